@@ -0,0 +1,25 @@
+// Coroutine frames on the pool.
+//
+// Coroutines of one kind all have the same frame size, and a server creates
+// and finishes them at about the same rate on each worker, so after warming
+// up nearly every frame is a pop from the thread's list of its size class.
+// Frames get the alignment operator new would give them.
+
+#include "Async/async.h"
+
+#include <cstddef>
+#include <new>
+
+#include "PoolAllocator/poolallocator.h"
+
+namespace async_detail {
+
+void* allocate_frame(std::size_t size) {
+  return pool_detail::allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void deallocate_frame(void* frame, std::size_t size) noexcept {
+  pool_detail::deallocate(frame, size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+}  // namespace async_detail
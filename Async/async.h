@@ -0,0 +1,240 @@
+#pragma once
+
+// Lazy coroutine tasks that run on ThreadPool.
+//
+// Task<T> starts only when awaited. Awaiting it records the awaiting
+// coroutine as its continuation and transfers to it symmetrically, and its
+// final suspension transfers back the same way, so chains of co_await run
+// as plain calls and returns without growing the stack. schedule(pool)
+// moves the awaiting coroutine onto a worker of the pool, spawn() starts a
+// detached task there, and sync_wait() blocks a thread that is not a
+// coroutine until a task is done.
+//
+// Frames come from PoolAllocator's pool: a per-thread free list of the
+// frame's size class, refilled and drained in batches. A frame freed on
+// another thread than the one it came from joins that thread's list, and
+// the surplus of a list goes back to the pool for any thread to take.
+
+#include <concepts>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "ThreadPool/threadpool.h"
+
+template <typename T = void>
+class Task;
+
+namespace async_detail {
+
+void* allocate_frame(std::size_t size);
+void deallocate_frame(void* frame, std::size_t size) noexcept;
+
+// Routes a coroutine's frame through the pool.
+struct FrameAllocated {
+  static void* operator new(std::size_t size) { return allocate_frame(size); }
+  static void operator delete(void* frame, std::size_t size) noexcept {
+    deallocate_frame(frame, size);
+  }
+};
+
+class PromiseBase : public FrameAllocated {
+ public:
+  struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> self) noexcept {
+      return self.promise().continuation_;
+    }
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() noexcept { error_ = std::current_exception(); }
+
+  void set_continuation(std::coroutine_handle<> continuation) noexcept {
+    continuation_ = continuation;
+  }
+
+ protected:
+  void rethrow_if_failed() const {
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+ private:
+  std::coroutine_handle<> continuation_ = std::noop_coroutine();
+  std::exception_ptr error_;
+};
+
+template <typename T>
+class Promise : public PromiseBase {
+ public:
+  Task<T> get_return_object() noexcept;
+
+  template <typename U = T>
+    requires std::constructible_from<T, U&&>
+  void return_value(U&& value) {
+    value_.emplace(std::forward<U>(value));
+  }
+
+  T result() {
+    rethrow_if_failed();
+    return std::move(*value_);
+  }
+
+ private:
+  std::optional<T> value_;
+};
+
+template <>
+class Promise<void> : public PromiseBase {
+ public:
+  Task<void> get_return_object() noexcept;
+  void return_void() const noexcept {}
+  void result() const { rethrow_if_failed(); }
+};
+
+// A coroutine that starts at once and frees itself when it ends.
+struct Detached {
+  struct promise_type : FrameAllocated {
+    Detached get_return_object() const noexcept { return {}; }
+    std::suspend_never initial_suspend() const noexcept { return {}; }
+    std::suspend_never final_suspend() const noexcept { return {}; }
+    void return_void() const noexcept {}
+    void unhandled_exception() const noexcept { std::terminate(); }
+  };
+};
+
+}  // namespace async_detail
+
+template <typename T>
+class [[nodiscard]] Task {
+  static_assert(!std::is_reference_v<T>, "Task: return a pointer or a value instead");
+
+ public:
+  using promise_type = async_detail::Promise<T>;
+
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      reset();
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+  ~Task() { reset(); }
+
+  // Runs the task, resuming the awaiting coroutine with its result or
+  // exception when it is done.
+  auto operator co_await() && noexcept {
+    struct Awaiter {
+      bool await_ready() const noexcept { return false; }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().set_continuation(awaiting);
+        return handle;
+      }
+      T await_resume() { return handle.promise().result(); }
+
+      std::coroutine_handle<promise_type> handle;
+    };
+    return Awaiter{handle_};
+  }
+
+ private:
+  friend promise_type;
+
+  explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+
+  void reset() noexcept {
+    if (handle_) {
+      handle_.destroy();
+      handle_ = nullptr;
+    }
+  }
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+template <typename T>
+Task<T> async_detail::Promise<T>::get_return_object() noexcept {
+  return Task<T>(std::coroutine_handle<Promise>::from_promise(*this));
+}
+
+inline Task<void> async_detail::Promise<void>::get_return_object() noexcept {
+  return Task<void>(std::coroutine_handle<Promise>::from_promise(*this));
+}
+
+// co_await schedule(pool) continues the coroutine on a worker of pool.
+inline auto schedule(ThreadPool& pool) noexcept {
+  struct Awaiter {
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> awaiting) {
+      pool->submit([awaiting] { awaiting.resume(); });
+    }
+    void await_resume() const noexcept {}
+
+    ThreadPool* pool;
+  };
+  return Awaiter{&pool};
+}
+
+namespace async_detail {
+
+inline Detached run_detached(ThreadPool& pool, Task<void> task) {
+  co_await schedule(pool);
+  co_await std::move(task);
+}
+
+}  // namespace async_detail
+
+// Runs task on pool without waiting for it. An exception escaping it
+// terminates, as one escaping a std::thread's function does.
+inline void spawn(ThreadPool& pool, Task<void> task) {
+  async_detail::run_detached(pool, std::move(task));
+}
+
+// Runs task on the calling thread until it first suspends, then blocks
+// until it is done; returns its result or rethrows its exception. Must not
+// be called from a coroutine, which would block a worker.
+template <typename T>
+T sync_wait(Task<T> task) {
+  std::mutex mutex;
+  std::condition_variable finished;
+  bool done = false;
+  std::exception_ptr error;
+  std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> result;
+
+  // Signals under the lock, so that this frame outlives the notification.
+  auto drive = [&](Task<T> awaited) -> async_detail::Detached {
+    try {
+      if constexpr (std::is_void_v<T>) {
+        co_await std::move(awaited);
+      } else {
+        result.emplace(co_await std::move(awaited));
+      }
+    } catch (...) {
+      error = std::current_exception();
+    }
+    std::lock_guard lock(mutex);
+    done = true;
+    finished.notify_one();
+  };
+  drive(std::move(task));
+
+  std::unique_lock lock(mutex);
+  finished.wait(lock, [&] { return done; });
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  if constexpr (!std::is_void_v<T>) {
+    return std::move(*result);
+  }
+}
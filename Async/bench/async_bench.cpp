@@ -0,0 +1,214 @@
+#include <benchmark/benchmark.h>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <vector>
+
+#include "Async/async.h"
+#include "Async/io_ring.h"
+
+namespace {
+
+Task<std::uint64_t> leaf(std::uint64_t value) { co_return value + 1; }
+
+Task<std::uint64_t> chain(std::size_t depth) {
+  if (depth == 0) {
+    co_return 0;
+  }
+  std::uint64_t below = co_await chain(depth - 1);
+  co_return co_await leaf(below);
+}
+
+// About 2 state.range(0) coroutine frames made, awaited and freed.
+void BM_AwaitChain(benchmark::State& state) {
+  const auto depth = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sync_wait(chain(depth)));
+  }
+  state.SetItemsProcessed(state.iterations() * 2 * state.range(0));
+}
+
+template <bool Cached>
+void BM_FrameAllocation(benchmark::State& state) {
+  constexpr std::size_t kFrames = 64;
+  constexpr std::size_t kFrameBytes = 192;
+  void* frames[kFrames];
+  for (auto _ : state) {
+    for (void*& frame : frames) {
+      frame = Cached ? async_detail::allocate_frame(kFrameBytes) : ::operator new(kFrameBytes);
+      benchmark::DoNotOptimize(frame);
+    }
+    for (void* frame : frames) {
+      if (Cached) {
+        async_detail::deallocate_frame(frame, kFrameBytes);
+      } else {
+        ::operator delete(frame, kFrameBytes);
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(kFrames));
+}
+
+// Waits until count reaches zero.
+void wait_for(std::atomic<std::size_t>& count) {
+  for (std::size_t left = count.load(); left != 0; left = count.load()) {
+    count.wait(left);
+  }
+}
+
+void finish(std::atomic<std::size_t>& count) {
+  if (count.fetch_sub(1) == 1) {
+    count.notify_all();
+  }
+}
+
+Task<void> hop(ThreadPool& pool, std::atomic<std::size_t>& left) {
+  co_await schedule(pool);
+  finish(left);
+}
+
+constexpr std::size_t kInFlight = 1024;
+
+// kInFlight tasks spawned at once, each hopping to a worker once more.
+void BM_SpawnAndHop(benchmark::State& state) {
+  ThreadPool& pool = ThreadPool::shared();
+  for (auto _ : state) {
+    std::atomic<std::size_t> left{kInFlight};
+    for (std::size_t i = 0; i < kInFlight; ++i) {
+      spawn(pool, hop(pool, left));
+    }
+    wait_for(left);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(kInFlight));
+}
+
+constexpr std::size_t kBlock = 4096;
+constexpr std::size_t kFileBlocks = 4096;
+
+// A 16 MiB scratch file, in the page cache after it is written.
+int scratch_file() {
+  static const int fd = [] {
+    char name[] = "/tmp/async_benchXXXXXX";
+    int file = mkstemp(name);
+    unlink(name);
+    std::vector<std::byte> block(kBlock, std::byte{1});
+    for (std::size_t i = 0; i < kFileBlocks; ++i) {
+      if (pwrite(file, block.data(), kBlock, static_cast<off_t>(i * kBlock)) < 0) {
+        std::abort();
+      }
+    }
+    return file;
+  }();
+  return fd;
+}
+
+Task<void> read_blocks(IoRing& ring, int fd, std::size_t first, std::size_t count,
+                       std::atomic<std::size_t>& left) {
+  std::vector<std::byte> buffer(kBlock);
+  for (std::size_t i = 0; i < count; ++i) {
+    co_await ring.read(fd, buffer, ((first + i * 7919) % kFileBlocks) * kBlock);
+  }
+  finish(left);
+}
+
+// state.range(1) coroutines reading kFileBlocks random 4 KiB blocks between
+// them.
+void BM_FileReads(benchmark::State& state) {
+  IoRing ring(ThreadPool::shared(), static_cast<IoBackend>(state.range(0)));
+  if (ring.backend() != static_cast<IoBackend>(state.range(0))) {
+    state.SkipWithError("io_uring unavailable");
+    return;
+  }
+  const int fd = scratch_file();
+  const auto readers = static_cast<std::size_t>(state.range(1));
+  for (auto _ : state) {
+    std::atomic<std::size_t> left{readers};
+    for (std::size_t r = 0; r < readers; ++r) {
+      spawn(ThreadPool::shared(), read_blocks(ring, fd, r, kFileBlocks / readers, left));
+    }
+    wait_for(left);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(kFileBlocks));
+}
+
+constexpr std::size_t kRoundTrips = 64;
+
+Task<void> ping_pong(IoRing& ring, int fd, std::atomic<std::size_t>& left) {
+  std::byte message[64] = {};
+  for (std::size_t i = 0; i < kRoundTrips; ++i) {
+    co_await ring.send(fd, message);
+    co_await ring.recv(fd, message);
+  }
+  finish(left);
+}
+
+Task<void> echo(IoRing& ring, int fd, std::atomic<std::size_t>& left) {
+  std::byte message[64];
+  for (std::size_t i = 0; i < kRoundTrips; ++i) {
+    std::size_t received = co_await ring.recv(fd, message);
+    co_await ring.send(fd, std::span(message, received));
+  }
+  finish(left);
+}
+
+// state.range(1) socket pairs, each with a client and an echoing server
+// coroutine, in flight at once. Only io_uring is measured: with the
+// blocking backend a client blocked in recv holds the worker its server
+// would need.
+void BM_EchoSockets(benchmark::State& state) {
+  IoRing ring(ThreadPool::shared(), static_cast<IoBackend>(state.range(0)));
+  if (ring.backend() != static_cast<IoBackend>(state.range(0))) {
+    state.SkipWithError("io_uring unavailable");
+    return;
+  }
+  const auto pairs = static_cast<std::size_t>(state.range(1));
+  std::vector<int> sockets(2 * pairs);
+  for (std::size_t p = 0; p < pairs; ++p) {
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, &sockets[2 * p]) != 0) {
+      state.SkipWithError("socketpair failed");
+      return;
+    }
+  }
+  for (auto _ : state) {
+    std::atomic<std::size_t> left{2 * pairs};
+    for (std::size_t p = 0; p < pairs; ++p) {
+      spawn(ThreadPool::shared(), echo(ring, sockets[2 * p + 1], left));
+      spawn(ThreadPool::shared(), ping_pong(ring, sockets[2 * p], left));
+    }
+    wait_for(left);
+  }
+  for (int socket : sockets) {
+    close(socket);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(pairs * kRoundTrips));
+}
+
+constexpr auto kIoUring = static_cast<std::int64_t>(IoBackend::IoUring);
+constexpr auto kBlocking = static_cast<std::int64_t>(IoBackend::Blocking);
+
+}  // namespace
+
+BENCHMARK(BM_AwaitChain)->Arg(1000);
+BENCHMARK(BM_FrameAllocation<true>)->Name("BM_FrameAllocation/cache");
+BENCHMARK(BM_FrameAllocation<false>)->Name("BM_FrameAllocation/operator_new");
+BENCHMARK(BM_SpawnAndHop)->UseRealTime();
+BENCHMARK(BM_FileReads)
+    ->ArgNames({"backend", "readers"})
+    ->Args({kBlocking, 1})
+    ->Args({kIoUring, 1})
+    ->Args({kIoUring, 64})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_EchoSockets)
+    ->ArgNames({"backend", "pairs"})
+    ->Args({kIoUring, 1})
+    ->Args({kIoUring, 1000})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
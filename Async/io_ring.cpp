@@ -0,0 +1,339 @@
+// The io_uring rings behind IoRing.
+//
+// Layout and protocol follow io_uring(7): the kernel shares a submission
+// ring of indices into an array of entries and a completion ring of
+// results, each with a head and a tail. The side that writes a tail
+// publishes with a release store after filling the entries; the side that
+// writes a head releases the entries it has read. Every submission enters
+// the kernel at once, so the kernel has consumed each entry before the
+// mutex is released and the submission ring never fills. No more requests
+// are in flight than the completion ring holds, so it never fills either.
+//
+// Many requests complete during the submission itself, reads from the page
+// cache for one. So the submitting thread, if no one else is at it, reaps
+// the completion ring right after entering the kernel and continues its
+// coroutine without suspending when its own request is among them; the
+// completion thread only sees the rest. A kernel may still refuse a
+// submission while the completion ring is full; the submitter reaps it
+// then, if it holds the completion lock, since the completion thread
+// cannot get to it meanwhile.
+
+#include "Async/io_ring.h"
+
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+namespace {
+
+static_assert(sizeof(std::int64_t[2]) == sizeof(__kernel_timespec));
+
+int io_uring_setup(unsigned entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+unsigned* at(void* base, std::uint32_t offset) {
+  return reinterpret_cast<unsigned*>(static_cast<std::byte*>(base) + offset);
+}
+
+unsigned load_acquire(unsigned* value) {
+  return std::atomic_ref<unsigned>(*value).load(std::memory_order_acquire);
+}
+
+void store_release(unsigned* value, unsigned next) {
+  std::atomic_ref<unsigned>(*value).store(next, std::memory_order_release);
+}
+
+// -errno of a failed system call, else its result.
+int result_of(long result) { return result < 0 ? -errno : static_cast<int>(result); }
+
+}  // namespace
+
+IoRing::IoRing(ThreadPool& pool, IoBackend backend, unsigned entries) : pool_(&pool) {
+  if (entries == 0) {
+    throw std::invalid_argument("IoRing: entries must be positive");
+  }
+  if (backend == IoBackend::Blocking) {
+    return;
+  }
+
+  io_uring_params params{};
+  // Room for many more completions than submissions at a time, so that
+  // requests in flight seldom overflow into the kernel's backlog.
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = 4 * entries;
+  const int fd = io_uring_setup(entries, &params);
+  if (fd < 0) {
+    return;
+  }
+
+  const std::size_t sq_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  const std::size_t cq_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0) {
+    // Kernels before 5.4 map the rings separately; not worth supporting.
+    close(fd);
+    return;
+  }
+  rings_bytes_ = std::max(sq_bytes, cq_bytes);
+  rings_ = mmap(nullptr, rings_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                IORING_OFF_SQ_RING);
+  if (rings_ == MAP_FAILED) {
+    rings_ = nullptr;
+    close(fd);
+    return;
+  }
+  sqes_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = mmap(nullptr, sqes_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+               IORING_OFF_SQES);
+  if (sqes_ == MAP_FAILED) {
+    sqes_ = nullptr;
+    munmap(rings_, rings_bytes_);
+    rings_ = nullptr;
+    close(fd);
+    return;
+  }
+
+  sq_head_ = at(rings_, params.sq_off.head);
+  sq_tail_ = at(rings_, params.sq_off.tail);
+  sq_mask_ = *at(rings_, params.sq_off.ring_mask);
+  sq_array_ = at(rings_, params.sq_off.array);
+  cq_head_ = at(rings_, params.cq_off.head);
+  cq_tail_ = at(rings_, params.cq_off.tail);
+  cq_mask_ = *at(rings_, params.cq_off.ring_mask);
+  cq_entries_ = params.cq_entries;
+  cqes_ = static_cast<std::byte*>(rings_) + params.cq_off.cqes;
+
+  ring_fd_ = fd;
+  completer_ = std::thread([this] { complete(); });
+}
+
+IoRing::~IoRing() {
+  if (ring_fd_ < 0) {
+    return;
+  }
+  Operation stop(*this, Operation::Kind::Stop, -1, nullptr, 0, 0, 0);
+  submit(stop);
+  completer_.join();
+  munmap(sqes_, sqes_bytes_);
+  munmap(rings_, rings_bytes_);
+  close(ring_fd_);
+}
+
+IoRing::Operation IoRing::read(int fd, std::span<std::byte> buffer, std::uint64_t offset) {
+  return Operation(*this, Operation::Kind::Read, fd, buffer.data(), buffer.size(), offset, 0);
+}
+
+IoRing::Operation IoRing::write(int fd, std::span<const std::byte> buffer, std::uint64_t offset) {
+  return Operation(*this, Operation::Kind::Write, fd, buffer.data(), buffer.size(), offset, 0);
+}
+
+IoRing::Operation IoRing::recv(int fd, std::span<std::byte> buffer, int flags) {
+  return Operation(*this, Operation::Kind::Recv, fd, buffer.data(), buffer.size(), 0, flags);
+}
+
+IoRing::Operation IoRing::send(int fd, std::span<const std::byte> buffer, int flags) {
+  return Operation(*this, Operation::Kind::Send, fd, buffer.data(), buffer.size(), 0, flags);
+}
+
+IoRing::Operation IoRing::accept(int fd) {
+  return Operation(*this, Operation::Kind::Accept, fd, nullptr, 0, 0, 0);
+}
+
+IoRing::Operation IoRing::connect(int fd, const sockaddr* address, socklen_t length) {
+  return Operation(*this, Operation::Kind::Connect, fd, address, length, 0, 0);
+}
+
+IoRing::Operation IoRing::sleep_for(std::chrono::nanoseconds duration) {
+  // The duration travels in the offset until submit() converts it.
+  const auto nanoseconds = static_cast<std::uint64_t>(std::max<std::int64_t>(duration.count(), 0));
+  return Operation(*this, Operation::Kind::Sleep, -1, nullptr, 0, nanoseconds, 0);
+}
+
+bool IoRing::submit(Operation& operation) {
+  // Takes a slot in the completion ring, before any lock, so that the
+  // completion thread can free one meanwhile.
+  unsigned in_flight = in_flight_.load(std::memory_order_relaxed);
+  while (in_flight == cq_entries_ ||
+         !in_flight_.compare_exchange_weak(in_flight, in_flight + 1,
+                                           std::memory_order_relaxed)) {
+    if (in_flight == cq_entries_) {
+      in_flight_.wait(in_flight, std::memory_order_relaxed);
+      in_flight = in_flight_.load(std::memory_order_relaxed);
+    }
+  }
+
+  std::lock_guard lock(submit_mutex_);
+  const unsigned tail = *sq_tail_;
+  const unsigned index = tail & sq_mask_;
+  io_uring_sqe& sqe = static_cast<io_uring_sqe*>(sqes_)[index];
+  sqe = io_uring_sqe{};
+  sqe.fd = operation.fd_;
+  sqe.addr = reinterpret_cast<std::uint64_t>(operation.address_);
+  sqe.len = static_cast<std::uint32_t>(operation.length_);
+  sqe.off = operation.offset_;
+  sqe.user_data = reinterpret_cast<std::uint64_t>(&operation);
+  switch (operation.kind_) {
+    case Operation::Kind::Read:
+      sqe.opcode = IORING_OP_READ;
+      break;
+    case Operation::Kind::Write:
+      sqe.opcode = IORING_OP_WRITE;
+      break;
+    case Operation::Kind::Recv:
+      sqe.opcode = IORING_OP_RECV;
+      sqe.msg_flags = static_cast<std::uint32_t>(operation.flags_);
+      break;
+    case Operation::Kind::Send:
+      sqe.opcode = IORING_OP_SEND;
+      sqe.msg_flags = static_cast<std::uint32_t>(operation.flags_);
+      break;
+    case Operation::Kind::Accept:
+      sqe.opcode = IORING_OP_ACCEPT;
+      sqe.accept_flags = SOCK_CLOEXEC;
+      break;
+    case Operation::Kind::Connect:
+      sqe.opcode = IORING_OP_CONNECT;
+      // The address length travels in the offset field.
+      sqe.len = 0;
+      sqe.off = operation.length_;
+      break;
+    case Operation::Kind::Sleep:
+      sqe.opcode = IORING_OP_TIMEOUT;
+      operation.timeout_[0] = static_cast<std::int64_t>(operation.offset_ / 1'000'000'000);
+      operation.timeout_[1] = static_cast<std::int64_t>(operation.offset_ % 1'000'000'000);
+      sqe.off = 0;
+      sqe.addr = reinterpret_cast<std::uint64_t>(operation.timeout_);
+      sqe.len = 1;
+      break;
+    case Operation::Kind::Stop:
+      sqe.opcode = IORING_OP_NOP;
+      break;
+  }
+  sq_array_[index] = index;
+  store_release(sq_tail_, tail + 1);
+
+  // Holding the completion lock across the submission keeps anyone else
+  // from handing this operation's completion to the pool first. The
+  // destructor's Stop must reach the completion thread, so it never takes
+  // it.
+  std::unique_lock reaping(complete_mutex_, std::defer_lock);
+  if (operation.kind_ != Operation::Kind::Stop) {
+    reaping.try_lock();
+  }
+  bool completed = false;
+  while (true) {
+    const int submitted = io_uring_enter(ring_fd_, 1, 0, 0);
+    if (submitted >= 0) {
+      break;
+    }
+    if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      const int error = errno;
+      // Not consumed: take the entry back.
+      store_release(sq_tail_, tail);
+      in_flight_.fetch_sub(1, std::memory_order_relaxed);
+      in_flight_.notify_all();
+      throw std::system_error(error, std::system_category(), "IoRing: io_uring_enter");
+    }
+    // EBUSY is a full completion ring, which only the holder of the
+    // completion lock can empty.
+    if (reaping.owns_lock()) {
+      completed = drain(&operation) || completed;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  return reaping.owns_lock() && (drain(&operation) || completed);
+}
+
+void IoRing::complete() {
+  while (true) {
+    io_uring_enter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+    std::lock_guard lock(complete_mutex_);
+    drain(nullptr);
+    if (stopping_) {
+      return;
+    }
+  }
+}
+
+bool IoRing::drain(const Operation* mine) {
+  bool found = false;
+  const unsigned first = *cq_head_;
+  const unsigned tail = load_acquire(cq_tail_);
+  if (first == tail) {
+    return false;
+  }
+  unsigned head = first;
+  for (; head != tail; ++head) {
+    const io_uring_cqe& cqe = static_cast<const io_uring_cqe*>(cqes_)[head & cq_mask_];
+    auto* operation = reinterpret_cast<Operation*>(cqe.user_data);
+    operation->result_ = cqe.res;
+    if (operation == mine) {
+      found = true;
+    } else if (operation->kind_ == Operation::Kind::Stop) {
+      stopping_ = true;
+    } else {
+      pool_->submit([awaiting = operation->awaiting_] { awaiting.resume(); });
+    }
+  }
+  store_release(cq_head_, head);
+  in_flight_.fetch_sub(tail - first, std::memory_order_relaxed);
+  in_flight_.notify_all();
+  return found;
+}
+
+int IoRing::run_blocking(Operation& operation) {
+  void* buffer = const_cast<void*>(operation.address_);
+  const auto offset = static_cast<off_t>(operation.offset_);
+  switch (operation.kind_) {
+    case Operation::Kind::Read:
+      return result_of(pread(operation.fd_, buffer, operation.length_, offset));
+    case Operation::Kind::Write:
+      return result_of(pwrite(operation.fd_, buffer, operation.length_, offset));
+    case Operation::Kind::Recv:
+      return result_of(::recv(operation.fd_, buffer, operation.length_, operation.flags_));
+    case Operation::Kind::Send:
+      return result_of(::send(operation.fd_, buffer, operation.length_, operation.flags_));
+    case Operation::Kind::Accept:
+      return result_of(accept4(operation.fd_, nullptr, nullptr, SOCK_CLOEXEC));
+    case Operation::Kind::Connect:
+      return result_of(::connect(operation.fd_, static_cast<const sockaddr*>(operation.address_),
+                                 static_cast<socklen_t>(operation.length_)));
+    case Operation::Kind::Sleep:
+      std::this_thread::sleep_for(std::chrono::nanoseconds(operation.offset_));
+      return 0;
+    case Operation::Kind::Stop:
+      break;
+  }
+  return 0;
+}
+
+std::size_t IoRing::Operation::await_resume() const {
+  // A timeout that simply expired reports -ETIME.
+  if (kind_ == Kind::Sleep && result_ == -ETIME) {
+    return 0;
+  }
+  if (result_ < 0) {
+    throw std::system_error(-result_, std::system_category(), "IoRing: operation failed");
+  }
+  return static_cast<std::size_t>(result_);
+}
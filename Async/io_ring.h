@@ -0,0 +1,152 @@
+#pragma once
+
+// File and socket operations for coroutines, on Linux io_uring.
+//
+// co_await ring.read(fd, buffer, offset) and the like queue one request on
+// the ring and suspend; a thread of the ring waits for completions and
+// hands each suspended coroutine back to the ThreadPool with its result.
+// Requests that complete while being submitted do not suspend at all. No
+// thread blocks per request, so a few workers keep thousands of them in
+// flight, up to the size of the completion queue; past that, submitting
+// waits until a request completes. The ring is driven through the raw
+// system calls, without liburing. The awaiting coroutines run on any
+// worker, so the submission queue is filled under a mutex, and the
+// completion queue read under another.
+//
+// Where io_uring is unavailable (an old kernel, or a sandbox that forbids
+// it), or when IoBackend::Blocking is asked for, every operation instead
+// runs as a plain blocking system call on the coroutine's thread, with the
+// same results.
+//
+// Results are those of the system calls: bytes transferred, 0 at end of
+// file, the new descriptor for accept. Failures throw std::system_error.
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <thread>
+
+#include "ThreadPool/threadpool.h"
+
+enum class IoBackend { IoUring, Blocking };
+
+class IoRing {
+ public:
+  class Operation;
+
+  // A ring for at least entries requests submitted at a time and four times
+  // as many in flight. Falls back to IoBackend::Blocking if io_uring cannot
+  // be set up. Throws std::invalid_argument for 0 entries.
+  explicit IoRing(ThreadPool& pool = ThreadPool::shared(), IoBackend backend = IoBackend::IoUring,
+                  unsigned entries = 256);
+
+  IoRing(const IoRing&) = delete;
+  IoRing& operator=(const IoRing&) = delete;
+
+  // Operations still in flight must have completed.
+  ~IoRing();
+
+  IoBackend backend() const noexcept {
+    return ring_fd_ < 0 ? IoBackend::Blocking : IoBackend::IoUring;
+  }
+
+  Operation read(int fd, std::span<std::byte> buffer, std::uint64_t offset);
+  Operation write(int fd, std::span<const std::byte> buffer, std::uint64_t offset);
+  Operation recv(int fd, std::span<std::byte> buffer, int flags = 0);
+  Operation send(int fd, std::span<const std::byte> buffer, int flags = 0);
+  Operation accept(int fd);
+  // address must stay valid until the operation completes.
+  Operation connect(int fd, const sockaddr* address, socklen_t length);
+  // Resumes, with result 0, after the given time.
+  Operation sleep_for(std::chrono::nanoseconds duration);
+
+ private:
+  friend class Operation;
+
+  // Queues operation; true if it has already completed.
+  bool submit(Operation& operation);
+  int run_blocking(Operation& operation);
+  // The completion thread.
+  void complete();
+  // Hands the completions queued so far to their coroutines, except
+  // mine's, and says whether it was among them. Under complete_mutex_.
+  bool drain(const Operation* mine);
+
+  ThreadPool* pool_;
+  int ring_fd_ = -1;
+
+  std::mutex submit_mutex_;
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned sq_mask_ = 0;
+  void* sqes_ = nullptr;
+
+  std::mutex complete_mutex_;
+  bool stopping_ = false;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  void* cqes_ = nullptr;
+
+  // Requests submitted and not yet reaped, at most cq_entries_, so that
+  // the completion queue cannot overflow.
+  unsigned cq_entries_ = 0;
+  std::atomic<unsigned> in_flight_{0};
+
+  void* rings_ = nullptr;
+  std::size_t rings_bytes_ = 0;
+  std::size_t sqes_bytes_ = 0;
+
+  std::thread completer_;
+};
+
+// The awaitable of one request. It lives in the awaiting coroutine's frame
+// while the request is in flight, and so must be awaited where it is made.
+class IoRing::Operation {
+ public:
+  Operation(const Operation&) = delete;
+  Operation& operator=(const Operation&) = delete;
+
+  bool await_ready() {
+    if (ring_->backend() == IoBackend::Blocking) {
+      result_ = ring_->run_blocking(*this);
+      return true;
+    }
+    return false;
+  }
+  bool await_suspend(std::coroutine_handle<> awaiting) {
+    awaiting_ = awaiting;
+    return !ring_->submit(*this);
+  }
+  std::size_t await_resume() const;
+
+ private:
+  friend class IoRing;
+
+  enum class Kind : std::uint8_t { Read, Write, Recv, Send, Accept, Connect, Sleep, Stop };
+
+  Operation(IoRing& ring, Kind kind, int fd, const void* address, std::size_t length,
+            std::uint64_t offset, int flags)
+      : ring_(&ring), kind_(kind), fd_(fd), flags_(flags), address_(address), length_(length),
+        offset_(offset) {}
+
+  IoRing* ring_;
+  Kind kind_;
+  int fd_;
+  int flags_;
+  const void* address_;
+  std::size_t length_;
+  std::uint64_t offset_;
+  // The kernel's struct __kernel_timespec, for Sleep.
+  std::int64_t timeout_[2] = {0, 0};
+
+  std::coroutine_handle<> awaiting_;
+  int result_ = 0;
+};
@@ -0,0 +1,286 @@
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <latch>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "Async/async.h"
+#include "Async/io_ring.h"
+#include "PoolAllocator/poolallocator.h"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+Task<int> value(int x) { co_return x; }
+
+Task<int> sum_of(int a, int b) { co_return co_await value(a) + co_await value(b); }
+
+Task<std::unique_ptr<int>> boxed(int x) { co_return std::make_unique<int>(x); }
+
+Task<int> fails() {
+  throw std::runtime_error("task");
+  co_return 0;
+}
+
+Task<int> catches() {
+  try {
+    co_await fails();
+  } catch (const std::runtime_error&) {
+    co_return 1;
+  }
+  co_return 0;
+}
+
+// Each level awaits the next: with symmetric transfer the stack stays flat.
+Task<std::size_t> depth(std::size_t n) {
+  if (n == 0) {
+    co_return 0;
+  }
+  co_return 1 + co_await depth(n - 1);
+}
+
+struct Counted {
+  static inline int alive = 0;
+  Counted() { ++alive; }
+  Counted(const Counted&) { ++alive; }
+  ~Counted() { --alive; }
+};
+
+Task<int> holds(Counted) { co_return 0; }
+
+TEST(Task, ReturnsThroughSyncWait) {
+  EXPECT_EQ(sync_wait(value(7)), 7);
+  EXPECT_EQ(sync_wait(sum_of(2, 3)), 5);
+  EXPECT_EQ(*sync_wait(boxed(4)), 4);
+}
+
+TEST(Task, PropagatesExceptions) {
+  EXPECT_THROW(sync_wait(fails()), std::runtime_error);
+  EXPECT_EQ(sync_wait(catches()), 1);
+}
+
+TEST(Task, DeepChainsDoNotGrowTheStack) {
+  EXPECT_EQ(sync_wait(depth(1000000)), 1000000u);
+}
+
+TEST(Task, FramesComeFromThePool) {
+  void* frame = async_detail::allocate_frame(200);
+  async_detail::deallocate_frame(frame, 200);
+  void* block = pool_detail::allocate(200, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+  EXPECT_EQ(block, frame);
+  pool_detail::deallocate(block, 200, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+  // Once warm, a million frames made and freed take no new slabs.
+  EXPECT_EQ(sync_wait(depth(1000)), 1000u);
+  const std::size_t reserved = pool_detail::reserved_bytes();
+  for (int round = 0; round < 1000; ++round) {
+    ASSERT_EQ(sync_wait(depth(1000)), 1000u);
+  }
+  EXPECT_EQ(pool_detail::reserved_bytes(), reserved);
+}
+
+TEST(Task, IsLazyAndFreesAnUnstartedFrame) {
+  {
+    Task<int> task = holds(Counted());
+    EXPECT_EQ(Counted::alive, 1);
+    Task<int> moved = std::move(task);
+    EXPECT_EQ(Counted::alive, 1);
+  }
+  EXPECT_EQ(Counted::alive, 0);
+}
+
+TEST(Task, ScheduleMovesToThePool) {
+  ThreadPool pool(2);
+  const auto caller = std::this_thread::get_id();
+  auto where = [&]() -> Task<std::thread::id> {
+    co_await schedule(pool);
+    co_return std::this_thread::get_id();
+  };
+  EXPECT_NE(sync_wait(where()), caller);
+}
+
+TEST(Task, SpawnRunsDetachedTasks) {
+  ThreadPool pool(4);
+  constexpr int kTasks = 10000;
+  std::atomic<int> total{0};
+  std::latch done(kTasks);
+  auto add = [&](int x) -> Task<void> {
+    total.fetch_add(co_await sum_of(x, 1), std::memory_order_relaxed);
+    done.count_down();
+  };
+  for (int i = 0; i < kTasks; ++i) {
+    spawn(pool, add(i));
+  }
+  done.wait();
+  EXPECT_EQ(total.load(), kTasks * (kTasks - 1) / 2 + kTasks);
+}
+
+// A temporary file, removed at the end.
+class TempFile {
+ public:
+  TempFile() {
+    std::string path = testing::TempDir() + "async_test_XXXXXX";
+    fd_ = ::mkstemp(path.data());
+    if (fd_ < 0) {
+      throw std::system_error(errno, std::system_category(), "mkstemp");
+    }
+    ::unlink(path.c_str());
+  }
+  TempFile(const TempFile&) = delete;
+  TempFile& operator=(const TempFile&) = delete;
+  ~TempFile() { ::close(fd_); }
+
+  int fd() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+std::span<const std::byte> bytes_of(std::string_view text) {
+  return std::as_bytes(std::span(text.data(), text.size()));
+}
+
+std::string text_of(std::span<const std::byte> bytes) {
+  return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+}
+
+// Every operation on both backends; the io_uring one falls back to
+// blocking calls where the kernel does not allow it.
+class IoRingTest : public testing::TestWithParam<IoBackend> {
+ protected:
+  ThreadPool pool_{4};
+  IoRing ring_{pool_, GetParam(), 8};
+};
+
+TEST_P(IoRingTest, ReadsAndWritesFiles) {
+  TempFile file;
+  auto io = [&]() -> Task<std::string> {
+    co_await schedule(pool_);
+    EXPECT_EQ(co_await ring_.write(file.fd(), bytes_of("hello, world"), 0), 12u);
+    EXPECT_EQ(co_await ring_.write(file.fd(), bytes_of("W"), 7), 1u);
+    std::vector<std::byte> buffer(64);
+    const std::size_t read = co_await ring_.read(file.fd(), buffer, 0);
+    EXPECT_EQ(co_await ring_.read(file.fd(), buffer, 12), 0u);
+    co_return text_of(std::span(buffer).first(read));
+  };
+  EXPECT_EQ(sync_wait(io()), "hello, World");
+}
+
+TEST_P(IoRingTest, FailuresThrow) {
+  auto bad = [&]() -> Task<std::size_t> {
+    std::vector<std::byte> buffer(8);
+    co_return co_await ring_.read(-1, buffer, 0);
+  };
+  EXPECT_THROW(sync_wait(bad()), std::system_error);
+}
+
+TEST_P(IoRingTest, SendsAndReceivesOnSockets) {
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  auto exchange = [&]() -> Task<std::string> {
+    co_await schedule(pool_);
+    EXPECT_EQ(co_await ring_.send(fds[0], bytes_of("ping")), 4u);
+    std::vector<std::byte> buffer(16);
+    const std::size_t received = co_await ring_.recv(fds[1], buffer);
+    co_return text_of(std::span(buffer).first(received));
+  };
+  EXPECT_EQ(sync_wait(exchange()), "ping");
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+TEST_P(IoRingTest, AcceptsAndConnects) {
+  const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(listener, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+  ASSERT_EQ(::listen(listener, 4), 0);
+  socklen_t length = sizeof(address);
+  ASSERT_EQ(::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length), 0);
+  const int client = ::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(client, 0);
+
+  std::latch connected(1);
+  auto connect = [&]() -> Task<void> {
+    co_await ring_.connect(client, reinterpret_cast<const sockaddr*>(&address), length);
+    co_await ring_.send(client, bytes_of("over tcp"));
+    connected.count_down();
+  };
+  auto serve = [&]() -> Task<std::string> {
+    co_await schedule(pool_);
+    const int accepted = static_cast<int>(co_await ring_.accept(listener));
+    std::vector<std::byte> buffer(16);
+    std::size_t received = 0;
+    while (received < 8) {
+      received += co_await ring_.recv(accepted, std::span(buffer).subspan(received));
+    }
+    ::close(accepted);
+    co_return text_of(std::span(buffer).first(received));
+  };
+  spawn(pool_, connect());
+  EXPECT_EQ(sync_wait(serve()), "over tcp");
+  connected.wait();
+  ::close(client);
+  ::close(listener);
+}
+
+TEST_P(IoRingTest, SleepsAtLeastTheDuration) {
+  auto nap = [&]() -> Task<std::chrono::steady_clock::duration> {
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(co_await ring_.sleep_for(5ms), 0u);
+    co_await ring_.sleep_for(0ns);
+    co_return std::chrono::steady_clock::now() - start;
+  };
+  EXPECT_GE(sync_wait(nap()), 5ms);
+}
+
+// Far more sleepers in flight than the ring's eight entries: submissions
+// wait for completions and must keep the completion queue from
+// overflowing.
+TEST_P(IoRingTest, MoreRequestsThanTheCompletionQueueHolds) {
+  for (int round = 0; round < 3; ++round) {
+    constexpr int kSleepers = 3000;
+    std::latch done(kSleepers);
+    auto sleeper = [&](int i) -> Task<void> {
+      co_await ring_.sleep_for(std::chrono::microseconds(100 + i % 50));
+      co_await ring_.sleep_for(0ns);
+      done.count_down();
+    };
+    for (int i = 0; i < kSleepers; ++i) {
+      spawn(pool_, sleeper(i));
+    }
+    done.wait();
+  }
+}
+
+std::string backend_name(const testing::TestParamInfo<IoBackend>& info) {
+  return info.param == IoBackend::IoUring ? "IoUring" : "Blocking";
+}
+
+INSTANTIATE_TEST_SUITE_P(Backend, IoRingTest,
+                         testing::Values(IoBackend::IoUring, IoBackend::Blocking), backend_name);
+
+TEST(IoRing, RejectsZeroEntries) {
+  EXPECT_THROW(IoRing(ThreadPool::shared(), IoBackend::IoUring, 0), std::invalid_argument);
+  EXPECT_EQ(IoRing(ThreadPool::shared(), IoBackend::Blocking).backend(), IoBackend::Blocking);
+}
+
+}  // namespace
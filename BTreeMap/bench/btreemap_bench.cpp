@@ -0,0 +1,203 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "BTreeMap/btreemap.h"
+
+namespace {
+
+// Not std::less, so the map searches its nodes with binary search.
+struct PlainLess {
+  bool operator()(std::uint64_t lhs, std::uint64_t rhs) const { return lhs < rhs; }
+};
+
+using Map = BTreeMap<std::uint64_t, std::uint64_t>;
+using BinarySearchMap = BTreeMap<std::uint64_t, std::uint64_t, PlainLess>;
+
+// Sorted distinct random keys, the value of each its rank.
+const std::vector<std::pair<std::uint64_t, std::uint64_t>>& entries(std::size_t count) {
+  static std::map<std::size_t, std::vector<std::pair<std::uint64_t, std::uint64_t>>> cache;
+  auto& result = cache[count];
+  if (result.empty()) {
+    std::mt19937_64 random(count);
+    std::vector<std::uint64_t> keys(count + count / 8);
+    for (auto& key : keys) {
+      key = random();
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    keys.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      result.emplace_back(keys[i], i);
+    }
+  }
+  return result;
+}
+
+// Keys of the map in random order, so that lookups miss the caches.
+std::vector<std::uint64_t> probes(std::size_t count) {
+  const auto& sorted = entries(count);
+  std::vector<std::uint64_t> keys;
+  keys.reserve(count);
+  for (const auto& entry : sorted) {
+    keys.push_back(entry.first);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937_64(42));
+  return keys;
+}
+
+template <typename M>
+void find_keys(benchmark::State& state, const M& map, const std::vector<std::uint64_t>& keys) {
+  std::size_t i = 0;
+  for (auto _ : state) {
+    auto it = map.find(keys[i]);
+    benchmark::DoNotOptimize(it);
+    if (++i == keys.size()) {
+      i = 0;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_StdMapFind(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto& sorted = entries(count);
+  std::map<std::uint64_t, std::uint64_t> map(sorted.begin(), sorted.end());
+  find_keys(state, map, probes(count));
+}
+
+void BM_BTreeMapFind(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto& sorted = entries(count);
+  Map map = Map::from_sorted(sorted.begin(), sorted.end());
+  find_keys(state, map, probes(count));
+}
+
+void BM_BTreeMapFindBinarySearch(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto& sorted = entries(count);
+  BinarySearchMap map = BinarySearchMap::from_sorted(sorted.begin(), sorted.end());
+  find_keys(state, map, probes(count));
+}
+
+void BM_BTreeMapFindIsa(benchmark::State& state) {
+  auto isa = static_cast<btreemap_detail::SearchIsa>(state.range(1));
+  btreemap_detail::SearchIsa previous = btreemap_detail::active_search_isa();
+  if (!btreemap_detail::select_search_isa(isa)) {
+    state.SkipWithError("instruction set not supported");
+    return;
+  }
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto& sorted = entries(count);
+  Map map = Map::from_sorted(sorted.begin(), sorted.end());
+  find_keys(state, map, probes(count));
+  btreemap_detail::select_search_isa(previous);
+}
+
+void BM_StdMapInsertRandom(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto keys = probes(count);
+  for (auto _ : state) {
+    std::map<std::uint64_t, std::uint64_t> map;
+    for (std::uint64_t key : keys) {
+      map.try_emplace(key, key);
+    }
+    benchmark::DoNotOptimize(map.size());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(count));
+}
+
+void BM_BTreeMapInsertRandom(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto keys = probes(count);
+  for (auto _ : state) {
+    Map map;
+    for (std::uint64_t key : keys) {
+      map.try_emplace(key, key);
+    }
+    benchmark::DoNotOptimize(map.size());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(count));
+}
+
+// Building from sorted input: std::map with the end hint, which is also
+// linear, against the bottom-up bulk load.
+void BM_StdMapFromSorted(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto& sorted = entries(count);
+  for (auto _ : state) {
+    std::map<std::uint64_t, std::uint64_t> map(sorted.begin(), sorted.end());
+    benchmark::DoNotOptimize(map.size());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(count));
+}
+
+void BM_BTreeMapFromSorted(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto& sorted = entries(count);
+  for (auto _ : state) {
+    Map map = Map::from_sorted(sorted.begin(), sorted.end());
+    benchmark::DoNotOptimize(map.size());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(count));
+}
+
+// Sums the values of 1000 consecutive keys from a random start.
+template <typename M>
+void scan_ranges(benchmark::State& state, const M& map, const std::vector<std::uint64_t>& keys) {
+  constexpr std::size_t kLength = 1000;
+  std::size_t i = 0;
+  for (auto _ : state) {
+    std::uint64_t sum = 0;
+    std::size_t left = kLength;
+    for (auto it = map.lower_bound(keys[i]); it != map.end() && left > 0; ++it, --left) {
+      sum += it->second;
+    }
+    benchmark::DoNotOptimize(sum);
+    if (++i == keys.size()) {
+      i = 0;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(kLength));
+}
+
+void BM_StdMapRangeScan(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto& sorted = entries(count);
+  std::map<std::uint64_t, std::uint64_t> map(sorted.begin(), sorted.end());
+  scan_ranges(state, map, probes(count));
+}
+
+void BM_BTreeMapRangeScan(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto& sorted = entries(count);
+  Map map = Map::from_sorted(sorted.begin(), sorted.end());
+  scan_ranges(state, map, probes(count));
+}
+
+constexpr auto kPortable = static_cast<std::int64_t>(btreemap_detail::SearchIsa::Portable);
+constexpr auto kAvx2 = static_cast<std::int64_t>(btreemap_detail::SearchIsa::Avx2);
+constexpr auto kAvx512 = static_cast<std::int64_t>(btreemap_detail::SearchIsa::Avx512);
+
+}  // namespace
+
+BENCHMARK(BM_StdMapFind)->RangeMultiplier(64)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_BTreeMapFind)->RangeMultiplier(64)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_BTreeMapFindBinarySearch)->RangeMultiplier(64)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_BTreeMapFindIsa)
+    ->ArgNames({"keys", "isa"})
+    ->ArgsProduct({{1 << 16}, {kPortable, kAvx2, kAvx512}});
+BENCHMARK(BM_StdMapInsertRandom)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BTreeMapInsertRandom)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_StdMapFromSorted)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BTreeMapFromSorted)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_StdMapRangeScan)->Arg(1 << 20);
+BENCHMARK(BM_BTreeMapRangeScan)->Arg(1 << 20);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,354 @@
+// Key search kernels behind BTreeMap's lookups.
+//
+// A kernel counts the keys of a node below the one looked up. The keys are
+// sorted, so that count is the lower bound, and computing it over the whole
+// node with vector compares and a popcount replaces the log2(size)
+// unpredictable branches of a binary search. Nodes hold at most 64 keys, so
+// this is a handful of instructions. Every instruction set provides kernels
+// for 32- and 64-bit keys, signed and unsigned, and one set is picked at
+// first use from the CPU features: AVX-512 or AVX2 on x86 (SSE2 has no
+// 64-bit compare), NEON on AArch64 and a portable loop elsewhere, which
+// compilers vectorize where they can.
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "BTreeMap/btreemap.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BTREE_SEARCH_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define BTREE_SEARCH_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace btreemap_detail {
+
+namespace {
+
+// Keys arrive as bytes because int64_t is long on some platforms and long
+// long on others; the kernels only care about width and signedness.
+struct Kernels {
+  SearchIsa isa;
+  std::size_t (*less_i32)(const void*, std::size_t, std::int32_t);
+  std::size_t (*less_u32)(const void*, std::size_t, std::uint32_t);
+  std::size_t (*less_i64)(const void*, std::size_t, std::int64_t);
+  std::size_t (*less_u64)(const void*, std::size_t, std::uint64_t);
+};
+
+template <typename T>
+std::size_t count_less_portable(const void* keys, std::size_t size, T key) {
+  auto bytes = static_cast<const unsigned char*>(keys);
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    T value;
+    std::memcpy(&value, bytes + i * sizeof(T), sizeof(T));
+    count += value < key ? 1 : 0;
+  }
+  return count;
+}
+
+constexpr Kernels kPortable{SearchIsa::Portable, count_less_portable<std::int32_t>,
+                            count_less_portable<std::uint32_t>,
+                            count_less_portable<std::int64_t>,
+                            count_less_portable<std::uint64_t>};
+
+#if defined(BTREE_SEARCH_X86)
+
+// AVX2 only compares signed integers; flipping the sign bit of both sides
+// maps unsigned order onto signed order.
+
+template <bool Signed>
+__attribute__((target("avx2"))) std::size_t count_less32_avx2(const void* keys,
+                                                              std::size_t size,
+                                                              std::uint32_t key) {
+  const std::uint32_t flip = Signed ? 0 : 0x80000000u;
+  const __m256i bias = _mm256_set1_epi32(static_cast<int>(flip));
+  const __m256i pattern = _mm256_set1_epi32(static_cast<int>(key ^ flip));
+  auto data = static_cast<const unsigned char*>(keys);
+  std::size_t count = 0;
+  std::size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    __m256i block = _mm256_xor_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i * 4)), bias);
+    __m256i less = _mm256_cmpgt_epi32(pattern, block);
+    count += static_cast<std::size_t>(
+        std::popcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(less)))));
+  }
+  for (; i < size; ++i) {
+    std::uint32_t value;
+    std::memcpy(&value, data + i * 4, 4);
+    count += static_cast<std::int32_t>(value ^ flip) < static_cast<std::int32_t>(key ^ flip);
+  }
+  return count;
+}
+
+template <bool Signed>
+__attribute__((target("avx2"))) std::size_t count_less64_avx2(const void* keys,
+                                                              std::size_t size,
+                                                              std::uint64_t key) {
+  const std::uint64_t flip = Signed ? 0 : 0x8000000000000000ull;
+  const __m256i bias = _mm256_set1_epi64x(static_cast<long long>(flip));
+  const __m256i pattern = _mm256_set1_epi64x(static_cast<long long>(key ^ flip));
+  auto data = static_cast<const unsigned char*>(keys);
+  std::size_t count = 0;
+  std::size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    __m256i block = _mm256_xor_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i * 8)), bias);
+    __m256i less = _mm256_cmpgt_epi64(pattern, block);
+    count += static_cast<std::size_t>(
+        std::popcount(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(less)))));
+  }
+  for (; i < size; ++i) {
+    std::uint64_t value;
+    std::memcpy(&value, data + i * 8, 8);
+    count += static_cast<std::int64_t>(value ^ flip) < static_cast<std::int64_t>(key ^ flip);
+  }
+  return count;
+}
+
+constexpr Kernels kAvx2{
+    SearchIsa::Avx2,
+    [](const void* keys, std::size_t size, std::int32_t key) {
+      return count_less32_avx2<true>(keys, size, static_cast<std::uint32_t>(key));
+    },
+    count_less32_avx2<false>,
+    [](const void* keys, std::size_t size, std::int64_t key) {
+      return count_less64_avx2<true>(keys, size, static_cast<std::uint64_t>(key));
+    },
+    count_less64_avx2<false>};
+
+// AVX-512 compares unsigned integers directly into mask registers, and a
+// masked load covers the tail of the node without reading past it.
+
+__attribute__((target("avx512f"))) std::size_t count_less_i32_avx512(const void* keys,
+                                                                     std::size_t size,
+                                                                     std::int32_t key) {
+  const __m512i pattern = _mm512_set1_epi32(key);
+  auto data = static_cast<const int*>(keys);
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < size; i += 16) {
+    const auto lanes = static_cast<__mmask16>(size - i >= 16 ? 0xFFFF : (1u << (size - i)) - 1);
+    __m512i block = _mm512_maskz_loadu_epi32(lanes, data + i);
+    count += static_cast<std::size_t>(
+        std::popcount(static_cast<unsigned>(_mm512_mask_cmplt_epi32_mask(lanes, block, pattern))));
+  }
+  return count;
+}
+
+__attribute__((target("avx512f"))) std::size_t count_less_u32_avx512(const void* keys,
+                                                                     std::size_t size,
+                                                                     std::uint32_t key) {
+  const __m512i pattern = _mm512_set1_epi32(static_cast<int>(key));
+  auto data = static_cast<const int*>(keys);
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < size; i += 16) {
+    const auto lanes = static_cast<__mmask16>(size - i >= 16 ? 0xFFFF : (1u << (size - i)) - 1);
+    __m512i block = _mm512_maskz_loadu_epi32(lanes, data + i);
+    count += static_cast<std::size_t>(
+        std::popcount(static_cast<unsigned>(_mm512_mask_cmplt_epu32_mask(lanes, block, pattern))));
+  }
+  return count;
+}
+
+__attribute__((target("avx512f"))) std::size_t count_less_i64_avx512(const void* keys,
+                                                                     std::size_t size,
+                                                                     std::int64_t key) {
+  const __m512i pattern = _mm512_set1_epi64(key);
+  auto data = static_cast<const long long*>(keys);
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < size; i += 8) {
+    const auto lanes = static_cast<__mmask8>(size - i >= 8 ? 0xFF : (1u << (size - i)) - 1);
+    __m512i block = _mm512_maskz_loadu_epi64(lanes, data + i);
+    count += static_cast<std::size_t>(
+        std::popcount(static_cast<unsigned>(_mm512_mask_cmplt_epi64_mask(lanes, block, pattern))));
+  }
+  return count;
+}
+
+__attribute__((target("avx512f"))) std::size_t count_less_u64_avx512(const void* keys,
+                                                                     std::size_t size,
+                                                                     std::uint64_t key) {
+  const __m512i pattern = _mm512_set1_epi64(static_cast<long long>(key));
+  auto data = static_cast<const long long*>(keys);
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < size; i += 8) {
+    const auto lanes = static_cast<__mmask8>(size - i >= 8 ? 0xFF : (1u << (size - i)) - 1);
+    __m512i block = _mm512_maskz_loadu_epi64(lanes, data + i);
+    count += static_cast<std::size_t>(
+        std::popcount(static_cast<unsigned>(_mm512_mask_cmplt_epu64_mask(lanes, block, pattern))));
+  }
+  return count;
+}
+
+constexpr Kernels kAvx512{SearchIsa::Avx512, count_less_i32_avx512, count_less_u32_avx512,
+                          count_less_i64_avx512, count_less_u64_avx512};
+
+#endif  // BTREE_SEARCH_X86
+
+#if defined(BTREE_SEARCH_NEON)
+
+// A true compare lane is all ones, so subtracting the compare results
+// counts them; a scalar loop covers the tail.
+
+template <typename T>
+std::size_t count_tail(const void* keys, std::size_t begin, std::size_t size, T key) {
+  auto bytes = static_cast<const unsigned char*>(keys);
+  std::size_t count = 0;
+  for (std::size_t i = begin; i < size; ++i) {
+    T value;
+    std::memcpy(&value, bytes + i * sizeof(T), sizeof(T));
+    count += value < key ? 1 : 0;
+  }
+  return count;
+}
+
+std::size_t count_less_i32_neon(const void* keys, std::size_t size, std::int32_t key) {
+  const int32x4_t pattern = vdupq_n_s32(key);
+  auto data = static_cast<const std::int32_t*>(keys);
+  uint32x4_t total = vdupq_n_u32(0);
+  std::size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    total = vsubq_u32(total, vcltq_s32(vld1q_s32(data + i), pattern));
+  }
+  return vaddvq_u32(total) + count_tail(keys, i, size, key);
+}
+
+std::size_t count_less_u32_neon(const void* keys, std::size_t size, std::uint32_t key) {
+  const uint32x4_t pattern = vdupq_n_u32(key);
+  auto data = static_cast<const std::uint32_t*>(keys);
+  uint32x4_t total = vdupq_n_u32(0);
+  std::size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    total = vsubq_u32(total, vcltq_u32(vld1q_u32(data + i), pattern));
+  }
+  return vaddvq_u32(total) + count_tail(keys, i, size, key);
+}
+
+std::size_t count_less_i64_neon(const void* keys, std::size_t size, std::int64_t key) {
+  const int64x2_t pattern = vdupq_n_s64(key);
+  auto data = static_cast<const std::int64_t*>(keys);
+  uint64x2_t total = vdupq_n_u64(0);
+  std::size_t i = 0;
+  for (; i + 2 <= size; i += 2) {
+    total = vsubq_u64(total, vcltq_s64(vld1q_s64(data + i), pattern));
+  }
+  return vaddvq_u64(total) + count_tail(keys, i, size, key);
+}
+
+std::size_t count_less_u64_neon(const void* keys, std::size_t size, std::uint64_t key) {
+  const uint64x2_t pattern = vdupq_n_u64(key);
+  auto data = static_cast<const std::uint64_t*>(keys);
+  uint64x2_t total = vdupq_n_u64(0);
+  std::size_t i = 0;
+  for (; i + 2 <= size; i += 2) {
+    total = vsubq_u64(total, vcltq_u64(vld1q_u64(data + i), pattern));
+  }
+  return vaddvq_u64(total) + count_tail(keys, i, size, key);
+}
+
+constexpr Kernels kNeon{SearchIsa::Neon, count_less_i32_neon, count_less_u32_neon,
+                        count_less_i64_neon, count_less_u64_neon};
+
+#endif  // BTREE_SEARCH_NEON
+
+const Kernels* kernels_for(SearchIsa isa) {
+  switch (isa) {
+#if defined(BTREE_SEARCH_X86)
+    case SearchIsa::Avx2:
+      return __builtin_cpu_supports("avx2") ? &kAvx2 : nullptr;
+    case SearchIsa::Avx512:
+      return __builtin_cpu_supports("avx512f") ? &kAvx512 : nullptr;
+#endif
+#if defined(BTREE_SEARCH_NEON)
+    case SearchIsa::Neon:
+      return &kNeon;
+#endif
+    case SearchIsa::Portable:
+      return &kPortable;
+    default:
+      return nullptr;
+  }
+}
+
+const Kernels* detect_kernels() {
+  for (SearchIsa isa : {SearchIsa::Avx512, SearchIsa::Avx2, SearchIsa::Neon}) {
+    if (const Kernels* found = kernels_for(isa)) {
+      return found;
+    }
+  }
+  return &kPortable;
+}
+
+// Constant-initialized, so maps built during static initialization of
+// other translation units can search too.
+constinit std::atomic<const Kernels*> active_kernels{nullptr};
+
+const Kernels& kernels() {
+  const Kernels* current = active_kernels.load(std::memory_order_relaxed);
+  if (current == nullptr) {
+    current = detect_kernels();
+    active_kernels.store(current, std::memory_order_relaxed);
+  }
+  return *current;
+}
+
+template <typename T>
+std::size_t dispatch(const T* keys, std::size_t size, T key) {
+  static_assert(sizeof(T) == 4 || sizeof(T) == 8);
+  const Kernels& active = kernels();
+  if constexpr (sizeof(T) == 4 && std::is_signed_v<T>) {
+    return active.less_i32(keys, size, static_cast<std::int32_t>(key));
+  } else if constexpr (sizeof(T) == 4) {
+    return active.less_u32(keys, size, static_cast<std::uint32_t>(key));
+  } else if constexpr (std::is_signed_v<T>) {
+    return active.less_i64(keys, size, static_cast<std::int64_t>(key));
+  } else {
+    return active.less_u64(keys, size, static_cast<std::uint64_t>(key));
+  }
+}
+
+}  // namespace
+
+bool select_search_isa(SearchIsa isa) {
+  const Kernels* requested = kernels_for(isa);
+  if (requested == nullptr) {
+    return false;
+  }
+  active_kernels.store(requested, std::memory_order_relaxed);
+  return true;
+}
+
+SearchIsa active_search_isa() { return kernels().isa; }
+
+std::size_t count_less(const int* keys, std::size_t size, int key) noexcept {
+  return dispatch(keys, size, key);
+}
+
+std::size_t count_less(const unsigned* keys, std::size_t size, unsigned key) noexcept {
+  return dispatch(keys, size, key);
+}
+
+std::size_t count_less(const long* keys, std::size_t size, long key) noexcept {
+  return dispatch(keys, size, key);
+}
+
+std::size_t count_less(const unsigned long* keys, std::size_t size, unsigned long key) noexcept {
+  return dispatch(keys, size, key);
+}
+
+std::size_t count_less(const long long* keys, std::size_t size, long long key) noexcept {
+  return dispatch(keys, size, key);
+}
+
+std::size_t count_less(const unsigned long long* keys, std::size_t size,
+                       unsigned long long key) noexcept {
+  return dispatch(keys, size, key);
+}
+
+}  // namespace btreemap_detail
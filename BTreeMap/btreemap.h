@@ -0,0 +1,1099 @@
+#pragma once
+
+// Ordered map as a B+-tree with wide, cache-aligned nodes.
+//
+// All elements live in the leaves, which form a doubly linked list in key
+// order, so iteration and range scans walk arrays instead of chasing a
+// pointer per element. Inner nodes hold only separator keys and child
+// pointers: every key in child i is at most keys[i] and every key in child
+// i + 1 is greater. A node holds up to four cache lines of keys (between 8
+// and 64 of them) and every node but the root and the last leaf stays at
+// least half full, so 10^8 64-bit keys are six levels deep, against 27
+// for a red-black tree.
+//
+// Leaves keep keys and mapped values in separate arrays, so descending
+// reads nothing but keys. For integer keys under std::less the position in
+// a node is found by counting the keys below the one looked up with SIMD
+// compares over the whole node; that costs no unpredictable branches, and
+// disappears behind the one cache miss a level costs on a large tree. Other
+// keys and comparators use binary search.
+//
+// Because keys and values are stored apart, dereferencing an iterator
+// yields std::pair<const K&, V&> by value, as std::flat_map does; structured
+// bindings and it->second work as with std::map. Insertion and erasure
+// invalidate all iterators.
+//
+// from_sorted() builds the tree bottom-up from sorted input in O(n), with
+// every node filled evenly; the range constructor sorts its input and does
+// the same.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace btreemap_detail {
+
+// Instruction sets of the key search kernels; one is picked at first use
+// from the CPU features. select_search_isa switches to another one for
+// benchmarks and returns false if this CPU or build does not have it.
+enum class SearchIsa { Portable, Avx2, Avx512, Neon };
+
+bool select_search_isa(SearchIsa isa);
+SearchIsa active_search_isa();
+
+// Number of keys[0, size) less than key: its lower bound in a sorted node.
+std::size_t count_less(const int* keys, std::size_t size, int key) noexcept;
+std::size_t count_less(const unsigned* keys, std::size_t size, unsigned key) noexcept;
+std::size_t count_less(const long* keys, std::size_t size, long key) noexcept;
+std::size_t count_less(const unsigned long* keys, std::size_t size, unsigned long key) noexcept;
+std::size_t count_less(const long long* keys, std::size_t size, long long key) noexcept;
+std::size_t count_less(const unsigned long long* keys, std::size_t size,
+                       unsigned long long key) noexcept;
+
+template <typename K, typename Compare>
+concept SimdSearchable =
+    (std::same_as<Compare, std::less<K>> || std::same_as<Compare, std::less<>>) &&
+    requires(const K* keys, std::size_t size, K key) {
+      { count_less(keys, size, key) } -> std::same_as<std::size_t>;
+    };
+
+inline constexpr std::size_t kCacheLine = 64;
+inline constexpr std::size_t kNodeKeyBytes = 4 * kCacheLine;
+
+template <typename K>
+inline constexpr std::size_t kSlots =
+    std::clamp<std::size_t>(kNodeKeyBytes / sizeof(K), 8, 64);
+
+// Storage for N objects of type T that the node constructs and destroys.
+template <typename T, std::size_t N>
+class RawArray {
+ public:
+  T* data() noexcept { return std::launder(reinterpret_cast<T*>(storage_)); }
+  const T* data() const noexcept { return std::launder(reinterpret_cast<const T*>(storage_)); }
+  T& operator[](std::size_t i) noexcept { return data()[i]; }
+  const T& operator[](std::size_t i) const noexcept { return data()[i]; }
+
+ private:
+  alignas(T) std::byte storage_[N * sizeof(T)];
+};
+
+// Keys come first so that they start on a cache line.
+template <typename K, typename V>
+struct alignas(kCacheLine) Leaf {
+  RawArray<K, kSlots<K>> keys;
+  RawArray<V, kSlots<K>> values;
+  Leaf* prev = nullptr;
+  Leaf* next = nullptr;
+  std::uint32_t size = 0;
+};
+
+// Children are leaves at the lowest inner level and inner nodes above; the
+// map knows which from the depth.
+template <typename K>
+struct alignas(kCacheLine) Inner {
+  RawArray<K, kSlots<K>> keys;
+  void* children[kSlots<K> + 1];
+  std::uint32_t size = 0;  // keys; there is one child more
+};
+
+// Moves [pos, size) one slot right; pos is left without an object.
+template <typename T>
+void open_gap(T* data, std::size_t pos, std::size_t size) {
+  if constexpr (std::is_trivially_copyable_v<T>) {
+    std::memmove(static_cast<void*>(data + pos + 1), data + pos, (size - pos) * sizeof(T));
+  } else if (pos < size) {
+    std::construct_at(data + size, std::move(data[size - 1]));
+    std::move_backward(data + pos, data + size - 1, data + size);
+    std::destroy_at(data + pos);
+  }
+}
+
+// Destroys data[pos] and moves (pos, size) one slot left.
+template <typename T>
+void close_gap(T* data, std::size_t pos, std::size_t size) {
+  if constexpr (std::is_trivially_copyable_v<T>) {
+    std::memmove(static_cast<void*>(data + pos), data + pos + 1, (size - pos - 1) * sizeof(T));
+  } else {
+    std::move(data + pos + 1, data + size, data + pos);
+    std::destroy_at(data + size - 1);
+  }
+}
+
+// Moves count objects into uninitialized storage and destroys the sources.
+template <typename T>
+void relocate(T* from, std::size_t count, T* to) {
+  if constexpr (std::is_trivially_copyable_v<T>) {
+    std::memcpy(static_cast<void*>(to), from, count * sizeof(T));
+  } else {
+    for (std::size_t i = 0; i < count; ++i) {
+      std::construct_at(to + i, std::move(from[i]));
+      std::destroy_at(from + i);
+    }
+  }
+}
+
+}  // namespace btreemap_detail
+
+template <typename K, typename V, typename Compare = std::less<K>,
+          typename Allocator = std::allocator<std::pair<const K, V>>>
+class BTreeMap {
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<K, V>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+  using reference = std::pair<const K&, V&>;
+  using const_reference = std::pair<const K&, const V&>;
+
+ private:
+  using Leaf = btreemap_detail::Leaf<K, V>;
+  using Inner = btreemap_detail::Inner<K>;
+
+  static constexpr std::size_t kSlots = btreemap_detail::kSlots<K>;
+  static constexpr std::size_t kMinSize = kSlots / 2;
+  // Inner nodes below the root have more than kSlots / 2 >= 4 children, so
+  // a size_type never counts enough elements for more levels.
+  static constexpr std::size_t kMaxHeight = 32;
+  static constexpr bool kSimdSearch = btreemap_detail::SimdSearchable<K, Compare>;
+
+  using AllocTraits = std::allocator_traits<Allocator>;
+  using LeafAllocator = typename AllocTraits::template rebind_alloc<Leaf>;
+  using LeafTraits = std::allocator_traits<LeafAllocator>;
+  using InnerAllocator = typename AllocTraits::template rebind_alloc<Inner>;
+  using InnerTraits = std::allocator_traits<InnerAllocator>;
+
+  // The child taken at one inner node on the way down.
+  struct Step {
+    Inner* node;
+    std::size_t index;
+  };
+
+  template <bool IsConst>
+  class Iterator {
+   public:
+    using iterator_concept = std::bidirectional_iterator_tag;
+    using iterator_category = std::input_iterator_tag;  // references are proxies
+    using value_type = BTreeMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::conditional_t<IsConst, BTreeMap::const_reference, BTreeMap::reference>;
+
+    // Keeps the pair that operator-> points into alive.
+    class pointer {
+     public:
+      reference* operator->() noexcept { return &ref_; }
+
+     private:
+      friend class Iterator;
+      explicit pointer(reference ref) : ref_(ref) {}
+      reference ref_;
+    };
+
+    Iterator() = default;
+    operator Iterator<true>() const {  // NOLINT(google-explicit-constructor)
+      return Iterator<true>(leaf_, pos_);
+    }
+
+    reference operator*() const { return reference(leaf_->keys[pos_], leaf_->values[pos_]); }
+    pointer operator->() const { return pointer(**this); }
+
+    Iterator& operator++() {
+      if (++pos_ == leaf_->size && leaf_->next != nullptr) {
+        leaf_ = leaf_->next;
+        pos_ = 0;
+      }
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator old = *this;
+      ++*this;
+      return old;
+    }
+    Iterator& operator--() {
+      if (pos_ == 0) {
+        leaf_ = leaf_->prev;
+        pos_ = leaf_->size;
+      }
+      --pos_;
+      return *this;
+    }
+    Iterator operator--(int) {
+      Iterator old = *this;
+      --*this;
+      return old;
+    }
+
+    friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
+      return lhs.leaf_ == rhs.leaf_ && lhs.pos_ == rhs.pos_;
+    }
+
+   private:
+    friend class BTreeMap;
+    friend class Iterator<!IsConst>;
+
+    Iterator(Leaf* leaf, std::size_t pos) : leaf_(leaf), pos_(pos) {}
+
+    // The end of a leaf other than the last is the start of the next one.
+    static Iterator normalized(Leaf* leaf, std::size_t pos) {
+      if (pos == leaf->size && leaf->next != nullptr) {
+        return Iterator(leaf->next, 0);
+      }
+      return Iterator(leaf, pos);
+    }
+
+    Leaf* leaf_ = nullptr;
+    std::size_t pos_ = 0;
+  };
+
+ public:
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  BTreeMap() = default;
+  explicit BTreeMap(const Compare& comp, const Allocator& alloc = Allocator())
+      : comp_(comp), alloc_(alloc) {}
+  explicit BTreeMap(const Allocator& alloc) : alloc_(alloc) {}
+
+  // Any order; of equal keys the first one is kept, as insert() would.
+  template <std::input_iterator InputIt>
+  BTreeMap(InputIt first, InputIt last, const Compare& comp = Compare(),
+           const Allocator& alloc = Allocator())
+      : comp_(comp), alloc_(alloc) {
+    std::vector<value_type> values(first, last);
+    auto by_key = [this](const value_type& lhs, const value_type& rhs) {
+      return comp_(lhs.first, rhs.first);
+    };
+    std::stable_sort(values.begin(), values.end(), by_key);
+    auto equal_keys = [this](const value_type& lhs, const value_type& rhs) {
+      return !comp_(lhs.first, rhs.first);
+    };
+    values.erase(std::unique(values.begin(), values.end(), equal_keys), values.end());
+    build_from(values.size(), std::make_move_iterator(values.begin()));
+  }
+
+  BTreeMap(std::initializer_list<value_type> values, const Compare& comp = Compare(),
+           const Allocator& alloc = Allocator())
+      : BTreeMap(values.begin(), values.end(), comp, alloc) {}
+
+  // Builds the map from [first, last), which must be sorted by key with no
+  // key repeated, in O(n). Throws std::invalid_argument otherwise.
+  template <std::forward_iterator ForwardIt>
+  static BTreeMap from_sorted(ForwardIt first, ForwardIt last, const Compare& comp = Compare(),
+                              const Allocator& alloc = Allocator()) {
+    BTreeMap map(comp, alloc);
+    auto not_increasing = [&map](const auto& lhs, const auto& rhs) {
+      return !map.comp_(lhs.first, rhs.first);
+    };
+    if (std::adjacent_find(first, last, not_increasing) != last) {
+      throw std::invalid_argument("BTreeMap::from_sorted: keys are not strictly increasing");
+    }
+    map.build_from(static_cast<size_type>(std::distance(first, last)), first);
+    return map;
+  }
+
+  BTreeMap(const BTreeMap& other)
+      : BTreeMap(other, AllocTraits::select_on_container_copy_construction(other.alloc_)) {}
+
+  BTreeMap(const BTreeMap& other, const Allocator& alloc) : comp_(other.comp_), alloc_(alloc) {
+    build_from(other.size_, other.begin());
+  }
+
+  BTreeMap(BTreeMap&& other) noexcept
+      : comp_(std::move(other.comp_)), alloc_(std::move(other.alloc_)) {
+    steal(other);
+  }
+
+  BTreeMap(BTreeMap&& other, const Allocator& alloc) : comp_(other.comp_), alloc_(alloc) {
+    if (alloc_ == other.alloc_) {
+      steal(other);
+    } else {
+      move_elements_from(other);
+    }
+  }
+
+  ~BTreeMap() { clear(); }
+
+  BTreeMap& operator=(const BTreeMap& other) {
+    if (this != &other) {
+      BTreeMap copy(other, AllocTraits::propagate_on_container_copy_assignment::value
+                               ? other.alloc_
+                               : alloc_);
+      clear();
+      comp_ = other.comp_;
+      if constexpr (AllocTraits::propagate_on_container_copy_assignment::value) {
+        alloc_ = other.alloc_;
+      }
+      steal(copy);
+    }
+    return *this;
+  }
+
+  BTreeMap& operator=(BTreeMap&& other) noexcept(
+      AllocTraits::propagate_on_container_move_assignment::value ||
+      AllocTraits::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
+    }
+    clear();
+    comp_ = std::move(other.comp_);
+    if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+      alloc_ = std::move(other.alloc_);
+      steal(other);
+    } else if (alloc_ == other.alloc_) {
+      steal(other);
+    } else {
+      move_elements_from(other);
+    }
+    return *this;
+  }
+
+  BTreeMap& operator=(std::initializer_list<value_type> values) {
+    *this = BTreeMap(values, comp_, alloc_);
+    return *this;
+  }
+
+  allocator_type get_allocator() const { return alloc_; }
+  key_compare key_comp() const { return comp_; }
+
+  iterator begin() { return iterator(head_, 0); }
+  iterator end() { return iterator(tail_, tail_ == nullptr ? 0 : tail_->size); }
+  const_iterator begin() const { return const_cast<BTreeMap*>(this)->begin(); }
+  const_iterator end() const { return const_cast<BTreeMap*>(this)->end(); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+  const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+  bool empty() const { return size_ == 0; }
+  size_type size() const { return size_; }
+  // Levels of inner nodes above the leaves.
+  size_type height() const { return height_; }
+
+  void clear() noexcept {
+    if (root_ != nullptr) {
+      destroy_subtree(root_, height_);
+    }
+    root_ = nullptr;
+    head_ = tail_ = nullptr;
+    height_ = 0;
+    size_ = 0;
+  }
+
+  // Lookup. With a transparent comparator every key type it accepts works;
+  // only K itself takes the SIMD search.
+
+  iterator find(const K& key) { return find_impl(key); }
+  const_iterator find(const K& key) const { return const_cast<BTreeMap*>(this)->find_impl(key); }
+  bool contains(const K& key) const { return find(key) != end(); }
+  size_type count(const K& key) const { return contains(key) ? 1 : 0; }
+
+  iterator lower_bound(const K& key) { return lower_bound_impl(key); }
+  const_iterator lower_bound(const K& key) const {
+    return const_cast<BTreeMap*>(this)->lower_bound_impl(key);
+  }
+  iterator upper_bound(const K& key) { return upper_bound_impl(key); }
+  const_iterator upper_bound(const K& key) const {
+    return const_cast<BTreeMap*>(this)->upper_bound_impl(key);
+  }
+  std::pair<iterator, iterator> equal_range(const K& key) {
+    iterator first = lower_bound(key);
+    iterator last = first;
+    if (last != end() && !comp_(key, last.leaf_->keys[last.pos_])) {
+      ++last;
+    }
+    return {first, last};
+  }
+  std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+    return const_cast<BTreeMap*>(this)->equal_range(key);
+  }
+
+  template <typename Q>
+    requires requires { typename Compare::is_transparent; }
+  iterator find(const Q& key) {
+    return find_impl(key);
+  }
+  template <typename Q>
+    requires requires { typename Compare::is_transparent; }
+  const_iterator find(const Q& key) const {
+    return const_cast<BTreeMap*>(this)->find_impl(key);
+  }
+  template <typename Q>
+    requires requires { typename Compare::is_transparent; }
+  bool contains(const Q& key) const {
+    return find(key) != end();
+  }
+  template <typename Q>
+    requires requires { typename Compare::is_transparent; }
+  size_type count(const Q& key) const {
+    return contains(key) ? 1 : 0;
+  }
+  template <typename Q>
+    requires requires { typename Compare::is_transparent; }
+  iterator lower_bound(const Q& key) {
+    return lower_bound_impl(key);
+  }
+  template <typename Q>
+    requires requires { typename Compare::is_transparent; }
+  const_iterator lower_bound(const Q& key) const {
+    return const_cast<BTreeMap*>(this)->lower_bound_impl(key);
+  }
+  template <typename Q>
+    requires requires { typename Compare::is_transparent; }
+  iterator upper_bound(const Q& key) {
+    return upper_bound_impl(key);
+  }
+  template <typename Q>
+    requires requires { typename Compare::is_transparent; }
+  const_iterator upper_bound(const Q& key) const {
+    return const_cast<BTreeMap*>(this)->upper_bound_impl(key);
+  }
+
+  V& at(const K& key) {
+    iterator it = find(key);
+    if (it == end()) {
+      throw std::out_of_range("BTreeMap::at: key not found");
+    }
+    return it.leaf_->values[it.pos_];
+  }
+  const V& at(const K& key) const { return const_cast<BTreeMap*>(this)->at(key); }
+
+  V& operator[](const K& key) { return try_emplace(key).first->second; }
+  V& operator[](K&& key) { return try_emplace(std::move(key)).first->second; }
+
+  // Insertion. The key is looked up before anything is constructed, and a
+  // new element goes in with moves only once its node has room: a full leaf
+  // and the full inner nodes above it are split after all new nodes are
+  // allocated, so an exception leaves the map unchanged.
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const K& key, Args&&... args) {
+    return emplace_unique(key, std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+    return emplace_unique(std::move(key), std::forward<Args>(args)...);
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(const K& key, M&& value) {
+    auto result = try_emplace(key, std::forward<M>(value));
+    if (!result.second) {
+      result.first->second = std::forward<M>(value);
+    }
+    return result;
+  }
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(K&& key, M&& value) {
+    auto result = try_emplace(std::move(key), std::forward<M>(value));
+    if (!result.second) {
+      result.first->second = std::forward<M>(value);
+    }
+    return result;
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    value_type value(std::forward<Args>(args)...);
+    return emplace_unique(std::move(value.first), std::move(value.second));
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    return emplace_unique(value.first, value.second);
+  }
+  std::pair<iterator, bool> insert(value_type&& value) {
+    return emplace_unique(std::move(value.first), std::move(value.second));
+  }
+
+  template <std::input_iterator InputIt>
+  void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+      const auto& [key, value] = *first;
+      try_emplace(key, value);
+    }
+  }
+  void insert(std::initializer_list<value_type> values) { insert(values.begin(), values.end()); }
+
+  // Erasure. A leaf or inner node that drops below half full takes an
+  // element from a sibling, or merges with it when both fit in one node.
+
+  iterator erase(const_iterator pos) {
+    Step path[kMaxHeight];
+    Leaf* leaf = descend(pos.leaf_->keys[pos.pos_], path);
+    return erase_at(path, leaf, pos.pos_);
+  }
+  iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    if (first == begin() && last == end()) {
+      clear();
+      return end();
+    }
+    for (size_type n = static_cast<size_type>(std::distance(first, last)); n > 0; --n) {
+      first = erase(first);
+    }
+    return iterator(first.leaf_, first.pos_);
+  }
+
+  size_type erase(const K& key) {
+    if (root_ == nullptr) {
+      return 0;
+    }
+    Step path[kMaxHeight];
+    Leaf* leaf = descend(key, path);
+    const std::size_t pos = search(leaf->keys.data(), leaf->size, key);
+    if (pos == leaf->size || comp_(key, leaf->keys[pos])) {
+      return 0;
+    }
+    erase_at(path, leaf, pos);
+    return 1;
+  }
+
+  void swap(BTreeMap& other) noexcept {
+    using std::swap;
+    swap(comp_, other.comp_);
+    if constexpr (AllocTraits::propagate_on_container_swap::value) {
+      swap(alloc_, other.alloc_);
+    }
+    swap(root_, other.root_);
+    swap(head_, other.head_);
+    swap(tail_, other.tail_);
+    swap(height_, other.height_);
+    swap(size_, other.size_);
+  }
+
+  friend void swap(BTreeMap& lhs, BTreeMap& rhs) noexcept { lhs.swap(rhs); }
+
+  friend bool operator==(const BTreeMap& lhs, const BTreeMap& rhs) {
+    if (lhs.size_ != rhs.size_) {
+      return false;
+    }
+    for (auto l = lhs.begin(), r = rhs.begin(); l != lhs.end(); ++l, ++r) {
+      if (!(l->first == r->first) || !(l->second == r->second)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  // Owns the nodes an insertion may need until it takes them.
+  class Reserve {
+   public:
+    explicit Reserve(BTreeMap& map) : map_(map) {}
+    Reserve(const Reserve&) = delete;
+    Reserve& operator=(const Reserve&) = delete;
+    ~Reserve() {
+      if (leaf_ != nullptr) {
+        map_.destroy_leaf(leaf_);
+      }
+      while (taken_ < count_) {
+        map_.destroy_inner(inners_[taken_++]);
+      }
+    }
+
+    void add_leaf() { leaf_ = map_.new_leaf(); }
+    void add_inner() { inners_[count_++] = map_.new_inner(); }
+    Leaf* take_leaf() noexcept { return std::exchange(leaf_, nullptr); }
+    Inner* take_inner() noexcept { return inners_[taken_++]; }
+
+   private:
+    BTreeMap& map_;
+    Leaf* leaf_ = nullptr;
+    Inner* inners_[kMaxHeight + 1];
+    std::size_t count_ = 0;
+    std::size_t taken_ = 0;
+  };
+
+  static Leaf* as_leaf(void* node) noexcept { return static_cast<Leaf*>(node); }
+  static Inner* as_inner(void* node) noexcept { return static_cast<Inner*>(node); }
+
+  template <typename Q>
+  std::size_t search(const K* keys, std::size_t size, const Q& key) const {
+    if constexpr (kSimdSearch && std::is_same_v<Q, K>) {
+      return btreemap_detail::count_less(keys, size, key);
+    } else {
+      return static_cast<std::size_t>(std::lower_bound(keys, keys + size, key, comp_) - keys);
+    }
+  }
+
+  // The leaf whose range covers key; records the path if one is given.
+  // The map must not be empty.
+  template <typename Q>
+  Leaf* descend(const Q& key, Step* path) const {
+    void* node = root_;
+    for (std::size_t depth = 0; depth < height_; ++depth) {
+      Inner* inner = as_inner(node);
+      const std::size_t index = search(inner->keys.data(), inner->size, key);
+      if (path != nullptr) {
+        path[depth] = {inner, index};
+      }
+      node = inner->children[index];
+    }
+    return as_leaf(node);
+  }
+
+  template <typename Q>
+  iterator lower_bound_impl(const Q& key) {
+    if (root_ == nullptr) {
+      return end();
+    }
+    Leaf* leaf = descend(key, nullptr);
+    return iterator::normalized(leaf, search(leaf->keys.data(), leaf->size, key));
+  }
+
+  template <typename Q>
+  iterator upper_bound_impl(const Q& key) {
+    iterator it = lower_bound_impl(key);
+    if (it != end() && !comp_(key, it.leaf_->keys[it.pos_])) {
+      ++it;
+    }
+    return it;
+  }
+
+  template <typename Q>
+  iterator find_impl(const Q& key) {
+    if (root_ == nullptr) {
+      return end();
+    }
+    Leaf* leaf = descend(key, nullptr);
+    const std::size_t pos = search(leaf->keys.data(), leaf->size, key);
+    if (pos == leaf->size || comp_(key, leaf->keys[pos])) {
+      return end();
+    }
+    return iterator(leaf, pos);
+  }
+
+  template <typename KK, typename... Args>
+  std::pair<iterator, bool> emplace_unique(KK&& key, Args&&... args) {
+    if (root_ == nullptr) {
+      K new_key(std::forward<KK>(key));
+      V new_value(std::forward<Args>(args)...);
+      Leaf* leaf = new_leaf();
+      put(leaf, 0, std::move(new_key), std::move(new_value));
+      root_ = head_ = tail_ = leaf;
+      size_ = 1;
+      return {iterator(leaf, 0), true};
+    }
+    Step path[kMaxHeight];
+    Leaf* leaf = descend(key, path);
+    const std::size_t pos = search(leaf->keys.data(), leaf->size, key);
+    if (pos < leaf->size && !comp_(key, leaf->keys[pos])) {
+      return {iterator(leaf, pos), false};
+    }
+    K new_key(std::forward<KK>(key));
+    V new_value(std::forward<Args>(args)...);
+    return {insert_at(path, leaf, pos, std::move(new_key), std::move(new_value)), true};
+  }
+
+  // Constructs the element at pos of a leaf with room for it.
+  static void put(Leaf* leaf, std::size_t pos, K&& key, V&& value) {
+    btreemap_detail::open_gap(leaf->keys.data(), pos, leaf->size);
+    btreemap_detail::open_gap(leaf->values.data(), pos, leaf->size);
+    std::construct_at(leaf->keys.data() + pos, std::move(key));
+    std::construct_at(leaf->values.data() + pos, std::move(value));
+    ++leaf->size;
+  }
+
+  // Inserts key before keys[index] of a node with room, and child after it.
+  static void put_child(Inner* node, std::size_t index, K&& key, void* child) {
+    btreemap_detail::open_gap(node->keys.data(), index, node->size);
+    std::construct_at(node->keys.data() + index, std::move(key));
+    std::memmove(node->children + index + 2, node->children + index + 1,
+                 (node->size - index) * sizeof(void*));
+    node->children[index + 1] = child;
+    ++node->size;
+  }
+
+  iterator insert_at(Step* path, Leaf* leaf, std::size_t pos, K&& key, V&& value) {
+    if (leaf->size < kSlots) {
+      put(leaf, pos, std::move(key), std::move(value));
+      ++size_;
+      return iterator(leaf, pos);
+    }
+
+    std::size_t full = 0;
+    while (full < height_ && path[height_ - 1 - full].node->size == kSlots) {
+      ++full;
+    }
+    Reserve reserve(*this);
+    reserve.add_leaf();
+    for (std::size_t i = 0; i < full + (full == height_ ? 1 : 0); ++i) {
+      reserve.add_inner();
+    }
+    // Appending to the last leaf leaves it full, so ascending insertion
+    // packs the leaves instead of leaving every one half empty.
+    const std::size_t mid = leaf->next == nullptr && pos == kSlots ? kSlots : kSlots / 2;
+    const bool to_right = pos > mid || mid == kSlots;
+    K separator(!to_right && pos == mid ? key : leaf->keys[mid - 1]);
+
+    Leaf* right = reserve.take_leaf();
+    btreemap_detail::relocate(leaf->keys.data() + mid, kSlots - mid, right->keys.data());
+    btreemap_detail::relocate(leaf->values.data() + mid, kSlots - mid, right->values.data());
+    right->size = static_cast<std::uint32_t>(kSlots - mid);
+    leaf->size = static_cast<std::uint32_t>(mid);
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next != nullptr) {
+      leaf->next->prev = right;
+    } else {
+      tail_ = right;
+    }
+    leaf->next = right;
+
+    Leaf* target = to_right ? right : leaf;
+    const std::size_t target_pos = to_right ? pos - mid : pos;
+    put(target, target_pos, std::move(key), std::move(value));
+    ++size_;
+
+    void* child = right;
+    for (std::size_t depth = height_; depth-- > 0;) {
+      Inner* parent = path[depth].node;
+      if (parent->size < kSlots) {
+        put_child(parent, path[depth].index, std::move(separator), child);
+        return iterator(target, target_pos);
+      }
+      Inner* sibling = reserve.take_inner();
+      separator = split_inner(parent, sibling, path[depth].index, std::move(separator), child);
+      child = sibling;
+    }
+    Inner* root = reserve.take_inner();
+    std::construct_at(root->keys.data(), std::move(separator));
+    root->children[0] = root_;
+    root->children[1] = child;
+    root->size = 1;
+    root_ = root;
+    ++height_;
+    return iterator(target, target_pos);
+  }
+
+  // Splits a full node into node and right around its middle key, inserts
+  // key and child where they belong and returns the middle key.
+  static K split_inner(Inner* node, Inner* right, std::size_t index, K&& key, void* child) {
+    constexpr std::size_t mid = kSlots / 2;
+    K middle(std::move(node->keys[mid]));
+    std::destroy_at(node->keys.data() + mid);
+    btreemap_detail::relocate(node->keys.data() + mid + 1, kSlots - mid - 1, right->keys.data());
+    std::copy(node->children + mid + 1, node->children + kSlots + 1, right->children);
+    right->size = static_cast<std::uint32_t>(kSlots - mid - 1);
+    node->size = static_cast<std::uint32_t>(mid);
+    if (index <= mid) {
+      put_child(node, index, std::move(key), child);
+    } else {
+      put_child(right, index - mid - 1, std::move(key), child);
+    }
+    return middle;
+  }
+
+  iterator erase_at(Step* path, Leaf* leaf, std::size_t pos) {
+    btreemap_detail::close_gap(leaf->keys.data(), pos, leaf->size);
+    btreemap_detail::close_gap(leaf->values.data(), pos, leaf->size);
+    --leaf->size;
+    --size_;
+    if (height_ == 0) {
+      if (leaf->size == 0) {
+        clear();
+        return end();
+      }
+      return iterator(leaf, pos);
+    }
+    if (leaf->size < kMinSize) {
+      rebalance_leaf(path[height_ - 1], leaf, pos);
+      for (std::size_t depth = height_ - 1; depth > 0; --depth) {
+        if (path[depth].node->size >= kMinSize) {
+          break;
+        }
+        rebalance_inner(path[depth - 1], path[depth].node);
+      }
+      Inner* root = as_inner(root_);
+      if (root->size == 0) {
+        root_ = root->children[0];
+        --height_;
+        destroy_inner(root);
+      }
+    }
+    return iterator::normalized(leaf, pos);
+  }
+
+  // Refills leaf, the child parent.index of parent.node, from a sibling.
+  // leaf and pos follow the position of the element after the erased one.
+  void rebalance_leaf(Step parent, Leaf*& leaf, std::size_t& pos) {
+    Inner* node = parent.node;
+    const std::size_t index = parent.index;
+    if (index > 0) {
+      Leaf* left = as_leaf(node->children[index - 1]);
+      if (left->size + leaf->size <= kSlots) {
+        pos += left->size;
+        merge_leaves(left, leaf);
+        remove_child(node, index - 1);
+        leaf = left;
+      } else {
+        btreemap_detail::open_gap(leaf->keys.data(), 0, leaf->size);
+        btreemap_detail::open_gap(leaf->values.data(), 0, leaf->size);
+        btreemap_detail::relocate(left->keys.data() + left->size - 1, 1, leaf->keys.data());
+        btreemap_detail::relocate(left->values.data() + left->size - 1, 1, leaf->values.data());
+        --left->size;
+        ++leaf->size;
+        ++pos;
+        node->keys[index - 1] = left->keys[left->size - 1];
+      }
+    } else {
+      Leaf* right = as_leaf(node->children[index + 1]);
+      if (leaf->size + right->size <= kSlots) {
+        merge_leaves(leaf, right);
+        remove_child(node, index);
+      } else {
+        std::construct_at(leaf->keys.data() + leaf->size, std::move(right->keys[0]));
+        std::construct_at(leaf->values.data() + leaf->size, std::move(right->values[0]));
+        btreemap_detail::close_gap(right->keys.data(), 0, right->size);
+        btreemap_detail::close_gap(right->values.data(), 0, right->size);
+        --right->size;
+        ++leaf->size;
+        node->keys[index] = leaf->keys[leaf->size - 1];
+      }
+    }
+  }
+
+  // Refills child, the child parent.index of parent.node, from a sibling,
+  // rotating keys through the parent.
+  void rebalance_inner(Step parent, Inner* child) {
+    Inner* node = parent.node;
+    const std::size_t index = parent.index;
+    if (index > 0) {
+      Inner* left = as_inner(node->children[index - 1]);
+      if (left->size + 1 + child->size <= kSlots) {
+        std::construct_at(left->keys.data() + left->size, std::move(node->keys[index - 1]));
+        btreemap_detail::relocate(child->keys.data(), child->size,
+                                  left->keys.data() + left->size + 1);
+        std::copy(child->children, child->children + child->size + 1,
+                  left->children + left->size + 1);
+        left->size += 1 + child->size;
+        child->size = 0;
+        destroy_inner(child);
+        remove_child(node, index - 1);
+      } else {
+        btreemap_detail::open_gap(child->keys.data(), 0, child->size);
+        std::construct_at(child->keys.data(), std::move(node->keys[index - 1]));
+        std::memmove(child->children + 1, child->children, (child->size + 1) * sizeof(void*));
+        child->children[0] = left->children[left->size];
+        ++child->size;
+        node->keys[index - 1] = std::move(left->keys[left->size - 1]);
+        std::destroy_at(left->keys.data() + left->size - 1);
+        --left->size;
+      }
+    } else {
+      Inner* right = as_inner(node->children[index + 1]);
+      if (child->size + 1 + right->size <= kSlots) {
+        std::construct_at(child->keys.data() + child->size, std::move(node->keys[index]));
+        btreemap_detail::relocate(right->keys.data(), right->size,
+                                  child->keys.data() + child->size + 1);
+        std::copy(right->children, right->children + right->size + 1,
+                  child->children + child->size + 1);
+        child->size += 1 + right->size;
+        right->size = 0;
+        destroy_inner(right);
+        remove_child(node, index);
+      } else {
+        std::construct_at(child->keys.data() + child->size, std::move(node->keys[index]));
+        child->children[child->size + 1] = right->children[0];
+        ++child->size;
+        node->keys[index] = std::move(right->keys[0]);
+        btreemap_detail::close_gap(right->keys.data(), 0, right->size);
+        std::memmove(right->children, right->children + 1, right->size * sizeof(void*));
+        --right->size;
+      }
+    }
+  }
+
+  // Appends right to left and frees it.
+  void merge_leaves(Leaf* left, Leaf* right) {
+    btreemap_detail::relocate(right->keys.data(), right->size, left->keys.data() + left->size);
+    btreemap_detail::relocate(right->values.data(), right->size,
+                              left->values.data() + left->size);
+    left->size += right->size;
+    right->size = 0;
+    left->next = right->next;
+    if (right->next != nullptr) {
+      right->next->prev = left;
+    } else {
+      tail_ = left;
+    }
+    destroy_leaf(right);
+  }
+
+  // Removes keys[index] and the child after it.
+  static void remove_child(Inner* node, std::size_t index) {
+    btreemap_detail::close_gap(node->keys.data(), index, node->size);
+    std::memmove(node->children + index + 1, node->children + index + 2,
+                 (node->size - index - 1) * sizeof(void*));
+    --node->size;
+  }
+
+  // Builds the tree of an empty map bottom-up from count sorted elements,
+  // each constructed by emit(key, value) into the given slots: leaves filled
+  // evenly, then each level of inner nodes over the previous one, all at
+  // least half full.
+  template <typename Emit>
+  void build(size_type count, Emit emit) {
+    if (count == 0) {
+      return;
+    }
+    const size_type leaves = (count + kSlots - 1) / kSlots;
+    std::vector<void*> level;
+    std::vector<const K*> maxima;  // largest key under each node of level
+    std::vector<Inner*> inners;
+    try {
+      level.reserve(leaves);
+      maxima.reserve(leaves);
+      inners.reserve(leaves);
+      for (size_type i = 0; i < leaves; ++i) {
+        Leaf* leaf = new_leaf();
+        leaf->prev = tail_;
+        (tail_ != nullptr ? tail_->next : head_) = leaf;
+        tail_ = leaf;
+        const size_type fill = count / leaves + (i < count % leaves ? 1 : 0);
+        for (; leaf->size < fill; ++leaf->size) {
+          emit(leaf->keys.data() + leaf->size, leaf->values.data() + leaf->size);
+        }
+        level.push_back(leaf);
+        maxima.push_back(leaf->keys.data() + fill - 1);
+      }
+      while (level.size() > 1) {
+        const size_type parents = (level.size() + kSlots) / (kSlots + 1);
+        std::vector<void*> next_level;
+        std::vector<const K*> next_maxima;
+        next_level.reserve(parents);
+        next_maxima.reserve(parents);
+        size_type child = 0;
+        for (size_type i = 0; i < parents; ++i) {
+          const size_type fanout = level.size() / parents + (i < level.size() % parents ? 1 : 0);
+          Inner* inner = new_inner();
+          inners.push_back(inner);
+          inner->children[0] = level[child];
+          for (size_type k = 1; k < fanout; ++k) {
+            std::construct_at(inner->keys.data() + k - 1, *maxima[child + k - 1]);
+            ++inner->size;
+            inner->children[k] = level[child + k];
+          }
+          next_level.push_back(inner);
+          next_maxima.push_back(maxima[child + fanout - 1]);
+          child += fanout;
+        }
+        level.swap(next_level);
+        maxima.swap(next_maxima);
+        ++height_;
+      }
+    } catch (...) {
+      for (Inner* inner : inners) {
+        destroy_inner(inner);
+      }
+      while (head_ != nullptr) {
+        destroy_leaf(std::exchange(head_, head_->next));
+      }
+      tail_ = nullptr;
+      height_ = 0;
+      throw;
+    }
+    root_ = level.front();
+    size_ = count;
+  }
+
+  // Elements from a sorted range whose iterators yield key-value pairs.
+  template <typename It>
+  void build_from(size_type count, It first) {
+    build(count, [&first](K* key, V* value) {
+      auto&& entry = *first;
+      construct_entry(key, value, std::forward<decltype(entry)>(entry).first,
+                      std::forward<decltype(entry)>(entry).second);
+      ++first;
+    });
+  }
+
+  void move_elements_from(BTreeMap& other) {
+    build(other.size_, [it = other.begin()](K* key, V* value) mutable {
+      construct_entry(key, value, std::move(it.leaf_->keys[it.pos_]),
+                      std::move(it.leaf_->values[it.pos_]));
+      ++it;
+    });
+    other.clear();
+  }
+
+  // Both or, if constructing one of them throws, neither.
+  template <typename KK, typename VV>
+  static void construct_entry(K* key, V* value, KK&& new_key, VV&& new_value) {
+    std::construct_at(key, std::forward<KK>(new_key));
+    try {
+      std::construct_at(value, std::forward<VV>(new_value));
+    } catch (...) {
+      std::destroy_at(key);
+      throw;
+    }
+  }
+
+  void steal(BTreeMap& other) noexcept {
+    root_ = std::exchange(other.root_, nullptr);
+    head_ = std::exchange(other.head_, nullptr);
+    tail_ = std::exchange(other.tail_, nullptr);
+    height_ = std::exchange(other.height_, 0);
+    size_ = std::exchange(other.size_, 0);
+  }
+
+  Leaf* new_leaf() {
+    LeafAllocator alloc(alloc_);
+    return std::construct_at(LeafTraits::allocate(alloc, 1));
+  }
+
+  Inner* new_inner() {
+    InnerAllocator alloc(alloc_);
+    return std::construct_at(InnerTraits::allocate(alloc, 1));
+  }
+
+  void destroy_leaf(Leaf* leaf) noexcept {
+    std::destroy_n(leaf->keys.data(), leaf->size);
+    std::destroy_n(leaf->values.data(), leaf->size);
+    LeafAllocator alloc(alloc_);
+    LeafTraits::deallocate(alloc, leaf, 1);
+  }
+
+  // Destroys the node but not its children.
+  void destroy_inner(Inner* inner) noexcept {
+    std::destroy_n(inner->keys.data(), inner->size);
+    InnerAllocator alloc(alloc_);
+    InnerTraits::deallocate(alloc, inner, 1);
+  }
+
+  void destroy_subtree(void* node, std::size_t height) noexcept {
+    if (height == 0) {
+      destroy_leaf(as_leaf(node));
+      return;
+    }
+    Inner* inner = as_inner(node);
+    for (std::size_t i = 0; i <= inner->size; ++i) {
+      destroy_subtree(inner->children[i], height - 1);
+    }
+    destroy_inner(inner);
+  }
+
+  void* root_ = nullptr;
+  Leaf* head_ = nullptr;
+  Leaf* tail_ = nullptr;
+  size_type height_ = 0;
+  size_type size_ = 0;
+  [[no_unique_address]] Compare comp_;
+  [[no_unique_address]] Allocator alloc_;
+};
@@ -0,0 +1,479 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "BTreeMap/btreemap.h"
+
+namespace {
+
+using btreemap_detail::SearchIsa;
+
+struct Counted {
+  static inline int alive = 0;
+  int value = 0;
+  Counted(int v = 0) : value(v) { ++alive; }  // NOLINT(google-explicit-constructor)
+  Counted(const Counted& other) : value(other.value) { ++alive; }
+  Counted(Counted&& other) noexcept : value(other.value) { ++alive; }
+  Counted& operator=(const Counted&) = default;
+  Counted& operator=(Counted&&) noexcept = default;
+  ~Counted() { --alive; }
+  bool operator==(const Counted& other) const { return value == other.value; }
+};
+
+// Throws from its constructor on request, to fail an insertion midway.
+struct Fragile {
+  static inline bool fail = false;
+  int value = 0;
+  Fragile(int v = 0) : value(v) {  // NOLINT(google-explicit-constructor)
+    if (fail) {
+      throw std::runtime_error("Fragile");
+    }
+  }
+};
+
+// Counts the bytes it has handed out and not taken back.
+template <typename T>
+struct CountingAllocator {
+  using value_type = T;
+
+  explicit CountingAllocator(std::ptrdiff_t* live) : live(live) {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>& other)  // NOLINT(google-explicit-constructor)
+      : live(other.live) {}
+
+  T* allocate(std::size_t n) {
+    *live += static_cast<std::ptrdiff_t>(n * sizeof(T));
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T* p, std::size_t n) {
+    *live -= static_cast<std::ptrdiff_t>(n * sizeof(T));
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  template <typename U>
+  bool operator==(const CountingAllocator<U>& other) const {
+    return live == other.live;
+  }
+
+  std::ptrdiff_t* live;
+};
+
+template <typename K>
+K key_of(std::uint64_t random) {
+  if constexpr (std::is_same_v<K, std::string>) {
+    return "key" + std::to_string(random % 100000);
+  } else {
+    return static_cast<K>(random);
+  }
+}
+
+template <typename Map, typename Reference>
+void expect_same(const Map& map, const Reference& expected) {
+  ASSERT_EQ(map.size(), expected.size());
+  ASSERT_EQ(map.empty(), expected.empty());
+  auto it = map.begin();
+  for (const auto& [key, value] : expected) {
+    ASSERT_NE(it, map.end());
+    ASSERT_EQ(it->first, key);
+    ASSERT_EQ(it->second, value);
+    ++it;
+  }
+  EXPECT_EQ(it, map.end());
+  EXPECT_TRUE(std::equal(map.rbegin(), map.rend(), expected.rbegin(), expected.rend(),
+                         [](const auto& lhs, const auto& rhs) {
+                           return lhs.first == rhs.first && lhs.second == rhs.second;
+                         }));
+}
+
+// Random insertions and erasures, checked against std::map.
+template <typename K, typename Compare = std::less<K>>
+void check_against_std_map(unsigned seed, std::uint64_t key_range, int steps) {
+  std::mt19937_64 gen(seed);
+  BTreeMap<K, int, Compare> map;
+  std::map<K, int, Compare> expected;
+  for (int step = 0; step < steps; ++step) {
+    const K key = key_of<K>(gen() % key_range);
+    switch (gen() % 8) {
+      case 0:
+      case 1:
+        EXPECT_EQ(map.try_emplace(key, step).second, expected.try_emplace(key, step).second);
+        break;
+      case 2:
+        EXPECT_EQ(map.insert_or_assign(key, step).second,
+                  expected.insert_or_assign(key, step).second);
+        break;
+      case 3:
+        map[key] += step;
+        expected[key] += step;
+        break;
+      case 4:
+      case 5:
+        EXPECT_EQ(map.erase(key), expected.erase(key));
+        break;
+      case 6: {
+        auto it = map.lower_bound(key);
+        auto expected_it = expected.lower_bound(key);
+        ASSERT_EQ(it == map.end(), expected_it == expected.end());
+        if (it != map.end()) {
+          EXPECT_EQ(it->first, expected_it->first);
+          auto next = map.erase(it);
+          auto expected_next = expected.erase(expected_it);
+          ASSERT_EQ(next == map.end(), expected_next == expected.end());
+          if (next != map.end()) {
+            EXPECT_EQ(next->first, expected_next->first);
+          }
+        }
+        break;
+      }
+      default: {
+        auto it = map.upper_bound(key);
+        auto expected_it = expected.upper_bound(key);
+        ASSERT_EQ(it == map.end(), expected_it == expected.end());
+        if (it != map.end()) {
+          EXPECT_EQ(it->first, expected_it->first);
+        }
+        EXPECT_EQ(map.contains(key), expected.contains(key));
+        break;
+      }
+    }
+    if (step % 1000 == 0) {
+      expect_same(map, expected);
+    }
+  }
+  expect_same(map, expected);
+  while (!expected.empty()) {
+    const K key = expected.begin()->first;
+    ASSERT_EQ(map.erase(key), 1u);
+    expected.erase(expected.begin());
+  }
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.begin(), map.end());
+}
+
+template <typename T>
+void check_count_less(unsigned seed) {
+  std::mt19937_64 gen(seed);
+  std::vector<T> interesting = {std::numeric_limits<T>::min(), std::numeric_limits<T>::max(),
+                                T(0), T(1), static_cast<T>(-1)};
+  for (std::size_t size = 0; size <= 80; ++size) {
+    for (int round = 0; round < 20; ++round) {
+      std::vector<T> keys(size);
+      for (T& key : keys) {
+        key = gen() % 4 == 0 ? interesting[gen() % interesting.size()] : static_cast<T>(gen());
+      }
+      if (round % 2 == 0) {
+        std::sort(keys.begin(), keys.end());
+      }
+      const T probe = gen() % 3 == 0 ? interesting[gen() % interesting.size()]
+                      : size != 0 && gen() % 2 == 0 ? keys[gen() % size]
+                                                    : static_cast<T>(gen());
+      const auto expected = static_cast<std::size_t>(
+          std::count_if(keys.begin(), keys.end(), [&](T key) { return key < probe; }));
+      ASSERT_EQ(btreemap_detail::count_less(keys.data(), keys.size(), probe), expected)
+          << size << " " << round;
+    }
+  }
+}
+
+// Each test runs on every search kernel the CPU has.
+class BTreeMapTest : public testing::TestWithParam<SearchIsa> {
+ protected:
+  void SetUp() override {
+    previous_ = btreemap_detail::active_search_isa();
+    if (!btreemap_detail::select_search_isa(GetParam())) {
+      GTEST_SKIP() << "instruction set not supported here";
+    }
+  }
+  void TearDown() override { btreemap_detail::select_search_isa(previous_); }
+
+ private:
+  SearchIsa previous_ = SearchIsa::Portable;
+};
+
+TEST_P(BTreeMapTest, CountsSmallerKeys) {
+  check_count_less<int>(1);
+  check_count_less<unsigned>(2);
+  check_count_less<long>(3);
+  check_count_less<unsigned long>(4);
+  check_count_less<long long>(5);
+  check_count_less<unsigned long long>(6);
+}
+
+TEST_P(BTreeMapTest, MatchesStdMap) {
+  check_against_std_map<int>(1, 500, 20000);
+  check_against_std_map<int>(2, 1u << 31, 30000);
+  check_against_std_map<unsigned>(3, 1u << 20, 20000);
+  check_against_std_map<std::int64_t>(4, std::numeric_limits<std::uint64_t>::max(), 20000);
+  check_against_std_map<std::uint64_t>(5, 3000, 20000);
+}
+
+TEST_P(BTreeMapTest, MatchesStdMapWithOtherKeysAndOrders) {
+  check_against_std_map<std::string>(6, 3000, 20000);
+  check_against_std_map<int, std::greater<int>>(7, 3000, 20000);
+  check_against_std_map<int, std::less<>>(8, 3000, 20000);
+}
+
+TEST_P(BTreeMapTest, BuildsFromSortedInput) {
+  for (std::size_t size : {0u, 1u, 8u, 63u, 64u, 65u, 127u, 1000u, 4096u, 100000u}) {
+    std::vector<std::pair<int, int>> sorted(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      sorted[i] = {static_cast<int>(i * 2), static_cast<int>(i)};
+    }
+    auto map = BTreeMap<int, int>::from_sorted(sorted.begin(), sorted.end());
+    expect_same(map, std::map<int, int>(sorted.begin(), sorted.end()));
+
+    // Every node at least half full: a height no binary tree could have.
+    std::size_t levels = 0;
+    for (std::size_t capacity = 64; capacity < size; capacity *= 33) {
+      ++levels;
+    }
+    EXPECT_LE(map.height(), levels);
+
+    // Still a valid tree to update.
+    for (std::size_t i = 0; i < size; i += 3) {
+      map.try_emplace(static_cast<int>(i * 2 + 1), -1);
+      map.erase(static_cast<int>(i * 2));
+    }
+    for (std::size_t i = 0; i < size; ++i) {
+      EXPECT_EQ(map.contains(static_cast<int>(i * 2)), i % 3 != 0);
+      EXPECT_EQ(map.contains(static_cast<int>(i * 2 + 1)), i % 3 == 0);
+    }
+  }
+
+  std::vector<std::pair<int, int>> unsorted = {{1, 0}, {3, 0}, {2, 0}};
+  EXPECT_THROW((BTreeMap<int, int>::from_sorted(unsorted.begin(), unsorted.end())),
+               std::invalid_argument);
+  std::vector<std::pair<int, int>> repeated = {{1, 0}, {2, 0}, {2, 1}};
+  EXPECT_THROW((BTreeMap<int, int>::from_sorted(repeated.begin(), repeated.end())),
+               std::invalid_argument);
+}
+
+std::string isa_name(const testing::TestParamInfo<SearchIsa>& info) {
+  constexpr const char* kNames[] = {"Portable", "Avx2", "Avx512", "Neon"};
+  return kNames[static_cast<int>(info.param)];
+}
+
+INSTANTIATE_TEST_SUITE_P(Isa, BTreeMapTest,
+                         testing::Values(SearchIsa::Portable, SearchIsa::Avx2, SearchIsa::Avx512,
+                                         SearchIsa::Neon),
+                         isa_name);
+
+TEST(BTreeMap, ConstructsFromUnsortedInput) {
+  std::vector<std::pair<int, std::string>> values;
+  std::mt19937 gen(9);
+  std::map<int, std::string> expected;
+  for (int i = 0; i < 5000; ++i) {
+    const int key = static_cast<int>(gen() % 2000);
+    values.emplace_back(key, std::to_string(i));
+    expected.try_emplace(key, std::to_string(i));
+  }
+  // Of equal keys the first one is kept.
+  expect_same(BTreeMap<int, std::string>(values.begin(), values.end()), expected);
+
+  BTreeMap<int, std::string> small{{3, "c"}, {1, "a"}, {2, "b"}, {1, "x"}};
+  expect_same(small, std::map<int, std::string>{{1, "a"}, {2, "b"}, {3, "c"}});
+  small = {{5, "e"}};
+  expect_same(small, std::map<int, std::string>{{5, "e"}});
+  small.insert({{4, "d"}, {5, "y"}});
+  expect_same(small, std::map<int, std::string>{{4, "d"}, {5, "e"}});
+}
+
+TEST(BTreeMap, LooksUpAndUpdates) {
+  BTreeMap<int, int> map;
+  for (int key = 0; key < 1000; ++key) {
+    EXPECT_TRUE(map.emplace(key * 10, key).second);
+  }
+  EXPECT_FALSE(map.insert({50, -1}).second);
+  EXPECT_EQ(map.at(50), 5);
+  EXPECT_THROW(map.at(51), std::out_of_range);
+  EXPECT_EQ(std::as_const(map).at(9990), 999);
+  EXPECT_EQ(map.count(10), 1u);
+  EXPECT_EQ(map.count(11), 0u);
+  EXPECT_EQ(map.find(11), map.end());
+
+  auto [first, last] = map.equal_range(100);
+  ASSERT_NE(first, map.end());
+  EXPECT_EQ(first->first, 100);
+  EXPECT_EQ(std::distance(first, last), 1);
+  auto [none, also_none] = std::as_const(map).equal_range(101);
+  EXPECT_EQ(none, also_none);
+  EXPECT_EQ(none->first, 110);
+
+  // Values are modified through iterators and their proxy references.
+  for (auto [key, value] : map) {
+    value = -key;
+  }
+  map.find(20)->second = 7;
+  EXPECT_EQ(map[20], 7);
+  EXPECT_EQ(map[30], -30);
+  BTreeMap<int, int>::const_iterator it = map.find(40);
+  EXPECT_EQ((*it).second, -40);
+}
+
+TEST(BTreeMap, ScansRanges) {
+  BTreeMap<std::uint64_t, std::uint64_t> map;
+  for (std::uint64_t key = 0; key < 100000; ++key) {
+    map.try_emplace(key * 7, key);
+  }
+  std::uint64_t sum = 0;
+  std::size_t count = 0;
+  for (auto it = map.lower_bound(7000), end = map.upper_bound(14000); it != end; ++it) {
+    sum += it->second;
+    ++count;
+  }
+  EXPECT_EQ(count, 1001u);
+  EXPECT_EQ(sum, (1000u + 2000u) * 1001u / 2);
+
+  // Walking back over leaf boundaries.
+  auto it = map.end();
+  for (std::uint64_t key = 100000; key-- > 99000;) {
+    --it;
+    ASSERT_EQ(it->first, key * 7);
+  }
+}
+
+TEST(BTreeMap, ErasesRanges) {
+  BTreeMap<int, int> map;
+  std::map<int, int> expected;
+  for (int key = 0; key < 3000; ++key) {
+    map.try_emplace(key, key);
+    expected.try_emplace(key, key);
+  }
+  auto next = map.erase(map.find(100), map.find(2500));
+  expected.erase(expected.find(100), expected.find(2500));
+  EXPECT_EQ(next->first, 2500);
+  expect_same(map, expected);
+  auto after = map.erase(map.begin(), map.end());
+  EXPECT_EQ(after, map.end());
+  EXPECT_TRUE(map.empty());
+  map.try_emplace(1, 1);
+  EXPECT_EQ(map.size(), 1u);
+}
+
+TEST(BTreeMap, LooksUpThroughTransparentComparators) {
+  BTreeMap<std::string, int, std::less<>> map;
+  for (int i = 0; i < 500; ++i) {
+    map.try_emplace("k" + std::to_string(i), i);
+  }
+  EXPECT_EQ(map.find(std::string_view("k42"))->second, 42);
+  EXPECT_TRUE(map.contains("k499"));
+  EXPECT_EQ(map.count(std::string_view("k500")), 0u);
+  EXPECT_EQ(map.lower_bound("k5")->first, "k5");
+  EXPECT_EQ(map.upper_bound("k5")->first, "k50");
+}
+
+TEST(BTreeMap, CopiesMovesAndSwaps) {
+  BTreeMap<int, std::string> map;
+  for (int key = 0; key < 2000; ++key) {
+    map.try_emplace(key, std::to_string(key));
+  }
+  BTreeMap<int, std::string> copy = map;
+  EXPECT_EQ(copy, map);
+  copy.erase(5);
+  EXPECT_NE(copy, map);
+  copy = map;
+  EXPECT_EQ(copy, map);
+
+  BTreeMap<int, std::string> moved = std::move(copy);
+  EXPECT_TRUE(copy.empty());  // NOLINT(bugprone-use-after-move)
+  EXPECT_EQ(copy.begin(), copy.end());
+  EXPECT_EQ(moved, map);
+  copy.try_emplace(1, "one");
+
+  swap(copy, moved);
+  EXPECT_EQ(copy, map);
+  EXPECT_EQ(moved.size(), 1u);
+  moved = std::move(copy);
+  EXPECT_EQ(moved, map);
+}
+
+TEST(BTreeMap, KeepsKeysOnCacheLines) {
+  BTreeMap<int, int> map;
+  for (int key = 0; key < 10000; ++key) {
+    map.try_emplace(key, key);
+  }
+  // A key that does not follow the one before it in memory starts a leaf.
+  const int* previous = nullptr;
+  std::size_t leaves = 0;
+  for (auto it = map.begin(); it != map.end(); ++it) {
+    const int* key = &it->first;
+    if (key != previous + 1) {
+      ASSERT_EQ(reinterpret_cast<std::uintptr_t>(key) % 64, 0u) << *key;
+      ++leaves;
+    }
+    previous = key;
+  }
+  EXPECT_GE(leaves, 10000u / 64);
+}
+
+TEST(BTreeMap, DestroysWhatItHolds) {
+  {
+    BTreeMap<int, Counted> map;
+    for (int key = 0; key < 5000; ++key) {
+      map.try_emplace(key, key);
+    }
+    EXPECT_EQ(Counted::alive, 5000);
+    for (int key = 0; key < 5000; key += 2) {
+      map.erase(key);
+    }
+    EXPECT_EQ(Counted::alive, 2500);
+    BTreeMap<int, Counted> copy = map;
+    EXPECT_EQ(Counted::alive, 5000);
+    copy.clear();
+    EXPECT_EQ(Counted::alive, 2500);
+  }
+  EXPECT_EQ(Counted::alive, 0);
+}
+
+TEST(BTreeMap, ReturnsAllocatedNodes) {
+  std::ptrdiff_t live = 0;
+  {
+    using Allocator = CountingAllocator<std::pair<const int, int>>;
+    BTreeMap<int, int, std::less<int>, Allocator> map{Allocator(&live)};
+    for (int key = 0; key < 20000; ++key) {
+      map.try_emplace(key * 7919 % 20000, key);
+    }
+    EXPECT_GT(live, 0);
+    for (int key = 0; key < 20000; key += 3) {
+      map.erase(key);
+    }
+    auto copy = map;
+    EXPECT_EQ(copy.get_allocator(), map.get_allocator());
+  }
+  EXPECT_EQ(live, 0);
+}
+
+TEST(BTreeMap, FailedInsertionsLeaveTheMapUnchanged) {
+  BTreeMap<int, Fragile> map;
+  for (int key = 0; key < 4000; ++key) {
+    map.try_emplace(key * 2, key);
+  }
+  Fragile::fail = true;
+  for (int key = 1; key < 8000; key += 2) {
+    EXPECT_THROW(map.try_emplace(key, key), std::runtime_error);
+  }
+  Fragile::fail = false;
+  ASSERT_EQ(map.size(), 4000u);
+  int expected = 0;
+  for (const auto& [key, value] : map) {
+    ASSERT_EQ(key, expected * 2);
+    ASSERT_EQ(value.value, expected);
+    ++expected;
+  }
+  map.try_emplace(1, 1);
+  EXPECT_EQ(map.size(), 4001u);
+}
+
+}  // namespace
@@ -0,0 +1,154 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BigInteger/biginteger.h"
+
+namespace {
+
+using MulAlgorithm = BigInteger::MulAlgorithm;
+
+// A random positive number with about `limbs` 32-bit limbs.
+BigInteger random_number(std::size_t limbs, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> digit(0, 9);
+  std::size_t digits = limbs * 32 * 30103 / 100000;
+  std::string text(digits, '0');
+  text[0] = '1';
+  for (std::size_t i = 1; i < digits; ++i) {
+    text[i] = static_cast<char>('0' + digit(gen));
+  }
+  return BigInteger(text);
+}
+
+template <MulAlgorithm Algorithm>
+void BM_Multiply(benchmark::State& state) {
+  auto limbs = static_cast<std::size_t>(state.range(0));
+  BigInteger lhs = random_number(limbs, 1);
+  BigInteger rhs = random_number(limbs, 2);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(BigInteger::multiply(lhs, rhs, Algorithm));
+  }
+  state.counters["limbs"] = static_cast<double>(lhs.limb_count());
+  state.SetComplexityN(state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_Multiply, MulAlgorithm::Schoolbook)
+    ->RangeMultiplier(2)->Range(8, 4096)->Complexity();
+BENCHMARK_TEMPLATE(BM_Multiply, MulAlgorithm::Karatsuba)
+    ->RangeMultiplier(2)->Range(8, 16384)->Complexity();
+BENCHMARK_TEMPLATE(BM_Multiply, MulAlgorithm::Toom3)
+    ->RangeMultiplier(2)->Range(8, 16384)->Complexity();
+BENCHMARK_TEMPLATE(BM_Multiply, MulAlgorithm::Ntt)
+    ->RangeMultiplier(2)->Range(8, 65536)->Complexity();
+BENCHMARK_TEMPLATE(BM_Multiply, MulAlgorithm::Auto)
+    ->RangeMultiplier(2)->Range(8, 65536)->Complexity();
+
+// a + b - c + d with every partial result a named value, as the operators
+// on const references compute it, against the chain on temporaries.
+void BM_AddChainNamed(benchmark::State& state) {
+  auto limbs = static_cast<std::size_t>(state.range(0));
+  BigInteger a = random_number(limbs, 1);
+  BigInteger b = random_number(limbs, 2);
+  BigInteger c = random_number(limbs, 3);
+  BigInteger d = random_number(limbs, 4);
+  for (auto _ : state) {
+    BigInteger sum = a + b;
+    BigInteger difference = sum - c;
+    benchmark::DoNotOptimize(difference + d);
+  }
+}
+
+BENCHMARK(BM_AddChainNamed)->RangeMultiplier(8)->Range(4, 2048);
+
+void BM_AddChain(benchmark::State& state) {
+  auto limbs = static_cast<std::size_t>(state.range(0));
+  BigInteger a = random_number(limbs, 1);
+  BigInteger b = random_number(limbs, 2);
+  BigInteger c = random_number(limbs, 3);
+  BigInteger d = random_number(limbs, 4);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a + b - c + d);
+  }
+}
+
+BENCHMARK(BM_AddChain)->RangeMultiplier(8)->Range(4, 2048);
+
+// A dot product of 64 pairs: acc += x * y builds every product before
+// adding it, add_product() accumulates it in place.
+template <bool Fused>
+void BM_DotProduct(benchmark::State& state) {
+  auto limbs = static_cast<std::size_t>(state.range(0));
+  std::vector<BigInteger> x;
+  std::vector<BigInteger> y;
+  for (unsigned i = 0; i < 64; ++i) {
+    x.push_back(random_number(limbs, 2 * i));
+    y.push_back(random_number(limbs, 2 * i + 1));
+  }
+  for (auto _ : state) {
+    BigInteger acc;
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      if constexpr (Fused) {
+        acc.add_product(x[i], y[i]);
+      } else {
+        acc += x[i] * y[i];
+      }
+    }
+    benchmark::DoNotOptimize(acc);
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_DotProduct, false)->Arg(4)->Arg(16)->Arg(32);
+BENCHMARK_TEMPLATE(BM_DotProduct, true)->Arg(4)->Arg(16)->Arg(32);
+
+void BM_Divide(benchmark::State& state) {
+  auto limbs = static_cast<std::size_t>(state.range(0));
+  BigInteger dividend = random_number(2 * limbs, 3);
+  BigInteger divisor = random_number(limbs, 4);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(dividend / divisor);
+  }
+  state.SetComplexityN(state.range(0));
+}
+
+BENCHMARK(BM_Divide)->RangeMultiplier(4)->Range(8, 2048)->Complexity();
+
+void BM_ToString(benchmark::State& state) {
+  BigInteger value = random_number(static_cast<std::size_t>(state.range(0)), 5);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(value.to_string());
+  }
+  state.SetComplexityN(state.range(0));
+}
+
+BENCHMARK(BM_ToString)->RangeMultiplier(4)->Range(16, 65536)->Complexity();
+
+void BM_ToChars(benchmark::State& state) {
+  BigInteger value = random_number(static_cast<std::size_t>(state.range(0)), 6);
+  std::string buffer(value.decimal_length_bound(), '\0');
+  for (auto _ : state) {
+    auto result = value.to_chars(buffer.data(), buffer.data() + buffer.size());
+    benchmark::DoNotOptimize(result.ptr);
+  }
+  state.SetComplexityN(state.range(0));
+}
+
+BENCHMARK(BM_ToChars)->RangeMultiplier(4)->Range(16, 65536)->Complexity();
+
+void BM_FromString(benchmark::State& state) {
+  std::string text =
+      random_number(static_cast<std::size_t>(state.range(0)), 7).to_string();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(BigInteger::from_string(text));
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(text.size()));
+  state.SetComplexityN(state.range(0));
+}
+
+BENCHMARK(BM_FromString)->RangeMultiplier(4)->Range(16, 65536)->Complexity();
+
+}  // namespace
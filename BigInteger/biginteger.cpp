@@ -0,0 +1,1204 @@
+#include "BigInteger/biginteger.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <deque>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+#include "ThreadPool/threadpool.h"
+
+namespace {
+
+using Limb = BigInteger::Limb;
+using DoubleLimb = std::uint64_t;
+using Limbs = std::vector<Limb>;
+using LimbSpan = std::span<const Limb>;
+using MulAlgorithm = BigInteger::MulAlgorithm;
+
+constexpr int kLimbBits = 32;
+
+// Sizes of the smaller operand, in limbs, from which each tier is used.
+// Measured with bench/biginteger_bench.cpp.
+constexpr std::size_t kKaratsubaThreshold = 40;
+constexpr std::size_t kToom3Threshold = 160;
+constexpr std::size_t kNttThreshold = 1200;
+
+LimbSpan trimmed(LimbSpan value) {
+  std::size_t size = value.size();
+  while (size > 0 && value[size - 1] == 0) {
+    --size;
+  }
+  return value.first(size);
+}
+
+void trim(Limbs& value) {
+  while (!value.empty() && value.back() == 0) {
+    value.pop_back();
+  }
+}
+
+// Both operands must be trimmed.
+std::strong_ordering compare(LimbSpan lhs, LimbSpan rhs) {
+  if (lhs.size() != rhs.size()) {
+    return lhs.size() <=> rhs.size();
+  }
+  for (std::size_t i = lhs.size(); i-- > 0;) {
+    if (lhs[i] != rhs[i]) {
+      return lhs[i] <=> rhs[i];
+    }
+  }
+  return std::strong_ordering::equal;
+}
+
+// result += value * B^offset, growing result as needed.
+void add_to(Limbs& result, LimbSpan value, std::size_t offset = 0) {
+  value = trimmed(value);
+  if (result.size() < offset + value.size()) {
+    result.resize(offset + value.size(), 0);
+  }
+  DoubleLimb carry = 0;
+  std::size_t i = 0;
+  for (; i < value.size(); ++i) {
+    carry += DoubleLimb{result[offset + i]} + value[i];
+    result[offset + i] = static_cast<Limb>(carry);
+    carry >>= kLimbBits;
+  }
+  for (std::size_t j = offset + i; carry != 0; ++j) {
+    if (j == result.size()) {
+      result.push_back(0);
+    }
+    carry += result[j];
+    result[j] = static_cast<Limb>(carry);
+    carry >>= kLimbBits;
+  }
+}
+
+// result -= value * B^offset; the result must not become negative.
+void sub_from(Limbs& result, LimbSpan value, std::size_t offset = 0) {
+  value = trimmed(value);
+  Limb borrow = 0;
+  std::size_t i = 0;
+  for (; i < value.size(); ++i) {
+    DoubleLimb lhs = result[offset + i];
+    DoubleLimb rhs = DoubleLimb{value[i]} + borrow;
+    result[offset + i] = static_cast<Limb>(lhs - rhs);
+    borrow = lhs < rhs ? 1 : 0;
+  }
+  for (std::size_t j = offset + i; borrow != 0; ++j) {
+    borrow = result[j] == 0 ? 1 : 0;
+    --result[j];
+  }
+  trim(result);
+}
+
+Limbs add(LimbSpan lhs, LimbSpan rhs) {
+  Limbs result(lhs.begin(), lhs.end());
+  add_to(result, rhs);
+  trim(result);
+  return result;
+}
+
+// Requires lhs >= rhs.
+Limbs sub(LimbSpan lhs, LimbSpan rhs) {
+  Limbs result(lhs.begin(), lhs.end());
+  sub_from(result, rhs);
+  return result;
+}
+
+Limb mul_small_into(Limb* result, LimbSpan value, Limb factor, Limb carry) {
+  DoubleLimb acc = carry;
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    acc += DoubleLimb{value[i]} * factor;
+    result[i] = static_cast<Limb>(acc);
+    acc >>= kLimbBits;
+  }
+  return static_cast<Limb>(acc);
+}
+
+// Divides in place, returns the remainder.
+Limb div_small(Limbs& value, Limb divisor) {
+  DoubleLimb remainder = 0;
+  for (std::size_t i = value.size(); i-- > 0;) {
+    DoubleLimb current = (remainder << kLimbBits) | value[i];
+    value[i] = static_cast<Limb>(current / divisor);
+    remainder = current % divisor;
+  }
+  trim(value);
+  return static_cast<Limb>(remainder);
+}
+
+Limbs mul_schoolbook(LimbSpan lhs, LimbSpan rhs) {
+  Limbs result(lhs.size() + rhs.size(), 0);
+  for (std::size_t i = 0; i < rhs.size(); ++i) {
+    DoubleLimb carry = 0;
+    Limb factor = rhs[i];
+    if (factor == 0) {
+      continue;
+    }
+    for (std::size_t j = 0; j < lhs.size(); ++j) {
+      carry += DoubleLimb{lhs[j]} * factor + result[i + j];
+      result[i + j] = static_cast<Limb>(carry);
+      carry >>= kLimbBits;
+    }
+    result[i + lhs.size()] = static_cast<Limb>(carry);
+  }
+  trim(result);
+  return result;
+}
+
+// result += lhs * rhs, growing result as needed; the schoolbook product
+// added in place instead of into a buffer of its own.
+void mul_add_to(Limbs& result, LimbSpan lhs, LimbSpan rhs) {
+  if (result.size() < lhs.size() + rhs.size()) {
+    result.resize(lhs.size() + rhs.size(), 0);
+  }
+  for (std::size_t i = 0; i < rhs.size(); ++i) {
+    DoubleLimb carry = 0;
+    Limb factor = rhs[i];
+    if (factor == 0) {
+      continue;
+    }
+    for (std::size_t j = 0; j < lhs.size(); ++j) {
+      carry += DoubleLimb{lhs[j]} * factor + result[i + j];
+      result[i + j] = static_cast<Limb>(carry);
+      carry >>= kLimbBits;
+    }
+    for (std::size_t j = i + lhs.size(); carry != 0; ++j) {
+      if (j == result.size()) {
+        result.push_back(0);
+      }
+      carry += result[j];
+      result[j] = static_cast<Limb>(carry);
+      carry >>= kLimbBits;
+    }
+  }
+  trim(result);
+}
+
+Limbs multiply(LimbSpan lhs, LimbSpan rhs, MulAlgorithm cap);
+
+Limbs mul_karatsuba(LimbSpan lhs, LimbSpan rhs, MulAlgorithm cap) {
+  if (lhs.size() < 2) {
+    return mul_schoolbook(lhs, rhs);
+  }
+  std::size_t half = (lhs.size() + 1) / 2;
+  LimbSpan lhs_low = trimmed(lhs.first(half));
+  LimbSpan lhs_high = lhs.subspan(half);
+  LimbSpan rhs_low = trimmed(rhs.first(std::min(half, rhs.size())));
+  LimbSpan rhs_high = rhs.size() > half ? rhs.subspan(half) : LimbSpan{};
+
+  Limbs low = multiply(lhs_low, rhs_low, cap);
+  Limbs high = multiply(lhs_high, rhs_high, cap);
+  Limbs middle = multiply(add(lhs_low, lhs_high), add(rhs_low, rhs_high), cap);
+  sub_from(middle, low);
+  sub_from(middle, high);
+
+  Limbs result = low;
+  result.reserve(lhs.size() + rhs.size() + 1);
+  add_to(result, middle, half);
+  add_to(result, high, 2 * half);
+  trim(result);
+  return result;
+}
+
+// Sign-magnitude value used by the Toom-3 evaluation and interpolation.
+struct Signed {
+  Limbs magnitude;
+  bool negative = false;
+};
+
+Signed signed_add(const Signed& lhs, const Signed& rhs) {
+  if (lhs.negative == rhs.negative) {
+    return {add(lhs.magnitude, rhs.magnitude), lhs.negative};
+  }
+  if (compare(lhs.magnitude, rhs.magnitude) >= 0) {
+    Signed result{sub(lhs.magnitude, rhs.magnitude), lhs.negative};
+    result.negative = result.negative && !result.magnitude.empty();
+    return result;
+  }
+  return {sub(rhs.magnitude, lhs.magnitude), rhs.negative};
+}
+
+Signed signed_sub(const Signed& lhs, Signed rhs) {
+  rhs.negative = !rhs.negative && !rhs.magnitude.empty();
+  return signed_add(lhs, rhs);
+}
+
+Signed signed_shift_left(Signed value, int bits) {
+  Limb carry = 0;
+  for (Limb& limb : value.magnitude) {
+    Limb next = limb >> (kLimbBits - bits);
+    limb = (limb << bits) | carry;
+    carry = next;
+  }
+  if (carry != 0) {
+    value.magnitude.push_back(carry);
+  }
+  return value;
+}
+
+// The division must be exact.
+Signed signed_divexact(Signed value, Limb divisor) {
+  div_small(value.magnitude, divisor);
+  value.negative = value.negative && !value.magnitude.empty();
+  return value;
+}
+
+Signed signed_mul(const Signed& lhs, const Signed& rhs, MulAlgorithm cap) {
+  Signed result{multiply(lhs.magnitude, rhs.magnitude, cap),
+                lhs.negative != rhs.negative};
+  result.negative = result.negative && !result.magnitude.empty();
+  return result;
+}
+
+// Toom-3 with the evaluation points 0, 1, -1, -2 and infinity and Bodrato's
+// interpolation sequence.
+Limbs mul_toom3(LimbSpan lhs, LimbSpan rhs, MulAlgorithm cap) {
+  if (lhs.size() < 3) {
+    return mul_schoolbook(lhs, rhs);
+  }
+  std::size_t part = (lhs.size() + 2) / 3;
+  auto split = [part](LimbSpan value, std::size_t index) -> Signed {
+    std::size_t begin = std::min(index * part, value.size());
+    std::size_t end = std::min(begin + part, value.size());
+    LimbSpan piece = trimmed(value.subspan(begin, end - begin));
+    return {Limbs(piece.begin(), piece.end()), false};
+  };
+
+  auto evaluate = [](const Signed& p0, const Signed& p1, const Signed& p2) {
+    Signed even = signed_add(p0, p2);
+    Signed at_one = signed_add(even, p1);
+    Signed at_minus_one = signed_sub(even, p1);
+    // p(-2) = (p(-1) + p2) * 2 - p0
+    Signed at_minus_two =
+        signed_sub(signed_shift_left(signed_add(at_minus_one, p2), 1), p0);
+    return std::array<Signed, 3>{at_one, at_minus_one, at_minus_two};
+  };
+
+  Signed a0 = split(lhs, 0), a1 = split(lhs, 1), a2 = split(lhs, 2);
+  Signed b0 = split(rhs, 0), b1 = split(rhs, 1), b2 = split(rhs, 2);
+  auto [a_one, a_minus_one, a_minus_two] = evaluate(a0, a1, a2);
+  auto [b_one, b_minus_one, b_minus_two] = evaluate(b0, b1, b2);
+
+  Signed r0 = signed_mul(a0, b0, cap);
+  Signed r_one = signed_mul(a_one, b_one, cap);
+  Signed r_minus_one = signed_mul(a_minus_one, b_minus_one, cap);
+  Signed r_minus_two = signed_mul(a_minus_two, b_minus_two, cap);
+  Signed r4 = signed_mul(a2, b2, cap);
+
+  Signed r3 = signed_divexact(signed_sub(r_minus_two, r_one), 3);
+  Signed r1 = signed_divexact(signed_sub(r_one, r_minus_one), 2);
+  Signed r2 = signed_sub(r_minus_one, r0);
+  r3 = signed_add(signed_divexact(signed_sub(r2, r3), 2),
+                  signed_shift_left(r4, 1));
+  r2 = signed_sub(signed_add(r2, r1), r4);
+  r1 = signed_sub(r1, r3);
+
+  // All interpolated coefficients are products of non-negative parts, so
+  // they are non-negative.
+  Limbs result = r0.magnitude;
+  result.reserve(lhs.size() + rhs.size() + 2);
+  add_to(result, r1.magnitude, part);
+  add_to(result, r2.magnitude, 2 * part);
+  add_to(result, r3.magnitude, 3 * part);
+  add_to(result, r4.magnitude, 4 * part);
+  trim(result);
+  return result;
+}
+
+// Arithmetic modulo the "Goldilocks" prime p = 2^64 - 2^32 + 1. It has roots
+// of unity of every order up to 2^32, and with 16-bit input digits every
+// coefficient of a convolution shorter than 2^32 stays below p, so a single
+// transform gives the exact product.
+namespace ntt {
+
+constexpr std::uint64_t kModulus = 0xFFFFFFFF00000001ULL;
+constexpr std::uint64_t kEpsilon = 0xFFFFFFFFULL;  // 2^64 mod p
+constexpr std::uint64_t kGenerator = 7;
+constexpr int kDigitBits = 16;
+// Transform length from which the two forward transforms run in parallel
+// on ThreadPool::shared(); below it handing one over costs more than it
+// saves.
+constexpr std::size_t kParallelSize = std::size_t{1} << 16;
+
+__extension__ using UInt128 = unsigned __int128;
+
+// The reductions are written with masks instead of branches: the operands
+// are effectively random, so branches would be mispredicted half the time.
+std::uint64_t mask(bool condition) {
+  return std::uint64_t{0} - static_cast<std::uint64_t>(condition);
+}
+
+std::uint64_t add(std::uint64_t lhs, std::uint64_t rhs) {
+  std::uint64_t sum = lhs + rhs;
+  return sum - (kModulus & mask(sum < lhs || sum >= kModulus));
+}
+
+std::uint64_t sub(std::uint64_t lhs, std::uint64_t rhs) {
+  return lhs - rhs + (kModulus & mask(lhs < rhs));
+}
+
+std::uint64_t mul(std::uint64_t lhs, std::uint64_t rhs) {
+  UInt128 product = static_cast<UInt128>(lhs) * rhs;
+  auto low = static_cast<std::uint64_t>(product);
+  auto high = static_cast<std::uint64_t>(product >> 64);
+  std::uint64_t high_high = high >> 32;
+  std::uint64_t high_low = high & kEpsilon;
+  // 2^96 = -1 and 2^64 = 2^32 - 1 modulo p.
+  std::uint64_t result = low - high_high;
+  result -= kEpsilon & mask(low < high_high);
+  std::uint64_t sum = result + high_low * kEpsilon;
+  sum += kEpsilon & mask(sum < result);
+  return sum - (kModulus & mask(sum >= kModulus));
+}
+
+std::uint64_t power(std::uint64_t base, std::uint64_t exponent) {
+  std::uint64_t result = 1;
+  while (exponent != 0) {
+    if ((exponent & 1) != 0) {
+      result = mul(result, base);
+    }
+    base = mul(base, base);
+    exponent >>= 1;
+  }
+  return result;
+}
+
+// Twiddle factors of every stage, stored contiguously: roots[half + k] is
+// w^k for the primitive (2 * half)-th root of unity w. The entries do not
+// depend on the transform length, so the table only ever grows.
+const std::vector<std::uint64_t>& twiddles(std::size_t size) {
+  thread_local std::vector<std::uint64_t> roots(2, 1);
+  std::size_t have = roots.size();
+  if (have < size) {
+    roots.resize(size);
+    for (std::size_t half = have; half < size; half <<= 1) {
+      std::uint64_t root = power(kGenerator, (kModulus - 1) / (2 * half));
+      for (std::size_t k = 0; k < half; k += 2) {
+        roots[half + k] = roots[half / 2 + k / 2];
+        roots[half + k + 1] = mul(roots[half + k], root);
+      }
+    }
+  }
+  return roots;
+}
+
+void transform(std::vector<std::uint64_t>& values, bool inverse) {
+  std::size_t size = values.size();
+  for (std::size_t i = 1, j = 0; i < size; ++i) {
+    std::size_t bit = size >> 1;
+    for (; (j & bit) != 0; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      std::swap(values[i], values[j]);
+    }
+  }
+
+  const std::vector<std::uint64_t>& roots = twiddles(size);
+  for (std::size_t half = 1; half < size; half <<= 1) {
+    const std::uint64_t* stage = roots.data() + half;
+    for (std::size_t start = 0; start < size; start += 2 * half) {
+      std::uint64_t* low = values.data() + start;
+      std::uint64_t* high = low + half;
+      for (std::size_t k = 0; k < half; ++k) {
+        std::uint64_t even = low[k];
+        std::uint64_t odd = mul(high[k], stage[k]);
+        low[k] = add(even, odd);
+        high[k] = sub(even, odd);
+      }
+    }
+  }
+
+  // The inverse transform is the forward one with w^-1 = w^(size - 1), that
+  // is the forward result read backwards, scaled by 1 / size.
+  if (inverse) {
+    std::reverse(values.begin() + 1, values.end());
+    std::uint64_t size_inverse = power(size % kModulus, kModulus - 2);
+    for (std::uint64_t& value : values) {
+      value = mul(value, size_inverse);
+    }
+  }
+}
+
+std::vector<std::uint64_t> to_digits(LimbSpan value, std::size_t size) {
+  std::vector<std::uint64_t> digits(size, 0);
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    digits[2 * i] = value[i] & 0xFFFF;
+    digits[2 * i + 1] = value[i] >> kDigitBits;
+  }
+  return digits;
+}
+
+Limbs multiply(LimbSpan lhs, LimbSpan rhs) {
+  std::size_t digit_count = 2 * (lhs.size() + rhs.size());
+  std::size_t size = std::bit_ceil(digit_count);
+
+  std::vector<std::uint64_t> left = to_digits(lhs, size);
+  bool square = lhs.data() == rhs.data() && lhs.size() == rhs.size();
+  if (square) {
+    transform(left, false);
+    for (std::uint64_t& value : left) {
+      value = mul(value, value);
+    }
+  } else {
+    std::vector<std::uint64_t> right = to_digits(rhs, size);
+    if (size >= kParallelSize) {
+      ThreadPool::shared().join([&] { transform(left, false); },
+                                [&] { transform(right, false); });
+    } else {
+      transform(left, false);
+      transform(right, false);
+    }
+    for (std::size_t i = 0; i < size; ++i) {
+      left[i] = mul(left[i], right[i]);
+    }
+  }
+  transform(left, true);
+
+  Limbs result(lhs.size() + rhs.size(), 0);
+  UInt128 carry = 0;
+  for (std::size_t i = 0; i < digit_count; ++i) {
+    carry += left[i];
+    auto digit = static_cast<Limb>(carry & 0xFFFF);
+    carry >>= kDigitBits;
+    result[i / 2] |= digit << (kDigitBits * (i % 2));
+  }
+  trim(result);
+  return result;
+}
+
+}  // namespace ntt
+
+MulAlgorithm choose_algorithm(std::size_t smaller, MulAlgorithm cap) {
+  if (cap == MulAlgorithm::Auto) {
+    cap = MulAlgorithm::Ntt;
+  }
+  if (smaller >= kNttThreshold && cap >= MulAlgorithm::Ntt) {
+    return MulAlgorithm::Ntt;
+  }
+  if (smaller >= kToom3Threshold && cap >= MulAlgorithm::Toom3) {
+    return MulAlgorithm::Toom3;
+  }
+  if (smaller >= kKaratsubaThreshold && cap >= MulAlgorithm::Karatsuba) {
+    return MulAlgorithm::Karatsuba;
+  }
+  return MulAlgorithm::Schoolbook;
+}
+
+Limbs mul_balanced(LimbSpan lhs, LimbSpan rhs, MulAlgorithm algorithm,
+                   MulAlgorithm cap) {
+  switch (algorithm) {
+    case MulAlgorithm::Karatsuba:
+      return mul_karatsuba(lhs, rhs, cap);
+    case MulAlgorithm::Toom3:
+      return mul_toom3(lhs, rhs, cap);
+    case MulAlgorithm::Ntt:
+      return ntt::multiply(lhs, rhs);
+    default:
+      return mul_schoolbook(lhs, rhs);
+  }
+}
+
+// lhs must be at least as long as rhs. Karatsuba and Toom-3 split by the
+// longer operand, so very unbalanced inputs are cut into rhs-sized chunks.
+Limbs mul_with(LimbSpan lhs, LimbSpan rhs, MulAlgorithm algorithm,
+               MulAlgorithm cap) {
+  bool splits = algorithm == MulAlgorithm::Karatsuba ||
+                algorithm == MulAlgorithm::Toom3;
+  if (!splits || lhs.size() < 2 * rhs.size()) {
+    return mul_balanced(lhs, rhs, algorithm, cap);
+  }
+  Limbs result;
+  result.reserve(lhs.size() + rhs.size());
+  for (std::size_t offset = 0; offset < lhs.size(); offset += rhs.size()) {
+    std::size_t length = std::min(rhs.size(), lhs.size() - offset);
+    LimbSpan chunk = trimmed(lhs.subspan(offset, length));
+    if (chunk.empty()) {
+      continue;
+    }
+    Limbs product = chunk.size() < rhs.size()
+                        ? multiply(rhs, chunk, cap)
+                        : mul_balanced(rhs, chunk, algorithm, cap);
+    add_to(result, product, offset);
+  }
+  trim(result);
+  return result;
+}
+
+Limbs multiply(LimbSpan lhs, LimbSpan rhs, MulAlgorithm cap) {
+  lhs = trimmed(lhs);
+  rhs = trimmed(rhs);
+  if (lhs.empty() || rhs.empty()) {
+    return {};
+  }
+  if (lhs.size() < rhs.size()) {
+    std::swap(lhs, rhs);
+  }
+  return mul_with(lhs, rhs, choose_algorithm(rhs.size(), cap), cap);
+}
+
+// Knuth's algorithm D (TAOCP 4.3.1) in the formulation of Hacker's Delight.
+// Requires divisor.size() >= 2 and dividend.size() >= divisor.size().
+void divmod_knuth(LimbSpan dividend, LimbSpan divisor, Limbs& quotient,
+                  Limbs& remainder) {
+  std::size_t n = divisor.size();
+  std::size_t m = dividend.size() - n;
+  int shift = std::countl_zero(divisor[n - 1]);
+
+  Limbs v(n);
+  Limbs u(dividend.size() + 1);
+  for (std::size_t i = n - 1; i > 0; --i) {
+    v[i] = (divisor[i] << shift) |
+           static_cast<Limb>(DoubleLimb{divisor[i - 1]} >> (kLimbBits - shift));
+  }
+  v[0] = divisor[0] << shift;
+  u[dividend.size()] = static_cast<Limb>(
+      DoubleLimb{dividend[dividend.size() - 1]} >> (kLimbBits - shift));
+  for (std::size_t i = dividend.size() - 1; i > 0; --i) {
+    u[i] = (dividend[i] << shift) |
+           static_cast<Limb>(DoubleLimb{dividend[i - 1]} >> (kLimbBits - shift));
+  }
+  u[0] = dividend[0] << shift;
+
+  constexpr DoubleLimb kBase = DoubleLimb{1} << kLimbBits;
+  quotient.assign(m + 1, 0);
+  for (std::size_t j = m + 1; j-- > 0;) {
+    DoubleLimb numerator = (DoubleLimb{u[j + n]} << kLimbBits) | u[j + n - 1];
+    DoubleLimb qhat = numerator / v[n - 1];
+    DoubleLimb rhat = numerator % v[n - 1];
+    while (qhat >= kBase ||
+           qhat * v[n - 2] > ((rhat << kLimbBits) | u[j + n - 2])) {
+      --qhat;
+      rhat += v[n - 1];
+      if (rhat >= kBase) {
+        break;
+      }
+    }
+
+    std::int64_t borrow = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      DoubleLimb product = qhat * v[i];
+      std::int64_t t = static_cast<std::int64_t>(u[i + j]) - borrow -
+                       static_cast<std::int64_t>(product & 0xFFFFFFFFULL);
+      u[i + j] = static_cast<Limb>(t);
+      borrow = static_cast<std::int64_t>(product >> kLimbBits) - (t >> kLimbBits);
+    }
+    std::int64_t t = static_cast<std::int64_t>(u[j + n]) - borrow;
+    u[j + n] = static_cast<Limb>(t);
+
+    if (t < 0) {
+      --qhat;
+      DoubleLimb carry = 0;
+      for (std::size_t i = 0; i < n; ++i) {
+        carry += DoubleLimb{u[i + j]} + v[i];
+        u[i + j] = static_cast<Limb>(carry);
+        carry >>= kLimbBits;
+      }
+      u[j + n] += static_cast<Limb>(carry);
+    }
+    quotient[j] = static_cast<Limb>(qhat);
+  }
+  trim(quotient);
+
+  remainder.assign(n, 0);
+  for (std::size_t i = 0; i < n; ++i) {
+    remainder[i] = (u[i] >> shift) |
+                   static_cast<Limb>(DoubleLimb{u[i + 1]} << (kLimbBits - shift));
+  }
+  trim(remainder);
+}
+
+void divmod_magnitude(LimbSpan dividend, LimbSpan divisor, Limbs& quotient,
+                      Limbs& remainder) {
+  if (compare(dividend, divisor) < 0) {
+    quotient.clear();
+    remainder.assign(dividend.begin(), dividend.end());
+    return;
+  }
+  if (divisor.size() == 1) {
+    quotient.assign(dividend.begin(), dividend.end());
+    Limb rest = div_small(quotient, divisor[0]);
+    remainder.clear();
+    if (rest != 0) {
+      remainder.push_back(rest);
+    }
+    return;
+  }
+  divmod_knuth(dividend, divisor, quotient, remainder);
+}
+
+// floor(B^(2k) / divisor) for a divisor of k limbs, by Newton iteration on
+// the top half of the divisor. Taking a couple of limbs more than half keeps
+// the error after one step at a few units, so the final correction loops run
+// O(1) times.
+Limbs reciprocal(LimbSpan divisor) {
+  constexpr std::size_t kNewtonThreshold = 32;
+  std::size_t k = divisor.size();
+  Limbs power(2 * k + 1, 0);
+  power.back() = 1;
+  if (k <= kNewtonThreshold) {
+    Limbs quotient;
+    Limbs remainder;
+    divmod_magnitude(power, divisor, quotient, remainder);
+    return quotient;
+  }
+
+  std::size_t head = k / 2 + 2;
+  Limbs estimate(k - head, 0);
+  Limbs head_reciprocal = reciprocal(divisor.subspan(k - head));
+  estimate.insert(estimate.end(), head_reciprocal.begin(),
+                  head_reciprocal.end());
+
+  // x += x * (B^(2k) - d * x) / B^(2k)
+  Signed error = signed_sub({power, false},
+                            {multiply(divisor, estimate, MulAlgorithm::Auto)});
+  Limbs correction = multiply(estimate, error.magnitude, MulAlgorithm::Auto);
+  correction.erase(correction.begin(),
+                   correction.begin() +
+                       static_cast<std::ptrdiff_t>(
+                           std::min(correction.size(), 2 * k)));
+  estimate = error.negative ? sub(estimate, correction)
+                            : add(estimate, correction);
+
+  Signed rest = signed_sub({power, false},
+                           {multiply(divisor, estimate, MulAlgorithm::Auto)});
+  const Limbs one{1};
+  Signed step{Limbs(divisor.begin(), divisor.end()), false};
+  while (rest.negative) {
+    sub_from(estimate, one);
+    rest = signed_add(rest, step);
+  }
+  while (compare(rest.magnitude, divisor) >= 0) {
+    add_to(estimate, one);
+    rest = signed_sub(rest, step);
+  }
+  return estimate;
+}
+
+// Barrett reduction: divides a value below B^(2k) by a k-limb divisor given
+// its reciprocal floor(B^(2k) / divisor). The estimate is at most two short.
+void divmod_barrett(LimbSpan dividend, LimbSpan divisor, LimbSpan inverse,
+                    Limbs& quotient, Limbs& remainder) {
+  std::size_t k = divisor.size();
+  if (compare(dividend, divisor) < 0) {
+    quotient.clear();
+    remainder.assign(dividend.begin(), dividend.end());
+    return;
+  }
+  quotient = multiply(dividend.subspan(k - 1), inverse, MulAlgorithm::Auto);
+  quotient.erase(quotient.begin(),
+                 quotient.begin() + static_cast<std::ptrdiff_t>(
+                                        std::min(quotient.size(), k + 1)));
+  remainder = sub(dividend, multiply(quotient, divisor, MulAlgorithm::Auto));
+  const Limbs one{1};
+  while (compare(remainder, divisor) >= 0) {
+    sub_from(remainder, divisor);
+    add_to(quotient, one);
+  }
+}
+
+// Decimal conversion splits numbers recursively by P(i) = 10^(9 * 2^i), so
+// both directions cost O(M(n) log n) instead of the quadratic digit loop.
+constexpr Limb kDecimalBase = 1'000'000'000;
+constexpr std::size_t kDecimalBaseDigits = 9;
+
+// Numbers below P(kLeafLevel + 1), i.e. with at most kLeafDigits digits, are
+// converted directly a base-10^9 chunk at a time.
+constexpr std::size_t kLeafLevel = 4;
+constexpr std::size_t kLeafDigits = kDecimalBaseDigits << (kLeafLevel + 1);
+
+struct DecimalPower {
+  Limbs power;       // P(level)
+  Limbs reciprocal;  // floor(B^(2k) / P(level)), computed on first division
+};
+
+// The table is per thread so conversions need no locking. It only grows: the
+// largest power is about the square root of the largest number converted.
+//
+// Large products wait for ThreadPool tasks, and the waiting thread runs
+// other tasks meanwhile, which may convert numbers too. So the table can
+// grow under a conversion that is in progress on the same thread: it is a
+// deque, whose elements stay in place when it grows, and a power is only
+// appended if no nested conversion appended it first.
+using DecimalPowers = std::deque<DecimalPower>;
+
+DecimalPowers& decimal_powers(std::size_t levels) {
+  thread_local DecimalPowers powers{{{kDecimalBase}, {}}};
+  while (powers.size() < levels) {
+    std::size_t size = powers.size();
+    const Limbs& last = powers.back().power;
+    Limbs next = multiply(last, last, MulAlgorithm::Auto);
+    if (powers.size() == size) {
+      powers.push_back({std::move(next), {}});
+    }
+  }
+  return powers;
+}
+
+Limbs parse_decimal_leaf(std::string_view digits) {
+  Limbs result;
+  std::size_t head = digits.size() % kDecimalBaseDigits;
+  if (head == 0) {
+    head = kDecimalBaseDigits;
+  }
+  for (std::size_t pos = 0; pos < digits.size();) {
+    std::size_t length = pos == 0 ? head : kDecimalBaseDigits;
+    Limb chunk = 0;
+    Limb scale = 1;
+    for (std::size_t i = 0; i < length; ++i) {
+      chunk = chunk * 10 + static_cast<Limb>(digits[pos + i] - '0');
+      scale *= 10;
+    }
+    pos += length;
+    Limb carry = mul_small_into(result.data(), result, scale, chunk);
+    if (carry != 0) {
+      result.push_back(carry);
+    }
+  }
+  return result;
+}
+
+// The low part of a number with n > kLeafDigits digits is its last
+// 9 * 2^level digits, the largest such block that is shorter than n.
+std::size_t split_level(std::size_t digits) {
+  std::size_t level = 0;
+  while ((kDecimalBaseDigits << (level + 1)) < digits) {
+    ++level;
+  }
+  return level;
+}
+
+Limbs parse_decimal(std::string_view digits,
+                    const DecimalPowers& powers) {
+  if (digits.size() <= kLeafDigits) {
+    return parse_decimal_leaf(digits);
+  }
+  std::size_t level = split_level(digits.size());
+  std::size_t low_digits = kDecimalBaseDigits << level;
+  Limbs result =
+      multiply(parse_decimal(digits.substr(0, digits.size() - low_digits), powers),
+               powers[level].power, MulAlgorithm::Auto);
+  add_to(result, parse_decimal(digits.substr(digits.size() - low_digits), powers));
+  trim(result);
+  return result;
+}
+
+// Writes a value below P(kLeafLevel + 1); when padded, as exactly `width`
+// digits with leading zeros.
+template <typename Sink>
+void write_decimal_leaf(LimbSpan value, std::size_t width, bool pad,
+                        Sink& sink) {
+  char buffer[kLeafDigits];
+  char* end = buffer + kLeafDigits;
+  char* begin = end;
+  Limbs rest(value.begin(), value.end());
+  while (!rest.empty()) {
+    Limb chunk = div_small(rest, kDecimalBase);
+    for (std::size_t i = 0; i < kDecimalBaseDigits; ++i) {
+      *--begin = static_cast<char>('0' + chunk % 10);
+      chunk /= 10;
+    }
+  }
+  if (pad) {
+    while (static_cast<std::size_t>(end - begin) < width) {
+      *--begin = '0';
+    }
+  } else {
+    while (begin + 1 < end && *begin == '0') {
+      ++begin;
+    }
+  }
+  sink.write(begin, static_cast<std::size_t>(end - begin));
+}
+
+// Writes a value below P(level + 1) = P(level)^2 by splitting it at P(level).
+template <typename Sink>
+void write_decimal(LimbSpan value, std::size_t level, bool pad,
+                   DecimalPowers& powers, Sink& sink) {
+  if (level <= kLeafLevel) {
+    write_decimal_leaf(value, kDecimalBaseDigits << (level + 1), pad, sink);
+    return;
+  }
+  DecimalPower& split = powers[level];
+  if (split.reciprocal.empty()) {
+    split.reciprocal = reciprocal(split.power);
+  }
+  Limbs quotient;
+  Limbs remainder;
+  divmod_barrett(value, split.power, split.reciprocal, quotient, remainder);
+  if (pad || !quotient.empty()) {
+    write_decimal(quotient, level - 1, pad, powers, sink);
+    write_decimal(remainder, level - 1, true, powers, sink);
+  } else {
+    write_decimal(remainder, level - 1, false, powers, sink);
+  }
+}
+
+template <typename Sink>
+void write_decimal(LimbSpan value, bool negative, Sink& sink) {
+  if (negative) {
+    sink.write("-", 1);
+  }
+  if (value.empty()) {
+    sink.write("0", 1);
+    return;
+  }
+  // The smallest level whose square certainly exceeds the value.
+  std::size_t level = 0;
+  for (;; ++level) {
+    const DecimalPowers& powers = decimal_powers(level + 1);
+    if (value.size() + 2 <= 2 * powers[level].power.size()) {
+      break;
+    }
+  }
+  write_decimal(value, level, false, decimal_powers(level + 1), sink);
+}
+
+struct StringSink {
+  std::string& out;
+
+  void write(const char* data, std::size_t size) { out.append(data, size); }
+};
+
+struct BufferSink {
+  char* position;
+  char* last;
+  bool overflow = false;
+
+  void write(const char* data, std::size_t size) {
+    if (overflow || static_cast<std::size_t>(last - position) < size) {
+      overflow = true;
+      return;
+    }
+    std::copy_n(data, size, position);
+    position += size;
+  }
+};
+
+struct StreamSink {
+  std::ostream& out;
+
+  void write(const char* data, std::size_t size) {
+    out.write(data, static_cast<std::streamsize>(size));
+  }
+};
+
+}  // namespace
+
+BigInteger::BigInteger(std::string_view decimal)
+    : BigInteger(from_string(decimal)) {}
+
+BigInteger BigInteger::from_string(std::string_view decimal) {
+  bool negative = false;
+  if (!decimal.empty() && (decimal.front() == '-' || decimal.front() == '+')) {
+    negative = decimal.front() == '-';
+    decimal.remove_prefix(1);
+  }
+  if (decimal.empty()) {
+    throw std::invalid_argument("BigInteger: empty number");
+  }
+  for (char c : decimal) {
+    if (c < '0' || c > '9') {
+      throw std::invalid_argument("BigInteger: invalid digit");
+    }
+  }
+  std::size_t leading_zeros = decimal.find_first_not_of('0');
+  decimal.remove_prefix(std::min(leading_zeros, decimal.size()));
+
+  BigInteger result;
+  if (decimal.size() <= kLeafDigits) {
+    result.limbs_ = parse_decimal_leaf(decimal);
+  } else {
+    result.limbs_ =
+        parse_decimal(decimal, decimal_powers(split_level(decimal.size()) + 1));
+  }
+  result.negative_ = negative;
+  result.normalize();
+  return result;
+}
+
+BigInteger BigInteger::from_limbs(std::span<const Limb> limbs, bool negative) {
+  BigInteger result;
+  result.limbs_.assign(limbs.begin(), limbs.end());
+  result.negative_ = negative;
+  result.normalize();
+  return result;
+}
+
+void BigInteger::normalize() {
+  trim(limbs_);
+  if (limbs_.empty()) {
+    negative_ = false;
+  }
+}
+
+BigInteger& BigInteger::operator+=(const BigInteger& other) {
+  if (negative_ == other.negative_) {
+    add_to(limbs_, other.limbs_);
+  } else if (compare(limbs_, other.limbs_) >= 0) {
+    sub_from(limbs_, other.limbs_);
+  } else {
+    limbs_ = sub(other.limbs_, limbs_);
+    negative_ = other.negative_;
+  }
+  normalize();
+  return *this;
+}
+
+BigInteger& BigInteger::operator-=(const BigInteger& other) {
+  if (this == &other) {
+    limbs_.clear();
+    negative_ = false;
+    return *this;
+  }
+  negative_ = !negative_;
+  *this += other;
+  negative_ = !negative_;
+  normalize();
+  return *this;
+}
+
+BigInteger& BigInteger::operator*=(const BigInteger& other) {
+  return *this = multiply(*this, other);
+}
+
+BigInteger& BigInteger::add_product(const BigInteger& lhs,
+                                    const BigInteger& rhs) {
+  accumulate_product(lhs, rhs, false);
+  return *this;
+}
+
+BigInteger& BigInteger::sub_product(const BigInteger& lhs,
+                                    const BigInteger& rhs) {
+  accumulate_product(lhs, rhs, true);
+  return *this;
+}
+
+// Magnitudes add when the product has the sign of *this; the schoolbook
+// tier then writes its partial products straight into limbs_. Otherwise,
+// with larger operands or when *this is one of them, the product is built
+// first.
+void BigInteger::accumulate_product(const BigInteger& lhs,
+                                    const BigInteger& rhs, bool subtract) {
+  bool product_negative = (lhs.negative_ != rhs.negative_) != subtract;
+  std::size_t smaller = std::min(lhs.limbs_.size(), rhs.limbs_.size());
+  if ((is_zero() || negative_ == product_negative) &&
+      smaller < kKaratsubaThreshold && this != &lhs && this != &rhs) {
+    if (smaller == 0) {
+      return;
+    }
+    LimbSpan left = lhs.limbs_;
+    LimbSpan right = rhs.limbs_;
+    if (left.size() < right.size()) {
+      std::swap(left, right);
+    }
+    mul_add_to(limbs_, left, right);
+    negative_ = product_negative;
+    return;
+  }
+  if (subtract) {
+    *this -= lhs * rhs;
+  } else {
+    *this += lhs * rhs;
+  }
+}
+
+BigInteger& BigInteger::operator/=(const BigInteger& other) {
+  BigInteger remainder;
+  divmod(*this, other, *this, remainder);
+  return *this;
+}
+
+BigInteger& BigInteger::operator%=(const BigInteger& other) {
+  BigInteger quotient;
+  divmod(*this, other, quotient, *this);
+  return *this;
+}
+
+BigInteger BigInteger::operator-() const& {
+  BigInteger result = *this;
+  result.negative_ = !negative_;
+  result.normalize();
+  return result;
+}
+
+BigInteger BigInteger::operator-() && {
+  negative_ = !negative_;
+  normalize();
+  return std::move(*this);
+}
+
+BigInteger BigInteger::operator++(int) {
+  BigInteger old = *this;
+  ++*this;
+  return old;
+}
+
+BigInteger BigInteger::operator--(int) {
+  BigInteger old = *this;
+  --*this;
+  return old;
+}
+
+BigInteger BigInteger::multiply(const BigInteger& lhs, const BigInteger& rhs,
+                                MulAlgorithm algorithm) {
+  BigInteger result;
+  if (lhs.is_zero() || rhs.is_zero()) {
+    return result;
+  }
+  LimbSpan left = lhs.limbs_;
+  LimbSpan right = rhs.limbs_;
+  if (left.size() < right.size()) {
+    std::swap(left, right);
+  }
+  if (algorithm == MulAlgorithm::Auto) {
+    algorithm = choose_algorithm(right.size(), MulAlgorithm::Auto);
+  }
+  result.limbs_ = mul_with(left, right, algorithm, algorithm);
+  result.negative_ = lhs.negative_ != rhs.negative_;
+  result.normalize();
+  return result;
+}
+
+void BigInteger::divmod(const BigInteger& dividend, const BigInteger& divisor,
+                        BigInteger& quotient, BigInteger& remainder) {
+  if (divisor.is_zero()) {
+    throw std::domain_error("BigInteger: division by zero");
+  }
+  bool quotient_negative = dividend.negative_ != divisor.negative_;
+  bool remainder_negative = dividend.negative_;
+  Limbs q;
+  Limbs r;
+  divmod_magnitude(dividend.limbs_, divisor.limbs_, q, r);
+  quotient.limbs_ = std::move(q);
+  quotient.negative_ = quotient_negative;
+  quotient.normalize();
+  remainder.limbs_ = std::move(r);
+  remainder.negative_ = remainder_negative;
+  remainder.normalize();
+}
+
+std::string BigInteger::to_string() const {
+  std::string result;
+  result.reserve(decimal_length_bound());
+  StringSink sink{result};
+  write_decimal(limbs_, negative_, sink);
+  return result;
+}
+
+std::to_chars_result BigInteger::to_chars(char* first, char* last) const {
+  BufferSink sink{first, last};
+  write_decimal(limbs_, negative_, sink);
+  if (sink.overflow) {
+    return {last, std::errc::value_too_large};
+  }
+  return {sink.position, std::errc{}};
+}
+
+std::size_t BigInteger::decimal_length_bound() const {
+  // A limb holds fewer than 10 decimal digits.
+  return 10 * limbs_.size() + 2;
+}
+
+std::strong_ordering operator<=>(const BigInteger& lhs, const BigInteger& rhs) {
+  if (lhs.negative_ != rhs.negative_) {
+    return lhs.negative_ ? std::strong_ordering::less
+                         : std::strong_ordering::greater;
+  }
+  std::strong_ordering magnitude = compare(lhs.limbs_, rhs.limbs_);
+  return lhs.negative_ ? 0 <=> magnitude : magnitude;
+}
+
+BigInteger operator+(const BigInteger& lhs, const BigInteger& rhs) {
+  BigInteger result = lhs;
+  result += rhs;
+  return result;
+}
+
+// The overloads on temporaries reuse the limbs of one operand.
+BigInteger operator+(BigInteger&& lhs, const BigInteger& rhs) {
+  lhs += rhs;
+  return std::move(lhs);
+}
+
+BigInteger operator+(const BigInteger& lhs, BigInteger&& rhs) {
+  rhs += lhs;
+  return std::move(rhs);
+}
+
+BigInteger operator+(BigInteger&& lhs, BigInteger&& rhs) {
+  lhs += rhs;
+  return std::move(lhs);
+}
+
+BigInteger operator-(const BigInteger& lhs, const BigInteger& rhs) {
+  BigInteger result = lhs;
+  result -= rhs;
+  return result;
+}
+
+BigInteger operator-(BigInteger&& lhs, const BigInteger& rhs) {
+  lhs -= rhs;
+  return std::move(lhs);
+}
+
+BigInteger operator-(const BigInteger& lhs, BigInteger&& rhs) {
+  rhs -= lhs;
+  return -std::move(rhs);
+}
+
+BigInteger operator-(BigInteger&& lhs, BigInteger&& rhs) {
+  lhs -= rhs;
+  return std::move(lhs);
+}
+
+BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs) {
+  return BigInteger::multiply(lhs, rhs);
+}
+
+BigInteger operator/(const BigInteger& lhs, const BigInteger& rhs) {
+  BigInteger quotient;
+  BigInteger remainder;
+  BigInteger::divmod(lhs, rhs, quotient, remainder);
+  return quotient;
+}
+
+BigInteger operator%(const BigInteger& lhs, const BigInteger& rhs) {
+  BigInteger quotient;
+  BigInteger remainder;
+  BigInteger::divmod(lhs, rhs, quotient, remainder);
+  return remainder;
+}
+
+std::ostream& operator<<(std::ostream& out, const BigInteger& value) {
+  StreamSink sink{out};
+  write_decimal(value.limbs_, value.negative_, sink);
+  return out;
+}
+
+std::istream& operator>>(std::istream& in, BigInteger& value) {
+  std::string token;
+  if (in >> token) {
+    try {
+      value = BigInteger(token);
+    } catch (const std::invalid_argument&) {
+      in.setstate(std::ios::failbit);
+    }
+  }
+  return in;
+}
+
+BigInteger operator""_bi(const char* digits) {
+  return BigInteger(std::string_view(digits));
+}
+
+BigInteger operator""_bi(const char* digits, std::size_t length) {
+  return BigInteger(std::string_view(digits, length));
+}
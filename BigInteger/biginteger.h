@@ -0,0 +1,149 @@
+#pragma once
+
+// Arbitrary-precision signed integer.
+//
+// The value is stored as sign and magnitude; the magnitude is a little-endian
+// vector of 32-bit limbs without leading zero limbs, so zero is an empty
+// vector and is never negative.
+//
+// Multiplication picks an algorithm by the size of the smaller operand:
+// schoolbook, Karatsuba, Toom-3 and finally a number-theoretic transform
+// modulo the prime 2^64 - 2^32 + 1. Division is Knuth's algorithm D.
+//
+// Decimal conversion in both directions is divide and conquer over cached
+// powers 10^(9 * 2^i), so it is as fast as multiplication up to a log factor.
+//
+// Arithmetic on temporaries reuses their limbs, so a chain such as
+// a + b - c + d allocates one result instead of one per operator, and
+// add_product() accumulates a product without materializing it while the
+// schoolbook tier is in use: acc.add_product(a[i], b[i]) is a dot product
+// without temporaries.
+
+#include <charconv>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class BigInteger {
+ public:
+  using Limb = std::uint32_t;
+
+  enum class MulAlgorithm { Auto, Schoolbook, Karatsuba, Toom3, Ntt };
+
+  BigInteger() = default;
+
+  template <std::integral T>
+  BigInteger(T value) {  // NOLINT(google-explicit-constructor)
+    using Unsigned = std::make_unsigned_t<T>;
+    Unsigned magnitude = static_cast<Unsigned>(value);
+    if constexpr (std::is_signed_v<T>) {
+      if (value < 0) {
+        negative_ = true;
+        magnitude = static_cast<Unsigned>(Unsigned{0} - magnitude);
+      }
+    }
+    if constexpr (sizeof(Unsigned) > sizeof(Limb)) {
+      while (magnitude != 0) {
+        limbs_.push_back(static_cast<Limb>(magnitude));
+        magnitude >>= 32;
+      }
+    } else if (magnitude != 0) {
+      limbs_.push_back(static_cast<Limb>(magnitude));
+    }
+  }
+
+  // Parses an optional sign followed by decimal digits.
+  // Throws std::invalid_argument on malformed input.
+  explicit BigInteger(std::string_view decimal);
+
+  BigInteger& operator+=(const BigInteger& other);
+  BigInteger& operator-=(const BigInteger& other);
+  BigInteger& operator*=(const BigInteger& other);
+  // Division truncates toward zero, the remainder has the sign of the
+  // dividend, as for built-in integers. Throws std::domain_error on zero.
+  BigInteger& operator/=(const BigInteger& other);
+  BigInteger& operator%=(const BigInteger& other);
+
+  // *this += lhs * rhs and *this -= lhs * rhs.
+  BigInteger& add_product(const BigInteger& lhs, const BigInteger& rhs);
+  BigInteger& sub_product(const BigInteger& lhs, const BigInteger& rhs);
+
+  BigInteger operator-() const&;
+  BigInteger operator-() &&;
+  BigInteger operator+() const { return *this; }
+
+  BigInteger& operator++() { return *this += 1; }
+  BigInteger& operator--() { return *this -= 1; }
+  BigInteger operator++(int);
+  BigInteger operator--(int);
+
+  explicit operator bool() const { return !limbs_.empty(); }
+
+  bool is_zero() const { return limbs_.empty(); }
+  bool is_negative() const { return negative_; }
+  std::size_t limb_count() const { return limbs_.size(); }
+
+  // The magnitude, least significant limb first, without leading zeros.
+  std::span<const Limb> limbs() const { return limbs_; }
+  // The integer with the given magnitude and sign; leading zero limbs are
+  // dropped, and zero is never negative.
+  static BigInteger from_limbs(std::span<const Limb> limbs, bool negative);
+
+  std::string to_string() const;
+  static BigInteger from_string(std::string_view decimal);
+
+  // Writes the decimal representation into [first, last) like std::to_chars:
+  // on success returns the end of the written text, otherwise
+  // std::errc::value_too_large. decimal_length_bound() characters always fit.
+  std::to_chars_result to_chars(char* first, char* last) const;
+  std::size_t decimal_length_bound() const;
+
+  // Multiplies with the given algorithm at the top level; subproducts are
+  // chosen automatically but never above the requested tier. Used by the
+  // benchmarks to expose the crossover points between the tiers.
+  static BigInteger multiply(const BigInteger& lhs, const BigInteger& rhs,
+                             MulAlgorithm algorithm = MulAlgorithm::Auto);
+
+  // Computes quotient and remainder in one pass.
+  static void divmod(const BigInteger& dividend, const BigInteger& divisor,
+                     BigInteger& quotient, BigInteger& remainder);
+
+  friend bool operator==(const BigInteger&, const BigInteger&) = default;
+  friend std::strong_ordering operator<=>(const BigInteger& lhs,
+                                          const BigInteger& rhs);
+
+  // Streams the digits straight into `out` without building a std::string.
+  friend std::ostream& operator<<(std::ostream& out, const BigInteger& value);
+
+ private:
+  void normalize();
+  void accumulate_product(const BigInteger& lhs, const BigInteger& rhs,
+                          bool subtract);
+
+  std::vector<Limb> limbs_;
+  bool negative_ = false;
+};
+
+BigInteger operator+(const BigInteger& lhs, const BigInteger& rhs);
+BigInteger operator+(BigInteger&& lhs, const BigInteger& rhs);
+BigInteger operator+(const BigInteger& lhs, BigInteger&& rhs);
+BigInteger operator+(BigInteger&& lhs, BigInteger&& rhs);
+BigInteger operator-(const BigInteger& lhs, const BigInteger& rhs);
+BigInteger operator-(BigInteger&& lhs, const BigInteger& rhs);
+BigInteger operator-(const BigInteger& lhs, BigInteger&& rhs);
+BigInteger operator-(BigInteger&& lhs, BigInteger&& rhs);
+BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs);
+BigInteger operator/(const BigInteger& lhs, const BigInteger& rhs);
+BigInteger operator%(const BigInteger& lhs, const BigInteger& rhs);
+
+std::ostream& operator<<(std::ostream& out, const BigInteger& value);
+std::istream& operator>>(std::istream& in, BigInteger& value);
+
+BigInteger operator""_bi(const char* digits);
+BigInteger operator""_bi(const char* digits, std::size_t length);
@@ -0,0 +1,414 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "BigInteger/biginteger.h"
+#include "ThreadPool/threadpool.h"
+
+namespace {
+
+using Limb = BigInteger::Limb;
+using MulAlgorithm = BigInteger::MulAlgorithm;
+
+// A nonzero number of exactly `limbs` random limbs.
+BigInteger random_number(std::size_t limbs, unsigned seed, bool negative = false) {
+  std::mt19937 gen(seed);
+  std::vector<Limb> digits(limbs);
+  for (Limb& limb : digits) {
+    limb = static_cast<Limb>(gen());
+  }
+  digits.back() |= 1;
+  return BigInteger::from_limbs(digits, negative);
+}
+
+// (2^(32n) - 1)^2 = 2^(64n) - 2^(32n + 1) + 1: one, n - 1 zeros,
+// 0xFFFFFFFE and n - 1 limbs of ones.
+std::vector<Limb> all_ones_squared(std::size_t n) {
+  std::vector<Limb> limbs(2 * n, 0xFFFFFFFF);
+  limbs[0] = 1;
+  for (std::size_t i = 1; i < n; ++i) {
+    limbs[i] = 0;
+  }
+  limbs[n] = 0xFFFFFFFE;
+  return limbs;
+}
+
+const MulAlgorithm kAlgorithms[] = {MulAlgorithm::Schoolbook, MulAlgorithm::Karatsuba,
+                                    MulAlgorithm::Toom3, MulAlgorithm::Ntt,
+                                    MulAlgorithm::Auto};
+
+TEST(BigIntegerMultiply, SmallValuesMatchBuiltIn) {
+  std::mt19937_64 gen(7);
+  for (int i = 0; i < 1000; ++i) {
+    std::uint64_t a = gen() >> 32;
+    std::uint64_t b = gen() >> 32;
+    EXPECT_EQ(BigInteger(a) * BigInteger(b), BigInteger(a * b));
+  }
+  EXPECT_EQ(BigInteger(-6) * BigInteger(7), BigInteger(-42));
+  EXPECT_EQ(BigInteger(-6) * BigInteger(-7), BigInteger(42));
+}
+
+TEST(BigIntegerMultiply, ZeroIsNeverNegative) {
+  BigInteger negative = random_number(300, 1, true);
+  for (MulAlgorithm algorithm : kAlgorithms) {
+    BigInteger product = BigInteger::multiply(negative, BigInteger(), algorithm);
+    EXPECT_TRUE(product.is_zero());
+    EXPECT_FALSE(product.is_negative());
+  }
+}
+
+TEST(BigIntegerMultiply, EveryTierSquaresAllOnes) {
+  for (std::size_t n : {1u, 50u, 200u, 1500u}) {
+    std::vector<Limb> ones(n, 0xFFFFFFFF);
+    BigInteger value = BigInteger::from_limbs(ones, false);
+    BigInteger expected = BigInteger::from_limbs(all_ones_squared(n), false);
+    for (MulAlgorithm algorithm : kAlgorithms) {
+      EXPECT_EQ(BigInteger::multiply(value, value, algorithm), expected)
+          << "n = " << n << ", algorithm " << static_cast<int>(algorithm);
+    }
+  }
+}
+
+// Sizes on both sides of every crossover, so each tier hands subproducts
+// to the one below it.
+TEST(BigIntegerMultiply, TiersAgreeAroundThresholds) {
+  unsigned seed = 0;
+  for (std::size_t limbs : {2u, 39u, 40u, 41u, 159u, 160u, 161u, 1199u, 1200u, 1333u}) {
+    BigInteger lhs = random_number(limbs, ++seed);
+    BigInteger rhs = random_number(limbs, ++seed, true);
+    BigInteger expected = BigInteger::multiply(lhs, rhs, MulAlgorithm::Schoolbook);
+    EXPECT_TRUE(expected.is_negative());
+    EXPECT_GE(expected.limb_count() + 1, 2 * limbs);
+    for (MulAlgorithm algorithm : kAlgorithms) {
+      EXPECT_EQ(BigInteger::multiply(lhs, rhs, algorithm), expected)
+          << limbs << " limbs, algorithm " << static_cast<int>(algorithm);
+    }
+  }
+}
+
+TEST(BigIntegerMultiply, TiersAgreeOnUnbalancedOperands) {
+  const std::pair<std::size_t, std::size_t> kShapes[] = {{1, 3000}, {45, 2000}, {170, 2500},
+                                                         {1250, 4000}};
+  unsigned seed = 100;
+  for (auto [small, large] : kShapes) {
+    BigInteger lhs = random_number(small, ++seed);
+    BigInteger rhs = random_number(large, ++seed);
+    BigInteger expected = BigInteger::multiply(lhs, rhs, MulAlgorithm::Schoolbook);
+    for (MulAlgorithm algorithm : kAlgorithms) {
+      EXPECT_EQ(BigInteger::multiply(lhs, rhs, algorithm), expected);
+      EXPECT_EQ(BigInteger::multiply(rhs, lhs, algorithm), expected);
+    }
+  }
+}
+
+TEST(BigIntegerMultiply, CompoundAssignmentMatchesProduct) {
+  BigInteger lhs = random_number(700, 11);
+  BigInteger rhs = random_number(650, 12);
+  BigInteger product = lhs;
+  product *= rhs;
+  EXPECT_EQ(product, lhs * rhs);
+  BigInteger square = lhs;
+  square *= square;
+  EXPECT_EQ(square, BigInteger::multiply(lhs, lhs, MulAlgorithm::Schoolbook));
+}
+
+TEST(BigIntegerDivide, UndoesMultiplication) {
+  unsigned seed = 200;
+  for (auto [a, b] : {std::pair{1u, 1u}, {5u, 3u}, {80u, 40u}, {1500u, 1300u}, {3000u, 200u}}) {
+    BigInteger quotient = random_number(a, ++seed);
+    BigInteger divisor = random_number(b, ++seed);
+    BigInteger remainder = random_number(b, ++seed) / BigInteger(3);
+    if (remainder >= divisor) {
+      remainder = divisor - 1;
+    }
+    BigInteger dividend = quotient * divisor + remainder;
+    BigInteger q, r;
+    BigInteger::divmod(dividend, divisor, q, r);
+    EXPECT_EQ(q, quotient);
+    EXPECT_EQ(r, remainder);
+    EXPECT_EQ(dividend / divisor, quotient);
+    EXPECT_EQ(dividend % divisor, remainder);
+  }
+}
+
+TEST(BigIntegerDivide, TruncatesTowardZero) {
+  EXPECT_EQ(BigInteger(-7) / BigInteger(2), BigInteger(-3));
+  EXPECT_EQ(BigInteger(-7) % BigInteger(2), BigInteger(-1));
+  EXPECT_EQ(BigInteger(7) / BigInteger(-2), BigInteger(-3));
+  EXPECT_EQ(BigInteger(7) % BigInteger(-2), BigInteger(1));
+}
+
+TEST(BigIntegerDivide, ThrowsOnZero) {
+  EXPECT_THROW(BigInteger(5) / BigInteger(), std::domain_error);
+  EXPECT_THROW(BigInteger(5) % BigInteger(), std::domain_error);
+}
+
+// A decimal string of `length` random digits without leading zeros.
+std::string random_digits(std::size_t length, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> digit(0, 9);
+  std::string text(length, '0');
+  for (char& c : text) {
+    c = static_cast<char>('0' + digit(gen));
+  }
+  text[0] = '1';
+  return text;
+}
+
+BigInteger power_of_ten(std::size_t exponent) {
+  BigInteger result = 1;
+  BigInteger ten = 10;
+  for (; exponent != 0; exponent >>= 1) {
+    if (exponent & 1) {
+      result *= ten;
+    }
+    ten *= ten;
+  }
+  return result;
+}
+
+TEST(BigIntegerDecimal, KnownValues) {
+  EXPECT_EQ(BigInteger().to_string(), "0");
+  EXPECT_EQ(BigInteger(-1).to_string(), "-1");
+  EXPECT_EQ(BigInteger(std::uint64_t{1} << 63).to_string(), "9223372036854775808");
+  EXPECT_EQ((BigInteger(std::uint64_t{1} << 32) * BigInteger(std::uint64_t{1} << 32)).to_string(),
+            "18446744073709551616");
+  EXPECT_EQ(BigInteger("18446744073709551616"), BigInteger(std::uint64_t{1} << 63) * 2);
+  EXPECT_EQ(12345678901234567890_bi, BigInteger(std::uint64_t{12345678901234567890u}));
+  EXPECT_EQ("-42"_bi, BigInteger(-42));
+}
+
+// Powers of ten are a run of zeros in every chunk the conversion splits
+// off, so a chunk written without its zero padding shows up at once.
+TEST(BigIntegerDecimal, PowersOfTenKeepTheirZeros) {
+  for (std::size_t exponent : {1u, 8u, 9u, 10u, 18u, 19u, 100u, 1000u, 4607u, 4608u, 20000u}) {
+    std::string expected(exponent + 1, '0');
+    expected[0] = '1';
+    BigInteger value = power_of_ten(exponent);
+    EXPECT_EQ(value.to_string(), expected) << exponent;
+    EXPECT_EQ(BigInteger(expected), value) << exponent;
+    expected.back() = '1';
+    EXPECT_EQ((value + 1).to_string(), expected) << exponent;
+  }
+}
+
+TEST(BigIntegerDecimal, RoundTripsAcrossSplitLevels) {
+  unsigned seed = 300;
+  for (std::size_t length : {1u, 9u, 10u, 17u, 18u, 19u, 35u, 37u, 143u, 145u, 1151u, 1153u,
+                             9217u, 36865u}) {
+    std::string text = random_digits(length, ++seed);
+    BigInteger value(text);
+    EXPECT_EQ(value.to_string(), text) << length;
+    EXPECT_EQ(BigInteger("-" + text).to_string(), "-" + text) << length;
+  }
+}
+
+TEST(BigIntegerDecimal, RoundTripsThroughLimbs) {
+  for (std::size_t limbs : {1u, 3u, 31u, 64u, 500u, 3000u}) {
+    BigInteger value = random_number(limbs, static_cast<unsigned>(limbs), limbs % 2 == 1);
+    EXPECT_EQ(BigInteger(value.to_string()), value) << limbs;
+  }
+}
+
+// Large conversions multiply on ThreadPool::shared(), and a worker waiting
+// there runs other tasks. Every task converts ever larger numbers, so one
+// picked up that way grows the thread's table of powers under the
+// conversion in progress.
+TEST(BigIntegerDecimal, ConvertsInNestedPoolTasks) {
+  constexpr std::size_t kTasks = 24;
+  std::vector<int> wrong(kTasks);
+  ThreadPool::shared().parallel_for(
+      0, kTasks,
+      [&](std::size_t i) {
+        for (std::size_t length = 2000; length <= 128000; length *= 2) {
+          const std::string text = random_digits(length, static_cast<unsigned>(500 + i));
+          wrong[i] += BigInteger(text).to_string() != text;
+        }
+      },
+      1);
+  for (std::size_t i = 0; i < kTasks; ++i) {
+    EXPECT_EQ(wrong[i], 0) << i;
+  }
+}
+
+TEST(BigIntegerDecimal, AcceptsSignsAndLeadingZeros) {
+  EXPECT_EQ(BigInteger("+17"), BigInteger(17));
+  EXPECT_EQ(BigInteger("0000000000000000000000017"), BigInteger(17));
+  EXPECT_EQ(BigInteger("-000"), BigInteger());
+  EXPECT_FALSE(BigInteger("-0").is_negative());
+  EXPECT_EQ(BigInteger("-0").to_string(), "0");
+  std::string padded = std::string(5000, '0') + "123456789123456789";
+  EXPECT_EQ(BigInteger(padded).to_string(), "123456789123456789");
+}
+
+TEST(BigIntegerDecimal, RejectsMalformedInput) {
+  for (const char* text : {"", "-", "+", "12a", " 1", "1 ", "1.0", "--1", "0x10"}) {
+    EXPECT_THROW(BigInteger::from_string(text), std::invalid_argument) << '"' << text << '"';
+  }
+  std::string long_text = random_digits(5000, 1);
+  long_text[2500] = '/';
+  EXPECT_THROW(BigInteger::from_string(long_text), std::invalid_argument);
+}
+
+TEST(BigIntegerDecimal, ToCharsReportsShortBuffers) {
+  BigInteger value = -BigInteger(random_digits(3000, 2));
+  std::string buffer(value.decimal_length_bound(), '\0');
+  auto [end, error] = value.to_chars(buffer.data(), buffer.data() + buffer.size());
+  ASSERT_EQ(error, std::errc{});
+  std::size_t length = static_cast<std::size_t>(end - buffer.data());
+  EXPECT_EQ(std::string_view(buffer.data(), length), value.to_string());
+
+  std::string exact(length, '\0');
+  EXPECT_EQ(value.to_chars(exact.data(), exact.data() + length).ec, std::errc{});
+  EXPECT_EQ(exact, value.to_string());
+  EXPECT_EQ(value.to_chars(exact.data(), exact.data() + length - 1).ec,
+            std::errc::value_too_large);
+}
+
+TEST(BigIntegerDecimal, Streams) {
+  BigInteger value = BigInteger(random_digits(2000, 3)) * -1;
+  std::ostringstream out;
+  out << value << ' ' << BigInteger();
+  EXPECT_EQ(out.str(), value.to_string() + " 0");
+
+  std::istringstream in(out.str() + " 12x");
+  BigInteger first;
+  BigInteger second;
+  BigInteger third = 5;
+  EXPECT_TRUE(in >> first >> second);
+  EXPECT_EQ(first, value);
+  EXPECT_EQ(second, BigInteger());
+  EXPECT_FALSE(in >> third);
+  EXPECT_EQ(third, BigInteger(5));
+}
+
+// Every operand mix of + and - against the overloads on const&, which copy.
+TEST(BigIntegerArithmetic, TemporariesGiveTheSameResults) {
+  unsigned seed = 500;
+  for (auto [a, b] : {std::pair{1u, 1u}, {3u, 1u}, {1u, 3u}, {50u, 50u}, {200u, 7u}}) {
+    for (bool a_negative : {false, true}) {
+      for (bool b_negative : {false, true}) {
+        const BigInteger x = random_number(a, ++seed, a_negative);
+        const BigInteger y = random_number(b, ++seed, b_negative);
+        const BigInteger sum = x + y;
+        const BigInteger difference = x - y;
+        EXPECT_EQ(BigInteger(x) + y, sum);
+        EXPECT_EQ(x + BigInteger(y), sum);
+        EXPECT_EQ(BigInteger(x) + BigInteger(y), sum);
+        EXPECT_EQ(BigInteger(x) - y, difference);
+        EXPECT_EQ(x - BigInteger(y), difference);
+        EXPECT_EQ(BigInteger(x) - BigInteger(y), difference);
+        EXPECT_EQ(-BigInteger(x), BigInteger() - x);
+        EXPECT_EQ(BigInteger(x) - x, BigInteger());
+        EXPECT_FALSE((x - BigInteger(x)).is_negative());
+      }
+    }
+  }
+  EXPECT_FALSE((-BigInteger()).is_negative());
+}
+
+TEST(BigIntegerArithmetic, ChainsReuseTheLimbsOfTemporaries) {
+  // a's top limb leaves room for the carries, so no limb is added.
+  std::vector<Limb> digits(20, 0x9E3779B9);
+  digits.back() = 1;
+  const BigInteger a = BigInteger::from_limbs(digits, false);
+  const BigInteger b = random_number(3, 2);
+  const BigInteger c = random_number(4, 3);
+  const BigInteger d = random_number(5, 4);
+
+  BigInteger sum = a;
+  const Limb* limbs = sum.limbs().data();
+  BigInteger result = std::move(sum) + b - c + d;
+  EXPECT_EQ(result.limbs().data(), limbs);
+  EXPECT_EQ(result, a + b - c + d);
+
+  BigInteger right = a;
+  limbs = right.limbs().data();
+  result = b + std::move(right);
+  EXPECT_EQ(result.limbs().data(), limbs);
+  EXPECT_EQ(result, a + b);
+
+  BigInteger negated = a;
+  limbs = negated.limbs().data();
+  result = -std::move(negated);
+  EXPECT_EQ(result.limbs().data(), limbs);
+  EXPECT_EQ(result, BigInteger() - a);
+}
+
+TEST(BigIntegerArithmetic, TemporariesMayBeBothOperands) {
+  const BigInteger x = random_number(30, 5, true);
+  BigInteger twice = x;
+  twice = std::move(twice) + std::move(twice);
+  EXPECT_EQ(twice, x * 2);
+  BigInteger none = x;
+  none = std::move(none) - std::move(none);
+  EXPECT_EQ(none, BigInteger());
+  EXPECT_FALSE(none.is_negative());
+}
+
+// acc + x * y and acc - x * y with every sign, products shorter and longer
+// than acc, and operands on both sides of the schoolbook tier.
+TEST(BigIntegerArithmetic, AddProductMatchesTheProduct) {
+  unsigned seed = 700;
+  const std::size_t kSizes[][3] = {{0, 1, 1},  {1, 1, 1},   {8, 2, 3},   {2, 8, 9},
+                                   {3, 39, 2}, {60, 39, 45}, {10, 40, 41}, {90, 45, 70}};
+  for (const auto& [acc_limbs, x_limbs, y_limbs] : kSizes) {
+    for (int signs = 0; signs < 8; ++signs) {
+      const BigInteger start =
+          acc_limbs == 0 ? BigInteger() : random_number(acc_limbs, ++seed, signs & 1);
+      const BigInteger x = random_number(x_limbs, ++seed, signs & 2);
+      const BigInteger y = random_number(y_limbs, ++seed, signs & 4);
+      BigInteger acc = start;
+      EXPECT_EQ(acc.add_product(x, y), start + x * y) << acc_limbs << " " << signs;
+      acc = start;
+      EXPECT_EQ(acc.sub_product(x, y), start - x * y) << acc_limbs << " " << signs;
+    }
+  }
+}
+
+TEST(BigIntegerArithmetic, AddProductOfZeroAndOfItself) {
+  const BigInteger x = random_number(6, 1, true);
+  const BigInteger y = random_number(9, 2);
+  BigInteger acc = x;
+  EXPECT_EQ(acc.add_product(BigInteger(), y), x);
+  EXPECT_EQ(acc.sub_product(y, 0), x);
+
+  acc = x * y;
+  acc.sub_product(x, y);
+  EXPECT_EQ(acc, BigInteger());
+  EXPECT_FALSE(acc.is_negative());
+
+  acc = x;
+  EXPECT_EQ(acc.add_product(acc, y), x + x * y);
+  acc = x;
+  EXPECT_EQ(acc.sub_product(y, acc), x - y * x);
+  acc = x;
+  EXPECT_EQ(acc.add_product(acc, acc), x + x * x);
+}
+
+TEST(BigIntegerArithmetic, DotProductsAccumulateInPlace) {
+  std::vector<BigInteger> lhs;
+  std::vector<BigInteger> rhs;
+  for (unsigned i = 0; i < 64; ++i) {
+    lhs.push_back(random_number(4, 2 * i, i % 3 == 0));
+    rhs.push_back(random_number(4, 2 * i + 1, i % 5 == 0));
+  }
+  BigInteger expected;
+  BigInteger dot;
+  for (std::size_t i = 0; i < lhs.size(); ++i) {
+    expected = expected + lhs[i] * rhs[i];
+    dot.add_product(lhs[i], rhs[i]);
+  }
+  EXPECT_EQ(dot, expected);
+}
+
+}  // namespace
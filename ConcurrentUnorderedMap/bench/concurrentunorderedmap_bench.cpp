@@ -0,0 +1,110 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+
+#include "ConcurrentUnorderedMap/concurrentunorderedmap.h"
+#include "UnorderedMap/unorderedmap.h"
+
+namespace {
+
+constexpr std::uint64_t kKeys = 1 << 16;
+
+// What the sharded map replaces: one table behind one mutex.
+struct LockedMap {
+  std::mutex mutex;
+  UnorderedMap<std::uint64_t, std::uint64_t> map;
+};
+
+LockedMap& locked_map() {
+  static LockedMap* map = [] {
+    auto* result = new LockedMap;
+    for (std::uint64_t key = 0; key < kKeys; ++key) {
+      result->map[key] = key;
+    }
+    return result;
+  }();
+  return *map;
+}
+
+ConcurrentUnorderedMap<std::uint64_t, std::uint64_t>& sharded_map() {
+  static auto* map = [] {
+    auto* result = new ConcurrentUnorderedMap<std::uint64_t, std::uint64_t>;
+    for (std::uint64_t key = 0; key < kKeys; ++key) {
+      result->try_emplace(key, key);
+    }
+    return result;
+  }();
+  return *map;
+}
+
+// Nine lookups to one increment, from every benchmark thread.
+
+void BM_GlobalMutexMixed(benchmark::State& state) {
+  LockedMap& shared = locked_map();
+  std::mt19937_64 random(static_cast<std::uint64_t>(state.thread_index()));
+  for (auto _ : state) {
+    const std::uint64_t key = random() % kKeys;
+    std::lock_guard lock(shared.mutex);
+    if (key % 10 == 0) {
+      ++shared.map[key];
+    } else {
+      auto it = shared.map.find(key);
+      benchmark::DoNotOptimize(it->second);
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ShardedMixed(benchmark::State& state) {
+  auto& shared = sharded_map();
+  std::mt19937_64 random(static_cast<std::uint64_t>(state.thread_index()));
+  for (auto _ : state) {
+    const std::uint64_t key = random() % kKeys;
+    if (key % 10 == 0) {
+      shared.visit(key, [](std::uint64_t& value) { ++value; });
+    } else {
+      shared.cvisit(key, [](const std::uint64_t& value) { benchmark::DoNotOptimize(value); });
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Sums every value, one shard after another against all shards at once.
+void BM_ForEach(benchmark::State& state) {
+  auto& shared = sharded_map();
+  for (auto _ : state) {
+    std::uint64_t sum = 0;
+    shared.for_each([&sum](std::uint64_t, std::uint64_t value) { sum += value; });
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(kKeys));
+}
+
+void BM_ForEachShard(benchmark::State& state) {
+  const auto& shared = sharded_map();
+  for (auto _ : state) {
+    std::atomic<std::uint64_t> sum{0};
+    shared.for_each_shard([&sum](const auto& shard) {
+      std::uint64_t local = 0;
+      for (const auto& [key, value] : shard) {
+        local += value;
+      }
+      sum.fetch_add(local, std::memory_order_relaxed);
+    });
+    benchmark::DoNotOptimize(sum.load());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(kKeys));
+}
+
+}  // namespace
+
+BENCHMARK(BM_GlobalMutexMixed)->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK(BM_ShardedMixed)->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK(BM_ForEach);
+BENCHMARK(BM_ForEachShard);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,319 @@
+#pragma once
+
+// A hash map for many threads: UnorderedMap split into shards by hash.
+//
+// The top bits of the mixed hash pick a shard and the shard's own table
+// uses the low bits, so the two never correlate. Every shard is an
+// UnorderedMap behind a reader-writer lock on a cache line of its own:
+// threads touching different shards never share a line, lookups in one
+// shard run in parallel and only writers to the same shard wait for each
+// other. With a few shards per thread, the default, two threads rarely
+// meet at all.
+//
+// Nothing hands out references or iterators, since another thread may
+// rehash the shard right after the lock is released. Lookups copy the value
+// out (get) or run a function on it under the lock (visit, cvisit), the
+// same for updates (insert_or_visit). The functions must not call back into
+// the map. visit takes the shard exclusively and may modify the value;
+// cvisit, and visit on a const map, take it shared.
+//
+// for_each_shard runs a function on every shard's UnorderedMap in parallel
+// on a ThreadPool, each under its shard's lock; for_each visits all
+// elements one shard after another. size() and the other whole-map
+// operations lock the shards one at a time, so they reflect a consistent
+// state only when no other thread is writing.
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "ThreadPool/threadpool.h"
+#include "UnorderedMap/unorderedmap.h"
+
+namespace concurrentmap_detail {
+
+// Assumed rather than std::hardware_destructive_interference_size, whose
+// value GCC warns may differ between compiler flags.
+inline constexpr std::size_t kCacheLine = 64;
+
+template <typename Map>
+struct alignas(kCacheLine) Shard {
+  mutable std::shared_mutex mutex;
+  Map map;
+};
+
+}  // namespace concurrentmap_detail
+
+template <typename K, typename V,
+          typename Hash = unorderedmap_detail::DefaultHash<K>,
+          typename KeyEqual = unorderedmap_detail::DefaultEqual<K>,
+          typename Allocator = std::allocator<std::pair<const K, V>>>
+class ConcurrentUnorderedMap {
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<const K, V>;
+  using size_type = std::size_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using allocator_type = Allocator;
+  using shard_type = UnorderedMap<K, V, Hash, KeyEqual, Allocator>;
+
+  // shards is rounded up to a power of two. Throws std::invalid_argument if
+  // it is zero.
+  explicit ConcurrentUnorderedMap(size_type shards = default_shards(), const Hash& hash = Hash(),
+                                  const KeyEqual& equal = KeyEqual(),
+                                  const Allocator& alloc = Allocator())
+      : hash_(hash) {
+    if (shards == 0) {
+      throw std::invalid_argument("ConcurrentUnorderedMap: shard count must be positive");
+    }
+    shard_count_ = std::bit_ceil(shards);
+    shard_bits_ = static_cast<unsigned>(std::countr_zero(shard_count_));
+    shards_ = std::make_unique<Shard[]>(shard_count_);
+    for (size_type i = 0; i < shard_count_; ++i) {
+      shards_[i].map = shard_type(0, hash, equal, alloc);
+    }
+  }
+
+  ConcurrentUnorderedMap(const ConcurrentUnorderedMap&) = delete;
+  ConcurrentUnorderedMap& operator=(const ConcurrentUnorderedMap&) = delete;
+
+  // Four shards per hardware thread.
+  static size_type default_shards() noexcept {
+    return std::bit_ceil(4 * std::max<size_type>(1, std::thread::hardware_concurrency()));
+  }
+
+  size_type shard_count() const noexcept { return shard_count_; }
+  hasher hash_function() const { return hash_; }
+
+  size_type size() const {
+    size_type total = 0;
+    for (size_type i = 0; i < shard_count_; ++i) {
+      std::shared_lock lock(shards_[i].mutex);
+      total += shards_[i].map.size();
+    }
+    return total;
+  }
+  bool empty() const { return size() == 0; }
+
+  void clear() {
+    for (size_type i = 0; i < shard_count_; ++i) {
+      std::unique_lock lock(shards_[i].mutex);
+      shards_[i].map.clear();
+    }
+  }
+
+  // Room for count elements spread evenly over the shards.
+  void reserve(size_type count) {
+    const size_type per_shard = (count + shard_count_ - 1) / shard_count_;
+    for (size_type i = 0; i < shard_count_; ++i) {
+      std::unique_lock lock(shards_[i].mutex);
+      shards_[i].map.reserve(per_shard);
+    }
+  }
+
+  // Lookup, under the shard's shared lock.
+
+  bool contains(const K& key) const {
+    const size_type hash = hash_(key);
+    const Shard& shard = shard_for(hash);
+    std::shared_lock lock(shard.mutex);
+    return shard.map.contains(key, hash);
+  }
+  size_type count(const K& key) const { return contains(key) ? 1 : 0; }
+
+  std::optional<V> get(const K& key) const {
+    const size_type hash = hash_(key);
+    const Shard& shard = shard_for(hash);
+    std::shared_lock lock(shard.mutex);
+    auto it = shard.map.find(key, hash);
+    if (it == shard.map.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  // f(const V&) on the value of key if there is one; returns whether.
+  template <typename F>
+  bool cvisit(const K& key, F&& f) const {
+    const size_type hash = hash_(key);
+    const Shard& shard = shard_for(hash);
+    std::shared_lock lock(shard.mutex);
+    auto it = shard.map.find(key, hash);
+    if (it == shard.map.end()) {
+      return false;
+    }
+    std::invoke(std::forward<F>(f), std::as_const(it->second));
+    return true;
+  }
+  template <typename F>
+  bool visit(const K& key, F&& f) const {
+    return cvisit(key, std::forward<F>(f));
+  }
+
+  // f(V&) on the value of key under the exclusive lock.
+  template <typename F>
+  bool visit(const K& key, F&& f) {
+    const size_type hash = hash_(key);
+    Shard& shard = shard_for(hash);
+    std::unique_lock lock(shard.mutex);
+    auto it = shard.map.find(key, hash);
+    if (it == shard.map.end()) {
+      return false;
+    }
+    std::invoke(std::forward<F>(f), it->second);
+    return true;
+  }
+
+  // Modification, under the shard's exclusive lock. Each returns whether
+  // an element was inserted.
+
+  bool insert(const value_type& value) { return try_emplace(value.first, value.second); }
+  bool insert(value_type&& value) { return try_emplace(value.first, std::move(value.second)); }
+  template <typename P>
+    requires std::is_constructible_v<std::pair<K, V>, P&&>
+  bool insert(P&& value) {
+    std::pair<K, V> pair(std::forward<P>(value));
+    return try_emplace(std::move(pair.first), std::move(pair.second));
+  }
+
+  template <typename... Args>
+  bool try_emplace(const K& key, Args&&... args) {
+    return emplace_impl(key, std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  bool try_emplace(K&& key, Args&&... args) {
+    return emplace_impl(std::move(key), std::forward<Args>(args)...);
+  }
+
+  template <typename M>
+  bool insert_or_assign(const K& key, M&& value) {
+    return insert_or_assign_impl(key, std::forward<M>(value));
+  }
+  template <typename M>
+  bool insert_or_assign(K&& key, M&& value) {
+    return insert_or_assign_impl(std::move(key), std::forward<M>(value));
+  }
+
+  // Inserts key with value, or runs f(V&) on the value already there:
+  //   counts.insert_or_visit(word, 1, [](int& n) { ++n; });
+  template <typename M, typename F>
+  bool insert_or_visit(const K& key, M&& value, F&& f) {
+    return insert_or_visit_impl(key, std::forward<M>(value), std::forward<F>(f));
+  }
+  template <typename M, typename F>
+  bool insert_or_visit(K&& key, M&& value, F&& f) {
+    return insert_or_visit_impl(std::move(key), std::forward<M>(value), std::forward<F>(f));
+  }
+
+  size_type erase(const K& key) {
+    const size_type hash = hash_(key);
+    Shard& shard = shard_for(hash);
+    std::unique_lock lock(shard.mutex);
+    auto it = shard.map.find(key, hash);
+    if (it == shard.map.end()) {
+      return 0;
+    }
+    shard.map.erase(it);
+    return 1;
+  }
+
+  // Whole-map traversal.
+
+  // f(const shard_type&) for every shard, in parallel on pool, each under
+  // its shared lock. f must be safe to call from several threads at once.
+  template <typename F>
+  void for_each_shard(F&& f, ThreadPool& pool = ThreadPool::shared()) const {
+    pool.parallel_for(
+        0, shard_count_,
+        [this, &f](size_type i) {
+          std::shared_lock lock(shards_[i].mutex);
+          f(std::as_const(shards_[i].map));
+        },
+        1);
+  }
+
+  // f(shard_type&) for every shard, as above with the exclusive locks.
+  template <typename F>
+  void for_each_shard(F&& f, ThreadPool& pool = ThreadPool::shared()) {
+    pool.parallel_for(
+        0, shard_count_,
+        [this, &f](size_type i) {
+          std::unique_lock lock(shards_[i].mutex);
+          f(shards_[i].map);
+        },
+        1);
+  }
+
+  // f(const K&, const V&) for every element, on the calling thread.
+  template <typename F>
+  void for_each(F&& f) const {
+    for (size_type i = 0; i < shard_count_; ++i) {
+      std::shared_lock lock(shards_[i].mutex);
+      for (const auto& [key, value] : shards_[i].map) {
+        f(key, value);
+      }
+    }
+  }
+
+ private:
+  using Shard = concurrentmap_detail::Shard<shard_type>;
+
+  // The top shard_bits_ bits of the hash as the shard map mixes it.
+  size_type shard_index(size_type hash) const noexcept {
+    const size_type mixed = unorderedmap_detail::mix(hash);
+    return shard_bits_ == 0 ? 0 : mixed >> (std::numeric_limits<size_type>::digits - shard_bits_);
+  }
+  Shard& shard_for(size_type hash) noexcept { return shards_[shard_index(hash)]; }
+  const Shard& shard_for(size_type hash) const noexcept { return shards_[shard_index(hash)]; }
+
+  // The key is hashed once, outside the lock, for the shard and its table.
+  template <typename KeyArg, typename... Args>
+  bool emplace_impl(KeyArg&& key, Args&&... args) {
+    const size_type hash = hash_(key);
+    Shard& shard = shard_for(hash);
+    std::unique_lock lock(shard.mutex);
+    return shard.map
+        .try_emplace_hashed(std::forward<KeyArg>(key), hash, std::forward<Args>(args)...)
+        .second;
+  }
+
+  template <typename KeyArg, typename M>
+  bool insert_or_assign_impl(KeyArg&& key, M&& value) {
+    const size_type hash = hash_(key);
+    Shard& shard = shard_for(hash);
+    std::unique_lock lock(shard.mutex);
+    return shard.map
+        .insert_or_assign_hashed(std::forward<KeyArg>(key), hash, std::forward<M>(value))
+        .second;
+  }
+
+  template <typename KeyArg, typename M, typename F>
+  bool insert_or_visit_impl(KeyArg&& key, M&& value, F&& f) {
+    const size_type hash = hash_(key);
+    Shard& shard = shard_for(hash);
+    std::unique_lock lock(shard.mutex);
+    auto [it, inserted] =
+        shard.map.try_emplace_hashed(std::forward<KeyArg>(key), hash, std::forward<M>(value));
+    if (!inserted) {
+      std::invoke(std::forward<F>(f), it->second);
+    }
+    return inserted;
+  }
+
+  std::unique_ptr<Shard[]> shards_;
+  size_type shard_count_ = 0;
+  unsigned shard_bits_ = 0;
+  [[no_unique_address]] Hash hash_;
+};
@@ -0,0 +1,239 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ConcurrentUnorderedMap/concurrentunorderedmap.h"
+
+namespace {
+
+// Counts its calls, to show that every operation hashes the key once.
+struct CountingHash {
+  static inline std::atomic<int> calls = 0;
+  std::size_t operator()(int key) const {
+    ++calls;
+    return static_cast<std::size_t>(key) * 31;
+  }
+};
+
+static_assert(alignof(concurrentmap_detail::Shard<UnorderedMap<int, int>>) ==
+              concurrentmap_detail::kCacheLine);
+
+TEST(ConcurrentUnorderedMap, RoundsTheShardCountUp) {
+  EXPECT_EQ((ConcurrentUnorderedMap<int, int>(1).shard_count()), 1u);
+  EXPECT_EQ((ConcurrentUnorderedMap<int, int>(5).shard_count()), 8u);
+  EXPECT_EQ((ConcurrentUnorderedMap<int, int>(64).shard_count()), 64u);
+  EXPECT_THROW((ConcurrentUnorderedMap<int, int>(0)), std::invalid_argument);
+
+  const std::size_t shards = ConcurrentUnorderedMap<int, int>::default_shards();
+  EXPECT_TRUE(std::has_single_bit(shards));
+  EXPECT_GE(shards, 4 * std::max(1u, std::thread::hardware_concurrency()));
+  EXPECT_EQ((ConcurrentUnorderedMap<int, int>().shard_count()), shards);
+}
+
+TEST(ConcurrentUnorderedMap, InsertsLooksUpAndErases) {
+  ConcurrentUnorderedMap<std::string, int> map(4);
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.insert({"one", 1}));
+  EXPECT_FALSE(map.insert({"one", 10}));
+  const std::pair<const std::string, int> five{"five", 5};
+  EXPECT_TRUE(map.insert(five));
+  EXPECT_FALSE(map.insert(std::pair<std::string, int>("five", 50)));
+  EXPECT_EQ(map.erase("five"), 1u);
+  EXPECT_TRUE(map.try_emplace("two", 2));
+  EXPECT_FALSE(map.try_emplace("two", 20));
+  EXPECT_TRUE(map.insert_or_assign("three", 3));
+  EXPECT_FALSE(map.insert_or_assign("three", 30));
+  const std::string four = "four";
+  EXPECT_TRUE(map.try_emplace(four, 4));
+  EXPECT_FALSE(map.insert_or_assign(four, 40));
+
+  EXPECT_EQ(map.size(), 4u);
+  EXPECT_EQ(map.get("one"), 1);
+  EXPECT_EQ(map.get("two"), 2);
+  EXPECT_EQ(map.get("three"), 30);
+  EXPECT_EQ(map.get("four"), 40);
+  EXPECT_EQ(map.get("five"), std::nullopt);
+  EXPECT_TRUE(map.contains("one"));
+  EXPECT_EQ(map.count("five"), 0u);
+
+  EXPECT_EQ(map.erase("one"), 1u);
+  EXPECT_EQ(map.erase("one"), 0u);
+  EXPECT_FALSE(map.contains("one"));
+  EXPECT_EQ(map.size(), 3u);
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.get("two"), std::nullopt);
+}
+
+TEST(ConcurrentUnorderedMap, VisitsValuesInPlace) {
+  ConcurrentUnorderedMap<int, std::string> map(8);
+  map.try_emplace(1, "a");
+  EXPECT_TRUE(map.visit(1, [](std::string& value) { value += "b"; }));
+  EXPECT_FALSE(map.visit(2, [](std::string&) { FAIL(); }));
+
+  std::string seen;
+  EXPECT_TRUE(map.cvisit(1, [&](const std::string& value) { seen = value; }));
+  EXPECT_EQ(seen, "ab");
+  const auto& constant = map;
+  EXPECT_TRUE(constant.visit(1, [&](const std::string& value) { seen = value + "!"; }));
+  EXPECT_EQ(seen, "ab!");
+  EXPECT_FALSE(constant.visit(2, [](const std::string&) { FAIL(); }));
+
+  EXPECT_TRUE(map.insert_or_visit(3, "c", [](std::string&) { FAIL(); }));
+  EXPECT_FALSE(map.insert_or_visit(3, "ignored", [](std::string& value) { value += "d"; }));
+  EXPECT_EQ(map.get(3), "cd");
+}
+
+TEST(ConcurrentUnorderedMap, HashesEachKeyOnce) {
+  ConcurrentUnorderedMap<int, std::string, CountingHash> map(8);
+  map.reserve(4000);
+  CountingHash::calls = 0;
+  for (int key = 0; key < 1000; ++key) {
+    ASSERT_TRUE(map.try_emplace(key, "x"));
+  }
+  EXPECT_EQ(CountingHash::calls, 1000);
+
+  CountingHash::calls = 0;
+  for (int key = 0; key < 1000; ++key) {
+    ASSERT_FALSE(map.insert_or_assign(key, std::to_string(key)));
+    ASSERT_FALSE(map.insert_or_visit(key, "z", [](std::string& value) { value += "!"; }));
+    ASSERT_TRUE(map.contains(key));
+    ASSERT_TRUE(map.get(key).has_value());
+    ASSERT_TRUE(map.visit(key, [](std::string&) {}));
+  }
+  EXPECT_EQ(CountingHash::calls, 5000);
+  EXPECT_EQ(map.get(7), "7!");
+
+  CountingHash::calls = 0;
+  for (int key = 0; key < 1000; ++key) {
+    ASSERT_EQ(map.erase(key), 1u);
+  }
+  EXPECT_EQ(CountingHash::calls, 1000);
+}
+
+TEST(ConcurrentUnorderedMap, SpreadsKeysOverTheShards) {
+  ConcurrentUnorderedMap<int, int> map(16);
+  for (int key = 0; key < 10000; ++key) {
+    map.try_emplace(key, key);
+  }
+  std::mutex mutex;
+  std::vector<std::size_t> sizes;
+  std::map<int, int> seen;
+  ThreadPool pool(4);
+  map.for_each_shard(
+      [&](const UnorderedMap<int, int>& shard) {
+        std::lock_guard lock(mutex);
+        sizes.push_back(shard.size());
+        for (const auto& [key, value] : shard) {
+          EXPECT_TRUE(seen.emplace(key, value).second) << key;
+        }
+      },
+      pool);
+  ASSERT_EQ(sizes.size(), 16u);
+  for (std::size_t size : sizes) {
+    EXPECT_GT(size, 10000u / 16 / 2);
+    EXPECT_LT(size, 10000u / 16 * 2);
+  }
+  EXPECT_EQ(seen.size(), 10000u);
+}
+
+TEST(ConcurrentUnorderedMap, UpdatesEveryShardInParallel) {
+  ConcurrentUnorderedMap<int, int> map(32);
+  for (int key = 0; key < 5000; ++key) {
+    map.try_emplace(key, key);
+  }
+  std::atomic<int> shards = 0;
+  map.for_each_shard([&](UnorderedMap<int, int>& shard) {
+    ++shards;
+    for (auto& [key, value] : shard) {
+      value = -key;
+    }
+  });
+  EXPECT_EQ(shards, 32);
+
+  long long sum = 0;
+  std::size_t count = 0;
+  map.for_each([&](const int& key, const int& value) {
+    EXPECT_EQ(value, -key);
+    sum += key;
+    ++count;
+  });
+  EXPECT_EQ(count, 5000u);
+  EXPECT_EQ(sum, 4999LL * 5000 / 2);
+}
+
+TEST(ConcurrentUnorderedMap, CountsFromManyThreads) {
+  ConcurrentUnorderedMap<int, int> map(8);
+  constexpr int kThreads = 8;
+  constexpr int kKeys = 1000;
+  constexpr int kRounds = 20;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&map, t] {
+      for (int round = 0; round < kRounds; ++round) {
+        for (int i = 0; i < kKeys; ++i) {
+          const int key = (i * 7 + t * 13) % kKeys;
+          map.insert_or_visit(key, 1, [](int& count) { ++count; });
+        }
+      }
+    });
+  }
+  // Readers alongside the writers only ever see counts that were written.
+  std::thread reader([&map] {
+    for (int round = 0; round < 50; ++round) {
+      for (int key = 0; key < kKeys; ++key) {
+        if (auto count = map.get(key)) {
+          ASSERT_GE(*count, 1);
+          ASSERT_LE(*count, kThreads * kRounds);
+        }
+      }
+    }
+  });
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  reader.join();
+  ASSERT_EQ(map.size(), static_cast<std::size_t>(kKeys));
+  for (int key = 0; key < kKeys; ++key) {
+    ASSERT_EQ(map.get(key), kThreads * kRounds) << key;
+  }
+}
+
+TEST(ConcurrentUnorderedMap, InsertsAndErasesFromManyThreads) {
+  ConcurrentUnorderedMap<int, std::string> map(4);
+  constexpr int kThreads = 6;
+  constexpr int kPerThread = 5000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&map, t] {
+      // Each thread owns its keys, so the outcome of each call is known.
+      for (int i = 0; i < kPerThread; ++i) {
+        const int key = t * kPerThread + i;
+        ASSERT_TRUE(map.try_emplace(key, std::to_string(key)));
+        if (i % 2 == 1) {
+          ASSERT_EQ(map.erase(key - 1), 1u);
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(map.size(), static_cast<std::size_t>(kThreads * kPerThread / 2));
+  for (int key = 0; key < kThreads * kPerThread; ++key) {
+    ASSERT_EQ(map.get(key), key % 2 == 1 ? std::optional(std::to_string(key)) : std::nullopt);
+  }
+}
+
+}  // namespace
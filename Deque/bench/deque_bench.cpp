@@ -0,0 +1,147 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "Deque/deque.h"
+
+namespace {
+
+// A cache line sized payload, to show the effect of the per-type block size.
+struct Wide {
+  Wide() = default;
+  explicit Wide(std::int64_t value) : head(value) {}
+
+  std::int64_t head = 0;
+  std::int64_t tail[7] = {};
+};
+
+template <typename T>
+T make(std::int64_t value) {
+  return T(value);
+}
+
+template <typename T>
+std::int64_t key(const T& value) {
+  if constexpr (std::is_same_v<T, Wide>) {
+    return value.head;
+  } else {
+    return value;
+  }
+}
+
+// Fills a container of state.range(0) elements from the back.
+template <typename Container>
+void BM_PushBack(benchmark::State& state) {
+  using T = typename Container::value_type;
+  auto count = static_cast<std::int64_t>(state.range(0));
+  for (auto _ : state) {
+    Container container;
+    for (std::int64_t i = 0; i < count; ++i) {
+      container.push_back(make<T>(i));
+    }
+    benchmark::DoNotOptimize(&container.back());
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * count);
+}
+
+// Fills a container of state.range(0) elements from the front.
+template <typename Container>
+void BM_PushFront(benchmark::State& state) {
+  using T = typename Container::value_type;
+  auto count = static_cast<std::int64_t>(state.range(0));
+  for (auto _ : state) {
+    Container container;
+    for (std::int64_t i = 0; i < count; ++i) {
+      container.push_front(make<T>(i));
+    }
+    benchmark::DoNotOptimize(&container.front());
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * count);
+}
+
+// Reads random positions of a container of state.range(0) elements.
+template <typename Container>
+void BM_RandomAccess(benchmark::State& state) {
+  using T = typename Container::value_type;
+  auto count = static_cast<std::size_t>(state.range(0));
+  Container container;
+  for (std::size_t i = 0; i < count; ++i) {
+    container.push_back(make<T>(static_cast<std::int64_t>(i)));
+  }
+  std::mt19937 gen(7);
+  std::vector<std::size_t> positions(4096);
+  for (std::size_t& position : positions) {
+    position = gen() % count;
+  }
+  for (auto _ : state) {
+    std::int64_t sum = 0;
+    for (std::size_t position : positions) {
+      sum += key(container[position]);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(positions.size()));
+}
+
+// Sums a container of state.range(0) elements through its iterators.
+template <typename Container>
+void BM_Iterate(benchmark::State& state) {
+  using T = typename Container::value_type;
+  auto count = static_cast<std::int64_t>(state.range(0));
+  Container container;
+  for (std::int64_t i = 0; i < count; ++i) {
+    container.push_back(make<T>(i));
+  }
+  for (auto _ : state) {
+    std::int64_t sum = 0;
+    for (const T& value : container) {
+      sum += key(value);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * count);
+}
+
+// Work queue: keeps state.range(0) elements in flight, each step pushes one
+// at the back and pops one from the front, so the contents drift through
+// the block map.
+template <typename Container>
+void BM_RingQueue(benchmark::State& state) {
+  using T = typename Container::value_type;
+  auto depth = static_cast<std::int64_t>(state.range(0));
+  Container container;
+  for (std::int64_t i = 0; i < depth; ++i) {
+    container.push_back(make<T>(i));
+  }
+  std::int64_t next = depth;
+  for (auto _ : state) {
+    for (int step = 0; step < 1024; ++step) {
+      container.push_back(make<T>(next++));
+      benchmark::DoNotOptimize(&container.front());
+      container.pop_front();
+    }
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * 1024);
+}
+
+#define DEQUE_BENCHMARKS(T)                                                 \
+  BENCHMARK_TEMPLATE(BM_PushBack, std::deque<T>)->Arg(1 << 10)->Arg(1 << 16); \
+  BENCHMARK_TEMPLATE(BM_PushBack, Deque<T>)->Arg(1 << 10)->Arg(1 << 16);      \
+  BENCHMARK_TEMPLATE(BM_PushFront, std::deque<T>)->Arg(1 << 10)->Arg(1 << 16);\
+  BENCHMARK_TEMPLATE(BM_PushFront, Deque<T>)->Arg(1 << 10)->Arg(1 << 16);     \
+  BENCHMARK_TEMPLATE(BM_RandomAccess, std::deque<T>)->Arg(1 << 16);           \
+  BENCHMARK_TEMPLATE(BM_RandomAccess, Deque<T>)->Arg(1 << 16);                \
+  BENCHMARK_TEMPLATE(BM_Iterate, std::deque<T>)->Arg(1 << 16);                \
+  BENCHMARK_TEMPLATE(BM_Iterate, Deque<T>)->Arg(1 << 16);                     \
+  BENCHMARK_TEMPLATE(BM_RingQueue, std::deque<T>)->Arg(16)->Arg(1 << 12);     \
+  BENCHMARK_TEMPLATE(BM_RingQueue, Deque<T>)->Arg(16)->Arg(1 << 12)
+
+DEQUE_BENCHMARKS(std::int64_t);
+DEQUE_BENCHMARKS(Wide);
+
+}  // namespace
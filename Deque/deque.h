@@ -0,0 +1,639 @@
+#pragma once
+
+// Double-ended queue stored as a map of fixed-size blocks.
+//
+// Element i lives in block (offset + i) / B at slot (offset + i) % B, where
+// offset is the position of the front element in its block and B is a power
+// of two, so operator[] is a shift, a mask and two loads. Elements never move
+// once constructed, so pushing at either end keeps references valid;
+// iterators hold a pointer into the map and are invalidated by any push,
+// exactly as for std::deque.
+//
+// B is chosen from sizeof(T) so a block is about one page. Emptied blocks are
+// freed except for one spare, so a deque used as a FIFO queue reaches a
+// steady state with no allocations.
+
+#include <algorithm>
+#include <bit>
+#include <compare>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace deque_detail {
+
+template <typename T>
+constexpr std::size_t block_size() {
+  constexpr std::size_t kBlockBytes = 4096;
+  constexpr std::size_t kMinElements = 16;
+  return std::bit_floor(std::max(kBlockBytes / sizeof(T), kMinElements));
+}
+
+}  // namespace deque_detail
+
+template <typename T, typename Allocator = std::allocator<T>>
+class Deque {
+  using AllocTraits = std::allocator_traits<Allocator>;
+  using MapAllocator = typename AllocTraits::template rebind_alloc<T*>;
+  using MapTraits = std::allocator_traits<MapAllocator>;
+
+  static constexpr std::size_t kBlockSize = deque_detail::block_size<T>();
+  static constexpr std::size_t kBlockShift = std::countr_zero(kBlockSize);
+  static constexpr std::size_t kBlockMask = kBlockSize - 1;
+  static constexpr std::size_t kMinMapSize = 8;
+
+  template <bool IsConst>
+  class Iterator {
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+
+    Iterator() = default;
+    operator Iterator<true>() const {  // NOLINT(google-explicit-constructor)
+      return Iterator<true>(node_, first_, current_);
+    }
+
+    reference operator*() const { return *current_; }
+    pointer operator->() const { return current_; }
+    reference operator[](difference_type n) const { return *(*this + n); }
+
+    Iterator& operator++() {
+      if (++current_ == first_ + kBlockSize) {
+        ++node_;
+        first_ = *node_;
+        current_ = first_;
+      }
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator old = *this;
+      ++*this;
+      return old;
+    }
+    Iterator& operator--() {
+      if (current_ == first_) {
+        --node_;
+        first_ = *node_;
+        current_ = first_ + kBlockSize;
+      }
+      --current_;
+      return *this;
+    }
+    Iterator operator--(int) {
+      Iterator old = *this;
+      --*this;
+      return old;
+    }
+
+    Iterator& operator+=(difference_type n) {
+      difference_type offset = (current_ - first_) + n;
+      if (offset >= 0 && offset < static_cast<difference_type>(kBlockSize)) {
+        current_ += n;
+        return *this;
+      }
+      difference_type blocks =
+          offset >= 0 ? offset >> kBlockShift : -((-offset - 1) >> kBlockShift) - 1;
+      node_ += blocks;
+      first_ = *node_;
+      current_ = first_ + (offset - blocks * static_cast<difference_type>(kBlockSize));
+      return *this;
+    }
+    Iterator& operator-=(difference_type n) { return *this += -n; }
+
+    friend Iterator operator+(Iterator it, difference_type n) { return it += n; }
+    friend Iterator operator+(difference_type n, Iterator it) { return it += n; }
+    friend Iterator operator-(Iterator it, difference_type n) { return it -= n; }
+
+    friend difference_type operator-(const Iterator& lhs, const Iterator& rhs) {
+      return (lhs.node_ - rhs.node_) * static_cast<difference_type>(kBlockSize) +
+             (lhs.current_ - lhs.first_) - (rhs.current_ - rhs.first_);
+    }
+
+    friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
+      return lhs.current_ == rhs.current_;
+    }
+    friend std::strong_ordering operator<=>(const Iterator& lhs,
+                                            const Iterator& rhs) {
+      return lhs - rhs <=> 0;
+    }
+
+   private:
+    friend class Deque;
+    friend class Iterator<!IsConst>;
+
+    using Node = std::conditional_t<IsConst, T* const*, T**>;
+
+    Iterator(Node node, pointer first, pointer current)
+        : node_(node), first_(first), current_(current) {}
+
+    // The start of the current block is cached so that stepping through a
+    // block compares against a register instead of reloading the map.
+    Node node_ = nullptr;
+    pointer first_ = nullptr;
+    pointer current_ = nullptr;
+  };
+
+ public:
+  using value_type = T;
+  using allocator_type = Allocator;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = typename AllocTraits::pointer;
+  using const_pointer = typename AllocTraits::const_pointer;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  Deque() = default;
+  explicit Deque(const Allocator& alloc) : alloc_(alloc) {}
+
+  explicit Deque(size_type count, const Allocator& alloc = Allocator())
+      : alloc_(alloc) {
+    guarded([&] {
+      for (size_type i = 0; i < count; ++i) {
+        emplace_back();
+      }
+    });
+  }
+
+  Deque(size_type count, const T& value, const Allocator& alloc = Allocator())
+      : alloc_(alloc) {
+    guarded([&] {
+      for (size_type i = 0; i < count; ++i) {
+        push_back(value);
+      }
+    });
+  }
+
+  template <std::input_iterator InputIt>
+  Deque(InputIt first, InputIt last, const Allocator& alloc = Allocator())
+      : alloc_(alloc) {
+    guarded([&] {
+      for (; first != last; ++first) {
+        emplace_back(*first);
+      }
+    });
+  }
+
+  Deque(std::initializer_list<T> values, const Allocator& alloc = Allocator())
+      : Deque(values.begin(), values.end(), alloc) {}
+
+  Deque(const Deque& other)
+      : Deque(other.begin(), other.end(),
+              AllocTraits::select_on_container_copy_construction(other.alloc_)) {}
+
+  Deque(Deque&& other) noexcept : alloc_(std::move(other.alloc_)) {
+    steal(other);
+  }
+
+  ~Deque() { release(); }
+
+  Deque& operator=(const Deque& other) {
+    if (this != &other) {
+      Deque copy(other.begin(), other.end(),
+                 AllocTraits::propagate_on_container_copy_assignment::value
+                     ? other.alloc_
+                     : alloc_);
+      release();
+      alloc_ = copy.alloc_;
+      steal(copy);
+    }
+    return *this;
+  }
+
+  Deque& operator=(Deque&& other) noexcept(
+      AllocTraits::propagate_on_container_move_assignment::value ||
+      AllocTraits::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
+    }
+    if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+      release();
+      alloc_ = std::move(other.alloc_);
+      steal(other);
+    } else {
+      if (alloc_ == other.alloc_) {
+        release();
+        steal(other);
+      } else {
+        Deque moved(std::make_move_iterator(other.begin()),
+                    std::make_move_iterator(other.end()), alloc_);
+        swap_storage(moved);
+      }
+    }
+    return *this;
+  }
+
+  Deque& operator=(std::initializer_list<T> values) {
+    return *this = Deque(values, alloc_);
+  }
+
+  allocator_type get_allocator() const { return alloc_; }
+
+  size_type size() const { return static_cast<size_type>(end_ - begin_); }
+  bool empty() const { return begin_ == end_; }
+
+  T& operator[](size_type index) { return *locate(index); }
+  const T& operator[](size_type index) const { return *locate(index); }
+
+  T& at(size_type index) {
+    check_index(index);
+    return (*this)[index];
+  }
+  const T& at(size_type index) const {
+    check_index(index);
+    return (*this)[index];
+  }
+
+  T& front() { return *begin_; }
+  const T& front() const { return *begin_; }
+  T& back() { return *std::prev(end()); }
+  const T& back() const { return *std::prev(end()); }
+
+  iterator begin() { return begin_; }
+  iterator end() { return end_; }
+  const_iterator begin() const { return begin_; }
+  const_iterator end() const { return end_; }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+  const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+  const_reverse_iterator crbegin() const { return rbegin(); }
+  const_reverse_iterator crend() const { return rend(); }
+
+  // All pushes give the strong exception guarantee.
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+  void push_front(const T& value) { emplace_front(value); }
+  void push_front(T&& value) { emplace_front(std::move(value)); }
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    if (end_.current_ != back_limit_) {
+      T* slot = end_.current_;
+      AllocTraits::construct(alloc_, slot, std::forward<Args>(args)...);
+      ++end_.current_;
+      return *slot;
+    }
+    return emplace_back_slow(std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  T& emplace_front(Args&&... args) {
+    if (begin_.current_ != begin_.first_) {
+      T* slot = begin_.current_ - 1;
+      AllocTraits::construct(alloc_, slot, std::forward<Args>(args)...);
+      begin_.current_ = slot;
+      return *slot;
+    }
+    return emplace_front_slow(std::forward<Args>(args)...);
+  }
+
+  void pop_back() {
+    if (end_.current_ == *end_.node_) {
+      release_block(end_.node_);
+      --end_.node_;
+      end_.first_ = *end_.node_;
+      back_limit_ = end_.first_ + kBlockMask;
+      end_.current_ = back_limit_;
+    } else {
+      --end_.current_;
+    }
+    AllocTraits::destroy(alloc_, end_.current_);
+  }
+
+  void pop_front() {
+    AllocTraits::destroy(alloc_, begin_.current_);
+    if (begin_.current_ == begin_.first_ + kBlockMask) {
+      release_block(begin_.node_);
+      ++begin_.node_;
+      begin_.first_ = *begin_.node_;
+      begin_.current_ = begin_.first_;
+    } else {
+      ++begin_.current_;
+    }
+  }
+
+  // Inserting or erasing in the middle moves the shorter side, O(min(i, n - i)).
+  iterator insert(const_iterator pos, const T& value) {
+    return emplace(pos, value);
+  }
+  iterator insert(const_iterator pos, T&& value) {
+    return emplace(pos, std::move(value));
+  }
+
+  template <typename... Args>
+  iterator emplace(const_iterator pos, Args&&... args) {
+    auto index = pos - cbegin();
+    if (index < static_cast<difference_type>(size() / 2)) {
+      emplace_front(std::forward<Args>(args)...);
+      std::rotate(begin(), begin() + 1, begin() + index + 1);
+    } else {
+      emplace_back(std::forward<Args>(args)...);
+      std::rotate(begin() + index, end() - 1, end());
+    }
+    return begin() + index;
+  }
+
+  iterator erase(const_iterator pos) {
+    auto index = pos - cbegin();
+    if (index < static_cast<difference_type>(size() / 2)) {
+      std::move_backward(begin(), begin() + index, begin() + index + 1);
+      pop_front();
+    } else {
+      std::move(begin() + index + 1, end(), begin() + index);
+      pop_back();
+    }
+    return begin() + index;
+  }
+
+  // Keeps the front block, so refilling a cleared deque does not allocate.
+  void clear() noexcept {
+    if (map_ == nullptr) {
+      return;
+    }
+    for (iterator it = begin_; it != end_; ++it) {
+      AllocTraits::destroy(alloc_, it.current_);
+    }
+    for (T** node = begin_.node_ + 1; node <= end_.node_; ++node) {
+      release_block(node);
+    }
+    end_ = begin_;
+    back_limit_ = begin_.first_ + kBlockMask;
+  }
+
+  void resize(size_type count) {
+    while (size() > count) {
+      pop_back();
+    }
+    while (size() < count) {
+      emplace_back();
+    }
+  }
+
+  void resize(size_type count, const T& value) {
+    while (size() > count) {
+      pop_back();
+    }
+    while (size() < count) {
+      push_back(value);
+    }
+  }
+
+  // Frees the spare block kept for reuse.
+  void shrink_to_fit() {
+    if (spare_ != nullptr) {
+      AllocTraits::deallocate(alloc_, spare_, kBlockSize);
+      spare_ = nullptr;
+    }
+  }
+
+  // Calls visit with each run of elements that is contiguous in memory, as
+  // a std::span, front to back: one run per block. Lets trivially copyable
+  // elements be copied in and out with memcpy.
+  template <typename Visit>
+  void for_each_segment(Visit visit) {
+    visit_segments(*this, visit);
+  }
+  template <typename Visit>
+  void for_each_segment(Visit visit) const {
+    visit_segments(*this, visit);
+  }
+
+  void swap(Deque& other) noexcept {
+    if constexpr (AllocTraits::propagate_on_container_swap::value) {
+      using std::swap;
+      swap(alloc_, other.alloc_);
+    }
+    swap_storage(other);
+  }
+
+  friend void swap(Deque& lhs, Deque& rhs) noexcept { lhs.swap(rhs); }
+
+  friend bool operator==(const Deque& lhs, const Deque& rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+  }
+
+  friend auto operator<=>(const Deque& lhs, const Deque& rhs) {
+    return std::lexicographical_compare_three_way(lhs.begin(), lhs.end(),
+                                                  rhs.begin(), rhs.end());
+  }
+
+ private:
+  T* locate(size_type index) const {
+    auto offset = static_cast<size_type>(begin_.current_ - begin_.first_) + index;
+    return begin_.node_[offset >> kBlockShift] + (offset & kBlockMask);
+  }
+
+  template <typename Self, typename Visit>
+  static void visit_segments(Self& self, Visit& visit) {
+    using Element = std::conditional_t<std::is_const_v<Self>, const T, T>;
+    if (self.empty()) {
+      return;
+    }
+    T* const* node = self.begin_.node_;
+    T* first = self.begin_.current_;
+    while (node != self.end_.node_) {
+      visit(std::span<Element>(first, *node + kBlockSize));
+      first = *++node;
+    }
+    if (first != self.end_.current_) {
+      visit(std::span<Element>(first, self.end_.current_));
+    }
+  }
+
+  void check_index(size_type index) const {
+    if (index >= size()) {
+      throw std::out_of_range("Deque::at");
+    }
+  }
+
+  // Runs a constructor body, freeing what was built if it throws.
+  template <typename Fill>
+  void guarded(Fill fill) {
+    try {
+      fill();
+    } catch (...) {
+      release();
+      throw;
+    }
+  }
+
+  // The last slot of the end block is never filled without allocating the
+  // next block first, so end_ always points into an allocated block.
+  template <typename... Args>
+  T& emplace_back_slow(Args&&... args) {
+    if (map_ == nullptr) {
+      initialize_map(0);
+      return emplace_back(std::forward<Args>(args)...);
+    }
+    if (end_.node_ + 1 == map_ + map_size_) {
+      rebalance_map();
+    }
+    end_.node_[1] = acquire_block();
+    T* slot = end_.current_;
+    construct_or_release(slot, end_.node_ + 1, std::forward<Args>(args)...);
+    ++end_.node_;
+    end_.first_ = *end_.node_;
+    end_.current_ = end_.first_;
+    back_limit_ = end_.first_ + kBlockMask;
+    return *slot;
+  }
+
+  template <typename... Args>
+  T& emplace_front_slow(Args&&... args) {
+    if (map_ == nullptr) {
+      initialize_map(kBlockMask);
+      return emplace_front(std::forward<Args>(args)...);
+    }
+    if (begin_.node_ == map_) {
+      rebalance_map();
+    }
+    begin_.node_[-1] = acquire_block();
+    T* slot = begin_.node_[-1] + kBlockMask;
+    construct_or_release(slot, begin_.node_ - 1, std::forward<Args>(args)...);
+    --begin_.node_;
+    begin_.first_ = *begin_.node_;
+    begin_.current_ = slot;
+    return *slot;
+  }
+
+  // Constructs an element in a freshly acquired block and gives the block
+  // back if the constructor throws.
+  template <typename... Args>
+  void construct_or_release(T* slot, T** node, Args&&... args) {
+    if constexpr (std::is_nothrow_constructible_v<T, Args...>) {
+      AllocTraits::construct(alloc_, slot, std::forward<Args>(args)...);
+    } else {
+      try {
+        AllocTraits::construct(alloc_, slot, std::forward<Args>(args)...);
+      } catch (...) {
+        release_block(node);
+        throw;
+      }
+    }
+  }
+
+  // Creates the map with one empty block and both ends at `offset` in it.
+  void initialize_map(size_type offset) {
+    MapAllocator map_alloc(alloc_);
+    map_ = MapTraits::allocate(map_alloc, kMinMapSize);
+    map_size_ = kMinMapSize;
+    T** node = map_ + (kMinMapSize - 1) / 2;
+    try {
+      *node = acquire_block();
+    } catch (...) {
+      MapTraits::deallocate(map_alloc, map_, map_size_);
+      map_ = nullptr;
+      map_size_ = 0;
+      throw;
+    }
+    begin_ = iterator(node, *node, *node + offset);
+    end_ = begin_;
+    back_limit_ = *node + kBlockMask;
+  }
+
+  T* acquire_block() {
+    if (spare_ != nullptr) {
+      return std::exchange(spare_, nullptr);
+    }
+    return AllocTraits::allocate(alloc_, kBlockSize);
+  }
+
+  void release_block(T** node) {
+    if (spare_ == nullptr) {
+      spare_ = *node;
+    } else {
+      AllocTraits::deallocate(alloc_, *node, kBlockSize);
+    }
+  }
+
+  // Centers the used blocks in the map, leaving at least one free slot at
+  // each end. The map is reallocated only if it is more than half full, so
+  // a queue drifting through the map recenters in amortized O(1).
+  void rebalance_map() {
+    auto first = static_cast<size_type>(begin_.node_ - map_);
+    auto used = static_cast<size_type>(end_.node_ - begin_.node_) + 1;
+    size_type new_size = map_size_;
+    if (2 * (used + 2) > map_size_) {
+      new_size = std::max(2 * map_size_, 2 * (used + 2));
+    }
+    size_type new_first = (new_size - used) / 2;
+
+    if (new_size == map_size_) {
+      if (new_first < first) {
+        std::move(map_ + first, map_ + first + used, map_ + new_first);
+      } else {
+        std::move_backward(map_ + first, map_ + first + used,
+                           map_ + new_first + used);
+      }
+    } else {
+      MapAllocator map_alloc(alloc_);
+      T** new_map = MapTraits::allocate(map_alloc, new_size);
+      std::copy(map_ + first, map_ + first + used, new_map + new_first);
+      MapTraits::deallocate(map_alloc, map_, map_size_);
+      map_ = new_map;
+      map_size_ = new_size;
+    }
+    begin_.node_ = map_ + new_first;
+    end_.node_ = begin_.node_ + (used - 1);
+  }
+
+  void release() noexcept {
+    if (map_ != nullptr) {
+      clear();
+      AllocTraits::deallocate(alloc_, *begin_.node_, kBlockSize);
+      MapAllocator map_alloc(alloc_);
+      MapTraits::deallocate(map_alloc, map_, map_size_);
+      map_ = nullptr;
+      map_size_ = 0;
+    }
+    shrink_to_fit();
+    begin_ = iterator();
+    end_ = iterator();
+    back_limit_ = nullptr;
+  }
+
+  void steal(Deque& other) noexcept {
+    map_ = std::exchange(other.map_, nullptr);
+    map_size_ = std::exchange(other.map_size_, 0);
+    begin_ = std::exchange(other.begin_, iterator());
+    end_ = std::exchange(other.end_, iterator());
+    back_limit_ = std::exchange(other.back_limit_, nullptr);
+    spare_ = std::exchange(other.spare_, nullptr);
+  }
+
+  void swap_storage(Deque& other) noexcept {
+    std::swap(map_, other.map_);
+    std::swap(map_size_, other.map_size_);
+    std::swap(begin_, other.begin_);
+    std::swap(end_, other.end_);
+    std::swap(back_limit_, other.back_limit_);
+    std::swap(spare_, other.spare_);
+  }
+
+  // Every block from begin_.node_ to end_.node_ is allocated, including the
+  // end block when it holds no elements. The ends are kept as pointers rather
+  // than indices: a store of T can never alias them, so the push and pop fast
+  // paths keep them in registers.
+  T** map_ = nullptr;
+  size_type map_size_ = 0;
+  iterator begin_;
+  iterator end_;
+  T* back_limit_ = nullptr;  // last slot of the end block
+  T* spare_ = nullptr;
+  [[no_unique_address]] Allocator alloc_;
+};
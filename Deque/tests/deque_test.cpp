@@ -0,0 +1,240 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Deque/deque.h"
+
+namespace {
+
+template <typename T>
+std::vector<T> contents(const Deque<T>& deque) {
+  return std::vector<T>(deque.begin(), deque.end());
+}
+
+// Counts the blocks a deque allocates, shared by all rebound copies.
+template <typename T>
+struct CountingAllocator {
+  using value_type = T;
+
+  std::shared_ptr<std::size_t> allocations = std::make_shared<std::size_t>(0);
+
+  CountingAllocator() = default;
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>& other)  // NOLINT(google-explicit-constructor)
+      : allocations(other.allocations) {}
+
+  T* allocate(std::size_t count) {
+    ++*allocations;
+    return std::allocator<T>().allocate(count);
+  }
+  void deallocate(T* pointer, std::size_t count) {
+    std::allocator<T>().deallocate(pointer, count);
+  }
+
+  friend bool operator==(const CountingAllocator& lhs, const CountingAllocator& rhs) {
+    return lhs.allocations == rhs.allocations;
+  }
+};
+
+// Throws from its constructor once `countdown` reaches zero.
+struct Fragile {
+  static inline int countdown = -1;
+  static inline int alive = 0;
+
+  Fragile() {
+    if (countdown-- == 0) {
+      throw std::runtime_error("Fragile");
+    }
+    ++alive;
+  }
+  Fragile(const Fragile&) : Fragile() {}
+  ~Fragile() { --alive; }
+};
+
+TEST(Deque, MatchesStdDequeUnderRandomOperations) {
+  Deque<int> deque;
+  std::deque<int> model;
+  std::mt19937 gen(1);
+  for (int step = 0; step < 200000; ++step) {
+    int value = static_cast<int>(gen());
+    switch (gen() % 8) {
+      case 0:
+      case 1:
+        deque.push_back(value);
+        model.push_back(value);
+        break;
+      case 2:
+      case 3:
+        deque.push_front(value);
+        model.push_front(value);
+        break;
+      case 4:
+        if (!model.empty()) {
+          deque.pop_back();
+          model.pop_back();
+        }
+        break;
+      case 5:
+        if (!model.empty()) {
+          deque.pop_front();
+          model.pop_front();
+        }
+        break;
+      case 6: {
+        std::size_t at = model.empty() ? 0 : gen() % (model.size() + 1);
+        deque.insert(deque.begin() + static_cast<std::ptrdiff_t>(at), value);
+        model.insert(model.begin() + static_cast<std::ptrdiff_t>(at), value);
+        break;
+      }
+      case 7:
+        if (!model.empty()) {
+          std::size_t at = gen() % model.size();
+          deque.erase(deque.begin() + static_cast<std::ptrdiff_t>(at));
+          model.erase(model.begin() + static_cast<std::ptrdiff_t>(at));
+        }
+        break;
+    }
+    ASSERT_EQ(deque.size(), model.size());
+    if (!model.empty()) {
+      std::size_t at = gen() % model.size();
+      ASSERT_EQ(deque[at], model[at]);
+      ASSERT_EQ(deque.front(), model.front());
+      ASSERT_EQ(deque.back(), model.back());
+    }
+  }
+  EXPECT_TRUE(std::equal(deque.begin(), deque.end(), model.begin(), model.end()));
+  EXPECT_TRUE(std::equal(deque.rbegin(), deque.rend(), model.rbegin(), model.rend()));
+}
+
+TEST(Deque, ReferencesSurvivePushesAtBothEnds) {
+  Deque<std::string> deque;
+  deque.push_back("middle");
+  std::string* middle = &deque.front();
+  std::vector<std::string*> pointers;
+  for (int i = 0; i < 10000; ++i) {
+    pointers.push_back(&deque.emplace_back(std::to_string(i)));
+    deque.emplace_front(std::to_string(-i));
+  }
+  EXPECT_EQ(*middle, "middle");
+  for (int i = 0; i < 10000; ++i) {
+    ASSERT_EQ(*pointers[static_cast<std::size_t>(i)], std::to_string(i));
+  }
+  EXPECT_EQ(&deque[10000], middle);
+}
+
+TEST(Deque, IteratorsAreRandomAccess) {
+  Deque<int> deque;
+  for (int i = 0; i < 5000; ++i) {
+    deque.push_back(i);
+  }
+  deque.pop_front();
+  auto it = deque.begin();
+  EXPECT_EQ(it[1234], 1235);
+  EXPECT_EQ(*(it + 4000), 4001);
+  EXPECT_EQ(deque.end() - deque.begin(), 4999);
+  it += 3000;
+  it -= 1000;
+  EXPECT_EQ(*it, 2001);
+  EXPECT_LT(deque.begin(), it);
+  EXPECT_EQ(std::distance(deque.cbegin(), deque.cend()), 4999);
+}
+
+TEST(Deque, AtChecksBounds) {
+  Deque<int> deque{1, 2, 3};
+  EXPECT_EQ(deque.at(2), 3);
+  EXPECT_THROW(deque.at(3), std::out_of_range);
+  const Deque<int>& constant = deque;
+  EXPECT_THROW(constant.at(100), std::out_of_range);
+  EXPECT_THROW(Deque<int>().at(0), std::out_of_range);
+}
+
+TEST(Deque, ConstructorsCopiesAndComparison) {
+  Deque<int> filled(3000, 7);
+  EXPECT_EQ(filled.size(), 3000u);
+  EXPECT_EQ(filled[2999], 7);
+  Deque<int> sized(100);
+  EXPECT_EQ(sized[50], 0);
+
+  std::vector<int> source(2500);
+  std::iota(source.begin(), source.end(), 0);
+  Deque<int> ranged(source.begin(), source.end());
+  EXPECT_EQ(contents(ranged), source);
+
+  Deque<int> copy = ranged;
+  EXPECT_EQ(copy, ranged);
+  copy.back() = -1;
+  EXPECT_LT(copy, ranged);
+
+  Deque<int> moved = std::move(copy);
+  EXPECT_TRUE(copy.empty());  // NOLINT(bugprone-use-after-move)
+  EXPECT_EQ(moved.back(), -1);
+
+  copy = {1, 2, 3};
+  swap(copy, moved);
+  EXPECT_EQ(moved, (Deque<int>{1, 2, 3}));
+  EXPECT_EQ(copy.size(), 2500u);
+}
+
+TEST(Deque, ResizeAndClear) {
+  Deque<int> deque;
+  deque.resize(5000, 3);
+  EXPECT_EQ(deque.size(), 5000u);
+  deque.resize(10);
+  EXPECT_EQ(contents(deque), std::vector<int>(10, 3));
+  deque.clear();
+  EXPECT_TRUE(deque.empty());
+  deque.push_front(1);
+  deque.push_back(2);
+  EXPECT_EQ(contents(deque), (std::vector<int>{1, 2}));
+}
+
+TEST(Deque, QueueReachesSteadyStateWithoutAllocating) {
+  CountingAllocator<int> alloc;
+  Deque<int, CountingAllocator<int>> queue(alloc);
+  for (int i = 0; i < 10000; ++i) {
+    queue.push_back(i);
+    queue.pop_front();
+  }
+  std::size_t warm = *alloc.allocations;
+  for (int i = 0; i < 100000; ++i) {
+    queue.push_back(i);
+    if (i % 3 != 0) {
+      queue.pop_front();
+    }
+    if (queue.size() > 100) {
+      queue.pop_front();
+    }
+  }
+  EXPECT_EQ(warm, *alloc.allocations);
+  EXPECT_LE(warm, 3u);
+}
+
+TEST(Deque, ClearKeepsTheFrontBlock) {
+  CountingAllocator<int> alloc;
+  Deque<int, CountingAllocator<int>> deque(alloc);
+  deque.push_back(1);
+  deque.clear();
+  std::size_t before = *alloc.allocations;
+  for (int i = 0; i < 10; ++i) {
+    deque.push_back(i);
+  }
+  EXPECT_EQ(*alloc.allocations, before);
+}
+
+TEST(Deque, ThrowingConstructorLeaksNothing) {
+  Fragile::countdown = 1500;
+  EXPECT_THROW((Deque<Fragile>(3000)), std::runtime_error);
+  EXPECT_EQ(Fragile::alive, 0);
+  Fragile::countdown = -1;
+}
+
+}  // namespace
@@ -0,0 +1,240 @@
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <numbers>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Geometry/geometry.h"
+
+namespace {
+
+// The design the batch tests replace: an array of point structs, and
+// shapes behind a virtual call per point with the textbook crossing test.
+struct Shape {
+  virtual ~Shape() = default;
+  virtual bool contains(Point p) const = 0;
+};
+
+struct NaivePolygon : Shape {
+  std::vector<Point> vertices;
+
+  bool contains(Point p) const override {
+    bool inside = false;
+    for (std::size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++) {
+      const Point a = vertices[i];
+      const Point b = vertices[j];
+      if ((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x) {
+        inside = !inside;
+      }
+    }
+    return inside;
+  }
+};
+
+struct NaiveCircle : Shape {
+  Point center;
+  double radius = 0;
+
+  bool contains(Point p) const override {
+    return std::hypot(p.x - center.x, p.y - center.y) <= radius;
+  }
+};
+
+constexpr std::size_t kPoints = 1 << 20;
+
+Points random_points(std::size_t count, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> dist(-1.0, 1.0);
+  Points points;
+  points.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    points.push_back({dist(gen), dist(gen)});
+  }
+  return points;
+}
+
+std::vector<Point> as_structs(const Points& points) {
+  std::vector<Point> result(points.size());
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    result[i] = points[i];
+  }
+  return result;
+}
+
+// A star with the given number of vertices, alternating radii 1 and 0.4.
+Polygon star(std::size_t vertices) {
+  Points points;
+  for (std::size_t i = 0; i < vertices; ++i) {
+    double radius = i % 2 == 0 ? 1.0 : 0.4;
+    double angle = 2 * std::numbers::pi * static_cast<double>(i) / static_cast<double>(vertices);
+    points.push_back({radius * std::cos(angle), radius * std::sin(angle)});
+  }
+  return Polygon(std::move(points));
+}
+
+void set_points_processed(benchmark::State& state, std::size_t count) {
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(count));
+}
+
+// Runs body with the kernels of the instruction set in argument `argument`.
+template <typename Body>
+void with_isa(benchmark::State& state, int argument, Body body) {
+  auto isa = static_cast<geometry_detail::GeometryIsa>(state.range(argument));
+  geometry_detail::GeometryIsa previous = geometry_detail::active_geometry_isa();
+  if (!geometry_detail::select_geometry_isa(isa)) {
+    state.SkipWithError("instruction set not supported");
+    return;
+  }
+  body();
+  geometry_detail::select_geometry_isa(previous);
+}
+
+void BM_PolygonVirtual(benchmark::State& state) {
+  auto polygon = std::make_unique<NaivePolygon>();
+  Polygon shape = star(static_cast<std::size_t>(state.range(0)));
+  for (Point p : as_structs(shape.vertices())) {
+    polygon->vertices.push_back(p);
+  }
+  std::unique_ptr<Shape> base = std::move(polygon);
+  std::vector<Point> points = as_structs(random_points(kPoints, 1));
+  std::vector<std::uint8_t> inside(points.size());
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      inside[i] = base->contains(points[i]);
+    }
+    benchmark::DoNotOptimize(inside.data());
+  }
+  set_points_processed(state, points.size());
+}
+
+void BM_PolygonScalar(benchmark::State& state) {
+  Polygon polygon = star(static_cast<std::size_t>(state.range(0)));
+  Points points = random_points(kPoints, 1);
+  std::vector<std::uint8_t> inside(points.size());
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      inside[i] = polygon.contains(points[i]);
+    }
+    benchmark::DoNotOptimize(inside.data());
+  }
+  set_points_processed(state, points.size());
+}
+
+void BM_PolygonBatch(benchmark::State& state) {
+  Polygon polygon = star(static_cast<std::size_t>(state.range(0)));
+  Points points = random_points(kPoints, 1);
+  std::vector<std::uint8_t> inside(points.size());
+  with_isa(state, 1, [&] {
+    for (auto _ : state) {
+      polygon.contains(points, inside);
+      benchmark::DoNotOptimize(inside.data());
+    }
+  });
+  set_points_processed(state, points.size());
+}
+
+void BM_CircleVirtual(benchmark::State& state) {
+  auto circle = std::make_unique<NaiveCircle>();
+  circle->center = {0.1, -0.2};
+  circle->radius = 0.5;
+  std::unique_ptr<Shape> base = std::move(circle);
+  std::vector<Point> points = as_structs(random_points(kPoints, 1));
+  std::vector<std::uint8_t> inside(points.size());
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      inside[i] = base->contains(points[i]);
+    }
+    benchmark::DoNotOptimize(inside.data());
+  }
+  set_points_processed(state, points.size());
+}
+
+void BM_CircleBatch(benchmark::State& state) {
+  Circle circle{{0.1, -0.2}, 0.5};
+  Points points = random_points(kPoints, 1);
+  std::vector<std::uint8_t> inside(points.size());
+  with_isa(state, 0, [&] {
+    for (auto _ : state) {
+      circle.contains(points, inside);
+      benchmark::DoNotOptimize(inside.data());
+    }
+  });
+  set_points_processed(state, points.size());
+}
+
+void BM_SideScalar(benchmark::State& state) {
+  Line line{{-0.3, -0.1}, {0.7, 0.5}};
+  Points points = random_points(kPoints, 1);
+  std::vector<Orientation> side(points.size());
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      side[i] = line.side(points[i]);
+    }
+    benchmark::DoNotOptimize(side.data());
+  }
+  set_points_processed(state, points.size());
+}
+
+void BM_SideBatch(benchmark::State& state) {
+  Line line{{-0.3, -0.1}, {0.7, 0.5}};
+  Points points = random_points(kPoints, 1);
+  std::vector<Orientation> side(points.size());
+  with_isa(state, 0, [&] {
+    for (auto _ : state) {
+      line.side(points, side);
+      benchmark::DoNotOptimize(side.data());
+    }
+  });
+  set_points_processed(state, points.size());
+}
+
+void BM_ConvexHull(benchmark::State& state) {
+  Points points = random_points(static_cast<std::size_t>(state.range(0)), 1);
+  for (auto _ : state) {
+    Polygon hull = convex_hull(points);
+    benchmark::DoNotOptimize(hull.size());
+  }
+  set_points_processed(state, points.size());
+}
+
+void BM_Area(benchmark::State& state) {
+  Polygon polygon = star(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    double area = polygon.area();
+    benchmark::DoNotOptimize(area);
+  }
+}
+
+constexpr auto kPortable = static_cast<std::int64_t>(geometry_detail::GeometryIsa::Portable);
+constexpr auto kAvx2 = static_cast<std::int64_t>(geometry_detail::GeometryIsa::Avx2);
+constexpr auto kAvx512 = static_cast<std::int64_t>(geometry_detail::GeometryIsa::Avx512);
+
+}  // namespace
+
+BENCHMARK(BM_PolygonVirtual)->ArgName("vertices")->Arg(8)->Arg(64)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_PolygonScalar)->ArgName("vertices")->Arg(8)->Arg(64)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_PolygonBatch)
+    ->ArgNames({"vertices", "isa"})
+    ->ArgsProduct({{8, 64}, {kPortable, kAvx2, kAvx512}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_CircleVirtual)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_CircleBatch)
+    ->ArgName("isa")
+    ->Arg(kPortable)
+    ->Arg(kAvx2)
+    ->Arg(kAvx512)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SideScalar)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SideBatch)
+    ->ArgName("isa")
+    ->Arg(kPortable)
+    ->Arg(kAvx2)
+    ->Arg(kAvx512)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ConvexHull)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Area)->Arg(64)->Arg(4096);
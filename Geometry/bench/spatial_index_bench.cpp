@@ -0,0 +1,135 @@
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "Geometry/geometry.h"
+#include "Geometry/spatial_index.h"
+
+namespace {
+
+// Uniform points in [-1, 1]^2, queried with boxes holding about 16 of them
+// and with k-nearest queries from random points.
+constexpr double kResultsPerQuery = 16;
+constexpr std::size_t kQueries = 1024;
+
+std::vector<Point> random_points(std::size_t count, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> dist(-1.0, 1.0);
+  std::vector<Point> points(count);
+  for (Point& p : points) {
+    p = {dist(gen), dist(gen)};
+  }
+  return points;
+}
+
+std::vector<Box> query_boxes(std::size_t count) {
+  const double side = std::sqrt(4 * kResultsPerQuery / static_cast<double>(count));
+  std::vector<Box> boxes;
+  for (Point p : random_points(kQueries, 2)) {
+    boxes.push_back({p, p + Point{side, side}});
+  }
+  return boxes;
+}
+
+// Building 10^7 item indexes takes seconds, so each is built once.
+template <typename Index>
+const Index& index_of(std::size_t count) {
+  static std::map<std::size_t, std::unique_ptr<Index>> built;
+  auto& index = built[count];
+  if (!index) {
+    index = std::make_unique<Index>(random_points(count, 1));
+  }
+  return *index;
+}
+
+void BM_RangeScan(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const std::vector<Point> points = random_points(count, 1);
+  const std::vector<Box> boxes = query_boxes(count);
+  std::size_t query = 0;
+  for (auto _ : state) {
+    const Box& box = boxes[query++ % kQueries];
+    std::size_t found = 0;
+    for (Point p : points) {
+      found += box.contains(p);
+    }
+    benchmark::DoNotOptimize(found);
+  }
+}
+
+template <typename Index>
+void BM_Range(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const Index& index = index_of<Index>(count);
+  const std::vector<Box> boxes = query_boxes(count);
+  std::size_t query = 0;
+  std::size_t found = 0;
+  for (auto _ : state) {
+    index.query(boxes[query++ % kQueries], [&](std::size_t) { ++found; });
+  }
+  benchmark::DoNotOptimize(found);
+}
+
+template <typename Index>
+void BM_Nearest(benchmark::State& state) {
+  const Index& index = index_of<Index>(static_cast<std::size_t>(state.range(0)));
+  const auto k = static_cast<std::size_t>(state.range(1));
+  const std::vector<Point> from = random_points(kQueries, 3);
+  std::size_t query = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(index.nearest(from[query++ % kQueries], k));
+  }
+}
+
+template <typename Index>
+void BM_Build(benchmark::State& state) {
+  const std::vector<Point> points = random_points(static_cast<std::size_t>(state.range(0)), 1);
+  for (auto _ : state) {
+    Index index(points);
+    benchmark::DoNotOptimize(index.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_RTreeInsert(benchmark::State& state) {
+  const std::vector<Point> points = random_points(static_cast<std::size_t>(state.range(0)), 1);
+  for (auto _ : state) {
+    RTree<Point> tree;
+    for (Point p : points) {
+      tree.insert(p);
+    }
+    benchmark::DoNotOptimize(tree.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_GridInsert(benchmark::State& state) {
+  const std::vector<Point> points = random_points(static_cast<std::size_t>(state.range(0)), 1);
+  const double cell = 2 / std::sqrt(static_cast<double>(state.range(0)));
+  for (auto _ : state) {
+    UniformGrid<Point> grid(Box{{-1, -1}, {1, 1}}, cell);
+    for (Point p : points) {
+      grid.insert(p);
+    }
+    benchmark::DoNotOptimize(grid.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK(BM_RangeScan)->Arg(1'000'000)->Arg(10'000'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Range<UniformGrid<Point>>)->Arg(1'000'000)->Arg(10'000'000);
+BENCHMARK(BM_Range<RTree<Point>>)->Arg(1'000'000)->Arg(10'000'000);
+BENCHMARK(BM_Nearest<UniformGrid<Point>>)->ArgsProduct({{1'000'000, 10'000'000}, {1, 16}});
+BENCHMARK(BM_Nearest<RTree<Point>>)->ArgsProduct({{1'000'000, 10'000'000}, {1, 16}});
+BENCHMARK(BM_Build<UniformGrid<Point>>)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Build<RTree<Point>>)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_GridInsert)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_RTreeInsert)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
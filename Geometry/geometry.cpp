@@ -0,0 +1,193 @@
+#include "Geometry/geometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace geometry_detail {
+
+namespace {
+
+// Shewchuk's error-free transformations: x + y is exactly the sum or
+// product of a and b, with x the rounded result.
+void two_sum(double a, double b, double& x, double& y) {
+  x = a + b;
+  const double b_virtual = x - a;
+  const double a_virtual = x - b_virtual;
+  y = (a - a_virtual) + (b - b_virtual);
+}
+
+void two_product(double a, double b, double& x, double& y) {
+  x = a * b;
+  y = std::fma(a, b, -x);
+}
+
+// Adds b to the nonoverlapping expansion e[0, size), smallest component
+// first, dropping zeros. Returns the new size, at most size + 1.
+std::size_t grow_expansion(double* e, std::size_t size, double b) {
+  std::size_t out = 0;
+  double q = b;
+  for (std::size_t i = 0; i < size; ++i) {
+    double sum = 0;
+    double error = 0;
+    two_sum(q, e[i], sum, error);
+    if (error != 0) {
+      e[out++] = error;
+    }
+    q = sum;
+  }
+  if (q != 0 || out == 0) {
+    e[out++] = q;
+  }
+  return out;
+}
+
+}  // namespace
+
+// The differences are exact as two-term expansions and each product of two
+// such terms as another two, so the determinant is an exact sum of sixteen
+// doubles. Its sign is the sign of the largest component.
+Orientation orientation_exact(Point a, Point b, Point c) {
+  double acx[2];
+  double acy[2];
+  double bcx[2];
+  double bcy[2];
+  two_sum(a.x, -c.x, acx[1], acx[0]);
+  two_sum(a.y, -c.y, acy[1], acy[0]);
+  two_sum(b.x, -c.x, bcx[1], bcx[0]);
+  two_sum(b.y, -c.y, bcy[1], bcy[0]);
+
+  double expansion[33];
+  std::size_t size = 0;
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < 2; ++j) {
+      double high = 0;
+      double low = 0;
+      two_product(acx[i], bcy[j], high, low);
+      size = grow_expansion(expansion, size, low);
+      size = grow_expansion(expansion, size, high);
+      two_product(acy[i], bcx[j], high, low);
+      size = grow_expansion(expansion, size, -low);
+      size = grow_expansion(expansion, size, -high);
+    }
+  }
+  const double top = expansion[size - 1];
+  return top > 0 ? Orientation::CounterClockwise
+                 : top < 0 ? Orientation::Clockwise : Orientation::Collinear;
+}
+
+}  // namespace geometry_detail
+
+double Polygon::signed_area() const {
+  const std::size_t n = size();
+  if (n < 3) {
+    return 0;
+  }
+  // Relative to the first vertex, so that far-off polygons keep their digits.
+  const Point origin = vertices_[0];
+  double twice = 0;
+  for (std::size_t i = 1; i + 1 < n; ++i) {
+    twice += cross(vertices_[i] - origin, vertices_[i + 1] - origin);
+  }
+  return twice / 2;
+}
+
+// Winding number over the edges crossing the horizontal through p, with
+// exact orientations, plus a boundary test for edges whose bounding box
+// holds p.
+bool Polygon::contains(Point p) const {
+  const std::size_t n = size();
+  long winding = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    const Point a = vertices_[i];
+    const Point b = vertices_[i + 1 == n ? 0 : i + 1];
+    const bool upward = a.y <= p.y && b.y > p.y;
+    const bool downward = a.y > p.y && b.y <= p.y;
+    const bool near = std::min(a.x, b.x) <= p.x && p.x <= std::max(a.x, b.x) &&
+                      std::min(a.y, b.y) <= p.y && p.y <= std::max(a.y, b.y);
+    if (!upward && !downward && !near) {
+      continue;
+    }
+    const Orientation turn = orientation(a, b, p);
+    if (near && turn == Orientation::Collinear) {
+      return true;
+    }
+    if (upward && turn == Orientation::CounterClockwise) {
+      ++winding;
+    } else if (downward && turn == Orientation::Clockwise) {
+      --winding;
+    }
+  }
+  return winding != 0;
+}
+
+Box bounding_box(const Polygon& polygon) {
+  const Points& vertices = polygon.vertices();
+  if (vertices.empty()) {
+    return {};
+  }
+  const auto [min_x, max_x] = std::minmax_element(vertices.x().begin(), vertices.x().end());
+  const auto [min_y, max_y] = std::minmax_element(vertices.y().begin(), vertices.y().end());
+  return {{*min_x, *min_y}, {*max_x, *max_y}};
+}
+
+double distance(Point p, const Polygon& polygon) {
+  if (polygon.contains(p)) {
+    return 0;
+  }
+  const Points& vertices = polygon.vertices();
+  const std::size_t n = vertices.size();
+  double nearest = HUGE_VAL;
+  for (std::size_t i = 0; i < n; ++i) {
+    const Point a = vertices[i];
+    const Point edge = vertices[i + 1 == n ? 0 : i + 1] - a;
+    const double length2 = dot(edge, edge);
+    const double t = length2 > 0 ? std::clamp(dot(p - a, edge) / length2, 0.0, 1.0) : 0.0;
+    nearest = std::min(nearest, distance(p, a + edge * t));
+  }
+  return nearest;
+}
+
+// Andrew's monotone chain: sort, then build the lower and the upper hull,
+// popping every vertex that does not make a strict left turn.
+Polygon convex_hull(const Points& points) {
+  std::vector<Point> sorted(points.size());
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    sorted[i] = points[i];
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](Point lhs, Point rhs) { return lhs.x < rhs.x || (lhs.x == rhs.x && lhs.y < rhs.y); });
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+  if (sorted.size() < 3) {
+    Points hull;
+    for (Point p : sorted) {
+      hull.push_back(p);
+    }
+    return Polygon(std::move(hull));
+  }
+
+  std::vector<Point> chain(2 * sorted.size());
+  std::size_t size = 0;
+  auto extend = [&](Point p, std::size_t floor) {
+    while (size > floor &&
+           orientation(chain[size - 2], chain[size - 1], p) != Orientation::CounterClockwise) {
+      --size;
+    }
+    chain[size++] = p;
+  };
+  for (Point p : sorted) {
+    extend(p, 1);
+  }
+  const std::size_t lower = size;
+  for (std::size_t i = sorted.size() - 1; i-- > 0;) {
+    extend(sorted[i], lower);
+  }
+  // The last point is the first one again.
+  Points hull;
+  hull.reserve(size - 1);
+  for (std::size_t i = 0; i + 1 < size; ++i) {
+    hull.push_back(chain[i]);
+  }
+  return Polygon(std::move(hull));
+}
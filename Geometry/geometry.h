@@ -0,0 +1,282 @@
+#pragma once
+
+// Planar geometry over doubles with exact predicates and batched tests.
+//
+// Point, Line, Circle and Ellipse are small values. Points holds many
+// points as two arrays, x and y, so that batch tests stream them with full
+// vector loads, and Polygon keeps its vertices the same way. There is no
+// Shape base class: every batch test is a loop over one shape and many
+// points, run by the vector kernels in geometry_batch.cpp (AVX-512, AVX2 or
+// SSE2/NEON, picked from the CPU at first use).
+//
+// orientation() is exact in the sense of Shewchuk's adaptive predicates:
+// the determinant is computed in floating point and trusted whenever it
+// exceeds a bound on its rounding error, and only the rare undecided cases
+// are recomputed exactly with floating-point expansions. Polygon::contains
+// is built on it and exact too; points on the boundary are inside. The
+// batch kernels apply the same filter to whole vectors and hand the
+// undecided lanes to the exact scalar code, so their results are identical.
+// Circle and Ellipse tests are plain floating point.
+//
+// Box is the axis-aligned bounding box that spatial_index.h indexes by;
+// every shape has bounding_box(), and distance(p, shape) where it is cheap.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <numbers>
+#include <span>
+#include <utility>
+#include <vector>
+
+struct Point {
+  double x = 0;
+  double y = 0;
+
+  friend constexpr Point operator+(Point lhs, Point rhs) { return {lhs.x + rhs.x, lhs.y + rhs.y}; }
+  friend constexpr Point operator-(Point lhs, Point rhs) { return {lhs.x - rhs.x, lhs.y - rhs.y}; }
+  friend constexpr Point operator*(Point p, double scale) { return {p.x * scale, p.y * scale}; }
+  friend constexpr Point operator*(double scale, Point p) { return p * scale; }
+  friend constexpr bool operator==(Point lhs, Point rhs) = default;
+};
+
+constexpr double dot(Point a, Point b) { return a.x * b.x + a.y * b.y; }
+constexpr double cross(Point a, Point b) { return a.x * b.y - a.y * b.x; }
+
+inline double distance(Point p, Point q) {
+  const Point d = q - p;
+  return std::sqrt(dot(d, d));
+}
+
+// The axis-aligned box [min.x, max.x] x [min.y, max.y], closed. Empty if
+// min is above or right of max, as is the default box.
+struct Box {
+  Point min{HUGE_VAL, HUGE_VAL};
+  Point max{-HUGE_VAL, -HUGE_VAL};
+
+  bool empty() const { return !(min.x <= max.x && min.y <= max.y); }
+  double area() const { return empty() ? 0 : (max.x - min.x) * (max.y - min.y); }
+  Point center() const { return (min + max) * 0.5; }
+
+  bool contains(Point p) const {
+    return min.x <= p.x && p.x <= max.x && min.y <= p.y && p.y <= max.y;
+  }
+  bool intersects(const Box& other) const {
+    return min.x <= other.max.x && other.min.x <= max.x && min.y <= other.max.y &&
+           other.min.y <= max.y;
+  }
+
+  // The smallest box holding both.
+  Box united(const Box& other) const {
+    return {{std::min(min.x, other.min.x), std::min(min.y, other.min.y)},
+            {std::max(max.x, other.max.x), std::max(max.y, other.max.y)}};
+  }
+
+  friend bool operator==(const Box&, const Box&) = default;
+};
+
+// Zero inside the box.
+inline double distance(Point p, const Box& box) {
+  const double dx = std::max({box.min.x - p.x, 0.0, p.x - box.max.x});
+  const double dy = std::max({box.min.y - p.y, 0.0, p.y - box.max.y});
+  return std::sqrt(dx * dx + dy * dy);
+}
+
+inline Box bounding_box(Point p) { return {p, p}; }
+inline Box bounding_box(const Box& box) { return box; }
+
+enum class Orientation : std::int8_t { Clockwise = -1, Collinear = 0, CounterClockwise = 1 };
+
+namespace geometry_detail {
+
+// Kernels of geometry_batch.cpp. The instruction set is picked from the CPU
+// features on first use.
+enum class GeometryIsa { Portable, Avx2, Avx512 };
+
+// Switches the kernels to the given instruction set, e.g. to compare them in
+// benchmarks. Returns false if the CPU or the build does not support it.
+bool select_geometry_isa(GeometryIsa isa);
+GeometryIsa active_geometry_isa();
+
+// Shewchuk's bound on the rounding error of the orientation determinant
+// relative to |left| + |right|, with the unit roundoff 2^-53.
+inline constexpr double kEpsilon = 0x1p-53;
+inline constexpr double kOrientationBound = (3 + 16 * kEpsilon) * kEpsilon;
+
+// The sign of (a - c) x (b - c), exactly.
+Orientation orientation_exact(Point a, Point b, Point c);
+
+}  // namespace geometry_detail
+
+// Which way a -> b -> c turns: CounterClockwise if c is left of the line
+// from a to b. Exact for all finite inputs.
+inline Orientation orientation(Point a, Point b, Point c) {
+  const double left = (a.x - c.x) * (b.y - c.y);
+  const double right = (a.y - c.y) * (b.x - c.x);
+  const double det = left - right;
+  const double bound = geometry_detail::kOrientationBound * (std::abs(left) + std::abs(right));
+  if (det > bound) {
+    return Orientation::CounterClockwise;
+  }
+  if (-det > bound) {
+    return Orientation::Clockwise;
+  }
+  return geometry_detail::orientation_exact(a, b, c);
+}
+
+// Many points, stored as an array of x and an array of y.
+class Points {
+ public:
+  Points() = default;
+  explicit Points(std::size_t count) : x_(count), y_(count) {}
+  Points(std::initializer_list<Point> points) {
+    reserve(points.size());
+    for (Point p : points) {
+      push_back(p);
+    }
+  }
+
+  std::size_t size() const noexcept { return x_.size(); }
+  bool empty() const noexcept { return x_.empty(); }
+
+  void reserve(std::size_t count) {
+    x_.reserve(count);
+    y_.reserve(count);
+  }
+  void clear() noexcept {
+    x_.clear();
+    y_.clear();
+  }
+  void push_back(Point p) {
+    x_.push_back(p.x);
+    y_.push_back(p.y);
+  }
+
+  Point operator[](std::size_t i) const noexcept { return {x_[i], y_[i]}; }
+  void set(std::size_t i, Point p) noexcept {
+    x_[i] = p.x;
+    y_[i] = p.y;
+  }
+
+  std::span<double> x() noexcept { return x_; }
+  std::span<const double> x() const noexcept { return x_; }
+  std::span<double> y() noexcept { return y_; }
+  std::span<const double> y() const noexcept { return y_; }
+
+  friend bool operator==(const Points&, const Points&) = default;
+
+ private:
+  std::vector<double> x_;
+  std::vector<double> y_;
+};
+
+// The directed line through a and b.
+struct Line {
+  Point a;
+  Point b;
+
+  // CounterClockwise for points left of the direction a -> b.
+  Orientation side(Point p) const { return orientation(a, b, p); }
+  // side() of every point. Throws std::invalid_argument unless out has
+  // points.size() elements, as do the other batch tests.
+  void side(const Points& points, std::span<Orientation> out) const;
+
+  double distance(Point p) const {
+    return std::abs(cross(b - a, p - a)) / std::hypot(b.x - a.x, b.y - a.y);
+  }
+};
+
+struct Circle {
+  Point center;
+  double radius = 0;
+
+  double area() const { return std::numbers::pi * radius * radius; }
+
+  // Points at most radius from the center.
+  bool contains(Point p) const {
+    const double dx = p.x - center.x;
+    const double dy = p.y - center.y;
+    return dx * dx + dy * dy <= radius * radius;
+  }
+  // 1 for points inside, 0 otherwise.
+  void contains(const Points& points, std::span<std::uint8_t> out) const;
+};
+
+inline Box bounding_box(const Circle& circle) {
+  const Point r{circle.radius, circle.radius};
+  return {circle.center - r, circle.center + r};
+}
+
+// Zero inside the circle.
+inline double distance(Point p, const Circle& circle) {
+  return std::max(distance(p, circle.center) - circle.radius, 0.0);
+}
+
+// Semi-axes along the directions angle and angle + pi/2 from the x axis.
+struct Ellipse {
+  Point center;
+  double semi_major = 0;
+  double semi_minor = 0;
+  double angle = 0;
+
+  double area() const { return std::numbers::pi * semi_major * semi_minor; }
+
+  bool contains(Point p) const {
+    const double cos = std::cos(angle);
+    const double sin = std::sin(angle);
+    const double dx = p.x - center.x;
+    const double dy = p.y - center.y;
+    const double u = (dx * cos + dy * sin) / semi_major;
+    const double v = (dy * cos - dx * sin) / semi_minor;
+    return u * u + v * v <= 1;
+  }
+  void contains(const Points& points, std::span<std::uint8_t> out) const;
+};
+
+inline Box bounding_box(const Ellipse& ellipse) {
+  const double cos = std::cos(ellipse.angle);
+  const double sin = std::sin(ellipse.angle);
+  const double a = ellipse.semi_major;
+  const double b = ellipse.semi_minor;
+  const Point half{std::hypot(a * cos, b * sin), std::hypot(a * sin, b * cos)};
+  return {ellipse.center - half, ellipse.center + half};
+}
+
+// A closed polygon through its vertices in order; the last one connects back
+// to the first. It may be non-convex; inside is decided by winding number,
+// so self-intersecting polygons follow the nonzero rule.
+class Polygon {
+ public:
+  Polygon() = default;
+  explicit Polygon(Points vertices) : vertices_(std::move(vertices)) {}
+  Polygon(std::initializer_list<Point> vertices) : vertices_(vertices) {}
+
+  const Points& vertices() const noexcept { return vertices_; }
+  std::size_t size() const noexcept { return vertices_.size(); }
+
+  // Positive for counterclockwise vertices.
+  double signed_area() const;
+  double area() const { return std::abs(signed_area()); }
+
+  // Exact; points on the boundary are inside.
+  bool contains(Point p) const;
+  // 1 for points inside, 0 otherwise.
+  void contains(const Points& points, std::span<std::uint8_t> out) const;
+
+  friend bool operator==(const Polygon&, const Polygon&) = default;
+
+ private:
+  Points vertices_;
+};
+
+// Empty for a polygon without vertices.
+Box bounding_box(const Polygon& polygon);
+// Zero inside or on the boundary, else the distance to the nearest edge.
+double distance(Point p, const Polygon& polygon);
+
+// The smallest convex polygon containing all points, counterclockwise from
+// the leftmost (then lowest) point, without repeated or collinear vertices.
+// O(n log n), exact.
+Polygon convex_hull(const Points& points);
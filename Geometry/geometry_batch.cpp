@@ -0,0 +1,205 @@
+// Batch tests of many points against one shape.
+//
+// Each kernel is written once with GCC vector extensions, in
+// geometry_batch_kernels.inc, and instantiated per vector width like the
+// Matrix micro-kernel: 16 bytes for the portable build (SSE2 on x86-64,
+// NEON on AArch64), 32 with AVX2, 64 with AVX-512, the widest supported
+// picked at first use. A final partial vector is padded with copies of the
+// last point.
+//
+// The orientation filter runs on whole vectors, branch free: every lane
+// whose determinant is within the rounding error bound is marked undecided,
+// and afterwards only those points go through the exact scalar predicate.
+// Decided lanes are exact, so they agree with orientation() however either
+// was compiled. The circle and ellipse tests are not; this file is built
+// with -ffp-contract=off so that they at least do not depend on the
+// instruction set picked.
+//
+// Batches of more than kChunk points are cut into chunks of that many and
+// run on ThreadPool::shared(), undecided lanes included.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+
+#include "Geometry/geometry.h"
+#include "ThreadPool/threadpool.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GEOMETRY_BATCH_X86 1
+#endif
+
+namespace geometry_detail {
+
+namespace {
+
+// Marks a lane the filter could not decide.
+constexpr std::int64_t kUndecided = 2;
+
+struct Kernels {
+  GeometryIsa isa;
+  void (*side)(const Line&, const double*, const double*, std::size_t, Orientation*);
+  void (*polygon)(const double*, const double*, std::size_t, const double*, const double*,
+                  std::size_t, std::uint8_t*);
+  void (*circle)(const Circle&, const double*, const double*, std::size_t, std::uint8_t*);
+  void (*ellipse)(const Ellipse&, double, double, const double*, const double*, std::size_t,
+                  std::uint8_t*);
+};
+
+namespace portable {
+constexpr std::size_t kBytes = 16;
+#define GEOMETRY_KERNEL
+#include "Geometry/geometry_batch_kernels.inc"
+#undef GEOMETRY_KERNEL
+}  // namespace portable
+
+constexpr Kernels kPortable{GeometryIsa::Portable, portable::side, portable::polygon,
+                            portable::circle, portable::ellipse};
+
+#if defined(GEOMETRY_BATCH_X86)
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+namespace avx2 {
+constexpr std::size_t kBytes = 32;
+#define GEOMETRY_KERNEL __attribute__((target("avx2")))
+#include "Geometry/geometry_batch_kernels.inc"
+#undef GEOMETRY_KERNEL
+}  // namespace avx2
+#pragma GCC pop_options
+
+constexpr Kernels kAvx2{GeometryIsa::Avx2, avx2::side, avx2::polygon, avx2::circle,
+                        avx2::ellipse};
+
+// AVX512DQ moves comparison masks into vectors in one instruction.
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512dq")
+namespace avx512 {
+constexpr std::size_t kBytes = 64;
+#define GEOMETRY_KERNEL __attribute__((target("avx512f,avx512dq")))
+#include "Geometry/geometry_batch_kernels.inc"
+#undef GEOMETRY_KERNEL
+}  // namespace avx512
+#pragma GCC pop_options
+
+constexpr Kernels kAvx512{GeometryIsa::Avx512, avx512::side, avx512::polygon, avx512::circle,
+                          avx512::ellipse};
+
+#endif  // GEOMETRY_BATCH_X86
+
+const Kernels* kernels_for(GeometryIsa isa) {
+  switch (isa) {
+#if defined(GEOMETRY_BATCH_X86)
+    case GeometryIsa::Avx2:
+      return __builtin_cpu_supports("avx2") ? &kAvx2 : nullptr;
+    case GeometryIsa::Avx512:
+      return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") ? &kAvx512
+                                                                             : nullptr;
+#endif
+    case GeometryIsa::Portable:
+      return &kPortable;
+    default:
+      return nullptr;
+  }
+}
+
+const Kernels* detect_kernels() {
+  for (GeometryIsa isa : {GeometryIsa::Avx512, GeometryIsa::Avx2}) {
+    if (const Kernels* found = kernels_for(isa)) {
+      return found;
+    }
+  }
+  return &kPortable;
+}
+
+constinit std::atomic<const Kernels*> active_kernels{nullptr};
+
+const Kernels& kernels() {
+  const Kernels* current = active_kernels.load(std::memory_order_relaxed);
+  if (current == nullptr) {
+    current = detect_kernels();
+    active_kernels.store(current, std::memory_order_relaxed);
+  }
+  return *current;
+}
+
+// Points per task of a parallel batch, a multiple of every vector width.
+constexpr std::size_t kChunk = std::size_t{1} << 15;
+
+// body(begin, end) over chunks covering [0, count).
+template <typename Body>
+void for_chunks(std::size_t count, Body&& body) {
+  ThreadPool::shared().parallel_for_ranges(0, count, body, kChunk);
+}
+
+template <typename T>
+void check_output(const Points& points, std::span<T> out) {
+  if (out.size() != points.size()) {
+    throw std::invalid_argument("Geometry: output size differs from the number of points");
+  }
+}
+
+}  // namespace
+
+bool select_geometry_isa(GeometryIsa isa) {
+  const Kernels* requested = kernels_for(isa);
+  if (requested == nullptr) {
+    return false;
+  }
+  active_kernels.store(requested, std::memory_order_relaxed);
+  return true;
+}
+
+GeometryIsa active_geometry_isa() { return kernels().isa; }
+
+}  // namespace geometry_detail
+
+void Line::side(const Points& points, std::span<Orientation> out) const {
+  geometry_detail::check_output(points, out);
+  geometry_detail::for_chunks(points.size(), [&](std::size_t begin, std::size_t end) {
+    geometry_detail::kernels().side(*this, points.x().data() + begin, points.y().data() + begin,
+                                    end - begin, out.data() + begin);
+    for (std::size_t i = begin; i < end; ++i) {
+      if (out[i] == static_cast<Orientation>(geometry_detail::kUndecided)) {
+        out[i] = geometry_detail::orientation_exact(a, b, points[i]);
+      }
+    }
+  });
+}
+
+void Circle::contains(const Points& points, std::span<std::uint8_t> out) const {
+  geometry_detail::check_output(points, out);
+  geometry_detail::for_chunks(points.size(), [&](std::size_t begin, std::size_t end) {
+    geometry_detail::kernels().circle(*this, points.x().data() + begin, points.y().data() + begin,
+                                      end - begin, out.data() + begin);
+  });
+}
+
+void Ellipse::contains(const Points& points, std::span<std::uint8_t> out) const {
+  geometry_detail::check_output(points, out);
+  const double cos_angle = std::cos(angle);
+  const double sin_angle = std::sin(angle);
+  geometry_detail::for_chunks(points.size(), [&](std::size_t begin, std::size_t end) {
+    geometry_detail::kernels().ellipse(*this, cos_angle, sin_angle, points.x().data() + begin,
+                                       points.y().data() + begin, end - begin, out.data() + begin);
+  });
+}
+
+void Polygon::contains(const Points& points, std::span<std::uint8_t> out) const {
+  geometry_detail::check_output(points, out);
+  geometry_detail::for_chunks(points.size(), [&](std::size_t begin, std::size_t end) {
+    geometry_detail::kernels().polygon(vertices_.x().data(), vertices_.y().data(), size(),
+                                       points.x().data() + begin, points.y().data() + begin,
+                                       end - begin, out.data() + begin);
+    for (std::size_t i = begin; i < end; ++i) {
+      if (out[i] == geometry_detail::kUndecided) {
+        out[i] = contains(points[i]);
+      }
+    }
+  });
+}
@@ -0,0 +1,749 @@
+#pragma once
+
+// Spatial indexes over anything with a bounding_box(): UniformGrid and RTree.
+//
+// Both own their items and name each by the index it was added at. A range
+// query visits every item whose bounding box intersects a box; refining
+// that to the shape itself is left to the caller. nearest() returns the k
+// items closest to a point by distance(p, item), for item types that have
+// one. Neither scans all items.
+//
+// UniformGrid<T> buckets items into square cells and lists an item in every
+// cell its box touches. Every cell's list is a slice of one shared array
+// with room to grow: a full slice moves to the end with twice the room, and
+// the array is compacted when the moved-out holes outweigh the entries. An
+// item in several cells is reported only from the first one a query
+// reaches, so queries need no duplicate set. The grid is the fastest index
+// for evenly spread items no larger than a cell and degrades with
+// clustering.
+//
+// RTree<T> is bulk-loaded with Sort-Tile-Recursive packing: the entries of a
+// level are sorted into vertical slices by the x of their centers, each
+// slice by y, and packed kFanout to a node, which is repeated up to the
+// root. Node boxes are kept as four arrays so that one node is tested in a
+// single vectorizable loop. insert() descends by least enlargement, as in
+// Guttman's R-tree, and splits a full node in halves along the axis on
+// which the centers are most spread. nearest() is a best-first search
+// ordered by distance to the node boxes.
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Geometry/geometry.h"
+
+template <typename T>
+concept Bounded = requires(const T& item) {
+  { bounding_box(item) } -> std::same_as<Box>;
+};
+
+template <typename T>
+concept Measurable = Bounded<T> && requires(const T& item, Point p) {
+  { distance(p, item) } -> std::convertible_to<double>;
+};
+
+namespace spatial_detail {
+
+// Items are named by 32-bit indices inside the indexes.
+inline constexpr std::size_t kMaxItems = std::numeric_limits<std::uint32_t>::max();
+
+inline void check_capacity(std::size_t size, const char* message) {
+  if (size >= kMaxItems) {
+    throw std::length_error(message);
+  }
+}
+
+// Whether distance(p, item) is the distance to bounding_box(item), which
+// the indexes keep, so that nearest() need not read the item itself.
+template <typename T>
+inline constexpr bool kBoxDistanceIsExact = std::same_as<T, Point> || std::same_as<T, Box>;
+
+// distance(p, box) squared, to compare without the square root.
+inline double squared_distance(Point p, const Box& box) {
+  const double dx = std::max(std::max(box.min.x - p.x, p.x - box.max.x), 0.0);
+  const double dy = std::max(std::max(box.min.y - p.y, p.y - box.max.y), 0.0);
+  return dx * dx + dy * dy;
+}
+
+// The distance from p to an item with the given box.
+template <typename T>
+double distance_to(Point p, const T& item, double box_distance) {
+  if constexpr (kBoxDistanceIsExact<T>) {
+    return box_distance;
+  } else {
+    return distance(p, item);
+  }
+}
+
+// The k nearest items seen so far, as a max-heap on distance.
+class NearestSet {
+ public:
+  explicit NearestSet(std::size_t k) : k_(k) { best_.reserve(k); }
+
+  // The distance an item has to beat to be kept.
+  double bound() const { return best_.size() < k_ ? HUGE_VAL : best_.front().first; }
+
+  void offer(double distance, std::size_t index) {
+    if (!(distance < bound())) {
+      return;
+    }
+    if (best_.size() == k_) {
+      std::pop_heap(best_.begin(), best_.end());
+      best_.pop_back();
+    }
+    best_.emplace_back(distance, index);
+    std::push_heap(best_.begin(), best_.end());
+  }
+
+  // For indexes that may offer one item more than once.
+  void offer_once(double distance, std::size_t index) {
+    if (distance < bound() &&
+        std::none_of(best_.begin(), best_.end(),
+                     [index](const auto& candidate) { return candidate.second == index; })) {
+      offer(distance, index);
+    }
+  }
+
+  // The indices by distance, ties by index.
+  std::vector<std::size_t> take() {
+    std::sort(best_.begin(), best_.end());
+    std::vector<std::size_t> result(best_.size());
+    for (std::size_t i = 0; i < best_.size(); ++i) {
+      result[i] = best_[i].second;
+    }
+    return result;
+  }
+
+ private:
+  std::size_t k_;
+  std::vector<std::pair<double, std::size_t>> best_;
+};
+
+}  // namespace spatial_detail
+
+template <Bounded T>
+class UniformGrid {
+ public:
+  // Items per cell the grid built from items aims at.
+  static constexpr double kItemsPerCell = 2;
+
+  // An empty grid over bounds with square cells of the given side. Items
+  // outside bounds are kept in the border cells, which stays correct but
+  // gets slow if there are many. Throws std::invalid_argument for empty
+  // bounds, a cell size that is not positive and finite, or more than
+  // 2^32 cells.
+  UniformGrid(const Box& bounds, double cell_size) { layout(bounds, cell_size); }
+
+  // A grid over the items' bounds with about kItemsPerCell items per cell,
+  // and cells at least as large as the items on average.
+  explicit UniformGrid(std::vector<T> items) : items_(std::move(items)) {
+    spatial_detail::check_capacity(items_.size(), "UniformGrid: too many items");
+    std::vector<Box> boxes;
+    boxes.reserve(items_.size());
+    Box bounds;
+    double extents = 0;
+    for (const T& item : items_) {
+      const Box& box = boxes.emplace_back(bounding_box(item));
+      bounds = bounds.united(box);
+      extents += std::max(box.max.x - box.min.x, box.max.y - box.min.y);
+    }
+    if (bounds.empty()) {
+      bounds = {{0, 0}, {1, 1}};
+    }
+    const double width = bounds.max.x - bounds.min.x;
+    const double height = bounds.max.y - bounds.min.y;
+    const auto count = static_cast<double>(std::max<std::size_t>(items_.size(), 1));
+    const double cells = std::max(count / kItemsPerCell, 1.0);
+    double cell = width > 0 && height > 0 ? std::sqrt(width * height / cells)
+                                          : std::max(width, height) / cells;
+    cell = std::max(cell, extents / count);
+    // Keeps the cell count near the target for thin bounds.
+    cell = std::max(cell, std::max(width, height) / (cells + 1));
+    layout(bounds, cell > 0 && std::isfinite(cell) ? cell : 1);
+
+    // Count, then fill every cell's slice exactly.
+    for (const Box& box : boxes) {
+      for_cells(range_of(box), [&](std::size_t cell) { ++cells_[cell].capacity; });
+    }
+    std::size_t begin = 0;
+    for (Cell& slice : cells_) {
+      slice.begin = static_cast<std::uint32_t>(begin);
+      begin += slice.capacity;
+      spatial_detail::check_capacity(begin, "UniformGrid: too many entries");
+    }
+    entries_.resize(begin);
+    live_ = begin;
+    for (std::size_t i = 0; i < boxes.size(); ++i) {
+      for_cells(range_of(boxes[i]), [&](std::size_t cell) {
+        Cell& slice = cells_[cell];
+        entries_[slice.begin + slice.size++] = {boxes[i], static_cast<std::uint32_t>(i)};
+      });
+    }
+  }
+
+  std::size_t size() const noexcept { return items_.size(); }
+  bool empty() const noexcept { return items_.empty(); }
+  const T& operator[](std::size_t index) const noexcept { return items_[index]; }
+  std::span<const T> items() const noexcept { return items_; }
+
+  const Box& bounds() const noexcept { return bounds_; }
+  double cell_size() const noexcept { return cell_size_; }
+
+  // Adds item and returns its index; amortized O(cells it touches).
+  std::size_t insert(T item) {
+    spatial_detail::check_capacity(items_.size(), "UniformGrid: too many items");
+    const Entry entry{bounding_box(item), static_cast<std::uint32_t>(items_.size())};
+    items_.push_back(std::move(item));
+    for_cells(range_of(entry.box), [&](std::size_t cell) { add(cell, entry); });
+    return entry.index;
+  }
+
+  // Calls visit(index) once for every item whose box intersects box.
+  template <typename Visit>
+  void query(const Box& box, Visit visit) const {
+    if (box.empty()) {
+      return;
+    }
+    const Range window = range_of(box);
+    for (std::size_t row = window.row_begin; row <= window.row_end; ++row) {
+      for (std::size_t column = window.column_begin; column <= window.column_end; ++column) {
+        for (const Entry& entry : slice(row * columns_ + column)) {
+          // Reported from the first cell of the window the item is in.
+          if (entry.box.intersects(box) &&
+              std::max(column_of(entry.box.min.x), window.column_begin) == column &&
+              std::max(row_of(entry.box.min.y), window.row_begin) == row) {
+            visit(static_cast<std::size_t>(entry.index));
+          }
+        }
+      }
+    }
+  }
+
+  std::vector<std::size_t> query(const Box& box) const {
+    std::vector<std::size_t> result;
+    query(box, [&](std::size_t index) { result.push_back(index); });
+    return result;
+  }
+
+  // The k items nearest to p, nearest first, searched ring by ring of
+  // cells around p's cell until the k-th is closer than the next ring.
+  std::vector<std::size_t> nearest(Point p, std::size_t k) const
+    requires Measurable<T>
+  {
+    spatial_detail::NearestSet best(k);
+    if (k == 0 || empty()) {
+      return best.take();
+    }
+    const auto column = static_cast<std::ptrdiff_t>(column_of(p.x));
+    const auto row = static_cast<std::ptrdiff_t>(row_of(p.y));
+    const auto columns = static_cast<std::ptrdiff_t>(columns_);
+    const auto rows = static_cast<std::ptrdiff_t>(rows_);
+    auto visit = [&](std::ptrdiff_t x, std::ptrdiff_t y) {
+      if (x < 0 || x >= columns || y < 0 || y >= rows) {
+        return;
+      }
+      for (const Entry& entry : slice(static_cast<std::size_t>(y * columns + x))) {
+        const double near = spatial_detail::squared_distance(p, entry.box);
+        const double bound = best.bound();
+        if (!(near < bound * bound)) {
+          continue;
+        }
+        const double reach =
+            spatial_detail::distance_to(p, items_[entry.index], std::sqrt(near));
+        if (column_of(entry.box.min.x) == column_of(entry.box.max.x) &&
+            row_of(entry.box.min.y) == row_of(entry.box.max.y)) {
+          best.offer(reach, entry.index);
+        } else {
+          best.offer_once(reach, entry.index);
+        }
+      }
+    };
+    for (std::ptrdiff_t ring = 0;; ++ring) {
+      if (ring == 0) {
+        visit(column, row);
+      } else {
+        for (std::ptrdiff_t x = std::max<std::ptrdiff_t>(column - ring, 0);
+             x <= std::min(column + ring, columns - 1); ++x) {
+          visit(x, row - ring);
+          visit(x, row + ring);
+        }
+        for (std::ptrdiff_t y = std::max<std::ptrdiff_t>(row - ring + 1, 0);
+             y <= std::min(row + ring - 1, rows - 1); ++y) {
+          visit(column - ring, y);
+          visit(column + ring, y);
+        }
+      }
+      // Unvisited items lie beyond a side of the visited square that is
+      // not the border of the grid; border cells also hold what is outside.
+      double reach = HUGE_VAL;
+      if (column - ring > 0) {
+        reach = std::min(reach, p.x - edge(bounds_.min.x, column - ring));
+      }
+      if (column + ring < columns - 1) {
+        reach = std::min(reach, edge(bounds_.min.x, column + ring + 1) - p.x);
+      }
+      if (row - ring > 0) {
+        reach = std::min(reach, p.y - edge(bounds_.min.y, row - ring));
+      }
+      if (row + ring < rows - 1) {
+        reach = std::min(reach, edge(bounds_.min.y, row + ring + 1) - p.y);
+      }
+      if (reach == HUGE_VAL || best.bound() <= reach) {
+        break;
+      }
+    }
+    return best.take();
+  }
+
+ private:
+  // Cells hold copies of the boxes so that a query reads them in order.
+  struct Entry {
+    Box box;
+    std::uint32_t index = 0;
+  };
+
+  struct Cell {
+    std::uint32_t begin = 0;
+    std::uint32_t size = 0;
+    std::uint32_t capacity = 0;
+  };
+
+  // Inclusive column and row ranges.
+  struct Range {
+    std::size_t column_begin;
+    std::size_t column_end;
+    std::size_t row_begin;
+    std::size_t row_end;
+  };
+
+  void layout(const Box& bounds, double cell_size) {
+    if (bounds.empty() || !std::isfinite(bounds.min.x) || !std::isfinite(bounds.min.y) ||
+        !std::isfinite(bounds.max.x) || !std::isfinite(bounds.max.y)) {
+      throw std::invalid_argument("UniformGrid: bounds must be finite and not empty");
+    }
+    if (!(cell_size > 0) || !std::isfinite(cell_size)) {
+      throw std::invalid_argument("UniformGrid: cell size must be positive and finite");
+    }
+    const double columns = std::floor((bounds.max.x - bounds.min.x) / cell_size) + 1;
+    const double rows = std::floor((bounds.max.y - bounds.min.y) / cell_size) + 1;
+    if (columns * rows > static_cast<double>(spatial_detail::kMaxItems)) {
+      throw std::invalid_argument("UniformGrid: too many cells");
+    }
+    bounds_ = bounds;
+    cell_size_ = cell_size;
+    inverse_ = 1 / cell_size;
+    columns_ = static_cast<std::size_t>(columns);
+    rows_ = static_cast<std::size_t>(rows);
+    cells_.resize(columns_ * rows_);
+  }
+
+  double edge(double origin, std::ptrdiff_t cell) const {
+    return origin + static_cast<double>(cell) * cell_size_;
+  }
+
+  std::size_t column_of(double x) const { return clamp((x - bounds_.min.x) * inverse_, columns_); }
+  std::size_t row_of(double y) const { return clamp((y - bounds_.min.y) * inverse_, rows_); }
+
+  static std::size_t clamp(double offset, std::size_t count) {
+    if (!(offset >= 0)) {
+      return 0;
+    }
+    return offset < static_cast<double>(count) ? static_cast<std::size_t>(offset) : count - 1;
+  }
+
+  Range range_of(const Box& box) const {
+    return {column_of(box.min.x), column_of(box.max.x), row_of(box.min.y), row_of(box.max.y)};
+  }
+
+  template <typename Fn>
+  void for_cells(const Range& range, Fn fn) const {
+    for (std::size_t row = range.row_begin; row <= range.row_end; ++row) {
+      for (std::size_t column = range.column_begin; column <= range.column_end; ++column) {
+        fn(row * columns_ + column);
+      }
+    }
+  }
+
+  std::span<const Entry> slice(std::size_t cell) const {
+    return {entries_.data() + cells_[cell].begin, cells_[cell].size};
+  }
+
+  void add(std::size_t cell, const Entry& entry) {
+    if (cells_[cell].size == cells_[cell].capacity) {
+      if (entries_.size() > 2 * live_ + 1024) {
+        compact();
+      }
+      Cell& slice = cells_[cell];
+      const std::size_t capacity = std::max<std::size_t>(4, 2 * std::size_t{slice.capacity});
+      spatial_detail::check_capacity(entries_.size() + capacity, "UniformGrid: too many entries");
+      const std::size_t begin = entries_.size();
+      entries_.resize(begin + capacity);
+      std::copy_n(entries_.begin() + slice.begin, slice.size, entries_.begin() + begin);
+      slice.begin = static_cast<std::uint32_t>(begin);
+      slice.capacity = static_cast<std::uint32_t>(capacity);
+    }
+    Cell& slice = cells_[cell];
+    entries_[slice.begin + slice.size++] = entry;
+    ++live_;
+  }
+
+  // Packs the slices without gaps, each with room for its entries only.
+  void compact() {
+    std::vector<Entry> packed;
+    packed.reserve(live_);
+    for (Cell& cell : cells_) {
+      const std::size_t begin = packed.size();
+      packed.insert(packed.end(), entries_.begin() + cell.begin,
+                    entries_.begin() + cell.begin + cell.size);
+      cell.begin = static_cast<std::uint32_t>(begin);
+      cell.capacity = cell.size;
+    }
+    entries_ = std::move(packed);
+  }
+
+  Box bounds_;
+  double cell_size_ = 0;
+  double inverse_ = 0;
+  std::size_t columns_ = 0;
+  std::size_t rows_ = 0;
+  std::vector<T> items_;
+  std::vector<Cell> cells_;
+  std::vector<Entry> entries_;
+  // Entries in use, the rest of entries_ being room to grow and holes.
+  std::size_t live_ = 0;
+};
+
+template <Bounded T>
+class RTree {
+ public:
+  // Entries per node.
+  static constexpr std::size_t kFanout = 16;
+
+  RTree() = default;
+
+  // Bulk-loads items with Sort-Tile-Recursive packing, O(n log n).
+  explicit RTree(std::vector<T> items) : items_(std::move(items)) {
+    spatial_detail::check_capacity(items_.size(), "RTree: too many items");
+    if (items_.empty()) {
+      return;
+    }
+    std::vector<Entry> level(items_.size());
+    for (std::size_t i = 0; i < items_.size(); ++i) {
+      level[i] = {bounding_box(items_[i]), static_cast<std::uint32_t>(i)};
+    }
+    for (std::uint32_t height = 0;; ++height) {
+      level = pack(std::move(level), height);
+      if (level.size() == 1) {
+        root_ = level.front().child;
+        height_ = height + 1;
+        return;
+      }
+    }
+  }
+
+  std::size_t size() const noexcept { return items_.size(); }
+  bool empty() const noexcept { return items_.empty(); }
+  const T& operator[](std::size_t index) const noexcept { return items_[index]; }
+  std::span<const T> items() const noexcept { return items_; }
+
+  // Levels of nodes, 0 for an empty tree.
+  std::size_t height() const noexcept { return height_; }
+
+  // Adds item and returns its index; O(log n).
+  std::size_t insert(T item) {
+    spatial_detail::check_capacity(items_.size(), "RTree: too many items");
+    const auto index = static_cast<std::uint32_t>(items_.size());
+    const Box box = bounding_box(item);
+    items_.push_back(std::move(item));
+    if (root_ == kNone) {
+      root_ = new_node(0);
+      nodes_[root_].append({box, index});
+      height_ = 1;
+      return index;
+    }
+
+    std::uint32_t path[kMaxHeight];
+    std::uint32_t slots[kMaxHeight];
+    std::size_t depth = 0;
+    std::uint32_t node = root_;
+    while (nodes_[node].level > 0) {
+      const std::uint32_t slot = nodes_[node].choose(box);
+      nodes_[node].set(slot, nodes_[node].box(slot).united(box), nodes_[node].child[slot]);
+      path[depth] = node;
+      slots[depth++] = slot;
+      node = nodes_[node].child[slot];
+    }
+
+    Entry pending{box, index};
+    while (nodes_[node].count == kFanout) {
+      const std::uint32_t sibling = split(node, pending);
+      if (depth == 0) {
+        root_ = new_node(nodes_[node].level + 1);
+        nodes_[root_].append({nodes_[node].bounds(), node});
+        nodes_[root_].append({nodes_[sibling].bounds(), sibling});
+        ++height_;
+        return index;
+      }
+      --depth;
+      const std::uint32_t parent = path[depth];
+      nodes_[parent].set(slots[depth], nodes_[node].bounds(), node);
+      pending = {nodes_[sibling].bounds(), sibling};
+      node = parent;
+    }
+    nodes_[node].append(pending);
+    return index;
+  }
+
+  // Calls visit(index) once for every item whose box intersects box.
+  template <typename Visit>
+  void query(const Box& box, Visit visit) const {
+    if (root_ != kNone && !box.empty()) {
+      query_node(root_, box, visit);
+    }
+  }
+
+  std::vector<std::size_t> query(const Box& box) const {
+    std::vector<std::size_t> result;
+    query(box, [&](std::size_t index) { result.push_back(index); });
+    return result;
+  }
+
+  // The k items nearest to p, nearest first.
+  std::vector<std::size_t> nearest(Point p, std::size_t k) const
+    requires Measurable<T>
+  {
+    spatial_detail::NearestSet best(k);
+    if (k != 0 && root_ != kNone) {
+      nearest_node(root_, p, best);
+    }
+    return best.take();
+  }
+
+ private:
+  static constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+  // Splits leave nodes at least half full, so 2^32 items need far fewer.
+  static constexpr std::size_t kMaxHeight = 32;
+
+  struct Entry {
+    Box box;
+    std::uint32_t child = 0;
+  };
+
+  // Children are items in leaves (level 0) and nodes above. Unused entries
+  // hold empty boxes, which intersect nothing.
+  struct Node {
+    alignas(64) double min_x[kFanout];
+    double min_y[kFanout];
+    double max_x[kFanout];
+    double max_y[kFanout];
+    std::uint32_t child[kFanout];
+    std::uint32_t count = 0;
+    std::uint32_t level = 0;
+
+    explicit Node(std::uint32_t height) : level(height) {
+      for (std::size_t slot = 0; slot < kFanout; ++slot) {
+        set(slot, Box{}, 0);
+      }
+    }
+
+    Box box(std::size_t slot) const {
+      return {{min_x[slot], min_y[slot]}, {max_x[slot], max_y[slot]}};
+    }
+    void set(std::size_t slot, const Box& box, std::uint32_t target) {
+      min_x[slot] = box.min.x;
+      min_y[slot] = box.min.y;
+      max_x[slot] = box.max.x;
+      max_y[slot] = box.max.y;
+      child[slot] = target;
+    }
+    void append(const Entry& entry) { set(count++, entry.box, entry.child); }
+
+    Box bounds() const {
+      Box result;
+      for (std::size_t slot = 0; slot < count; ++slot) {
+        result = result.united(box(slot));
+      }
+      return result;
+    }
+
+    // Bit i set if entry i intersects box.
+    std::uint32_t intersecting(const Box& box) const {
+      std::uint32_t mask = 0;
+      for (std::size_t slot = 0; slot < kFanout; ++slot) {
+        const bool hit = (min_x[slot] <= box.max.x) & (box.min.x <= max_x[slot]) &
+                         (min_y[slot] <= box.max.y) & (box.min.y <= max_y[slot]);
+        mask |= static_cast<std::uint32_t>(hit) << slot;
+      }
+      return mask;
+    }
+
+    // The squared distance from p to every entry, +inf for unused ones.
+    void squared_distances(Point p, double* out) const {
+      for (std::size_t slot = 0; slot < kFanout; ++slot) {
+        const double dx = std::max(std::max(min_x[slot] - p.x, p.x - max_x[slot]), 0.0);
+        const double dy = std::max(std::max(min_y[slot] - p.y, p.y - max_y[slot]), 0.0);
+        out[slot] = dx * dx + dy * dy;
+      }
+    }
+
+    // The entry whose box grows least in area to take box, then the smallest.
+    std::uint32_t choose(const Box& box) const {
+      std::uint32_t best = 0;
+      double best_growth = HUGE_VAL;
+      double best_area = HUGE_VAL;
+      for (std::uint32_t slot = 0; slot < count; ++slot) {
+        const double area = this->box(slot).area();
+        const double growth = this->box(slot).united(box).area() - area;
+        if (growth < best_growth || (growth == best_growth && area < best_area)) {
+          best = slot;
+          best_growth = growth;
+          best_area = area;
+        }
+      }
+      return best;
+    }
+  };
+
+  std::uint32_t new_node(std::uint32_t level) {
+    nodes_.emplace_back(level);
+    return static_cast<std::uint32_t>(nodes_.size() - 1);
+  }
+
+  static double center_x(const Entry& entry) { return entry.box.min.x + entry.box.max.x; }
+  static double center_y(const Entry& entry) { return entry.box.min.y + entry.box.max.y; }
+
+  // One STR level: packs entries into nodes of the given level and returns
+  // the entries for the level above.
+  std::vector<Entry> pack(std::vector<Entry> entries, std::uint32_t level) {
+    const std::size_t nodes = (entries.size() + kFanout - 1) / kFanout;
+    const auto slices = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(nodes))));
+    const std::size_t slice_size = slices * kFanout;
+    auto by_x = [](const Entry& lhs, const Entry& rhs) { return center_x(lhs) < center_x(rhs); };
+    auto by_y = [](const Entry& lhs, const Entry& rhs) { return center_y(lhs) < center_y(rhs); };
+    std::sort(entries.begin(), entries.end(), by_x);
+    std::vector<Entry> parents;
+    parents.reserve(nodes);
+    nodes_.reserve(nodes_.size() + nodes);
+    for (std::size_t begin = 0; begin < entries.size(); begin += slice_size) {
+      const std::size_t end = std::min(begin + slice_size, entries.size());
+      std::sort(entries.begin() + begin, entries.begin() + end, by_y);
+      for (std::size_t first = begin; first < end; first += kFanout) {
+        const std::uint32_t node = new_node(level);
+        for (std::size_t i = first; i < std::min(first + kFanout, end); ++i) {
+          nodes_[node].append(entries[i]);
+        }
+        parents.push_back({nodes_[node].bounds(), node});
+      }
+    }
+    return parents;
+  }
+
+  // Splits the full node plus extra in halves along the axis on which the
+  // entry centers spread most, keeping the lower half in node. Returns the
+  // new node with the upper half.
+  std::uint32_t split(std::uint32_t node, const Entry& extra) {
+    Entry entries[kFanout + 1];
+    for (std::uint32_t slot = 0; slot < kFanout; ++slot) {
+      entries[slot] = {nodes_[node].box(slot), nodes_[node].child[slot]};
+    }
+    entries[kFanout] = extra;
+    auto spread = [&](double (*center)(const Entry&)) {
+      const auto [low, high] = std::minmax_element(
+          std::begin(entries), std::end(entries),
+          [&](const Entry& lhs, const Entry& rhs) { return center(lhs) < center(rhs); });
+      return center(*high) - center(*low);
+    };
+    double (*center)(const Entry&) = spread(center_x) >= spread(center_y) ? center_x : center_y;
+    std::sort(std::begin(entries), std::end(entries),
+              [&](const Entry& lhs, const Entry& rhs) { return center(lhs) < center(rhs); });
+
+    const std::uint32_t sibling = new_node(nodes_[node].level);
+    const std::uint32_t level = nodes_[node].level;
+    nodes_[node] = Node(level);
+    constexpr std::size_t kHalf = (kFanout + 1) / 2;
+    for (std::size_t i = 0; i < kFanout + 1; ++i) {
+      nodes_[i < kHalf ? node : sibling].append(entries[i]);
+    }
+    return sibling;
+  }
+
+  // Starts loading a node, so that the misses on siblings overlap.
+  void prefetch(std::uint32_t index) const {
+    const auto* bytes = reinterpret_cast<const char*>(&nodes_[index]);
+    for (std::size_t offset = 0; offset < sizeof(Node); offset += 64) {
+      __builtin_prefetch(bytes + offset);
+    }
+  }
+
+  template <typename Visit>
+  void query_node(std::uint32_t index, const Box& box, Visit& visit) const {
+    const Node& node = nodes_[index];
+    const std::uint32_t hits = node.intersecting(box);
+    if (node.level == 0) {
+      for (std::uint32_t mask = hits; mask != 0; mask &= mask - 1) {
+        visit(static_cast<std::size_t>(node.child[std::countr_zero(mask)]));
+      }
+      return;
+    }
+    for (std::uint32_t mask = hits; mask != 0; mask &= mask - 1) {
+      prefetch(node.child[std::countr_zero(mask)]);
+    }
+    for (std::uint32_t mask = hits; mask != 0; mask &= mask - 1) {
+      query_node(node.child[std::countr_zero(mask)], box, visit);
+    }
+  }
+
+  // Branch and bound, as Roussopoulos et al.: children nearest first,
+  // stopping at the first one farther than the k-th item found so far.
+  // Children are picked by selection, as usually only one or two are
+  // visited.
+  void nearest_node(std::uint32_t index, Point p, spatial_detail::NearestSet& best) const
+    requires Measurable<T>
+  {
+    const Node& node = nodes_[index];
+    double reach[kFanout];
+    node.squared_distances(p, reach);
+    auto within = [&](double squared) {
+      const double bound = best.bound();
+      return squared < bound * bound;
+    };
+    if (node.level == 0) {
+      for (std::uint32_t slot = 0; slot < node.count; ++slot) {
+        if (within(reach[slot])) {
+          const std::uint32_t item = node.child[slot];
+          best.offer(spatial_detail::distance_to(p, items_[item], std::sqrt(reach[slot])), item);
+        }
+      }
+      return;
+    }
+    for (std::uint32_t slot = 0; slot < node.count; ++slot) {
+      if (within(reach[slot])) {
+        prefetch(node.child[slot]);
+      }
+    }
+    for (;;) {
+      std::uint32_t nearest = 0;
+      for (std::uint32_t slot = 1; slot < kFanout; ++slot) {
+        nearest = reach[slot] < reach[nearest] ? slot : nearest;
+      }
+      if (!within(reach[nearest])) {
+        return;
+      }
+      reach[nearest] = HUGE_VAL;
+      nearest_node(node.child[nearest], p, best);
+    }
+  }
+
+  std::vector<T> items_;
+  std::vector<Node> nodes_;
+  std::uint32_t root_ = kNone;
+  std::size_t height_ = 0;
+};
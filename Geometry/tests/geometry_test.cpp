@@ -0,0 +1,502 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Geometry/geometry.h"
+#include "Geometry/spatial_index.h"
+
+namespace {
+
+__extension__ using Int128 = __int128;
+
+// The sign of the orientation determinant in 128-bit integers, for
+// coordinates that are multiples of 2^-53 below 32 in magnitude.
+Orientation exact_orientation(Point a, Point b, Point c) {
+  const auto fixed = [](double v) { return static_cast<Int128>(std::ldexp(v, 53)); };
+  const Int128 det = (fixed(a.x) - fixed(c.x)) * (fixed(b.y) - fixed(c.y)) -
+                     (fixed(a.y) - fixed(c.y)) * (fixed(b.x) - fixed(c.x));
+  return det > 0 ? Orientation::CounterClockwise
+                 : det < 0 ? Orientation::Clockwise : Orientation::Collinear;
+}
+
+// Triples on a common line, each coordinate of c then moved by up to one
+// ulp either way; all coordinates in [1, 8).
+std::vector<Point> near_collinear(std::size_t count, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<std::int64_t> grid(1 << 20, 8 << 20);
+  std::uniform_int_distribution<int> step(0, 1024);
+  std::uniform_int_distribution<int> nudge(-1, 1);
+  const auto on_grid = [&] { return std::ldexp(static_cast<double>(grid(gen) - 1), -20); };
+  const auto moved = [&](double v) {
+    const int n = nudge(gen);
+    return n == 0 ? v : std::nextafter(v, n * HUGE_VAL);
+  };
+  std::vector<Point> points;
+  for (std::size_t i = 0; i < count; ++i) {
+    const Point a{on_grid(), on_grid()};
+    const Point b{on_grid(), on_grid()};
+    const double t = std::ldexp(step(gen), -10);
+    const Point c = a + (b - a) * t;
+    points.insert(points.end(), {a, b, {moved(c.x), moved(c.y)}});
+  }
+  return points;
+}
+
+Points random_points(std::size_t count, double low, double high, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> value(low, high);
+  Points points;
+  points.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const double x = value(gen);
+    points.push_back({x, value(gen)});
+  }
+  return points;
+}
+
+// A non-convex "comb" with vertices on the grid used by its test points.
+Polygon comb() {
+  return {{0, 0}, {4, 0}, {4, 3}, {3, 3}, {3, 1}, {2, 1}, {2, 3}, {1, 3}, {1, 1}, {0, 1}};
+}
+
+TEST(Orientation, SimpleTurns) {
+  EXPECT_EQ(orientation({0, 0}, {1, 0}, {0, 1}), Orientation::CounterClockwise);
+  EXPECT_EQ(orientation({0, 0}, {1, 0}, {0, -1}), Orientation::Clockwise);
+  EXPECT_EQ(orientation({0, 0}, {1, 1}, {3, 3}), Orientation::Collinear);
+  EXPECT_EQ(orientation({1, 1}, {1, 1}, {2, 5}), Orientation::Collinear);
+}
+
+// Kettner et al.'s example: near (0.5, 0.5) a plain floating-point
+// determinant gets the sign wrong for a large share of the points.
+TEST(Orientation, ExactNearTheDiagonal) {
+  const Point b{12, 12};
+  const Point c{24, 24};
+  for (int i = 0; i < 256; ++i) {
+    for (int j = 0; j < 256; ++j) {
+      const Point a{0.5 + std::ldexp(i, -53), 0.5 + std::ldexp(j, -53)};
+      ASSERT_EQ(orientation(a, b, c), exact_orientation(a, b, c)) << i << " " << j;
+    }
+  }
+}
+
+TEST(Orientation, ExactForNearlyCollinearTriples) {
+  const std::vector<Point> points = near_collinear(20000, 1);
+  for (std::size_t i = 0; i < points.size(); i += 3) {
+    ASSERT_EQ(orientation(points[i], points[i + 1], points[i + 2]),
+              exact_orientation(points[i], points[i + 1], points[i + 2]))
+        << i;
+  }
+}
+
+TEST(Points, StoresCoordinatesApart) {
+  Points points{{1, 2}, {3, 4}};
+  points.push_back({5, 6});
+  ASSERT_EQ(points.size(), 3u);
+  EXPECT_EQ(points[2], (Point{5, 6}));
+  EXPECT_EQ(points.x()[1], 3);
+  EXPECT_EQ(points.y()[1], 4);
+  points.set(0, {7, 8});
+  EXPECT_EQ(points[0], (Point{7, 8}));
+  points.clear();
+  EXPECT_TRUE(points.empty());
+}
+
+TEST(Box, ClosedAndEmptyByDefault) {
+  const Box box{{0, 0}, {2, 1}};
+  EXPECT_TRUE(box.contains({2, 1}));
+  EXPECT_FALSE(box.contains({2.5, 1}));
+  EXPECT_TRUE(box.intersects({{2, 1}, {3, 3}}));
+  EXPECT_FALSE(box.intersects({{2.1, 0}, {3, 3}}));
+  EXPECT_EQ(box.area(), 2);
+  EXPECT_EQ(distance({5, 5}, box), 5);
+  EXPECT_EQ(distance({1, 0.5}, box), 0);
+
+  const Box empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_EQ(empty.area(), 0);
+  EXPECT_EQ(empty.united(box), box);
+}
+
+TEST(Polygon, SignedArea) {
+  const Polygon square{{0, 0}, {2, 0}, {2, 2}, {0, 2}};
+  EXPECT_EQ(square.signed_area(), 4);
+  const Polygon clockwise{{0, 0}, {0, 2}, {2, 2}, {2, 0}};
+  EXPECT_EQ(clockwise.signed_area(), -4);
+  EXPECT_EQ(clockwise.area(), 4);
+  EXPECT_EQ(comb().area(), 8);
+  EXPECT_EQ(Polygon().area(), 0);
+}
+
+TEST(Polygon, ContainsWithTheBoundary) {
+  const Polygon polygon = comb();
+  EXPECT_TRUE(polygon.contains({0.5, 0.5}));
+  EXPECT_TRUE(polygon.contains({1.5, 2}));
+  EXPECT_FALSE(polygon.contains({2.5, 2}));
+  EXPECT_FALSE(polygon.contains({5, 0.5}));
+  EXPECT_TRUE(polygon.contains({0, 0}));
+  EXPECT_TRUE(polygon.contains({2.5, 1}));
+  EXPECT_TRUE(polygon.contains({4, 2}));
+  EXPECT_TRUE(polygon.contains({3, 3}));
+  EXPECT_FALSE(polygon.contains({2.5, 3}));
+}
+
+TEST(Polygon, SelfIntersectingFollowsNonzero) {
+  // A pentagram: the center is wound twice and stays inside.
+  const Polygon star{{0, 3}, {1.8, -2.4}, {-2.9, 1}, {2.9, 1}, {-1.8, -2.4}};
+  EXPECT_TRUE(star.contains({0, 0}));
+  EXPECT_TRUE(star.contains({0, 2.5}));
+  EXPECT_FALSE(star.contains({2.5, -2}));
+}
+
+TEST(Polygon, BoundingBoxAndDistance) {
+  const Polygon polygon = comb();
+  EXPECT_EQ(bounding_box(polygon), (Box{{0, 0}, {4, 3}}));
+  EXPECT_EQ(distance({2.5, 2}, polygon), 0.5);
+  EXPECT_EQ(distance({1.5, 2}, polygon), 0);
+  EXPECT_EQ(distance({7, 7}, polygon), 5);
+  EXPECT_TRUE(bounding_box(Polygon()).empty());
+}
+
+TEST(Shapes, CircleAndEllipse) {
+  const Circle circle{{1, 1}, 2};
+  EXPECT_TRUE(circle.contains({3, 1}));
+  EXPECT_FALSE(circle.contains({3, 1.1}));
+  EXPECT_EQ(bounding_box(circle), (Box{{-1, -1}, {3, 3}}));
+  EXPECT_EQ(distance({1, 6}, circle), 3);
+
+  const Ellipse ellipse{{0, 0}, 4, 1, std::numbers::pi / 2};
+  EXPECT_TRUE(ellipse.contains({0, 3.9}));
+  EXPECT_FALSE(ellipse.contains({3.9, 0}));
+  const Box box = bounding_box(ellipse);
+  EXPECT_NEAR(box.max.x, 1, 1e-12);
+  EXPECT_NEAR(box.max.y, 4, 1e-12);
+  EXPECT_DOUBLE_EQ(ellipse.area(), 4 * std::numbers::pi);
+}
+
+TEST(Line, SideAndDistance) {
+  const Line line{{0, 0}, {2, 0}};
+  EXPECT_EQ(line.side({1, 1}), Orientation::CounterClockwise);
+  EXPECT_EQ(line.side({1, -1}), Orientation::Clockwise);
+  EXPECT_EQ(line.side({5, 0}), Orientation::Collinear);
+  EXPECT_EQ(line.distance({1, -3}), 3);
+}
+
+TEST(ConvexHull, DropsInteriorAndCollinearPoints) {
+  const Points points{{0, 0}, {1, 0}, {2, 0}, {2, 2}, {1, 1}, {0, 2}, {0, 1}, {2, 2}, {0.5, 1.5}};
+  const Polygon hull = convex_hull(points);
+  EXPECT_EQ(hull, (Polygon{{0, 0}, {2, 0}, {2, 2}, {0, 2}}));
+}
+
+TEST(ConvexHull, DegenerateInputs) {
+  EXPECT_EQ(convex_hull(Points()).size(), 0u);
+  EXPECT_EQ(convex_hull(Points{{1, 1}, {1, 1}}), (Polygon{{1, 1}}));
+  EXPECT_EQ(convex_hull(Points{{2, 2}, {0, 0}, {1, 1}, {3, 3}}), (Polygon{{0, 0}, {3, 3}}));
+}
+
+TEST(ConvexHull, ContainsEveryPoint) {
+  const Points points = random_points(20000, -1, 1, 1);
+  const Polygon hull = convex_hull(points);
+  ASSERT_GE(hull.size(), 3u);
+  EXPECT_GT(hull.signed_area(), 0);
+  const Points& v = hull.vertices();
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    EXPECT_EQ(orientation(v[i], v[(i + 1) % v.size()], v[(i + 2) % v.size()]),
+              Orientation::CounterClockwise);
+  }
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    ASSERT_TRUE(hull.contains(points[i])) << i;
+  }
+}
+
+TEST(ConvexHull, ExactOnNearlyCollinearPoints) {
+  const std::vector<Point> triples = near_collinear(2000, 2);
+  Points points;
+  for (Point p : triples) {
+    points.push_back(p);
+  }
+  const Polygon hull = convex_hull(points);
+  const Points& v = hull.vertices();
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    ASSERT_EQ(exact_orientation(v[i], v[(i + 1) % v.size()], v[(i + 2) % v.size()]),
+              Orientation::CounterClockwise);
+  }
+}
+
+// Items of every size, from points to boxes a tenth of the extent, with
+// half of them in a small cluster.
+std::vector<Box> random_boxes(std::size_t count, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> position(0, 100);
+  std::uniform_real_distribution<double> cluster(40, 42);
+  std::exponential_distribution<double> extent(1);
+  std::vector<Box> boxes;
+  for (std::size_t i = 0; i < count; ++i) {
+    auto& place = i % 2 == 0 ? cluster : position;
+    const double x = place(gen);
+    const Point min{x, place(gen)};
+    const double w = i % 5 == 0 ? 0 : std::min(extent(gen), 10.0);
+    const double h = i % 5 == 0 ? 0 : std::min(extent(gen), 10.0);
+    boxes.push_back({min, {min.x + w, min.y + h}});
+  }
+  return boxes;
+}
+
+std::vector<Point> random_point_items(std::size_t count, unsigned seed) {
+  const Points points = random_points(count, 0, 100, seed);
+  std::vector<Point> items;
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    items.push_back(points[i]);
+  }
+  return items;
+}
+
+std::vector<Box> query_boxes(unsigned seed) {
+  std::vector<Box> boxes = random_boxes(200, seed);
+  boxes.push_back({{-1e9, -1e9}, {1e9, 1e9}});
+  boxes.push_back({{-10, -10}, {-5, -5}});
+  boxes.push_back({{41, 41}, {41, 41}});
+  boxes.push_back(Box());
+  return boxes;
+}
+
+// Range and nearest queries against a scan of all items.
+template <typename Index>
+void check_queries(const Index& index, unsigned seed) {
+  const auto items = index.items();
+  for (const Box& box : query_boxes(seed)) {
+    std::vector<std::size_t> expected;
+    for (std::size_t i = 0; i < items.size(); ++i) {
+      if (!box.empty() && bounding_box(items[i]).intersects(box)) {
+        expected.push_back(i);
+      }
+    }
+    std::vector<std::size_t> found = index.query(box);
+    std::sort(found.begin(), found.end());
+    ASSERT_EQ(found, expected);
+  }
+
+  using Item = typename std::decay_t<decltype(items)>::value_type;
+  if constexpr (Measurable<Item>) {
+    const Points probes = random_points(100, -20, 120, seed + 1);
+    for (std::size_t q = 0; q < probes.size(); ++q) {
+      const Point p = probes[q];
+      std::vector<double> all;
+      for (const auto& item : items) {
+        all.push_back(distance(p, item));
+      }
+      std::sort(all.begin(), all.end());
+      for (std::size_t k : {std::size_t{0}, std::size_t{1}, std::size_t{10}, items.size() + 3}) {
+        const std::vector<std::size_t> nearest = index.nearest(p, k);
+        ASSERT_EQ(nearest.size(), std::min(k, items.size())) << q << " " << k;
+        for (std::size_t i = 0; i < nearest.size(); ++i) {
+          ASSERT_EQ(distance(p, items[nearest[i]]), all[i]) << q << " " << k << " " << i;
+        }
+      }
+    }
+  }
+}
+
+TEST(UniformGrid, AnswersLikeAScan) {
+  check_queries(UniformGrid<Box>(random_boxes(5000, 1)), 2);
+  check_queries(UniformGrid<Point>(random_point_items(5000, 3)), 4);
+  std::vector<Circle> circles;
+  for (const Box& box : random_boxes(2000, 5)) {
+    circles.push_back({box.min, box.max.x - box.min.x});
+  }
+  check_queries(UniformGrid<Circle>(circles), 6);
+}
+
+TEST(UniformGrid, InsertsInsideAndOutsideItsBounds) {
+  UniformGrid<Box> grid(Box{{0, 0}, {50, 50}}, 4);
+  for (const Box& box : random_boxes(3000, 7)) {
+    grid.insert(box);
+  }
+  // Enough into one cell to move its slice and compact the array.
+  for (int i = 0; i < 3000; ++i) {
+    grid.insert(Box{{41, 41}, {41.5, 41.5}});
+  }
+  EXPECT_EQ(grid.size(), 6000u);
+  check_queries(grid, 8);
+
+  UniformGrid<Point> built(random_point_items(1000, 9));
+  for (Point p : random_point_items(1000, 10)) {
+    built.insert(p * 1.5);
+  }
+  check_queries(built, 11);
+}
+
+TEST(UniformGrid, DegenerateLayouts) {
+  EXPECT_THROW((UniformGrid<Point>(Box(), 1)), std::invalid_argument);
+  EXPECT_THROW((UniformGrid<Point>(Box{{0, 0}, {1, 1}}, 0)), std::invalid_argument);
+  EXPECT_THROW((UniformGrid<Point>(Box{{0, 0}, {1, 1}}, HUGE_VAL)), std::invalid_argument);
+
+  const UniformGrid<Point> empty{std::vector<Point>()};
+  EXPECT_TRUE(empty.nearest({0, 0}, 3).empty());
+  EXPECT_TRUE(empty.query({{0, 0}, {1, 1}}).empty());
+
+  // All on one vertical line, and all on one point.
+  std::vector<Point> line;
+  std::vector<Point> same;
+  for (int i = 0; i < 500; ++i) {
+    line.push_back({3, i * 0.5});
+    same.push_back({3, 3});
+  }
+  check_queries(UniformGrid<Point>(line), 12);
+  check_queries(UniformGrid<Point>(same), 13);
+}
+
+TEST(RTree, AnswersLikeAScan) {
+  check_queries(RTree<Box>(random_boxes(5000, 1)), 2);
+  check_queries(RTree<Point>(random_point_items(5000, 3)), 4);
+  std::vector<Polygon> triangles;
+  for (const Box& box : random_boxes(1000, 5)) {
+    triangles.push_back({box.min, {box.max.x, box.min.y}, box.max});
+  }
+  check_queries(RTree<Polygon>(triangles), 6);
+}
+
+TEST(RTree, PacksFullNodes) {
+  EXPECT_EQ(RTree<Point>().height(), 0u);
+  EXPECT_EQ(RTree<Point>(random_point_items(1, 1)).height(), 1u);
+  EXPECT_EQ(RTree<Point>(random_point_items(256, 2)).height(), 2u);
+  EXPECT_EQ(RTree<Point>(random_point_items(257, 3)).height(), 3u);
+  EXPECT_EQ(RTree<Point>(random_point_items(4096, 4)).height(), 3u);
+}
+
+TEST(RTree, InsertsIntoEmptyAndBulkLoadedTrees) {
+  RTree<Box> tree;
+  for (const Box& box : random_boxes(5000, 7)) {
+    tree.insert(box);
+  }
+  EXPECT_EQ(tree.size(), 5000u);
+  check_queries(tree, 8);
+
+  RTree<Point> built(random_point_items(3000, 9));
+  for (Point p : random_point_items(3000, 10)) {
+    built.insert(p * 1.5 - Point{20, 20});
+  }
+  check_queries(built, 11);
+
+  // Identical boxes make every split choose between equals.
+  RTree<Box> same;
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(same.insert(Box{{1, 1}, {2, 2}}), static_cast<std::size_t>(i));
+  }
+  EXPECT_EQ(same.query(Box{{1.5, 1.5}, {1.5, 1.5}}).size(), 1000u);
+  EXPECT_TRUE(same.query(Box{{3, 3}, {4, 4}}).empty());
+}
+
+// Every kernel the CPU supports gives the scalar answers.
+class GeometryBatch : public testing::TestWithParam<geometry_detail::GeometryIsa> {
+ protected:
+  void SetUp() override {
+    previous_ = geometry_detail::active_geometry_isa();
+    if (!geometry_detail::select_geometry_isa(GetParam())) {
+      GTEST_SKIP() << "instruction set not supported here";
+    }
+  }
+  void TearDown() override { geometry_detail::select_geometry_isa(previous_); }
+
+ private:
+  geometry_detail::GeometryIsa previous_ = geometry_detail::GeometryIsa::Portable;
+};
+
+// Sizes around the vector widths and beyond one parallel chunk.
+constexpr std::size_t kSizes[] = {0, 1, 7, 8, 9, 1003, 100003};
+
+TEST_P(GeometryBatch, LineSide) {
+  const std::vector<Point> triples = near_collinear(40000, 3);
+  const Line line{triples[0], triples[1]};
+  for (std::size_t size : kSizes) {
+    Points points;
+    for (std::size_t i = 0; i < size; ++i) {
+      points.push_back(i % 2 == 0 ? triples[3 * (i % 40000) + 2]
+                                  : line.a + (line.b - line.a) * std::ldexp(i % 64, -6));
+    }
+    std::vector<Orientation> out(size);
+    line.side(points, out);
+    for (std::size_t i = 0; i < size; ++i) {
+      ASSERT_EQ(out[i], line.side(points[i])) << size << " " << i;
+    }
+  }
+}
+
+TEST_P(GeometryBatch, PolygonContains) {
+  const Polygon polygon = comb();
+  std::mt19937 gen(4);
+  std::uniform_int_distribution<int> grid(-4, 20);
+  for (std::size_t size : kSizes) {
+    // Quarter steps land on edges and vertices often.
+    Points points = random_points(size, -1, 5, 5);
+    for (std::size_t i = 0; i < size; i += 2) {
+      points.set(i, {grid(gen) / 4.0, grid(gen) / 4.0});
+    }
+    std::vector<std::uint8_t> out(size);
+    polygon.contains(points, out);
+    for (std::size_t i = 0; i < size; ++i) {
+      ASSERT_EQ(out[i] != 0, polygon.contains(points[i])) << size << " " << i;
+    }
+  }
+}
+
+// Circle and ellipse tests are plain floating point, so points within
+// rounding of the boundary are not compared.
+TEST_P(GeometryBatch, CircleAndEllipseContains) {
+  const Circle circle{{0.5, -0.25}, 1.5};
+  const Ellipse ellipse{{0.5, -0.25}, 2, 0.75, 0.6};
+  for (std::size_t size : kSizes) {
+    const Points points = random_points(size, -3, 3, 6);
+    std::vector<std::uint8_t> in_circle(size);
+    std::vector<std::uint8_t> in_ellipse(size);
+    circle.contains(points, in_circle);
+    ellipse.contains(points, in_ellipse);
+    for (std::size_t i = 0; i < size; ++i) {
+      const Point p = points[i];
+      const bool inner_circle = Circle{circle.center, circle.radius * (1 - 1e-9)}.contains(p);
+      if (inner_circle == Circle{circle.center, circle.radius * (1 + 1e-9)}.contains(p)) {
+        ASSERT_EQ(in_circle[i] != 0, inner_circle) << size << " " << i;
+      }
+      Ellipse inner = ellipse;
+      inner.semi_major *= 1 - 1e-9;
+      inner.semi_minor *= 1 - 1e-9;
+      Ellipse outer = ellipse;
+      outer.semi_major *= 1 + 1e-9;
+      outer.semi_minor *= 1 + 1e-9;
+      if (inner.contains(p) == outer.contains(p)) {
+        ASSERT_EQ(in_ellipse[i] != 0, inner.contains(p)) << size << " " << i;
+      }
+    }
+  }
+}
+
+TEST_P(GeometryBatch, RejectsAMismatchedOutput) {
+  const Points points = random_points(10, 0, 1, 7);
+  std::vector<std::uint8_t> out(9);
+  EXPECT_THROW(comb().contains(points, out), std::invalid_argument);
+  EXPECT_THROW((Circle{{0, 0}, 1}.contains(points, out)), std::invalid_argument);
+  std::vector<Orientation> sides(11);
+  EXPECT_THROW((Line{{0, 0}, {1, 1}}.side(points, sides)), std::invalid_argument);
+}
+
+std::string isa_name(const testing::TestParamInfo<geometry_detail::GeometryIsa>& info) {
+  constexpr const char* kNames[] = {"Portable", "Avx2", "Avx512"};
+  return kNames[static_cast<int>(info.param)];
+}
+
+INSTANTIATE_TEST_SUITE_P(Isa, GeometryBatch,
+                         testing::Values(geometry_detail::GeometryIsa::Portable,
+                                         geometry_detail::GeometryIsa::Avx2,
+                                         geometry_detail::GeometryIsa::Avx512),
+                         isa_name);
+
+}  // namespace
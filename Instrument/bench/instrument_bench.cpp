@@ -0,0 +1,89 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <sstream>
+
+#include "Instrument/instrument.h"
+#include "ThreadPool/threadpool.h"
+#include "UnorderedMap/unorderedmap.h"
+
+namespace {
+
+// What one hook costs on the hot path. Built without PORTFOLIO_INSTRUMENT
+// these measure an empty loop, which is the point of compiling them out.
+
+void label(benchmark::State& state) {
+  state.SetLabel(kInstrumentEnabled ? "instrumented" : "compiled out");
+}
+
+void BM_Count(benchmark::State& state) {
+  std::uint64_t i = 0;
+  for (auto _ : state) {
+    PORTFOLIO_COUNT("bench.count", 1);
+    benchmark::DoNotOptimize(++i);
+  }
+  label(state);
+}
+BENCHMARK(BM_Count);
+
+void BM_Record(benchmark::State& state) {
+  std::uint64_t i = 0;
+  for (auto _ : state) {
+    PORTFOLIO_RECORD("bench.record", i & 0xFFFF);
+    benchmark::DoNotOptimize(++i);
+  }
+  label(state);
+}
+BENCHMARK(BM_Record);
+
+void BM_Scope(benchmark::State& state) {
+  set_tracing(state.range(0) != 0);
+  std::uint64_t i = 0;
+  for (auto _ : state) {
+    PORTFOLIO_SCOPE("bench.scope");
+    benchmark::DoNotOptimize(++i);
+  }
+  set_tracing(true);
+  label(state);
+}
+BENCHMARK(BM_Scope)->ArgName("tracing")->Arg(0)->Arg(1);
+
+// The hooks inside a library: lookups record their probe length.
+void BM_MapFind(benchmark::State& state) {
+  UnorderedMap<std::uint64_t, std::uint64_t> map;
+  for (std::uint64_t i = 0; i < (1 << 16); ++i) {
+    map.emplace(i, i);
+  }
+  std::uint64_t key = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(key++ & 0xFFFF));
+  }
+  label(state);
+}
+BENCHMARK(BM_MapFind);
+
+// A task per element: one span and a few counters each.
+void BM_ParallelFor(benchmark::State& state) {
+  ThreadPool pool;
+  for (auto _ : state) {
+    pool.parallel_for(0, 1 << 12, [](std::size_t i) { benchmark::DoNotOptimize(i); }, 1);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) << 12);
+  label(state);
+}
+BENCHMARK(BM_ParallelFor)->UseRealTime();
+
+void BM_ChromeTrace(benchmark::State& state) {
+  for (int i = 0; i < 1 << 13; ++i) {
+    PORTFOLIO_SCOPE("bench.trace");
+  }
+  for (auto _ : state) {
+    std::ostringstream out;
+    write_chrome_trace(out);
+    benchmark::DoNotOptimize(out.str().size());
+  }
+  label(state);
+}
+BENCHMARK(BM_ChromeTrace);
+
+}  // namespace
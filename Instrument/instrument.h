@@ -0,0 +1,618 @@
+#pragma once
+
+// Counters, histograms and trace spans for hot paths, compiled out unless
+// the build sets PORTFOLIO_INSTRUMENT (the CMake option of that name).
+//
+//   PORTFOLIO_COUNT("threadpool.steal", 1);
+//   PORTFOLIO_RECORD("unorderedmap.probe_groups", seq.probes());
+//   PORTFOLIO_SCOPE("unorderedmap.rehash");
+//
+// Without PORTFOLIO_INSTRUMENT the macros expand to nothing and their
+// arguments are not evaluated. With it, each registers its name once, on
+// first use, and from then on only touches memory of the calling thread:
+// every thread has its own block of counters and histograms, written by
+// that thread alone with relaxed loads and stores, and read by whoever
+// takes a snapshot. There is no lock and no read-modify-write on the way.
+// Metrics with the same name merge, including from different translation
+// units; past kMaxCounters or kMaxHistograms names, new ones are dropped.
+//
+// Histograms are log-linear in the manner of HdrHistogram: exact below 16,
+// then eight buckets per power of two, so any recorded value is known to
+// within 12.5%. The maximum is exact. A scope records its duration in
+// timestamp-counter ticks (rdtsc on x86, the virtual counter on ARM) into
+// a histogram of its name and, while tracing is on, appends a span to a
+// ring of the thread's last kTraceEvents spans; rare slow calls are kept
+// there even when sampling profilers miss them. write_chrome_trace() writes
+// the rings as Chrome trace JSON, which chrome://tracing and Perfetto open.
+//
+// A thread that exits gives its block to the next thread that starts, so
+// totals keep what it counted and memory is bounded by the most threads
+// alive at once.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifndef PORTFOLIO_INSTRUMENT
+#define PORTFOLIO_INSTRUMENT 0
+#endif
+
+inline constexpr bool kInstrumentEnabled = PORTFOLIO_INSTRUMENT != 0;
+
+namespace instrument_detail {
+
+inline constexpr std::size_t kMaxCounters = 256;
+inline constexpr std::size_t kMaxHistograms = 64;
+inline constexpr std::size_t kTraceEvents = std::size_t{1} << 13;
+inline constexpr std::uint32_t kDropped = ~std::uint32_t{0};
+
+// Exact below 2 * kSub, then kSub buckets per power of two.
+inline constexpr unsigned kSubBits = 3;
+inline constexpr std::uint64_t kSub = std::uint64_t{1} << kSubBits;
+inline constexpr std::size_t kBuckets = (64 - kSubBits + 1) * kSub;
+
+constexpr std::size_t bucket_index(std::uint64_t value) {
+  if (value < 2 * kSub) {
+    return static_cast<std::size_t>(value);
+  }
+  const auto shift = static_cast<unsigned>(std::bit_width(value)) - 1 - kSubBits;
+  return static_cast<std::size_t>((shift + 1) * kSub + (value >> shift) - kSub);
+}
+
+// Smallest and largest value of a bucket.
+constexpr std::uint64_t bucket_low(std::size_t index) {
+  if (index < 2 * kSub) {
+    return index;
+  }
+  const std::size_t shift = index / kSub - 1;
+  return (index % kSub + kSub) << shift;
+}
+constexpr std::uint64_t bucket_high(std::size_t index) {
+  return index < 2 * kSub ? index : bucket_low(index) + (std::uint64_t{1} << (index / kSub - 1)) - 1;
+}
+
+static_assert(bucket_index(2 * kSub - 1) == 2 * kSub - 1 && bucket_index(2 * kSub) == 2 * kSub);
+static_assert(bucket_index(~std::uint64_t{0}) == kBuckets - 1);
+static_assert(bucket_high(kBuckets - 1) == ~std::uint64_t{0});
+
+inline std::uint64_t ticks() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  std::uint64_t value;
+  __asm__ volatile("mrs %0, cntvct_el0" : "=r"(value));
+  return value;
+#else
+  return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Only the owning thread writes, so an increment needs no atomic RMW.
+inline void bump(std::atomic<std::uint64_t>& cell, std::uint64_t amount) noexcept {
+  cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+struct HistogramCells {
+  std::array<std::atomic<std::uint64_t>, kBuckets> buckets{};
+  std::atomic<std::uint64_t> count{0};
+  std::atomic<std::uint64_t> sum{0};
+  std::atomic<std::uint64_t> max{0};
+
+  void record(std::uint64_t value) noexcept {
+    bump(buckets[bucket_index(value)], 1);
+    bump(count, 1);
+    bump(sum, value);
+    if (value > max.load(std::memory_order_relaxed)) {
+      max.store(value, std::memory_order_relaxed);
+    }
+  }
+};
+
+// One span, guarded like a seqlock: seq is zeroed before the fields are
+// written and set to the span's position after, so a reader that sees the
+// same position before and after copying has a whole span.
+struct TraceEvent {
+  std::atomic<std::uint64_t> seq{0};
+  std::atomic<std::uint64_t> name_and_thread{0};
+  std::atomic<std::uint64_t> start{0};
+  std::atomic<std::uint64_t> duration{0};
+};
+
+struct TraceRing {
+  std::array<TraceEvent, kTraceEvents> events{};
+  std::atomic<std::uint64_t> head{0};
+
+  void append(std::uint32_t name, std::uint32_t thread, std::uint64_t start,
+              std::uint64_t duration) noexcept {
+    const std::uint64_t position = head.load(std::memory_order_relaxed);
+    TraceEvent& event = events[position % kTraceEvents];
+    event.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name_and_thread.store(std::uint64_t{name} << 32 | thread, std::memory_order_relaxed);
+    event.start.store(start, std::memory_order_relaxed);
+    event.duration.store(duration, std::memory_order_relaxed);
+    event.seq.store(position + 1, std::memory_order_release);
+    head.store(position + 1, std::memory_order_release);
+  }
+};
+
+struct ThreadData {
+  std::array<std::atomic<std::uint64_t>, kMaxCounters> counters{};
+  std::array<std::atomic<HistogramCells*>, kMaxHistograms> histograms{};
+  std::atomic<TraceRing*> trace{nullptr};
+  std::uint32_t thread = 0;
+  ThreadData* next_free = nullptr;
+};
+
+enum class HistogramKind { Values, Ticks };
+
+class Registry {
+ public:
+  Registry() : start_ticks_(ticks()), start_time_(std::chrono::steady_clock::now()) {}
+
+  std::uint32_t counter_id(std::string_view name) {
+    std::lock_guard lock(mutex_);
+    return id_in(counter_names_, kMaxCounters, name);
+  }
+
+  std::uint32_t histogram_id(std::string_view name, HistogramKind kind) {
+    std::lock_guard lock(mutex_);
+    const std::uint32_t id = id_in(histogram_names_, kMaxHistograms, name);
+    if (id != kDropped && id == histogram_kinds_.size()) {
+      histogram_kinds_.push_back(kind);
+    }
+    return id;
+  }
+
+  std::uint32_t span_id(std::string_view name) {
+    std::lock_guard lock(mutex_);
+    return id_in(span_names_, std::numeric_limits<std::uint32_t>::max(), name);
+  }
+
+  // A block for a starting thread, or nullptr if there is no memory.
+  ThreadData* attach() noexcept {
+    std::lock_guard lock(mutex_);
+    ThreadData* data = free_;
+    if (data != nullptr) {
+      free_ = data->next_free;
+    } else {
+      data = new (std::nothrow) ThreadData();
+      if (data == nullptr) {
+        return nullptr;
+      }
+      threads_.push_back(data);
+    }
+    data->thread = ++thread_count_;
+    return data;
+  }
+
+  void detach(ThreadData* data) noexcept {
+    std::lock_guard lock(mutex_);
+    data->next_free = free_;
+    free_ = data;
+  }
+
+  // Runs f(names, kinds, span names, blocks) under the registry lock.
+  template <typename F>
+  decltype(auto) inspect(F&& f) {
+    std::lock_guard lock(mutex_);
+    return f(std::as_const(counter_names_), std::as_const(histogram_names_),
+             std::as_const(histogram_kinds_), std::as_const(span_names_),
+             std::as_const(threads_));
+  }
+
+  // Nanoseconds per tick, measured over the life of the process so far and
+  // at least 10 ms of it.
+  double ns_per_tick() const {
+    using Clock = std::chrono::steady_clock;
+    while (Clock::now() - start_time_ < std::chrono::milliseconds(10)) {
+    }
+    const std::uint64_t elapsed_ticks = ticks() - start_ticks_;
+    const auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start_time_);
+    return elapsed_ticks == 0 ? 1.0 : elapsed.count() / static_cast<double>(elapsed_ticks);
+  }
+
+  std::uint64_t start_ticks() const noexcept { return start_ticks_; }
+
+  bool tracing() const noexcept { return tracing_.load(std::memory_order_relaxed); }
+  void set_tracing(bool enabled) noexcept { tracing_.store(enabled, std::memory_order_relaxed); }
+
+ private:
+  static std::uint32_t id_in(std::vector<std::string>& names, std::size_t limit,
+                             std::string_view name) {
+    auto it = std::find(names.begin(), names.end(), name);
+    if (it != names.end()) {
+      return static_cast<std::uint32_t>(it - names.begin());
+    }
+    if (names.size() == limit) {
+      return kDropped;
+    }
+    names.emplace_back(name);
+    return static_cast<std::uint32_t>(names.size() - 1);
+  }
+
+  std::mutex mutex_;
+  std::vector<std::string> counter_names_;
+  std::vector<std::string> histogram_names_;
+  std::vector<HistogramKind> histogram_kinds_;
+  std::vector<std::string> span_names_;
+  std::vector<ThreadData*> threads_;
+  ThreadData* free_ = nullptr;
+  std::uint32_t thread_count_ = 0;
+  std::uint64_t start_ticks_;
+  std::chrono::steady_clock::time_point start_time_;
+  std::atomic<bool> tracing_{true};
+};
+
+// Never destroyed, so that threads still counting at exit find it.
+inline Registry& registry() {
+  static Registry* const instance = new Registry();
+  return *instance;
+}
+
+// Trivially destructible, so it is usable for the whole life of the thread;
+// the first attach registers Detach, which hands the block back and marks
+// the thread done.
+struct ThreadState {
+  ThreadData* data = nullptr;
+  bool done = false;
+};
+
+inline constinit thread_local ThreadState thread_state;
+
+struct Detach {
+  Detach() = default;
+  Detach(const Detach&) = delete;
+  Detach& operator=(const Detach&) = delete;
+
+  ~Detach() {
+    if (thread_state.data != nullptr) {
+      registry().detach(thread_state.data);
+    }
+    thread_state = ThreadState{nullptr, true};
+  }
+};
+
+inline thread_local Detach detach_at_exit;
+
+inline ThreadData* attach_slow() noexcept {
+  if (thread_state.done) {
+    return nullptr;
+  }
+  // Odr-uses detach_at_exit, which has the thread register its destructor.
+  [[maybe_unused]] Detach* volatile registration = &detach_at_exit;
+  thread_state.data = registry().attach();
+  return thread_state.data;
+}
+
+inline ThreadData* local() noexcept {
+  ThreadData* data = thread_state.data;
+  return data != nullptr ? data : attach_slow();
+}
+
+inline void count(std::uint32_t id, std::uint64_t amount) noexcept {
+  if (id == kDropped) {
+    return;
+  }
+  if (ThreadData* data = local()) {
+    bump(data->counters[id], amount);
+  }
+}
+
+inline void record(std::uint32_t id, std::uint64_t value) noexcept {
+  if (id == kDropped) {
+    return;
+  }
+  ThreadData* data = local();
+  if (data == nullptr) {
+    return;
+  }
+  HistogramCells* cells = data->histograms[id].load(std::memory_order_relaxed);
+  if (cells == nullptr) {
+    cells = new (std::nothrow) HistogramCells();
+    if (cells == nullptr) {
+      return;
+    }
+    data->histograms[id].store(cells, std::memory_order_release);
+  }
+  cells->record(value);
+}
+
+inline void trace(std::uint32_t span, std::uint64_t start, std::uint64_t duration) noexcept {
+  if (!registry().tracing()) {
+    return;
+  }
+  ThreadData* data = local();
+  if (data == nullptr) {
+    return;
+  }
+  TraceRing* ring = data->trace.load(std::memory_order_relaxed);
+  if (ring == nullptr) {
+    ring = new (std::nothrow) TraceRing();
+    if (ring == nullptr) {
+      return;
+    }
+    data->trace.store(ring, std::memory_order_release);
+  }
+  ring->append(span, data->thread, start, duration);
+}
+
+class ScopedTimer {
+ public:
+  ScopedTimer(std::uint32_t histogram, std::uint32_t span) noexcept
+      : histogram_(histogram), span_(span), start_(ticks()) {}
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+  ~ScopedTimer() {
+    const std::uint64_t duration = ticks() - start_;
+    record(histogram_, duration);
+    trace(span_, start_, duration);
+  }
+
+ private:
+  std::uint32_t histogram_;
+  std::uint32_t span_;
+  std::uint64_t start_;
+};
+
+inline void write_json_string(std::ostream& out, std::string_view text) {
+  out << '"';
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      constexpr char kHex[] = "0123456789abcdef";
+      out << "\\u00" << kHex[(c >> 4) & 0xF] << kHex[c & 0xF];
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+}  // namespace instrument_detail
+
+#if PORTFOLIO_INSTRUMENT
+
+#define PORTFOLIO_INSTRUMENT_CONCAT2(a, b) a##b
+#define PORTFOLIO_INSTRUMENT_CONCAT(a, b) PORTFOLIO_INSTRUMENT_CONCAT2(a, b)
+
+// Adds amount to the counter name, a string literal.
+#define PORTFOLIO_COUNT(name, amount)                                                     \
+  do {                                                                                    \
+    static const std::uint32_t portfolio_counter_id =                                     \
+        ::instrument_detail::registry().counter_id(name);                                 \
+    ::instrument_detail::count(portfolio_counter_id, static_cast<std::uint64_t>(amount)); \
+  } while (false)
+
+// Records value in the histogram name.
+#define PORTFOLIO_RECORD(name, value)                                                      \
+  do {                                                                                     \
+    static const std::uint32_t portfolio_histogram_id =                                    \
+        ::instrument_detail::registry().histogram_id(                                      \
+            name, ::instrument_detail::HistogramKind::Values);                             \
+    ::instrument_detail::record(portfolio_histogram_id, static_cast<std::uint64_t>(value)); \
+  } while (false)
+
+// Times the rest of the enclosing block into the histogram name and, while
+// tracing is on, the thread's trace ring.
+#define PORTFOLIO_SCOPE(name)                                                          \
+  static const std::uint32_t PORTFOLIO_INSTRUMENT_CONCAT(portfolio_scope_histogram_,    \
+                                                         __LINE__) =                   \
+      ::instrument_detail::registry().histogram_id(                                    \
+          name, ::instrument_detail::HistogramKind::Ticks);                            \
+  static const std::uint32_t PORTFOLIO_INSTRUMENT_CONCAT(portfolio_scope_span_, __LINE__) = \
+      ::instrument_detail::registry().span_id(name);                                   \
+  const ::instrument_detail::ScopedTimer PORTFOLIO_INSTRUMENT_CONCAT(portfolio_scope_,  \
+                                                                     __LINE__)(        \
+      PORTFOLIO_INSTRUMENT_CONCAT(portfolio_scope_histogram_, __LINE__),               \
+      PORTFOLIO_INSTRUMENT_CONCAT(portfolio_scope_span_, __LINE__))
+
+#else
+
+#define PORTFOLIO_COUNT(name, amount) static_cast<void>(0)
+#define PORTFOLIO_RECORD(name, value) static_cast<void>(0)
+#define PORTFOLIO_SCOPE(name) static_cast<void>(0)
+
+#endif
+
+struct HistogramSnapshot {
+  std::string name;
+  // Ticks for scopes; scale converts them to nanoseconds. 1 otherwise.
+  double scale = 1.0;
+  std::uint64_t count = 0;
+  std::uint64_t sum = 0;
+  std::uint64_t max = 0;
+  std::array<std::uint64_t, instrument_detail::kBuckets> buckets{};
+
+  double mean() const {
+    return count == 0 ? 0.0 : scale * static_cast<double>(sum) / static_cast<double>(count);
+  }
+
+  // The value below which a fraction q of the records lie, to within a
+  // bucket; q is clamped to [0, 1]. Scaled, as mean().
+  double percentile(double q) const {
+    if (count == 0) {
+      return 0.0;
+    }
+    q = std::clamp(q, 0.0, 1.0);
+    const auto rank =
+        std::max<std::uint64_t>(1, static_cast<std::uint64_t>(q * static_cast<double>(count) + 0.5));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets.size(); ++i) {
+      seen += buckets[i];
+      if (seen >= rank) {
+        return scale * static_cast<double>(std::min(instrument_detail::bucket_high(i), max));
+      }
+    }
+    return scale * static_cast<double>(max);
+  }
+};
+
+struct InstrumentSnapshot {
+  std::vector<std::pair<std::string, std::uint64_t>> counters;
+  std::vector<HistogramSnapshot> histograms;
+
+  // 0 for a counter never touched.
+  std::uint64_t counter(std::string_view name) const {
+    for (const auto& [counter_name, value] : counters) {
+      if (counter_name == name) {
+        return value;
+      }
+    }
+    return 0;
+  }
+
+  // nullptr for a histogram never touched.
+  const HistogramSnapshot* histogram(std::string_view name) const {
+    for (const HistogramSnapshot& histogram : histograms) {
+      if (histogram.name == name) {
+        return &histogram;
+      }
+    }
+    return nullptr;
+  }
+};
+
+// Totals over all threads so far. Threads that keep counting meanwhile
+// show up partly.
+inline InstrumentSnapshot instrument_snapshot() {
+  using namespace instrument_detail;
+  const double ns_per_tick = registry().ns_per_tick();
+  return registry().inspect([&](const auto& counter_names, const auto& histogram_names,
+                                const auto& histogram_kinds, const auto&, const auto& threads) {
+    InstrumentSnapshot snapshot;
+    for (std::size_t id = 0; id < counter_names.size(); ++id) {
+      std::uint64_t total = 0;
+      for (const ThreadData* data : threads) {
+        total += data->counters[id].load(std::memory_order_relaxed);
+      }
+      snapshot.counters.emplace_back(counter_names[id], total);
+    }
+    for (std::size_t id = 0; id < histogram_names.size(); ++id) {
+      HistogramSnapshot& histogram = snapshot.histograms.emplace_back();
+      histogram.name = histogram_names[id];
+      histogram.scale = histogram_kinds[id] == HistogramKind::Ticks ? ns_per_tick : 1.0;
+      for (const ThreadData* data : threads) {
+        const HistogramCells* cells = data->histograms[id].load(std::memory_order_acquire);
+        if (cells == nullptr) {
+          continue;
+        }
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+          histogram.buckets[i] += cells->buckets[i].load(std::memory_order_relaxed);
+        }
+        histogram.count += cells->count.load(std::memory_order_relaxed);
+        histogram.sum += cells->sum.load(std::memory_order_relaxed);
+        histogram.max = std::max(histogram.max, cells->max.load(std::memory_order_relaxed));
+      }
+    }
+    return snapshot;
+  });
+}
+
+// Turns recording of spans on or off for all threads; on at start. Scopes
+// still feed their histograms while it is off.
+inline void set_tracing(bool enabled) noexcept {
+  instrument_detail::registry().set_tracing(enabled);
+}
+
+// The spans still in the threads' rings as complete ("X") events, and the
+// counters as counter ("C") events at the time of the call, in the Chrome
+// trace event format. Times are microseconds since the process started
+// counting.
+inline void write_chrome_trace(std::ostream& out) {
+  using namespace instrument_detail;
+  const double us_per_tick = registry().ns_per_tick() / 1000.0;
+  const std::uint64_t origin = registry().start_ticks();
+  const InstrumentSnapshot totals = instrument_snapshot();
+  const double now = static_cast<double>(ticks() - origin) * us_per_tick;
+  const std::ios_base::fmtflags flags = out.flags();
+  const std::streamsize precision = out.precision();
+  out.setf(std::ios_base::fixed, std::ios_base::floatfield);
+  out.precision(3);
+  registry().inspect([&](const auto&, const auto&, const auto&, const auto& span_names,
+                         const auto& threads) {
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    const auto separate = [&] {
+      out << (first ? "\n" : ",\n");
+      first = false;
+    };
+    for (const ThreadData* data : threads) {
+      const TraceRing* ring = data->trace.load(std::memory_order_acquire);
+      if (ring == nullptr) {
+        continue;
+      }
+      const std::uint64_t head = ring->head.load(std::memory_order_acquire);
+      for (std::uint64_t position = head > kTraceEvents ? head - kTraceEvents : 0;
+           position < head; ++position) {
+        const TraceEvent& event = ring->events[position % kTraceEvents];
+        if (event.seq.load(std::memory_order_acquire) != position + 1) {
+          continue;
+        }
+        const std::uint64_t name_and_thread =
+            event.name_and_thread.load(std::memory_order_relaxed);
+        const std::uint64_t start = event.start.load(std::memory_order_relaxed);
+        const std::uint64_t duration = event.duration.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (event.seq.load(std::memory_order_relaxed) != position + 1) {
+          continue;
+        }
+        const auto name = static_cast<std::size_t>(name_and_thread >> 32);
+        if (name >= span_names.size()) {
+          continue;
+        }
+        separate();
+        out << "{\"name\":";
+        write_json_string(out, span_names[name]);
+        out << ",\"cat\":\"portfolio\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+            << static_cast<std::uint32_t>(name_and_thread)
+            << ",\"ts\":" << static_cast<double>(start - origin) * us_per_tick
+            << ",\"dur\":" << static_cast<double>(duration) * us_per_tick << '}';
+      }
+    }
+    for (const auto& [name, value] : totals.counters) {
+      separate();
+      out << "{\"name\":";
+      write_json_string(out, name);
+      out << ",\"cat\":\"portfolio\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" << now
+          << ",\"args\":{\"value\":" << value << "}}";
+    }
+    out << "\n]}\n";
+  });
+  out.flags(flags);
+  out.precision(precision);
+}
+
+// Counters, and count, mean, p50, p99, p99.9 and max of every histogram,
+// one per line; scope times in nanoseconds.
+inline void write_instrument_report(std::ostream& out) {
+  const InstrumentSnapshot snapshot = instrument_snapshot();
+  for (const auto& [name, value] : snapshot.counters) {
+    out << name << ' ' << value << '\n';
+  }
+  for (const HistogramSnapshot& histogram : snapshot.histograms) {
+    out << histogram.name << " count=" << histogram.count << " mean=" << histogram.mean()
+        << " p50=" << histogram.percentile(0.5) << " p99=" << histogram.percentile(0.99)
+        << " p999=" << histogram.percentile(0.999)
+        << " max=" << histogram.scale * static_cast<double>(histogram.max) << '\n';
+  }
+}
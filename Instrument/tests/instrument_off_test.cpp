@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+// This suite checks the macros compiled out, whatever PORTFOLIO_INSTRUMENT
+// says for the rest of the build. It links no library built the other way.
+#undef PORTFOLIO_INSTRUMENT
+
+#include "Instrument/instrument.h"
+
+namespace {
+
+static_assert(!kInstrumentEnabled);
+
+TEST(InstrumentOff, ArgumentsAreNotEvaluated) {
+  int evaluated = 0;
+  PORTFOLIO_COUNT("off.count", ++evaluated);
+  PORTFOLIO_RECORD("off.record", ++evaluated);
+  {
+    PORTFOLIO_SCOPE("off.scope");
+  }
+  // Still usable as a single statement.
+  if (evaluated == 0)
+    PORTFOLIO_COUNT("off.count", ++evaluated);
+  else
+    PORTFOLIO_RECORD("off.record", ++evaluated);
+  EXPECT_EQ(evaluated, 0);
+}
+
+TEST(InstrumentOff, NothingIsRecorded) {
+  PORTFOLIO_COUNT("off.count", 1);
+  PORTFOLIO_RECORD("off.record", 1);
+  {
+    PORTFOLIO_SCOPE("off.scope");
+  }
+  const InstrumentSnapshot snapshot = instrument_snapshot();
+  EXPECT_TRUE(snapshot.counters.empty());
+  EXPECT_TRUE(snapshot.histograms.empty());
+
+  std::ostringstream out;
+  write_chrome_trace(out);
+  EXPECT_EQ(out.str(), "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n]}\n");
+  std::ostringstream report;
+  write_instrument_report(report);
+  EXPECT_EQ(report.str(), "");
+}
+
+}  // namespace
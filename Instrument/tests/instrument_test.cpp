@@ -0,0 +1,319 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// This suite checks the macros themselves, so it compiles them in whatever
+// PORTFOLIO_INSTRUMENT says for the rest of the build. It links no library
+// built the other way.
+#undef PORTFOLIO_INSTRUMENT
+#define PORTFOLIO_INSTRUMENT 1
+
+#include "Instrument/instrument.h"
+#include "StackAllocator/stackallocator.h"
+#include "UnorderedMap/unorderedmap.h"
+
+namespace {
+
+using instrument_detail::bucket_high;
+using instrument_detail::bucket_index;
+using instrument_detail::bucket_low;
+using instrument_detail::kBuckets;
+
+static_assert(kInstrumentEnabled);
+
+std::uint64_t counter(std::string_view name) {
+  return instrument_snapshot().counter(name);
+}
+
+std::uint64_t histogram_count(std::string_view name) {
+  const InstrumentSnapshot snapshot = instrument_snapshot();
+  const HistogramSnapshot* histogram = snapshot.histogram(name);
+  return histogram == nullptr ? 0 : histogram->count;
+}
+
+std::string chrome_trace() {
+  std::ostringstream out;
+  write_chrome_trace(out);
+  return out.str();
+}
+
+std::size_t occurrences(std::string_view text, std::string_view pattern) {
+  std::size_t count = 0;
+  for (std::size_t at = text.find(pattern); at != std::string_view::npos;
+       at = text.find(pattern, at + pattern.size())) {
+    ++count;
+  }
+  return count;
+}
+
+std::size_t thread_blocks() {
+  return instrument_detail::registry().inspect(
+      [](const auto&, const auto&, const auto&, const auto&, const auto& threads) {
+        return threads.size();
+      });
+}
+
+TEST(InstrumentBuckets, TileEveryValue) {
+  EXPECT_EQ(bucket_low(0), 0u);
+  for (std::size_t i = 0; i + 1 < kBuckets; ++i) {
+    ASSERT_LE(bucket_low(i), bucket_high(i)) << i;
+    ASSERT_EQ(bucket_high(i) + 1, bucket_low(i + 1)) << i;
+  }
+  EXPECT_EQ(bucket_high(kBuckets - 1), ~std::uint64_t{0});
+}
+
+TEST(InstrumentBuckets, AreExactBelowSixteenThenWithinAnEighth) {
+  for (std::uint64_t value = 0; value < 16; ++value) {
+    EXPECT_EQ(bucket_low(bucket_index(value)), value);
+    EXPECT_EQ(bucket_high(bucket_index(value)), value);
+  }
+  std::vector<std::uint64_t> values;
+  for (std::uint64_t value = 16; value < 5000; ++value) {
+    values.push_back(value);
+  }
+  for (unsigned bit = 5; bit < 64; ++bit) {
+    const std::uint64_t power = std::uint64_t{1} << bit;
+    values.insert(values.end(), {power - 1, power, power + 1, power + power / 3});
+  }
+  values.push_back(~std::uint64_t{0});
+  for (std::uint64_t value : values) {
+    const std::size_t index = bucket_index(value);
+    ASSERT_LE(bucket_low(index), value) << value;
+    ASSERT_GE(bucket_high(index), value) << value;
+    ASSERT_LE(bucket_high(index) - bucket_low(index), bucket_low(index) / 8) << value;
+  }
+}
+
+TEST(Instrument, CountersMergeAcrossCallSites) {
+  const std::uint64_t before = counter("test.merge");
+  for (int i = 0; i < 10; ++i) {
+    PORTFOLIO_COUNT("test.merge", 1);
+  }
+  PORTFOLIO_COUNT("test.merge", 32);
+  EXPECT_EQ(counter("test.merge"), before + 42);
+  EXPECT_EQ(counter("test.never_counted"), 0u);
+
+  auto& registry = instrument_detail::registry();
+  EXPECT_EQ(registry.counter_id("test.merge"), registry.counter_id("test.merge"));
+  EXPECT_NE(registry.counter_id("test.merge"), registry.counter_id("test.other"));
+}
+
+TEST(Instrument, ArgumentsAreEvaluatedOnce) {
+  const std::uint64_t before = counter("test.once");
+  int evaluated = 0;
+  PORTFOLIO_COUNT("test.once", ++evaluated);
+  PORTFOLIO_RECORD("test.once", ++evaluated);
+  EXPECT_EQ(evaluated, 2);
+  // Usable as a single statement.
+  if (evaluated == 2)
+    PORTFOLIO_COUNT("test.once", 1);
+  else
+    PORTFOLIO_COUNT("test.once", 100);
+  EXPECT_EQ(counter("test.once"), before + 2);
+}
+
+TEST(Instrument, TotalsKeepWhatExitedThreadsCounted) {
+  const std::uint64_t before = counter("test.threads");
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([] {
+      for (int i = 0; i < 1000; ++i) {
+        PORTFOLIO_COUNT("test.threads", 1);
+        PORTFOLIO_RECORD("test.thread_values", i);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(counter("test.threads"), before + 4000);
+  EXPECT_GE(histogram_count("test.thread_values"), 4000u);
+}
+
+TEST(Instrument, ExitedThreadsHandTheirBlocksOn) {
+  std::thread([] { PORTFOLIO_COUNT("test.reuse", 1); }).join();
+  const std::size_t blocks = thread_blocks();
+  const std::uint64_t before = counter("test.reuse");
+  for (int i = 0; i < 20; ++i) {
+    std::thread([] { PORTFOLIO_COUNT("test.reuse", 1); }).join();
+  }
+  EXPECT_EQ(thread_blocks(), blocks);
+  EXPECT_EQ(counter("test.reuse"), before + 20);
+}
+
+TEST(Instrument, HistogramsKeepCountSumAndMax) {
+  for (std::uint64_t value = 1; value <= 1000; ++value) {
+    PORTFOLIO_RECORD("test.values", value);
+  }
+  const InstrumentSnapshot snapshot = instrument_snapshot();
+  const HistogramSnapshot* values = snapshot.histogram("test.values");
+  ASSERT_NE(values, nullptr);
+  EXPECT_EQ(values->count, 1000u);
+  EXPECT_EQ(values->sum, 500500u);
+  EXPECT_EQ(values->max, 1000u);
+  EXPECT_DOUBLE_EQ(values->scale, 1.0);
+  EXPECT_DOUBLE_EQ(values->mean(), 500.5);
+  for (double q : {0.1, 0.5, 0.9, 0.99}) {
+    const double exact = q * 1000;
+    EXPECT_GE(values->percentile(q), exact) << q;
+    EXPECT_LE(values->percentile(q), exact * 1.125) << q;
+  }
+  EXPECT_DOUBLE_EQ(values->percentile(0.0), 1.0);
+  EXPECT_DOUBLE_EQ(values->percentile(1.0), 1000.0);
+  EXPECT_DOUBLE_EQ(values->percentile(2.0), 1000.0);
+  EXPECT_EQ(snapshot.histogram("test.never_recorded"), nullptr);
+}
+
+TEST(Instrument, SmallValuesAreExact) {
+  for (std::uint64_t value = 0; value < 16; ++value) {
+    for (std::uint64_t times = 0; times <= value; ++times) {
+      PORTFOLIO_RECORD("test.small", value);
+    }
+  }
+  const InstrumentSnapshot snapshot = instrument_snapshot();
+  const HistogramSnapshot* small = snapshot.histogram("test.small");
+  ASSERT_NE(small, nullptr);
+  for (std::uint64_t value = 0; value < 16; ++value) {
+    EXPECT_EQ(small->buckets[value], value + 1);
+  }
+  EXPECT_DOUBLE_EQ(small->percentile(0.5), 11.0);
+}
+
+TEST(Instrument, ScopesTimeInNanoseconds) {
+  for (int i = 0; i < 100; ++i) {
+    PORTFOLIO_SCOPE("test.scope");
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+  const InstrumentSnapshot snapshot = instrument_snapshot();
+  const HistogramSnapshot* scope = snapshot.histogram("test.scope");
+  ASSERT_NE(scope, nullptr);
+  EXPECT_EQ(scope->count, 100u);
+  EXPECT_GT(scope->scale, 0.0);
+  EXPECT_GE(scope->mean(), 50000.0 * 0.9);
+  EXPECT_GE(scope->percentile(1.0), scope->percentile(0.5));
+  EXPECT_EQ(occurrences(chrome_trace(), "\"name\":\"test.scope\""), 100u);
+}
+
+TEST(Instrument, TracingOffStillFeedsTheHistograms) {
+  set_tracing(false);
+  for (int i = 0; i < 10; ++i) {
+    PORTFOLIO_SCOPE("test.untraced");
+  }
+  set_tracing(true);
+  EXPECT_EQ(histogram_count("test.untraced"), 10u);
+  EXPECT_EQ(occurrences(chrome_trace(), "test.untraced"), 0u);
+}
+
+TEST(Instrument, TheRingKeepsTheLatestSpans) {
+  for (std::size_t i = 0; i < 2 * instrument_detail::kTraceEvents + 5; ++i) {
+    PORTFOLIO_SCOPE("test.ring");
+  }
+  EXPECT_EQ(occurrences(chrome_trace(), "\"name\":\"test.ring\""),
+            instrument_detail::kTraceEvents);
+}
+
+TEST(Instrument, WritesChromeTraceJson) {
+  PORTFOLIO_COUNT("test.trace_counter", 7);
+  std::thread([] { PORTFOLIO_SCOPE("test.\"quoted\"\\\n"); }).join();
+  const std::string trace = chrome_trace();
+  EXPECT_EQ(trace.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", 0), 0u);
+  EXPECT_EQ(trace.substr(trace.size() - 4), "\n]}\n");
+  EXPECT_NE(trace.find("{\"name\":\"test.\\\"quoted\\\"\\\\\\u000a\",\"cat\":\"portfolio\","
+                       "\"ph\":\"X\",\"pid\":1,\"tid\":"),
+            std::string::npos);
+  EXPECT_NE(trace.find("{\"name\":\"test.trace_counter\",\"cat\":\"portfolio\",\"ph\":\"C\""),
+            std::string::npos);
+  EXPECT_NE(trace.find(",\"args\":{\"value\":7}}"), std::string::npos);
+  EXPECT_EQ(trace.find("}{"), std::string::npos);
+  EXPECT_EQ(trace.find(",\n]"), std::string::npos);
+}
+
+TEST(Instrument, LeavesTheStreamFormattingAlone) {
+  std::ostringstream out;
+  out.precision(2);
+  write_chrome_trace(out);
+  out.str("");
+  out << 1.5;
+  EXPECT_EQ(out.str(), "1.5");
+  EXPECT_EQ(out.precision(), 2);
+}
+
+TEST(Instrument, ReadsWhileThreadsWrite) {
+  std::atomic<bool> stop = false;
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 3; ++t) {
+    writers.emplace_back([&stop] {
+      while (!stop.load(std::memory_order_relaxed)) {
+        PORTFOLIO_SCOPE("test.concurrent");
+        PORTFOLIO_COUNT("test.concurrent", 1);
+      }
+    });
+  }
+  std::uint64_t last = 0;
+  for (int round = 0; round < 20; ++round) {
+    const std::uint64_t now = counter("test.concurrent");
+    EXPECT_GE(now, last);
+    last = now;
+    EXPECT_EQ(chrome_trace().find("\"dur\":-"), std::string::npos);
+  }
+  stop = true;
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+}
+
+TEST(Instrument, ReportsEveryMetric) {
+  PORTFOLIO_COUNT("test.report", 3);
+  PORTFOLIO_RECORD("test.report_values", 5);
+  std::ostringstream out;
+  write_instrument_report(out);
+  const std::string report = "\n" + out.str();
+  EXPECT_NE(report.find("\ntest.report 3\n"), std::string::npos);
+  EXPECT_NE(report.find("\ntest.report_values count=1 mean=5 p50=5 p99=5 p999=5 max=5\n"),
+            std::string::npos);
+}
+
+TEST(InstrumentHooks, UnorderedMapRecordsProbesAndRehashes) {
+  const std::uint64_t probes = histogram_count("unorderedmap.probe_groups");
+  const std::uint64_t rehashes = histogram_count("unorderedmap.rehash");
+  UnorderedMap<int, int> map;
+  for (int key = 0; key < 1000; ++key) {
+    map.emplace(key, key);
+  }
+  EXPECT_GT(histogram_count("unorderedmap.rehash"), rehashes);
+
+  const std::uint64_t before = histogram_count("unorderedmap.probe_groups");
+  EXPECT_GT(before, probes);
+  for (int key = 0; key < 2000; ++key) {
+    map.find(key);
+  }
+  EXPECT_EQ(histogram_count("unorderedmap.probe_groups"), before + 2000);
+}
+
+TEST(InstrumentHooks, StackAllocatorCountsFrees) {
+  const std::uint64_t allocations = counter("stackallocator.allocate");
+  const std::uint64_t reclaimed = counter("stackallocator.reclaimed");
+  const std::uint64_t held = counter("stackallocator.held");
+  const std::uint64_t exhausted = counter("stackallocator.exhausted");
+  StackStorage<256> storage;
+  void* first = storage.allocate(64, 8);
+  void* second = storage.allocate(64, 8);
+  storage.deallocate(first, 64);
+  storage.deallocate(second, 64);
+  EXPECT_THROW(storage.allocate(1024, 8), std::bad_alloc);
+  EXPECT_EQ(counter("stackallocator.allocate"), allocations + 2);
+  EXPECT_EQ(counter("stackallocator.reclaimed"), reclaimed + 1);
+  EXPECT_EQ(counter("stackallocator.held"), held + 1);
+  EXPECT_EQ(counter("stackallocator.exhausted"), exhausted + 1);
+}
+
+}  // namespace
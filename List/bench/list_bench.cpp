@@ -0,0 +1,84 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <list>
+#include <random>
+#include <vector>
+
+#include "List/list.h"
+
+namespace {
+
+template <typename Container>
+Container random_list(std::size_t count, unsigned seed) {
+  std::mt19937 gen(seed);
+  Container container;
+  for (std::size_t i = 0; i < count; ++i) {
+    container.push_back(static_cast<int>(gen()));
+  }
+  return container;
+}
+
+// Keeps state.range(0) elements and replaces one per step: erase at the
+// front, insert in the middle. This is where node reuse pays off.
+template <typename Container>
+void BM_Churn(benchmark::State& state) {
+  auto count = static_cast<std::size_t>(state.range(0));
+  Container container = random_list<Container>(count, 1);
+  auto middle = std::next(container.begin(), static_cast<std::ptrdiff_t>(count / 2));
+  int next = 0;
+  for (auto _ : state) {
+    for (int step = 0; step < 1024; ++step) {
+      container.pop_front();
+      container.insert(middle, next++);
+    }
+    benchmark::DoNotOptimize(&container.front());
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * 1024);
+}
+
+BENCHMARK_TEMPLATE(BM_Churn, std::list<int>)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_Churn, List<int>)->Arg(1 << 10)->Arg(1 << 16);
+
+// Sorts a shuffled list of state.range(0) elements.
+template <typename Container>
+void BM_Sort(benchmark::State& state) {
+  auto count = static_cast<std::size_t>(state.range(0));
+  Container source = random_list<Container>(count, 2);
+  for (auto _ : state) {
+    state.PauseTiming();
+    Container container = source;
+    state.ResumeTiming();
+    container.sort();
+    benchmark::DoNotOptimize(&container.front());
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_Sort, std::list<int>)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_Sort, List<int>)->Arg(1 << 10)->Arg(1 << 16);
+
+// Merges two sorted lists of state.range(0) elements each and splits them
+// again with splice.
+template <typename Container>
+void BM_MergeSplice(benchmark::State& state) {
+  auto count = static_cast<std::size_t>(state.range(0));
+  Container lhs = random_list<Container>(count, 3);
+  Container rhs = random_list<Container>(count, 4);
+  lhs.sort();
+  rhs.sort();
+  for (auto _ : state) {
+    lhs.merge(rhs);
+    auto middle = std::next(lhs.begin(), static_cast<std::ptrdiff_t>(count));
+    rhs.splice(rhs.begin(), lhs, middle, lhs.end());
+    benchmark::DoNotOptimize(&lhs.front());
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          state.range(0) * 2);
+}
+
+BENCHMARK_TEMPLATE(BM_MergeSplice, std::list<int>)->Arg(1 << 10);
+BENCHMARK_TEMPLATE(BM_MergeSplice, List<int>)->Arg(1 << 10);
+
+}  // namespace
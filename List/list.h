@@ -0,0 +1,658 @@
+#pragma once
+
+// Doubly linked list with a per-list pool of free nodes.
+//
+// The list is circular around a sentinel node stored in the object itself,
+// so there are no null checks on the links. Nodes are allocated through the
+// allocator rebound to the node type, and every allocator operation goes
+// through std::allocator_traits, including the propagation flags and
+// select_on_container_copy_construction.
+//
+// Erased nodes are not given back to the allocator but kept on a singly
+// linked free list and reused by the next insertion, so insert/erase churn
+// at a steady size does not allocate at all. shrink_to_fit() returns the
+// pooled nodes. splice, merge, sort and reverse only relink nodes.
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace list_detail {
+
+struct BaseNode {
+  BaseNode* prev;
+  BaseNode* next;
+};
+
+// The value lives in raw storage so that a pooled node holds no T.
+template <typename T>
+struct Node : BaseNode {
+  T* storage() { return reinterpret_cast<T*>(bytes); }
+  T& value() { return *std::launder(storage()); }
+
+  alignas(T) std::byte bytes[sizeof(T)];
+};
+
+}  // namespace list_detail
+
+template <typename T, typename Allocator = std::allocator<T>>
+class List {
+  using BaseNode = list_detail::BaseNode;
+  using Node = list_detail::Node<T>;
+  using NodeAllocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+  template <bool IsConst>
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+
+    Iterator() = default;
+    operator Iterator<true>() const {  // NOLINT(google-explicit-constructor)
+      return Iterator<true>(node_);
+    }
+
+    reference operator*() const { return static_cast<Node*>(node_)->value(); }
+    pointer operator->() const { return std::addressof(**this); }
+
+    Iterator& operator++() {
+      node_ = node_->next;
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator old = *this;
+      node_ = node_->next;
+      return old;
+    }
+    Iterator& operator--() {
+      node_ = node_->prev;
+      return *this;
+    }
+    Iterator operator--(int) {
+      Iterator old = *this;
+      node_ = node_->prev;
+      return old;
+    }
+
+    friend bool operator==(const Iterator&, const Iterator&) = default;
+
+   private:
+    friend class List;
+    friend class Iterator<!IsConst>;
+
+    explicit Iterator(BaseNode* node) : node_(node) {}
+
+    BaseNode* node_ = nullptr;
+  };
+
+ public:
+  using value_type = T;
+  using allocator_type = Allocator;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = typename std::allocator_traits<Allocator>::pointer;
+  using const_pointer = typename std::allocator_traits<Allocator>::const_pointer;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  List() = default;
+  explicit List(const Allocator& alloc) : alloc_(alloc) {}
+
+  explicit List(size_type count, const Allocator& alloc = Allocator())
+      : alloc_(alloc) {
+    guarded([&] {
+      for (size_type i = 0; i < count; ++i) {
+        emplace_back();
+      }
+    });
+  }
+
+  List(size_type count, const T& value, const Allocator& alloc = Allocator())
+      : alloc_(alloc) {
+    guarded([&] {
+      for (size_type i = 0; i < count; ++i) {
+        push_back(value);
+      }
+    });
+  }
+
+  template <std::input_iterator InputIt>
+  List(InputIt first, InputIt last, const Allocator& alloc = Allocator())
+      : alloc_(alloc) {
+    guarded([&] {
+      for (; first != last; ++first) {
+        emplace_back(*first);
+      }
+    });
+  }
+
+  List(std::initializer_list<T> values, const Allocator& alloc = Allocator())
+      : List(values.begin(), values.end(), alloc) {}
+
+  List(const List& other)
+      : List(other.begin(), other.end(),
+             Allocator(NodeTraits::select_on_container_copy_construction(
+                 other.alloc_))) {}
+
+  List(const List& other, const Allocator& alloc)
+      : List(other.begin(), other.end(), alloc) {}
+
+  List(List&& other) noexcept : alloc_(std::move(other.alloc_)) {
+    steal(other);
+  }
+
+  List(List&& other, const Allocator& alloc) : alloc_(alloc) {
+    if (alloc_ == other.alloc_) {
+      steal(other);
+    } else {
+      guarded([&] {
+        for (T& value : other) {
+          emplace_back(std::move(value));
+        }
+      });
+    }
+  }
+
+  ~List() { release(); }
+
+  List& operator=(const List& other) {
+    if (this == &other) {
+      return *this;
+    }
+    if constexpr (NodeTraits::propagate_on_container_copy_assignment::value) {
+      if (alloc_ != other.alloc_) {
+        // Nodes from the old allocator, pooled ones included, cannot be
+        // handed to the new one.
+        release();
+      }
+      alloc_ = other.alloc_;
+    }
+    assign(other.begin(), other.end());
+    return *this;
+  }
+
+  List& operator=(List&& other) noexcept(
+      NodeTraits::propagate_on_container_move_assignment::value ||
+      NodeTraits::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
+    }
+    if (NodeTraits::propagate_on_container_move_assignment::value ||
+        alloc_ == other.alloc_) {
+      release();
+      if constexpr (NodeTraits::propagate_on_container_move_assignment::value) {
+        alloc_ = std::move(other.alloc_);
+      }
+      steal(other);
+    } else {
+      assign(std::make_move_iterator(other.begin()),
+             std::make_move_iterator(other.end()));
+      other.clear();
+    }
+    return *this;
+  }
+
+  List& operator=(std::initializer_list<T> values) {
+    assign(values.begin(), values.end());
+    return *this;
+  }
+
+  // Assigns over the existing elements first, so nodes are reused.
+  template <std::input_iterator InputIt>
+  void assign(InputIt first, InputIt last) {
+    iterator it = begin();
+    for (; it != end() && first != last; ++it, ++first) {
+      *it = *first;
+    }
+    if (first == last) {
+      erase(it, end());
+    } else {
+      for (; first != last; ++first) {
+        emplace_back(*first);
+      }
+    }
+  }
+
+  void assign(std::initializer_list<T> values) {
+    assign(values.begin(), values.end());
+  }
+
+  allocator_type get_allocator() const { return Allocator(alloc_); }
+
+  size_type size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  T& front() { return *begin(); }
+  const T& front() const { return *begin(); }
+  T& back() { return *std::prev(end()); }
+  const T& back() const { return *std::prev(end()); }
+
+  iterator begin() { return iterator(end_.next); }
+  iterator end() { return iterator(&end_); }
+  const_iterator begin() const { return const_iterator(end_.next); }
+  const_iterator end() const { return const_iterator(sentinel()); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+  const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+  const_reverse_iterator crbegin() const { return rbegin(); }
+  const_reverse_iterator crend() const { return rend(); }
+
+  // Insertions give the strong exception guarantee.
+  template <typename... Args>
+  iterator emplace(const_iterator pos, Args&&... args) {
+    Node* node = make_node(std::forward<Args>(args)...);
+    link_before(pos.node_, node);
+    ++size_;
+    return iterator(node);
+  }
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    return *emplace(end(), std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  T& emplace_front(Args&&... args) {
+    return *emplace(begin(), std::forward<Args>(args)...);
+  }
+
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+  void push_front(const T& value) { emplace_front(value); }
+  void push_front(T&& value) { emplace_front(std::move(value)); }
+
+  iterator insert(const_iterator pos, const T& value) {
+    return emplace(pos, value);
+  }
+  iterator insert(const_iterator pos, T&& value) {
+    return emplace(pos, std::move(value));
+  }
+
+  // Builds the new nodes aside and links them in one step, so a throwing
+  // copy leaves the list unchanged.
+  template <std::input_iterator InputIt>
+  iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    List chain(alloc_);
+    pool_.swap(chain.pool_);
+    try {
+      for (; first != last; ++first) {
+        chain.emplace_back(*first);
+      }
+    } catch (...) {
+      pool_.swap(chain.pool_);
+      throw;
+    }
+    pool_.swap(chain.pool_);
+    iterator result = chain.empty() ? iterator(pos.node_) : chain.begin();
+    splice(pos, chain);
+    return result;
+  }
+
+  iterator insert(const_iterator pos, std::initializer_list<T> values) {
+    return insert(pos, values.begin(), values.end());
+  }
+
+  void pop_back() { erase(std::prev(end())); }
+  void pop_front() { erase(begin()); }
+
+  iterator erase(const_iterator pos) {
+    BaseNode* node = pos.node_;
+    BaseNode* next = node->next;
+    unlink(node);
+    --size_;
+    recycle(static_cast<Node*>(node));
+    return iterator(next);
+  }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    while (first != last) {
+      first = erase(first);
+    }
+    return iterator(last.node_);
+  }
+
+  void clear() noexcept { erase(begin(), end()); }
+
+  void resize(size_type count) {
+    while (size_ > count) {
+      pop_back();
+    }
+    while (size_ < count) {
+      emplace_back();
+    }
+  }
+
+  void resize(size_type count, const T& value) {
+    while (size_ > count) {
+      pop_back();
+    }
+    while (size_ < count) {
+      push_back(value);
+    }
+  }
+
+  // Returns the pooled nodes to the allocator.
+  void shrink_to_fit() noexcept { pool_.release(alloc_); }
+
+  void swap(List& other) noexcept {
+    if constexpr (NodeTraits::propagate_on_container_swap::value) {
+      using std::swap;
+      swap(alloc_, other.alloc_);
+    }
+    BaseNode* first = end_.next;
+    BaseNode* last = end_.prev;
+    bool was_empty = empty();
+    if (other.empty()) {
+      reset_links();
+    } else {
+      adopt(other.end_.next, other.end_.prev);
+    }
+    if (was_empty) {
+      other.reset_links();
+    } else {
+      other.adopt(first, last);
+    }
+    std::swap(size_, other.size_);
+    pool_.swap(other.pool_);
+  }
+
+  friend void swap(List& lhs, List& rhs) noexcept { lhs.swap(rhs); }
+
+  // splice and merge require equal allocators, as for std::list.
+  void splice(const_iterator pos, List& other) {
+    if (other.empty()) {
+      return;
+    }
+    transfer(pos.node_, other.end_.next, &other.end_);
+    size_ += std::exchange(other.size_, 0);
+  }
+  void splice(const_iterator pos, List&& other) { splice(pos, other); }
+
+  void splice(const_iterator pos, List& other, const_iterator it) {
+    BaseNode* node = it.node_;
+    if (node == pos.node_ || node->next == pos.node_) {
+      return;
+    }
+    transfer(pos.node_, node, node->next);
+    --other.size_;
+    ++size_;
+  }
+  void splice(const_iterator pos, List&& other, const_iterator it) {
+    splice(pos, other, it);
+  }
+
+  // Linear in the length of [first, last) unless other is *this.
+  void splice(const_iterator pos, List& other, const_iterator first,
+              const_iterator last) {
+    if (first == last) {
+      return;
+    }
+    if (&other != this) {
+      auto count = static_cast<size_type>(std::distance(first, last));
+      other.size_ -= count;
+      size_ += count;
+    }
+    transfer(pos.node_, first.node_, last.node_);
+  }
+  void splice(const_iterator pos, List&& other, const_iterator first,
+              const_iterator last) {
+    splice(pos, other, first, last);
+  }
+
+  // Merges two sorted lists; stable, elements of *this go first on ties.
+  template <typename Compare>
+  void merge(List& other, Compare comp) {
+    if (&other == this || other.empty()) {
+      return;
+    }
+    BaseNode* first = end_.next;
+    BaseNode* other_first = other.end_.next;
+    while (first != &end_ && other_first != &other.end_) {
+      if (comp(value_of(other_first), value_of(first))) {
+        BaseNode* next = other_first->next;
+        transfer(first, other_first, next);
+        other_first = next;
+      } else {
+        first = first->next;
+      }
+    }
+    if (other_first != &other.end_) {
+      transfer(&end_, other_first, &other.end_);
+    }
+    size_ += std::exchange(other.size_, 0);
+  }
+  template <typename Compare>
+  void merge(List&& other, Compare comp) {
+    merge(other, comp);
+  }
+  void merge(List& other) { merge(other, std::less<>()); }
+  void merge(List&& other) { merge(other, std::less<>()); }
+
+  // Stable bottom-up merge sort on the links. bins[i] holds a sorted run of
+  // 2^i nodes, so the extra space is 64 pointers on the stack.
+  template <typename Compare>
+  void sort(Compare comp) {
+    if (size_ < 2) {
+      return;
+    }
+    end_.prev->next = nullptr;
+    BaseNode* chain = end_.next;
+    BaseNode* bins[64] = {};
+    while (chain != nullptr) {
+      BaseNode* run = chain;
+      chain = chain->next;
+      run->next = nullptr;
+      std::size_t i = 0;
+      for (; bins[i] != nullptr; ++i) {
+        run = merge_runs(bins[i], run, comp);
+        bins[i] = nullptr;
+      }
+      bins[i] = run;
+    }
+    BaseNode* sorted = nullptr;
+    for (BaseNode* bin : bins) {
+      if (bin != nullptr) {
+        sorted = sorted == nullptr ? bin : merge_runs(bin, sorted, comp);
+      }
+    }
+    BaseNode* prev = &end_;
+    for (BaseNode* node = sorted; node != nullptr; node = node->next) {
+      prev->next = node;
+      node->prev = prev;
+      prev = node;
+    }
+    prev->next = &end_;
+    end_.prev = prev;
+  }
+  void sort() { sort(std::less<>()); }
+
+  void reverse() noexcept {
+    BaseNode* node = &end_;
+    do {
+      std::swap(node->prev, node->next);
+      node = node->prev;
+    } while (node != &end_);
+  }
+
+  template <typename Predicate>
+  size_type remove_if(Predicate pred) {
+    size_type removed = 0;
+    for (iterator it = begin(); it != end();) {
+      if (pred(*it)) {
+        it = erase(it);
+        ++removed;
+      } else {
+        ++it;
+      }
+    }
+    return removed;
+  }
+  size_type remove(const T& value) {
+    return remove_if([&](const T& element) { return element == value; });
+  }
+
+  friend bool operator==(const List& lhs, const List& rhs) {
+    return lhs.size_ == rhs.size_ &&
+           std::equal(lhs.begin(), lhs.end(), rhs.begin());
+  }
+
+  friend auto operator<=>(const List& lhs, const List& rhs) {
+    return std::lexicographical_compare_three_way(lhs.begin(), lhs.end(),
+                                                  rhs.begin(), rhs.end());
+  }
+
+ private:
+  // Nodes without a value, chained through `next`.
+  class Pool {
+   public:
+    Node* take() { return static_cast<Node*>(std::exchange(head_, head_->next)); }
+    void give(Node* node) {
+      node->next = head_;
+      head_ = node;
+    }
+    bool empty() const { return head_ == nullptr; }
+    void swap(Pool& other) noexcept { std::swap(head_, other.head_); }
+    void steal(Pool& other) noexcept { head_ = std::exchange(other.head_, nullptr); }
+
+    void release(NodeAllocator& alloc) noexcept {
+      while (head_ != nullptr) {
+        Node* node = take();
+        NodeTraits::destroy(alloc, node);
+        NodeTraits::deallocate(alloc, node, 1);
+      }
+    }
+
+   private:
+    BaseNode* head_ = nullptr;
+  };
+
+  BaseNode* sentinel() const { return const_cast<BaseNode*>(&end_); }
+
+  static T& value_of(BaseNode* node) { return static_cast<Node*>(node)->value(); }
+
+  template <typename... Args>
+  Node* make_node(Args&&... args) {
+    Node* node;
+    if (!pool_.empty()) {
+      node = pool_.take();
+    } else {
+      node = NodeTraits::allocate(alloc_, 1);
+      NodeTraits::construct(alloc_, node);
+    }
+    try {
+      NodeTraits::construct(alloc_, node->storage(), std::forward<Args>(args)...);
+    } catch (...) {
+      pool_.give(node);
+      throw;
+    }
+    return node;
+  }
+
+  void recycle(Node* node) noexcept {
+    NodeTraits::destroy(alloc_, std::addressof(node->value()));
+    pool_.give(node);
+  }
+
+  static void link_before(BaseNode* pos, BaseNode* node) {
+    node->prev = pos->prev;
+    node->next = pos;
+    pos->prev->next = node;
+    pos->prev = node;
+  }
+
+  static void unlink(BaseNode* node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+  }
+
+  // Moves [first, last) in front of pos; pos must not be inside the range.
+  static void transfer(BaseNode* pos, BaseNode* first, BaseNode* last) {
+    if (pos == last) {
+      return;
+    }
+    BaseNode* tail = last->prev;
+    first->prev->next = last;
+    last->prev = first->prev;
+    tail->next = pos;
+    first->prev = pos->prev;
+    pos->prev->next = first;
+    pos->prev = tail;
+  }
+
+  // Merges two null-terminated sorted runs, preferring `lhs` on ties.
+  template <typename Compare>
+  static BaseNode* merge_runs(BaseNode* lhs, BaseNode* rhs, Compare& comp) {
+    BaseNode head;
+    BaseNode* tail = &head;
+    while (lhs != nullptr && rhs != nullptr) {
+      if (comp(value_of(rhs), value_of(lhs))) {
+        tail->next = rhs;
+        rhs = rhs->next;
+      } else {
+        tail->next = lhs;
+        lhs = lhs->next;
+      }
+      tail = tail->next;
+    }
+    tail->next = lhs != nullptr ? lhs : rhs;
+    return head.next;
+  }
+
+  // Runs a constructor body, freeing what was built if it throws.
+  template <typename Fill>
+  void guarded(Fill fill) {
+    try {
+      fill();
+    } catch (...) {
+      release();
+      throw;
+    }
+  }
+
+  // Makes the chain first..last the contents of this list.
+  void adopt(BaseNode* first, BaseNode* last) noexcept {
+    end_.next = first;
+    end_.prev = last;
+    first->prev = &end_;
+    last->next = &end_;
+  }
+
+  void reset_links() noexcept { end_.next = end_.prev = &end_; }
+
+  void steal(List& other) noexcept {
+    if (!other.empty()) {
+      adopt(other.end_.next, other.end_.prev);
+      other.reset_links();
+    }
+    size_ = std::exchange(other.size_, 0);
+    pool_.steal(other.pool_);
+  }
+
+  void release() noexcept {
+    clear();
+    shrink_to_fit();
+  }
+
+  BaseNode end_{&end_, &end_};
+  size_type size_ = 0;
+  Pool pool_;
+  [[no_unique_address]] NodeAllocator alloc_;
+};
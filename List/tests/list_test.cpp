@@ -0,0 +1,289 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "List/list.h"
+#include "StackAllocator/stackallocator.h"
+
+namespace {
+
+template <typename T, typename Allocator>
+std::vector<T> contents(const List<T, Allocator>& list) {
+  return std::vector<T>(list.begin(), list.end());
+}
+
+struct Counters {
+  std::size_t allocations = 0;
+  std::size_t deallocations = 0;
+  std::size_t largest = 0;  // biggest object allocated, in bytes
+};
+
+// Allocator with an identity and configurable propagation; copies made for
+// a copy-constructed container get a new identity.
+template <typename T, bool Propagate = false>
+struct TaggedAllocator {
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::bool_constant<Propagate>;
+  using propagate_on_container_move_assignment = std::bool_constant<Propagate>;
+  using propagate_on_container_swap = std::bool_constant<Propagate>;
+  using is_always_equal = std::false_type;
+
+  template <typename U>
+  struct rebind {
+    using other = TaggedAllocator<U, Propagate>;
+  };
+
+  int id = 0;
+  std::shared_ptr<Counters> counters = std::make_shared<Counters>();
+
+  TaggedAllocator() = default;
+  explicit TaggedAllocator(int tag) : id(tag) {}
+  template <typename U>
+  TaggedAllocator(const TaggedAllocator<U, Propagate>& other)  // NOLINT(google-explicit-constructor)
+      : id(other.id), counters(other.counters) {}
+
+  T* allocate(std::size_t count) {
+    ++counters->allocations;
+    counters->largest = std::max(counters->largest, sizeof(T));
+    return std::allocator<T>().allocate(count);
+  }
+  void deallocate(T* pointer, std::size_t count) {
+    ++counters->deallocations;
+    std::allocator<T>().deallocate(pointer, count);
+  }
+
+  TaggedAllocator select_on_container_copy_construction() const {
+    TaggedAllocator copy(id + 100);
+    return copy;
+  }
+
+  template <typename U>
+  bool operator==(const TaggedAllocator<U, Propagate>& other) const {
+    return id == other.id;
+  }
+};
+
+struct Throwing {
+  static inline int countdown = -1;
+  int value;
+
+  Throwing(int v) : value(v) {}  // NOLINT(google-explicit-constructor)
+  Throwing(const Throwing& other) : value(other.value) {
+    if (countdown-- == 0) {
+      throw std::runtime_error("Throwing");
+    }
+  }
+};
+
+TEST(List, MatchesStdListUnderRandomOperations) {
+  List<int> list;
+  std::list<int> model;
+  std::mt19937 gen(3);
+  for (int step = 0; step < 50000; ++step) {
+    int value = static_cast<int>(gen() % 1000);
+    std::size_t at = model.empty() ? 0 : gen() % model.size();
+    switch (gen() % 6) {
+      case 0:
+        list.push_back(value);
+        model.push_back(value);
+        break;
+      case 1:
+        list.push_front(value);
+        model.push_front(value);
+        break;
+      case 2:
+        list.insert(std::next(list.begin(), static_cast<std::ptrdiff_t>(at)), value);
+        model.insert(std::next(model.begin(), static_cast<std::ptrdiff_t>(at)), value);
+        break;
+      case 3:
+      case 4:
+        if (!model.empty()) {
+          list.erase(std::next(list.begin(), static_cast<std::ptrdiff_t>(at)));
+          model.erase(std::next(model.begin(), static_cast<std::ptrdiff_t>(at)));
+        }
+        break;
+      case 5:
+        if (model.size() > 200) {
+          list.remove(value);
+          model.remove(value);
+        }
+        break;
+    }
+    ASSERT_EQ(list.size(), model.size());
+  }
+  EXPECT_TRUE(std::equal(list.begin(), list.end(), model.begin(), model.end()));
+  EXPECT_TRUE(std::equal(list.rbegin(), list.rend(), model.rbegin(), model.rend()));
+}
+
+TEST(List, ChurnReusesPooledNodes) {
+  TaggedAllocator<int> alloc;
+  List<int, TaggedAllocator<int>> list(alloc);
+  for (int i = 0; i < 100; ++i) {
+    list.push_back(i);
+  }
+  std::size_t warm = alloc.counters->allocations;
+  for (int round = 0; round < 10000; ++round) {
+    list.pop_front();
+    list.push_back(round);
+    list.erase(std::next(list.begin(), 50));
+    list.insert(std::next(list.begin(), 10), round);
+  }
+  EXPECT_EQ(alloc.counters->allocations, warm);
+  EXPECT_EQ(alloc.counters->deallocations, 0u);
+
+  list.clear();
+  EXPECT_EQ(alloc.counters->deallocations, 0u);
+  list.shrink_to_fit();
+  EXPECT_EQ(alloc.counters->deallocations, warm);
+}
+
+TEST(List, AllocatesWholeNodes) {
+  TaggedAllocator<char> alloc;
+  List<char, TaggedAllocator<char>> list(alloc);
+  list.push_back('x');
+  EXPECT_GE(alloc.counters->largest, sizeof(char) + 2 * sizeof(void*));
+}
+
+TEST(List, CopySelectsAllocatorAndMoveMayNot) {
+  using Alloc = TaggedAllocator<int>;
+  List<int, Alloc> source({1, 2, 3}, Alloc(1));
+  List<int, Alloc> copy = source;
+  EXPECT_EQ(copy.get_allocator().id, 101);
+  EXPECT_EQ(copy, source);
+
+  List<int, Alloc> other(Alloc(2));
+  other = source;
+  EXPECT_EQ(other.get_allocator().id, 2);
+
+  const int* first = &source.front();
+  List<int, Alloc> same(std::move(source), Alloc(1));
+  EXPECT_EQ(&same.front(), first);
+
+  List<int, Alloc> elsewhere(std::move(same), Alloc(3));
+  EXPECT_NE(&elsewhere.front(), first);
+  EXPECT_EQ(contents(elsewhere), (std::vector<int>{1, 2, 3}));
+}
+
+TEST(List, PropagatingAllocatorFollowsAssignment) {
+  using Alloc = TaggedAllocator<int, true>;
+  List<int, Alloc> source({4, 5}, Alloc(1));
+  List<int, Alloc> target({9, 9, 9}, Alloc(2));
+  target = source;
+  EXPECT_EQ(target.get_allocator().id, 1);
+  EXPECT_EQ(contents(target), (std::vector<int>{4, 5}));
+
+  List<int, Alloc> moved(Alloc(3));
+  moved = std::move(target);
+  EXPECT_EQ(moved.get_allocator().id, 1);
+
+  List<int, Alloc> swapped({7}, Alloc(4));
+  swap(swapped, moved);
+  EXPECT_EQ(swapped.get_allocator().id, 1);
+  EXPECT_EQ(moved.get_allocator().id, 4);
+  EXPECT_EQ(contents(moved), (std::vector<int>{7}));
+}
+
+TEST(List, SpliceRelinksNodes) {
+  List<int> left{1, 2, 3};
+  List<int> right{10, 20, 30, 40};
+  int* twenty = &*std::next(right.begin());
+
+  left.splice(std::next(left.begin()), right, std::next(right.begin()));
+  EXPECT_EQ(contents(left), (std::vector<int>{1, 20, 2, 3}));
+  EXPECT_EQ(&*std::next(left.begin()), twenty);
+  EXPECT_EQ(right.size(), 3u);
+
+  left.splice(left.end(), right, std::next(right.begin()), right.end());
+  EXPECT_EQ(contents(left), (std::vector<int>{1, 20, 2, 3, 30, 40}));
+  EXPECT_EQ(contents(right), (std::vector<int>{10}));
+
+  left.splice(left.begin(), std::move(right));
+  EXPECT_EQ(left.size(), 7u);
+  EXPECT_TRUE(right.empty());  // NOLINT(bugprone-use-after-move)
+  EXPECT_EQ(left.front(), 10);
+}
+
+TEST(List, SortIsStableAndMergeInterleaves) {
+  std::mt19937 gen(5);
+  List<std::pair<int, int>> list;
+  for (int i = 0; i < 5000; ++i) {
+    list.emplace_back(static_cast<int>(gen() % 50), i);
+  }
+  auto by_key = [](const auto& a, const auto& b) { return a.first < b.first; };
+  list.sort(by_key);
+  std::vector<std::pair<int, int>> sorted(list.begin(), list.end());
+  EXPECT_TRUE(std::is_sorted(sorted.begin(), sorted.end()));
+
+  List<int> evens{0, 2, 4, 6, 8};
+  List<int> odds{1, 3, 5, 7, 9, 11};
+  evens.merge(odds);
+  EXPECT_EQ(contents(evens), (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 11}));
+  EXPECT_TRUE(odds.empty());
+
+  evens.reverse();
+  EXPECT_EQ(evens.front(), 11);
+  EXPECT_EQ(evens.back(), 0);
+
+  List<int> empty;
+  empty.sort();
+  empty.reverse();
+  EXPECT_TRUE(empty.empty());
+}
+
+TEST(List, ThrowingRangeInsertLeavesTheListAlone) {
+  List<Throwing> list;
+  list.emplace_back(1);
+  list.emplace_back(2);
+  std::vector<Throwing> source{10, 20, 30, 40};
+  Throwing::countdown = 2;
+  EXPECT_THROW(list.insert(std::next(list.begin()), source.begin(), source.end()),
+               std::runtime_error);
+  Throwing::countdown = -1;
+  ASSERT_EQ(list.size(), 2u);
+  EXPECT_EQ(list.front().value, 1);
+  EXPECT_EQ(list.back().value, 2);
+}
+
+TEST(List, AssignReusesNodesAndResizes) {
+  List<std::string> list{"a", "b", "c", "d"};
+  const std::string* second = &*std::next(list.begin());
+  list.assign({"w", "x"});
+  EXPECT_EQ(contents(list), (std::vector<std::string>{"w", "x"}));
+  EXPECT_EQ(&*std::next(list.begin()), second);
+
+  list.resize(4, "y");
+  EXPECT_EQ(contents(list), (std::vector<std::string>{"w", "x", "y", "y"}));
+  list.resize(1);
+  EXPECT_EQ(contents(list), (std::vector<std::string>{"w"}));
+
+  EXPECT_LT(List<int>({1, 2}), List<int>({1, 3}));
+  EXPECT_EQ(List<int>({1, 2, 1}).size(), 3u);
+}
+
+TEST(List, RunsOnStackAllocator) {
+  constexpr std::size_t kBytes = 1 << 15;
+  StackStorage<kBytes> storage;
+  List<int, StackAllocator<int, kBytes>> list(storage);
+  for (int i = 0; i < 500; ++i) {
+    list.push_back(i);
+  }
+  std::size_t used = storage.used();
+  list.clear();
+  for (int i = 0; i < 500; ++i) {
+    list.push_front(i);
+  }
+  EXPECT_EQ(storage.used(), used);
+  EXPECT_EQ(list.front(), 499);
+}
+
+}  // namespace
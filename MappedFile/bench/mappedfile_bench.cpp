@@ -0,0 +1,123 @@
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "MappedFile/mappedfile.h"
+#include "MappedFile/tokenizer.h"
+
+namespace {
+
+constexpr std::size_t kRecords = 1 << 20;
+
+// About 64 MiB of CSV, eight fields a record, some of them quoted; in the
+// page cache after it is written.
+const char* scratch_file() {
+  static const std::string path = [] {
+    char name[] = "/tmp/mappedfile_benchXXXXXX";
+    const int fd = mkstemp(name);
+    close(fd);
+    std::ofstream out(name, std::ios::binary);
+    std::mt19937_64 random(1);
+    for (std::size_t r = 0; r < kRecords; ++r) {
+      out << r << ',' << random() % 100000 << ",\"name, " << random() % 1000 << "\","
+          << random() << ',' << random() % 7 << ",abcdefgh,"
+          << static_cast<double>(random() % 1000000) / 1000 << ",x\n";
+    }
+    std::atexit([] { std::remove(path.c_str()); });
+    return std::string(name);
+  }();
+  return path.c_str();
+}
+
+void set_bytes(benchmark::State& state, std::size_t bytes) {
+  state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(bytes));
+}
+
+void BM_LinesIostream(benchmark::State& state) {
+  const char* path = scratch_file();
+  std::size_t bytes = 0;
+  for (auto _ : state) {
+    std::ifstream in(path, std::ios::binary);
+    std::string line;
+    std::size_t total = 0;
+    while (std::getline(in, line)) {
+      total += line.size() + 1;
+    }
+    benchmark::DoNotOptimize(total);
+    bytes = total;
+  }
+  set_bytes(state, bytes);
+}
+
+void BM_LinesMapped(benchmark::State& state) {
+  const char* path = scratch_file();
+  std::size_t bytes = 0;
+  for (auto _ : state) {
+    MappedFile file(path);
+    std::size_t total = 0;
+    for (StringView line : LineView(file.view())) {
+      total += line.size() + 1;
+    }
+    benchmark::DoNotOptimize(total);
+    bytes = file.size();
+  }
+  set_bytes(state, bytes);
+}
+
+// Splits on every comma, ignoring quotes: less than CsvReader does.
+void BM_FieldsIostream(benchmark::State& state) {
+  const char* path = scratch_file();
+  std::size_t bytes = 0;
+  for (auto _ : state) {
+    std::ifstream in(path, std::ios::binary);
+    std::string line;
+    std::string field;
+    std::size_t fields = 0;
+    bytes = 0;
+    while (std::getline(in, line)) {
+      bytes += line.size() + 1;
+      std::istringstream record(line);
+      while (std::getline(record, field, ',')) {
+        fields += field.size() != 0;
+      }
+    }
+    benchmark::DoNotOptimize(fields);
+  }
+  set_bytes(state, bytes);
+}
+
+void BM_FieldsMapped(benchmark::State& state) {
+  const char* path = scratch_file();
+  std::size_t bytes = 0;
+  std::vector<CsvField> record;
+  for (auto _ : state) {
+    MappedFile file(path);
+    CsvReader reader(file.view());
+    std::size_t fields = 0;
+    while (reader.next(record)) {
+      for (const CsvField& field : record) {
+        fields += !field.value.empty();
+      }
+    }
+    benchmark::DoNotOptimize(fields);
+    bytes = file.size();
+  }
+  set_bytes(state, bytes);
+}
+
+}  // namespace
+
+BENCHMARK(BM_LinesIostream)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LinesMapped)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FieldsIostream)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FieldsMapped)->Unit(benchmark::kMillisecond);
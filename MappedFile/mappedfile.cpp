@@ -0,0 +1,130 @@
+// MappedFile: mmap where the kernel allows it, read() where it does not.
+//
+// The mapping is private and read-only, so the file's pages are shared
+// with the page cache and nothing is copied. Files mmap refuses (0-byte,
+// pipes, /proc) are read to the end into a buffer that doubles as needed.
+
+#include "MappedFile/mappedfile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <utility>
+
+namespace {
+
+// Mappings from this size on ask for transparent huge pages.
+constexpr std::size_t kHugePage = std::size_t{2} << 20;
+
+[[noreturn]] void fail(const char* what) {
+  throw std::system_error(errno, std::system_category(), what);
+}
+
+// Closes the descriptor when the constructor is done with it.
+class Descriptor {
+ public:
+  explicit Descriptor(int fd) : fd_(fd) {}
+  Descriptor(const Descriptor&) = delete;
+  Descriptor& operator=(const Descriptor&) = delete;
+  ~Descriptor() { close(fd_); }
+
+  int get() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+}  // namespace
+
+MappedFile::MappedFile(const char* path, Access access) {
+  const int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    fail("MappedFile: open");
+  }
+  Descriptor file(fd);
+
+  struct stat info {};
+  if (fstat(file.get(), &info) != 0) {
+    fail("MappedFile: fstat");
+  }
+  // Regular files report their size; /proc files report 0 and are read.
+  if (S_ISREG(info.st_mode) && info.st_size > 0) {
+    const auto size = static_cast<std::size_t>(info.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file.get(), 0);
+    if (mapping != MAP_FAILED) {
+      madvise(mapping, size, access == Access::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+      if (size >= kHugePage) {
+        madvise(mapping, size, MADV_HUGEPAGE);
+      }
+      data_ = static_cast<const char*>(mapping);
+      size_ = size;
+      mapped_ = true;
+      return;
+    }
+  }
+
+  // Reads in doubling chunks, starting from the size fstat reported.
+  std::size_t capacity = S_ISREG(info.st_mode) && info.st_size > 0
+                             ? static_cast<std::size_t>(info.st_size) + 1
+                             : std::size_t{64} << 10;
+  auto buffer = std::make_unique_for_overwrite<char[]>(capacity);
+  std::size_t size = 0;
+  while (true) {
+    if (size == capacity) {
+      auto bigger = std::make_unique_for_overwrite<char[]>(2 * capacity);
+      std::memcpy(bigger.get(), buffer.get(), size);
+      buffer = std::move(bigger);
+      capacity *= 2;
+    }
+    const ssize_t count = read(file.get(), buffer.get() + size, capacity - size);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fail("MappedFile: read");
+    }
+    if (count == 0) {
+      break;
+    }
+    size += static_cast<std::size_t>(count);
+  }
+  buffer_ = std::move(buffer);
+  data_ = buffer_.get();
+  size_ = size;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      mapped_(std::exchange(other.mapped_, false)),
+      buffer_(std::move(other.buffer_)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    release();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    mapped_ = std::exchange(other.mapped_, false);
+    buffer_ = std::move(other.buffer_);
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() { release(); }
+
+void MappedFile::release() noexcept {
+  if (mapped_) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+  buffer_.reset();
+  data_ = nullptr;
+  size_ = 0;
+  mapped_ = false;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+// A whole file as one read-only StringView, without copying it.
+//
+// Regular files are mapped with mmap and the kernel is told how they will
+// be read: MADV_SEQUENTIAL doubles its readahead and lets it drop pages
+// soon after they are passed, MADV_RANDOM turns readahead off, and large
+// mappings ask for transparent huge pages where the file system supports
+// them for files. What cannot be mapped, pipes and most of /proc for
+// example, is read into a buffer with read() instead, so callers need not
+// care which they got.
+
+#include <cstddef>
+#include <memory>
+
+#include "String/string.h"
+
+class MappedFile {
+ public:
+  enum class Access { Sequential, Random };
+
+  // Throws std::system_error if the file cannot be opened or read.
+  explicit MappedFile(const char* path, Access access = Access::Sequential);
+
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  StringView view() const noexcept { return {data_, size_}; }
+  const char* data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+
+  // Whether the contents are mapped rather than read into a buffer.
+  bool mapped() const noexcept { return mapped_; }
+
+ private:
+  void release() noexcept;
+
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+  bool mapped_ = false;
+  std::unique_ptr<char[]> buffer_;
+};
@@ -0,0 +1,359 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "MappedFile/mappedfile.h"
+#include "MappedFile/tokenizer.h"
+
+namespace {
+
+std::string_view view(StringView str) { return std::string_view(str); }
+
+// A file holding the given contents, removed again at the end of the test.
+class TempFile {
+ public:
+  explicit TempFile(std::string_view contents) {
+    path_ = testing::TempDir() + "mappedfile_test_XXXXXX";
+    int fd = ::mkstemp(path_.data());
+    if (fd < 0) {
+      throw std::system_error(errno, std::system_category(), "mkstemp");
+    }
+    ::close(fd);
+    std::ofstream(path_, std::ios::binary).write(contents.data(),
+                                                 static_cast<std::streamsize>(contents.size()));
+  }
+  TempFile(const TempFile&) = delete;
+  TempFile& operator=(const TempFile&) = delete;
+  ~TempFile() { std::remove(path_.c_str()); }
+
+  const char* path() const { return path_.c_str(); }
+
+ private:
+  std::string path_;
+};
+
+std::string random_text(std::size_t size, std::string_view alphabet, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<std::size_t> pick(0, alphabet.size() - 1);
+  std::string text(size, '\0');
+  for (char& c : text) {
+    c = alphabet[pick(gen)];
+  }
+  return text;
+}
+
+std::vector<std::string> lines_of(std::string_view text) {
+  std::vector<std::string> lines;
+  for (StringView line : LineView(text)) {
+    lines.emplace_back(view(line));
+  }
+  return lines;
+}
+
+// The lines one character at a time.
+std::vector<std::string> expected_lines(std::string_view text) {
+  std::vector<std::string> lines;
+  std::size_t start = 0;
+  while (start < text.size()) {
+    std::size_t end = std::min(text.find('\n', start), text.size());
+    std::string_view line = text.substr(start, end - start);
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    lines.emplace_back(line);
+    start = end + 1;
+  }
+  return lines;
+}
+
+struct Field {
+  std::string value;
+  bool escaped;
+
+  bool operator==(const Field&) const = default;
+};
+
+using Records = std::vector<std::vector<Field>>;
+
+Records records_of(std::string_view text, char delimiter = ',') {
+  Records records;
+  CsvReader reader(text, delimiter);
+  std::vector<CsvField> fields;
+  while (reader.next(fields)) {
+    auto& record = records.emplace_back();
+    for (const CsvField& field : fields) {
+      record.push_back({std::string(view(field.value)), field.escaped});
+    }
+  }
+  EXPECT_TRUE(fields.empty());
+  return records;
+}
+
+// The same lenient RFC 4180 reading, one character at a time.
+Records expected_records(std::string_view text, char delimiter) {
+  auto separator = [&](std::size_t from) {
+    while (from < text.size() && text[from] != delimiter && text[from] != '\n') {
+      ++from;
+    }
+    return from;
+  };
+  Records records;
+  std::size_t position = 0;
+  while (position < text.size()) {
+    auto& record = records.emplace_back();
+    while (true) {
+      Field field{"", false};
+      std::size_t end;
+      if (position < text.size() && text[position] == '"') {
+        std::size_t close = position + 1;
+        while (close < text.size()) {
+          if (text[close] == '"') {
+            if (close + 1 < text.size() && text[close + 1] == '"') {
+              field.escaped = true;
+              close += 2;
+              continue;
+            }
+            break;
+          }
+          ++close;
+        }
+        field.value = text.substr(position + 1, close - position - 1);
+        end = close == text.size() ? close : separator(close + 1);
+      } else {
+        end = separator(position);
+        field.value = text.substr(position, end - position);
+        if ((end == text.size() || text[end] == '\n') && !field.value.empty() &&
+            field.value.back() == '\r') {
+          field.value.pop_back();
+        }
+      }
+      record.push_back(field);
+      if (end == text.size() || text[end] == '\n') {
+        position = end + 1;
+        break;
+      }
+      position = end + 1;
+    }
+  }
+  return records;
+}
+
+TEST(MappedFile, MapsRegularFiles) {
+  std::string contents = random_text(100000, "abc\n", 1);
+  TempFile file(contents);
+  for (auto access : {MappedFile::Access::Sequential, MappedFile::Access::Random}) {
+    MappedFile mapped(file.path(), access);
+    EXPECT_TRUE(mapped.mapped());
+    EXPECT_EQ(mapped.size(), contents.size());
+    EXPECT_EQ(view(mapped.view()), contents);
+    EXPECT_EQ(mapped.data(), mapped.view().data());
+  }
+}
+
+TEST(MappedFile, ReadsEmptyFiles) {
+  TempFile file("");
+  MappedFile mapped(file.path());
+  EXPECT_FALSE(mapped.mapped());
+  EXPECT_EQ(mapped.size(), 0u);
+  EXPECT_TRUE(mapped.view().empty());
+}
+
+TEST(MappedFile, ReadsWhatCannotBeMapped) {
+  MappedFile status("/proc/self/status");
+  EXPECT_FALSE(status.mapped());
+  EXPECT_NE(view(status.view()).find("Name:"), std::string_view::npos);
+
+  // More than one read's worth through a pipe, so the buffer has to grow.
+  int fds[2];
+  ASSERT_EQ(::pipe(fds), 0);
+  std::string contents = random_text(300000, "xyz\n", 2);
+  std::thread writer([&] {
+    std::size_t written = 0;
+    while (written < contents.size()) {
+      ssize_t n = ::write(fds[1], contents.data() + written, contents.size() - written);
+      ASSERT_GT(n, 0);
+      written += static_cast<std::size_t>(n);
+    }
+    ::close(fds[1]);
+  });
+  std::string path = "/proc/self/fd/" + std::to_string(fds[0]);
+  MappedFile piped(path.c_str());
+  writer.join();
+  ::close(fds[0]);
+  EXPECT_FALSE(piped.mapped());
+  EXPECT_EQ(view(piped.view()), contents);
+}
+
+TEST(MappedFile, ThrowsWhenTheFileCannotBeOpened) {
+  std::string path = testing::TempDir() + "mappedfile_test_missing";
+  try {
+    MappedFile missing(path.c_str());
+    FAIL() << "opened a missing file";
+  } catch (const std::system_error& error) {
+    EXPECT_EQ(error.code(), std::error_code(ENOENT, std::system_category()));
+  }
+}
+
+TEST(MappedFile, MovesTheContents) {
+  TempFile file("first\nsecond\n");
+  TempFile other("other");
+  MappedFile mapped(file.path());
+  const char* data = mapped.data();
+
+  MappedFile moved(std::move(mapped));
+  EXPECT_EQ(moved.data(), data);
+  EXPECT_TRUE(moved.mapped());
+  EXPECT_EQ(view(moved.view()), "first\nsecond\n");
+  EXPECT_TRUE(mapped.view().empty());  // NOLINT(bugprone-use-after-move)
+  EXPECT_FALSE(mapped.mapped());
+
+  MappedFile assigned(other.path());
+  assigned = std::move(moved);
+  EXPECT_EQ(assigned.data(), data);
+  EXPECT_EQ(view(assigned.view()), "first\nsecond\n");
+
+  MappedFile empty(TempFile("").path());
+  empty = std::move(assigned);
+  EXPECT_EQ(view(empty.view()), "first\nsecond\n");
+}
+
+TEST(LineView, SplitsLines) {
+  using Lines = std::vector<std::string>;
+  EXPECT_EQ(lines_of(""), Lines{});
+  EXPECT_EQ(lines_of("a"), Lines{"a"});
+  EXPECT_EQ(lines_of("a\n"), Lines{"a"});
+  EXPECT_EQ(lines_of("\n"), Lines{""});
+  EXPECT_EQ(lines_of("a\n\nb"), (Lines{"a", "", "b"}));
+  EXPECT_EQ(lines_of("a\r\nb\r\n"), (Lines{"a", "b"}));
+  EXPECT_EQ(lines_of("a\rb\n\r\n"), (Lines{"a\rb", ""}));
+}
+
+TEST(LineView, PointsIntoTheText) {
+  StringView text("one\ntwo\r\nthree");
+  LineView lines(text);
+  auto it = lines.begin();
+  EXPECT_EQ(it->data(), text.data());
+  EXPECT_EQ((*++it).data(), text.data() + 4);
+  auto copy = it++;
+  EXPECT_EQ(view(*copy), "two");
+  EXPECT_EQ(view(*it), "three");
+  EXPECT_EQ(++it, lines.end());
+
+  // A forward iterator: walking it twice gives the same lines.
+  EXPECT_EQ(std::distance(lines.begin(), lines.end()), 3);
+  EXPECT_EQ(std::distance(lines.begin(), lines.end()), 3);
+}
+
+TEST(LineView, MatchesACharacterByCharacterSplit) {
+  for (std::size_t size : {63u, 64u, 65u, 127u, 128u, 129u, 5000u}) {
+    for (std::string_view alphabet : {"ab\n", "a\r\n", "abcdefghijklmnopqrstuvwxyz\n"}) {
+      std::string text = random_text(size, alphabet, static_cast<unsigned>(size));
+      EXPECT_EQ(lines_of(text), expected_lines(text)) << size << " " << alphabet.size();
+    }
+  }
+  // Lines longer than a block, and a line break on every block boundary.
+  std::string text = std::string(200, 'x') + "\n" + std::string(63, 'y') + "\n" +
+                     std::string(63, 'z') + "\n";
+  EXPECT_EQ(lines_of(text), expected_lines(text));
+}
+
+TEST(LineView, ReadsAMappedFile) {
+  std::string contents = random_text(200000, "abcdefgh\r\n", 3);
+  TempFile file(contents);
+  MappedFile mapped(file.path());
+  EXPECT_EQ(lines_of(view(mapped.view())), expected_lines(contents));
+}
+
+TEST(CsvReader, ReadsPlainFields) {
+  EXPECT_EQ(records_of(""), Records{});
+  EXPECT_EQ(records_of("a,b,c"), (Records{{{"a", false}, {"b", false}, {"c", false}}}));
+  EXPECT_EQ(records_of("a,,b,\n"),
+            (Records{{{"a", false}, {"", false}, {"b", false}, {"", false}}}));
+  EXPECT_EQ(records_of("a,b\r\nc,d\r\n"),
+            (Records{{{"a", false}, {"b", false}}, {{"c", false}, {"d", false}}}));
+  EXPECT_EQ(records_of("\n"), (Records{{{"", false}}}));
+}
+
+TEST(CsvReader, ReadsQuotedFields) {
+  EXPECT_EQ(records_of("\"a,b\",\"c\nd\"\n\"\",e"),
+            (Records{{{"a,b", false}, {"c\nd", false}}, {{"", false}, {"e", false}}}));
+  EXPECT_EQ(records_of("\"x\"\r\n"), (Records{{{"x", false}}}));
+
+  CsvReader reader("\"say \"\"hi\"\"\",\"\"\"\"");
+  std::vector<CsvField> fields;
+  ASSERT_TRUE(reader.next(fields));
+  ASSERT_EQ(fields.size(), 2u);
+  EXPECT_TRUE(fields[0].escaped);
+  EXPECT_EQ(view(fields[0].value), "say \"\"hi\"\"");
+  EXPECT_EQ(view(fields[0].unescaped()), "say \"hi\"");
+  EXPECT_EQ(view(fields[1].unescaped()), "\"");
+  EXPECT_FALSE(reader.next(fields));
+  EXPECT_TRUE(fields.empty());
+}
+
+TEST(CsvReader, TakesOtherDelimiters) {
+  EXPECT_EQ(records_of("a;\"b;c\";d,e", ';'),
+            (Records{{{"a", false}, {"b;c", false}, {"d,e", false}}}));
+  EXPECT_EQ(records_of("a\tb\n", '\t'), (Records{{{"a", false}, {"b", false}}}));
+  EXPECT_THROW(CsvReader("", '"'), std::invalid_argument);
+  EXPECT_THROW(CsvReader("", '\n'), std::invalid_argument);
+  EXPECT_THROW(CsvReader("", '\r'), std::invalid_argument);
+}
+
+TEST(CsvReader, ReadsMalformedInputLeniently) {
+  // A quote inside an unquoted field is an ordinary character.
+  EXPECT_EQ(records_of("a\"b,c"), (Records{{{"a\"b", false}, {"c", false}}}));
+  // Text between a closing quote and the next delimiter is dropped.
+  EXPECT_EQ(records_of("\"a\"junk,b\n"), (Records{{{"a", false}, {"b", false}}}));
+  // An unterminated quote runs to the end of the text.
+  EXPECT_EQ(records_of("\"a,b\nc"), (Records{{{"a,b\nc", false}}}));
+}
+
+TEST(CsvReader, MatchesACharacterByCharacterReader) {
+  for (std::size_t size : {1u, 63u, 64u, 65u, 129u, 1000u, 20000u}) {
+    for (unsigned seed = 0; seed < 8; ++seed) {
+      std::string text = random_text(size, "ab,;\"\"\n\r", seed * 1000 + 7);
+      for (char delimiter : {',', ';'}) {
+        EXPECT_EQ(records_of(text, delimiter), expected_records(text, delimiter))
+            << size << " " << seed << " " << delimiter;
+      }
+    }
+  }
+}
+
+TEST(CsvReader, ReadsAMappedFile) {
+  std::string contents;
+  for (int row = 0; row < 5000; ++row) {
+    contents += std::to_string(row) + ",\"name " + std::to_string(row) + "\",\"a \"\"q\"\"\"\r\n";
+  }
+  TempFile file(contents);
+  MappedFile mapped(file.path());
+  CsvReader reader(mapped.view());
+  std::vector<CsvField> fields;
+  int rows = 0;
+  while (reader.next(fields)) {
+    ASSERT_EQ(fields.size(), 3u);
+    EXPECT_EQ(view(fields[0].value), std::to_string(rows));
+    EXPECT_EQ(view(fields[1].value), "name " + std::to_string(rows));
+    EXPECT_EQ(view(fields[2].unescaped()), "a \"q\"");
+    ++rows;
+  }
+  EXPECT_EQ(rows, 5000);
+}
+
+}  // namespace
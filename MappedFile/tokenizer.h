@@ -0,0 +1,244 @@
+#pragma once
+
+// Lines and CSV fields of a text as StringViews into it, without copying.
+//
+// Both tokenizers look at 64 bytes at a time: the String search kernel
+// turns each block into a bitmask of the characters that matter ('\n', and
+// for CSV also the delimiter and '"'), and the tokenizer then jumps from
+// one set bit to the next. Ordinary bytes are never looked at one by one.
+// Pointed at a MappedFile, they read a file straight out of the page cache.
+//
+// LineView yields the lines without their "\n" or "\r\n"; a text that ends
+// in '\n' has no empty line after it. CsvReader follows RFC 4180: fields
+// may be quoted, and quoted fields may hold delimiters, line breaks and
+// doubled quotes. Their value is the text between the quotes, with any
+// doubled quotes still doubled; CsvField::unescaped() copies it out
+// without them. Malformed input is read leniently rather than rejected: a
+// quote inside an unquoted field is an ordinary character, text between a
+// closing quote and the next delimiter is dropped, and an unterminated
+// quote runs to the end of the text.
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include "String/string.h"
+
+namespace tokenizer_detail {
+
+// The positions in a text of any of N characters, in increasing order.
+template <std::size_t N>
+class Scanner {
+ public:
+  Scanner() = default;
+  Scanner(StringView text, std::array<char, N> chars) : text_(text), chars_(chars) {
+    if (!text_.empty()) {
+      load_block();
+    }
+  }
+
+  // The next position not returned yet, or text.size() past the last one.
+  std::size_t next() {
+    while (mask_ == 0) {
+      block_ += kBlock;
+      if (block_ >= text_.size()) {
+        block_ = text_.size();
+        return text_.size();
+      }
+      load_block();
+    }
+    std::size_t position = block_ + static_cast<std::size_t>(std::countr_zero(mask_));
+    mask_ &= mask_ - 1;
+    return position;
+  }
+
+ private:
+  static constexpr std::size_t kBlock = 64;
+
+  void load_block() {
+    std::size_t length = std::min(kBlock, text_.size() - block_);
+    mask_ = 0;
+    for (char c : chars_) {
+      mask_ |= string_detail::match_mask(text_.data() + block_, length, c);
+    }
+  }
+
+  StringView text_;
+  std::array<char, N> chars_{};
+  std::size_t block_ = 0;   // offset of the block described by mask_
+  std::uint64_t mask_ = 0;  // positions in the block not returned yet
+};
+
+}  // namespace tokenizer_detail
+
+class LineView {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = StringView;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const StringView*;
+    using reference = StringView;
+
+    iterator() = default;
+
+    StringView operator*() const { return line_; }
+    const StringView* operator->() const { return &line_; }
+
+    iterator& operator++() {
+      advance();
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator old = *this;
+      advance();
+      return old;
+    }
+
+    friend bool operator==(const iterator& lhs, const iterator& rhs) {
+      return lhs.done_ == rhs.done_ &&
+             (lhs.done_ || lhs.line_.data() == rhs.line_.data());
+    }
+
+   private:
+    friend class LineView;
+
+    explicit iterator(StringView text) : text_(text), newlines_(text, {'\n'}), done_(false) {
+      advance();
+    }
+
+    void advance() {
+      if (start_ >= text_.size()) {
+        done_ = true;
+        return;
+      }
+      std::size_t end = newlines_.next();
+      line_ = StringView(text_.data() + start_, end - start_);
+      if (!line_.empty() && line_.back() == '\r') {
+        line_.remove_suffix(1);
+      }
+      start_ = end + 1;
+    }
+
+    StringView text_;
+    StringView line_;
+    tokenizer_detail::Scanner<1> newlines_;
+    std::size_t start_ = 0;  // beginning of the next line
+    bool done_ = true;       // past the last line
+  };
+
+  explicit LineView(StringView text) : text_(text) {}
+
+  iterator begin() const { return iterator(text_); }
+  iterator end() const { return iterator(); }
+
+ private:
+  StringView text_;
+};
+
+struct CsvField {
+  // The field, or for a quoted field the text between its quotes.
+  StringView value;
+  // Whether value still holds doubled quotes.
+  bool escaped = false;
+
+  // The value with doubled quotes made single. Copies.
+  String unescaped() const {
+    if (!escaped) {
+      return String(value);
+    }
+    String result;
+    result.reserve(value.size());
+    for (std::size_t i = 0; i < value.size(); ++i) {
+      result.push_back(value[i]);
+      if (value[i] == '"') {
+        ++i;
+      }
+    }
+    return result;
+  }
+};
+
+class CsvReader {
+ public:
+  // Throws std::invalid_argument if delimiter is '"' or a line break.
+  explicit CsvReader(StringView text, char delimiter = ',')
+      : text_(text), scanner_(text, {delimiter, '\n', '"'}) {
+    if (delimiter == '"' || delimiter == '\n' || delimiter == '\r') {
+      throw std::invalid_argument("CsvReader: delimiter must not be a quote or a line break");
+    }
+  }
+
+  // Replaces fields with those of the next record. Returns false, leaving
+  // fields empty, once the text is used up.
+  bool next(std::vector<CsvField>& fields) {
+    fields.clear();
+    if (start_ >= text_.size()) {
+      return false;
+    }
+    std::size_t position = start_;
+    while (true) {
+      CsvField field;
+      std::size_t end;
+      if (position < text_.size() && text_[position] == '"') {
+        scanner_.next();  // the opening quote
+        std::size_t close = closing_quote(field.escaped);
+        field.value = StringView(text_.data() + position + 1, close - position - 1);
+        end = close == text_.size() ? close : separator();
+      } else {
+        end = separator();
+        field.value = StringView(text_.data() + position, end - position);
+        if (ends_record(end) && !field.value.empty() && field.value.back() == '\r') {
+          field.value.remove_suffix(1);
+        }
+      }
+      fields.push_back(field);
+      if (ends_record(end)) {
+        start_ = end + 1;
+        return true;
+      }
+      position = end + 1;
+    }
+  }
+
+ private:
+  bool ends_record(std::size_t end) const { return end == text_.size() || text_[end] == '\n'; }
+
+  // The next delimiter or line break, or the end of the text.
+  std::size_t separator() {
+    std::size_t end = scanner_.next();
+    while (end != text_.size() && text_[end] == '"') {
+      end = scanner_.next();
+    }
+    return end;
+  }
+
+  // The quote closing a quoted field, or the end of the text.
+  std::size_t closing_quote(bool& escaped) {
+    while (true) {
+      std::size_t quote = scanner_.next();
+      if (quote == text_.size()) {
+        return quote;
+      }
+      if (text_[quote] != '"') {
+        continue;
+      }
+      if (quote + 1 < text_.size() && text_[quote + 1] == '"') {
+        scanner_.next();  // the second quote of the pair
+        escaped = true;
+        continue;
+      }
+      return quote;
+    }
+  }
+
+  StringView text_;
+  tokenizer_detail::Scanner<3> scanner_;
+  std::size_t start_ = 0;  // beginning of the next record
+};
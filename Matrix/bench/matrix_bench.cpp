@@ -0,0 +1,307 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "Matrix/matrix.h"
+#include "Matrix/residue.h"
+
+namespace {
+
+// The textbook residue type: % after every operation, and inverses by
+// Fermat's little theorem.
+template <std::uint32_t P>
+struct NaiveResidue {
+  NaiveResidue() = default;
+  NaiveResidue(std::int64_t x)  // NOLINT(google-explicit-constructor)
+      : value(static_cast<std::uint32_t>((x % P + P) % P)) {}
+
+  NaiveResidue& operator+=(NaiveResidue o) {
+    value = (value + o.value) % P;
+    return *this;
+  }
+  NaiveResidue& operator-=(NaiveResidue o) {
+    value = (value + P - o.value) % P;
+    return *this;
+  }
+  NaiveResidue& operator*=(NaiveResidue o) {
+    value = static_cast<std::uint32_t>(std::uint64_t{value} * o.value % P);
+    return *this;
+  }
+  NaiveResidue& operator/=(NaiveResidue o) {
+    NaiveResidue inverse(1);
+    for (std::uint32_t e = P - 2; e != 0; e >>= 1, o *= o) {
+      if (e & 1) {
+        inverse *= o;
+      }
+    }
+    return *this *= inverse;
+  }
+  NaiveResidue operator-() const { return NaiveResidue() -= *this; }
+  friend NaiveResidue operator+(NaiveResidue a, NaiveResidue b) { return a += b; }
+  friend NaiveResidue operator-(NaiveResidue a, NaiveResidue b) { return a -= b; }
+  friend NaiveResidue operator*(NaiveResidue a, NaiveResidue b) { return a *= b; }
+  friend NaiveResidue operator/(NaiveResidue a, NaiveResidue b) { return a /= b; }
+  friend bool operator==(NaiveResidue a, NaiveResidue b) { return a.value == b.value; }
+
+  std::uint32_t value = 0;
+};
+
+constexpr std::uint32_t kPrime = 998244353;
+
+template <typename M>
+M random_matrix(unsigned seed) {
+  using Field = typename M::value_type;
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> dist(-1.0, 1.0);
+  M result;
+  for (std::size_t i = 0; i < M::size(); ++i) {
+    if constexpr (std::is_floating_point_v<Field>) {
+      result.data()[i] = static_cast<Field>(dist(gen));
+    } else {
+      result.data()[i] = Field(static_cast<std::int64_t>(gen()));
+    }
+  }
+  return result;
+}
+
+template <typename M>
+void report_flops(benchmark::State& state) {
+  auto flops = 2.0 * static_cast<double>(M::rows() * M::columns() * M::columns());
+  state.counters["flops"] = benchmark::Counter(flops * static_cast<double>(state.iterations()),
+                                               benchmark::Counter::kIsRate);
+}
+
+// The textbook i-j-k triple loop, as the baseline.
+template <typename M>
+void naive_multiply(const M& a, const M& b, M& c) {
+  for (std::size_t i = 0; i < M::rows(); ++i) {
+    for (std::size_t j = 0; j < M::columns(); ++j) {
+      typename M::value_type sum{};
+      for (std::size_t p = 0; p < M::columns(); ++p) {
+        sum += a(i, p) * b(p, j);
+      }
+      c(i, j) = sum;
+    }
+  }
+}
+
+template <typename M>
+void BM_Naive(benchmark::State& state) {
+  M a = random_matrix<M>(1);
+  M b = random_matrix<M>(2);
+  M c;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a.data());
+    benchmark::DoNotOptimize(b.data());
+    naive_multiply(a, b, c);
+    benchmark::DoNotOptimize(c.data());
+  }
+  report_flops<M>(state);
+}
+
+template <typename M>
+void BM_Multiply(benchmark::State& state) {
+  M a = random_matrix<M>(1);
+  M b = random_matrix<M>(2);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a.data());
+    benchmark::DoNotOptimize(b.data());
+    M c = a * b;
+    benchmark::DoNotOptimize(c.data());
+  }
+  report_flops<M>(state);
+}
+
+// r = a * b + c * d with every intermediate a Matrix of its own, as it was
+// before expressions, against the expression, whose products both
+// accumulate into r.
+template <typename M>
+void BM_MultiplyAddEager(benchmark::State& state) {
+  M a = random_matrix<M>(1);
+  M b = random_matrix<M>(2);
+  M c = random_matrix<M>(3);
+  M d = random_matrix<M>(4);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a.data());
+    M ab = a * b;
+    M cd = c * d;
+    M r = ab;
+    r += cd;
+    benchmark::DoNotOptimize(r.data());
+  }
+}
+
+template <typename M>
+void BM_MultiplyAdd(benchmark::State& state) {
+  M a = random_matrix<M>(1);
+  M b = random_matrix<M>(2);
+  M c = random_matrix<M>(3);
+  M d = random_matrix<M>(4);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a.data());
+    M r = a * b + c * d;
+    benchmark::DoNotOptimize(r.data());
+  }
+}
+
+// r = a + b - c * s: three loops and two temporaries, or one loop.
+template <typename M>
+void BM_ElementwiseEager(benchmark::State& state) {
+  M a = random_matrix<M>(1);
+  M b = random_matrix<M>(2);
+  M c = random_matrix<M>(3);
+  typename M::value_type s(3);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a.data());
+    M sum = a + b;
+    M scaled = c * s;
+    M r = sum - scaled;
+    benchmark::DoNotOptimize(r.data());
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * 4 * M::size() *
+                                                   sizeof(typename M::value_type)));
+}
+
+template <typename M>
+void BM_Elementwise(benchmark::State& state) {
+  M a = random_matrix<M>(1);
+  M b = random_matrix<M>(2);
+  M c = random_matrix<M>(3);
+  typename M::value_type s(3);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a.data());
+    M r = a + b - c * s;
+    benchmark::DoNotOptimize(r.data());
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * 4 * M::size() *
+                                                   sizeof(typename M::value_type)));
+}
+
+// The packed kernels with each instruction set the CPU supports.
+template <typename M>
+void BM_MultiplyIsa(benchmark::State& state) {
+  auto isa = static_cast<matrix_detail::GemmIsa>(state.range(0));
+  matrix_detail::GemmIsa previous = matrix_detail::active_gemm_isa();
+  if (!matrix_detail::select_gemm_isa(isa)) {
+    state.SkipWithError("instruction set not supported");
+    return;
+  }
+  BM_Multiply<M>(state);
+  matrix_detail::select_gemm_isa(previous);
+}
+
+template <typename M>
+void BM_Det(benchmark::State& state) {
+  M a = random_matrix<M>(1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a.data());
+    auto det = a.det();
+    benchmark::DoNotOptimize(det);
+  }
+}
+
+template <typename M>
+void BM_Inverse(benchmark::State& state) {
+  M a = random_matrix<M>(1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a.data());
+    M inverse = a.inverted();
+    benchmark::DoNotOptimize(inverse.data());
+  }
+}
+
+// Unblocked, single-threaded Gaussian elimination, the baseline for the
+// LU factorization behind det() of large float and double matrices.
+template <typename M>
+void BM_Eliminate(benchmark::State& state) {
+  M a = random_matrix<M>(1);
+  for (auto _ : state) {
+    M work = a;
+    auto det = matrix_detail::eliminate(work.data(), M::rows(), M::columns(), M::columns(), false).det;
+    benchmark::DoNotOptimize(det);
+  }
+}
+
+template <typename M>
+void BM_Solve(benchmark::State& state) {
+  M a = random_matrix<M>(1);
+  auto b = random_matrix<Matrix<M::rows(), 1, typename M::value_type>>(2);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a.data());
+    auto x = a.solve(b);
+    benchmark::DoNotOptimize(x.data());
+  }
+}
+
+// Quotients of a fixed array, the inner operation of elimination pivots.
+template <typename Field>
+void BM_Divide(benchmark::State& state) {
+  std::mt19937 gen(1);
+  std::vector<Field> values(1024);
+  for (Field& value : values) {
+    value = Field(static_cast<std::int64_t>(gen() % (kPrime - 1) + 1));
+  }
+  for (auto _ : state) {
+    Field acc(1);
+    for (const Field& value : values) {
+      acc = acc / value + Field(1);
+    }
+    benchmark::DoNotOptimize(acc);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(values.size()));
+}
+
+constexpr auto kPortable = static_cast<std::int64_t>(matrix_detail::GemmIsa::Portable);
+constexpr auto kAvx2 = static_cast<std::int64_t>(matrix_detail::GemmIsa::Avx2);
+constexpr auto kAvx512 = static_cast<std::int64_t>(matrix_detail::GemmIsa::Avx512);
+
+BENCHMARK_TEMPLATE(BM_Naive, Matrix<3, 3, double>);
+BENCHMARK_TEMPLATE(BM_Multiply, Matrix<3, 3, double>);
+BENCHMARK_TEMPLATE(BM_Naive, Matrix<4, 4, float>);
+BENCHMARK_TEMPLATE(BM_Multiply, Matrix<4, 4, float>);
+BENCHMARK_TEMPLATE(BM_Naive, Matrix<4, 4, double>);
+BENCHMARK_TEMPLATE(BM_Multiply, Matrix<4, 4, double>);
+BENCHMARK_TEMPLATE(BM_Naive, Matrix<16, 16, double>);
+BENCHMARK_TEMPLATE(BM_Multiply, Matrix<16, 16, double>);
+BENCHMARK_TEMPLATE(BM_Naive, Matrix<64, 64, double>);
+BENCHMARK_TEMPLATE(BM_Multiply, Matrix<64, 64, double>);
+BENCHMARK_TEMPLATE(BM_Naive, Matrix<256, 256, float>);
+BENCHMARK_TEMPLATE(BM_Multiply, Matrix<256, 256, float>);
+BENCHMARK_TEMPLATE(BM_Naive, Matrix<256, 256, double>);
+BENCHMARK_TEMPLATE(BM_MultiplyIsa, Matrix<256, 256, double>)
+    ->ArgName("isa")
+    ->Arg(kPortable)
+    ->Arg(kAvx2)
+    ->Arg(kAvx512);
+BENCHMARK_TEMPLATE(BM_MultiplyAddEager, Matrix<4, 4, double>);
+BENCHMARK_TEMPLATE(BM_MultiplyAdd, Matrix<4, 4, double>);
+BENCHMARK_TEMPLATE(BM_MultiplyAddEager, Matrix<16, 16, double>);
+BENCHMARK_TEMPLATE(BM_MultiplyAdd, Matrix<16, 16, double>);
+BENCHMARK_TEMPLATE(BM_MultiplyAddEager, Matrix<256, 256, double>);
+BENCHMARK_TEMPLATE(BM_MultiplyAdd, Matrix<256, 256, double>);
+BENCHMARK_TEMPLATE(BM_ElementwiseEager, Matrix<16, 16, double>);
+BENCHMARK_TEMPLATE(BM_Elementwise, Matrix<16, 16, double>);
+BENCHMARK_TEMPLATE(BM_ElementwiseEager, Matrix<512, 512, double>);
+BENCHMARK_TEMPLATE(BM_Elementwise, Matrix<512, 512, double>);
+BENCHMARK_TEMPLATE(BM_Divide, NaiveResidue<kPrime>);
+BENCHMARK_TEMPLATE(BM_Divide, Residue<kPrime>);
+BENCHMARK_TEMPLATE(BM_Det, Matrix<128, 128, NaiveResidue<kPrime>>);
+BENCHMARK_TEMPLATE(BM_Det, Matrix<128, 128, Residue<kPrime>>);
+BENCHMARK_TEMPLATE(BM_Inverse, Matrix<128, 128, NaiveResidue<kPrime>>);
+BENCHMARK_TEMPLATE(BM_Inverse, Matrix<128, 128, Residue<kPrime>>);
+BENCHMARK_TEMPLATE(BM_Multiply, Matrix<128, 128, NaiveResidue<kPrime>>);
+BENCHMARK_TEMPLATE(BM_Multiply, Matrix<128, 128, Residue<kPrime>>);
+BENCHMARK_TEMPLATE(BM_Eliminate, Matrix<128, 128, double>);
+BENCHMARK_TEMPLATE(BM_Det, Matrix<128, 128, double>);
+BENCHMARK_TEMPLATE(BM_Eliminate, Matrix<1024, 1024, double>)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Det, Matrix<1024, 1024, double>)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Solve, Matrix<1024, 1024, double>)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Inverse, Matrix<1024, 1024, double>)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Det, Matrix<2000, 2000, double>)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Naive, Matrix<1024, 1024, double>)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Multiply, Matrix<1024, 1024, double>)->Unit(benchmark::kMillisecond);
+
+}  // namespace
@@ -0,0 +1,987 @@
+#pragma once
+
+// Dense matrix with dimensions fixed at compile time.
+//
+// Matrix<N, M, Field> stores its N x M elements row-major, inline when they
+// take at most kInlineBytes and on the heap otherwise, so 3x3 and 4x4
+// matrices are plain values while 256x256 ones move in O(1). Field is any
+// type with the usual arithmetic; Field{} must be zero and Field(1) one.
+//
+// Multiplication picks a strategy from the number of multiply-adds:
+//   - up to MATRIX_UNROLL_LIMIT the product is a fold expression over
+//     index sequences, fully unrolled and usable in constant expressions;
+//   - below MATRIX_GEMM_LIMIT, a dot product per element;
+//   - from there on, float and double go to the packed, register-tiled
+//     kernels in matrix_gemm.cpp (AVX-512, AVX2 + FMA, or SSE2/NEON, picked
+//     from the CPU at first use), and other fields to an i-k-j loop.
+// The limits can be set with compile definitions; they must be the same
+// for every translation unit of a program.
+//
+// +, -, scaling and products do not compute anything: they build an
+// expression, which is evaluated once, when it is assigned to a Matrix or
+// used to construct one. Sums, differences and scalings of matrices are a
+// single loop without temporaries, and products are written straight into
+// the destination, so in
+//
+//   r = a * b + c * d;
+//
+// the kernels accumulate both products into r. An expression that is not
+// elementwise and reads the matrix it is assigned to, as in a = a * b, is
+// evaluated aside first. eval() gives an expression's value as a Matrix,
+// for members such as det() or transposed(). Expressions keep references
+// to the matrices they are built from and own the temporaries, so one
+// held in an `auto` variable must not outlive its operands.
+//
+// det(), rank(), inverted() and solve() work over any field, e.g. Residue<P>
+// from residue.h for exact arithmetic over GF(P). They go through
+// LuDecomposition, and for float and double from MATRIX_LU_LIMIT rows on it
+// is the blocked, multithreaded factorization of matrix_lu.cpp, whose
+// updates are matrix products on the same kernels.
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifndef MATRIX_UNROLL_LIMIT
+#define MATRIX_UNROLL_LIMIT 64
+#endif
+
+#ifndef MATRIX_GEMM_LIMIT
+#define MATRIX_GEMM_LIMIT 4096
+#endif
+
+#ifndef MATRIX_LU_LIMIT
+#define MATRIX_LU_LIMIT 96
+#endif
+
+namespace matrix_detail {
+
+inline constexpr std::size_t kInlineBytes = 4096;
+inline constexpr std::size_t kUnrollLimit = MATRIX_UNROLL_LIMIT;
+inline constexpr std::size_t kGemmLimit = MATRIX_GEMM_LIMIT;
+inline constexpr std::size_t kLuLimit = MATRIX_LU_LIMIT;
+
+// Kernels of matrix_gemm.cpp. The instruction set is picked from the CPU
+// features on first use.
+enum class GemmIsa { Portable, Avx2, Avx512 };
+
+// Switches the kernels to the given instruction set, e.g. to compare them in
+// benchmarks. Returns false if the CPU or the build does not support it.
+bool select_gemm_isa(GemmIsa isa);
+GemmIsa active_gemm_isa();
+
+// C[n x k] += A[n x m] * B[m x k], all row-major with the given row strides.
+void gemm(std::size_t n, std::size_t m, std::size_t k, const float* a, std::size_t lda,
+          const float* b, std::size_t ldb, float* c, std::size_t ldc);
+void gemm(std::size_t n, std::size_t m, std::size_t k, const double* a, std::size_t lda,
+          const double* b, std::size_t ldb, double* c, std::size_t ldc);
+
+// Blocked LU with partial pivoting of the n x n row-major matrix at a, in
+// place: L below the diagonal with its unit diagonal implied, U on and
+// above it. Row i was swapped with row pivots[i] at step i. Returns false
+// if a pivot fell below the tolerance, and the factors are then of no use.
+// Panel and trailing updates are split across ThreadPool::shared().
+bool lu_factor(std::size_t n, float* a, std::size_t* pivots);
+bool lu_factor(std::size_t n, double* a, std::size_t* pivots);
+
+// Overwrites the n x k row-major b with the solution x of A x = b, given
+// the factors of A from lu_factor.
+void lu_solve(std::size_t n, std::size_t k, const float* lu, const std::size_t* pivots, float* b);
+void lu_solve(std::size_t n, std::size_t k, const double* lu, const std::size_t* pivots,
+              double* b);
+
+template <typename Field>
+inline constexpr bool kHasGemm = std::is_same_v<Field, float> || std::is_same_v<Field, double>;
+
+template <typename Field, std::size_t Size, bool Inline = Size * sizeof(Field) <= kInlineBytes>
+class Storage {
+ public:
+  constexpr Field* data() noexcept { return data_; }
+  constexpr const Field* data() const noexcept { return data_; }
+
+ private:
+  Field data_[Size] = {};
+};
+
+template <typename Field, std::size_t Size>
+class Storage<Field, Size, false> {
+ public:
+  constexpr Field* data() noexcept { return data_.data(); }
+  constexpr const Field* data() const noexcept { return data_.data(); }
+
+ private:
+  std::vector<Field> data_ = std::vector<Field>(Size);
+};
+
+// How a kernel stores its results: c = x, c += x or c -= x.
+enum class Accumulate { Assign, Add, Subtract };
+
+template <Accumulate Mode, typename Field>
+constexpr void store(Field& out, const Field& value) {
+  if constexpr (Mode == Accumulate::Assign) {
+    out = value;
+  } else if constexpr (Mode == Accumulate::Add) {
+    out += value;
+  } else {
+    out -= value;
+  }
+}
+
+// c[I][J] = sum over P of a[I][P] * b[P][J], as one expression.
+template <std::size_t I, std::size_t J, std::size_t M, std::size_t K, typename Field,
+          std::size_t... Ps>
+constexpr Field dot(const Field* a, const Field* b, std::index_sequence<Ps...>) {
+  return ((a[I * M + Ps] * b[Ps * K + J]) + ...);
+}
+
+// All results are computed before the first store: `c` may be the return
+// slot of the caller, which the compiler has to assume can alias a and b.
+template <Accumulate Mode, std::size_t M, std::size_t K, typename Field, std::size_t... Cells>
+constexpr void multiply_unrolled(const Field* a, const Field* b, Field* c,
+                                 std::index_sequence<Cells...>) {
+  const Field values[] = {dot<Cells / K, Cells % K, M, K>(a, b, std::make_index_sequence<M>())...};
+  for (std::size_t i = 0; i < sizeof...(Cells); ++i) {
+    store<Mode>(c[i], values[i]);
+  }
+}
+
+// One dot product per element. With small compile-time dimensions the
+// inner loop unrolls completely and this beats reordered loops.
+template <Accumulate Mode, std::size_t N, std::size_t M, std::size_t K, typename Field>
+constexpr void multiply_dot(const Field* a, const Field* b, Field* c) {
+  for (std::size_t i = 0; i < N; ++i) {
+    for (std::size_t j = 0; j < K; ++j) {
+      Field sum{};
+      for (std::size_t p = 0; p < M; ++p) {
+        sum += a[i * M + p] * b[p * K + j];
+      }
+      store<Mode>(c[i * K + j], sum);
+    }
+  }
+}
+
+// Streams rows of b instead of columns, for large fields without a kernel.
+// Accumulates into c, which starts out zeroed for Assign.
+template <Accumulate Mode, std::size_t N, std::size_t M, std::size_t K, typename Field>
+constexpr void multiply_rows(const Field* a, const Field* b, Field* c) {
+  if constexpr (Mode == Accumulate::Assign) {
+    std::fill(c, c + N * K, Field{});
+  }
+  constexpr Accumulate kStep = Mode == Accumulate::Subtract ? Mode : Accumulate::Add;
+  for (std::size_t i = 0; i < N; ++i) {
+    Field* out = c + i * K;
+    for (std::size_t p = 0; p < M; ++p) {
+      const Field scale = a[i * M + p];
+      const Field* row = b + p * K;
+      for (std::size_t j = 0; j < K; ++j) {
+        store<kStep>(out[j], scale * row[j]);
+      }
+    }
+  }
+}
+
+// c = a b, c += a b or c -= a b for a of N x M and b of M x K, with the
+// strategy of the header comment. c must not overlap a or b. gemm only
+// accumulates, so Subtract goes through a temporary there.
+template <Accumulate Mode, std::size_t N, std::size_t M, std::size_t K, typename Field>
+constexpr void multiply(const Field* a, const Field* b, Field* c) {
+  constexpr std::size_t kWork = N * M * K;
+  if constexpr (kWork <= kUnrollLimit) {
+    multiply_unrolled<Mode, M, K>(a, b, c, std::make_index_sequence<N * K>());
+  } else if constexpr (kWork < kGemmLimit) {
+    multiply_dot<Mode, N, M, K>(a, b, c);
+  } else {
+    if constexpr (kHasGemm<Field>) {
+      if (!std::is_constant_evaluated()) {
+        if constexpr (Mode == Accumulate::Subtract) {
+          std::vector<Field> product(N * K);
+          gemm(N, M, K, a, M, b, K, product.data(), K);
+          for (std::size_t i = 0; i < N * K; ++i) {
+            c[i] -= product[i];
+          }
+        } else {
+          if constexpr (Mode == Accumulate::Assign) {
+            std::fill(c, c + N * K, Field{});
+          }
+          gemm(N, M, K, a, M, b, K, c, K);
+        }
+        return;
+      }
+    }
+    multiply_rows<Mode, N, M, K>(a, b, c);
+  }
+}
+
+template <typename Field>
+constexpr Field magnitude(const Field& x) {
+  return x < Field{} ? -x : x;
+}
+
+// Pivots at or below this count as zero: exact zero for exact fields, and
+// for floating point the largest magnitude in the n x m block at a, with
+// row stride `stride`, scaled by the dimension and the machine epsilon.
+template <typename Field>
+constexpr Field pivot_tolerance(const Field* a, std::size_t n, std::size_t m,
+                                std::size_t stride) {
+  Field tolerance{};
+  if constexpr (std::is_floating_point_v<Field>) {
+    for (std::size_t r = 0; r < n; ++r) {
+      for (std::size_t c = 0; c < m; ++c) {
+        tolerance = std::max(tolerance, magnitude(a[r * stride + c]));
+      }
+    }
+    tolerance *= static_cast<Field>(std::max(n, m)) * std::numeric_limits<Field>::epsilon();
+  }
+  return tolerance;
+}
+
+// The pivot row for `column` among rows [top, n) of the row-major block at
+// a with row stride m, or n if there is none. Exact fields take the first
+// nonzero element, floating point the largest one above the tolerance.
+template <typename Field>
+constexpr std::size_t find_pivot(const Field* a, std::size_t n, std::size_t m, std::size_t column,
+                                 std::size_t top, const Field& tolerance) {
+  std::size_t pivot_row = n;
+  if constexpr (std::is_floating_point_v<Field>) {
+    Field best = tolerance;
+    for (std::size_t r = top; r < n; ++r) {
+      if (magnitude(a[r * m + column]) > best) {
+        best = magnitude(a[r * m + column]);
+        pivot_row = r;
+      }
+    }
+  } else {
+    for (std::size_t r = top; r < n && pivot_row == n; ++r) {
+      if (!(a[r * m + column] == Field{})) {
+        pivot_row = r;
+      }
+    }
+  }
+  return pivot_row;
+}
+
+template <typename Field>
+struct Elimination {
+  std::size_t rank;
+  Field det;
+};
+
+// Gaussian elimination on the n x m row-major block at a, with pivots taken
+// from the first pivot_columns columns only, and compared with a tolerance
+// from those columns alone: the identity of [A | I] does not set the scale
+// of A. Leaves row echelon form, or the reduced form (pivots 1, zeros above
+// them) when `reduce` is set. Returns the rank and, for a square pivot
+// block, the determinant. Each pivot costs one division, the rest is
+// multiply-subtract.
+template <typename Field>
+constexpr Elimination<Field> eliminate(Field* a, std::size_t n, std::size_t m,
+                                       std::size_t pivot_columns, bool reduce) {
+  const Field tolerance = pivot_tolerance(a, n, pivot_columns, m);
+  Elimination<Field> result{0, Field(1)};
+  for (std::size_t column = 0; column < pivot_columns && result.rank < n; ++column) {
+    std::size_t top = result.rank;
+    std::size_t pivot_row = find_pivot(a, n, m, column, top, tolerance);
+    if (pivot_row == n) {
+      result.det = Field{};
+      continue;
+    }
+    if (pivot_row != top) {
+      std::swap_ranges(a + pivot_row * m + column, a + pivot_row * m + m, a + top * m + column);
+      result.det = -result.det;
+    }
+    Field* pivot = a + top * m;
+    result.det *= pivot[column];
+    const Field inverse = Field(1) / pivot[column];
+    if (reduce) {
+      for (std::size_t c = column; c < m; ++c) {
+        pivot[c] *= inverse;
+      }
+    }
+    for (std::size_t r = reduce ? 0 : top + 1; r < n; ++r) {
+      Field* row = a + r * m;
+      if (r == top || row[column] == Field{}) {
+        continue;
+      }
+      const Field factor = reduce ? row[column] : row[column] * inverse;
+      for (std::size_t c = column; c < m; ++c) {
+        row[c] -= factor * pivot[c];
+      }
+    }
+    ++result.rank;
+  }
+  if (result.rank < pivot_columns) {
+    result.det = Field{};
+  }
+  return result;
+}
+
+// lu_factor for small matrices and fields without kernels.
+template <typename Field>
+constexpr bool lu_factor_unblocked(Field* a, std::size_t n, std::size_t* pivots) {
+  const Field tolerance = pivot_tolerance(a, n, n, n);
+  bool nonsingular = true;
+  for (std::size_t j = 0; j < n; ++j) {
+    std::size_t pivot_row = find_pivot(a, n, n, j, j, tolerance);
+    if (pivot_row == n) {
+      pivots[j] = j;
+      nonsingular = false;
+      continue;
+    }
+    pivots[j] = pivot_row;
+    if (pivot_row != j) {
+      std::swap_ranges(a + pivot_row * n, a + pivot_row * n + n, a + j * n);
+    }
+    const Field* pivot = a + j * n;
+    const Field inverse = Field(1) / pivot[j];
+    for (std::size_t r = j + 1; r < n; ++r) {
+      Field* row = a + r * n;
+      if (row[j] == Field{}) {
+        continue;
+      }
+      row[j] *= inverse;
+      for (std::size_t c = j + 1; c < n; ++c) {
+        row[c] -= row[j] * pivot[c];
+      }
+    }
+  }
+  return nonsingular;
+}
+
+// lu_solve for small matrices and fields without kernels.
+template <typename Field>
+constexpr void lu_solve_unblocked(std::size_t n, std::size_t k, const Field* lu,
+                                  const std::size_t* pivots, Field* b) {
+  for (std::size_t i = 0; i < n; ++i) {
+    if (pivots[i] != i) {
+      std::swap_ranges(b + pivots[i] * k, b + pivots[i] * k + k, b + i * k);
+    }
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t p = 0; p < i; ++p) {
+      const Field factor = lu[i * n + p];
+      for (std::size_t c = 0; c < k; ++c) {
+        b[i * k + c] -= factor * b[p * k + c];
+      }
+    }
+  }
+  for (std::size_t i = n; i-- > 0;) {
+    for (std::size_t p = i + 1; p < n; ++p) {
+      const Field factor = lu[i * n + p];
+      for (std::size_t c = 0; c < k; ++c) {
+        b[i * k + c] -= factor * b[p * k + c];
+      }
+    }
+    const Field inverse = Field(1) / lu[i * n + i];
+    for (std::size_t c = 0; c < k; ++c) {
+      b[i * k + c] *= inverse;
+    }
+  }
+}
+
+// Whether LuDecomposition<N, Field> runs on lu_factor and lu_solve.
+template <typename Field, std::size_t N>
+inline constexpr bool kBlockedLu = kHasGemm<Field> && N >= kLuLimit;
+
+}  // namespace matrix_detail
+
+template <std::size_t N, std::size_t M, typename Field = double>
+class Matrix;
+
+template <std::size_t N, typename Field>
+class LuDecomposition;
+
+namespace matrix_detail {
+
+// Lazy expressions. Every node has the static shape and value_type of a
+// Matrix, kElementwise, aliases(out) telling whether a Matrix it reads has
+// its elements at out, and either element(i), the i-th element in row-major
+// order, or, when it is not elementwise, evaluate_into<Mode>(out).
+
+template <typename T>
+struct IsMatrix : std::false_type {};
+template <std::size_t N, std::size_t M, typename Field>
+struct IsMatrix<Matrix<N, M, Field>> : std::true_type {};
+
+struct ExpressionNode {};
+
+template <typename T>
+concept Expression = IsMatrix<std::remove_cvref_t<T>>::value ||
+                     std::is_base_of_v<ExpressionNode, std::remove_cvref_t<T>>;
+
+template <typename L, typename R>
+concept SameShape = Expression<L> && Expression<R> &&
+                    std::remove_cvref_t<L>::rows() == std::remove_cvref_t<R>::rows() &&
+                    std::remove_cvref_t<L>::columns() == std::remove_cvref_t<R>::columns() &&
+                    std::is_same_v<typename std::remove_cvref_t<L>::value_type,
+                                   typename std::remove_cvref_t<R>::value_type>;
+
+template <typename L, typename R>
+concept Multipliable = Expression<L> && Expression<R> &&
+                       std::remove_cvref_t<L>::columns() == std::remove_cvref_t<R>::rows() &&
+                       std::is_same_v<typename std::remove_cvref_t<L>::value_type,
+                                      typename std::remove_cvref_t<R>::value_type>;
+
+// The shape and field of node E as a Matrix.
+template <typename E>
+using MatrixOf = Matrix<E::rows(), E::columns(), typename E::value_type>;
+
+template <typename Derived, std::size_t N, std::size_t M, typename Field>
+class NodeBase : public ExpressionNode {
+ public:
+  using value_type = Field;
+  static constexpr std::size_t rows() noexcept { return N; }
+  static constexpr std::size_t columns() noexcept { return M; }
+  static constexpr std::size_t size() noexcept { return N * M; }
+
+  constexpr Matrix<N, M, Field> eval() const { return Matrix<N, M, Field>(derived()); }
+
+ private:
+  constexpr const Derived& derived() const { return static_cast<const Derived&>(*this); }
+};
+
+// A Matrix operand: Holder is const Matrix& for an lvalue and Matrix for a
+// temporary moved into the expression, which keeps it alive as long as the
+// expression.
+template <typename Holder>
+class Leaf : public NodeBase<Leaf<Holder>, std::remove_cvref_t<Holder>::rows(),
+                             std::remove_cvref_t<Holder>::columns(),
+                             typename std::remove_cvref_t<Holder>::value_type> {
+ public:
+  using Stored = std::remove_cvref_t<Holder>;
+  using Field = typename Stored::value_type;
+  static constexpr bool kElementwise = true;
+
+  template <typename T>
+  constexpr explicit Leaf(T&& matrix) : matrix_(std::forward<T>(matrix)) {}
+
+  constexpr const Stored& matrix() const noexcept { return matrix_; }
+  constexpr const Field& element(std::size_t i) const { return matrix_.data()[i]; }
+  constexpr bool aliases(const Field* out) const noexcept { return matrix_.data() == out; }
+
+ private:
+  Holder matrix_;
+};
+
+template <typename T>
+using NodeOf = std::conditional_t<IsMatrix<std::remove_cvref_t<T>>::value,
+                                  std::conditional_t<std::is_lvalue_reference_v<T>,
+                                                     Leaf<const std::remove_cvref_t<T>&>,
+                                                     Leaf<std::remove_cvref_t<T>>>,
+                                  std::remove_cvref_t<T>>;
+
+template <typename T>
+constexpr NodeOf<T> as_node(T&& operand) {
+  return NodeOf<T>(std::forward<T>(operand));
+}
+
+// out = e, out += e or out -= e. Elementwise expressions are one loop.
+template <Accumulate Mode, typename E>
+constexpr void evaluate(const E& e, typename E::value_type* out) {
+  if constexpr (E::kElementwise) {
+    for (std::size_t i = 0; i < E::size(); ++i) {
+      store<Mode>(out[i], e.element(i));
+    }
+  } else {
+    e.template evaluate_into<Mode>(out);
+  }
+}
+
+// The elements of e: the Matrix itself for a leaf, otherwise a new one.
+template <typename E>
+constexpr decltype(auto) materialize(const E& e) {
+  if constexpr (requires { e.matrix(); }) {
+    return e.matrix();
+  } else {
+    return e.eval();
+  }
+}
+
+constexpr Accumulate opposite(Accumulate mode) {
+  return mode == Accumulate::Add ? Accumulate::Subtract : Accumulate::Add;
+}
+
+// L + R, or L - R when Subtract is set.
+template <typename L, typename R, bool Subtract>
+class Sum : public NodeBase<Sum<L, R, Subtract>, L::rows(), L::columns(),
+                            typename L::value_type> {
+ public:
+  using Field = typename L::value_type;
+  static constexpr bool kElementwise = L::kElementwise && R::kElementwise;
+
+  constexpr Sum(L lhs, R rhs) : lhs_(std::move(lhs)), rhs_(std::move(rhs)) {}
+
+  constexpr Field element(std::size_t i) const {
+    return Subtract ? lhs_.element(i) - rhs_.element(i) : lhs_.element(i) + rhs_.element(i);
+  }
+  constexpr bool aliases(const Field* out) const {
+    return lhs_.aliases(out) || rhs_.aliases(out);
+  }
+
+  // One term after the other. An elementwise right term of a sum goes
+  // first on assignment, so that products after it accumulate into what it
+  // wrote: A * B + C * d is one pass for C * d and then gemm adding A * B.
+  template <Accumulate Mode>
+  constexpr void evaluate_into(Field* out) const {
+    if constexpr (Mode == Accumulate::Assign && !Subtract && !L::kElementwise &&
+                  R::kElementwise) {
+      evaluate<Accumulate::Assign>(rhs_, out);
+      evaluate<Accumulate::Add>(lhs_, out);
+    } else {
+      constexpr Accumulate kRhs = Mode == Accumulate::Assign ? Accumulate::Add : Mode;
+      evaluate<Mode>(lhs_, out);
+      evaluate<Subtract ? opposite(kRhs) : kRhs>(rhs_, out);
+    }
+  }
+
+ private:
+  L lhs_;
+  R rhs_;
+};
+
+template <typename E>
+class Negated : public NodeBase<Negated<E>, E::rows(), E::columns(), typename E::value_type> {
+ public:
+  using Field = typename E::value_type;
+  static constexpr bool kElementwise = E::kElementwise;
+
+  constexpr explicit Negated(E operand) : operand_(std::move(operand)) {}
+
+  constexpr Field element(std::size_t i) const { return -operand_.element(i); }
+  constexpr bool aliases(const Field* out) const { return operand_.aliases(out); }
+
+  template <Accumulate Mode>
+  constexpr void evaluate_into(Field* out) const {
+    if constexpr (Mode == Accumulate::Assign) {
+      evaluate<Accumulate::Assign>(operand_, out);
+      for (std::size_t i = 0; i < E::size(); ++i) {
+        out[i] = -out[i];
+      }
+    } else {
+      evaluate<opposite(Mode)>(operand_, out);
+    }
+  }
+
+ private:
+  E operand_;
+};
+
+// E times a scalar, multiplied on the right of every element.
+template <typename E>
+class Scaled : public NodeBase<Scaled<E>, E::rows(), E::columns(), typename E::value_type> {
+ public:
+  using Field = typename E::value_type;
+  static constexpr bool kElementwise = E::kElementwise;
+
+  constexpr Scaled(E operand, const Field& scale) : operand_(std::move(operand)), scale_(scale) {}
+
+  constexpr Field element(std::size_t i) const { return operand_.element(i) * scale_; }
+  constexpr bool aliases(const Field* out) const { return operand_.aliases(out); }
+
+  // A scaled product has no kernel to accumulate into out, so adding one
+  // goes through its value.
+  template <Accumulate Mode>
+  constexpr void evaluate_into(Field* out) const {
+    if constexpr (Mode == Accumulate::Assign) {
+      evaluate<Accumulate::Assign>(operand_, out);
+      for (std::size_t i = 0; i < E::size(); ++i) {
+        out[i] *= scale_;
+      }
+    } else {
+      const auto value = operand_.eval();
+      for (std::size_t i = 0; i < E::size(); ++i) {
+        store<Mode>(out[i], value.data()[i] * scale_);
+      }
+    }
+  }
+
+ private:
+  E operand_;
+  Field scale_;
+};
+
+// L * R. Operands that are not a Matrix are evaluated once; the product
+// goes straight into the destination, accumulating there when it is a
+// term of a sum.
+template <typename L, typename R>
+class Product : public NodeBase<Product<L, R>, L::rows(), R::columns(),
+                                typename L::value_type> {
+ public:
+  using Field = typename L::value_type;
+  static constexpr bool kElementwise = false;
+  // From kGemmLimit on the kernels add to out and clear it first to assign.
+  static constexpr bool kClearsOut = L::rows() * L::columns() * R::columns() >= kGemmLimit;
+
+  constexpr Product(L lhs, R rhs) : lhs_(std::move(lhs)), rhs_(std::move(rhs)) {}
+
+  constexpr bool aliases(const Field* out) const {
+    return lhs_.aliases(out) || rhs_.aliases(out);
+  }
+
+  template <Accumulate Mode>
+  constexpr void evaluate_into(Field* out) const {
+    const auto& a = materialize(lhs_);
+    const auto& b = materialize(rhs_);
+    multiply<Mode, L::rows(), L::columns(), R::columns()>(a.data(), b.data(), out);
+  }
+
+ private:
+  L lhs_;
+  R rhs_;
+};
+
+// Evaluates e into the elements of a new Matrix, which are zero already:
+// a product whose kernel would clear them accumulates into them instead.
+template <typename E>
+constexpr void initialize(const E& e, typename E::value_type* out) {
+  if constexpr (requires { requires E::kClearsOut; }) {
+    evaluate<Accumulate::Add>(e, out);
+  } else {
+    evaluate<Accumulate::Assign>(e, out);
+  }
+}
+
+}  // namespace matrix_detail
+
+template <std::size_t N, std::size_t M, typename Field>
+class Matrix {
+  static_assert(N > 0 && M > 0, "Matrix dimensions must be positive");
+
+ public:
+  using value_type = Field;
+  using size_type = std::size_t;
+
+  static constexpr size_type rows() noexcept { return N; }
+  static constexpr size_type columns() noexcept { return M; }
+  static constexpr size_type size() noexcept { return N * M; }
+
+  constexpr Matrix() = default;
+
+  // Evaluates an expression of other matrices straight into this one.
+  template <matrix_detail::Expression E>
+    requires(matrix_detail::SameShape<E, Matrix> && !matrix_detail::IsMatrix<E>::value)
+  constexpr Matrix(const E& expression) {  // NOLINT(google-explicit-constructor)
+    matrix_detail::initialize(expression, data());
+  }
+
+  // An expression that reads this matrix, other than elementwise, is
+  // evaluated aside and moved in.
+  template <matrix_detail::Expression E>
+    requires(matrix_detail::SameShape<E, Matrix> && !matrix_detail::IsMatrix<E>::value)
+  constexpr Matrix& operator=(const E& expression) {
+    if constexpr (!E::kElementwise) {
+      if (expression.aliases(data())) {
+        return *this = Matrix(expression);
+      }
+    }
+    matrix_detail::evaluate<matrix_detail::Accumulate::Assign>(expression, data());
+    return *this;
+  }
+
+  // Row by row; throws std::invalid_argument unless the shape is N x M.
+  constexpr Matrix(std::initializer_list<std::initializer_list<Field>> values) {
+    if (values.size() != N) {
+      throw std::invalid_argument("Matrix: wrong number of rows");
+    }
+    Field* out = data();
+    for (const auto& row : values) {
+      if (row.size() != M) {
+        throw std::invalid_argument("Matrix: wrong number of columns");
+      }
+      for (const Field& value : row) {
+        *out++ = value;
+      }
+    }
+  }
+
+  static constexpr Matrix identity()
+    requires(N == M)
+  {
+    Matrix result;
+    for (size_type i = 0; i < N; ++i) {
+      result(i, i) = Field(1);
+    }
+    return result;
+  }
+
+  constexpr Field& operator()(size_type i, size_type j) noexcept { return data()[i * M + j]; }
+  constexpr const Field& operator()(size_type i, size_type j) const noexcept {
+    return data()[i * M + j];
+  }
+
+  // Row i, so that m[i][j] works.
+  constexpr Field* operator[](size_type i) noexcept { return data() + i * M; }
+  constexpr const Field* operator[](size_type i) const noexcept { return data() + i * M; }
+
+  constexpr Field* data() noexcept { return storage_.data(); }
+  constexpr const Field* data() const noexcept { return storage_.data(); }
+
+  constexpr Matrix<1, M, Field> row(size_type i) const {
+    Matrix<1, M, Field> result;
+    for (size_type j = 0; j < M; ++j) {
+      result(0, j) = (*this)(i, j);
+    }
+    return result;
+  }
+
+  constexpr Matrix<N, 1, Field> column(size_type j) const {
+    Matrix<N, 1, Field> result;
+    for (size_type i = 0; i < N; ++i) {
+      result(i, 0) = (*this)(i, j);
+    }
+    return result;
+  }
+
+  constexpr Matrix<M, N, Field> transposed() const {
+    Matrix<M, N, Field> result;
+    for (size_type i = 0; i < N; ++i) {
+      for (size_type j = 0; j < M; ++j) {
+        result(j, i) = (*this)(i, j);
+      }
+    }
+    return result;
+  }
+
+  constexpr Field trace() const
+    requires(N == M)
+  {
+    Field sum{};
+    for (size_type i = 0; i < N; ++i) {
+      sum += (*this)(i, i);
+    }
+    return sum;
+  }
+
+  constexpr Field det() const
+    requires(N == M)
+  {
+    if constexpr (matrix_detail::kBlockedLu<Field, N>) {
+      if (!std::is_constant_evaluated()) {
+        return LuDecomposition<N, Field>(*this).det();
+      }
+    }
+    Matrix work = *this;
+    return matrix_detail::eliminate(work.data(), N, N, N, false).det;
+  }
+
+  // A nonsingular square matrix is settled by its LU factors; anything else
+  // needs the echelon form.
+  constexpr size_type rank() const {
+    if constexpr (N == M && matrix_detail::kBlockedLu<Field, N>) {
+      if (!std::is_constant_evaluated() && !LuDecomposition<N, Field>(*this).singular()) {
+        return N;
+      }
+    }
+    Matrix work = *this;
+    return matrix_detail::eliminate(work.data(), N, M, M, false).rank;
+  }
+
+  // The x with A x = b. Throws std::domain_error if A is singular.
+  template <std::size_t K>
+  constexpr Matrix<N, K, Field> solve(const Matrix<N, K, Field>& b) const
+    requires(N == M)
+  {
+    return LuDecomposition<N, Field>(*this).solve(b);
+  }
+
+  // Gauss-Jordan on [A | I], or A^-1 I from the LU factors for large float
+  // and double matrices. Throws std::domain_error if A is singular.
+  constexpr Matrix inverted() const
+    requires(N == M)
+  {
+    if constexpr (matrix_detail::kBlockedLu<Field, N>) {
+      if (!std::is_constant_evaluated()) {
+        return LuDecomposition<N, Field>(*this).inverse();
+      }
+    }
+    Matrix<N, 2 * N, Field> work;
+    for (size_type i = 0; i < N; ++i) {
+      for (size_type j = 0; j < N; ++j) {
+        work(i, j) = (*this)(i, j);
+      }
+      work(i, N + i) = Field(1);
+    }
+    if (matrix_detail::eliminate(work.data(), N, 2 * N, N, true).rank < N) {
+      throw std::domain_error("Matrix: inverse of a singular matrix");
+    }
+    Matrix result;
+    for (size_type i = 0; i < N; ++i) {
+      for (size_type j = 0; j < N; ++j) {
+        result(i, j) = work(i, N + j);
+      }
+    }
+    return result;
+  }
+
+  constexpr Matrix& invert()
+    requires(N == M)
+  {
+    return *this = inverted();
+  }
+
+  template <matrix_detail::Expression E>
+    requires matrix_detail::SameShape<E, Matrix>
+  constexpr Matrix& operator+=(const E& expression) {
+    return accumulate<matrix_detail::Accumulate::Add>(matrix_detail::as_node(expression));
+  }
+
+  template <matrix_detail::Expression E>
+    requires matrix_detail::SameShape<E, Matrix>
+  constexpr Matrix& operator-=(const E& expression) {
+    return accumulate<matrix_detail::Accumulate::Subtract>(matrix_detail::as_node(expression));
+  }
+
+  constexpr Matrix& operator*=(const Field& scale) {
+    for (size_type i = 0; i < size(); ++i) {
+      data()[i] *= scale;
+    }
+    return *this;
+  }
+
+  constexpr Matrix& operator*=(const Matrix<M, M, Field>& other) {
+    return *this = *this * other;
+  }
+
+  constexpr Matrix operator+() const { return *this; }
+
+  friend constexpr bool operator==(const Matrix& lhs, const Matrix& rhs) {
+    for (size_type i = 0; i < size(); ++i) {
+      if (!(lhs.data()[i] == rhs.data()[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  template <matrix_detail::Accumulate Mode, typename Node>
+  constexpr Matrix& accumulate(const Node& node) {
+    if constexpr (!Node::kElementwise) {
+      if (node.aliases(data())) {
+        const Matrix value(node);
+        matrix_detail::evaluate<Mode>(matrix_detail::as_node(value), data());
+        return *this;
+      }
+    }
+    matrix_detail::evaluate<Mode>(node, data());
+    return *this;
+  }
+
+  matrix_detail::Storage<Field, N * M> storage_;
+};
+
+template <std::size_t N, typename Field = double>
+using SquareMatrix = Matrix<N, N, Field>;
+
+// Arithmetic on matrices and expressions builds an expression; nothing is
+// computed until it is assigned to a Matrix or converted into one.
+
+template <typename L, typename R>
+  requires matrix_detail::SameShape<L, R>
+constexpr auto operator+(L&& lhs, R&& rhs) {
+  return matrix_detail::Sum<matrix_detail::NodeOf<L>, matrix_detail::NodeOf<R>, false>(
+      matrix_detail::as_node(std::forward<L>(lhs)), matrix_detail::as_node(std::forward<R>(rhs)));
+}
+
+template <typename L, typename R>
+  requires matrix_detail::SameShape<L, R>
+constexpr auto operator-(L&& lhs, R&& rhs) {
+  return matrix_detail::Sum<matrix_detail::NodeOf<L>, matrix_detail::NodeOf<R>, true>(
+      matrix_detail::as_node(std::forward<L>(lhs)), matrix_detail::as_node(std::forward<R>(rhs)));
+}
+
+template <matrix_detail::Expression E>
+constexpr auto operator-(E&& operand) {
+  return matrix_detail::Negated<matrix_detail::NodeOf<E>>(
+      matrix_detail::as_node(std::forward<E>(operand)));
+}
+
+template <matrix_detail::Expression E>
+constexpr auto operator*(E&& operand, const typename std::remove_cvref_t<E>::value_type& scale) {
+  return matrix_detail::Scaled<matrix_detail::NodeOf<E>>(
+      matrix_detail::as_node(std::forward<E>(operand)), scale);
+}
+
+template <matrix_detail::Expression E>
+constexpr auto operator*(const typename std::remove_cvref_t<E>::value_type& scale, E&& operand) {
+  return matrix_detail::Scaled<matrix_detail::NodeOf<E>>(
+      matrix_detail::as_node(std::forward<E>(operand)), scale);
+}
+
+template <typename L, typename R>
+  requires matrix_detail::Multipliable<L, R>
+constexpr auto operator*(L&& lhs, R&& rhs) {
+  return matrix_detail::Product<matrix_detail::NodeOf<L>, matrix_detail::NodeOf<R>>(
+      matrix_detail::as_node(std::forward<L>(lhs)), matrix_detail::as_node(std::forward<R>(rhs)));
+}
+
+// A = P L U with partial pivoting, computed once to take determinants and
+// solve any number of systems. Large float and double matrices are
+// factored blockwise on several threads.
+template <std::size_t N, typename Field = double>
+class LuDecomposition {
+ public:
+  constexpr explicit LuDecomposition(const Matrix<N, N, Field>& a) : factors_(a), pivots_(N) {
+    if constexpr (matrix_detail::kBlockedLu<Field, N>) {
+      if (!std::is_constant_evaluated()) {
+        nonsingular_ = matrix_detail::lu_factor(N, factors_.data(), pivots_.data());
+        return;
+      }
+    }
+    nonsingular_ = matrix_detail::lu_factor_unblocked(factors_.data(), N, pivots_.data());
+  }
+
+  constexpr bool singular() const noexcept { return !nonsingular_; }
+
+  constexpr Field det() const {
+    if (!nonsingular_) {
+      return Field{};
+    }
+    Field result(1);
+    for (std::size_t i = 0; i < N; ++i) {
+      result *= factors_(i, i);
+      if (pivots_[i] != i) {
+        result = -result;
+      }
+    }
+    return result;
+  }
+
+  // The x with A x = b. Throws std::domain_error if A is singular.
+  template <std::size_t K>
+  constexpr Matrix<N, K, Field> solve(Matrix<N, K, Field> b) const {
+    if (!nonsingular_) {
+      throw std::domain_error("Matrix: solve with a singular matrix");
+    }
+    if constexpr (matrix_detail::kBlockedLu<Field, N>) {
+      if (!std::is_constant_evaluated()) {
+        matrix_detail::lu_solve(N, K, factors_.data(), pivots_.data(), b.data());
+        return b;
+      }
+    }
+    matrix_detail::lu_solve_unblocked(N, K, factors_.data(), pivots_.data(), b.data());
+    return b;
+  }
+
+  // Throws std::domain_error if A is singular.
+  constexpr Matrix<N, N, Field> inverse() const {
+    if (!nonsingular_) {
+      throw std::domain_error("Matrix: inverse of a singular matrix");
+    }
+    return solve(Matrix<N, N, Field>::identity());
+  }
+
+  // L strictly below the diagonal, U on and above it.
+  constexpr const Matrix<N, N, Field>& factors() const noexcept { return factors_; }
+  // Row i was swapped with row pivots()[i] at step i.
+  constexpr const std::vector<std::size_t>& pivots() const noexcept { return pivots_; }
+
+ private:
+  Matrix<N, N, Field> factors_;
+  std::vector<std::size_t> pivots_;
+  bool nonsingular_ = false;
+};
@@ -0,0 +1,262 @@
+// Packed, register-tiled matrix multiplication behind Matrix::operator*.
+//
+// The classic Goto/BLIS scheme: B is copied in KC x NC blocks into panels
+// NR columns wide and A in MC x KC blocks into panels MR rows high, so the
+// micro-kernel streams both operands from contiguous, cache-resident
+// memory. The micro-kernel keeps an MR x NR tile of C in vector registers
+// for the whole KC-long update, which is what gets it near peak FLOPS.
+//
+// There is one micro-kernel, written with GCC vector extensions and
+// instantiated per vector width: 16 bytes for the portable build (SSE2 on
+// x86-64, NEON on AArch64), 32 bytes with AVX2 and FMA, 64 with AVX-512.
+// The widest one the CPU supports is picked at first use. This file is
+// built with -ffp-contract=fast so the vector multiply-adds become FMAs.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "Matrix/matrix.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MATRIX_GEMM_X86 1
+#endif
+
+namespace matrix_detail {
+
+namespace {
+
+// Rows of A per packed block, depth of the rank-KC update and columns of B
+// per packed block. MC is a multiple of every MR below.
+constexpr std::size_t kMc = 96;
+constexpr std::size_t kKc = 256;
+constexpr std::size_t kNc = 2048;
+
+template <typename T, std::size_t Bytes>
+struct VectorOf {
+  using type __attribute__((vector_size(Bytes))) = T;
+};
+
+// C[MR x NR] += A panel * B panel over depth kc; NR is NV vectors.
+template <typename T, std::size_t Bytes, std::size_t MR, std::size_t NV>
+[[gnu::always_inline]] inline void tile(std::size_t kc, const T* a, const T* b, T* c,
+                                        std::size_t ldc) {
+  using V = typename VectorOf<T, Bytes>::type;
+  constexpr std::size_t kLanes = Bytes / sizeof(T);
+  V acc[MR][NV] = {};
+  for (std::size_t p = 0; p < kc; ++p) {
+    V row[NV];
+    for (std::size_t v = 0; v < NV; ++v) {
+      std::memcpy(&row[v], b + (p * NV + v) * kLanes, Bytes);
+    }
+    for (std::size_t r = 0; r < MR; ++r) {
+      V broadcast = V{} + a[p * MR + r];
+      for (std::size_t v = 0; v < NV; ++v) {
+        acc[r][v] += broadcast * row[v];
+      }
+    }
+  }
+  for (std::size_t r = 0; r < MR; ++r) {
+    for (std::size_t v = 0; v < NV; ++v) {
+      V out;
+      std::memcpy(&out, c + r * ldc + v * kLanes, Bytes);
+      out += acc[r][v];
+      std::memcpy(c + r * ldc + v * kLanes, &out, Bytes);
+    }
+  }
+}
+
+template <typename T>
+struct TileKernel {
+  std::size_t mr;
+  std::size_t nr;
+  void (*tile)(std::size_t kc, const T* a, const T* b, T* c, std::size_t ldc);
+};
+
+struct Kernels {
+  GemmIsa isa;
+  TileKernel<float> f;
+  TileKernel<double> d;
+};
+
+void tile_portable_f(std::size_t kc, const float* a, const float* b, float* c, std::size_t ldc) {
+  tile<float, 16, 4, 2>(kc, a, b, c, ldc);
+}
+void tile_portable_d(std::size_t kc, const double* a, const double* b, double* c,
+                     std::size_t ldc) {
+  tile<double, 16, 4, 2>(kc, a, b, c, ldc);
+}
+
+constexpr Kernels kPortable{GemmIsa::Portable, {4, 8, tile_portable_f}, {4, 4, tile_portable_d}};
+
+#if defined(MATRIX_GEMM_X86)
+
+__attribute__((target("avx2,fma"))) void tile_avx2_f(std::size_t kc, const float* a,
+                                                     const float* b, float* c,
+                                                     std::size_t ldc) {
+  tile<float, 32, 6, 2>(kc, a, b, c, ldc);
+}
+__attribute__((target("avx2,fma"))) void tile_avx2_d(std::size_t kc, const double* a,
+                                                     const double* b, double* c,
+                                                     std::size_t ldc) {
+  tile<double, 32, 6, 2>(kc, a, b, c, ldc);
+}
+
+constexpr Kernels kAvx2{GemmIsa::Avx2, {6, 16, tile_avx2_f}, {6, 8, tile_avx2_d}};
+
+__attribute__((target("avx512f"))) void tile_avx512_f(std::size_t kc, const float* a,
+                                                      const float* b, float* c,
+                                                      std::size_t ldc) {
+  tile<float, 64, 8, 2>(kc, a, b, c, ldc);
+}
+__attribute__((target("avx512f"))) void tile_avx512_d(std::size_t kc, const double* a,
+                                                      const double* b, double* c,
+                                                      std::size_t ldc) {
+  tile<double, 64, 8, 2>(kc, a, b, c, ldc);
+}
+
+constexpr Kernels kAvx512{GemmIsa::Avx512, {8, 32, tile_avx512_f}, {8, 16, tile_avx512_d}};
+
+#endif  // MATRIX_GEMM_X86
+
+const Kernels* kernels_for(GemmIsa isa) {
+  switch (isa) {
+#if defined(MATRIX_GEMM_X86)
+    case GemmIsa::Avx2:
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? &kAvx2
+                                                                             : nullptr;
+    case GemmIsa::Avx512:
+      return __builtin_cpu_supports("avx512f") ? &kAvx512 : nullptr;
+#endif
+    case GemmIsa::Portable:
+      return &kPortable;
+    default:
+      return nullptr;
+  }
+}
+
+const Kernels* detect_kernels() {
+  for (GemmIsa isa : {GemmIsa::Avx512, GemmIsa::Avx2}) {
+    if (const Kernels* found = kernels_for(isa)) {
+      return found;
+    }
+  }
+  return &kPortable;
+}
+
+constinit std::atomic<const Kernels*> active_kernels{nullptr};
+
+const Kernels& kernels() {
+  const Kernels* current = active_kernels.load(std::memory_order_relaxed);
+  if (current == nullptr) {
+    current = detect_kernels();
+    active_kernels.store(current, std::memory_order_relaxed);
+  }
+  return *current;
+}
+
+// Copies rows [0, mc) x columns [0, kc) of A into MR-row panels, each
+// stored column by column and padded with zero rows.
+template <typename T>
+void pack_a(std::size_t mc, std::size_t kc, const T* a, std::size_t lda, std::size_t mr,
+            T* out) {
+  for (std::size_t i = 0; i < mc; i += mr) {
+    std::size_t rows = std::min(mr, mc - i);
+    for (std::size_t p = 0; p < kc; ++p) {
+      for (std::size_t r = 0; r < rows; ++r) {
+        out[r] = a[(i + r) * lda + p];
+      }
+      std::fill(out + rows, out + mr, T{});
+      out += mr;
+    }
+  }
+}
+
+// Copies rows [0, kc) x columns [0, nc) of B into NR-column panels, each
+// stored row by row and padded with zero columns.
+template <typename T>
+void pack_b(std::size_t kc, std::size_t nc, const T* b, std::size_t ldb, std::size_t nr,
+            T* out) {
+  for (std::size_t j = 0; j < nc; j += nr) {
+    std::size_t columns = std::min(nr, nc - j);
+    for (std::size_t p = 0; p < kc; ++p) {
+      std::copy(b + p * ldb + j, b + p * ldb + j + columns, out);
+      std::fill(out + columns, out + nr, T{});
+      out += nr;
+    }
+  }
+}
+
+template <typename T>
+void gemm_blocked(const TileKernel<T>& kernel, std::size_t n, std::size_t m, std::size_t k,
+                  const T* a, std::size_t lda, const T* b, std::size_t ldb, T* c,
+                  std::size_t ldc) {
+  const std::size_t mr = kernel.mr;
+  const std::size_t nr = kernel.nr;
+  // Per thread, so concurrent products do not share buffers.
+  thread_local std::vector<T> packed_a;
+  thread_local std::vector<T> packed_b;
+  packed_a.resize(kMc * kKc);
+  packed_b.resize(kKc * ((std::min(kNc, k) + nr - 1) / nr * nr));
+  T edge[8 * 32];
+
+  for (std::size_t jc = 0; jc < k; jc += kNc) {
+    std::size_t nc = std::min(kNc, k - jc);
+    for (std::size_t pc = 0; pc < m; pc += kKc) {
+      std::size_t kc = std::min(kKc, m - pc);
+      pack_b(kc, nc, b + pc * ldb + jc, ldb, nr, packed_b.data());
+      for (std::size_t ic = 0; ic < n; ic += kMc) {
+        std::size_t mc = std::min(kMc, n - ic);
+        pack_a(mc, kc, a + ic * lda + pc, lda, mr, packed_a.data());
+        for (std::size_t jr = 0; jr < nc; jr += nr) {
+          std::size_t columns = std::min(nr, nc - jr);
+          for (std::size_t ir = 0; ir < mc; ir += mr) {
+            std::size_t rows = std::min(mr, mc - ir);
+            const T* panel_a = packed_a.data() + ir * kc;
+            const T* panel_b = packed_b.data() + jr * kc;
+            T* out = c + (ic + ir) * ldc + jc + jr;
+            if (rows == mr && columns == nr) {
+              kernel.tile(kc, panel_a, panel_b, out, ldc);
+              continue;
+            }
+            // Edge tile: compute in full into a scratch tile, keep the rest.
+            std::fill(edge, edge + mr * nr, T{});
+            kernel.tile(kc, panel_a, panel_b, edge, nr);
+            for (std::size_t r = 0; r < rows; ++r) {
+              for (std::size_t j = 0; j < columns; ++j) {
+                out[r * ldc + j] += edge[r * nr + j];
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+
+bool select_gemm_isa(GemmIsa isa) {
+  const Kernels* requested = kernels_for(isa);
+  if (requested == nullptr) {
+    return false;
+  }
+  active_kernels.store(requested, std::memory_order_relaxed);
+  return true;
+}
+
+GemmIsa active_gemm_isa() { return kernels().isa; }
+
+void gemm(std::size_t n, std::size_t m, std::size_t k, const float* a, std::size_t lda,
+          const float* b, std::size_t ldb, float* c, std::size_t ldc) {
+  gemm_blocked(kernels().f, n, m, k, a, lda, b, ldb, c, ldc);
+}
+
+void gemm(std::size_t n, std::size_t m, std::size_t k, const double* a, std::size_t lda,
+          const double* b, std::size_t ldb, double* c, std::size_t ldc) {
+  gemm_blocked(kernels().d, n, m, k, a, lda, b, ldb, c, ldc);
+}
+
+}  // namespace matrix_detail
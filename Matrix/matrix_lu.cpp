@@ -0,0 +1,240 @@
+// Blocked LU factorization and triangular solves behind LuDecomposition.
+//
+// Recursive, after Toledo: the left half of the columns is factored with
+// partial pivoting, the top of the right half is solved against the left
+// half's unit lower triangle, the rest of the right half gets the update
+// A22 -= L21 U12, and the right half is factored the same way. The
+// triangular solves halve recursively too. Only kLeaf-wide strips are left
+// to plain loops; everything else is a matrix product on the packed gemm
+// kernels, with the negated left operand copied once so that gemm's
+// C += A B does the subtraction.
+//
+// Updates are cut into row (or column) ranges and run on
+// ThreadPool::shared(). The kLeaf-wide strips, pivot search included, stay
+// serial; they are O(n^2 kLeaf) overall.
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "Matrix/matrix.h"
+#include "ThreadPool/threadpool.h"
+
+namespace matrix_detail {
+
+namespace {
+
+// Widest strip factored or solved by plain loops.
+constexpr std::size_t kLeaf = 16;
+// Fewest rows or columns worth handing to another thread.
+constexpr std::size_t kGrain = 64;
+
+// body(begin, end) over ranges covering [0, total), a few per thread so
+// that uneven ranges even out.
+template <typename Body>
+void parallel_ranges(std::size_t total, Body&& body) {
+  ThreadPool& pool = ThreadPool::shared();
+  std::size_t pieces = 4 * pool.size();
+  pool.parallel_for_ranges(0, total, body, std::max(kGrain, (total + pieces - 1) / pieces));
+}
+
+// C[rows x columns] -= A B for A = rows x depth at a with stride lda: the
+// negated A is copied once, then gemm runs on ranges of rows.
+template <typename T>
+void subtract_product(std::size_t rows, std::size_t depth, std::size_t columns, const T* a,
+                      std::size_t lda, const T* b, std::size_t ldb, T* c, std::size_t ldc) {
+  if (rows == 0 || depth == 0 || columns == 0) {
+    return;
+  }
+  std::vector<T> negated(rows * depth);
+  for (std::size_t i = 0; i < rows; ++i) {
+    for (std::size_t p = 0; p < depth; ++p) {
+      negated[i * depth + p] = -a[i * lda + p];
+    }
+  }
+  parallel_ranges(rows, [&](std::size_t begin, std::size_t end) {
+    gemm(end - begin, depth, columns, negated.data() + begin * depth, depth, b, ldb,
+         c + begin * ldc, ldc);
+  });
+}
+
+// Factors columns [j0, j0 + jb) of the n x n matrix at a below row j0,
+// then applies its row swaps to the other columns. Returns false if a pivot
+// fell below the tolerance.
+//
+// The strip is factored in a contiguous copy: walking a column of the
+// matrix itself touches a new page per row.
+template <typename T>
+bool factor_panel(std::size_t n, T* a, std::size_t j0, std::size_t jb, std::size_t* pivots,
+                  T tolerance) {
+  const std::size_t rows = n - j0;
+  thread_local std::vector<T> strip;
+  strip.resize(rows * jb);
+  for (std::size_t r = 0; r < rows; ++r) {
+    std::copy(a + (j0 + r) * n + j0, a + (j0 + r) * n + j0 + jb, strip.data() + r * jb);
+  }
+
+  bool nonsingular = true;
+  for (std::size_t j = 0; j < jb; ++j) {
+    std::size_t pivot_row = find_pivot(strip.data(), rows, jb, j, j, tolerance);
+    if (pivot_row == rows) {
+      pivots[j0 + j] = j0 + j;
+      nonsingular = false;
+      continue;
+    }
+    pivots[j0 + j] = j0 + pivot_row;
+    if (pivot_row != j) {
+      std::swap_ranges(strip.data() + pivot_row * jb, strip.data() + pivot_row * jb + jb,
+                       strip.data() + j * jb);
+    }
+    const T* pivot = strip.data() + j * jb;
+    const T inverse = T(1) / pivot[j];
+    for (std::size_t r = j + 1; r < rows; ++r) {
+      T* row = strip.data() + r * jb;
+      row[j] *= inverse;
+      const T factor = row[j];
+      for (std::size_t c = j + 1; c < jb; ++c) {
+        row[c] -= factor * pivot[c];
+      }
+    }
+  }
+
+  for (std::size_t r = 0; r < rows; ++r) {
+    std::copy(strip.data() + r * jb, strip.data() + r * jb + jb, a + (j0 + r) * n + j0);
+  }
+  for (std::size_t j = j0; j < j0 + jb; ++j) {
+    if (pivots[j] != j) {
+      T* row = a + j * n;
+      T* other = a + pivots[j] * n;
+      std::swap_ranges(row, row + j0, other);
+      std::swap_ranges(row + j0 + jb, row + n, other + j0 + jb);
+    }
+  }
+  return nonsingular;
+}
+
+// Rows [i0, i0 + ib) of the k columns at b with row stride ldb become
+// L^-1 times themselves, for L the unit lower triangle of the ib x ib
+// diagonal block of lu at i0. A leaf, run on ranges of columns.
+template <typename T>
+void solve_lower_leaf(std::size_t n, std::size_t i0, std::size_t ib, const T* lu, std::size_t k,
+                      T* b, std::size_t ldb) {
+  parallel_ranges(k, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = i0 + 1; i < i0 + ib; ++i) {
+      T* row = b + i * ldb;
+      for (std::size_t p = i0; p < i; ++p) {
+        const T factor = lu[i * n + p];
+        const T* source = b + p * ldb;
+        for (std::size_t c = begin; c < end; ++c) {
+          row[c] -= factor * source[c];
+        }
+      }
+    }
+  });
+}
+
+// The same with U^-1, U the upper triangle including the diagonal.
+template <typename T>
+void solve_upper_leaf(std::size_t n, std::size_t i0, std::size_t ib, const T* lu, std::size_t k,
+                      T* b, std::size_t ldb) {
+  parallel_ranges(k, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = i0 + ib; i-- > i0;) {
+      T* row = b + i * ldb;
+      for (std::size_t p = i + 1; p < i0 + ib; ++p) {
+        const T factor = lu[i * n + p];
+        const T* source = b + p * ldb;
+        for (std::size_t c = begin; c < end; ++c) {
+          row[c] -= factor * source[c];
+        }
+      }
+      const T inverse = T(1) / lu[i * n + i];
+      for (std::size_t c = begin; c < end; ++c) {
+        row[c] *= inverse;
+      }
+    }
+  });
+}
+
+template <typename T>
+void solve_lower(std::size_t n, std::size_t i0, std::size_t ib, const T* lu, std::size_t k, T* b,
+                 std::size_t ldb) {
+  if (ib <= kLeaf) {
+    solve_lower_leaf(n, i0, ib, lu, k, b, ldb);
+    return;
+  }
+  const std::size_t half = ib / 2;
+  solve_lower(n, i0, half, lu, k, b, ldb);
+  subtract_product(ib - half, half, k, lu + (i0 + half) * n + i0, n, b + i0 * ldb, ldb,
+                   b + (i0 + half) * ldb, ldb);
+  solve_lower(n, i0 + half, ib - half, lu, k, b, ldb);
+}
+
+template <typename T>
+void solve_upper(std::size_t n, std::size_t i0, std::size_t ib, const T* lu, std::size_t k, T* b,
+                 std::size_t ldb) {
+  if (ib <= kLeaf) {
+    solve_upper_leaf(n, i0, ib, lu, k, b, ldb);
+    return;
+  }
+  const std::size_t half = ib / 2;
+  solve_upper(n, i0 + half, ib - half, lu, k, b, ldb);
+  subtract_product(half, ib - half, k, lu + i0 * n + i0 + half, n, b + (i0 + half) * ldb, ldb,
+                   b + i0 * ldb, ldb);
+  solve_upper(n, i0, half, lu, k, b, ldb);
+}
+
+// Factors columns [j0, j0 + width) below row j0. Returns false if a pivot
+// fell below the tolerance.
+template <typename T>
+bool factor_columns(std::size_t n, T* a, std::size_t j0, std::size_t width, std::size_t* pivots,
+                    T tolerance) {
+  if (width <= kLeaf) {
+    return factor_panel(n, a, j0, width, pivots, tolerance);
+  }
+  const std::size_t half = width / 2;
+  const std::size_t right = j0 + half;
+  bool nonsingular = factor_columns(n, a, j0, half, pivots, tolerance);
+  // U12 = L11^-1 A12, then A22 -= L21 U12.
+  solve_lower(n, j0, half, a, width - half, a + right, n);
+  subtract_product(n - right, half, width - half, a + right * n + j0, n, a + j0 * n + right, n,
+                   a + right * n + right, n);
+  return factor_columns(n, a, right, width - half, pivots, tolerance) && nonsingular;
+}
+
+template <typename T>
+bool lu_factor_recursive(std::size_t n, T* a, std::size_t* pivots) {
+  return factor_columns(n, a, 0, n, pivots, pivot_tolerance(a, n, n, n));
+}
+
+template <typename T>
+void lu_solve_recursive(std::size_t n, std::size_t k, const T* lu, const std::size_t* pivots,
+                        T* b) {
+  for (std::size_t i = 0; i < n; ++i) {
+    if (pivots[i] != i) {
+      std::swap_ranges(b + pivots[i] * k, b + pivots[i] * k + k, b + i * k);
+    }
+  }
+  solve_lower(n, 0, n, lu, k, b, k);
+  solve_upper(n, 0, n, lu, k, b, k);
+}
+
+}  // namespace
+
+bool lu_factor(std::size_t n, float* a, std::size_t* pivots) {
+  return lu_factor_recursive(n, a, pivots);
+}
+
+bool lu_factor(std::size_t n, double* a, std::size_t* pivots) {
+  return lu_factor_recursive(n, a, pivots);
+}
+
+void lu_solve(std::size_t n, std::size_t k, const float* lu, const std::size_t* pivots, float* b) {
+  lu_solve_recursive(n, k, lu, pivots, b);
+}
+
+void lu_solve(std::size_t n, std::size_t k, const double* lu, const std::size_t* pivots,
+              double* b) {
+  lu_solve_recursive(n, k, lu, pivots, b);
+}
+
+}  // namespace matrix_detail
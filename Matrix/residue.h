@@ -0,0 +1,236 @@
+#pragma once
+
+// Integers modulo N, a field when N is prime.
+//
+// Residue<N> is four bytes. For odd N the value is kept in Montgomery form,
+// a * 2^32 mod N, so a product is one 64-bit multiplication and a
+// Montgomery reduction (two more multiplications and a shift) instead of a
+// hardware division. Sums and differences need a single branchless
+// correction. N = 2 is done with plain arithmetic.
+//
+// Division and inverse() require N to be prime, which is checked at compile
+// time. The inverse is Kaliski's Montgomery inverse, a binary extended
+// Euclidean algorithm that consumes whole runs of zero bits with one count
+// trailing zeros, followed by one multiplication that fixes up the power of
+// two; no division either.
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+namespace residue_detail {
+
+constexpr bool is_prime(std::uint32_t n) {
+  if (n < 2) {
+    return false;
+  }
+  if (n % 2 == 0 || n % 3 == 0) {
+    return n < 4;
+  }
+  for (std::uint32_t d = 5; d <= n / d; d += 6) {
+    if (n % d == 0 || n % (d + 2) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace residue_detail
+
+template <std::uint32_t N>
+class Residue {
+  static_assert(N >= 2 && N < (std::uint32_t{1} << 31), "Residue modulus must be in [2, 2^31)");
+
+  static constexpr bool kMontgomery = N % 2 == 1;
+
+  // -N^-1 mod 2^32 by Newton's iteration, each step doubling the correct
+  // low bits (N is its own inverse mod 8).
+  static constexpr std::uint32_t kNegInverse = [] {
+    std::uint32_t inverse = N;
+    for (int i = 0; i < 4; ++i) {
+      inverse *= 2 - N * inverse;
+    }
+    return 0 - inverse;
+  }();
+  // 2^64 mod N, converts into Montgomery form with one reduction.
+  static constexpr std::uint32_t kR2 = [] {
+    std::uint64_t r = (std::uint64_t{1} << 32) % N;
+    return static_cast<std::uint32_t>(r * r % N);
+  }();
+
+ public:
+  static constexpr std::uint32_t modulus() noexcept { return N; }
+  static constexpr bool kIsField = residue_detail::is_prime(N);
+
+  constexpr Residue() = default;
+
+  template <std::integral T>
+  constexpr Residue(T value) noexcept  // NOLINT(google-explicit-constructor)
+      : repr_(to_repr(reduce_integer(value))) {}
+
+  // The representative in [0, N).
+  constexpr std::uint32_t value() const noexcept {
+    if constexpr (kMontgomery) {
+      return reduce(repr_);
+    } else {
+      return repr_;
+    }
+  }
+
+  constexpr explicit operator std::uint32_t() const noexcept { return value(); }
+
+  constexpr Residue& operator+=(Residue other) noexcept {
+    repr_ = correct(repr_ + other.repr_ - N);
+    return *this;
+  }
+
+  constexpr Residue& operator-=(Residue other) noexcept {
+    repr_ = correct(repr_ - other.repr_);
+    return *this;
+  }
+
+  constexpr Residue& operator*=(Residue other) noexcept {
+    if constexpr (kMontgomery) {
+      repr_ = reduce(static_cast<std::uint64_t>(repr_) * other.repr_);
+    } else {
+      repr_ = static_cast<std::uint32_t>(static_cast<std::uint64_t>(repr_) * other.repr_ % N);
+    }
+    return *this;
+  }
+
+  // Throws std::domain_error when dividing by zero.
+  constexpr Residue& operator/=(Residue other)
+    requires kIsField
+  {
+    return *this *= other.inverse();
+  }
+
+  constexpr Residue inverse() const
+    requires kIsField
+  {
+    if (repr_ == 0) {
+      throw std::domain_error("Residue: inverse of zero");
+    }
+    Residue result;
+    if constexpr (kMontgomery) {
+      int k = 0;
+      std::uint32_t x = almost_inverse(repr_, k);
+      result.repr_ = reduce(static_cast<std::uint64_t>(x) * kInverseCorrection[k]);
+    } else {
+      result.repr_ = 1;
+    }
+    return result;
+  }
+
+  constexpr Residue pow(std::uint64_t exponent) const noexcept {
+    Residue result(1);
+    Residue base = *this;
+    for (; exponent != 0; exponent >>= 1) {
+      if (exponent & 1) {
+        result *= base;
+      }
+      base *= base;
+    }
+    return result;
+  }
+
+  constexpr Residue operator-() const noexcept { return Residue() - *this; }
+  constexpr Residue operator+() const noexcept { return *this; }
+
+  friend constexpr Residue operator+(Residue lhs, Residue rhs) noexcept { return lhs += rhs; }
+  friend constexpr Residue operator-(Residue lhs, Residue rhs) noexcept { return lhs -= rhs; }
+  friend constexpr Residue operator*(Residue lhs, Residue rhs) noexcept { return lhs *= rhs; }
+  friend constexpr Residue operator/(Residue lhs, Residue rhs)
+    requires kIsField
+  {
+    return lhs /= rhs;
+  }
+
+  // The representation is unique, so equality compares it directly.
+  friend constexpr bool operator==(Residue lhs, Residue rhs) noexcept {
+    return lhs.repr_ == rhs.repr_;
+  }
+
+ private:
+  template <std::integral T>
+  static constexpr std::uint32_t reduce_integer(T value) noexcept {
+    if constexpr (std::is_signed_v<T>) {
+      auto rest = static_cast<std::int64_t>(value % static_cast<std::int64_t>(N));
+      return static_cast<std::uint32_t>(rest < 0 ? rest + N : rest);
+    } else {
+      return static_cast<std::uint32_t>(value % N);
+    }
+  }
+
+  // x + N if x wrapped below zero, else x. Both operands were below
+  // N < 2^31, so the sign bit tells, and a mask instead of a branch keeps
+  // the pipeline from guessing on random data.
+  static constexpr std::uint32_t correct(std::uint32_t x) noexcept {
+    return x + (N & (0 - (x >> 31)));
+  }
+
+  static constexpr std::uint32_t to_repr(std::uint32_t value) noexcept {
+    if constexpr (kMontgomery) {
+      return reduce(static_cast<std::uint64_t>(value) * kR2);
+    } else {
+      return value;
+    }
+  }
+
+  // t * 2^-32 mod N for t < N * 2^32.
+  static constexpr std::uint32_t reduce(std::uint64_t t) noexcept {
+    std::uint32_t m = static_cast<std::uint32_t>(t) * kNegInverse;
+    auto u = static_cast<std::uint32_t>((t + static_cast<std::uint64_t>(m) * N) >> 32);
+    return u >= N ? u - N : u;
+  }
+
+  // Kaliski's almost inverse: x = a^-1 * 2^k mod N with k <= 62 for odd N
+  // and 0 < a < N, from subtractions and shifts over whole runs of zero
+  // bits. Keeps r * a = -u * 2^k and s * a = v * 2^k (mod N) while u and v
+  // shrink to their gcd, 1.
+  static constexpr std::uint32_t almost_inverse(std::uint32_t a, int& k) noexcept {
+    std::uint64_t u = N;
+    std::uint64_t v = a;
+    std::uint64_t r = 0;
+    std::uint64_t s = 1;
+    k = std::countr_zero(v);
+    v >>= k;
+    // Both branches are computed and selected, which the compiler turns into
+    // conditional moves: the comparison is a coin flip on random input.
+    while (u != v) {
+      bool u_larger = u > v;
+      std::uint64_t difference = u_larger ? u - v : v - u;
+      int shift = std::countr_zero(difference);
+      difference >>= shift;
+      std::uint64_t sum = r + s;
+      u = u_larger ? difference : u;
+      v = u_larger ? v : difference;
+      std::uint64_t shifted = (u_larger ? s : r) << shift;
+      r = u_larger ? sum : shifted;
+      s = u_larger ? shifted : sum;
+      k += shift;
+    }
+    // The last step, from u = v = 1 to v = 0.
+    r <<= 1;
+    ++k;
+    return static_cast<std::uint32_t>(r >= N ? 2 * N - r : N - r);
+  }
+
+  // 2^(96 - k) mod N: multiplying the almost inverse of a Montgomery
+  // representation by it and reducing once yields the inverse's
+  // representation.
+  static constexpr auto kInverseCorrection = [] {
+    std::array<std::uint32_t, 65> table{};
+    std::uint64_t power = (std::uint64_t{1} << 32) % N;
+    for (int k = 64; k >= 0; --k) {
+      table[k] = static_cast<std::uint32_t>(power);
+      power = power * 2 % N;
+    }
+    return table;
+  }();
+
+  std::uint32_t repr_ = 0;
+};
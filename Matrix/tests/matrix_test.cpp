@@ -0,0 +1,758 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Matrix/matrix.h"
+#include "Matrix/residue.h"
+#include "ThreadPool/threadpool.h"
+
+namespace {
+
+template <std::size_t N, std::size_t M, typename Field>
+Matrix<N, M, Field> random_matrix(unsigned seed) {
+  std::mt19937 gen(seed);
+  Matrix<N, M, Field> result;
+  if constexpr (std::is_floating_point_v<Field>) {
+    std::uniform_real_distribution<Field> value(-1, 1);
+    std::generate_n(result.data(), result.size(), [&] { return value(gen); });
+  } else {
+    std::uniform_int_distribution<Field> value(-9, 9);
+    std::generate_n(result.data(), result.size(), [&] { return value(gen); });
+  }
+  return result;
+}
+
+// Largest difference between a * b and a triple loop in double.
+template <std::size_t N, std::size_t M, std::size_t K, typename Field>
+double product_error(const Matrix<N, M, Field>& a, const Matrix<M, K, Field>& b,
+                     const Matrix<N, K, Field>& c) {
+  double error = 0;
+  for (std::size_t i = 0; i < N; ++i) {
+    for (std::size_t j = 0; j < K; ++j) {
+      double expected = 0;
+      for (std::size_t p = 0; p < M; ++p) {
+        expected += static_cast<double>(a(i, p)) * static_cast<double>(b(p, j));
+      }
+      error = std::max(error, std::abs(expected - static_cast<double>(c(i, j))));
+    }
+  }
+  return error;
+}
+
+template <typename Field>
+double tolerance(std::size_t m) {
+  if constexpr (std::is_same_v<Field, float>) {
+    return 1e-5 * static_cast<double>(m);
+  } else if constexpr (std::is_same_v<Field, double>) {
+    return 1e-13 * static_cast<double>(m);
+  } else {
+    return 0;
+  }
+}
+
+template <std::size_t N, std::size_t M, std::size_t K, typename Field>
+void check_product(unsigned seed) {
+  const auto a = random_matrix<N, M, Field>(seed);
+  const auto b = random_matrix<M, K, Field>(seed + 1);
+  const Matrix<N, K, Field> c = a * b;
+  EXPECT_LE(product_error(a, b, c), tolerance<Field>(M)) << N << "x" << M << "x" << K;
+
+  Matrix<N, K, Field> assigned = random_matrix<N, K, Field>(seed + 2);
+  assigned = a * b;
+  EXPECT_TRUE(assigned == c) << N << "x" << M << "x" << K;
+}
+
+constexpr Matrix<2, 2, int> kProduct =
+    Matrix<2, 2, int>{{1, 2}, {3, 4}} * Matrix<2, 2, int>{{5, 6}, {7, 8}};
+static_assert(kProduct(0, 0) == 19 && kProduct(0, 1) == 22);
+static_assert(kProduct(1, 0) == 43 && kProduct(1, 1) == 50);
+
+constexpr Matrix<3, 3, int> kRotation{{0, -1, 0}, {1, 0, 0}, {0, 0, 1}};
+static_assert(kRotation * kRotation * kRotation * kRotation == Matrix<3, 3, int>::identity());
+
+static_assert(sizeof(Matrix<4, 4, float>) == 16 * sizeof(float));
+static_assert(sizeof(Matrix<256, 256, double>) == sizeof(std::vector<double>));
+
+TEST(Matrix, StartsAtZero) {
+  const auto is_zero = [](double x) { return x == 0; };
+  Matrix<3, 4> small;
+  EXPECT_TRUE(std::all_of(small.data(), small.data() + small.size(), is_zero));
+  Matrix<64, 64> large;
+  EXPECT_TRUE(std::all_of(large.data(), large.data() + large.size(), is_zero));
+}
+
+TEST(Matrix, InitializerListChecksTheShape) {
+  Matrix<2, 3, int> m{{1, 2, 3}, {4, 5, 6}};
+  EXPECT_EQ(m(1, 2), 6);
+  EXPECT_EQ(m[0][1], 2);
+  EXPECT_THROW((Matrix<2, 3, int>{{1, 2, 3}}), std::invalid_argument);
+  EXPECT_THROW((Matrix<2, 3, int>{{1, 2, 3}, {4, 5}}), std::invalid_argument);
+}
+
+TEST(Matrix, RowsColumnsTransposeAndTrace) {
+  const Matrix<2, 3, int> m{{1, 2, 3}, {4, 5, 6}};
+  EXPECT_TRUE((m.row(1) == Matrix<1, 3, int>{{4, 5, 6}}));
+  EXPECT_TRUE((m.column(2) == Matrix<2, 1, int>{{3}, {6}}));
+  EXPECT_TRUE((m.transposed() == Matrix<3, 2, int>{{1, 4}, {2, 5}, {3, 6}}));
+  EXPECT_EQ((Matrix<2, 2, int>{{1, 2}, {3, 4}}.trace()), 5);
+  EXPECT_EQ((Matrix<3, 3, int>::identity().trace()), 3);
+}
+
+TEST(Matrix, LargeMatricesMoveTheirElements) {
+  auto a = random_matrix<128, 128, double>(1);
+  const double* elements = a.data();
+  Matrix<128, 128, double> b = std::move(a);
+  EXPECT_EQ(b.data(), elements);
+}
+
+TEST(Matrix, ElementwiseArithmetic) {
+  const Matrix<2, 2, int> a{{1, 2}, {3, 4}};
+  const Matrix<2, 2, int> b{{5, 6}, {7, 8}};
+  EXPECT_TRUE((Matrix<2, 2, int>(a + b) == Matrix<2, 2, int>{{6, 8}, {10, 12}}));
+  EXPECT_TRUE((Matrix<2, 2, int>(b - a) == Matrix<2, 2, int>{{4, 4}, {4, 4}}));
+  EXPECT_TRUE((Matrix<2, 2, int>(-a) == Matrix<2, 2, int>{{-1, -2}, {-3, -4}}));
+  EXPECT_TRUE((Matrix<2, 2, int>(2 * a) == Matrix<2, 2, int>{{2, 4}, {6, 8}}));
+  EXPECT_TRUE((Matrix<2, 2, int>(a * 3) == Matrix<2, 2, int>{{3, 6}, {9, 12}}));
+
+  Matrix<2, 2, int> c = a;
+  c += b;
+  c -= a;
+  EXPECT_TRUE(c == b);
+  c *= 2;
+  EXPECT_TRUE((c == Matrix<2, 2, int>{{10, 12}, {14, 16}}));
+  c *= Matrix<2, 2, int>::identity();
+  EXPECT_TRUE((c == Matrix<2, 2, int>{{10, 12}, {14, 16}}));
+}
+
+// Sizes on both sides of every strategy: unrolled up to 64 multiply-adds,
+// dot products below 4096, kernels from there on.
+TEST(Matrix, ProductsAgreeOnEveryStrategy) {
+  check_product<2, 3, 4, double>(1);
+  check_product<4, 4, 4, double>(2);
+  check_product<5, 5, 5, double>(3);
+  check_product<1, 64, 1, double>(4);
+  check_product<16, 16, 15, double>(5);
+  check_product<16, 16, 16, double>(6);
+  check_product<4, 4, 4, float>(7);
+  check_product<16, 16, 15, float>(8);
+}
+
+TEST(Matrix, IntegerProductsAreExact) {
+  check_product<3, 3, 3, int>(1);
+  check_product<8, 8, 8, int>(2);
+  check_product<40, 30, 20, long long>(3);
+}
+
+// Every kernel the CPU supports is checked against a triple loop.
+class MatrixGemm : public testing::TestWithParam<matrix_detail::GemmIsa> {
+ protected:
+  void SetUp() override {
+    previous_ = matrix_detail::active_gemm_isa();
+    if (!matrix_detail::select_gemm_isa(GetParam())) {
+      GTEST_SKIP() << "instruction set not supported here";
+    }
+  }
+  void TearDown() override { matrix_detail::select_gemm_isa(previous_); }
+
+ private:
+  matrix_detail::GemmIsa previous_ = matrix_detail::GemmIsa::Portable;
+};
+
+TEST_P(MatrixGemm, SquareProducts) {
+  check_product<32, 32, 32, double>(1);
+  check_product<64, 64, 64, float>(2);
+  check_product<256, 256, 256, double>(3);
+  check_product<256, 256, 256, float>(4);
+}
+
+// Edges that do not fill a register tile or a cache block.
+TEST_P(MatrixGemm, RaggedProducts) {
+  check_product<17, 33, 9, double>(1);
+  check_product<1, 300, 31, double>(2);
+  check_product<301, 7, 3, float>(3);
+  check_product<97, 129, 65, double>(4);
+  check_product<67, 517, 35, float>(5);
+}
+
+// Strided operands accumulate into a window of a larger C.
+TEST_P(MatrixGemm, AccumulatesWithStrides) {
+  constexpr std::size_t kN = 23;
+  constexpr std::size_t kM = 41;
+  constexpr std::size_t kK = 19;
+  constexpr std::size_t kStride = 50;
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<double> value(-1, 1);
+  std::vector<double> a(kN * kStride);
+  std::vector<double> b(kM * kStride);
+  std::vector<double> c(kN * kStride);
+  for (auto* v : {&a, &b, &c}) {
+    std::generate(v->begin(), v->end(), [&] { return value(gen); });
+  }
+  std::vector<double> expected = c;
+  for (std::size_t i = 0; i < kN; ++i) {
+    for (std::size_t j = 0; j < kK; ++j) {
+      for (std::size_t p = 0; p < kM; ++p) {
+        expected[i * kStride + j] += a[i * kStride + p] * b[p * kStride + j];
+      }
+    }
+  }
+  matrix_detail::gemm(kN, kM, kK, a.data(), kStride, b.data(), kStride, c.data(), kStride);
+  for (std::size_t i = 0; i < c.size(); ++i) {
+    EXPECT_NEAR(c[i], expected[i], 1e-12) << i;
+  }
+}
+
+std::string isa_name(const testing::TestParamInfo<matrix_detail::GemmIsa>& info) {
+  constexpr const char* kNames[] = {"Portable", "Avx2", "Avx512"};
+  return kNames[static_cast<int>(info.param)];
+}
+
+INSTANTIATE_TEST_SUITE_P(Isa, MatrixGemm,
+                         testing::Values(matrix_detail::GemmIsa::Portable,
+                                         matrix_detail::GemmIsa::Avx2,
+                                         matrix_detail::GemmIsa::Avx512),
+                         isa_name);
+
+using Gf = Residue<998244353>;
+
+template <typename T>
+concept Divisible = requires(T a) { a / a; };
+
+static_assert(sizeof(Residue<998244353>) == 4);
+static_assert(Residue<7>::kIsField && Residue<2>::kIsField && Residue<2147483647>::kIsField);
+static_assert(!Residue<561>::kIsField && !Residue<1000>::kIsField);
+static_assert(Divisible<Residue<7>> && !Divisible<Residue<561>>);
+static_assert((Residue<7>(3) * Residue<7>(5)).value() == 1);
+static_assert(Residue<7>(3).inverse() == Residue<7>(5));
+static_assert(Residue<7>(-1).value() == 6);
+
+// Every operation against 64-bit arithmetic with %.
+template <std::uint32_t P>
+void check_arithmetic(unsigned seed) {
+  std::mt19937_64 gen(seed);
+  std::uniform_int_distribution<std::int64_t> value(-(std::int64_t{1} << 40),
+                                                    std::int64_t{1} << 40);
+  const auto reference = [](std::int64_t x) {
+    return static_cast<std::uint32_t>((x % P + P) % P);
+  };
+  for (int i = 0; i < 1000; ++i) {
+    const std::int64_t x = value(gen);
+    const std::int64_t y = value(gen);
+    const Residue<P> a(x);
+    const Residue<P> b(y);
+    const std::int64_t rx = reference(x);
+    const std::int64_t ry = reference(y);
+    ASSERT_EQ(a.value(), rx) << x;
+    ASSERT_EQ((a + b).value(), reference(rx + ry)) << x << " " << y;
+    ASSERT_EQ((a - b).value(), reference(rx - ry)) << x << " " << y;
+    ASSERT_EQ((a * b).value(), reference(rx * ry)) << x << " " << y;
+    ASSERT_EQ((-a).value(), reference(-rx)) << x;
+  }
+}
+
+TEST(Residue, ArithmeticMatchesRemainders) {
+  check_arithmetic<2>(1);
+  check_arithmetic<7>(2);
+  check_arithmetic<1000>(3);
+  check_arithmetic<998244353>(4);
+  check_arithmetic<2147483647>(5);
+  check_arithmetic<2147483646>(6);
+}
+
+TEST(Residue, UnsignedValuesReduce) {
+  EXPECT_EQ(Residue<7>(std::uint64_t{0} - 1).value(), (std::uint64_t{0} - 1) % 7);
+  EXPECT_EQ(Residue<1000>(123456789u).value(), 789u);
+  EXPECT_EQ(static_cast<std::uint32_t>(Gf(998244354)), 1u);
+}
+
+template <std::uint32_t P>
+void check_inverses(unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<std::uint32_t> value(1, P - 1);
+  std::vector<std::uint32_t> values = {1, 2, P - 1, P / 2};
+  for (int i = 0; i < 1000; ++i) {
+    values.push_back(value(gen));
+  }
+  for (std::uint32_t x : values) {
+    const Residue<P> a(x);
+    ASSERT_EQ(a * a.inverse(), Residue<P>(1)) << x;
+    ASSERT_EQ(a / a, Residue<P>(1)) << x;
+  }
+}
+
+TEST(Residue, InverseOfEveryElement) {
+  for (std::uint32_t x = 1; x < 7; ++x) {
+    EXPECT_EQ(Residue<7>(x) * Residue<7>(x).inverse(), Residue<7>(1)) << x;
+  }
+  EXPECT_EQ(Residue<2>(1).inverse(), Residue<2>(1));
+  check_inverses<998244353>(1);
+  check_inverses<2147483647>(2);
+  check_inverses<65537>(3);
+}
+
+TEST(Residue, DivisionByZeroThrows) {
+  EXPECT_THROW(Gf(0).inverse(), std::domain_error);
+  EXPECT_THROW(Gf(5) / Gf(998244353), std::domain_error);
+}
+
+TEST(Residue, PowFollowsFermat) {
+  for (std::uint32_t x : {1u, 2u, 3u, 12345u, 998244352u}) {
+    EXPECT_EQ(Gf(x).pow(998244352), Gf(1)) << x;
+  }
+  EXPECT_EQ(Gf(3).pow(0), Gf(1));
+  EXPECT_EQ(Gf(3).pow(5), Gf(243));
+}
+
+template <std::size_t N>
+Matrix<N, N, Gf> random_gf_matrix(unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<std::uint32_t> value(0, 998244352);
+  Matrix<N, N, Gf> result;
+  std::generate_n(result.data(), result.size(), [&] { return Gf(value(gen)); });
+  return result;
+}
+
+constexpr Matrix<3, 3, Residue<7>> kTridiagonal{{2, -1, 0}, {-1, 2, -1}, {0, -1, 2}};
+static_assert(kTridiagonal.det() == Residue<7>(4));
+static_assert(kTridiagonal.rank() == 3);
+static_assert(kTridiagonal * kTridiagonal.inverted() == Matrix<3, 3, Residue<7>>::identity());
+
+TEST(Matrix, DeterminantOverAFiniteField) {
+  const auto a = random_gf_matrix<12>(1);
+  const auto b = random_gf_matrix<12>(2);
+  const Matrix<12, 12, Gf> product = a * b;
+  EXPECT_EQ(product.det(), a.det() * b.det());
+
+  Matrix<12, 12, Gf> swapped = a;
+  std::swap_ranges(swapped[0], swapped[0] + 12, swapped[5]);
+  EXPECT_EQ(swapped.det(), -a.det());
+
+  Matrix<12, 12, Gf> triangular = a;
+  Gf diagonal(1);
+  for (std::size_t i = 0; i < 12; ++i) {
+    for (std::size_t j = 0; j < i; ++j) {
+      triangular(i, j) = Gf(0);
+    }
+    diagonal *= triangular(i, i);
+  }
+  EXPECT_EQ(triangular.det(), diagonal);
+}
+
+TEST(Matrix, InverseOverAFiniteField) {
+  const auto a = random_gf_matrix<20>(3);
+  ASSERT_NE(a.det(), Gf(0));
+  const Matrix<20, 20, Gf> inverse = a.inverted();
+  EXPECT_TRUE((Matrix<20, 20, Gf>(a * inverse) == Matrix<20, 20, Gf>::identity()));
+  EXPECT_TRUE((Matrix<20, 20, Gf>(inverse * a) == Matrix<20, 20, Gf>::identity()));
+
+  Matrix<20, 20, Gf> b = a;
+  b.invert();
+  EXPECT_TRUE(b == inverse);
+}
+
+TEST(Matrix, SingularMatricesHaveNoInverse) {
+  auto a = random_gf_matrix<8>(4);
+  for (std::size_t j = 0; j < 8; ++j) {
+    a(7, j) = a(0, j) * Gf(3) + a(1, j);
+  }
+  EXPECT_EQ(a.det(), Gf(0));
+  EXPECT_EQ(a.rank(), 7u);
+  EXPECT_THROW(a.inverted(), std::domain_error);
+
+  const Matrix<2, 2> doubles{{1, 2}, {2, 4}};
+  EXPECT_EQ(doubles.det(), 0);
+  EXPECT_EQ(doubles.rank(), 1u);
+  EXPECT_THROW(doubles.inverted(), std::domain_error);
+}
+
+TEST(Matrix, RankOfRectangularMatrices) {
+  const Matrix<3, 4> m{{1, 2, 3, 4}, {2, 4, 6, 8}, {0, 1, 1, 1}};
+  EXPECT_EQ(m.rank(), 2u);
+  EXPECT_EQ(m.transposed().rank(), 2u);
+  EXPECT_EQ((Matrix<3, 5, Gf>().rank()), 0u);
+  EXPECT_EQ((Matrix<2, 5, Gf>{{0, 0, 1, 0, 0}, {0, 0, 0, 0, 1}}.rank()), 2u);
+}
+
+TEST(Matrix, SmallFloatingPointDeterminantAndInverse) {
+  const Matrix<3, 3> a{{2, -1, 0}, {-1, 2, -1}, {0, -1, 2}};
+  EXPECT_NEAR(a.det(), 4, 1e-12);
+  const Matrix<3, 3> product = a * a.inverted();
+  for (std::size_t i = 0; i < 3; ++i) {
+    for (std::size_t j = 0; j < 3; ++j) {
+      EXPECT_NEAR(product(i, j), i == j ? 1 : 0, 1e-12);
+    }
+  }
+  // The largest pivot is taken, so a tiny leading element does not lose
+  // the other digits.
+  const Matrix<2, 2> tiny{{1e-20, 1}, {1, 1}};
+  EXPECT_NEAR(tiny.det(), -1, 1e-12);
+  EXPECT_NEAR(tiny.inverted()(0, 0), -1, 1e-12);
+}
+
+// Singularity is judged relative to the scale of A, so a well-conditioned
+// matrix inverts however small or large its elements are.
+template <std::size_t N>
+void check_scaled_inverse(const Matrix<N, N>& a) {
+  for (double scale : {1e-20, 1e-150, 1e20, 1e150}) {
+    const Matrix<N, N> scaled = a * scale;
+    EXPECT_EQ(scaled.rank(), N) << scale;
+    const Matrix<N, N> inverse = scaled.inverted();
+    const Matrix<N, N> product = scaled * inverse;
+    for (std::size_t i = 0; i < N; ++i) {
+      for (std::size_t j = 0; j < N; ++j) {
+        EXPECT_NEAR(product(i, j), i == j ? 1 : 0, 1e-10) << scale;
+      }
+    }
+  }
+}
+
+TEST(Matrix, InvertsTinyAndHugeMatrices) {
+  static_assert(3 < matrix_detail::kLuLimit && 40 < matrix_detail::kLuLimit);
+  const Matrix<2, 2> identity_scaled = Matrix<2, 2>::identity() * 1e-20;
+  EXPECT_NEAR(identity_scaled.det(), 1e-40, 1e-52);
+  EXPECT_EQ(identity_scaled.inverted()(0, 0), 1e20);
+  check_scaled_inverse(Matrix<3, 3>{{2, -1, 0}, {-1, 2, -1}, {0, -1, 2}});
+  // Diagonally dominant, so well-conditioned.
+  Matrix<40, 40> dominant = random_matrix<40, 40, double>(1);
+  for (std::size_t i = 0; i < 40; ++i) {
+    dominant(i, i) += 40;
+  }
+  check_scaled_inverse(dominant);
+}
+
+// Largest element of |a - b|.
+template <std::size_t N, std::size_t M, typename Field>
+double max_difference(const Matrix<N, M, Field>& a, const Matrix<N, M, Field>& b) {
+  double error = 0;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    error = std::max(error, std::abs(static_cast<double>(a.data()[i] - b.data()[i])));
+  }
+  return error;
+}
+
+// Largest element of |a x - b|.
+template <std::size_t N, std::size_t K, typename Field>
+double residual(const Matrix<N, N, Field>& a, const Matrix<N, K, Field>& x,
+                const Matrix<N, K, Field>& b) {
+  return max_difference(Matrix<N, K, Field>(a * x), b);
+}
+
+// P L U rebuilt from the factors, which should give back A.
+template <std::size_t N, typename Field>
+Matrix<N, N, Field> rebuilt(const LuDecomposition<N, Field>& lu) {
+  Matrix<N, N, Field> l = Matrix<N, N, Field>::identity();
+  Matrix<N, N, Field> u;
+  for (std::size_t i = 0; i < N; ++i) {
+    for (std::size_t j = 0; j < N; ++j) {
+      (j < i ? l : u)(i, j) = lu.factors()(i, j);
+    }
+  }
+  Matrix<N, N, Field> product = l * u;
+  for (std::size_t i = N; i-- > 0;) {
+    std::swap_ranges(product[i], product[i] + N, product[lu.pivots()[i]]);
+  }
+  return product;
+}
+
+// A = L U for a random unit lower L and an upper U with a diagonal in
+// [1, 2), so the determinant is known.
+template <std::size_t N, typename Field>
+std::pair<Matrix<N, N, Field>, double> with_known_det(unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> value(-0.1, 0.1);
+  std::uniform_real_distribution<double> diagonal(1, 2);
+  Matrix<N, N, Field> l;
+  Matrix<N, N, Field> u;
+  double det = 1;
+  for (std::size_t i = 0; i < N; ++i) {
+    for (std::size_t j = 0; j < N; ++j) {
+      if (j < i) {
+        l(i, j) = static_cast<Field>(value(gen));
+      } else if (j > i) {
+        u(i, j) = static_cast<Field>(value(gen));
+      }
+    }
+    l(i, i) = 1;
+    u(i, i) = static_cast<Field>(diagonal(gen));
+    det *= static_cast<double>(u(i, i));
+  }
+  return {Matrix<N, N, Field>(l * u), det};
+}
+
+template <std::size_t N, typename Field>
+void check_lu(unsigned seed, double tolerance) {
+  const auto a = random_matrix<N, N, Field>(seed);
+  const LuDecomposition<N, Field> lu(a);
+  ASSERT_FALSE(lu.singular());
+  EXPECT_LE(max_difference(rebuilt(lu), a), tolerance) << N;
+
+  const auto b = random_matrix<N, 1, Field>(seed + 1);
+  EXPECT_LE(residual(a, lu.solve(b), b), tolerance) << N;
+  const auto many = random_matrix<N, 7, Field>(seed + 2);
+  EXPECT_LE(residual(a, a.solve(many), many), tolerance) << N;
+
+  const Matrix<N, N, Field> inverse = a.inverted();
+  EXPECT_LE(residual(a, inverse, Matrix<N, N, Field>::identity()), tolerance) << N;
+  EXPECT_EQ(a.rank(), N);
+}
+
+// Sizes from the blocked limit on, around the leaf width and the grain.
+TEST(LuDecomposition, BlockedFactorsAndSolves) {
+  check_lu<96, double>(1, 1e-10);
+  check_lu<127, double>(2, 1e-10);
+  check_lu<200, double>(3, 1e-9);
+  check_lu<301, double>(4, 1e-9);
+  check_lu<150, float>(5, 1e-2);
+}
+
+TEST(LuDecomposition, UnblockedFactorsAndSolves) {
+  check_lu<5, double>(1, 1e-12);
+  check_lu<40, double>(2, 1e-11);
+  check_lu<95, double>(3, 1e-10);
+}
+
+TEST(LuDecomposition, DeterminantOfAKnownProduct) {
+  const auto [small, small_det] = with_known_det<50, double>(1);
+  EXPECT_NEAR(small.det() / small_det, 1, 1e-10);
+  const auto [large, large_det] = with_known_det<250, double>(2);
+  EXPECT_NEAR(large.det() / large_det, 1, 1e-9);
+  EXPECT_NEAR(LuDecomposition<250>(large).det() / large_det, 1, 1e-9);
+
+  // A row swap negates it.
+  Matrix<250, 250> swapped = large;
+  std::swap_ranges(swapped[3], swapped[3] + 250, swapped[200]);
+  EXPECT_NEAR(swapped.det() / large_det, -1, 1e-9);
+}
+
+TEST(LuDecomposition, SingularMatrices) {
+  auto a = random_matrix<128, 128, double>(1);
+  std::copy(a[5], a[5] + 128, a[90]);
+  const LuDecomposition<128> lu(a);
+  EXPECT_TRUE(lu.singular());
+  EXPECT_EQ(lu.det(), 0);
+  EXPECT_EQ(a.det(), 0);
+  EXPECT_EQ(a.rank(), 127u);
+  EXPECT_THROW(lu.solve(Matrix<128, 1>()), std::domain_error);
+  EXPECT_THROW(lu.inverse(), std::domain_error);
+  EXPECT_THROW(a.inverted(), std::domain_error);
+
+  EXPECT_TRUE((LuDecomposition<100>(Matrix<100, 100>()).singular()));
+}
+
+TEST(LuDecomposition, ExactOverAFiniteField) {
+  const auto a = random_gf_matrix<30>(1);
+  const LuDecomposition<30, Gf> lu(a);
+  ASSERT_FALSE(lu.singular());
+  EXPECT_TRUE(rebuilt(lu) == a);
+  EXPECT_EQ(lu.det(), a.det());
+
+  Matrix<30, 3, Gf> b;
+  std::generate_n(b.data(), b.size(), [n = 1]() mutable { return Gf(n++); });
+  const Matrix<30, 3, Gf> x = a.solve(b);
+  EXPECT_TRUE((Matrix<30, 3, Gf>(a * x) == b));
+}
+
+static_assert(kTridiagonal.solve(Matrix<3, 1, Residue<7>>{{1}, {0}, {1}}) ==
+              Matrix<3, 1, Residue<7>>{{1}, {1}, {1}});
+
+// Factorizations started from pool tasks share the pool with their own
+// updates.
+TEST(LuDecomposition, FactorsFromPoolTasks) {
+  constexpr std::size_t kCount = 8;
+  std::vector<double> errors(kCount);
+  ThreadPool::shared().parallel_for(
+      0, kCount,
+      [&](std::size_t i) {
+        const auto a = random_matrix<160, 160, double>(static_cast<unsigned>(i));
+        const auto b = random_matrix<160, 2, double>(static_cast<unsigned>(i + 100));
+        errors[i] = residual(a, a.solve(b), b);
+      },
+      1);
+  for (std::size_t i = 0; i < kCount; ++i) {
+    EXPECT_LE(errors[i], 1e-9) << i;
+  }
+}
+
+// Small integers in any field, so that sums of products are exact in
+// whatever order the kernels add them.
+template <std::size_t N, std::size_t M, typename Field>
+Matrix<N, M, Field> integral_matrix(unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> value(-9, 9);
+  Matrix<N, M, Field> result;
+  std::generate_n(result.data(), result.size(), [&] { return static_cast<Field>(value(gen)); });
+  return result;
+}
+
+// f of each pair of elements, computed without expressions.
+template <std::size_t N, std::size_t M, typename Field, typename F>
+Matrix<N, M, Field> combined(const Matrix<N, M, Field>& x, const Matrix<N, M, Field>& y, F f) {
+  Matrix<N, M, Field> result;
+  for (std::size_t i = 0; i < result.size(); ++i) {
+    result.data()[i] = f(x.data()[i], y.data()[i]);
+  }
+  return result;
+}
+
+template <typename Field>
+Field plus(const Field& x, const Field& y) {
+  return x + y;
+}
+
+template <typename Field>
+Field minus(const Field& x, const Field& y) {
+  return x - y;
+}
+
+// Sums of products against the products one at a time, on a destination
+// that starts dirty and on one that is constructed.
+template <std::size_t N, std::size_t M, std::size_t K, typename Field>
+void check_fused(unsigned seed) {
+  using Result = Matrix<N, K, Field>;
+  const auto a = integral_matrix<N, M, Field>(seed);
+  const auto b = integral_matrix<M, K, Field>(seed + 1);
+  const auto c = integral_matrix<N, M, Field>(seed + 2);
+  const auto d = integral_matrix<M, K, Field>(seed + 3);
+  const auto e = integral_matrix<N, K, Field>(seed + 4);
+  const Result ab = a * b;
+  const Result cd = c * d;
+  const Result sum = combined(ab, cd, plus<Field>);
+  Result r = integral_matrix<N, K, Field>(seed + 5);
+  r = a * b + c * d;
+  EXPECT_TRUE(r == sum) << N << "x" << M << "x" << K;
+  EXPECT_TRUE(Result(a * b + c * d) == sum) << N << "x" << M << "x" << K;
+  r = a * b - c * d;
+  EXPECT_TRUE(r == combined(ab, cd, minus<Field>));
+  r = a * b + e;
+  EXPECT_TRUE(r == combined(ab, e, plus<Field>));
+  r = e + a * b;
+  EXPECT_TRUE(r == combined(e, ab, plus<Field>));
+  EXPECT_TRUE(Result(e + a * b) == combined(e, ab, plus<Field>));
+  r = e - a * b;
+  EXPECT_TRUE(r == combined(e, ab, minus<Field>));
+  r = -(a * b) + e;
+  EXPECT_TRUE(r == combined(e, ab, minus<Field>));
+  r = a * b * Field(2) - e;
+  EXPECT_TRUE(r == combined(combined(ab, ab, plus<Field>), e, minus<Field>));
+
+  const Matrix<N, M, Field> left = combined(a, c, plus<Field>);
+  const Matrix<M, K, Field> right = combined(b, d, minus<Field>);
+  r = (a + c) * (b - d);
+  EXPECT_TRUE(r == Result(left * right));
+
+  r = e;
+  r += a * b;
+  r -= c * d;
+  EXPECT_TRUE(r == combined(combined(e, ab, plus<Field>), cd, minus<Field>));
+  r = e;
+  r += a * b + c * d;
+  r -= Field(2) * cd;
+  EXPECT_TRUE(r == combined(combined(e, ab, plus<Field>), cd, minus<Field>));
+}
+
+// Products that read the matrix they are assigned to.
+template <std::size_t N, typename Field>
+void check_aliasing(unsigned seed) {
+  using Square = Matrix<N, N, Field>;
+  const auto start = integral_matrix<N, N, Field>(seed);
+  const auto b = integral_matrix<N, N, Field>(seed + 1);
+  const Square ab = start * b;
+  const Square ba = b * start;
+  Square a = start;
+  a = a * b;
+  EXPECT_TRUE(a == ab) << N;
+  a = start;
+  a = b * a;
+  EXPECT_TRUE(a == ba) << N;
+  a = start;
+  a = a * a;
+  EXPECT_TRUE(a == Square(start * start)) << N;
+  a = start;
+  a = a * b + a;
+  EXPECT_TRUE(a == combined(ab, start, plus<Field>)) << N;
+  a = start;
+  a += a * b;
+  EXPECT_TRUE(a == combined(start, ab, plus<Field>)) << N;
+  a = start;
+  a -= b * a;
+  EXPECT_TRUE(a == combined(start, ba, minus<Field>)) << N;
+  a = start;
+  a = b - a;
+  EXPECT_TRUE(a == combined(b, start, minus<Field>)) << N;
+
+  auto wide = integral_matrix<N, 3, Field>(seed + 2);
+  const auto wide_start = wide;
+  const auto turn = integral_matrix<3, 3, Field>(seed + 3);
+  wide = wide * turn;
+  EXPECT_TRUE(wide == (Matrix<N, 3, Field>(wide_start * turn))) << N;
+}
+
+constexpr Matrix<2, 2, int> kFused = Matrix<2, 2, int>{{1, 2}, {3, 4}} *
+                                         Matrix<2, 2, int>{{5, 6}, {7, 8}} +
+                                     Matrix<2, 2, int>::identity() * 10;
+static_assert(kFused(0, 0) == 29 && kFused(0, 1) == 22);
+static_assert(kFused(1, 0) == 43 && kFused(1, 1) == 60);
+
+TEST(MatrixExpression, IsEvaluatedWhenAssigned) {
+  Matrix<2, 2, int> a{{1, 2}, {3, 4}};
+  const Matrix<2, 2, int> b{{5, 6}, {7, 8}};
+  const auto sum = a + b;
+  static_assert(!matrix_detail::IsMatrix<std::remove_cvref_t<decltype(sum)>>::value);
+  a(0, 0) = 10;
+  EXPECT_TRUE((Matrix<2, 2, int>(sum) == Matrix<2, 2, int>{{15, 8}, {10, 12}}));
+}
+
+// Temporaries, here on the heap, live as long as the expression.
+TEST(MatrixExpression, OwnsItsTemporaries) {
+  const auto expected = combined(random_matrix<64, 64, double>(1),
+                                 random_matrix<64, 64, double>(2), plus<double>);
+  const auto sum = random_matrix<64, 64, double>(1) + random_matrix<64, 64, double>(2);
+  EXPECT_TRUE((Matrix<64, 64, double>(sum) == expected));
+
+  const auto square = random_matrix<64, 64, double>(3);
+  const auto product = random_matrix<64, 64, double>(3) * square;
+  EXPECT_TRUE((Matrix<64, 64, double>(product) == Matrix<64, 64, double>(square * square)));
+}
+
+TEST(MatrixExpression, EvalGivesAMatrix) {
+  const Matrix<2, 3, int> a{{1, 2, 3}, {4, 5, 6}};
+  const Matrix<3, 2, int> b{{1, 0}, {0, 1}, {1, 1}};
+  static_assert(std::is_same_v<decltype((a * b).eval()), Matrix<2, 2, int>>);
+  EXPECT_EQ((a * b).eval().trace(), 15);
+  EXPECT_TRUE(((a * b).eval().transposed() == Matrix<2, 2, int>{{4, 10}, {5, 11}}));
+  EXPECT_EQ((a + a).eval()(1, 2), 12);
+  EXPECT_EQ((-(a * b)).eval().trace(), -15);
+}
+
+// Sizes on both sides of every product strategy, as above.
+TEST(MatrixExpression, SumsOfProductsAreFused) {
+  check_fused<2, 3, 4, int>(1);
+  check_fused<2, 3, 4, double>(2);
+  check_fused<8, 9, 10, double>(3);
+  check_fused<8, 9, 10, long long>(4);
+  check_fused<20, 30, 17, double>(5);
+  check_fused<20, 30, 17, float>(6);
+  check_fused<20, 30, 17, int>(7);
+  check_fused<8, 8, 8, Gf>(8);
+}
+
+TEST(MatrixExpression, ProductsIntoAnOperandAreEvaluatedAside) {
+  check_aliasing<3, int>(1);
+  check_aliasing<3, double>(2);
+  check_aliasing<8, double>(3);
+  check_aliasing<24, double>(4);
+  check_aliasing<24, float>(5);
+  check_aliasing<24, long long>(6);
+  check_aliasing<24, Gf>(7);
+}
+
+}  // namespace
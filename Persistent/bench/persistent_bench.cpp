@@ -0,0 +1,122 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "Persistent/persistentmap.h"
+#include "Persistent/persistentvector.h"
+#include "UnorderedMap/unorderedmap.h"
+
+namespace {
+
+// A state of this many entries changes in one place per tick and every
+// tick's state stays readable: the copy-per-snapshot the persistent types
+// replace against one set() each.
+constexpr std::size_t kEntries = std::size_t{1} << 16;
+
+void BM_VectorSnapshotCopy(benchmark::State& state) {
+  std::vector<std::uint64_t> current(kEntries);
+  std::mt19937_64 random(1);
+  for (auto _ : state) {
+    std::vector<std::uint64_t> next = current;
+    next[random() % kEntries] = random();
+    current = std::move(next);
+    benchmark::DoNotOptimize(current.data());
+  }
+}
+BENCHMARK(BM_VectorSnapshotCopy);
+
+void BM_VectorSnapshotPersistent(benchmark::State& state) {
+  PersistentVector<std::uint64_t> current;
+  for (std::size_t i = 0; i < kEntries; ++i) {
+    current = std::move(current).push_back(0);
+  }
+  std::mt19937_64 random(1);
+  for (auto _ : state) {
+    PersistentVector<std::uint64_t> next = current.set(random() % kEntries, random());
+    current = std::move(next);
+    benchmark::DoNotOptimize(current.size());
+  }
+}
+BENCHMARK(BM_VectorSnapshotPersistent);
+
+void BM_MapSnapshotCopy(benchmark::State& state) {
+  UnorderedMap<std::uint64_t, std::uint64_t> current;
+  for (std::uint64_t i = 0; i < kEntries; ++i) {
+    current[i] = 0;
+  }
+  std::mt19937_64 random(2);
+  for (auto _ : state) {
+    UnorderedMap<std::uint64_t, std::uint64_t> next = current;
+    next[random() % kEntries] = random();
+    current = std::move(next);
+    benchmark::DoNotOptimize(current.size());
+  }
+}
+BENCHMARK(BM_MapSnapshotCopy);
+
+void BM_MapSnapshotPersistent(benchmark::State& state) {
+  PersistentMap<std::uint64_t, std::uint64_t> current;
+  for (std::uint64_t i = 0; i < kEntries; ++i) {
+    current = std::move(current).set(i, 0);
+  }
+  std::mt19937_64 random(2);
+  for (auto _ : state) {
+    PersistentMap<std::uint64_t, std::uint64_t> next = current.set(random() % kEntries, random());
+    current = std::move(next);
+    benchmark::DoNotOptimize(current.size());
+  }
+}
+BENCHMARK(BM_MapSnapshotPersistent);
+
+// Building without snapshots: the rvalue overloads update unshared nodes in
+// place, so this is the cost of the trie over a growing array.
+void BM_VectorPushBack(benchmark::State& state) {
+  for (auto _ : state) {
+    std::vector<std::uint64_t> values;
+    for (std::size_t i = 0; i < kEntries; ++i) {
+      values.push_back(i);
+    }
+    benchmark::DoNotOptimize(values.data());
+  }
+}
+BENCHMARK(BM_VectorPushBack);
+
+void BM_PersistentVectorPushBack(benchmark::State& state) {
+  for (auto _ : state) {
+    PersistentVector<std::uint64_t> values;
+    for (std::size_t i = 0; i < kEntries; ++i) {
+      values = std::move(values).push_back(i);
+    }
+    benchmark::DoNotOptimize(values.size());
+  }
+}
+BENCHMARK(BM_PersistentVectorPushBack);
+
+void BM_MapInsert(benchmark::State& state) {
+  for (auto _ : state) {
+    UnorderedMap<std::uint64_t, std::uint64_t> values;
+    for (std::uint64_t i = 0; i < kEntries; ++i) {
+      values[i] = i;
+    }
+    benchmark::DoNotOptimize(values.size());
+  }
+}
+BENCHMARK(BM_MapInsert);
+
+void BM_PersistentMapInsert(benchmark::State& state) {
+  for (auto _ : state) {
+    PersistentMap<std::uint64_t, std::uint64_t> values;
+    for (std::uint64_t i = 0; i < kEntries; ++i) {
+      values = std::move(values).set(i, i);
+    }
+    benchmark::DoNotOptimize(values.size());
+  }
+}
+BENCHMARK(BM_PersistentMapInsert);
+
+}  // namespace
+
+BENCHMARK_MAIN();
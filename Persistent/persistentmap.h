@@ -0,0 +1,597 @@
+#pragma once
+
+// Immutable hash map whose updates return new versions sharing structure.
+//
+// A hash array mapped trie in the compressed layout of Steindorfer and
+// Vinju (CHAMP): each node spends five bits of the mixed hash to pick one
+// of 32 positions and keeps two bitmaps, one of positions holding an entry
+// inline and one of positions holding a subtree, followed by the two packed
+// arrays, all in one allocation. A lookup is a popcount per level and at
+// most log32(n) levels for a good hash. Keys whose hashes agree in all 64
+// bits end up together in a collision node, searched linearly. Removal
+// pulls a lone remaining entry back into its parent, so the trie for a set
+// of keys does not depend on the order of the updates.
+//
+// set() and erase() copy the nodes on the path to the key, O(log32 n), and
+// share the rest with the old version. Nodes are counted through
+// IntrusivePtr with atomic counts, so a version can be read on other
+// threads while the owner makes new ones. As with PersistentVector, the
+// rvalue overloads, std::move(map).set(k, v), update in place the nodes
+// that no other version shares.
+//
+// Hashing and equality default to those of UnorderedMap.
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include "Persistent/persistentvector.h"
+#include "SmartPointers/intrusiveptr.h"
+#include "SmartPointers/smartpointers.h"
+#include "UnorderedMap/unorderedmap.h"
+
+namespace persistent_detail {
+
+inline constexpr unsigned kHashBits = std::numeric_limits<std::size_t>::digits;
+// Levels a hash can pick positions on; below them are collision nodes.
+inline constexpr unsigned kMapLevels = (kHashBits + kBits - 1) / kBits;
+
+// A trie node: the header, child_count subtree pointers, then entry_count
+// entries. Collision nodes have no children and empty bitmaps; a node is
+// one by its depth.
+template <typename Entry>
+class MapNode {
+ public:
+  using Ptr = IntrusivePtr<MapNode>;
+
+  MapNode(const MapNode&) = delete;
+  MapNode& operator=(const MapNode&) = delete;
+
+  // A node for the given numbers of entries and children, filled by
+  // fill(node) through add_entry() and children(), in order.
+  template <typename Fill>
+  static Ptr make(std::uint32_t entry_map, std::uint32_t child_map, std::uint32_t entries,
+                  std::uint32_t children, Fill fill) {
+    void* memory = ::operator new(entries_offset(children) + entries * sizeof(Entry),
+                                  std::align_val_t(kAlignment));
+    // From here on the node frees itself, with the entries built so far,
+    // if fill throws.
+    Ptr node(new (memory) MapNode(entry_map, child_map, children));
+    fill(*node);
+    return node;
+  }
+
+  std::uint32_t entry_map() const noexcept { return entry_map_; }
+  std::uint32_t child_map() const noexcept { return child_map_; }
+  std::uint32_t entry_count() const noexcept { return entry_count_; }
+  std::uint32_t child_count() const noexcept { return child_count_; }
+  bool owned() const noexcept { return refs_.unique(); }
+
+  Ptr* children() noexcept {
+    return reinterpret_cast<Ptr*>(reinterpret_cast<std::byte*>(this) + sizeof(MapNode));
+  }
+  const Ptr* children() const noexcept { return const_cast<MapNode*>(this)->children(); }
+  Entry* entries() noexcept {
+    return reinterpret_cast<Entry*>(reinterpret_cast<std::byte*>(this) +
+                                    entries_offset(child_count_));
+  }
+  const Entry* entries() const noexcept { return const_cast<MapNode*>(this)->entries(); }
+
+  template <typename... Args>
+  void add_entry(Args&&... args) {
+    std::construct_at(entries() + entry_count_, std::forward<Args>(args)...);
+    ++entry_count_;
+  }
+
+  friend void intrusivePtrAddRef(const MapNode* node) noexcept { node->refs_.increment(); }
+  friend void intrusivePtrRelease(const MapNode* node) noexcept {
+    if (node->refs_.decrement() == 0) {
+      auto* doomed = const_cast<MapNode*>(node);
+      doomed->~MapNode();
+      ::operator delete(doomed, std::align_val_t(kAlignment));
+    }
+  }
+
+ private:
+  static constexpr std::size_t kAlignment = std::max(alignof(Ptr), alignof(Entry));
+
+  static constexpr std::size_t entries_offset(std::uint32_t children) noexcept {
+    const std::size_t end = sizeof(MapNode) + children * sizeof(Ptr);
+    return (end + alignof(Entry) - 1) / alignof(Entry) * alignof(Entry);
+  }
+
+  MapNode(std::uint32_t entry_map, std::uint32_t child_map, std::uint32_t children) noexcept
+      : entry_map_(entry_map), child_map_(child_map), child_count_(children) {
+    std::uninitialized_value_construct_n(this->children(), children);
+  }
+  ~MapNode() {
+    std::destroy_n(entries(), entry_count_);
+    std::destroy_n(children(), child_count_);
+  }
+
+  mutable AtomicCount::Counter refs_{0};
+  std::uint32_t entry_map_;
+  std::uint32_t child_map_;
+  std::uint32_t entry_count_ = 0;  // built so far
+  std::uint32_t child_count_;
+};
+
+}  // namespace persistent_detail
+
+template <typename K, typename V, typename Hash = unorderedmap_detail::DefaultHash<K>,
+          typename KeyEqual = unorderedmap_detail::DefaultEqual<K>>
+class PersistentMap {
+  using Entry = std::pair<K, V>;
+  using Node = persistent_detail::MapNode<Entry>;
+  using NodePtr = typename Node::Ptr;
+
+  static constexpr unsigned kBits = persistent_detail::kBits;
+  static constexpr unsigned kHashBits = persistent_detail::kHashBits;
+  static constexpr unsigned kLevels = persistent_detail::kMapLevels;
+
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<K, V>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using reference = const value_type&;
+  using const_reference = const value_type&;
+
+  // Visits a node's entries, then its subtrees depth first.
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::pair<K, V>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    const_iterator() = default;
+
+    const value_type& operator*() const { return nodes_[depth_]->entries()[entry_]; }
+    const value_type* operator->() const { return &**this; }
+
+    const_iterator& operator++() {
+      ++entry_;
+      settle();
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator old = *this;
+      ++*this;
+      return old;
+    }
+
+    friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) {
+      if (lhs.depth_ < 0 || rhs.depth_ < 0) {
+        return lhs.depth_ < 0 && rhs.depth_ < 0;
+      }
+      return &*lhs == &*rhs;
+    }
+
+   private:
+    friend class PersistentMap;
+
+    explicit const_iterator(const Node* root) {
+      if (root != nullptr) {
+        depth_ = 0;
+        nodes_[0] = root;
+        settle();
+      }
+    }
+
+    // Moves on from entry_ of the innermost node to the next entry there
+    // is, if entry_ is past that node's entries.
+    void settle() {
+      while (depth_ >= 0) {
+        const Node* node = nodes_[depth_];
+        if (entry_ < node->entry_count()) {
+          return;
+        }
+        if (next_child_[depth_] < node->child_count()) {
+          nodes_[depth_ + 1] = node->children()[next_child_[depth_]++].get();
+          ++depth_;
+          next_child_[depth_] = 0;
+          entry_ = 0;
+        } else if (--depth_ >= 0) {
+          entry_ = nodes_[depth_]->entry_count();
+        }
+      }
+    }
+
+    const Node* nodes_[kLevels + 1] = {};
+    std::uint32_t next_child_[kLevels + 1] = {};
+    int depth_ = -1;  // -1 at the end
+    std::uint32_t entry_ = 0;
+  };
+  using iterator = const_iterator;
+
+  PersistentMap() = default;
+  explicit PersistentMap(const Hash& hash, const KeyEqual& equal = KeyEqual())
+      : hash_(hash), equal_(equal) {}
+
+  PersistentMap(std::initializer_list<value_type> values, const Hash& hash = Hash(),
+                const KeyEqual& equal = KeyEqual())
+      : hash_(hash), equal_(equal) {
+    for (const value_type& value : values) {
+      size_ += insert(root_, 0, hash_of(value.first), K(value.first), V(value.second));
+    }
+  }
+
+  // Copies share every node and are O(1), moves leave an empty map.
+  PersistentMap(const PersistentMap&) = default;
+  PersistentMap(PersistentMap&& other) noexcept
+      : root_(std::move(other.root_)), size_(std::exchange(other.size_, 0)),
+        hash_(other.hash_), equal_(other.equal_) {}
+  PersistentMap& operator=(const PersistentMap&) = default;
+  PersistentMap& operator=(PersistentMap&& other) noexcept {
+    root_ = std::move(other.root_);
+    size_ = std::exchange(other.size_, 0);
+    hash_ = other.hash_;
+    equal_ = other.equal_;
+    return *this;
+  }
+
+  size_type size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+  hasher hash_function() const { return hash_; }
+  key_equal key_eq() const { return equal_; }
+
+  const_iterator begin() const { return const_iterator(root_.get()); }
+  const_iterator end() const { return const_iterator(); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  // The value of key, or nullptr if it is absent.
+  const V* find(const K& key) const {
+    const std::size_t hash = hash_of(key);
+    const Node* node = root_.get();
+    for (unsigned shift = 0; node != nullptr; shift += kBits) {
+      if (shift >= kHashBits) {
+        const Entry* entries = node->entries();
+        for (std::uint32_t i = 0; i < node->entry_count(); ++i) {
+          if (equal_(entries[i].first, key)) {
+            return &entries[i].second;
+          }
+        }
+        return nullptr;
+      }
+      const std::uint32_t bit = bit_of(hash, shift);
+      if ((node->entry_map() & bit) != 0) {
+        const Entry& entry = node->entries()[index_of(node->entry_map(), bit)];
+        return equal_(entry.first, key) ? &entry.second : nullptr;
+      }
+      if ((node->child_map() & bit) == 0) {
+        return nullptr;
+      }
+      node = node->children()[index_of(node->child_map(), bit)].get();
+    }
+    return nullptr;
+  }
+
+  bool contains(const K& key) const { return find(key) != nullptr; }
+  size_type count(const K& key) const { return contains(key) ? 1 : 0; }
+
+  // Throws std::out_of_range if key is absent.
+  const V& at(const K& key) const {
+    const V* value = find(key);
+    if (value == nullptr) {
+      throw std::out_of_range("PersistentMap::at");
+    }
+    return *value;
+  }
+
+  // The map with key mapped to value, whether or not it was there.
+  PersistentMap set(K key, V value) const& {
+    PersistentMap result(*this);
+    result.size_ += result.insert(result.root_, 0, hash_of(key), std::move(key), std::move(value));
+    return result;
+  }
+  PersistentMap set(K key, V value) && {
+    size_ += insert(root_, 0, hash_of(key), std::move(key), std::move(value));
+    return std::move(*this);
+  }
+
+  // The map without key; the same map if key is absent.
+  PersistentMap erase(const K& key) const& {
+    PersistentMap result(*this);
+    result.size_ -= result.remove(result.root_, 0, hash_of(key), key);
+    return result;
+  }
+  PersistentMap erase(const K& key) && {
+    size_ -= remove(root_, 0, hash_of(key), key);
+    return std::move(*this);
+  }
+
+  friend bool operator==(const PersistentMap& lhs, const PersistentMap& rhs) {
+    if (lhs.size_ != rhs.size_) {
+      return false;
+    }
+    for (const value_type& entry : lhs) {
+      const V* other = rhs.find(entry.first);
+      if (other == nullptr || !(*other == entry.second)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  std::size_t hash_of(const K& key) const { return unorderedmap_detail::mix(hash_(key)); }
+
+  static std::uint32_t bit_of(std::size_t hash, unsigned shift) {
+    return std::uint32_t{1} << ((hash >> shift) & persistent_detail::kMask);
+  }
+  // Position of bit's slot in the packed array for map.
+  static std::uint32_t index_of(std::uint32_t map, std::uint32_t bit) {
+    return static_cast<std::uint32_t>(std::popcount(map & (bit - 1)));
+  }
+
+  static void copy_children(const Node& from, Node& to) {
+    std::copy_n(from.children(), from.child_count(), to.children());
+  }
+
+  // node with a new entry at the free position bit.
+  static NodePtr with_entry(const Node& node, std::uint32_t bit, Entry&& entry) {
+    const std::uint32_t at = index_of(node.entry_map(), bit);
+    return Node::make(node.entry_map() | bit, node.child_map(), node.entry_count() + 1,
+                      node.child_count(), [&](Node& copy) {
+                        copy_children(node, copy);
+                        for (std::uint32_t i = 0; i < node.entry_count(); ++i) {
+                          if (i == at) {
+                            copy.add_entry(std::move(entry));
+                          }
+                          copy.add_entry(node.entries()[i]);
+                        }
+                        if (at == node.entry_count()) {
+                          copy.add_entry(std::move(entry));
+                        }
+                      });
+  }
+
+  // node without its entry at position bit.
+  static NodePtr without_entry(const Node& node, std::uint32_t bit) {
+    const std::uint32_t at = index_of(node.entry_map(), bit);
+    return Node::make(node.entry_map() & ~bit, node.child_map(), node.entry_count() - 1,
+                      node.child_count(), [&](Node& copy) {
+                        copy_children(node, copy);
+                        for (std::uint32_t i = 0; i < node.entry_count(); ++i) {
+                          if (i != at) {
+                            copy.add_entry(node.entries()[i]);
+                          }
+                        }
+                      });
+  }
+
+  // node with the value of entry `at` replaced.
+  static NodePtr with_value(const Node& node, std::uint32_t at, V&& value) {
+    return Node::make(node.entry_map(), node.child_map(), node.entry_count(), node.child_count(),
+                      [&](Node& copy) {
+                        copy_children(node, copy);
+                        for (std::uint32_t i = 0; i < node.entry_count(); ++i) {
+                          if (i == at) {
+                            copy.add_entry(node.entries()[i].first, std::move(value));
+                          } else {
+                            copy.add_entry(node.entries()[i]);
+                          }
+                        }
+                      });
+  }
+
+  // node with child `at` replaced.
+  static NodePtr with_child(const Node& node, std::uint32_t at, NodePtr child) {
+    return Node::make(node.entry_map(), node.child_map(), node.entry_count(), node.child_count(),
+                      [&](Node& copy) {
+                        copy_children(node, copy);
+                        copy.children()[at] = std::move(child);
+                        for (std::uint32_t i = 0; i < node.entry_count(); ++i) {
+                          copy.add_entry(node.entries()[i]);
+                        }
+                      });
+  }
+
+  // node with the entry at position bit replaced by the subtree child.
+  static NodePtr entry_to_child(const Node& node, std::uint32_t bit, NodePtr child) {
+    const std::uint32_t entry_at = index_of(node.entry_map(), bit);
+    const std::uint32_t child_at = index_of(node.child_map(), bit);
+    return Node::make(node.entry_map() & ~bit, node.child_map() | bit, node.entry_count() - 1,
+                      node.child_count() + 1, [&](Node& copy) {
+                        const NodePtr* children = node.children();
+                        std::copy_n(children, child_at, copy.children());
+                        copy.children()[child_at] = std::move(child);
+                        std::copy(children + child_at, children + node.child_count(),
+                                  copy.children() + child_at + 1);
+                        for (std::uint32_t i = 0; i < node.entry_count(); ++i) {
+                          if (i != entry_at) {
+                            copy.add_entry(node.entries()[i]);
+                          }
+                        }
+                      });
+  }
+
+  // node with the subtree at position bit replaced by its one entry.
+  static NodePtr child_to_entry(const Node& node, std::uint32_t bit, const Entry& entry) {
+    const std::uint32_t entry_at = index_of(node.entry_map(), bit);
+    const std::uint32_t child_at = index_of(node.child_map(), bit);
+    return Node::make(node.entry_map() | bit, node.child_map() & ~bit, node.entry_count() + 1,
+                      node.child_count() - 1, [&](Node& copy) {
+                        const NodePtr* children = node.children();
+                        std::copy_n(children, child_at, copy.children());
+                        std::copy(children + child_at + 1, children + node.child_count(),
+                                  copy.children() + child_at);
+                        for (std::uint32_t i = 0; i < node.entry_count(); ++i) {
+                          if (i == entry_at) {
+                            copy.add_entry(entry);
+                          }
+                          copy.add_entry(node.entries()[i]);
+                        }
+                        if (entry_at == node.entry_count()) {
+                          copy.add_entry(entry);
+                        }
+                      });
+  }
+
+  // The smallest subtree at shift holding two entries with different keys.
+  static NodePtr merge(unsigned shift, Entry&& first, std::size_t first_hash, Entry&& second,
+                       std::size_t second_hash) {
+    if (shift >= kHashBits) {
+      return Node::make(0, 0, 2, 0, [&](Node& node) {
+        node.add_entry(std::move(first));
+        node.add_entry(std::move(second));
+      });
+    }
+    const std::uint32_t first_bit = bit_of(first_hash, shift);
+    const std::uint32_t second_bit = bit_of(second_hash, shift);
+    if (first_bit == second_bit) {
+      NodePtr child =
+          merge(shift + kBits, std::move(first), first_hash, std::move(second), second_hash);
+      return Node::make(0, first_bit, 0, 1,
+                        [&](Node& node) { node.children()[0] = std::move(child); });
+    }
+    return Node::make(first_bit | second_bit, 0, 2, 0, [&](Node& node) {
+      if (first_bit < second_bit) {
+        node.add_entry(std::move(first));
+        node.add_entry(std::move(second));
+      } else {
+        node.add_entry(std::move(second));
+        node.add_entry(std::move(first));
+      }
+    });
+  }
+
+  // Maps key to value in the subtree at slot, whose nodes pick positions
+  // from bit shift of the hash on. Returns whether key is new. Nodes owned
+  // by this version alone are updated in place where the layout allows.
+  bool insert(NodePtr& slot, unsigned shift, std::size_t hash, K&& key, V&& value) {
+    if (!slot) {
+      const std::uint32_t bit = bit_of(hash, shift);
+      slot = Node::make(bit, 0, 1, 0,
+                        [&](Node& node) { node.add_entry(std::move(key), std::move(value)); });
+      return true;
+    }
+    Node& node = *slot;
+    if (shift >= kHashBits) {
+      return insert_colliding(slot, std::move(key), std::move(value));
+    }
+    const std::uint32_t bit = bit_of(hash, shift);
+    if ((node.entry_map() & bit) != 0) {
+      const std::uint32_t at = index_of(node.entry_map(), bit);
+      const Entry& entry = node.entries()[at];
+      if (equal_(entry.first, key)) {
+        if (node.owned()) {
+          node.entries()[at].second = std::move(value);
+        } else {
+          slot = with_value(node, at, std::move(value));
+        }
+        return false;
+      }
+      NodePtr child = merge(shift + kBits, Entry(entry), hash_of(entry.first),
+                            Entry(std::move(key), std::move(value)), hash);
+      slot = entry_to_child(node, bit, std::move(child));
+      return true;
+    }
+    if ((node.child_map() & bit) != 0) {
+      const std::uint32_t at = index_of(node.child_map(), bit);
+      if (node.owned()) {
+        return insert(node.children()[at], shift + kBits, hash, std::move(key), std::move(value));
+      }
+      NodePtr child = node.children()[at];
+      const bool inserted = insert(child, shift + kBits, hash, std::move(key), std::move(value));
+      slot = with_child(node, at, std::move(child));
+      return inserted;
+    }
+    slot = with_entry(node, bit, Entry(std::move(key), std::move(value)));
+    return true;
+  }
+
+  bool insert_colliding(NodePtr& slot, K&& key, V&& value) {
+    Node& node = *slot;
+    for (std::uint32_t i = 0; i < node.entry_count(); ++i) {
+      if (equal_(node.entries()[i].first, key)) {
+        if (node.owned()) {
+          node.entries()[i].second = std::move(value);
+        } else {
+          slot = with_value(node, i, std::move(value));
+        }
+        return false;
+      }
+    }
+    slot = Node::make(0, 0, node.entry_count() + 1, 0, [&](Node& copy) {
+      for (std::uint32_t i = 0; i < node.entry_count(); ++i) {
+        copy.add_entry(node.entries()[i]);
+      }
+      copy.add_entry(std::move(key), std::move(value));
+    });
+    return true;
+  }
+
+  // Removes key from the subtree at slot; returns whether it was there.
+  // A subtree left with a single entry and no subtrees is lifted into the
+  // parent by the caller; the root may keep one, or be reset when empty.
+  bool remove(NodePtr& slot, unsigned shift, std::size_t hash, const K& key) {
+    if (!slot) {
+      return false;
+    }
+    Node& node = *slot;
+    if (shift >= kHashBits) {
+      for (std::uint32_t i = 0; i < node.entry_count(); ++i) {
+        if (equal_(node.entries()[i].first, key)) {
+          slot = Node::make(0, 0, node.entry_count() - 1, 0, [&](Node& copy) {
+            for (std::uint32_t j = 0; j < node.entry_count(); ++j) {
+              if (j != i) {
+                copy.add_entry(node.entries()[j]);
+              }
+            }
+          });
+          return true;
+        }
+      }
+      return false;
+    }
+    const std::uint32_t bit = bit_of(hash, shift);
+    if ((node.entry_map() & bit) != 0) {
+      if (!equal_(node.entries()[index_of(node.entry_map(), bit)].first, key)) {
+        return false;
+      }
+      if (node.entry_count() == 1 && node.child_count() == 0) {
+        slot.reset();
+      } else {
+        slot = without_entry(node, bit);
+      }
+      return true;
+    }
+    if ((node.child_map() & bit) == 0) {
+      return false;
+    }
+    const std::uint32_t at = index_of(node.child_map(), bit);
+    const bool owned = node.owned();
+    NodePtr shared;
+    NodePtr& child = owned ? node.children()[at] : (shared = node.children()[at]);
+    if (!remove(child, shift + kBits, hash, key)) {
+      return false;
+    }
+    if (child->child_count() == 0 && child->entry_count() == 1) {
+      slot = child_to_entry(node, bit, child->entries()[0]);
+    } else if (!owned) {
+      slot = with_child(node, at, std::move(shared));
+    }
+    return true;
+  }
+
+  NodePtr root_;  // null when empty
+  size_type size_ = 0;
+  [[no_unique_address]] Hash hash_;
+  [[no_unique_address]] KeyEqual equal_;
+};
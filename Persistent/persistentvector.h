@@ -0,0 +1,452 @@
+#pragma once
+
+// Immutable vector whose updates return new versions sharing structure.
+//
+// The elements live in a 32-way trie of leaves of 32 elements, as in
+// Bagwell's and Clojure's persistent vectors, plus a tail leaf holding the
+// last 1 to 32 elements outside the trie. Element i is found by taking
+// five bits of i per level, so a lookup touches at most log32(n) + 1
+// nodes: 4 for a million elements, 7 for a billion. set() and pop_back()
+// copy only the nodes on the path to the element, and push_back() usually
+// just the tail, so a new version costs O(log32 n) however large the
+// vector; every other node is shared with the old version.
+//
+// Nodes are reference counted through IntrusivePtr with atomic counts, so
+// versions can be handed to other threads and read there while the owner
+// goes on making new ones. A version is never modified, but a
+// PersistentVector object is a value: assigning a new version to it must
+// not race with readers of that same object.
+//
+// The updates also come as rvalue overloads, std::move(v).set(i, x), which
+// modify nodes in place where no other version shares them. A loop of
+// std::move(v).push_back(x) then builds a vector without copying a node.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include "SmartPointers/intrusiveptr.h"
+#include "SmartPointers/smartpointers.h"
+
+namespace persistent_detail {
+
+inline constexpr unsigned kBits = 5;
+inline constexpr std::size_t kWidth = std::size_t{1} << kBits;
+inline constexpr std::size_t kMask = kWidth - 1;
+
+template <typename T>
+struct VectorLeaf;
+template <typename T>
+struct VectorBranch;
+
+// Base of both node kinds; the release deletes through the kind, so nodes
+// need no virtual destructor.
+template <typename T>
+struct VectorNode {
+  explicit VectorNode(bool is_leaf) noexcept : leaf(is_leaf) {}
+  VectorNode(const VectorNode&) = delete;
+  VectorNode& operator=(const VectorNode&) = delete;
+
+  friend void intrusivePtrAddRef(const VectorNode* node) noexcept { node->refs.increment(); }
+  friend void intrusivePtrRelease(const VectorNode* node) noexcept {
+    if (node->refs.decrement() == 0) {
+      if (node->leaf) {
+        delete static_cast<const VectorLeaf<T>*>(node);
+      } else {
+        delete static_cast<const VectorBranch<T>*>(node);
+      }
+    }
+  }
+
+  mutable AtomicCount::Counter refs{0};
+  const bool leaf;
+};
+
+template <typename T>
+using VectorNodePtr = IntrusivePtr<VectorNode<T>>;
+
+// Up to kWidth elements; only the tail is ever partly filled.
+template <typename T>
+struct VectorLeaf : VectorNode<T> {
+  VectorLeaf() noexcept : VectorNode<T>(true) {}
+  ~VectorLeaf() { std::destroy_n(values(), size); }
+
+  T* values() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+  const T* values() const noexcept { return std::launder(reinterpret_cast<const T*>(storage)); }
+
+  template <typename... Args>
+  void emplace_back(Args&&... args) {
+    std::construct_at(values() + size, std::forward<Args>(args)...);
+    ++size;
+  }
+  void pop_back() noexcept { std::destroy_at(values() + --size); }
+
+  std::uint32_t size = 0;
+  alignas(T) std::byte storage[kWidth * sizeof(T)];
+};
+
+template <typename T>
+struct VectorBranch : VectorNode<T> {
+  VectorBranch() noexcept : VectorNode<T>(false) {}
+
+  VectorNodePtr<T> children[kWidth];
+};
+
+}  // namespace persistent_detail
+
+template <typename T>
+class PersistentVector {
+  using Node = persistent_detail::VectorNode<T>;
+  using NodePtr = persistent_detail::VectorNodePtr<T>;
+  using Leaf = persistent_detail::VectorLeaf<T>;
+  using Branch = persistent_detail::VectorBranch<T>;
+
+  static constexpr unsigned kBits = persistent_detail::kBits;
+  static constexpr std::size_t kWidth = persistent_detail::kWidth;
+  static constexpr std::size_t kMask = persistent_detail::kMask;
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = const T&;
+  using const_reference = const T&;
+
+  class const_iterator {
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator() = default;
+
+    // The leaf of the current element is cached, so stepping through a
+    // leaf does not walk the trie.
+    const T& operator*() const {
+      if ((index_ >> kBits) != block_) {
+        block_ = index_ >> kBits;
+        values_ = vector_->leaf_for(index_);
+      }
+      return values_[index_ & kMask];
+    }
+    const T* operator->() const { return &**this; }
+    const T& operator[](difference_type n) const { return *(*this + n); }
+
+    const_iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator old = *this;
+      ++index_;
+      return old;
+    }
+    const_iterator& operator--() {
+      --index_;
+      return *this;
+    }
+    const_iterator operator--(int) {
+      const_iterator old = *this;
+      --index_;
+      return old;
+    }
+    const_iterator& operator+=(difference_type n) {
+      index_ += static_cast<size_type>(n);
+      return *this;
+    }
+    const_iterator& operator-=(difference_type n) {
+      index_ -= static_cast<size_type>(n);
+      return *this;
+    }
+
+    friend const_iterator operator+(const_iterator it, difference_type n) { return it += n; }
+    friend const_iterator operator+(difference_type n, const_iterator it) { return it += n; }
+    friend const_iterator operator-(const_iterator it, difference_type n) { return it -= n; }
+    friend difference_type operator-(const const_iterator& lhs, const const_iterator& rhs) {
+      return static_cast<difference_type>(lhs.index_ - rhs.index_);
+    }
+
+    friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) {
+      return lhs.index_ == rhs.index_;
+    }
+    friend auto operator<=>(const const_iterator& lhs, const const_iterator& rhs) {
+      return lhs.index_ <=> rhs.index_;
+    }
+
+   private:
+    friend class PersistentVector;
+
+    const_iterator(const PersistentVector* vector, size_type index)
+        : vector_(vector), index_(index) {}
+
+    const PersistentVector* vector_ = nullptr;
+    size_type index_ = 0;
+    mutable size_type block_ = static_cast<size_type>(-1);
+    mutable const T* values_ = nullptr;
+  };
+  using iterator = const_iterator;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  using reverse_iterator = const_reverse_iterator;
+
+  PersistentVector() = default;
+
+  template <std::input_iterator InputIt>
+  PersistentVector(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+      push(*first);
+    }
+  }
+
+  PersistentVector(std::initializer_list<T> values)
+      : PersistentVector(values.begin(), values.end()) {}
+
+  // Copies share every node and are O(1), moves leave an empty vector.
+  PersistentVector(const PersistentVector&) = default;
+  PersistentVector(PersistentVector&& other) noexcept
+      : root_(std::move(other.root_)), tail_(std::move(other.tail_)),
+        size_(std::exchange(other.size_, 0)), shift_(std::exchange(other.shift_, kBits)) {}
+  PersistentVector& operator=(const PersistentVector&) = default;
+  PersistentVector& operator=(PersistentVector&& other) noexcept {
+    root_ = std::move(other.root_);
+    tail_ = std::move(other.tail_);
+    size_ = std::exchange(other.size_, 0);
+    shift_ = std::exchange(other.shift_, kBits);
+    return *this;
+  }
+
+  size_type size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+  const T& operator[](size_type index) const { return leaf_for(index)[index & kMask]; }
+  const T& at(size_type index) const {
+    if (index >= size_) {
+      throw std::out_of_range("PersistentVector::at");
+    }
+    return (*this)[index];
+  }
+  const T& front() const { return (*this)[0]; }
+  const T& back() const { return (*this)[size_ - 1]; }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size_); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+  const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+  // The vector with value appended.
+  PersistentVector push_back(T value) const& {
+    PersistentVector result(*this);
+    result.push(std::move(value));
+    return result;
+  }
+  PersistentVector push_back(T value) && {
+    push(std::move(value));
+    return std::move(*this);
+  }
+
+  // The vector with element index replaced. Throws std::out_of_range if
+  // index >= size().
+  PersistentVector set(size_type index, T value) const& {
+    PersistentVector result(*this);
+    result.assign(index, std::move(value));
+    return result;
+  }
+  PersistentVector set(size_type index, T value) && {
+    assign(index, std::move(value));
+    return std::move(*this);
+  }
+
+  // The vector without its last element, which must exist.
+  PersistentVector pop_back() const& {
+    PersistentVector result(*this);
+    result.pop();
+    return result;
+  }
+  PersistentVector pop_back() && {
+    pop();
+    return std::move(*this);
+  }
+
+  friend bool operator==(const PersistentVector& lhs, const PersistentVector& rhs) {
+    return lhs.size_ == rhs.size_ && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+  }
+
+ private:
+  static Leaf* as_leaf(const NodePtr& node) noexcept { return static_cast<Leaf*>(node.get()); }
+  static Branch* as_branch(const NodePtr& node) noexcept {
+    return static_cast<Branch*>(node.get());
+  }
+
+  // Index of the first element in the tail; everything before is in the trie.
+  size_type tail_offset() const noexcept { return size_ == 0 ? 0 : (size_ - 1) & ~kMask; }
+
+  // The elements of the leaf holding index.
+  const T* leaf_for(size_type index) const {
+    if (index >= tail_offset()) {
+      return as_leaf(tail_)->values();
+    }
+    const Node* node = root_.get();
+    for (unsigned level = shift_; level > 0; level -= kBits) {
+      node = static_cast<const Branch*>(node)->children[(index >> level) & kMask].get();
+    }
+    return static_cast<const Leaf*>(node)->values();
+  }
+
+  // Makes the node in slot one that only this version owns, copying it
+  // unless it already is, and returns it. A node reached only through
+  // nodes of this version and counted once belongs to nobody else.
+  static Leaf* own_leaf(NodePtr& slot) {
+    if (!slot->refs.unique()) {
+      const Leaf& shared = *as_leaf(slot);
+      IntrusivePtr<Leaf> copy(new Leaf);
+      for (std::uint32_t i = 0; i < shared.size; ++i) {
+        copy->emplace_back(shared.values()[i]);
+      }
+      slot = std::move(copy);
+    }
+    return as_leaf(slot);
+  }
+
+  static Branch* own_branch(NodePtr& slot) {
+    if (!slot->refs.unique()) {
+      const Branch& shared = *as_branch(slot);
+      IntrusivePtr<Branch> copy(new Branch);
+      std::copy(std::begin(shared.children), std::end(shared.children), copy->children);
+      slot = std::move(copy);
+    }
+    return as_branch(slot);
+  }
+
+  // A chain of branches down from level with leaf at its left edge.
+  static NodePtr new_path(unsigned level, const NodePtr& leaf) {
+    if (level == 0) {
+      return leaf;
+    }
+    IntrusivePtr<Branch> branch(new Branch);
+    branch->children[0] = new_path(level - kBits, leaf);
+    return branch;
+  }
+
+  // Hangs the full tail, whose last element is index, below slot.
+  static void push_tail(NodePtr& slot, unsigned level, size_type index, const NodePtr& leaf) {
+    Branch* branch = own_branch(slot);
+    NodePtr& child = branch->children[(index >> level) & kMask];
+    if (level == kBits) {
+      child = leaf;
+    } else if (child) {
+      push_tail(child, level - kBits, index, leaf);
+    } else {
+      child = new_path(level - kBits, leaf);
+    }
+  }
+
+  // Unhangs the last leaf below slot, the one holding index. Returns
+  // whether slot is left without children, and then leaves it to the
+  // caller to drop.
+  static bool pop_tail(NodePtr& slot, unsigned level, size_type index) {
+    const size_type child = (index >> level) & kMask;
+    if (level == kBits) {
+      if (child == 0) {
+        return true;
+      }
+      own_branch(slot)->children[child].reset();
+      return false;
+    }
+    Branch* branch = own_branch(slot);
+    if (!pop_tail(branch->children[child], level - kBits, index)) {
+      return false;
+    }
+    branch->children[child].reset();
+    return child == 0;
+  }
+
+  template <typename Value>
+  void push(Value&& value) {
+    if (size_ == 0) {
+      tail_ = NodePtr(new Leaf);
+    } else if (size_ - tail_offset() == kWidth) {
+      // The tail is full: it moves into the trie and a new one starts. The
+      // tail stays in place until nothing can throw any more.
+      IntrusivePtr<Leaf> fresh(new Leaf);
+      fresh->emplace_back(std::forward<Value>(value));
+      const size_type last = size_ - 1;
+      if (!root_) {
+        root_ = new_path(kBits, tail_);
+      } else if ((size_ >> kBits) > (size_type{1} << shift_)) {
+        IntrusivePtr<Branch> root(new Branch);
+        root->children[1] = new_path(shift_, tail_);
+        root->children[0] = std::move(root_);
+        root_ = std::move(root);
+        shift_ += kBits;
+      } else {
+        push_tail(root_, shift_, last, tail_);
+      }
+      tail_ = std::move(fresh);
+      ++size_;
+      return;
+    }
+    own_leaf(tail_)->emplace_back(std::forward<Value>(value));
+    ++size_;
+  }
+
+  void assign(size_type index, T&& value) {
+    if (index >= size_) {
+      throw std::out_of_range("PersistentVector::set");
+    }
+    if (index >= tail_offset()) {
+      own_leaf(tail_)->values()[index & kMask] = std::move(value);
+      return;
+    }
+    NodePtr* slot = &root_;
+    for (unsigned level = shift_; level > 0; level -= kBits) {
+      slot = &own_branch(*slot)->children[(index >> level) & kMask];
+    }
+    own_leaf(*slot)->values()[index & kMask] = std::move(value);
+  }
+
+  void pop() {
+    if (size_ == 1) {
+      tail_.reset();
+      size_ = 0;
+      return;
+    }
+    if (size_ - tail_offset() > 1) {
+      own_leaf(tail_)->pop_back();
+      --size_;
+      return;
+    }
+    // The last leaf of the trie becomes the tail, still shared.
+    const size_type last = size_ - 2;
+    const Node* node = root_.get();
+    for (unsigned level = shift_; level > 0; level -= kBits) {
+      node = static_cast<const Branch*>(node)->children[(last >> level) & kMask].get();
+    }
+    NodePtr leaf(const_cast<Node*>(node));
+    if (pop_tail(root_, shift_, last)) {
+      root_.reset();
+    } else if (shift_ > kBits && !as_branch(root_)->children[1]) {
+      NodePtr only = as_branch(root_)->children[0];
+      root_ = std::move(only);
+      shift_ -= kBits;
+    }
+    if (!root_) {
+      shift_ = kBits;
+    }
+    tail_ = std::move(leaf);
+    --size_;
+  }
+
+  NodePtr root_;  // null while every element is in the tail
+  NodePtr tail_;  // null when empty
+  size_type size_ = 0;
+  unsigned shift_ = kBits;  // bits of the index below the root's children
+};
@@ -0,0 +1,353 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Persistent/persistentmap.h"
+#include "Persistent/persistentvector.h"
+
+namespace {
+
+struct Counted {
+  static inline int alive = 0;
+  int value = 0;
+  Counted(int v = 0) : value(v) { ++alive; }  // NOLINT(google-explicit-constructor)
+  Counted(const Counted& other) : value(other.value) { ++alive; }
+  Counted& operator=(const Counted&) = default;
+  ~Counted() { --alive; }
+  bool operator==(const Counted& other) const { return value == other.value; }
+};
+
+// Sizes on either side of a full tail and of each level of the trie.
+const std::size_t kSizes[] = {0, 1, 31, 32, 33, 64, 65, 1055, 1056, 1057, 1088, 1089, 33823, 33824,
+                              33825, 40000};
+
+PersistentVector<int> iota_vector(std::size_t size) {
+  PersistentVector<int> v;
+  for (std::size_t i = 0; i < size; ++i) {
+    v = std::move(v).push_back(static_cast<int>(i));
+  }
+  return v;
+}
+
+void expect_elements(const PersistentVector<int>& v, const std::vector<int>& expected) {
+  ASSERT_EQ(v.size(), expected.size());
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(v[i], expected[i]) << i;
+  }
+  EXPECT_TRUE(std::equal(v.begin(), v.end(), expected.begin(), expected.end()));
+}
+
+TEST(PersistentVector, GrowsAndShrinksAcrossLevels) {
+  for (std::size_t size : kSizes) {
+    PersistentVector<int> v = iota_vector(size);
+    std::vector<int> expected(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      expected[i] = static_cast<int>(i);
+    }
+    expect_elements(v, expected);
+    EXPECT_EQ(v.empty(), size == 0);
+    if (size != 0) {
+      EXPECT_EQ(v.front(), 0);
+      EXPECT_EQ(v.back(), static_cast<int>(size - 1));
+    }
+    EXPECT_THROW(v.at(size), std::out_of_range);
+
+    while (!v.empty()) {
+      v = std::move(v).pop_back();
+      expected.pop_back();
+      if (v.size() % 97 == 0 || v.size() % 32 <= 1) {
+        expect_elements(v, expected);
+      }
+    }
+    EXPECT_EQ(v, PersistentVector<int>());
+    v = std::move(v).push_back(7);
+    expect_elements(v, {7});
+  }
+}
+
+TEST(PersistentVector, ConstructsAndIterates) {
+  PersistentVector<std::string> words{"a", "b", "c"};
+  EXPECT_EQ(words.size(), 3u);
+  EXPECT_EQ(words.at(1), "b");
+
+  std::vector<int> source(2000);
+  for (std::size_t i = 0; i < source.size(); ++i) {
+    source[i] = static_cast<int>(i * 3);
+  }
+  PersistentVector<int> v(source.begin(), source.end());
+  expect_elements(v, source);
+  EXPECT_TRUE(std::equal(v.rbegin(), v.rend(), source.rbegin(), source.rend()));
+
+  auto it = v.begin() + 1000;
+  EXPECT_EQ(*it, 3000);
+  EXPECT_EQ(*(it - 999), 3);
+  EXPECT_EQ(*--it, 2997);
+  EXPECT_EQ(*it++, 2997);
+  EXPECT_EQ(v.end() - it, 1000);
+  EXPECT_LT(v.begin(), it);
+  EXPECT_EQ(std::distance(v.cbegin(), v.cend()), 2000);
+}
+
+TEST(PersistentVector, UpdatesLeaveOldVersionsAlone) {
+  std::mt19937 gen(1);
+  std::vector<PersistentVector<int>> versions{PersistentVector<int>()};
+  std::vector<std::vector<int>> expected{{}};
+  for (int step = 0; step < 4000; ++step) {
+    const PersistentVector<int>& last = versions.back();
+    std::vector<int> next = expected.back();
+    const unsigned op = gen() % 8;
+    if (op < 5 || next.empty()) {
+      next.push_back(step);
+      versions.push_back(last.push_back(step));
+    } else if (op < 7) {
+      const std::size_t at = gen() % next.size();
+      next[at] = -step;
+      versions.push_back(last.set(at, -step));
+    } else {
+      next.pop_back();
+      versions.push_back(last.pop_back());
+    }
+    expected.push_back(std::move(next));
+  }
+  for (std::size_t i = 0; i < versions.size(); i += 37) {
+    expect_elements(versions[i], expected[i]);
+  }
+  expect_elements(versions.back(), expected.back());
+  EXPECT_THROW(versions.back().set(expected.back().size(), 0), std::out_of_range);
+}
+
+TEST(PersistentVector, SharesWhatAnUpdateDoesNotTouch) {
+  PersistentVector<int> v = iota_vector(5000);
+  PersistentVector<int> w = v.set(4000, -1);
+  EXPECT_EQ(&v[0], &w[0]);
+  EXPECT_EQ(&v[3999 & ~31], &w[3999 & ~31]);
+  EXPECT_NE(&v[4000], &w[4000]);
+  EXPECT_EQ(v[4000], 4000);
+  EXPECT_EQ(w[4000], -1);
+
+  // In place once nothing else shares the nodes.
+  v = PersistentVector<int>();
+  const int* slot = &w[4000];
+  w = std::move(w).set(4000, -2);
+  EXPECT_EQ(&w[4000], slot);
+  EXPECT_EQ(w[4000], -2);
+}
+
+TEST(PersistentVector, RvalueUpdatesCopyWhatIsShared) {
+  PersistentVector<int> v = iota_vector(3000);
+  PersistentVector<int> copy = v;
+  copy = std::move(copy).set(10, -1);
+  copy = std::move(copy).set(2999, -2);
+  copy = std::move(copy).push_back(3000);
+  copy = std::move(copy).pop_back();
+  copy = std::move(copy).pop_back();
+  EXPECT_EQ(copy.size(), 2999u);
+  EXPECT_EQ(copy[10], -1);
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    ASSERT_EQ(v[i], static_cast<int>(i));
+  }
+
+  PersistentVector<int> moved = std::move(v);
+  EXPECT_TRUE(v.empty());  // NOLINT(bugprone-use-after-move)
+  EXPECT_EQ(moved.size(), 3000u);
+}
+
+TEST(PersistentVector, DestroysElementsWithTheLastVersion) {
+  {
+    PersistentVector<Counted> v;
+    for (int i = 0; i < 2000; ++i) {
+      v = std::move(v).push_back(Counted(i));
+    }
+    PersistentVector<Counted> w = v.set(5, Counted(-5)).pop_back().push_back(Counted(1));
+    EXPECT_GT(Counted::alive, 2000);
+    v = PersistentVector<Counted>();
+    EXPECT_EQ(w[5].value, -5);
+    EXPECT_EQ(w[1999].value, 1);
+  }
+  EXPECT_EQ(Counted::alive, 0);
+}
+
+TEST(PersistentVector, VersionsAreReadOnOtherThreads) {
+  PersistentVector<int> v = iota_vector(10000);
+  std::vector<std::thread> readers;
+  std::atomic<bool> wrong{false};
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([snapshot = v, &wrong] {
+      for (int round = 0; round < 20; ++round) {
+        for (std::size_t i = 0; i < snapshot.size(); ++i) {
+          if (snapshot[i] != static_cast<int>(i)) {
+            wrong = true;
+          }
+        }
+      }
+    });
+  }
+  for (int step = 0; step < 10000; ++step) {
+    v = std::move(v).set(static_cast<std::size_t>(step), -step);
+  }
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+  EXPECT_FALSE(wrong);
+}
+
+// Spreads keys over only a few distinct hashes, so that most of them share
+// all 64 bits of theirs.
+struct FewHashes {
+  std::size_t operator()(int key) const { return static_cast<std::size_t>(key % 4); }
+};
+
+template <typename Map>
+void expect_entries(const Map& map, const std::map<int, int>& expected) {
+  ASSERT_EQ(map.size(), expected.size());
+  for (const auto& [key, value] : expected) {
+    const int* found = map.find(key);
+    ASSERT_NE(found, nullptr) << key;
+    EXPECT_EQ(*found, value) << key;
+  }
+  std::map<int, int> iterated;
+  for (const auto& [key, value] : map) {
+    EXPECT_TRUE(iterated.emplace(key, value).second) << key;
+  }
+  EXPECT_EQ(iterated, expected);
+}
+
+template <typename Map>
+void check_random_updates(unsigned seed, int key_range) {
+  std::mt19937 gen(seed);
+  std::vector<Map> versions{Map()};
+  std::vector<std::map<int, int>> expected{{}};
+  for (int step = 0; step < 3000; ++step) {
+    const int key = static_cast<int>(gen() % static_cast<unsigned>(key_range)) - key_range / 2;
+    std::map<int, int> next = expected.back();
+    if (gen() % 3 == 0) {
+      next.erase(key);
+      versions.push_back(versions.back().erase(key));
+    } else {
+      next[key] = step;
+      versions.push_back(versions.back().set(key, step));
+    }
+    expected.push_back(std::move(next));
+  }
+  for (std::size_t i = 0; i < versions.size(); i += 101) {
+    expect_entries(versions[i], expected[i]);
+  }
+  expect_entries(versions.back(), expected.back());
+}
+
+TEST(PersistentMap, SetsFindsAndErases) {
+  PersistentMap<std::string, int> map{{"one", 1}, {"two", 2}};
+  EXPECT_EQ(map.size(), 2u);
+  EXPECT_EQ(map.at("one"), 1);
+  EXPECT_TRUE(map.contains("two"));
+  EXPECT_EQ(map.count("three"), 0u);
+  EXPECT_EQ(map.find("three"), nullptr);
+  EXPECT_THROW(map.at("three"), std::out_of_range);
+
+  PersistentMap<std::string, int> more = map.set("three", 3).set("one", 10);
+  EXPECT_EQ(more.size(), 3u);
+  EXPECT_EQ(more.at("one"), 10);
+  EXPECT_EQ(map.at("one"), 1);
+  EXPECT_FALSE(map.contains("three"));
+
+  using Map = PersistentMap<std::string, int>;
+  Map fewer = more.erase("two").erase("absent");
+  EXPECT_EQ(fewer.size(), 2u);
+  EXPECT_FALSE(fewer.contains("two"));
+  EXPECT_TRUE(more.contains("two"));
+  EXPECT_EQ(fewer.erase("one").erase("three"), Map());
+  EXPECT_TRUE((PersistentMap<int, int>().erase(1).empty()));
+  PersistentMap<int, int> empty;
+  EXPECT_EQ(empty.begin(), empty.end());
+}
+
+TEST(PersistentMap, UpdatesLeaveOldVersionsAlone) {
+  check_random_updates<PersistentMap<int, int>>(1, 200);
+  check_random_updates<PersistentMap<int, int>>(2, 100000);
+}
+
+TEST(PersistentMap, HandlesCollidingHashes) {
+  check_random_updates<PersistentMap<int, int, FewHashes>>(3, 300);
+
+  PersistentMap<int, int, FewHashes> map;
+  for (int key = 0; key < 100; ++key) {
+    map = std::move(map).set(key, key * 2);
+  }
+  for (int key = 0; key < 100; key += 2) {
+    map = std::move(map).erase(key);
+  }
+  for (int key = 0; key < 100; ++key) {
+    EXPECT_EQ(map.contains(key), key % 2 == 1) << key;
+  }
+  EXPECT_EQ(map.size(), 50u);
+}
+
+TEST(PersistentMap, DoesNotDependOnTheOrderOfUpdates) {
+  PersistentMap<int, int> forward;
+  for (int key = 0; key < 2000; ++key) {
+    forward = std::move(forward).set(key, key);
+  }
+  for (int key = 1; key < 2000; key += 2) {
+    forward = std::move(forward).erase(key);
+  }
+  PersistentMap<int, int> backward;
+  for (int key = 1998; key >= 0; key -= 2) {
+    backward = std::move(backward).set(key, key);
+  }
+  EXPECT_EQ(forward, backward);
+  EXPECT_TRUE(std::equal(forward.begin(), forward.end(), backward.begin(), backward.end()));
+  EXPECT_NE(forward, backward.set(0, 1));
+  EXPECT_NE(forward, backward.erase(0));
+}
+
+TEST(PersistentMap, RvalueUpdatesCopyWhatIsShared) {
+  PersistentMap<int, int> map;
+  for (int key = 0; key < 5000; ++key) {
+    map = std::move(map).set(key, key);
+  }
+  PersistentMap<int, int> copy = map;
+  for (int key = 0; key < 5000; key += 3) {
+    copy = std::move(copy).set(key, -key);
+  }
+  for (int key = 1; key < 5000; key += 3) {
+    copy = std::move(copy).erase(key);
+  }
+  for (int key = 0; key < 5000; ++key) {
+    ASSERT_EQ(map.at(key), key);
+  }
+  EXPECT_EQ(copy.size(), 5000u - 1667);
+
+  PersistentMap<int, int> moved = std::move(map);
+  EXPECT_TRUE(map.empty());  // NOLINT(bugprone-use-after-move)
+  EXPECT_EQ(moved.size(), 5000u);
+}
+
+TEST(PersistentMap, DestroysEntriesWithTheLastVersion) {
+  {
+    PersistentMap<int, Counted, FewHashes> colliding;
+    PersistentMap<int, Counted> spread;
+    for (int key = 0; key < 1000; ++key) {
+      colliding = std::move(colliding).set(key, Counted(key));
+      spread = std::move(spread).set(key, Counted(key));
+    }
+    auto colliding_later = colliding.erase(3).set(4, Counted(-4));
+    auto spread_later = spread.erase(3).set(4, Counted(-4));
+    colliding = {};
+    spread = {};
+    EXPECT_EQ(colliding_later.at(4).value, -4);
+    EXPECT_EQ(spread_later.at(4).value, -4);
+  }
+  EXPECT_EQ(Counted::alive, 0);
+}
+
+}  // namespace
@@ -0,0 +1,140 @@
+#include <benchmark/benchmark.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BTreeMap/btreemap.h"
+#include "List/list.h"
+#include "PoolAllocator/poolallocator.h"
+#include "SmartPointers/smartpointers.h"
+
+namespace {
+
+// Builds a list of state.range(0) elements and drops it, the lifetime of a
+// per-request list. List's own free nodes do not outlive the list, so every
+// node comes from the allocator.
+template <template <typename> typename Alloc>
+void BM_ListBuild(benchmark::State& state) {
+  auto count = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    List<int, Alloc<int>> list;
+    for (int i = 0; i < count; ++i) {
+      list.push_back(i);
+    }
+    benchmark::DoNotOptimize(&list.back());
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * count);
+}
+
+BENCHMARK_TEMPLATE(BM_ListBuild, std::allocator)->Arg(64)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_ListBuild, PoolAllocator)->Arg(64)->Arg(1 << 16);
+
+// Keeps about state.range(0) keys and replaces one per step: erase a random
+// key, insert another. Splits and merges allocate and free 64-byte aligned
+// nodes all along.
+template <template <typename> typename Alloc>
+void BM_BTreeMapChurn(benchmark::State& state) {
+  using Map = BTreeMap<std::uint64_t, std::uint64_t, std::less<std::uint64_t>,
+                       Alloc<std::pair<const std::uint64_t, std::uint64_t>>>;
+  auto count = static_cast<std::uint64_t>(state.range(0));
+  std::mt19937_64 gen(1);
+  Map map;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    map.insert({gen() % (4 * count), i});
+  }
+  for (auto _ : state) {
+    for (int step = 0; step < 1024; ++step) {
+      map.erase(gen() % (4 * count));
+      map.insert({gen() % (4 * count), 0});
+    }
+    benchmark::DoNotOptimize(map.size());
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * 1024);
+}
+
+BENCHMARK_TEMPLATE(BM_BTreeMapChurn, std::allocator)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_BTreeMapChurn, PoolAllocator)->Arg(1 << 16);
+
+struct Session {
+  std::uint64_t id;
+  char payload[40];
+};
+
+// A ring of 4096 live shared objects, one replaced per step.
+template <template <typename> typename Alloc>
+void BM_SharedChurn(benchmark::State& state) {
+  std::vector<SharedPtr<Session>> ring(4096);
+  std::uint64_t next = 0;
+  for (auto _ : state) {
+    for (auto& slot : ring) {
+      slot = allocateShared<Session>(Alloc<Session>(), Session{next++, {}});
+    }
+    benchmark::DoNotOptimize(ring.front().get());
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(ring.size()));
+}
+
+BENCHMARK_TEMPLATE(BM_SharedChurn, std::allocator)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SharedChurn, PoolAllocator)->UseRealTime();
+
+// Allocates 64-byte blocks on this thread and frees them on another, the
+// producer and consumer pattern where blocks never return to their thread.
+template <template <typename> typename Alloc>
+void BM_CrossThreadFree(benchmark::State& state) {
+  struct Block {
+    std::byte bytes[64];
+  };
+  constexpr std::size_t kBatch = 4096;
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::vector<Block*> handed;
+  bool done = false;
+  std::thread consumer([&] {
+    Alloc<Block> alloc;
+    std::unique_lock lock(mutex);
+    while (true) {
+      ready.wait(lock, [&] { return done || !handed.empty(); });
+      if (handed.empty()) {
+        return;
+      }
+      std::vector<Block*> blocks = std::exchange(handed, {});
+      ready.notify_all();
+      lock.unlock();
+      for (Block* block : blocks) {
+        alloc.deallocate(block, 1);
+      }
+      lock.lock();
+    }
+  });
+  Alloc<Block> alloc;
+  for (auto _ : state) {
+    std::vector<Block*> blocks(kBatch);
+    for (Block*& block : blocks) {
+      block = alloc.allocate(1);
+    }
+    std::unique_lock lock(mutex);
+    ready.wait(lock, [&] { return handed.empty(); });
+    handed = std::move(blocks);
+    ready.notify_all();
+  }
+  {
+    std::lock_guard lock(mutex);
+    done = true;
+  }
+  ready.notify_all();
+  consumer.join();
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * kBatch);
+}
+
+BENCHMARK_TEMPLATE(BM_CrossThreadFree, std::allocator)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_CrossThreadFree, PoolAllocator)->UseRealTime();
+
+}  // namespace
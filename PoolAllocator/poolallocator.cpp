@@ -0,0 +1,263 @@
+// The pool behind PoolAllocator.
+//
+// A free block holds two links: the next block of its list, and in the
+// first block of a batch parked in a depot, the next batch. Blocks are 16
+// bytes at least, so both fit. Batches vary in length, since a thread that
+// exits parks its whole list and one that has already exited parks single
+// blocks; taking a batch counts it on the way.
+//
+// The thread cache is trivially destructible, so it can be reached at any
+// point of the thread's life. Its first refill or free registers a
+// thread_local whose destructor parks the lists and marks the cache dead;
+// allocations and frees after that, from destructors that run later, go
+// straight to the depot. The depots live in a pool that is never
+// destroyed, for the same reason.
+//
+// With PORTFOLIO_INSTRUMENT the counters "pool.hit" and "pool.refill" give
+// the hit rate of the thread lists; "pool.flush" counts batches handed
+// back, "pool.slab" slabs taken and "pool.large" requests past the pool.
+
+#include "PoolAllocator/poolallocator.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+#include "Instrument/instrument.h"
+
+namespace pool_detail {
+
+namespace {
+
+constexpr std::size_t kSmallStep = 16;
+constexpr std::size_t kSmallMax = 512;
+constexpr std::size_t kSmallClasses = kSmallMax / kSmallStep;
+constexpr std::size_t kClasses =
+    kSmallClasses + std::bit_width(kMaxPooledBytes) - std::bit_width(kSmallMax);
+constexpr std::size_t kMinSlabBytes = std::size_t{64} << 10;
+// Blocks moved between a thread and a depot at a time: 8 KiB worth, 4 to 64.
+constexpr std::size_t kBatchBytes = std::size_t{8} << 10;
+
+static_assert(kClasses == 38);
+
+constexpr std::size_t size_class(std::size_t bytes) {
+  if (bytes <= kSmallMax) {
+    return (bytes - 1) / kSmallStep;
+  }
+  return kSmallClasses + std::bit_width(bytes - 1) - std::bit_width(kSmallMax);
+}
+
+constexpr std::size_t class_bytes(std::size_t c) {
+  return c < kSmallClasses ? (c + 1) * kSmallStep : kSmallMax << (c - kSmallClasses + 1);
+}
+
+constexpr std::size_t batch_blocks(std::size_t c) {
+  return std::clamp<std::size_t>(kBatchBytes / class_bytes(c), 4, 64);
+}
+
+static_assert(size_class(kMaxPooledBytes) == kClasses - 1);
+static_assert(class_bytes(kClasses - 1) == kMaxPooledBytes);
+static_assert(size_class(kSmallMax + 1) == kSmallClasses && class_bytes(kSmallClasses) == 1024);
+
+struct Node {
+  Node* next;
+  Node* next_batch;
+};
+
+static_assert(sizeof(Node) <= kSmallStep);
+
+// Batches of one class parked by threads, and the slab it carves from.
+struct alignas(64) Depot {
+  std::mutex mutex;
+  Node* batches = nullptr;
+  std::byte* carve = nullptr;
+  std::byte* carve_end = nullptr;
+};
+
+class Pool {
+ public:
+  // A batch of blocks of class c, count set to its length.
+  Node* take(std::size_t c, std::size_t& count) {
+    Depot& depot = depots_[c];
+    std::lock_guard lock(depot.mutex);
+    if (Node* batch = depot.batches) {
+      depot.batches = batch->next_batch;
+      count = 0;
+      for (Node* node = batch; node; node = node->next) {
+        ++count;
+      }
+      return batch;
+    }
+    return carve(depot, c, count);
+  }
+
+  // Parks the list starting at batch.
+  void park(std::size_t c, Node* batch) noexcept {
+    Depot& depot = depots_[c];
+    std::lock_guard lock(depot.mutex);
+    batch->next_batch = depot.batches;
+    depot.batches = batch;
+  }
+
+  std::size_t reserved_bytes() const noexcept {
+    return reserved_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // A batch cut from the depot's slab, starting a new slab if it is used
+  // up. The tail of a slab too short for a batch still gives what it has.
+  Node* carve(Depot& depot, std::size_t c, std::size_t& count) {
+    const std::size_t bytes = class_bytes(c);
+    if (depot.carve == depot.carve_end) {
+      const std::size_t slab = std::max(kMinSlabBytes, bytes * batch_blocks(c));
+      depot.carve = static_cast<std::byte*>(::operator new(slab, std::align_val_t{kMaxAlignment}));
+      depot.carve_end = depot.carve + slab / bytes * bytes;
+      reserved_.fetch_add(slab, std::memory_order_relaxed);
+      PORTFOLIO_COUNT("pool.slab", 1);
+    }
+    count = std::min<std::size_t>(batch_blocks(c),
+                                  static_cast<std::size_t>(depot.carve_end - depot.carve) / bytes);
+    Node* head = nullptr;
+    for (std::size_t i = count; i-- > 0;) {
+      head = ::new (depot.carve + i * bytes) Node{head, nullptr};
+    }
+    depot.carve += count * bytes;
+    return head;
+  }
+
+  std::array<Depot, kClasses> depots_{};
+  std::atomic<std::size_t> reserved_{0};
+};
+
+Pool& pool() {
+  static Pool* const instance = new Pool();
+  return *instance;
+}
+
+struct FreeList {
+  Node* head = nullptr;
+  std::size_t count = 0;
+};
+
+struct ThreadCache {
+  std::array<FreeList, kClasses> lists{};
+  bool registered = false;
+  bool dead = false;
+};
+
+constinit thread_local ThreadCache cache;
+
+struct CacheFlush {
+  CacheFlush() = default;
+  CacheFlush(const CacheFlush&) = delete;
+  CacheFlush& operator=(const CacheFlush&) = delete;
+
+  ~CacheFlush() {
+    for (std::size_t c = 0; c < kClasses; ++c) {
+      if (cache.lists[c].head) {
+        pool().park(c, cache.lists[c].head);
+      }
+      cache.lists[c] = FreeList{};
+    }
+    cache.dead = true;
+  }
+};
+
+thread_local CacheFlush flush;
+
+// A thread that only frees, as a consumer does, has lists to park as well.
+void register_flush() {
+  // Odr-uses flush, which has the thread register its destructor.
+  [[maybe_unused]] CacheFlush* volatile registration = &flush;
+  cache.registered = true;
+}
+
+void* allocate_slow(std::size_t c) {
+  PORTFOLIO_COUNT("pool.refill", 1);
+  if (cache.dead) {
+    std::size_t count = 0;
+    Node* batch = pool().take(c, count);
+    if (Node* rest = batch->next) {
+      pool().park(c, rest);
+    }
+    return batch;
+  }
+  if (!cache.registered) {
+    register_flush();
+  }
+  FreeList& list = cache.lists[c];
+  list.head = pool().take(c, list.count);
+  Node* node = list.head;
+  list.head = node->next;
+  --list.count;
+  return node;
+}
+
+bool pooled(std::size_t bytes, std::size_t alignment) {
+  return alignment <= kMaxAlignment && bytes <= kMaxPooledBytes;
+}
+
+// A zero-byte request still takes a block of its alignment.
+std::size_t round_up(std::size_t bytes, std::size_t alignment) {
+  return (std::max<std::size_t>(bytes, 1) + alignment - 1) & ~(alignment - 1);
+}
+
+}  // namespace
+
+void* allocate(std::size_t bytes, std::size_t alignment) {
+  if (!pooled(round_up(bytes, alignment), alignment)) {
+    PORTFOLIO_COUNT("pool.large", 1);
+    return ::operator new(bytes, std::align_val_t{std::max(alignment, kMinAlignment)});
+  }
+  const std::size_t c = size_class(round_up(bytes, alignment));
+  FreeList& list = cache.lists[c];
+  if (Node* node = list.head) {
+    PORTFOLIO_COUNT("pool.hit", 1);
+    list.head = node->next;
+    --list.count;
+    return node;
+  }
+  return allocate_slow(c);
+}
+
+void deallocate(void* block, std::size_t bytes, std::size_t alignment) noexcept {
+  if (block == nullptr) {
+    return;
+  }
+  if (!pooled(round_up(bytes, alignment), alignment)) {
+    ::operator delete(block, bytes, std::align_val_t{std::max(alignment, kMinAlignment)});
+    return;
+  }
+  const std::size_t c = size_class(round_up(bytes, alignment));
+  if (cache.dead) {
+    pool().park(c, ::new (block) Node{nullptr, nullptr});
+    return;
+  }
+  if (!cache.registered) {
+    register_flush();
+  }
+  FreeList& list = cache.lists[c];
+  list.head = ::new (block) Node{list.head, nullptr};
+  if (++list.count < 2 * batch_blocks(c)) {
+    return;
+  }
+  // Hands the first batch back; the rest stays for the next allocations.
+  Node* last = list.head;
+  for (std::size_t i = 1; i < batch_blocks(c); ++i) {
+    last = last->next;
+  }
+  Node* batch = list.head;
+  list.head = last->next;
+  last->next = nullptr;
+  list.count -= batch_blocks(c);
+  PORTFOLIO_COUNT("pool.flush", 1);
+  pool().park(c, batch);
+}
+
+std::size_t reserved_bytes() noexcept { return pool().reserved_bytes(); }
+
+}  // namespace pool_detail
@@ -0,0 +1,82 @@
+#pragma once
+
+// A process-wide pool of size-classed blocks and an allocator on it.
+//
+// Requests up to 32 KiB are rounded up to one of 38 size classes: steps of
+// 16 bytes up to 512, then powers of two. Each class carves its blocks out
+// of page-aligned slabs of 64 KiB or more, so blocks of a class sit next to
+// each other and a freed block is reused for the same size instead of
+// leaving a hole of the wrong size behind.
+//
+// Every thread keeps a free list per class, used without locks or atomics:
+// allocating pops it and freeing pushes onto it, whichever thread the block
+// came from. When a list runs dry it takes a batch of blocks from the class
+// depot, or from a new stretch of slab; when it grows past two batches it
+// hands one batch back. The depot lock is taken once per batch of up to 64
+// blocks, so blocks freed on other threads than the ones that allocated
+// them, as with a producer and a consumer, flow back in bulk. A thread that
+// exits returns its lists to the depots.
+//
+// Memory never goes back to the system: the pool is for long-lived
+// processes whose peak is also their steady state. Larger requests, and
+// alignments above a page, go to operator new.
+//
+// PoolAllocator<T> is stateless and satisfies the Allocator requirements,
+// so any allocator-aware container runs on the pool:
+//
+//   List<Order, PoolAllocator<Order>> orders;
+//   BTreeMap<std::uint64_t, Order*, std::less<>, PoolAllocator<...>> index;
+//   auto session = allocateShared<Session>(PoolAllocator<Session>(), id);
+//
+// Coroutine frames of Task<T> come from the pool as well.
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+namespace pool_detail {
+
+// Blocks of the pool are aligned to this at least, and requests with up to
+// kMaxAlignment are served from it.
+inline constexpr std::size_t kMinAlignment = 16;
+inline constexpr std::size_t kMaxAlignment = 4096;
+inline constexpr std::size_t kMaxPooledBytes = std::size_t{32} << 10;
+
+// A block of at least bytes bytes aligned to alignment, a power of two.
+// Throws std::bad_alloc.
+void* allocate(std::size_t bytes, std::size_t alignment);
+// Returns a block; bytes and alignment as passed to allocate().
+void deallocate(void* block, std::size_t bytes, std::size_t alignment) noexcept;
+
+// Slab memory the pool has taken from the system so far.
+std::size_t reserved_bytes() noexcept;
+
+}  // namespace pool_detail
+
+template <typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  PoolAllocator() noexcept = default;
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&) noexcept {}  // NOLINT(google-explicit-constructor)
+
+  T* allocate(std::size_t count) {
+    if (count > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(pool_detail::allocate(count * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* pointer, std::size_t count) noexcept {
+    pool_detail::deallocate(pointer, count * sizeof(T), alignof(T));
+  }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>&) const noexcept {
+    return true;
+  }
+};
@@ -0,0 +1,268 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "BTreeMap/btreemap.h"
+#include "Instrument/instrument.h"
+#include "List/list.h"
+#include "PoolAllocator/poolallocator.h"
+#include "SmartPointers/smartpointers.h"
+
+namespace {
+
+bool aligned(const void* block, std::size_t alignment) {
+  return reinterpret_cast<std::uintptr_t>(block) % alignment == 0;
+}
+
+struct Block {
+  void* data;
+  std::size_t bytes;
+  std::size_t alignment;
+  unsigned char fill;
+};
+
+// Allocates blocks of random sizes and alignments, each filled with its own
+// byte, and checks the fills before freeing: blocks must not overlap.
+void churn(std::mt19937& gen, std::vector<Block>& live, int steps) {
+  for (int step = 0; step < steps; ++step) {
+    if (live.empty() || gen() % 2 == 0) {
+      const std::size_t bytes = gen() % 4 == 0 ? gen() % 40000 : gen() % 600;
+      const std::size_t alignment = std::size_t{1} << (gen() % 8 == 0 ? gen() % 14 : 3);
+      void* data = pool_detail::allocate(bytes, alignment);
+      EXPECT_TRUE(aligned(data, std::max(alignment, pool_detail::kMinAlignment)));
+      const auto fill = static_cast<unsigned char>(gen());
+      std::memset(data, fill, bytes);
+      live.push_back({data, bytes, alignment, fill});
+    } else {
+      const std::size_t at = gen() % live.size();
+      Block block = live[at];
+      live[at] = live.back();
+      live.pop_back();
+      const auto* bytes = static_cast<const unsigned char*>(block.data);
+      for (std::size_t i = 0; i < block.bytes; ++i) {
+        ASSERT_EQ(bytes[i], block.fill) << block.bytes << " " << i;
+      }
+      pool_detail::deallocate(block.data, block.bytes, block.alignment);
+    }
+  }
+}
+
+void release(std::vector<Block>& live) {
+  for (const Block& block : live) {
+    pool_detail::deallocate(block.data, block.bytes, block.alignment);
+  }
+  live.clear();
+}
+
+static_assert(std::is_same_v<PoolAllocator<int>::is_always_equal, std::true_type>);
+static_assert(std::is_same_v<std::allocator_traits<PoolAllocator<int>>::rebind_alloc<double>,
+                             PoolAllocator<double>>);
+
+TEST(PoolAllocator, AlignsEveryBlock) {
+  for (std::size_t alignment = 1; alignment <= 8192; alignment *= 2) {
+    for (std::size_t bytes : {0u, 1u, 15u, 16u, 17u, 100u, 512u, 513u, 4096u, 32768u, 40000u}) {
+      void* block = pool_detail::allocate(bytes, alignment);
+      EXPECT_TRUE(aligned(block, std::max(alignment, pool_detail::kMinAlignment)))
+          << bytes << " " << alignment;
+      std::memset(block, 0xab, bytes);
+      pool_detail::deallocate(block, bytes, alignment);
+    }
+  }
+}
+
+TEST(PoolAllocator, ReusesTheLastBlockFreed) {
+  for (std::size_t bytes : {1u, 16u, 48u, 500u, 1000u, 32768u}) {
+    void* first = pool_detail::allocate(bytes, 16);
+    pool_detail::deallocate(first, bytes, 16);
+    void* second = pool_detail::allocate(bytes, 16);
+    EXPECT_EQ(second, first) << bytes;
+    pool_detail::deallocate(second, bytes, 16);
+  }
+  // Sizes of the same class share blocks: 17 and 32 bytes, 513 and 1024.
+  void* small = pool_detail::allocate(17, 16);
+  pool_detail::deallocate(small, 17, 16);
+  void* same_class = pool_detail::allocate(32, 16);
+  EXPECT_EQ(same_class, small);
+  pool_detail::deallocate(same_class, 32, 16);
+  void* medium = pool_detail::allocate(513, 16);
+  pool_detail::deallocate(medium, 513, 16);
+  void* doubled = pool_detail::allocate(1024, 8);
+  EXPECT_EQ(doubled, medium);
+  pool_detail::deallocate(doubled, 1024, 8);
+}
+
+TEST(PoolAllocator, ZeroByteRequestsGetDistinctBlocks) {
+  void* first = pool_detail::allocate(0, 16);
+  void* second = pool_detail::allocate(0, 16);
+  EXPECT_NE(first, nullptr);
+  EXPECT_NE(first, second);
+  pool_detail::deallocate(second, 0, 16);
+  pool_detail::deallocate(first, 0, 16);
+  pool_detail::deallocate(nullptr, 16, 16);
+}
+
+TEST(PoolAllocator, KeepsBlocksApart) {
+  std::mt19937 gen(1);
+  std::vector<Block> live;
+  churn(gen, live, 50000);
+  release(live);
+}
+
+TEST(PoolAllocator, SteadyChurnTakesNoNewSlabs) {
+  std::mt19937 gen(2);
+  std::vector<Block> live;
+  churn(gen, live, 20000);
+  release(live);
+  const std::size_t reserved = pool_detail::reserved_bytes();
+  EXPECT_GT(reserved, 0u);
+  for (int round = 0; round < 5; ++round) {
+    std::mt19937 same(2);
+    churn(same, live, 20000);
+    release(live);
+  }
+  EXPECT_EQ(pool_detail::reserved_bytes(), reserved);
+}
+
+TEST(PoolAllocator, FreesOnOtherThreadsFlowBack) {
+  constexpr int kBlocks = 4096;
+  auto round = [] {
+    std::vector<void*> blocks(kBlocks);
+    for (void*& block : blocks) {
+      block = pool_detail::allocate(64, 16);
+    }
+    std::thread consumer([&blocks] {
+      for (void* block : blocks) {
+        pool_detail::deallocate(block, 64, 16);
+      }
+    });
+    consumer.join();
+  };
+  for (int i = 0; i < 4; ++i) {
+    round();
+  }
+  // Every round frees on a new thread that then exits: without its blocks
+  // coming back, each round would take new slabs.
+  const std::size_t reserved = pool_detail::reserved_bytes();
+  for (int i = 0; i < 50; ++i) {
+    round();
+  }
+  EXPECT_EQ(pool_detail::reserved_bytes(), reserved);
+}
+
+TEST(PoolAllocator, ServesManyThreadsAtOnce) {
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::vector<Block> handed_over;
+  for (unsigned t = 0; t < 8; ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937 gen(t);
+      std::vector<Block> live;
+      churn(gen, live, 20000);
+      // Half of what is left is freed by whichever thread comes next.
+      std::lock_guard lock(mutex);
+      release(handed_over);
+      handed_over.assign(live.begin(), live.begin() + static_cast<std::ptrdiff_t>(live.size() / 2));
+      live.erase(live.begin(), live.begin() + static_cast<std::ptrdiff_t>(live.size() / 2));
+      release(live);
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  release(handed_over);
+}
+
+TEST(PoolAllocator, CountsHitsAndRefills) {
+  if (!kInstrumentEnabled) {
+    GTEST_SKIP() << "built without PORTFOLIO_INSTRUMENT";
+  }
+  const InstrumentSnapshot before = instrument_snapshot();
+  // A new thread starts with empty lists: its first block is a refill, the
+  // rest of the batch are hits, and freeing them all flushes a batch back.
+  std::thread([] {
+    std::vector<void*> blocks(1000);
+    for (void*& block : blocks) {
+      block = pool_detail::allocate(96, 16);
+    }
+    for (void* block : blocks) {
+      pool_detail::deallocate(block, 96, 16);
+    }
+    void* large = pool_detail::allocate(1 << 20, 16);
+    pool_detail::deallocate(large, 1 << 20, 16);
+  }).join();
+  const InstrumentSnapshot after = instrument_snapshot();
+  const auto delta = [&](const char* name) { return after.counter(name) - before.counter(name); };
+  EXPECT_GE(delta("pool.refill"), 1u);
+  EXPECT_EQ(delta("pool.hit") + delta("pool.refill"), 1000u);
+  EXPECT_GT(delta("pool.hit"), delta("pool.refill"));
+  EXPECT_GE(delta("pool.flush"), 1u);
+  EXPECT_EQ(delta("pool.large"), 1u);
+}
+
+TEST(PoolAllocator, AllocatesArraysOfT) {
+  PoolAllocator<std::uint64_t> alloc;
+  std::uint64_t* values = alloc.allocate(1000);
+  for (std::uint64_t i = 0; i < 1000; ++i) {
+    values[i] = i;
+  }
+  EXPECT_EQ(values[999], 999u);
+  alloc.deallocate(values, 1000);
+  EXPECT_THROW(alloc.allocate(std::numeric_limits<std::size_t>::max() / 4),
+               std::bad_array_new_length);
+
+  struct alignas(256) Wide {
+    char bytes[256];
+  };
+  PoolAllocator<Wide> wide(alloc);
+  Wide* block = wide.allocate(3);
+  EXPECT_TRUE(aligned(block, 256));
+  wide.deallocate(block, 3);
+  EXPECT_TRUE(alloc == wide);
+  EXPECT_FALSE(alloc != wide);
+}
+
+TEST(PoolAllocator, BacksTheContainers) {
+  std::vector<int, PoolAllocator<int>> vector;
+  List<int, PoolAllocator<int>> list;
+  for (int i = 0; i < 10000; ++i) {
+    vector.push_back(i);
+    list.push_back(i);
+  }
+  EXPECT_EQ(vector[9999], 9999);
+  EXPECT_EQ(list.size(), 10000u);
+  EXPECT_EQ(list.back(), 9999);
+
+  using Entry = std::pair<const std::uint64_t, std::uint64_t>;
+  BTreeMap<std::uint64_t, std::uint64_t, std::less<std::uint64_t>, PoolAllocator<Entry>> map;
+  for (std::uint64_t key = 0; key < 50000; ++key) {
+    map.try_emplace(key * 7919 % 50000, key);
+  }
+  for (std::uint64_t key = 0; key < 50000; key += 2) {
+    map.erase(key);
+  }
+  EXPECT_EQ(map.size(), 25000u);
+  EXPECT_EQ(map.begin()->first, 1u);
+
+  struct Session {
+    explicit Session(int id) : id(id) {}
+    int id;
+  };
+  SharedPtr<Session> session = allocateShared<Session>(PoolAllocator<Session>(), 42);
+  SharedPtr<Session> copy = session;
+  EXPECT_EQ(copy->id, 42);
+  EXPECT_EQ(session.use_count(), 2);
+}
+
+}  // namespace
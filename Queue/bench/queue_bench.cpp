@@ -0,0 +1,144 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "Queue/queue.h"
+
+namespace {
+
+// The baseline: a std::deque behind a mutex.
+class LockedQueue {
+ public:
+  explicit LockedQueue(std::size_t capacity) : capacity_(capacity) {}
+
+  bool try_push(std::uint64_t value) {
+    std::lock_guard lock(mutex_);
+    if (values_.size() == capacity_) {
+      return false;
+    }
+    values_.push_back(value);
+    return true;
+  }
+
+  bool try_pop(std::uint64_t& out) {
+    std::lock_guard lock(mutex_);
+    if (values_.empty()) {
+      return false;
+    }
+    out = values_.front();
+    values_.pop_front();
+    return true;
+  }
+
+  std::size_t push_n(std::span<std::uint64_t> values) {
+    std::lock_guard lock(mutex_);
+    std::size_t count = std::min(values.size(), capacity_ - values_.size());
+    values_.insert(values_.end(), values.begin(), values.begin() + count);
+    return count;
+  }
+
+  std::size_t pop_n(std::span<std::uint64_t> out) {
+    std::lock_guard lock(mutex_);
+    std::size_t count = std::min(out.size(), values_.size());
+    std::copy_n(values_.begin(), count, out.begin());
+    values_.erase(values_.begin(), values_.begin() + count);
+    return count;
+  }
+
+ private:
+  std::size_t capacity_;
+  std::mutex mutex_;
+  std::deque<std::uint64_t> values_;
+};
+
+constexpr std::size_t kCapacity = 1024;
+constexpr std::size_t kMessages = 1 << 20;
+
+// One thread pushing and popping in turn: the uncontended cost.
+template <typename Queue>
+void BM_PushPop(benchmark::State& state) {
+  Queue queue(kCapacity);
+  std::uint64_t value = 0;
+  for (auto _ : state) {
+    queue.try_push(value);
+    queue.try_pop(value);
+    benchmark::DoNotOptimize(value);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// The same in batches of state.range(0).
+template <typename Queue>
+void BM_PushPopBatch(benchmark::State& state) {
+  Queue queue(kCapacity);
+  std::vector<std::uint64_t> batch(static_cast<std::size_t>(state.range(0)), 1);
+  for (auto _ : state) {
+    queue.push_n(batch);
+    queue.pop_n(batch);
+    benchmark::DoNotOptimize(batch.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// kMessages from a producer thread to the benchmark thread, in batches of
+// state.range(0).
+template <typename Queue>
+void BM_Handoff(benchmark::State& state) {
+  const auto batch_size = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    Queue queue(kCapacity);
+    std::thread producer([&] {
+      std::vector<std::uint64_t> batch(batch_size);
+      for (std::size_t sent = 0; sent < kMessages;) {
+        for (std::size_t i = 0; i < batch_size; ++i) {
+          batch[i] = sent + i;
+        }
+        std::span<std::uint64_t> rest(batch.data(), std::min(batch_size, kMessages - sent));
+        while (!rest.empty()) {
+          std::size_t pushed = queue.push_n(rest);
+          if (pushed == 0) {
+            std::this_thread::yield();
+          }
+          sent += pushed;
+          rest = rest.subspan(pushed);
+        }
+      }
+    });
+    std::vector<std::uint64_t> batch(batch_size);
+    std::uint64_t sum = 0;
+    for (std::size_t received = 0; received < kMessages;) {
+      std::size_t popped = queue.pop_n(batch);
+      if (popped == 0) {
+        std::this_thread::yield();
+      }
+      for (std::size_t i = 0; i < popped; ++i) {
+        sum += batch[i];
+      }
+      received += popped;
+    }
+    producer.join();
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(kMessages));
+}
+
+}  // namespace
+
+BENCHMARK(BM_PushPop<LockedQueue>);
+BENCHMARK(BM_PushPop<MpmcQueue<std::uint64_t>>);
+BENCHMARK(BM_PushPop<SpscRing<std::uint64_t>>);
+BENCHMARK(BM_PushPopBatch<LockedQueue>)->Arg(64);
+BENCHMARK(BM_PushPopBatch<MpmcQueue<std::uint64_t>>)->Arg(64);
+BENCHMARK(BM_PushPopBatch<SpscRing<std::uint64_t>>)->Arg(64);
+BENCHMARK(BM_Handoff<LockedQueue>)->ArgName("batch")->Arg(1)->Arg(64)->UseRealTime()->Unit(
+    benchmark::kMillisecond);
+BENCHMARK(BM_Handoff<MpmcQueue<std::uint64_t>>)->ArgName("batch")->Arg(1)->Arg(64)->UseRealTime()->Unit(
+    benchmark::kMillisecond);
+BENCHMARK(BM_Handoff<SpscRing<std::uint64_t>>)->ArgName("batch")->Arg(1)->Arg(64)->UseRealTime()->Unit(
+    benchmark::kMillisecond);
@@ -0,0 +1,290 @@
+#pragma once
+
+// Bounded lock-free queues for handing values between threads.
+//
+// MpmcQueue is Dmitry Vyukov's array queue: every slot carries a sequence
+// number that says whose turn it is. A producer claims position p with one
+// compare-and-swap on the enqueue index once slot p % capacity shows p, and
+// publishes by setting it to p + 1; a consumer claims from the dequeue
+// index once the slot shows p + 1, and frees it for the next lap by setting
+// p + capacity. Producers and consumers only meet on slots, so neither side
+// takes a lock or waits for the other unless the queue is full or empty.
+// push_n and pop_n claim a run of ready slots with a single
+// compare-and-swap.
+//
+// SpscRing serves exactly one producer and one consumer. Each side owns its
+// index and keeps a possibly stale copy of the other's, on its own cache
+// line, so that it reads the other side's line only when the copy says the
+// ring is full (or empty). A batch costs one index store however many
+// values it moves.
+//
+// Both round the capacity up to a power of two. Values are moved in and
+// out, so they must be nothrow movable: a slot claimed by a move that throws
+// could never be published.
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace queue_detail {
+
+// Assumed rather than std::hardware_destructive_interference_size, whose
+// value GCC warns may differ between compiler flags.
+inline constexpr std::size_t kCacheLine = 64;
+
+inline std::size_t ring_capacity(std::size_t capacity) {
+  if (capacity == 0) {
+    throw std::invalid_argument("Queue: capacity must be positive");
+  }
+  if (capacity > (std::size_t{1} << (std::numeric_limits<std::size_t>::digits - 2))) {
+    throw std::length_error("Queue: capacity too large");
+  }
+  return std::bit_ceil(capacity);
+}
+
+// Uninitialized storage for one T.
+template <typename T>
+struct Storage {
+  T* get() noexcept { return std::launder(reinterpret_cast<T*>(bytes)); }
+
+  alignas(T) std::byte bytes[sizeof(T)];
+};
+
+}  // namespace queue_detail
+
+template <typename T>
+concept QueueElement = std::is_nothrow_move_constructible_v<T> &&
+                       std::is_nothrow_move_assignable_v<T> &&
+                       std::is_nothrow_destructible_v<T>;
+
+template <QueueElement T>
+class MpmcQueue {
+ public:
+  // Holds at least capacity values. Throws std::invalid_argument for 0.
+  explicit MpmcQueue(std::size_t capacity)
+      : mask_(queue_detail::ring_capacity(capacity) - 1),
+        slots_(std::make_unique<Slot[]>(mask_ + 1)) {
+    for (std::size_t i = 0; i <= mask_; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpmcQueue(const MpmcQueue&) = delete;
+  MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+  ~MpmcQueue() {
+    const std::size_t enqueued = enqueue_.load(std::memory_order_relaxed);
+    for (std::size_t i = dequeue_.load(std::memory_order_relaxed); i != enqueued; ++i) {
+      slot(i).value.get()->~T();
+    }
+  }
+
+  std::size_t capacity() const noexcept { return mask_ + 1; }
+
+  // A snapshot: exact only while no other thread pushes or pops.
+  std::size_t size() const noexcept {
+    const std::size_t dequeued = dequeue_.load(std::memory_order_acquire);
+    const std::size_t enqueued = enqueue_.load(std::memory_order_acquire);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+  }
+  bool empty() const noexcept { return size() == 0; }
+
+  // false, leaving value alone, if the queue is full.
+  bool try_push(T&& value) noexcept { return push_n(std::span<T>(&value, 1)) == 1; }
+  bool try_push(const T& value) requires std::copy_constructible<T> {
+    T copy(value);
+    return try_push(std::move(copy));
+  }
+
+  // false, leaving out alone, if the queue is empty.
+  bool try_pop(T& out) noexcept { return pop_n(std::span<T>(&out, 1)) == 1; }
+
+  // Moves from the longest prefix of values that fits in one claim and
+  // returns its length, 0 if the queue is full. The prefix stays together:
+  // no other producer's values come between them.
+  std::size_t push_n(std::span<T> values) noexcept {
+    if (values.empty()) {
+      return 0;
+    }
+    std::size_t position = enqueue_.load(std::memory_order_relaxed);
+    std::size_t count = 0;
+    while (true) {
+      count = ready(position, values.size(), 0);
+      if (count != 0) {
+        if (enqueue_.compare_exchange_weak(position, position + count,
+                                           std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (behind(slot(position).sequence.load(std::memory_order_acquire), position)) {
+        return 0;  // Still holding last lap's value: full.
+      } else {
+        position = enqueue_.load(std::memory_order_relaxed);
+      }
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      Slot& target = slot(position + i);
+      ::new (static_cast<void*>(target.value.get())) T(std::move(values[i]));
+      target.sequence.store(position + i + 1, std::memory_order_release);
+    }
+    return count;
+  }
+
+  // Moves up to out.size() values into out, oldest first, and returns how
+  // many; 0 if the queue is empty.
+  std::size_t pop_n(std::span<T> out) noexcept {
+    if (out.empty()) {
+      return 0;
+    }
+    std::size_t position = dequeue_.load(std::memory_order_relaxed);
+    std::size_t count = 0;
+    while (true) {
+      count = ready(position, out.size(), 1);
+      if (count != 0) {
+        if (dequeue_.compare_exchange_weak(position, position + count,
+                                           std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (behind(slot(position).sequence.load(std::memory_order_acquire), position + 1)) {
+        return 0;  // Not yet published: empty.
+      } else {
+        position = dequeue_.load(std::memory_order_relaxed);
+      }
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      Slot& source = slot(position + i);
+      T* value = source.value.get();
+      out[i] = std::move(*value);
+      value->~T();
+      source.sequence.store(position + i + capacity(), std::memory_order_release);
+    }
+    return count;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    queue_detail::Storage<T> value;
+  };
+
+  Slot& slot(std::size_t position) const noexcept { return slots_[position & mask_]; }
+
+  // Whether sequence comes before turn, allowing for wrap-around.
+  static bool behind(std::size_t sequence, std::size_t turn) noexcept {
+    return static_cast<std::ptrdiff_t>(sequence - turn) < 0;
+  }
+
+  // How many of the up to limit slots from position show position + shift
+  // onwards, the turn of whoever claims them. A slot showing its turn keeps
+  // it until the index moves past it, which a successful claim guards.
+  std::size_t ready(std::size_t position, std::size_t limit, std::size_t shift) const noexcept {
+    limit = std::min(limit, capacity());
+    std::size_t count = 0;
+    while (count < limit &&
+           slot(position + count).sequence.load(std::memory_order_acquire) ==
+               position + count + shift) {
+      ++count;
+    }
+    return count;
+  }
+
+  const std::size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  alignas(queue_detail::kCacheLine) std::atomic<std::size_t> enqueue_{0};
+  alignas(queue_detail::kCacheLine) std::atomic<std::size_t> dequeue_{0};
+};
+
+template <QueueElement T>
+class SpscRing {
+ public:
+  // Holds at least capacity values. Throws std::invalid_argument for 0.
+  explicit SpscRing(std::size_t capacity)
+      : mask_(queue_detail::ring_capacity(capacity) - 1),
+        slots_(std::make_unique<queue_detail::Storage<T>[]>(mask_ + 1)) {}
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  ~SpscRing() {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    for (std::size_t i = head_.load(std::memory_order_relaxed); i != tail; ++i) {
+      slot(i)->~T();
+    }
+  }
+
+  std::size_t capacity() const noexcept { return mask_ + 1; }
+
+  // A snapshot, exact on the producer's or the consumer's thread up to what
+  // the other side has done since.
+  std::size_t size() const noexcept {
+    const std::size_t head = head_.load(std::memory_order_acquire);
+    return tail_.load(std::memory_order_acquire) - head;
+  }
+  bool empty() const noexcept { return size() == 0; }
+
+  // Producer only. false, leaving value alone, if the ring is full.
+  bool try_push(T&& value) noexcept { return push_n(std::span<T>(&value, 1)) == 1; }
+  bool try_push(const T& value) requires std::copy_constructible<T> {
+    T copy(value);
+    return try_push(std::move(copy));
+  }
+
+  // Consumer only. false, leaving out alone, if the ring is empty.
+  bool try_pop(T& out) noexcept { return pop_n(std::span<T>(&out, 1)) == 1; }
+
+  // Producer only. Moves from the longest prefix of values that fits and
+  // returns its length.
+  std::size_t push_n(std::span<T> values) noexcept {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (values.size() > capacity() - (tail - head_cache_)) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+    }
+    const std::size_t count = std::min(values.size(), capacity() - (tail - head_cache_));
+    for (std::size_t i = 0; i < count; ++i) {
+      ::new (static_cast<void*>(slot(tail + i))) T(std::move(values[i]));
+    }
+    if (count != 0) {
+      tail_.store(tail + count, std::memory_order_release);
+    }
+    return count;
+  }
+
+  // Consumer only. Moves up to out.size() values into out, oldest first,
+  // and returns how many.
+  std::size_t pop_n(std::span<T> out) noexcept {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (out.size() > tail_cache_ - head) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+    }
+    const std::size_t count = std::min(out.size(), tail_cache_ - head);
+    for (std::size_t i = 0; i < count; ++i) {
+      T* value = slot(head + i);
+      out[i] = std::move(*value);
+      value->~T();
+    }
+    if (count != 0) {
+      head_.store(head + count, std::memory_order_release);
+    }
+    return count;
+  }
+
+ private:
+  T* slot(std::size_t position) const noexcept { return slots_[position & mask_].get(); }
+
+  const std::size_t mask_;
+  std::unique_ptr<queue_detail::Storage<T>[]> slots_;
+  // The consumer's line: the index it owns and its copy of the producer's.
+  alignas(queue_detail::kCacheLine) std::atomic<std::size_t> head_{0};
+  std::size_t tail_cache_ = 0;
+  // The producer's line.
+  alignas(queue_detail::kCacheLine) std::atomic<std::size_t> tail_{0};
+  std::size_t head_cache_ = 0;
+};
@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "Queue/queue.h"
+
+namespace {
+
+struct ThrowingMove {
+  ThrowingMove(ThrowingMove&&) {}
+  ThrowingMove& operator=(ThrowingMove&&) noexcept { return *this; }
+};
+
+static_assert(QueueElement<std::unique_ptr<int>>);
+static_assert(!QueueElement<ThrowingMove>);
+static_assert(alignof(MpmcQueue<int>) == queue_detail::kCacheLine);
+static_assert(alignof(SpscRing<int>) == queue_detail::kCacheLine);
+
+template <typename Queue>
+class Queues : public testing::Test {};
+
+using QueueTypes = testing::Types<MpmcQueue<std::unique_ptr<int>>, SpscRing<std::unique_ptr<int>>>;
+TYPED_TEST_SUITE(Queues, QueueTypes);
+
+TYPED_TEST(Queues, RoundsTheCapacityUp) {
+  EXPECT_EQ(TypeParam(1).capacity(), 1u);
+  EXPECT_EQ(TypeParam(5).capacity(), 8u);
+  EXPECT_EQ(TypeParam(64).capacity(), 64u);
+  EXPECT_THROW(TypeParam(0), std::invalid_argument);
+  EXPECT_THROW(TypeParam(std::numeric_limits<std::size_t>::max()), std::length_error);
+}
+
+TYPED_TEST(Queues, FirstInFirstOut) {
+  TypeParam queue(4);
+  std::unique_ptr<int> out;
+  EXPECT_FALSE(queue.try_pop(out));
+  for (int lap = 0; lap < 10; ++lap) {
+    for (int i = 0; i < 4; ++i) {
+      ASSERT_TRUE(queue.try_push(std::make_unique<int>(lap * 4 + i)));
+    }
+    EXPECT_EQ(queue.size(), 4u);
+    auto rejected = std::make_unique<int>(-1);
+    EXPECT_FALSE(queue.try_push(std::move(rejected)));
+    ASSERT_NE(rejected, nullptr);
+    for (int i = 0; i < 4; ++i) {
+      ASSERT_TRUE(queue.try_pop(out));
+      EXPECT_EQ(*out, lap * 4 + i);
+    }
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.try_pop(out));
+  }
+}
+
+TYPED_TEST(Queues, BatchesTakeWhatFits) {
+  TypeParam queue(8);
+  std::vector<std::unique_ptr<int>> values;
+  for (int i = 0; i < 14; ++i) {
+    values.push_back(std::make_unique<int>(i));
+  }
+  EXPECT_EQ(queue.push_n(std::span(values).first(5)), 5u);
+  EXPECT_EQ(queue.push_n(std::span(values).subspan(5)), 3u);
+  EXPECT_EQ(values[7], nullptr);
+  ASSERT_NE(values[8], nullptr);
+  EXPECT_EQ(queue.push_n(std::span(values).subspan(8)), 0u);
+  EXPECT_EQ(queue.push_n({}), 0u);
+
+  std::vector<std::unique_ptr<int>> out(10);
+  EXPECT_EQ(queue.pop_n(std::span(out).first(3)), 3u);
+  EXPECT_EQ(queue.push_n(std::span(values).subspan(8)), 3u);
+  EXPECT_EQ(queue.pop_n(out), 8u);
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_EQ(*out[i], i + 3);
+  }
+  EXPECT_EQ(queue.pop_n(out), 0u);
+}
+
+TEST(Queue, DestroysWhatIsLeft) {
+  auto shared = std::make_shared<int>(1);
+  {
+    MpmcQueue<std::shared_ptr<int>> mpmc(8);
+    SpscRing<std::shared_ptr<int>> spsc(8);
+    for (int i = 0; i < 5; ++i) {
+      mpmc.try_push(shared);
+      spsc.try_push(shared);
+    }
+    std::shared_ptr<int> out;
+    mpmc.try_pop(out);
+    spsc.try_pop(out);
+    EXPECT_EQ(shared.use_count(), 10);
+  }
+  EXPECT_EQ(shared.use_count(), 1);
+}
+
+// Values are producer * kPerProducer + sequence. Every value arrives once,
+// and each consumer sees each producer's values in order.
+TEST(MpmcQueue, ManyProducersAndConsumers) {
+  constexpr std::size_t kProducers = 4;
+  constexpr std::size_t kConsumers = 4;
+  constexpr std::size_t kPerProducer = 50000;
+  MpmcQueue<std::size_t> queue(64);
+  std::vector<std::vector<std::size_t>> received(kConsumers);
+  std::atomic<std::size_t> remaining{kProducers * kPerProducer};
+  std::vector<std::thread> threads;
+  for (std::size_t p = 0; p < kProducers; ++p) {
+    threads.emplace_back([&, p] {
+      std::vector<std::size_t> batch;
+      for (std::size_t next = 0; next < kPerProducer;) {
+        batch.clear();
+        for (std::size_t i = next; i < std::min(kPerProducer, next + 1 + next % 7); ++i) {
+          batch.push_back(p * kPerProducer + i);
+        }
+        std::size_t pushed = queue.push_n(batch);
+        if (pushed == 0) {
+          std::this_thread::yield();
+        }
+        next += pushed;
+      }
+    });
+  }
+  for (std::size_t c = 0; c < kConsumers; ++c) {
+    threads.emplace_back([&, c] {
+      std::vector<std::size_t> out(1 + c * 3);
+      while (remaining.load(std::memory_order_relaxed) != 0) {
+        std::size_t popped = queue.pop_n(out);
+        if (popped == 0) {
+          std::this_thread::yield();
+        }
+        received[c].insert(received[c].end(), out.begin(), out.begin() + popped);
+        remaining.fetch_sub(popped, std::memory_order_relaxed);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<std::size_t> all;
+  for (const auto& values : received) {
+    std::vector<std::size_t> last(kProducers, 0);
+    std::vector<bool> seen(kProducers, false);
+    for (std::size_t value : values) {
+      const std::size_t producer = value / kPerProducer;
+      ASSERT_TRUE(!seen[producer] || last[producer] < value);
+      seen[producer] = true;
+      last[producer] = value;
+    }
+    all.insert(all.end(), values.begin(), values.end());
+  }
+  std::sort(all.begin(), all.end());
+  std::vector<std::size_t> expected(kProducers * kPerProducer);
+  std::iota(expected.begin(), expected.end(), 0);
+  EXPECT_EQ(all, expected);
+}
+
+TEST(SpscRing, HandsOverInOrder) {
+  constexpr std::uint64_t kCount = 1000000;
+  SpscRing<std::uint64_t> ring(256);
+  std::thread producer([&] {
+    std::vector<std::uint64_t> batch;
+    for (std::uint64_t next = 0; next < kCount;) {
+      batch.clear();
+      for (std::uint64_t i = next; i < std::min(kCount, next + 1 + next % 61); ++i) {
+        batch.push_back(i);
+      }
+      std::size_t pushed = ring.push_n(batch);
+      if (pushed == 0) {
+        std::this_thread::yield();
+      }
+      next += pushed;
+    }
+  });
+  std::vector<std::uint64_t> out(100);
+  std::uint64_t expected = 0;
+  bool in_order = true;
+  while (expected < kCount) {
+    std::size_t popped = ring.pop_n(std::span(out).first(1 + expected % 100));
+    if (popped == 0) {
+      std::this_thread::yield();
+    }
+    for (std::size_t i = 0; i < popped; ++i) {
+      in_order = in_order && out[i] == expected++;
+    }
+  }
+  producer.join();
+  EXPECT_TRUE(in_order);
+  EXPECT_TRUE(ring.empty());
+}
+
+}  // namespace
@@ -0,0 +1,176 @@
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Serialize/serialize.h"
+
+namespace {
+
+constexpr std::size_t kElements = std::size_t{1} << 22;
+
+const char* scratch_path() {
+  static const std::string path = [] {
+    char name[] = "/tmp/serialize_benchXXXXXX";
+    close(mkstemp(name));
+    std::atexit([] { std::remove(path.c_str()); });
+    return std::string(name);
+  }();
+  return path.c_str();
+}
+
+const Deque<double>& doubles() {
+  static const Deque<double> values = [] {
+    Deque<double> result;
+    std::mt19937_64 random(1);
+    std::uniform_real_distribution<double> uniform(-1e6, 1e6);
+    for (std::size_t i = 0; i < kElements; ++i) {
+      result.push_back(uniform(random));
+    }
+    return result;
+  }();
+  return values;
+}
+
+const UnorderedMap<std::uint64_t, std::uint64_t>& counts() {
+  static const UnorderedMap<std::uint64_t, std::uint64_t> values = [] {
+    UnorderedMap<std::uint64_t, std::uint64_t> result;
+    std::mt19937_64 random(2);
+    for (std::size_t i = 0; i < kElements / 4; ++i) {
+      result[random()] = i;
+    }
+    return result;
+  }();
+  return values;
+}
+
+void set_bytes(benchmark::State& state) {
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<std::int64_t>(kElements * sizeof(double)));
+}
+
+// Full precision text, one value per line: what the binary dump replaces.
+void BM_DequeTextWrite(benchmark::State& state) {
+  for (auto _ : state) {
+    std::ofstream out(scratch_path());
+    out.precision(std::numeric_limits<double>::max_digits10);
+    for (double value : doubles()) {
+      out << value << '\n';
+    }
+  }
+  set_bytes(state);
+}
+
+void BM_DequeTextRead(benchmark::State& state) {
+  {
+    std::ofstream out(scratch_path());
+    out.precision(std::numeric_limits<double>::max_digits10);
+    for (double value : doubles()) {
+      out << value << '\n';
+    }
+  }
+  for (auto _ : state) {
+    std::ifstream in(scratch_path());
+    Deque<double> values;
+    for (double value; in >> value;) {
+      values.push_back(value);
+    }
+    benchmark::DoNotOptimize(values.size());
+  }
+  set_bytes(state);
+}
+
+void BM_DequeBinaryWrite(benchmark::State& state) {
+  for (auto _ : state) {
+    BinaryWriter out(scratch_path());
+    serialize(out, doubles());
+    out.close();
+  }
+  set_bytes(state);
+}
+
+void BM_DequeBinaryRead(benchmark::State& state) {
+  {
+    BinaryWriter out(scratch_path());
+    serialize(out, doubles());
+    out.close();
+  }
+  for (auto _ : state) {
+    MappedFile file(scratch_path());
+    BinaryReader in(file);
+    Deque<double> values;
+    deserialize(in, values);
+    benchmark::DoNotOptimize(values.size());
+  }
+  set_bytes(state);
+}
+
+void BM_MapBinaryRoundTrip(benchmark::State& state) {
+  for (auto _ : state) {
+    {
+      BinaryWriter out(scratch_path());
+      serialize(out, counts());
+      out.close();
+    }
+    MappedFile file(scratch_path());
+    BinaryReader in(file);
+    UnorderedMap<std::uint64_t, std::uint64_t> values;
+    deserialize(in, values);
+    benchmark::DoNotOptimize(values.size());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(counts().size()));
+}
+
+// A BigInteger of state.range(0) limbs, as decimal text or in binary.
+template <bool Binary>
+void BM_BigIntegerRoundTrip(benchmark::State& state) {
+  std::mt19937 random(3);
+  std::vector<BigInteger::Limb> limbs(static_cast<std::size_t>(state.range(0)));
+  for (auto& limb : limbs) {
+    limb = random();
+  }
+  const BigInteger value = BigInteger::from_limbs(limbs, true);
+  for (auto _ : state) {
+    BigInteger copy;
+    if constexpr (Binary) {
+      {
+        BinaryWriter out(scratch_path());
+        serialize(out, value);
+        out.close();
+      }
+      MappedFile file(scratch_path());
+      BinaryReader in(file);
+      deserialize(in, copy);
+    } else {
+      copy = BigInteger(value.to_string());
+    }
+    benchmark::DoNotOptimize(copy.limb_count());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0) *
+                          static_cast<std::int64_t>(sizeof(BigInteger::Limb)));
+}
+
+}  // namespace
+
+BENCHMARK(BM_DequeTextWrite)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DequeTextRead)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DequeBinaryWrite)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DequeBinaryRead)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MapBinaryRoundTrip)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BigIntegerRoundTrip<false>)
+    ->Name("BM_BigIntegerRoundTrip/text")
+    ->Arg(1 << 14)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BigIntegerRoundTrip<true>)
+    ->Name("BM_BigIntegerRoundTrip/binary")
+    ->Arg(1 << 14)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,161 @@
+// BinaryWriter buffers up to a megabyte and hands anything larger straight
+// to write(), so a big array goes from the object to the file without an
+// extra copy. BinaryReader only moves an offset over its input.
+
+#include "Serialize/binary.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace {
+
+[[noreturn]] void fail(const char* what) {
+  throw std::system_error(errno, std::system_category(), what);
+}
+
+[[noreturn]] void malformed(const char* what) {
+  throw std::invalid_argument(what);
+}
+
+void write_all(int fd, const std::byte* data, std::size_t size) {
+  while (size != 0) {
+    const ssize_t written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fail("BinaryWriter: write");
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+}
+
+}  // namespace
+
+BinaryWriter::BinaryWriter(const char* path)
+    : buffer_(std::make_unique_for_overwrite<std::byte[]>(kBufferSize)) {
+  fd_ = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    fail("BinaryWriter: open");
+  }
+  write_bytes(binary_detail::kMagic, sizeof(binary_detail::kMagic));
+  write(binary_detail::kVersion);
+}
+
+BinaryWriter::~BinaryWriter() {
+  if (fd_ >= 0) {
+    try {
+      flush();
+    } catch (const std::system_error&) {
+      // Errors are only reported by close().
+    }
+    ::close(fd_);
+  }
+}
+
+void BinaryWriter::close() {
+  if (fd_ < 0) {
+    return;
+  }
+  // If the flush throws, the destructor still closes the file.
+  flush();
+  const int fd = std::exchange(fd_, -1);
+  if (::close(fd) != 0) {
+    fail("BinaryWriter: close");
+  }
+}
+
+void BinaryWriter::write_bytes(const void* data, std::size_t size) {
+  if (fd_ < 0) {
+    throw std::logic_error("BinaryWriter: write after close");
+  }
+  if (size == 0) {
+    return;
+  }
+  const auto* bytes = static_cast<const std::byte*>(data);
+  offset_ += size;
+  if (size <= kBufferSize - buffered_) {
+    std::memcpy(buffer_.get() + buffered_, bytes, size);
+    buffered_ += size;
+    return;
+  }
+  flush();
+  if (size >= kBufferSize) {
+    write_all(fd_, bytes, size);
+  } else {
+    std::memcpy(buffer_.get(), bytes, size);
+    buffered_ = size;
+  }
+}
+
+void BinaryWriter::pad(std::size_t alignment) {
+  static constexpr std::byte kZeros[binary_detail::kMaxAlignment] = {};
+  const std::size_t misalignment = offset_ % alignment;
+  if (misalignment != 0) {
+    write_bytes(kZeros, alignment - misalignment);
+  }
+}
+
+void BinaryWriter::flush() {
+  const std::size_t size = buffered_;
+  buffered_ = 0;
+  write_all(fd_, buffer_.get(), size);
+}
+
+BinaryReader::BinaryReader(std::span<const std::byte> bytes) : bytes_(bytes) {
+  if (reinterpret_cast<std::uintptr_t>(bytes.data()) % binary_detail::kMaxAlignment != 0) {
+    throw std::invalid_argument("BinaryReader: input must be aligned to 16 bytes");
+  }
+  const std::byte* magic = take(sizeof(binary_detail::kMagic), 1);
+  if (std::memcmp(magic, binary_detail::kMagic, sizeof(binary_detail::kMagic)) != 0) {
+    malformed("BinaryReader: not a binary checkpoint");
+  }
+  const auto version = read<std::uint32_t>();
+  if (version == 0) {
+    malformed("BinaryReader: no format version 0");
+  }
+  if (version > binary_detail::kVersion) {
+    malformed("BinaryReader: format version is newer than this build");
+  }
+}
+
+std::size_t BinaryReader::read_size() {
+  const auto size = read<std::uint64_t>();
+  if (size > remaining()) {
+    // No size can exceed what is left, whatever it counts.
+    malformed("BinaryReader: truncated input");
+  }
+  return static_cast<std::size_t>(size);
+}
+
+void BinaryReader::expect_tag(BinaryTag tag) {
+  if (read<BinaryTag>() != tag) {
+    malformed("BinaryReader: unexpected value type");
+  }
+}
+
+const std::byte* BinaryReader::take(std::size_t size, std::size_t alignment) {
+  const std::size_t start = (offset_ + alignment - 1) / alignment * alignment;
+  if (start > bytes_.size() || size > bytes_.size() - start) {
+    malformed("BinaryReader: truncated input");
+  }
+  offset_ = start + size;
+  return bytes_.data() + start;
+}
+
+void BinaryReader::check_count(std::size_t count, std::size_t element_size) const {
+  if (count > remaining() / element_size) {
+    malformed("BinaryReader: truncated input");
+  }
+}
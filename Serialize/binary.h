@@ -0,0 +1,237 @@
+#pragma once
+
+// A compact, versioned binary format for checkpoints.
+//
+// A file starts with the magic bytes "PBIN" and a 32-bit format version,
+// followed by the values in the order they were written; nothing but the
+// reader's expectations says what comes next. Integers are little-endian
+// and every value of a trivially copyable type is stored as its object
+// representation, padded to its alignment from the start of the file. So
+// an array of them is one memcpy each way, and a reader over a MappedFile
+// can hand it out as a std::span into the mapping without copying at all.
+// Strings are a 64-bit length and the bytes; sizes and counts are 64 bits.
+//
+// Types that own memory or have invariants specialize BinaryFormat<T> with
+// static write(BinaryWriter&, const T&) and read(BinaryReader&, T&); see
+// serialize.h for BigInteger, Matrix, Deque and UnorderedMap. serialize()
+// and deserialize() use the specialization if there is one and the object
+// representation otherwise, which is only portable between builds that lay
+// the type out alike.
+//
+// Only little-endian hosts are supported. Readers throw
+// std::invalid_argument on input that is truncated, has the wrong magic, a
+// version of 0 or a newer one, or does not hold what was asked for; writers
+// throw std::system_error when the file cannot be written.
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "MappedFile/mappedfile.h"
+#include "String/string.h"
+
+static_assert(std::endian::native == std::endian::little,
+              "the binary format is only implemented for little-endian hosts");
+
+namespace binary_detail {
+
+inline constexpr char kMagic[4] = {'P', 'B', 'I', 'N'};
+inline constexpr std::uint32_t kVersion = 1;
+// Padding never exceeds this, so any buffer aligned to it reads in place.
+inline constexpr std::size_t kMaxAlignment = 16;
+
+}  // namespace binary_detail
+
+// Identifies the value that follows, written by the BinaryFormat of
+// composite types so that reading the wrong type fails instead of
+// misinterpreting the bytes.
+enum class BinaryTag : std::uint32_t {
+  BigInteger = 1,
+  Matrix = 2,
+  Deque = 3,
+  UnorderedMap = 4,
+};
+
+class BinaryWriter;
+class BinaryReader;
+
+template <typename T>
+struct BinaryFormat {};
+
+template <typename T>
+concept HasBinaryFormat = requires(BinaryWriter& writer, BinaryReader& reader, const T& in,
+                                   T& out) {
+  BinaryFormat<T>::write(writer, in);
+  BinaryFormat<T>::read(reader, out);
+};
+
+// Stored as the object representation, arrays of it in one piece.
+template <typename T>
+concept BulkSerializable = !HasBinaryFormat<T> && std::is_trivially_copyable_v<T> &&
+                           alignof(T) <= binary_detail::kMaxAlignment;
+
+template <typename T>
+concept Serializable = HasBinaryFormat<T> || BulkSerializable<T>;
+
+class BinaryWriter {
+ public:
+  // Creates or truncates the file and writes the header.
+  explicit BinaryWriter(const char* path);
+
+  BinaryWriter(const BinaryWriter&) = delete;
+  BinaryWriter& operator=(const BinaryWriter&) = delete;
+
+  // Flushes and closes the file if close() was not called, ignoring errors.
+  ~BinaryWriter();
+
+  // Flushes and closes the file; only then have all writes succeeded.
+  // Writing afterwards throws std::logic_error.
+  void close();
+
+  // Bytes written so far, including the header.
+  std::uint64_t offset() const noexcept { return offset_; }
+
+  template <BulkSerializable T>
+  void write(const T& value) {
+    write_array(std::span<const T>(&value, 1));
+  }
+
+  template <Serializable T>
+  void write_array(std::span<const T> values) {
+    if constexpr (BulkSerializable<T>) {
+      pad(alignof(T));
+      write_bytes(values.data(), values.size_bytes());
+    } else {
+      for (const T& value : values) {
+        BinaryFormat<T>::write(*this, value);
+      }
+    }
+  }
+
+  void write_size(std::size_t size) { write(static_cast<std::uint64_t>(size)); }
+  void write_tag(BinaryTag tag) { write(tag); }
+
+  void write_string(StringView text) {
+    write_size(text.size());
+    write_bytes(text.data(), text.size());
+  }
+
+  void write_bytes(const void* data, std::size_t size);
+
+ private:
+  static constexpr std::size_t kBufferSize = std::size_t{1} << 20;
+
+  // Zero bytes up to the next multiple of alignment.
+  void pad(std::size_t alignment);
+  void flush();
+
+  int fd_ = -1;
+  std::unique_ptr<std::byte[]> buffer_;
+  std::size_t buffered_ = 0;
+  std::uint64_t offset_ = 0;
+};
+
+class BinaryReader {
+ public:
+  // Reads from bytes, which must outlive the reader and everything viewed
+  // through it, and start at a multiple of 16 like a MappedFile's do.
+  // Checks that and the header.
+  explicit BinaryReader(std::span<const std::byte> bytes);
+  explicit BinaryReader(const MappedFile& file)
+      : BinaryReader(std::as_bytes(std::span(file.data(), file.size()))) {}
+  // The mapping would go away with the temporary.
+  BinaryReader(MappedFile&&) = delete;
+
+  std::size_t offset() const noexcept { return offset_; }
+  std::size_t remaining() const noexcept { return bytes_.size() - offset_; }
+  bool at_end() const noexcept { return offset_ == bytes_.size(); }
+
+  template <BulkSerializable T>
+  T read() {
+    T value;
+    read_array(std::span<T>(&value, 1));
+    return value;
+  }
+
+  template <Serializable T>
+  void read_array(std::span<T> values) {
+    if constexpr (BulkSerializable<T>) {
+      const std::byte* data = take(values.size_bytes(), alignof(T));
+      if (!values.empty()) {
+        std::memcpy(static_cast<void*>(values.data()), data, values.size_bytes());
+      }
+    } else {
+      for (T& value : values) {
+        BinaryFormat<T>::read(*this, value);
+      }
+    }
+  }
+
+  // The next count values in place, without copying.
+  template <BulkSerializable T>
+  std::span<const T> view(std::size_t count) {
+    check_count(count, sizeof(T));
+    return {reinterpret_cast<const T*>(take(count * sizeof(T), alignof(T))), count};
+  }
+
+  // A size or count written by write_size. Throws std::invalid_argument if
+  // fewer than that many values of T could follow, before anything is
+  // allocated for them.
+  template <Serializable T>
+  std::size_t read_count() {
+    const std::size_t count = read_size();
+    check_count(count, BulkSerializable<T> ? sizeof(T) : 1);
+    return count;
+  }
+
+  std::size_t read_size();
+  // Throws std::invalid_argument unless the next tag is the expected one.
+  void expect_tag(BinaryTag tag);
+
+  // The string in place, without copying.
+  StringView read_string() {
+    const std::size_t size = read_count<char>();
+    return {reinterpret_cast<const char*>(take(size, 1)), size};
+  }
+
+ private:
+  // Skips padding to alignment and returns the next size bytes.
+  const std::byte* take(std::size_t size, std::size_t alignment);
+  void check_count(std::size_t count, std::size_t element_size) const;
+
+  std::span<const std::byte> bytes_;
+  std::size_t offset_ = 0;
+};
+
+template <Serializable T>
+void serialize(BinaryWriter& writer, const T& value) {
+  writer.write_array(std::span<const T>(&value, 1));
+}
+
+template <Serializable T>
+void deserialize(BinaryReader& reader, T& value) {
+  reader.read_array(std::span<T>(&value, 1));
+}
+
+template <>
+struct BinaryFormat<String> {
+  static void write(BinaryWriter& writer, const String& value) { writer.write_string(value); }
+  static void read(BinaryReader& reader, String& value) { value = String(reader.read_string()); }
+};
+
+template <>
+struct BinaryFormat<std::string> {
+  static void write(BinaryWriter& writer, const std::string& value) {
+    writer.write_string(StringView(value.data(), value.size()));
+  }
+  static void read(BinaryReader& reader, std::string& value) {
+    StringView text = reader.read_string();
+    value.assign(text.data(), text.size());
+  }
+};
@@ -0,0 +1,24 @@
+// The BigInteger format: the limbs are copied straight out of the input
+// into the new magnitude, so reading costs one memcpy on top of whatever
+// the file read does.
+
+#include "Serialize/serialize.h"
+
+#include <cstdint>
+
+void BinaryFormat<BigInteger>::write(BinaryWriter& writer, const BigInteger& value) {
+  writer.write_tag(BinaryTag::BigInteger);
+  writer.write(static_cast<std::uint32_t>(value.is_negative()));
+  writer.write_size(value.limb_count());
+  writer.write_array(value.limbs());
+}
+
+void BinaryFormat<BigInteger>::read(BinaryReader& reader, BigInteger& value) {
+  reader.expect_tag(BinaryTag::BigInteger);
+  const auto negative = reader.read<std::uint32_t>();
+  if (negative > 1) {
+    throw std::invalid_argument("BinaryReader: malformed BigInteger sign");
+  }
+  const std::size_t count = reader.read_count<BigInteger::Limb>();
+  value = BigInteger::from_limbs(reader.view<BigInteger::Limb>(count), negative == 1);
+}
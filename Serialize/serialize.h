@@ -0,0 +1,100 @@
+#pragma once
+
+// Binary formats of BigInteger, Matrix, Deque and UnorderedMap.
+//
+// Each value starts with its BinaryTag. A BigInteger is then its sign as a
+// 32-bit 0 or 1, its limb count and the limbs, least significant first. A
+// Matrix stores rows and columns, checked against the type when read, and
+// its elements row by row. A Deque stores its size and elements, an
+// UnorderedMap its size and the key-value pairs in iteration order.
+// Elements that are BulkSerializable go in and out with one memcpy per
+// contiguous run: the whole matrix, each block of the deque.
+//
+//   BinaryWriter out("state.bin");
+//   serialize(out, counts);   // UnorderedMap<std::string, BigInteger>
+//   out.close();
+//
+//   MappedFile file("state.bin");
+//   BinaryReader in(file);
+//   deserialize(in, counts);
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+#include "BigInteger/biginteger.h"
+#include "Deque/deque.h"
+#include "Matrix/matrix.h"
+#include "Serialize/binary.h"
+#include "UnorderedMap/unorderedmap.h"
+
+template <>
+struct BinaryFormat<BigInteger> {
+  static void write(BinaryWriter& writer, const BigInteger& value);
+  static void read(BinaryReader& reader, BigInteger& value);
+};
+
+template <std::size_t N, std::size_t M, Serializable Field>
+struct BinaryFormat<Matrix<N, M, Field>> {
+  static void write(BinaryWriter& writer, const Matrix<N, M, Field>& value) {
+    writer.write_tag(BinaryTag::Matrix);
+    writer.write_size(N);
+    writer.write_size(M);
+    writer.write_array(std::span<const Field>(value.data(), N * M));
+  }
+
+  static void read(BinaryReader& reader, Matrix<N, M, Field>& value) {
+    reader.expect_tag(BinaryTag::Matrix);
+    const std::size_t rows = reader.read_size();
+    const std::size_t columns = reader.read_size();
+    if (rows != N || columns != M) {
+      throw std::invalid_argument("BinaryReader: matrix of another shape");
+    }
+    reader.read_array(std::span<Field>(value.data(), N * M));
+  }
+};
+
+template <Serializable T, typename Allocator>
+struct BinaryFormat<Deque<T, Allocator>> {
+  static void write(BinaryWriter& writer, const Deque<T, Allocator>& value) {
+    writer.write_tag(BinaryTag::Deque);
+    writer.write_size(value.size());
+    value.for_each_segment([&](std::span<const T> segment) { writer.write_array(segment); });
+  }
+
+  static void read(BinaryReader& reader, Deque<T, Allocator>& value) {
+    reader.expect_tag(BinaryTag::Deque);
+    const std::size_t size = reader.read_count<T>();
+    value.clear();
+    value.resize(size);
+    value.for_each_segment([&](std::span<T> segment) { reader.read_array(segment); });
+  }
+};
+
+template <Serializable K, Serializable V, typename Hash, typename KeyEqual, typename Allocator>
+struct BinaryFormat<UnorderedMap<K, V, Hash, KeyEqual, Allocator>> {
+  static void write(BinaryWriter& writer,
+                    const UnorderedMap<K, V, Hash, KeyEqual, Allocator>& value) {
+    writer.write_tag(BinaryTag::UnorderedMap);
+    writer.write_size(value.size());
+    for (const auto& [key, mapped] : value) {
+      serialize(writer, key);
+      serialize(writer, mapped);
+    }
+  }
+
+  static void read(BinaryReader& reader, UnorderedMap<K, V, Hash, KeyEqual, Allocator>& value) {
+    reader.expect_tag(BinaryTag::UnorderedMap);
+    const std::size_t size = reader.read_count<K>();
+    value.clear();
+    value.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      K key;
+      V mapped;
+      deserialize(reader, key);
+      deserialize(reader, mapped);
+      value.insert_or_assign(std::move(key), std::move(mapped));
+    }
+  }
+};
@@ -0,0 +1,451 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Serialize/serialize.h"
+
+namespace {
+
+// A scratch file, removed again at the end of the test.
+class TempPath {
+ public:
+  TempPath() {
+    path_ = testing::TempDir() + "serialize_test_XXXXXX";
+    int fd = ::mkstemp(path_.data());
+    if (fd < 0) {
+      throw std::system_error(errno, std::system_category(), "mkstemp");
+    }
+    ::close(fd);
+  }
+  TempPath(const TempPath&) = delete;
+  TempPath& operator=(const TempPath&) = delete;
+  ~TempPath() { std::remove(path_.c_str()); }
+
+  const char* c_str() const { return path_.c_str(); }
+
+ private:
+  std::string path_;
+};
+
+// Bytes at the 16-byte alignment a BinaryReader asks for.
+class AlignedBytes {
+ public:
+  explicit AlignedBytes(std::span<const std::byte> bytes)
+      : blocks_((bytes.size() + sizeof(Block) - 1) / sizeof(Block) + 1), size_(bytes.size()) {
+    if (!bytes.empty()) {
+      std::memcpy(blocks_.data(), bytes.data(), bytes.size());
+    }
+  }
+
+  std::span<const std::byte> span() const {
+    return {reinterpret_cast<const std::byte*>(blocks_.data()), size_};
+  }
+  std::span<std::byte> span() { return {reinterpret_cast<std::byte*>(blocks_.data()), size_}; }
+
+ private:
+  struct alignas(16) Block {
+    std::byte bytes[16];
+  };
+
+  std::vector<Block> blocks_;
+  std::size_t size_;
+};
+
+template <typename Write>
+std::vector<std::byte> written(Write write) {
+  TempPath path;
+  BinaryWriter out(path.c_str());
+  write(out);
+  out.close();
+  MappedFile file(path.c_str());
+  auto bytes = std::as_bytes(std::span(file.data(), file.size()));
+  return {bytes.begin(), bytes.end()};
+}
+
+template <typename T>
+T round_trip(const T& value) {
+  TempPath path;
+  BinaryWriter out(path.c_str());
+  serialize(out, value);
+  out.close();
+  MappedFile file(path.c_str());
+  BinaryReader in(file);
+  T result{};
+  deserialize(in, result);
+  EXPECT_TRUE(in.at_end());
+  return result;
+}
+
+BigInteger random_big(std::mt19937_64& gen, std::size_t digits) {
+  std::string decimal = gen() % 2 == 0 ? "-" : "";
+  decimal += static_cast<char>('1' + gen() % 9);
+  for (std::size_t i = 1; i < digits; ++i) {
+    decimal += static_cast<char>('0' + gen() % 10);
+  }
+  return BigInteger(decimal);
+}
+
+struct Pair {
+  std::int16_t a;
+  double b;
+};
+
+static_assert(BulkSerializable<Pair>);
+static_assert(!BulkSerializable<BigInteger>);
+static_assert(!BulkSerializable<std::string>);
+static_assert(Serializable<Deque<std::string>>);
+static_assert(std::is_constructible_v<BinaryReader, const MappedFile&>);
+static_assert(!std::is_constructible_v<BinaryReader, MappedFile&&>);
+static_assert(!std::is_constructible_v<BinaryReader, MappedFile>);
+
+TEST(Binary, StartsWithTheMagicAndVersion) {
+  auto bytes = written([](BinaryWriter&) {});
+  ASSERT_EQ(bytes.size(), 8u);
+  EXPECT_EQ(std::memcmp(bytes.data(), "PBIN\x01\x00\x00\x00", 8), 0);
+}
+
+TEST(Binary, PadsValuesToTheirAlignment) {
+  std::uint64_t offset_after_byte = 0;
+  auto bytes = written([&](BinaryWriter& out) {
+    out.write(std::uint8_t{7});
+    offset_after_byte = out.offset();
+    out.write(3.5);
+    out.write(std::int16_t{-2});
+    out.write(Pair{5, 0.25});
+  });
+  EXPECT_EQ(offset_after_byte, 9u);
+  // 9 bytes, padded to 16 for the double, then 2 bytes and padding to 32.
+  ASSERT_EQ(bytes.size(), 48u);
+
+  AlignedBytes aligned(bytes);
+  BinaryReader in(aligned.span());
+  EXPECT_EQ(in.read<std::uint8_t>(), 7);
+  EXPECT_EQ(in.read<double>(), 3.5);
+  EXPECT_EQ(in.offset(), 24u);
+  EXPECT_EQ(in.read<std::int16_t>(), -2);
+  Pair pair = in.read<Pair>();
+  EXPECT_EQ(pair.a, 5);
+  EXPECT_EQ(pair.b, 0.25);
+  EXPECT_TRUE(in.at_end());
+}
+
+TEST(Binary, ViewsArraysAndStringsInPlace) {
+  std::vector<std::uint32_t> values(100000);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<std::uint32_t>(i * i);
+  }
+  TempPath path;
+  {
+    BinaryWriter out(path.c_str());
+    out.write_string("checkpoint");
+    out.write_size(values.size());
+    out.write_array(std::span<const std::uint32_t>(values));
+    serialize(out, String("string"));
+    serialize(out, std::string("std::string"));
+    out.close();
+  }
+  MappedFile file(path.c_str());
+  BinaryReader in(file);
+  StringView name = in.read_string();
+  EXPECT_EQ(std::string_view(name), "checkpoint");
+  EXPECT_GE(name.data(), file.data());
+  EXPECT_LT(name.data(), file.data() + file.size());
+
+  std::span<const std::uint32_t> view = in.view<std::uint32_t>(in.read_count<std::uint32_t>());
+  EXPECT_EQ(reinterpret_cast<const char*>(view.data()) - file.data(), 40);
+  EXPECT_TRUE(std::equal(view.begin(), view.end(), values.begin(), values.end()));
+
+  String string;
+  std::string std_string;
+  deserialize(in, string);
+  deserialize(in, std_string);
+  EXPECT_EQ(string, String("string"));
+  EXPECT_EQ(std_string, "std::string");
+  EXPECT_TRUE(in.at_end());
+  EXPECT_EQ(in.remaining(), 0u);
+}
+
+TEST(Binary, BuffersLargeAndSmallWrites) {
+  // Larger than the writer's buffer, in pieces on both sides of its size.
+  std::vector<std::uint8_t> big(3 << 20);
+  for (std::size_t i = 0; i < big.size(); ++i) {
+    big[i] = static_cast<std::uint8_t>(i * 31);
+  }
+  auto bytes = written([&](BinaryWriter& out) {
+    out.write_bytes(big.data(), 1000);
+    out.write_bytes(big.data(), (1 << 20) - 10);
+    out.write_bytes(big.data(), big.size());
+    EXPECT_EQ(out.offset(), 8 + 1000 + (1 << 20) - 10 + big.size());
+  });
+  ASSERT_EQ(bytes.size(), 8 + 1000 + (1u << 20) - 10 + big.size());
+  EXPECT_EQ(std::memcmp(bytes.data() + 8, big.data(), 1000), 0);
+  EXPECT_EQ(std::memcmp(bytes.data() + 1008, big.data(), (1 << 20) - 10), 0);
+  EXPECT_EQ(std::memcmp(bytes.data() + 998 + (1 << 20), big.data(), big.size()), 0);
+}
+
+TEST(Binary, WriterReportsErrors) {
+  std::string missing = testing::TempDir() + "serialize_test_missing/file";
+  EXPECT_THROW(BinaryWriter(missing.c_str()), std::system_error);
+
+  TempPath path;
+  BinaryWriter out(path.c_str());
+  out.close();
+  out.close();
+  EXPECT_THROW(out.write(1), std::logic_error);
+}
+
+TEST(Binary, RejectsForeignHeaders) {
+  auto bytes = written([](BinaryWriter& out) { out.write(std::uint64_t{42}); });
+  auto reads = [&](std::vector<std::byte> input) {
+    AlignedBytes aligned(input);
+    BinaryReader in(aligned.span());
+    return in.read<std::uint64_t>();
+  };
+  EXPECT_EQ(reads(bytes), 42u);
+
+  auto magic = bytes;
+  magic[0] = std::byte{'Q'};
+  EXPECT_THROW(reads(magic), std::invalid_argument);
+  auto version_zero = bytes;
+  version_zero[4] = std::byte{0};
+  EXPECT_THROW(reads(version_zero), std::invalid_argument);
+  auto newer = bytes;
+  newer[4] = std::byte{2};
+  EXPECT_THROW(reads(newer), std::invalid_argument);
+  EXPECT_THROW(reads({}), std::invalid_argument);
+
+  // Not at the alignment the format needs.
+  AlignedBytes aligned(bytes);
+  EXPECT_THROW(BinaryReader(std::span<const std::byte>(aligned.span().data() + 1, 8)),
+               std::invalid_argument);
+}
+
+TEST(Binary, RejectsTruncatedInput) {
+  Deque<std::string> strings;
+  for (int i = 0; i < 50; ++i) {
+    strings.push_back(std::string(static_cast<std::size_t>(i), 'a' + i % 26));
+  }
+  UnorderedMap<int, BigInteger> numbers;
+  numbers[1] = BigInteger("123456789012345678901234567890");
+  numbers[-5] = -7;
+  auto bytes = written([&](BinaryWriter& out) {
+    serialize(out, strings);
+    serialize(out, numbers);
+    serialize(out, Matrix<2, 3, double>{{1, 2, 3}, {4, 5, 6}});
+  });
+  auto read_all = [](std::span<const std::byte> input) {
+    BinaryReader in(input);
+    Deque<std::string> strings_read;
+    UnorderedMap<int, BigInteger> numbers_read;
+    Matrix<2, 3, double> matrix_read;
+    deserialize(in, strings_read);
+    deserialize(in, numbers_read);
+    deserialize(in, matrix_read);
+  };
+  AlignedBytes whole(bytes);
+  EXPECT_NO_THROW(read_all(whole.span()));
+  for (std::size_t length = 0; length < bytes.size(); ++length) {
+    AlignedBytes prefix(std::span(bytes.data(), length));
+    EXPECT_THROW(read_all(prefix.span()), std::invalid_argument) << length;
+  }
+}
+
+TEST(Binary, RejectsImpossibleCountsBeforeAllocating) {
+  auto bytes = written([](BinaryWriter& out) {
+    out.write_tag(BinaryTag::Deque);
+    out.write_size(std::size_t{1} << 60);
+  });
+  AlignedBytes aligned(bytes);
+  BinaryReader in(aligned.span());
+  Deque<double> values;
+  EXPECT_THROW(deserialize(in, values), std::invalid_argument);
+
+  auto strings = written([](BinaryWriter& out) {
+    out.write_tag(BinaryTag::Deque);
+    out.write_size(3);
+    out.write_size(8);
+  });
+  AlignedBytes strings_aligned(strings);
+  BinaryReader strings_in(strings_aligned.span());
+  Deque<std::string> strings_read;
+  EXPECT_THROW(deserialize(strings_in, strings_read), std::invalid_argument);
+}
+
+TEST(Binary, RejectsTheWrongType) {
+  auto bytes = written([](BinaryWriter& out) {
+    serialize(out, Deque<int>());
+    serialize(out, Matrix<2, 2, int>{{1, 2}, {3, 4}});
+  });
+  AlignedBytes aligned(bytes);
+  {
+    BinaryReader in(aligned.span());
+    Matrix<2, 2, int> matrix;
+    EXPECT_THROW(deserialize(in, matrix), std::invalid_argument);
+  }
+  {
+    BinaryReader in(aligned.span());
+    Deque<int> deque;
+    deserialize(in, deque);
+    Matrix<2, 3, int> wide;
+    EXPECT_THROW(deserialize(in, wide), std::invalid_argument);
+  }
+  {
+    BinaryReader in(aligned.span());
+    UnorderedMap<int, int> map;
+    EXPECT_THROW(deserialize(in, map), std::invalid_argument);
+  }
+}
+
+TEST(Serialize, BigIntegers) {
+  EXPECT_EQ(round_trip(BigInteger()), BigInteger());
+  EXPECT_EQ(round_trip(BigInteger(-1)), BigInteger(-1));
+  EXPECT_EQ(round_trip(BigInteger(std::numeric_limits<std::int64_t>::min())),
+            BigInteger(std::numeric_limits<std::int64_t>::min()));
+  std::mt19937_64 gen(1);
+  for (std::size_t digits : {9u, 10u, 100u, 10000u}) {
+    BigInteger value = random_big(gen, digits);
+    EXPECT_EQ(round_trip(value), value);
+  }
+
+  auto bytes = written([](BinaryWriter& out) { serialize(out, BigInteger(-5)); });
+  // Tag, sign, padding, count and one limb.
+  ASSERT_EQ(bytes.size(), 8u + 4 + 4 + 8 + 4);
+  bytes[12] = std::byte{2};
+  AlignedBytes aligned(bytes);
+  BinaryReader in(aligned.span());
+  BigInteger value;
+  EXPECT_THROW(deserialize(in, value), std::invalid_argument);
+}
+
+TEST(Serialize, BigIntegerLimbs) {
+  const BigInteger::Limb limbs[] = {5, 0, 7, 0, 0};
+  BigInteger value = BigInteger::from_limbs(limbs, true);
+  EXPECT_EQ(value.limb_count(), 3u);
+  EXPECT_EQ(value, -(BigInteger(7) * BigInteger(std::int64_t{1} << 32) *
+                         BigInteger(std::int64_t{1} << 32) +
+                     5));
+  EXPECT_TRUE(std::equal(value.limbs().begin(), value.limbs().end(), limbs));
+  // Zero has no sign.
+  const BigInteger::Limb zeros[] = {0, 0};
+  EXPECT_EQ(BigInteger::from_limbs(zeros, true), BigInteger());
+  EXPECT_FALSE(BigInteger::from_limbs(zeros, true).is_negative());
+}
+
+TEST(Serialize, Matrices) {
+  Matrix<3, 4, double> doubles;
+  for (std::size_t i = 0; i < 3; ++i) {
+    for (std::size_t j = 0; j < 4; ++j) {
+      doubles[i][j] = static_cast<double>(i) * 0.5 - static_cast<double>(j);
+    }
+  }
+  EXPECT_EQ(round_trip(doubles), doubles);
+
+  Matrix<2, 2, BigInteger> big{{BigInteger("123456789123456789123"), 0}, {-1, 7}};
+  EXPECT_EQ(round_trip(big), big);
+
+  Matrix<64, 64, std::int64_t> large;
+  for (std::size_t i = 0; i < 64; ++i) {
+    for (std::size_t j = 0; j < 64; ++j) {
+      large[i][j] = static_cast<std::int64_t>(i * 1000 + j);
+    }
+  }
+  EXPECT_EQ(round_trip(large), large);
+}
+
+TEST(Serialize, Deques) {
+  Deque<int> empty;
+  EXPECT_EQ(round_trip(empty), empty);
+
+  // Many blocks, with the first one partly used.
+  Deque<double> doubles;
+  for (int i = 0; i < 10000; ++i) {
+    doubles.push_back(i * 0.5);
+  }
+  for (int i = 0; i < 777; ++i) {
+    doubles.push_front(-i);
+  }
+  EXPECT_EQ(round_trip(doubles), doubles);
+
+  Deque<BigInteger> big;
+  std::mt19937_64 gen(2);
+  for (int i = 0; i < 300; ++i) {
+    big.push_back(random_big(gen, 1 + static_cast<std::size_t>(i)));
+  }
+  EXPECT_EQ(round_trip(big), big);
+
+  // Reading replaces what was there.
+  TempPath path;
+  {
+    BinaryWriter out(path.c_str());
+    serialize(out, doubles);
+    out.close();
+  }
+  MappedFile file(path.c_str());
+  BinaryReader in(file);
+  Deque<double> target(5, 1.0);
+  deserialize(in, target);
+  EXPECT_EQ(target, doubles);
+}
+
+TEST(Serialize, UnorderedMaps) {
+  UnorderedMap<std::string, BigInteger> counts;
+  std::mt19937_64 gen(3);
+  for (int i = 0; i < 2000; ++i) {
+    counts["key" + std::to_string(i)] = random_big(gen, 1 + static_cast<std::size_t>(i % 60));
+  }
+  auto read = round_trip(counts);
+  ASSERT_EQ(read.size(), counts.size());
+  for (const auto& [key, value] : counts) {
+    auto found = read.find(key);
+    ASSERT_NE(found, read.end()) << key;
+    EXPECT_EQ(found->second, value);
+  }
+
+  UnorderedMap<int, double> numbers;
+  numbers[3] = 1.5;
+  UnorderedMap<int, double> target;
+  target[4] = 2.0;
+  TempPath path;
+  {
+    BinaryWriter out(path.c_str());
+    serialize(out, numbers);
+    out.close();
+  }
+  MappedFile file(path.c_str());
+  BinaryReader in(file);
+  deserialize(in, target);
+  EXPECT_EQ(target.size(), 1u);
+  EXPECT_EQ(target[3], 1.5);
+  EXPECT_FALSE(target.contains(4));
+}
+
+TEST(Serialize, NestedContainers) {
+  Deque<UnorderedMap<int, Deque<std::string>>> nested(3);
+  nested[0][1].push_back("one");
+  nested[2][7].push_back("seven");
+  nested[2][7].push_back("");
+  auto read = round_trip(nested);
+  ASSERT_EQ(read.size(), 3u);
+  EXPECT_EQ(read[0].size(), 1u);
+  EXPECT_EQ(read[0][1], nested[0][1]);
+  EXPECT_EQ(read[1].size(), 0u);
+  EXPECT_EQ(read[2][7], nested[2][7]);
+}
+
+}  // namespace
@@ -0,0 +1,248 @@
+#pragma once
+
+// Lock-free atomic SharedPtr based on split reference counts.
+//
+// The state is one 64-bit word: the control block address in the low 48
+// bits and a local count in the high 16. The word owns a prepaid batch of
+// kBatch strong references on its block, and the local count says how many
+// of those readers have taken. load() is then a single fetch_add on the
+// word, after which the reader owns one reference outright; a reader that
+// sees the batch half used tops it up. Replacing the word hands back
+// whatever part of the batch was not taken. There is no lock anywhere, so a
+// writer never stalls readers and readers never stall each other beyond
+// the contended cache line.
+//
+// The stored block is always a small wrapper holding the SharedPtr that was
+// stored, which keeps aliasing SharedPtrs exact. Pointers loaded from it
+// share ownership with the original, but their use_count() includes the
+// unused part of the batch and is not meaningful.
+//
+// Requires 64-bit pointers with the top 16 bits clear, as user-space
+// addresses are on x86-64 and AArch64 (without pointer tagging).
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+#include "SmartPointers/smartpointers.h"
+
+namespace smartpointers_detail {
+
+// Control block that owns the stored SharedPtr.
+template <typename T>
+class AliasBlock final : public ControlBlock<AtomicCount> {
+ public:
+  explicit AliasBlock(SharedPtr<T>&& owner) noexcept
+      : ptr_(owner.get()), owner_(std::move(owner)) {}
+
+  T* get() const noexcept { return ptr_; }
+  const SharedPtr<T>& owner() const noexcept { return owner_; }
+
+ private:
+  void destroy_object() noexcept override { owner_.reset(); }
+  void deallocate() noexcept override { delete this; }
+
+  T* ptr_;
+  SharedPtr<T> owner_;
+};
+
+}  // namespace smartpointers_detail
+
+template <typename T>
+class AtomicSharedPtr {
+  using Block = smartpointers_detail::AliasBlock<T>;
+  using Word = std::uint64_t;
+
+  static_assert(sizeof(void*) == sizeof(Word), "AtomicSharedPtr needs 64-bit pointers");
+
+  static constexpr int kCountShift = 48;
+  static constexpr Word kOne = Word{1} << kCountShift;
+  static constexpr Word kAddressMask = kOne - 1;
+  // References prepaid by the word, and the local count at which a reader
+  // tops the batch up. The gap guards the 16-bit count against readers
+  // racing a top-up.
+  static constexpr long kBatch = 1 << 15;
+  static constexpr long kRefill = 1 << 13;
+
+ public:
+  using element_type = T;
+  using value_type = SharedPtr<T>;
+
+  static constexpr bool is_always_lock_free = std::atomic<Word>::is_always_lock_free;
+
+  AtomicSharedPtr() noexcept = default;
+  AtomicSharedPtr(SharedPtr<T> desired)  // NOLINT(google-explicit-constructor)
+      : word_(adopt(std::move(desired))) {}
+  AtomicSharedPtr(const AtomicSharedPtr&) = delete;
+  AtomicSharedPtr& operator=(const AtomicSharedPtr&) = delete;
+
+  ~AtomicSharedPtr() { release_word(word_.load(std::memory_order_acquire), 0); }
+
+  AtomicSharedPtr& operator=(SharedPtr<T> desired) {
+    store(std::move(desired));
+    return *this;
+  }
+
+  bool is_lock_free() const noexcept { return word_.is_lock_free(); }
+
+  SharedPtr<T> load(std::memory_order order = std::memory_order_seq_cst) const noexcept {
+    Word old = word_.fetch_add(kOne, acquire_part(order));
+    Block* block = block_of(old);
+    if (block == nullptr) {
+      // The local count of an empty word means nothing and may wrap.
+      return SharedPtr<T>();
+    }
+    if (count_of(old) >= kRefill) {
+      refill(block);
+    }
+    return share(block);
+  }
+
+  operator SharedPtr<T>() const noexcept {  // NOLINT(google-explicit-constructor)
+    return load();
+  }
+
+  // Allocates a wrapper block, so unlike load() this can throw.
+  void store(SharedPtr<T> desired, std::memory_order order = std::memory_order_seq_cst) {
+    exchange(std::move(desired), order);
+  }
+
+  SharedPtr<T> exchange(SharedPtr<T> desired,
+                        std::memory_order order = std::memory_order_seq_cst) {
+    Word next = adopt(std::move(desired));
+    Word old = word_.exchange(next, strongest(order));
+    SharedPtr<T> previous;
+    if (Block* block = block_of(old)) {
+      previous = share(block);
+    }
+    release_word(old, 1);
+    return previous;
+  }
+
+  // Succeeds if the stored pointer is equivalent to `expected`: the same
+  // address, owning the same object. On failure `expected` gets the current
+  // value.
+  bool compare_exchange_strong(SharedPtr<T>& expected, SharedPtr<T> desired,
+                               std::memory_order order = std::memory_order_seq_cst) {
+    while (true) {
+      // Holding `current` keeps its block alive, so comparing addresses
+      // below cannot be fooled by a reused allocation.
+      SharedPtr<T> current = load(std::memory_order_acquire);
+      if (!equivalent(current, expected)) {
+        expected = std::move(current);
+        return false;
+      }
+      Word next = adopt(std::move(desired));
+      Word word = word_.load(std::memory_order_relaxed);
+      while (block_of(word) == current.block_) {
+        if (word_.compare_exchange_weak(word, next, strongest(order),
+                                        std::memory_order_relaxed)) {
+          release_word(word, 0);
+          return true;
+        }
+      }
+      desired = take_back(next);
+    }
+  }
+
+  bool compare_exchange_weak(SharedPtr<T>& expected, SharedPtr<T> desired,
+                             std::memory_order order = std::memory_order_seq_cst) {
+    return compare_exchange_strong(expected, std::move(desired), order);
+  }
+
+ private:
+  static Block* block_of(Word word) noexcept {
+    return reinterpret_cast<Block*>(static_cast<std::uintptr_t>(word & kAddressMask));
+  }
+  static long count_of(Word word) noexcept { return static_cast<long>(word >> kCountShift); }
+
+  // Wraps one reference on `block` that the caller already owns.
+  static SharedPtr<T> share(Block* block) noexcept {
+    smartpointers_detail::ControlBlock<AtomicCount>* base = block;
+    return SharedPtr<T>(block->get(), base);
+  }
+
+  static constexpr std::memory_order acquire_part(std::memory_order order) noexcept {
+    return order == std::memory_order_relaxed ? std::memory_order_relaxed
+                                              : std::memory_order_acquire;
+  }
+  static constexpr std::memory_order strongest(std::memory_order order) noexcept {
+    return order == std::memory_order_seq_cst ? order : std::memory_order_acq_rel;
+  }
+
+  // Turns `desired` into a word owning a full batch on a wrapper block.
+  static Word adopt(SharedPtr<T>&& desired) {
+    if (!desired) {
+      return 0;
+    }
+    // A pointer loaded from some AtomicSharedPtr is already a wrapper of
+    // the right shape; reuse it rather than nesting wrappers.
+    auto* block = dynamic_cast<Block*>(desired.block_);
+    if (block != nullptr && block->get() == desired.ptr_) {
+      desired.block_ = nullptr;
+      desired.ptr_ = nullptr;
+    } else {
+      block = new Block(std::move(desired));
+    }
+    block->add_shared(kBatch - 1);
+    return static_cast<Word>(reinterpret_cast<std::uintptr_t>(block));
+  }
+
+  // Undoes adopt() for a word that was never published.
+  static SharedPtr<T> take_back(Word word) noexcept {
+    Block* block = block_of(word);
+    if (block == nullptr) {
+      return SharedPtr<T>();
+    }
+    block->release_shared(kBatch - 1);
+    return share(block);
+  }
+
+  // Gives back the part of the batch `word` still owned, except `keep`
+  // references that the caller takes over.
+  static void release_word(Word word, long keep) noexcept {
+    Block* block = block_of(word);
+    if (block == nullptr) {
+      return;
+    }
+    long owned = kBatch - count_of(word) - keep;
+    if (owned > 0) {
+      block->release_shared(owned);
+    } else if (owned < 0) {
+      block->add_shared(-owned);
+    }
+  }
+
+  // Swaps the used part of the batch for fresh references. The caller owns
+  // a reference, so the block stays alive throughout.
+  void refill(Block* block) const noexcept {
+    Word word = word_.load(std::memory_order_relaxed);
+    while (block_of(word) == block && count_of(word) >= kRefill) {
+      long used = count_of(word);
+      block->add_shared(used);
+      Word fresh = word & kAddressMask;
+      if (word_.compare_exchange_weak(word, fresh, std::memory_order_relaxed,
+                                      std::memory_order_relaxed)) {
+        return;
+      }
+      block->release_shared(used);
+    }
+  }
+
+  static bool equivalent(const SharedPtr<T>& current, const SharedPtr<T>& expected) noexcept {
+    if (current.ptr_ != expected.ptr_) {
+      return false;
+    }
+    if (current.block_ == expected.block_) {
+      return true;
+    }
+    if (current.block_ == nullptr) {
+      return false;
+    }
+    // `expected` may be the original that was stored rather than a load.
+    auto* block = static_cast<Block*>(current.block_);
+    return block->owner().block_ == expected.block_;
+  }
+
+  mutable std::atomic<Word> word_{0};
+};
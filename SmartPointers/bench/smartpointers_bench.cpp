@@ -0,0 +1,193 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "SmartPointers/atomicsharedptr.h"
+#include "SmartPointers/intrusiveptr.h"
+#include "SmartPointers/smartpointers.h"
+
+namespace {
+
+struct Payload {
+  std::int64_t a = 0;
+  std::int64_t b = 0;
+};
+
+// One flavour of shared pointer: how to create one and the weak type.
+struct Std {
+  template <typename T>
+  using Shared = std::shared_ptr<T>;
+  template <typename T>
+  using Weak = std::weak_ptr<T>;
+  template <typename T>
+  static Shared<T> make() {
+    return std::make_shared<T>();
+  }
+};
+
+template <typename Policy>
+struct Portfolio {
+  template <typename T>
+  using Shared = SharedPtr<T, Policy>;
+  template <typename T>
+  using Weak = WeakPtr<T, Policy>;
+  template <typename T>
+  static Shared<T> make() {
+    return makeShared<T, Policy>();
+  }
+};
+
+using Atomic = Portfolio<AtomicCount>;
+using Plain = Portfolio<PlainCount>;
+
+constexpr std::size_t kCount = 1 << 12;
+
+// libstdc++ skips atomic counts while the process has a single thread.
+// Services never do, so start one before any benchmark runs.
+const bool kMultiThreaded = [] {
+  std::thread([] {}).join();
+  return true;
+}();
+
+// Creates and destroys owners: one allocation each with make_shared.
+template <typename Flavour>
+void BM_Make(benchmark::State& state) {
+  std::vector<typename Flavour::template Shared<Payload>> owners(kCount);
+  for (auto _ : state) {
+    for (auto& owner : owners) {
+      owner = Flavour::template make<Payload>();
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kCount));
+}
+
+// Copies a vector of owners, as passing a graph of nodes by value does;
+// every copy and destruction touches the count.
+template <typename Flavour>
+void BM_Copy(benchmark::State& state) {
+  std::vector<typename Flavour::template Shared<Payload>> owners;
+  for (std::size_t i = 0; i < kCount; ++i) {
+    owners.push_back(Flavour::template make<Payload>());
+  }
+  std::vector<typename Flavour::template Shared<Payload>> copies(kCount);
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < kCount; ++i) {
+      copies[i] = owners[i];
+    }
+    for (auto& copy : copies) {
+      copy = nullptr;
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kCount));
+}
+
+// Locks weak references, the cache lookup pattern.
+template <typename Flavour>
+void BM_WeakLock(benchmark::State& state) {
+  std::vector<typename Flavour::template Shared<Payload>> owners;
+  std::vector<typename Flavour::template Weak<Payload>> weak;
+  for (std::size_t i = 0; i < kCount; ++i) {
+    owners.push_back(Flavour::template make<Payload>());
+    weak.emplace_back(owners.back());
+  }
+  for (auto _ : state) {
+    std::int64_t sum = 0;
+    for (const auto& ref : weak) {
+      if (auto owner = ref.lock()) {
+        sum += owner->a;
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kCount));
+}
+
+template <typename Policy>
+struct Node : RefCounted<Node<Policy>, Policy> {
+  std::int64_t a = 0;
+  std::int64_t b = 0;
+};
+
+// BM_Copy with the count inside the object.
+template <typename Policy>
+void BM_IntrusiveCopy(benchmark::State& state) {
+  std::vector<IntrusivePtr<Node<Policy>>> owners;
+  for (std::size_t i = 0; i < kCount; ++i) {
+    owners.push_back(makeIntrusive<Node<Policy>>());
+  }
+  std::vector<IntrusivePtr<Node<Policy>>> copies(kCount);
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < kCount; ++i) {
+      copies[i] = owners[i];
+    }
+    for (auto& copy : copies) {
+      copy = nullptr;
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kCount));
+}
+
+struct Snapshot {
+  std::int64_t version = 0;
+  std::int64_t data[7] = {};
+};
+
+// A published snapshot that many threads read: the libstdc++ atomic
+// shared_ptr (a spin lock in the pointer) or AtomicSharedPtr.
+struct StdCell {
+  using Pointer = std::shared_ptr<Snapshot>;
+  std::atomic<Pointer> cell{std::make_shared<Snapshot>()};
+  static Pointer make(std::int64_t version) {
+    return std::make_shared<Snapshot>(Snapshot{version, {}});
+  }
+};
+
+struct PortfolioCell {
+  using Pointer = SharedPtr<Snapshot>;
+  AtomicSharedPtr<Snapshot> cell{makeShared<Snapshot>()};
+  static Pointer make(std::int64_t version) {
+    return makeShared<Snapshot>(Snapshot{version, {}});
+  }
+};
+
+// Every thread loads the snapshot; thread 0 also publishes a new one every
+// 256 reads.
+template <typename Cell>
+void BM_SnapshotRead(benchmark::State& state) {
+  static Cell cell;
+  std::int64_t sum = 0;
+  std::int64_t reads = 0;
+  for (auto _ : state) {
+    typename Cell::Pointer snapshot = cell.cell.load();
+    sum += snapshot->version;
+    if (state.thread_index() == 0 && ++reads % 256 == 0) {
+      cell.cell.store(Cell::make(reads));
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+}
+
+#define POINTER_BENCHMARKS(Flavour)     \
+  BENCHMARK_TEMPLATE(BM_Make, Flavour); \
+  BENCHMARK_TEMPLATE(BM_Copy, Flavour); \
+  BENCHMARK_TEMPLATE(BM_WeakLock, Flavour)
+
+POINTER_BENCHMARKS(Std);
+POINTER_BENCHMARKS(Atomic);
+POINTER_BENCHMARKS(Plain);
+
+BENCHMARK_TEMPLATE(BM_IntrusiveCopy, AtomicCount);
+BENCHMARK_TEMPLATE(BM_IntrusiveCopy, PlainCount);
+
+BENCHMARK_TEMPLATE(BM_SnapshotRead, StdCell)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SnapshotRead, PortfolioCell)->ThreadRange(1, 64)->UseRealTime();
+
+}  // namespace
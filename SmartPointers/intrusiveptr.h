@@ -0,0 +1,156 @@
+#pragma once
+
+// Owning pointer for objects that carry their own reference count.
+//
+// IntrusivePtr<T> adjusts the count through two functions found by
+// argument-dependent lookup, intrusivePtrAddRef(const T*) and
+// intrusivePtrRelease(const T*), so any type can opt in. RefCounted<T,
+// Policy> provides both for a class that derives from it, with the count
+// kept by the same policies as SharedPtr. There is no control block: the
+// pointer is one word, and an owner can be recreated from a raw pointer at
+// any time, e.g. from `this`.
+
+#include <compare>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "SmartPointers/smartpointers.h"
+
+// Base that makes Derived usable with IntrusivePtr. The object is deleted
+// when the last owner goes; copies of an object start with no owners.
+template <typename Derived, typename Policy = AtomicCount>
+class RefCounted {
+ public:
+  long use_count() const noexcept { return refs_.load(); }
+
+ protected:
+  RefCounted() noexcept = default;
+  RefCounted(const RefCounted&) noexcept {}
+  RefCounted& operator=(const RefCounted&) noexcept { return *this; }
+  ~RefCounted() = default;
+
+ private:
+  friend void intrusivePtrAddRef(const RefCounted* object) noexcept {
+    object->refs_.increment();
+  }
+
+  friend void intrusivePtrRelease(const RefCounted* object) noexcept {
+    if (object->refs_.decrement() == 0) {
+      delete static_cast<const Derived*>(object);
+    }
+  }
+
+  mutable typename Policy::Counter refs_{0};
+};
+
+template <typename T>
+class IntrusivePtr {
+ public:
+  using element_type = T;
+
+  IntrusivePtr() noexcept = default;
+  IntrusivePtr(std::nullptr_t) noexcept {}  // NOLINT(google-explicit-constructor)
+
+  // With add_ref = false the pointer takes over a reference the caller
+  // already holds, the counterpart of detach().
+  IntrusivePtr(T* ptr, bool add_ref = true) noexcept  // NOLINT(google-explicit-constructor)
+      : ptr_(ptr) {
+    if (ptr_ != nullptr && add_ref) {
+      intrusivePtrAddRef(ptr_);
+    }
+  }
+
+  IntrusivePtr(const IntrusivePtr& other) noexcept : IntrusivePtr(other.ptr_) {}
+  IntrusivePtr(IntrusivePtr&& other) noexcept : ptr_(std::exchange(other.ptr_, nullptr)) {}
+
+  template <typename Y>
+    requires std::is_convertible_v<Y*, T*>
+  IntrusivePtr(const IntrusivePtr<Y>& other) noexcept  // NOLINT(google-explicit-constructor)
+      : IntrusivePtr(other.get()) {}
+
+  template <typename Y>
+    requires std::is_convertible_v<Y*, T*>
+  IntrusivePtr(IntrusivePtr<Y>&& other) noexcept  // NOLINT(google-explicit-constructor)
+      : ptr_(other.detach()) {}
+
+  ~IntrusivePtr() {
+    if (ptr_ != nullptr) {
+      intrusivePtrRelease(ptr_);
+    }
+  }
+
+  IntrusivePtr& operator=(const IntrusivePtr& other) noexcept {
+    IntrusivePtr(other).swap(*this);
+    return *this;
+  }
+  IntrusivePtr& operator=(IntrusivePtr&& other) noexcept {
+    IntrusivePtr(std::move(other)).swap(*this);
+    return *this;
+  }
+  template <typename Y>
+  IntrusivePtr& operator=(const IntrusivePtr<Y>& other) noexcept {
+    IntrusivePtr(other).swap(*this);
+    return *this;
+  }
+  template <typename Y>
+  IntrusivePtr& operator=(IntrusivePtr<Y>&& other) noexcept {
+    IntrusivePtr(std::move(other)).swap(*this);
+    return *this;
+  }
+  IntrusivePtr& operator=(T* ptr) noexcept {
+    IntrusivePtr(ptr).swap(*this);
+    return *this;
+  }
+
+  void reset() noexcept { IntrusivePtr().swap(*this); }
+  void reset(T* ptr, bool add_ref = true) noexcept { IntrusivePtr(ptr, add_ref).swap(*this); }
+
+  // Gives up ownership without touching the count.
+  T* detach() noexcept { return std::exchange(ptr_, nullptr); }
+
+  void swap(IntrusivePtr& other) noexcept { std::swap(ptr_, other.ptr_); }
+  friend void swap(IntrusivePtr& lhs, IntrusivePtr& rhs) noexcept { lhs.swap(rhs); }
+
+  T* get() const noexcept { return ptr_; }
+  T& operator*() const noexcept { return *ptr_; }
+  T* operator->() const noexcept { return ptr_; }
+  explicit operator bool() const noexcept { return ptr_ != nullptr; }
+
+  template <typename U>
+  friend bool operator==(const IntrusivePtr& lhs, const IntrusivePtr<U>& rhs) noexcept {
+    return lhs.get() == rhs.get();
+  }
+  template <typename U>
+  friend std::strong_ordering operator<=>(const IntrusivePtr& lhs,
+                                          const IntrusivePtr<U>& rhs) noexcept {
+    return std::compare_three_way()(lhs.get(), rhs.get());
+  }
+  friend bool operator==(const IntrusivePtr& lhs, std::nullptr_t) noexcept { return !lhs; }
+
+ private:
+  T* ptr_ = nullptr;
+};
+
+template <typename T, typename... Args>
+IntrusivePtr<T> makeIntrusive(Args&&... args) {
+  return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> staticPointerCast(const IntrusivePtr<U>& ptr) noexcept {
+  return IntrusivePtr<T>(static_cast<T*>(ptr.get()));
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> dynamicPointerCast(const IntrusivePtr<U>& ptr) noexcept {
+  return IntrusivePtr<T>(dynamic_cast<T*>(ptr.get()));
+}
+
+template <typename T>
+struct std::hash<IntrusivePtr<T>> {
+  std::size_t operator()(const IntrusivePtr<T>& ptr) const noexcept {
+    return std::hash<T*>()(ptr.get());
+  }
+};
@@ -0,0 +1,613 @@
+#pragma once
+
+// Shared-ownership smart pointers with a selectable reference-count policy.
+//
+// SharedPtr<T, Policy> and WeakPtr<T, Policy> follow std::shared_ptr and
+// std::weak_ptr. Policy decides how the counts are kept: AtomicCount (the
+// default) is safe to share between threads, PlainCount uses ordinary
+// integers and is for object graphs that stay on one thread, where the
+// atomic read-modify-write on every copy is pure overhead. Pointers with
+// different policies do not mix.
+//
+// The control block counts strong owners and weak owners; all strong owners
+// together hold one weak reference, so the block is freed when the last weak
+// reference goes. makeShared and allocateShared put the object inside the
+// control block, one allocation instead of two, with the object destroyed
+// when the last SharedPtr goes and the memory freed with the last WeakPtr.
+//
+// Arrays (SharedPtr<T[]>) are not supported.
+
+#include <atomic>
+#include <compare>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Thread-safe counts: increments are relaxed, the decrement that may destroy
+// the object is acquire-release.
+struct AtomicCount {
+  class Counter {
+   public:
+    explicit Counter(long value) noexcept : value_(value) {}
+
+    void increment(long count = 1) noexcept {
+      value_.fetch_add(count, std::memory_order_relaxed);
+    }
+    // Returns the new value.
+    long decrement(long count = 1) noexcept {
+      return value_.fetch_sub(count, std::memory_order_acq_rel) - count;
+    }
+    bool increment_if_nonzero() noexcept {
+      long value = value_.load(std::memory_order_relaxed);
+      while (value != 0) {
+        if (value_.compare_exchange_weak(value, value + 1, std::memory_order_acq_rel,
+                                         std::memory_order_relaxed)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    long load() const noexcept { return value_.load(std::memory_order_relaxed); }
+    bool unique() const noexcept { return value_.load(std::memory_order_acquire) == 1; }
+
+   private:
+    std::atomic<long> value_;
+  };
+};
+
+// Counts for pointers that never cross threads.
+struct PlainCount {
+  class Counter {
+   public:
+    explicit Counter(long value) noexcept : value_(value) {}
+
+    void increment(long count = 1) noexcept { value_ += count; }
+    long decrement(long count = 1) noexcept { return value_ -= count; }
+    bool increment_if_nonzero() noexcept {
+      if (value_ == 0) {
+        return false;
+      }
+      ++value_;
+      return true;
+    }
+    long load() const noexcept { return value_; }
+    bool unique() const noexcept { return value_ == 1; }
+
+   private:
+    long value_;
+  };
+};
+
+template <typename T, typename Policy = AtomicCount>
+class SharedPtr;
+
+template <typename T, typename Policy = AtomicCount>
+class WeakPtr;
+
+template <typename T, typename Policy = AtomicCount>
+class EnableSharedFromThis;
+
+template <typename T, typename Policy = AtomicCount, typename Allocator,
+          typename... Args>
+SharedPtr<T, Policy> allocateShared(const Allocator& alloc, Args&&... args);
+
+namespace smartpointers_detail {
+
+template <typename Policy>
+class ControlBlock {
+ public:
+  ControlBlock() = default;
+  ControlBlock(const ControlBlock&) = delete;
+  ControlBlock& operator=(const ControlBlock&) = delete;
+
+  void add_shared(long count = 1) noexcept { shared_.increment(count); }
+  bool try_add_shared() noexcept { return shared_.increment_if_nonzero(); }
+  void add_weak() noexcept { weak_.increment(); }
+
+  void release_shared(long count = 1) noexcept {
+    if (shared_.decrement(count) == 0) {
+      destroy_object();
+      release_weak();
+    }
+  }
+
+  // A sole weak reference cannot be copied by anyone else, so the common
+  // case of a block without WeakPtrs skips the second read-modify-write.
+  void release_weak() noexcept {
+    if (weak_.unique() || weak_.decrement() == 0) {
+      deallocate();
+    }
+  }
+
+  long use_count() const noexcept { return shared_.load(); }
+
+ protected:
+  ~ControlBlock() = default;
+
+ private:
+  virtual void destroy_object() noexcept = 0;
+  virtual void deallocate() noexcept = 0;
+
+  typename Policy::Counter shared_{1};
+  typename Policy::Counter weak_{1};
+};
+
+// Block for a pointer adopted by SharedPtr(ptr, deleter, alloc).
+template <typename Policy, typename Y, typename Deleter, typename Allocator>
+class PointerBlock final : public ControlBlock<Policy> {
+ public:
+  using BlockAllocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<PointerBlock>;
+  using BlockTraits = std::allocator_traits<BlockAllocator>;
+
+  PointerBlock(Y* ptr, Deleter deleter, const BlockAllocator& alloc)
+      : ptr_(ptr), deleter_(std::move(deleter)), alloc_(alloc) {}
+
+ private:
+  void destroy_object() noexcept override { deleter_(ptr_); }
+
+  void deallocate() noexcept override {
+    BlockAllocator alloc(alloc_);
+    BlockTraits::destroy(alloc, this);
+    BlockTraits::deallocate(alloc, this, 1);
+  }
+
+  Y* ptr_;
+  [[no_unique_address]] Deleter deleter_;
+  [[no_unique_address]] BlockAllocator alloc_;
+};
+
+// Block with the object stored inline, made by allocateShared.
+template <typename Policy, typename T, typename Allocator>
+class InplaceBlock final : public ControlBlock<Policy> {
+ public:
+  using ValueAllocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<std::remove_cv_t<T>>;
+  using ValueTraits = std::allocator_traits<ValueAllocator>;
+  using BlockAllocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<InplaceBlock>;
+  using BlockTraits = std::allocator_traits<BlockAllocator>;
+
+  explicit InplaceBlock(const BlockAllocator& alloc) : alloc_(alloc) {}
+
+  // Separate from the constructor so that the block can be freed by the
+  // caller if the object's constructor throws.
+  template <typename... Args>
+  T* construct(Args&&... args) {
+    ValueAllocator alloc(alloc_);
+    auto* raw = reinterpret_cast<std::remove_cv_t<T>*>(bytes_);
+    ValueTraits::construct(alloc, raw, std::forward<Args>(args)...);
+    return value();
+  }
+
+  T* value() noexcept { return std::launder(reinterpret_cast<T*>(bytes_)); }
+
+ private:
+  void destroy_object() noexcept override {
+    ValueAllocator alloc(alloc_);
+    ValueTraits::destroy(alloc, const_cast<std::remove_cv_t<T>*>(value()));
+  }
+
+  void deallocate() noexcept override {
+    BlockAllocator alloc(alloc_);
+    BlockTraits::destroy(alloc, this);
+    BlockTraits::deallocate(alloc, this, 1);
+  }
+
+  [[no_unique_address]] BlockAllocator alloc_;
+  alignas(T) std::byte bytes_[sizeof(T)];
+};
+
+}  // namespace smartpointers_detail
+
+template <typename T, typename Policy>
+class SharedPtr {
+  using ControlBlock = smartpointers_detail::ControlBlock<Policy>;
+
+ public:
+  using element_type = T;
+  using weak_type = WeakPtr<T, Policy>;
+
+  SharedPtr() noexcept = default;
+  SharedPtr(std::nullptr_t) noexcept {}  // NOLINT(google-explicit-constructor)
+
+  template <typename Y>
+    requires std::is_convertible_v<Y*, T*>
+  explicit SharedPtr(Y* ptr) : SharedPtr(ptr, std::default_delete<Y>()) {}
+
+  template <typename Y, typename Deleter>
+    requires std::is_convertible_v<Y*, T*>
+  SharedPtr(Y* ptr, Deleter deleter)
+      : SharedPtr(ptr, std::move(deleter), std::allocator<Y>()) {}
+
+  template <typename Y, typename Deleter, typename Allocator>
+    requires std::is_convertible_v<Y*, T*>
+  SharedPtr(Y* ptr, Deleter deleter, const Allocator& alloc) : ptr_(ptr) {
+    using Block = smartpointers_detail::PointerBlock<Policy, Y, Deleter, Allocator>;
+    typename Block::BlockAllocator block_alloc(alloc);
+    Block* block = nullptr;
+    try {
+      block = Block::BlockTraits::allocate(block_alloc, 1);
+    } catch (...) {
+      deleter(ptr);
+      throw;
+    }
+    Block::BlockTraits::construct(block_alloc, block, ptr, std::move(deleter),
+                                  block_alloc);
+    block_ = block;
+    enable_shared_from_this(ptr);
+  }
+
+  template <typename Y, typename Deleter>
+    requires std::is_convertible_v<typename std::unique_ptr<Y, Deleter>::pointer, T*>
+  SharedPtr(std::unique_ptr<Y, Deleter>&& owner)  // NOLINT(google-explicit-constructor)
+      : SharedPtr() {
+    if (owner) {
+      using Stored = std::conditional_t<std::is_reference_v<Deleter>,
+                                        std::reference_wrapper<std::remove_reference_t<Deleter>>,
+                                        Deleter>;
+      using Block = smartpointers_detail::PointerBlock<Policy, Y, Stored, std::allocator<Y>>;
+      // If the block cannot be allocated, `owner` keeps the object.
+      typename Block::BlockAllocator block_alloc;
+      Block* block = Block::BlockTraits::allocate(block_alloc, 1);
+      Y* ptr = owner.release();
+      Block::BlockTraits::construct(block_alloc, block, ptr, Stored(owner.get_deleter()),
+                                    block_alloc);
+      ptr_ = ptr;
+      block_ = block;
+      enable_shared_from_this(ptr);
+    }
+  }
+
+  // Shares ownership with `owner` but points at `ptr`, usually a member of
+  // the owned object.
+  template <typename Y>
+  SharedPtr(const SharedPtr<Y, Policy>& owner, T* ptr) noexcept
+      : ptr_(ptr), block_(owner.block_) {
+    if (block_ != nullptr) {
+      block_->add_shared();
+    }
+  }
+
+  template <typename Y>
+  SharedPtr(SharedPtr<Y, Policy>&& owner, T* ptr) noexcept
+      : ptr_(ptr), block_(std::exchange(owner.block_, nullptr)) {
+    owner.ptr_ = nullptr;
+  }
+
+  SharedPtr(const SharedPtr& other) noexcept : SharedPtr(other, other.ptr_) {}
+  SharedPtr(SharedPtr&& other) noexcept
+      : ptr_(std::exchange(other.ptr_, nullptr)),
+        block_(std::exchange(other.block_, nullptr)) {}
+
+  template <typename Y>
+    requires std::is_convertible_v<Y*, T*>
+  SharedPtr(const SharedPtr<Y, Policy>& other) noexcept  // NOLINT(google-explicit-constructor)
+      : SharedPtr(other, other.ptr_) {}
+
+  template <typename Y>
+    requires std::is_convertible_v<Y*, T*>
+  SharedPtr(SharedPtr<Y, Policy>&& other) noexcept  // NOLINT(google-explicit-constructor)
+      : ptr_(std::exchange(other.ptr_, nullptr)),
+        block_(std::exchange(other.block_, nullptr)) {}
+
+  // Throws std::bad_weak_ptr if the object is already gone.
+  template <typename Y>
+    requires std::is_convertible_v<Y*, T*>
+  explicit SharedPtr(const WeakPtr<Y, Policy>& weak) {
+    if (weak.block_ == nullptr || !weak.block_->try_add_shared()) {
+      throw std::bad_weak_ptr();
+    }
+    ptr_ = weak.ptr_;
+    block_ = weak.block_;
+  }
+
+  ~SharedPtr() {
+    if (block_ != nullptr) {
+      block_->release_shared();
+    }
+  }
+
+  SharedPtr& operator=(const SharedPtr& other) noexcept {
+    SharedPtr(other).swap(*this);
+    return *this;
+  }
+  SharedPtr& operator=(SharedPtr&& other) noexcept {
+    SharedPtr(std::move(other)).swap(*this);
+    return *this;
+  }
+  template <typename Y>
+  SharedPtr& operator=(const SharedPtr<Y, Policy>& other) noexcept {
+    SharedPtr(other).swap(*this);
+    return *this;
+  }
+  template <typename Y>
+  SharedPtr& operator=(SharedPtr<Y, Policy>&& other) noexcept {
+    SharedPtr(std::move(other)).swap(*this);
+    return *this;
+  }
+  template <typename Y, typename Deleter>
+  SharedPtr& operator=(std::unique_ptr<Y, Deleter>&& owner) {
+    SharedPtr(std::move(owner)).swap(*this);
+    return *this;
+  }
+
+  void reset() noexcept { SharedPtr().swap(*this); }
+  template <typename Y>
+  void reset(Y* ptr) {
+    SharedPtr(ptr).swap(*this);
+  }
+  template <typename Y, typename Deleter>
+  void reset(Y* ptr, Deleter deleter) {
+    SharedPtr(ptr, std::move(deleter)).swap(*this);
+  }
+  template <typename Y, typename Deleter, typename Allocator>
+  void reset(Y* ptr, Deleter deleter, const Allocator& alloc) {
+    SharedPtr(ptr, std::move(deleter), alloc).swap(*this);
+  }
+
+  void swap(SharedPtr& other) noexcept {
+    std::swap(ptr_, other.ptr_);
+    std::swap(block_, other.block_);
+  }
+  friend void swap(SharedPtr& lhs, SharedPtr& rhs) noexcept { lhs.swap(rhs); }
+
+  T* get() const noexcept { return ptr_; }
+  template <typename U = T>
+    requires(!std::is_void_v<U>)
+  U& operator*() const noexcept {
+    return *ptr_;
+  }
+  T* operator->() const noexcept { return ptr_; }
+  explicit operator bool() const noexcept { return ptr_ != nullptr; }
+
+  long use_count() const noexcept { return block_ != nullptr ? block_->use_count() : 0; }
+
+  template <typename Y>
+  bool owner_before(const SharedPtr<Y, Policy>& other) const noexcept {
+    return std::less<>()(block_, other.block_);
+  }
+  template <typename Y>
+  bool owner_before(const WeakPtr<Y, Policy>& other) const noexcept {
+    return std::less<>()(block_, other.block_);
+  }
+
+  template <typename U>
+  friend bool operator==(const SharedPtr& lhs, const SharedPtr<U, Policy>& rhs) noexcept {
+    return lhs.get() == rhs.get();
+  }
+  template <typename U>
+  friend std::strong_ordering operator<=>(const SharedPtr& lhs,
+                                          const SharedPtr<U, Policy>& rhs) noexcept {
+    return std::compare_three_way()(lhs.get(), rhs.get());
+  }
+  friend bool operator==(const SharedPtr& lhs, std::nullptr_t) noexcept { return !lhs; }
+  friend std::strong_ordering operator<=>(const SharedPtr& lhs, std::nullptr_t) noexcept {
+    return std::compare_three_way()(lhs.get(), static_cast<T*>(nullptr));
+  }
+
+ private:
+  template <typename, typename>
+  friend class SharedPtr;
+  template <typename, typename>
+  friend class WeakPtr;
+  template <typename>
+  friend class AtomicSharedPtr;
+  template <typename U, typename P, typename Allocator, typename... Args>
+  friend SharedPtr<U, P> allocateShared(const Allocator& alloc, Args&&... args);
+
+  SharedPtr(T* ptr, ControlBlock* block) noexcept : ptr_(ptr), block_(block) {}
+
+  // Points the object's EnableSharedFromThis base, if any, at this owner.
+  template <typename Y>
+  void enable_shared_from_this(Y* ptr) noexcept {
+    if constexpr (requires { shared_from_this_base(ptr); }) {
+      if (ptr != nullptr) {
+        shared_from_this_base(ptr)->adopt(*this);
+      }
+    }
+  }
+
+  T* ptr_ = nullptr;
+  ControlBlock* block_ = nullptr;
+};
+
+template <typename T, typename Policy>
+class WeakPtr {
+  using ControlBlock = smartpointers_detail::ControlBlock<Policy>;
+
+ public:
+  using element_type = T;
+
+  WeakPtr() noexcept = default;
+
+  template <typename Y>
+    requires std::is_convertible_v<Y*, T*>
+  WeakPtr(const SharedPtr<Y, Policy>& shared) noexcept  // NOLINT(google-explicit-constructor)
+      : ptr_(shared.ptr_), block_(shared.block_) {
+    if (block_ != nullptr) {
+      block_->add_weak();
+    }
+  }
+
+  WeakPtr(const WeakPtr& other) noexcept : ptr_(other.ptr_), block_(other.block_) {
+    if (block_ != nullptr) {
+      block_->add_weak();
+    }
+  }
+  WeakPtr(WeakPtr&& other) noexcept
+      : ptr_(std::exchange(other.ptr_, nullptr)),
+        block_(std::exchange(other.block_, nullptr)) {}
+
+  // Going through lock() because a virtual base of an expired object cannot
+  // be reached from a pointer to the derived type.
+  template <typename Y>
+    requires std::is_convertible_v<Y*, T*>
+  WeakPtr(const WeakPtr<Y, Policy>& other) noexcept  // NOLINT(google-explicit-constructor)
+      : block_(other.block_) {
+    if (block_ != nullptr) {
+      block_->add_weak();
+      ptr_ = other.lock().get();
+    }
+  }
+  template <typename Y>
+    requires std::is_convertible_v<Y*, T*>
+  WeakPtr(WeakPtr<Y, Policy>&& other) noexcept  // NOLINT(google-explicit-constructor)
+      : WeakPtr(other) {
+    other.reset();
+  }
+
+  ~WeakPtr() {
+    if (block_ != nullptr) {
+      block_->release_weak();
+    }
+  }
+
+  WeakPtr& operator=(const WeakPtr& other) noexcept {
+    WeakPtr(other).swap(*this);
+    return *this;
+  }
+  WeakPtr& operator=(WeakPtr&& other) noexcept {
+    WeakPtr(std::move(other)).swap(*this);
+    return *this;
+  }
+  template <typename Y>
+  WeakPtr& operator=(const WeakPtr<Y, Policy>& other) noexcept {
+    WeakPtr(other).swap(*this);
+    return *this;
+  }
+  template <typename Y>
+  WeakPtr& operator=(WeakPtr<Y, Policy>&& other) noexcept {
+    WeakPtr(std::move(other)).swap(*this);
+    return *this;
+  }
+  template <typename Y>
+  WeakPtr& operator=(const SharedPtr<Y, Policy>& shared) noexcept {
+    WeakPtr(shared).swap(*this);
+    return *this;
+  }
+
+  void reset() noexcept { WeakPtr().swap(*this); }
+
+  void swap(WeakPtr& other) noexcept {
+    std::swap(ptr_, other.ptr_);
+    std::swap(block_, other.block_);
+  }
+  friend void swap(WeakPtr& lhs, WeakPtr& rhs) noexcept { lhs.swap(rhs); }
+
+  long use_count() const noexcept { return block_ != nullptr ? block_->use_count() : 0; }
+  bool expired() const noexcept { return use_count() == 0; }
+
+  SharedPtr<T, Policy> lock() const noexcept {
+    if (block_ != nullptr && block_->try_add_shared()) {
+      return SharedPtr<T, Policy>(ptr_, block_);
+    }
+    return SharedPtr<T, Policy>();
+  }
+
+  template <typename Y>
+  bool owner_before(const SharedPtr<Y, Policy>& other) const noexcept {
+    return std::less<>()(block_, other.block_);
+  }
+  template <typename Y>
+  bool owner_before(const WeakPtr<Y, Policy>& other) const noexcept {
+    return std::less<>()(block_, other.block_);
+  }
+
+ private:
+  template <typename, typename>
+  friend class SharedPtr;
+  template <typename, typename>
+  friend class WeakPtr;
+
+  T* ptr_ = nullptr;
+  ControlBlock* block_ = nullptr;
+};
+
+// Base for objects that need to hand out owners of themselves. Only works
+// while some SharedPtr owns the object.
+template <typename T, typename Policy>
+class EnableSharedFromThis {
+ public:
+  SharedPtr<T, Policy> shared_from_this() { return SharedPtr<T, Policy>(weak_this_); }
+  SharedPtr<const T, Policy> shared_from_this() const {
+    return SharedPtr<const T, Policy>(weak_this_);
+  }
+  WeakPtr<T, Policy> weak_from_this() noexcept { return weak_this_; }
+  WeakPtr<const T, Policy> weak_from_this() const noexcept { return weak_this_; }
+
+ protected:
+  EnableSharedFromThis() noexcept = default;
+  EnableSharedFromThis(const EnableSharedFromThis&) noexcept {}
+  EnableSharedFromThis& operator=(const EnableSharedFromThis&) noexcept { return *this; }
+  ~EnableSharedFromThis() = default;
+
+ private:
+  template <typename, typename>
+  friend class SharedPtr;
+
+  // Found by argument-dependent lookup from SharedPtr for any type derived
+  // from EnableSharedFromThis.
+  friend const EnableSharedFromThis* shared_from_this_base(
+      const EnableSharedFromThis* base) noexcept {
+    return base;
+  }
+
+  template <typename Y, typename P>
+  void adopt(const SharedPtr<Y, P>& owner) const noexcept {
+    static_assert(std::is_same_v<P, Policy>,
+                  "EnableSharedFromThis and SharedPtr use different count policies");
+    if (weak_this_.expired()) {
+      weak_this_ = SharedPtr<T, Policy>(owner, const_cast<T*>(static_cast<const T*>(this)));
+    }
+  }
+
+  mutable WeakPtr<T, Policy> weak_this_;
+};
+
+// Creates the object and its control block in one allocation from `alloc`.
+template <typename T, typename Policy, typename Allocator, typename... Args>
+SharedPtr<T, Policy> allocateShared(const Allocator& alloc, Args&&... args) {
+  using Block = smartpointers_detail::InplaceBlock<Policy, T, Allocator>;
+  typename Block::BlockAllocator block_alloc(alloc);
+  Block* block = Block::BlockTraits::allocate(block_alloc, 1);
+  Block::BlockTraits::construct(block_alloc, block, block_alloc);
+  T* value = nullptr;
+  try {
+    value = block->construct(std::forward<Args>(args)...);
+  } catch (...) {
+    Block::BlockTraits::destroy(block_alloc, block);
+    Block::BlockTraits::deallocate(block_alloc, block, 1);
+    throw;
+  }
+  smartpointers_detail::ControlBlock<Policy>* base = block;
+  SharedPtr<T, Policy> result(value, base);
+  result.enable_shared_from_this(value);
+  return result;
+}
+
+template <typename T, typename Policy = AtomicCount, typename... Args>
+SharedPtr<T, Policy> makeShared(Args&&... args) {
+  return allocateShared<T, Policy>(std::allocator<T>(), std::forward<Args>(args)...);
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> staticPointerCast(const SharedPtr<U, Policy>& ptr) noexcept {
+  return SharedPtr<T, Policy>(ptr, static_cast<T*>(ptr.get()));
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> dynamicPointerCast(const SharedPtr<U, Policy>& ptr) noexcept {
+  if (auto* cast = dynamic_cast<T*>(ptr.get())) {
+    return SharedPtr<T, Policy>(ptr, cast);
+  }
+  return SharedPtr<T, Policy>();
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> constPointerCast(const SharedPtr<U, Policy>& ptr) noexcept {
+  return SharedPtr<T, Policy>(ptr, const_cast<T*>(ptr.get()));
+}
@@ -0,0 +1,406 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "SmartPointers/atomicsharedptr.h"
+#include "SmartPointers/intrusiveptr.h"
+#include "SmartPointers/smartpointers.h"
+
+namespace {
+
+struct Counters {
+  int allocations = 0;
+  int deallocations = 0;
+};
+
+template <typename T>
+struct CountingAllocator {
+  using value_type = T;
+
+  Counters* counters;
+
+  explicit CountingAllocator(Counters* c) : counters(c) {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>& other)  // NOLINT(google-explicit-constructor)
+      : counters(other.counters) {}
+
+  T* allocate(std::size_t count) {
+    ++counters->allocations;
+    return std::allocator<T>().allocate(count);
+  }
+  void deallocate(T* pointer, std::size_t count) {
+    ++counters->deallocations;
+    std::allocator<T>().deallocate(pointer, count);
+  }
+
+  template <typename U>
+  bool operator==(const CountingAllocator<U>& other) const {
+    return counters == other.counters;
+  }
+};
+
+struct Tracked {
+  static inline int alive = 0;
+  int value;
+
+  explicit Tracked(int v = 0) : value(v) { ++alive; }
+  virtual ~Tracked() { --alive; }
+};
+
+struct Derived : Tracked {
+  using Tracked::Tracked;
+};
+
+struct ThrowsOnBuild {
+  ThrowsOnBuild() { throw std::runtime_error("ThrowsOnBuild"); }
+};
+
+struct Self : EnableSharedFromThis<Self> {
+  int value = 3;
+};
+
+TEST(SharedPtr, MakeSharedUsesOneAllocation) {
+  Counters counters;
+  WeakPtr<Tracked> weak;
+  {
+    auto shared = allocateShared<Tracked>(CountingAllocator<Tracked>(&counters), 7);
+    EXPECT_EQ(counters.allocations, 1);
+    EXPECT_EQ(shared->value, 7);
+    EXPECT_EQ(shared.use_count(), 1);
+    weak = shared;
+  }
+  EXPECT_EQ(Tracked::alive, 0);
+  EXPECT_TRUE(weak.expired());
+  EXPECT_EQ(counters.deallocations, 0);
+  weak.reset();
+  EXPECT_EQ(counters.deallocations, 1);
+}
+
+TEST(SharedPtr, ThrowingConstructorFreesTheBlock) {
+  Counters counters;
+  EXPECT_THROW(allocateShared<ThrowsOnBuild>(CountingAllocator<ThrowsOnBuild>(&counters)),
+               std::runtime_error);
+  EXPECT_EQ(counters.allocations, 1);
+  EXPECT_EQ(counters.deallocations, 1);
+}
+
+TEST(SharedPtr, CountsCopiesAndMoves) {
+  auto first = makeShared<Tracked>(1);
+  SharedPtr<Tracked> second = first;
+  EXPECT_EQ(first.use_count(), 2);
+  SharedPtr<Tracked> third = std::move(second);
+  EXPECT_FALSE(second);  // NOLINT(bugprone-use-after-move)
+  EXPECT_EQ(first.use_count(), 2);
+  EXPECT_EQ(first, third);
+  third.reset();
+  EXPECT_EQ(first.use_count(), 1);
+  first = first;
+  EXPECT_EQ(first.use_count(), 1);
+  first = nullptr;
+  EXPECT_EQ(Tracked::alive, 0);
+  EXPECT_EQ(first, nullptr);
+}
+
+TEST(SharedPtr, CustomDeleterAndUniquePtr) {
+  int deleted = 0;
+  {
+    SharedPtr<Tracked> owner(new Tracked(2), [&](Tracked* ptr) {
+      ++deleted;
+      delete ptr;
+    });
+    SharedPtr<Tracked> copy = owner;
+  }
+  EXPECT_EQ(deleted, 1);
+
+  SharedPtr<Tracked> adopted = std::make_unique<Derived>(4);
+  EXPECT_EQ(adopted->value, 4);
+  adopted.reset();
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(WeakPtr, LockAndBadWeakPtr) {
+  WeakPtr<Tracked> weak;
+  EXPECT_FALSE(weak.lock());
+  {
+    auto shared = makeShared<Tracked>(5);
+    weak = shared;
+    EXPECT_EQ(weak.use_count(), 1);
+    auto locked = weak.lock();
+    EXPECT_EQ(locked->value, 5);
+    EXPECT_EQ(shared.use_count(), 2);
+    SharedPtr<Tracked> from_weak(weak);
+    EXPECT_EQ(shared.use_count(), 3);
+  }
+  EXPECT_TRUE(weak.expired());
+  EXPECT_FALSE(weak.lock());
+  EXPECT_THROW(SharedPtr<Tracked>{weak}, std::bad_weak_ptr);
+}
+
+TEST(SharedPtr, AliasingAndCasts) {
+  struct Pair {
+    int first = 1;
+    int second = 2;
+  };
+  auto pair = makeShared<Pair>();
+  SharedPtr<int> member(pair, &pair->second);
+  pair.reset();
+  EXPECT_EQ(*member, 2);
+  EXPECT_EQ(member.use_count(), 1);
+
+  SharedPtr<Tracked> base = makeShared<Derived>(8);
+  auto derived = dynamicPointerCast<Derived>(base);
+  ASSERT_TRUE(derived);
+  EXPECT_EQ(base.use_count(), 2);
+  EXPECT_EQ(staticPointerCast<Derived>(base)->value, 8);
+  EXPECT_FALSE(dynamicPointerCast<Derived>(makeShared<Tracked>(0)));
+  SharedPtr<const Tracked> constant = base;
+  EXPECT_EQ(constPointerCast<Tracked>(constant), base);
+}
+
+TEST(SharedPtr, OwnerOrdering) {
+  auto a = makeShared<int>(1);
+  SharedPtr<int> alias(a, a.get());
+  auto b = makeShared<int>(1);
+  EXPECT_FALSE(a.owner_before(alias) || alias.owner_before(a));
+  EXPECT_TRUE(a.owner_before(b) || b.owner_before(a));
+  WeakPtr<int> weak = a;
+  EXPECT_FALSE(weak.owner_before(a) || a.owner_before(weak));
+}
+
+TEST(EnableSharedFromThis, SharesTheExistingBlock) {
+  auto self = makeShared<Self>();
+  auto again = self->shared_from_this();
+  EXPECT_EQ(again, self);
+  EXPECT_EQ(self.use_count(), 2);
+  EXPECT_FALSE(self->weak_from_this().expired());
+
+  SharedPtr<Self> owned(new Self);
+  EXPECT_EQ(owned->shared_from_this().use_count(), 2);
+
+  Self unowned;
+  EXPECT_TRUE(unowned.weak_from_this().expired());
+  EXPECT_THROW(unowned.shared_from_this(), std::bad_weak_ptr);
+}
+
+TEST(SharedPtr, PlainCountOnOneThread) {
+  std::vector<SharedPtr<Tracked, PlainCount>> owners(3, makeShared<Tracked, PlainCount>(9));
+  WeakPtr<Tracked, PlainCount> weak = owners.front();
+  EXPECT_EQ(weak.use_count(), 3);
+  EXPECT_EQ(weak.lock()->value, 9);
+  owners.clear();
+  EXPECT_TRUE(weak.expired());
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(SharedPtr, AtomicCountSurvivesThreads) {
+  auto shared = makeShared<Tracked>(1);
+  WeakPtr<Tracked> weak = shared;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([shared] {
+      for (int i = 0; i < 20000; ++i) {
+        SharedPtr<Tracked> copy = shared;
+        WeakPtr<Tracked> observer = copy;
+        EXPECT_TRUE(observer.lock());
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(shared.use_count(), 1);
+  shared.reset();
+  EXPECT_TRUE(weak.expired());
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+struct Node : RefCounted<Node> {
+  static inline int alive = 0;
+  int value;
+
+  explicit Node(int v = 0) : value(v) { ++alive; }
+  Node(const Node& other) : RefCounted(other), value(other.value) { ++alive; }
+  virtual ~Node() { --alive; }
+
+  IntrusivePtr<Node> self() { return IntrusivePtr<Node>(this); }
+};
+
+struct Leaf : Node {
+  using Node::Node;
+};
+
+// Opts in through its own pair of functions instead of RefCounted.
+struct Handle {
+  int refs = 0;
+  bool freed = false;
+};
+void intrusivePtrAddRef(const Handle* handle) noexcept { ++const_cast<Handle*>(handle)->refs; }
+void intrusivePtrRelease(const Handle* handle) noexcept {
+  auto* mutable_handle = const_cast<Handle*>(handle);
+  if (--mutable_handle->refs == 0) {
+    mutable_handle->freed = true;
+  }
+}
+
+TEST(IntrusivePtr, CountsLiveInTheObject) {
+  static_assert(sizeof(IntrusivePtr<Node>) == sizeof(void*));
+  {
+    auto first = makeIntrusive<Node>(1);
+    EXPECT_EQ(first->use_count(), 1);
+    IntrusivePtr<Node> second = first;
+    IntrusivePtr<Node> from_this = second->self();
+    EXPECT_EQ(first->use_count(), 3);
+    IntrusivePtr<Node> moved = std::move(second);
+    EXPECT_FALSE(second);  // NOLINT(bugprone-use-after-move)
+    EXPECT_EQ(moved, first);
+    EXPECT_EQ(first->use_count(), 3);
+  }
+  EXPECT_EQ(Node::alive, 0);
+}
+
+TEST(IntrusivePtr, DetachAndAdopt) {
+  auto owner = makeIntrusive<Node>(2);
+  Node* raw = owner.detach();
+  EXPECT_FALSE(owner);
+  EXPECT_EQ(raw->use_count(), 1);
+  IntrusivePtr<Node> adopted(raw, false);
+  EXPECT_EQ(adopted->use_count(), 1);
+  adopted.reset();
+  EXPECT_EQ(Node::alive, 0);
+}
+
+TEST(IntrusivePtr, CopiedObjectsStartUnowned) {
+  auto original = makeIntrusive<Node>(3);
+  IntrusivePtr<Node> extra = original;
+  auto copy = makeIntrusive<Node>(*original);
+  EXPECT_EQ(copy->use_count(), 1);
+  EXPECT_EQ(copy->value, 3);
+  EXPECT_EQ(original->use_count(), 2);
+}
+
+TEST(IntrusivePtr, CastsAndCustomCounting) {
+  IntrusivePtr<Node> base = makeIntrusive<Leaf>(4);
+  auto leaf = dynamicPointerCast<Leaf>(base);
+  ASSERT_TRUE(leaf);
+  EXPECT_EQ(base->use_count(), 2);
+  EXPECT_EQ(staticPointerCast<Leaf>(base)->value, 4);
+  EXPECT_FALSE(dynamicPointerCast<Leaf>(makeIntrusive<Node>()));
+  EXPECT_EQ(std::hash<IntrusivePtr<Node>>{}(base), std::hash<Node*>{}(base.get()));
+
+  Handle handle;
+  {
+    IntrusivePtr<Handle> first(&handle);
+    IntrusivePtr<Handle> second = first;
+    EXPECT_EQ(handle.refs, 2);
+  }
+  EXPECT_TRUE(handle.freed);
+}
+
+TEST(AtomicSharedPtr, LoadStoreExchange) {
+  EXPECT_TRUE(AtomicSharedPtr<int>::is_always_lock_free);
+  AtomicSharedPtr<Tracked> atomic;
+  EXPECT_FALSE(atomic.load());
+
+  atomic.store(makeShared<Tracked>(1));
+  EXPECT_EQ(atomic.load()->value, 1);
+  SharedPtr<Tracked> held = atomic;
+  auto previous = atomic.exchange(makeShared<Tracked>(2));
+  EXPECT_EQ(previous->value, 1);
+  EXPECT_EQ(previous, held);
+  EXPECT_EQ(atomic.load()->value, 2);
+
+  held.reset();
+  previous.reset();
+  EXPECT_EQ(Tracked::alive, 1);
+  atomic.store(nullptr);
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(AtomicSharedPtr, KeepsAliasingPointersExact) {
+  struct Pair {
+    int first = 1;
+    int second = 2;
+  };
+  auto pair = makeShared<Pair>();
+  AtomicSharedPtr<int> atomic(SharedPtr<int>(pair, &pair->second));
+  EXPECT_EQ(atomic.load().get(), &pair->second);
+  WeakPtr<Pair> weak = pair;
+  pair.reset();
+  EXPECT_FALSE(weak.expired());
+  atomic.store(nullptr);
+  EXPECT_TRUE(weak.expired());
+}
+
+TEST(AtomicSharedPtr, CompareExchange) {
+  auto first = makeShared<Tracked>(1);
+  auto second = makeShared<Tracked>(2);
+  AtomicSharedPtr<Tracked> atomic(first);
+
+  SharedPtr<Tracked> expected = second;
+  EXPECT_FALSE(atomic.compare_exchange_strong(expected, makeShared<Tracked>(3)));
+  EXPECT_EQ(expected, first);
+
+  EXPECT_TRUE(atomic.compare_exchange_strong(expected, second));
+  EXPECT_EQ(atomic.load(), second);
+
+  // A loaded pointer is equivalent to what was stored.
+  SharedPtr<Tracked> loaded = atomic.load();
+  EXPECT_TRUE(atomic.compare_exchange_weak(loaded, nullptr));
+  EXPECT_FALSE(atomic.load());
+}
+
+TEST(AtomicSharedPtr, ManyLoadsRefillTheBatch) {
+  AtomicSharedPtr<Tracked> atomic(makeShared<Tracked>(5));
+  for (int i = 0; i < 200000; ++i) {
+    ASSERT_EQ(atomic.load()->value, 5);
+  }
+  std::vector<SharedPtr<Tracked>> held;
+  for (int i = 0; i < 100000; ++i) {
+    held.push_back(atomic.load());
+  }
+  atomic.store(nullptr);
+  EXPECT_EQ(Tracked::alive, 1);
+  held.clear();
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(AtomicSharedPtr, ReadersAndWritersRace) {
+  {
+    AtomicSharedPtr<Tracked> atomic(makeShared<Tracked>(0));
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; ++t) {
+      threads.emplace_back([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+          SharedPtr<Tracked> value = atomic.load();
+          EXPECT_GE(value->value, 0);
+        }
+      });
+    }
+    threads.emplace_back([&] {
+      for (int i = 1; i <= 20000; ++i) {
+        if (i % 2 == 0) {
+          atomic.store(makeShared<Tracked>(i));
+        } else {
+          SharedPtr<Tracked> expected = atomic.load();
+          atomic.compare_exchange_strong(expected, makeShared<Tracked>(i));
+        }
+      }
+      stop.store(true);
+    });
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    EXPECT_EQ(atomic.load()->value, 20000);
+  }
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+}  // namespace
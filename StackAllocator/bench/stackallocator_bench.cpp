@@ -0,0 +1,85 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+
+#include "Deque/deque.h"
+#include "StackAllocator/stackallocator.h"
+
+namespace {
+
+constexpr std::size_t kArenaBytes = std::size_t{1} << 21;
+
+template <typename T>
+using Arena = StackAllocator<T, kArenaBytes>;
+
+// Builds a container of state.range(0) elements and tears it down. With the
+// arena allocator the storage is a fresh local for every iteration, like a
+// per-request arena; 2 MiB of stack is enough for the largest case.
+template <typename Container, bool UseArena>
+void run_build(benchmark::State& state) {
+  auto count = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    if constexpr (UseArena) {
+      StackStorage<kArenaBytes> storage;
+      Container container(storage);
+      for (int i = 0; i < count; ++i) {
+        container.push_back(i);
+      }
+      benchmark::DoNotOptimize(&container.back());
+    } else {
+      Container container;
+      for (int i = 0; i < count; ++i) {
+        container.push_back(i);
+      }
+      benchmark::DoNotOptimize(&container.back());
+    }
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * count);
+}
+
+void BM_ListBuild(benchmark::State& state) { run_build<std::list<int>, false>(state); }
+void BM_ListBuildArena(benchmark::State& state) {
+  run_build<std::list<int, Arena<int>>, true>(state);
+}
+void BM_DequeBuild(benchmark::State& state) { run_build<Deque<int>, false>(state); }
+void BM_DequeBuildArena(benchmark::State& state) {
+  run_build<Deque<int, Arena<int>>, true>(state);
+}
+
+BENCHMARK(BM_ListBuild)->Arg(64)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(BM_ListBuildArena)->Arg(64)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(BM_DequeBuild)->Arg(64)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(BM_DequeBuildArena)->Arg(64)->Arg(1 << 10)->Arg(1 << 16);
+
+// Inserts state.range(0) keys into a std::map, the node-per-element case
+// where malloc dominates.
+template <bool UseArena>
+void BM_MapInsert(benchmark::State& state) {
+  auto count = static_cast<int>(state.range(0));
+  using Alloc = Arena<std::pair<const int, int>>;
+  for (auto _ : state) {
+    if constexpr (UseArena) {
+      StackStorage<kArenaBytes> storage;
+      std::map<int, int, std::less<>, Alloc> map(storage);
+      for (int i = 0; i < count; ++i) {
+        map.emplace((i * 7919) % count, i);
+      }
+      benchmark::DoNotOptimize(map.size());
+    } else {
+      std::map<int, int, std::less<>> map;
+      for (int i = 0; i < count; ++i) {
+        map.emplace((i * 7919) % count, i);
+      }
+      benchmark::DoNotOptimize(map.size());
+    }
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * count);
+}
+
+BENCHMARK_TEMPLATE(BM_MapInsert, false)->Arg(1 << 10)->Arg(1 << 14);
+BENCHMARK_TEMPLATE(BM_MapInsert, true)->Arg(1 << 10)->Arg(1 << 14);
+
+}  // namespace
@@ -0,0 +1,114 @@
+#pragma once
+
+// Fixed-size arena and an allocator that carves memory out of it.
+//
+// StackStorage<N> is a buffer of N bytes, usually a local variable, served
+// by bumping an offset. StackAllocator<T, N> hands out pieces of one storage
+// and satisfies the standard Allocator requirements, so any allocator-aware
+// container can run on it without touching the heap:
+//
+//   StackStorage<1 << 16> storage;
+//   std::list<int, StackAllocator<int, 1 << 16>> list(storage);
+//
+// Deallocation only gives memory back when it is the most recent allocation;
+// everything else is reclaimed when the storage goes out of scope. A storage
+// is not synchronized: use one per thread or per request.
+//
+// With PORTFOLIO_INSTRUMENT, "stackallocator.allocate" and
+// "stackallocator.exhausted" count allocations and those that did not fit;
+// "stackallocator.reclaimed" and "stackallocator.held" count frees that
+// gave the memory back and those that left it until the storage goes.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "Instrument/instrument.h"
+
+template <std::size_t N>
+class StackStorage {
+ public:
+  // User-provided so that even value-initialization leaves the buffer alone.
+  StackStorage() noexcept {}  // NOLINT(modernize-use-equals-default)
+  StackStorage(const StackStorage&) = delete;
+  StackStorage& operator=(const StackStorage&) = delete;
+
+  // Throws std::bad_alloc when the rest of the buffer is too small.
+  void* allocate(std::size_t bytes, std::size_t alignment) {
+    auto base = reinterpret_cast<std::uintptr_t>(buffer_);
+    std::size_t start = ((base + offset_ + alignment - 1) & ~(alignment - 1)) - base;
+    if (start > N || bytes > N - start) {
+      PORTFOLIO_COUNT("stackallocator.exhausted", 1);
+      throw std::bad_alloc();
+    }
+    PORTFOLIO_COUNT("stackallocator.allocate", 1);
+    offset_ = start + bytes;
+    return buffer_ + start;
+  }
+
+  void deallocate(void* pointer, std::size_t bytes) noexcept {
+    if (static_cast<std::byte*>(pointer) + bytes == buffer_ + offset_) {
+      PORTFOLIO_COUNT("stackallocator.reclaimed", 1);
+      offset_ -= bytes;
+    } else {
+      PORTFOLIO_COUNT("stackallocator.held", 1);
+    }
+  }
+
+  std::size_t used() const { return offset_; }
+  static constexpr std::size_t capacity() { return N; }
+
+ private:
+  alignas(std::max_align_t) std::byte buffer_[N];
+  std::size_t offset_ = 0;
+};
+
+template <typename T, std::size_t N>
+class StackAllocator {
+ public:
+  using value_type = T;
+  // A container moved, copied or swapped keeps drawing from the storage its
+  // elements live in.
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  using is_always_equal = std::false_type;
+
+  template <typename U>
+  struct rebind {
+    using other = StackAllocator<U, N>;
+  };
+
+  StackAllocator(StackStorage<N>& storage)  // NOLINT(google-explicit-constructor)
+      : storage_(&storage) {}
+
+  template <typename U>
+  StackAllocator(const StackAllocator<U, N>& other)  // NOLINT(google-explicit-constructor)
+      : storage_(other.storage_) {}
+
+  T* allocate(std::size_t count) {
+    if (count > N / sizeof(T)) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(storage_->allocate(count * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* pointer, std::size_t count) noexcept {
+    storage_->deallocate(pointer, count * sizeof(T));
+  }
+
+  StackStorage<N>& storage() const { return *storage_; }
+
+  template <typename U>
+  bool operator==(const StackAllocator<U, N>& other) const {
+    return storage_ == other.storage_;
+  }
+
+ private:
+  template <typename, std::size_t>
+  friend class StackAllocator;
+
+  StackStorage<N>* storage_;
+};
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "Deque/deque.h"
+#include "StackAllocator/stackallocator.h"
+
+namespace {
+
+constexpr std::size_t kBytes = 1 << 16;
+
+template <std::size_t N>
+bool owns(const StackStorage<N>& storage, const void* pointer) {
+  auto* first = reinterpret_cast<const std::byte*>(&storage);
+  auto* address = static_cast<const std::byte*>(pointer);
+  return address >= first && address < first + sizeof(storage);
+}
+
+TEST(StackStorage, AlignsEachAllocation) {
+  StackStorage<1024> storage;
+  void* one = storage.allocate(1, 1);
+  void* wide = storage.allocate(8, 64);
+  void* word = storage.allocate(4, 4);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(wide) % 64, 0u);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(word) % 4, 0u);
+  EXPECT_LT(one, wide);
+  EXPECT_LT(wide, word);
+}
+
+TEST(StackStorage, ReclaimsOnlyTheLatestAllocation) {
+  StackStorage<1024> storage;
+  void* first = storage.allocate(100, 8);
+  void* second = storage.allocate(100, 8);
+  std::size_t used = storage.used();
+
+  storage.deallocate(first, 100);
+  EXPECT_EQ(storage.used(), used);
+  storage.deallocate(second, 100);
+  EXPECT_LT(storage.used(), used);
+  EXPECT_EQ(storage.allocate(100, 8), second);
+}
+
+TEST(StackStorage, ThrowsWhenExhausted) {
+  StackStorage<256> storage;
+  storage.allocate(200, 1);
+  std::size_t used = storage.used();
+  EXPECT_THROW(storage.allocate(100, 1), std::bad_alloc);
+  EXPECT_EQ(storage.used(), used);
+  EXPECT_THROW(storage.allocate(1, 1024), std::bad_alloc);
+  EXPECT_NO_THROW(storage.allocate(56, 1));
+  EXPECT_EQ(storage.used(), 256u);
+}
+
+TEST(StackAllocator, RejectsCountsThatOverflow) {
+  StackStorage<kBytes> storage;
+  StackAllocator<std::uint64_t, kBytes> alloc(storage);
+  EXPECT_THROW(alloc.allocate(kBytes), std::bad_alloc);
+  EXPECT_THROW(alloc.allocate(static_cast<std::size_t>(-1) / 4), std::bad_alloc);
+  EXPECT_EQ(storage.used(), 0u);
+}
+
+TEST(StackAllocator, RebindsOntoTheSameStorage) {
+  StackStorage<kBytes> storage;
+  StackAllocator<int, kBytes> ints(storage);
+  StackAllocator<double, kBytes> doubles(ints);
+  EXPECT_TRUE(ints == doubles);
+  EXPECT_EQ(&doubles.storage(), &storage);
+
+  StackStorage<kBytes> other;
+  EXPECT_FALSE((ints == StackAllocator<int, kBytes>(other)));
+}
+
+TEST(StackAllocator, StandardContainersStayInTheStorage) {
+  StackStorage<kBytes> storage;
+  std::vector<int, StackAllocator<int, kBytes>> vector(storage);
+  std::list<int, StackAllocator<int, kBytes>> list(storage);
+  std::map<int, int, std::less<>, StackAllocator<std::pair<const int, int>, kBytes>> map(storage);
+  for (int i = 0; i < 500; ++i) {
+    vector.push_back(i);
+    list.push_front(i);
+    map.emplace(i, -i);
+  }
+  EXPECT_TRUE(owns(storage, vector.data()));
+  EXPECT_TRUE(owns(storage, &list.front()));
+  EXPECT_TRUE(owns(storage, &map.at(250)));
+  EXPECT_EQ(list.back(), 0);
+  EXPECT_EQ(map.at(499), -499);
+}
+
+TEST(StackAllocator, PortfolioDequeStaysInTheStorage) {
+  StackStorage<kBytes> storage;
+  Deque<int, StackAllocator<int, kBytes>> deque(storage);
+  for (int i = 0; i < 3000; ++i) {
+    deque.push_back(i);
+    deque.push_front(-i);
+  }
+  EXPECT_TRUE(owns(storage, &deque.front()));
+  EXPECT_TRUE(owns(storage, &deque.back()));
+  EXPECT_EQ(deque[3000], 0);
+}
+
+TEST(StackAllocator, ContainersPropagateTheirStorage) {
+  StackStorage<kBytes> first;
+  StackStorage<kBytes> second;
+  using Vector = std::vector<int, StackAllocator<int, kBytes>>;
+  Vector a({1, 2, 3}, first);
+  Vector b({4, 5}, second);
+
+  a.swap(b);
+  EXPECT_EQ(&a.get_allocator().storage(), &second);
+  EXPECT_TRUE(owns(second, a.data()));
+
+  Vector c(first);
+  c = std::move(a);
+  EXPECT_EQ(&c.get_allocator().storage(), &second);
+  EXPECT_EQ(c, (Vector({4, 5}, second)));
+}
+
+TEST(StackAllocator, VectorThatOutgrowsTheStorageThrows) {
+  StackStorage<1024> storage;
+  std::vector<int, StackAllocator<int, 1024>> vector(storage);
+  EXPECT_THROW(
+      {
+        for (int i = 0; i < 1000; ++i) {
+          vector.push_back(i);
+        }
+      },
+      std::bad_alloc);
+  EXPECT_FALSE(vector.empty());
+  EXPECT_EQ(vector.front(), 0);
+}
+
+}  // namespace
@@ -0,0 +1,221 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "String/string.h"
+
+namespace {
+
+std::vector<std::string> random_keys(std::size_t count, std::size_t length) {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> letter('a', 'z');
+  std::vector<std::string> keys(count, std::string(length, ' '));
+  for (std::string& key : keys) {
+    for (char& c : key) {
+      c = static_cast<char>(letter(gen));
+    }
+  }
+  return keys;
+}
+
+std::string haystack(std::size_t size) {
+  std::string text = random_keys(1, size)[0];
+  return text;
+}
+
+// Copies a batch of keys of state.range(0) characters.
+template <typename Str>
+void BM_Copy(benchmark::State& state) {
+  std::vector<Str> keys;
+  for (const std::string& key :
+       random_keys(1024, static_cast<std::size_t>(state.range(0)))) {
+    keys.emplace_back(key.c_str());
+  }
+  for (auto _ : state) {
+    std::vector<Str> copies(keys);
+    benchmark::DoNotOptimize(copies.data());
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * 1024);
+}
+
+BENCHMARK_TEMPLATE(BM_Copy, std::string)->Arg(8)->Arg(22)->Arg(23)->Arg(64);
+BENCHMARK_TEMPLATE(BM_Copy, String)->Arg(8)->Arg(22)->Arg(23)->Arg(64);
+
+// Builds a string of state.range(0) characters one char at a time.
+template <typename Str>
+void BM_AppendChar(benchmark::State& state) {
+  auto length = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    Str str;
+    for (std::size_t i = 0; i < length; ++i) {
+      str.push_back('x');
+    }
+    benchmark::DoNotOptimize(str.data());
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_AppendChar, std::string)->Arg(16)->Arg(23)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_AppendChar, String)->Arg(16)->Arg(23)->Arg(4096);
+
+// Concatenates short words into one long string.
+template <typename Str>
+void BM_AppendWords(benchmark::State& state) {
+  std::vector<std::string> words = random_keys(256, 7);
+  for (auto _ : state) {
+    Str str;
+    for (const std::string& word : words) {
+      str += word.c_str();
+      str += ' ';
+    }
+    benchmark::DoNotOptimize(str.data());
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_AppendWords, std::string);
+BENCHMARK_TEMPLATE(BM_AppendWords, String);
+
+template <typename Str>
+void BM_FindChar(benchmark::State& state) {
+  Str text(haystack(static_cast<std::size_t>(state.range(0))).c_str());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(text.find('#'));
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_FindChar, std::string)->Arg(64)->Arg(4096)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_FindChar, String)->Arg(64)->Arg(4096)->Arg(1 << 20);
+
+template <typename Str>
+void BM_FindSubstring(benchmark::State& state) {
+  Str text(haystack(static_cast<std::size_t>(state.range(0))).c_str());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(text.find("needle"));
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_FindSubstring, std::string)
+    ->Arg(64)->Arg(4096)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_FindSubstring, String)->Arg(64)->Arg(4096)->Arg(1 << 20);
+
+// Takes every 8-character window: a copy for std::string, a view for String.
+template <typename Str>
+void BM_Substr(benchmark::State& state) {
+  Str text(haystack(4096).c_str());
+  for (auto _ : state) {
+    for (std::size_t pos = 0; pos + 8 <= 4096; pos += 8) {
+      auto piece = text.substr(pos, 8);
+      benchmark::DoNotOptimize(piece.data());
+    }
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_Substr, std::string);
+BENCHMARK_TEMPLATE(BM_Substr, String);
+
+using string_detail::SearchIsa;
+
+// Runs the kernels of the instruction set given by state.range(0).
+bool select_isa(benchmark::State& state) {
+  auto isa = static_cast<SearchIsa>(state.range(0));
+  if (!string_detail::select_search_isa(isa)) {
+    state.SkipWithError("instruction set not supported");
+    return false;
+  }
+  constexpr const char* kNames[] = {"scalar", "sse2", "avx2", "neon"};
+  state.SetLabel(kNames[state.range(0)]);
+  return true;
+}
+
+void isa_args(benchmark::internal::Benchmark* bench) {
+  for (auto isa : {SearchIsa::Scalar, SearchIsa::Sse2, SearchIsa::Avx2,
+                   SearchIsa::Neon}) {
+    bench->Args({static_cast<std::int64_t>(isa), 1 << 20});
+  }
+}
+
+void BM_FindCharIsa(benchmark::State& state) {
+  if (!select_isa(state)) {
+    return;
+  }
+  String text(haystack(static_cast<std::size_t>(state.range(1))).c_str());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(text.find('#'));
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          state.range(1));
+}
+
+BENCHMARK(BM_FindCharIsa)->Apply(isa_args);
+
+void BM_FindSubstringIsa(benchmark::State& state) {
+  if (!select_isa(state)) {
+    return;
+  }
+  String text(haystack(static_cast<std::size_t>(state.range(1))).c_str());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(text.find("needle"));
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          state.range(1));
+}
+
+BENCHMARK(BM_FindSubstringIsa)->Apply(isa_args);
+
+// Comma-separated fields of 1 to 16 characters.
+std::string csv_line(std::size_t size) {
+  std::string text = haystack(size);
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<std::size_t> gap(1, 16);
+  for (std::size_t pos = gap(gen); pos < size; pos += gap(gen)) {
+    text[pos] = ',';
+  }
+  return text;
+}
+
+void BM_SplitIsa(benchmark::State& state) {
+  if (!select_isa(state)) {
+    return;
+  }
+  String text(csv_line(static_cast<std::size_t>(state.range(1))).c_str());
+  for (auto _ : state) {
+    std::size_t total = 0;
+    for (StringView field : text.split(',')) {
+      total += field.size();
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          state.range(1));
+}
+
+BENCHMARK(BM_SplitIsa)->Apply(isa_args);
+
+// The usual find-in-a-loop split over std::string_view, for reference.
+void BM_SplitStdFind(benchmark::State& state) {
+  std::string text = csv_line(1 << 20);
+  for (auto _ : state) {
+    std::string_view rest(text);
+    std::size_t total = 0;
+    for (std::size_t end; (end = rest.find(',')) != std::string_view::npos;
+         rest.remove_prefix(end + 1)) {
+      total += end;
+    }
+    total += rest.size();
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          (1 << 20));
+}
+
+BENCHMARK(BM_SplitStdFind);
+
+}  // namespace
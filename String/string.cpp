@@ -0,0 +1,165 @@
+#include "String/string.h"
+
+#include <cctype>
+#include <istream>
+#include <ostream>
+
+String::String(std::size_t count, char c) {
+  set_short_size(0);
+  append(count, c);
+}
+
+String::String(StringView view) {
+  set_short_size(0);
+  append(view);
+}
+
+String::String(const String& other) {
+  if (other.is_short()) {
+    rep_ = other.rep_;
+    return;
+  }
+  set_short_size(0);
+  append(other);
+}
+
+String& String::operator=(const String& other) {
+  if (this == &other) {
+    return *this;
+  }
+  if (other.is_short() && is_short()) {
+    rep_ = other.rep_;
+    return *this;
+  }
+  clear();
+  append(other);
+  return *this;
+}
+
+String& String::operator=(String&& other) noexcept {
+  if (this != &other) {
+    if (!is_short()) {
+      delete[] rep_.long_rep.data;
+    }
+    rep_ = other.rep_;
+    other.set_short_size(0);
+  }
+  return *this;
+}
+
+String::~String() {
+  if (!is_short()) {
+    delete[] rep_.long_rep.data;
+  }
+}
+
+void String::reallocate(std::size_t new_capacity) {
+  std::size_t old_size = size();
+  char* buffer = new char[new_capacity + 1];
+  std::memcpy(buffer, data(), old_size);
+  buffer[old_size] = '\0';
+  if (!is_short()) {
+    delete[] rep_.long_rep.data;
+  }
+  rep_.long_rep = Long{buffer, old_size, new_capacity | kLongFlag};
+}
+
+void String::grow_for(std::size_t extra) {
+  std::size_t required = size() + extra;
+  std::size_t current = capacity();
+  if (required > current) {
+    reallocate(std::max(required, 2 * current));
+  }
+}
+
+void String::reserve(std::size_t new_capacity) {
+  if (new_capacity > capacity()) {
+    reallocate(new_capacity);
+  }
+}
+
+void String::shrink_to_fit() {
+  if (is_short()) {
+    return;
+  }
+  std::size_t current = size();
+  if (current <= kShortCapacity) {
+    char* heap = rep_.long_rep.data;
+    std::memcpy(rep_.short_rep.data, heap, current);
+    set_short_size(current);
+    delete[] heap;
+  } else if (current < capacity()) {
+    reallocate(current);
+  }
+}
+
+void String::resize(std::size_t new_size, char c) {
+  std::size_t current = size();
+  if (new_size > current) {
+    append(new_size - current, c);
+  } else {
+    set_size(new_size);
+  }
+}
+
+void String::push_back_slow(char c) {
+  grow_for(1);
+  std::size_t current = size();
+  data()[current] = c;
+  set_size(current + 1);
+}
+
+String& String::append_slow(StringView view) {
+  std::size_t current = size();
+  // The view may point into this string, so remember its offset across the
+  // reallocation.
+  const char* source = view.data();
+  bool aliased = source >= data() && source <= data() + current;
+  std::size_t offset = static_cast<std::size_t>(source - data());
+  grow_for(view.size());
+  if (aliased) {
+    source = data() + offset;
+  }
+  std::memcpy(data() + current, source, view.size());
+  set_size(current + view.size());
+  return *this;
+}
+
+String& String::append(std::size_t count, char c) {
+  grow_for(count);
+  std::size_t current = size();
+  std::memset(data() + current, c, count);
+  set_size(current + count);
+  return *this;
+}
+
+String operator+(StringView lhs, StringView rhs) {
+  String result;
+  result.reserve(lhs.size() + rhs.size());
+  result.append(lhs);
+  result.append(rhs);
+  return result;
+}
+
+std::ostream& operator<<(std::ostream& out, StringView view) {
+  return out << std::string_view(view);
+}
+
+std::istream& operator>>(std::istream& in, String& str) {
+  str.clear();
+  std::istream::sentry sentry(in);
+  if (!sentry) {
+    return in;
+  }
+  std::streambuf* buffer = in.rdbuf();
+  for (int c = buffer->sgetc(); c != std::char_traits<char>::eof();
+       c = buffer->snextc()) {
+    if (std::isspace(static_cast<unsigned char>(c)) != 0) {
+      return in;
+    }
+    str.push_back(static_cast<char>(c));
+  }
+  in.setstate(str.empty() ? std::ios::eofbit | std::ios::failbit
+                          : std::ios::eofbit);
+  return in;
+}
@@ -0,0 +1,444 @@
+#pragma once
+
+// Byte string with the small string optimization, and a non-owning view.
+//
+// String is 24 bytes on 64-bit targets. Up to 23 characters are stored inline;
+// the last byte then holds 23 - size, so it doubles as the terminating zero of
+// a full inline string. Longer strings live on the heap and set the top bit of
+// the capacity word, which is the same last byte on little-endian targets.
+//
+// substr() returns a StringView into the string and find() takes views, so
+// neither copies characters. A view stays valid until the string it points
+// into is modified or destroyed. split() yields views lazily, scanning the
+// text 64 bytes at a time with the SIMD kernels.
+
+#include <algorithm>
+#include <bit>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <cstring>
+#include <functional>
+#include <iosfwd>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace string_detail {
+
+// Search kernels shared by String and StringView, see string_search.cpp.
+// The instruction set is picked from the CPU features on first use.
+enum class SearchIsa { Scalar, Sse2, Avx2, Neon };
+
+// Switches all kernels to the given instruction set, e.g. to compare them in
+// benchmarks. Returns false if the CPU or the build does not support it.
+bool select_search_isa(SearchIsa isa);
+SearchIsa active_search_isa();
+
+std::size_t find_char(const char* data, std::size_t size, char c);
+std::size_t find_substring(const char* data, std::size_t size,
+                           const char* needle, std::size_t needle_size);
+// Bit i is set if data[i] == c; size must not exceed 64.
+std::uint64_t match_mask(const char* data, std::size_t size, char c);
+
+}  // namespace string_detail
+
+class SplitView;
+
+class StringView {
+ public:
+  static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+  constexpr StringView() = default;
+  constexpr StringView(const char* str)  // NOLINT(google-explicit-constructor)
+      : data_(str), size_(std::char_traits<char>::length(str)) {}
+  constexpr StringView(const char* data, std::size_t size)
+      : data_(data), size_(size) {}
+  constexpr StringView(std::string_view view)  // NOLINT(google-explicit-constructor)
+      : data_(view.data()), size_(view.size()) {}
+
+  constexpr explicit operator std::string_view() const { return {data_, size_}; }
+
+  constexpr const char* data() const { return data_; }
+  constexpr std::size_t size() const { return size_; }
+  constexpr std::size_t length() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+
+  constexpr const char& operator[](std::size_t index) const { return data_[index]; }
+  constexpr const char& front() const { return data_[0]; }
+  constexpr const char& back() const { return data_[size_ - 1]; }
+
+  constexpr const char* begin() const { return data_; }
+  constexpr const char* end() const { return data_ + size_; }
+
+  constexpr void remove_prefix(std::size_t count) {
+    data_ += count;
+    size_ -= count;
+  }
+  constexpr void remove_suffix(std::size_t count) { size_ -= count; }
+
+  // Throws std::out_of_range if pos > size().
+  constexpr StringView substr(std::size_t pos, std::size_t count = npos) const {
+    if (pos > size_) {
+      throw std::out_of_range("StringView::substr");
+    }
+    return {data_ + pos, std::min(count, size_ - pos)};
+  }
+
+  std::size_t find(char c, std::size_t pos = 0) const {
+    if (pos >= size_) {
+      return npos;
+    }
+    std::size_t found = string_detail::find_char(data_ + pos, size_ - pos, c);
+    return found == npos ? npos : pos + found;
+  }
+
+  std::size_t find(StringView needle, std::size_t pos = 0) const {
+    if (pos > size_) {
+      return npos;
+    }
+    std::size_t found = string_detail::find_substring(
+        data_ + pos, size_ - pos, needle.data_, needle.size_);
+    return found == npos ? npos : pos + found;
+  }
+
+  std::size_t rfind(char c, std::size_t pos = npos) const {
+    if (size_ == 0) {
+      return npos;
+    }
+    for (std::size_t i = std::min(pos, size_ - 1) + 1; i-- > 0;) {
+      if (data_[i] == c) {
+        return i;
+      }
+    }
+    return npos;
+  }
+
+  std::size_t rfind(StringView needle, std::size_t pos = npos) const {
+    return std::string_view(*this).rfind(std::string_view(needle), pos);
+  }
+
+  bool contains(char c) const { return find(c) != npos; }
+  bool contains(StringView needle) const { return find(needle) != npos; }
+
+  // Fields between occurrences of the delimiter, empty ones included.
+  SplitView split(char delimiter) const;
+
+  constexpr bool starts_with(StringView prefix) const {
+    return size_ >= prefix.size_ &&
+           std::string_view(data_, prefix.size_) == std::string_view(prefix);
+  }
+  constexpr bool ends_with(StringView suffix) const {
+    return size_ >= suffix.size_ &&
+           std::string_view(data_ + size_ - suffix.size_, suffix.size_) ==
+               std::string_view(suffix);
+  }
+
+ private:
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+constexpr bool operator==(StringView lhs, StringView rhs) {
+  return std::string_view(lhs) == std::string_view(rhs);
+}
+
+constexpr std::strong_ordering operator<=>(StringView lhs, StringView rhs) {
+  return std::string_view(lhs) <=> std::string_view(rhs);
+}
+
+std::ostream& operator<<(std::ostream& out, StringView view);
+
+// Forward range over the fields of a view. Occurrences of the delimiter are
+// found a 64-byte block at a time as a bit mask, so a field costs a
+// count-trailing-zeros rather than a call into the search kernel.
+class SplitView {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = StringView;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const StringView*;
+    using reference = StringView;
+
+    iterator() = default;
+
+    StringView operator*() const { return field_; }
+    const StringView* operator->() const { return &field_; }
+
+    iterator& operator++() {
+      advance();
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator old = *this;
+      advance();
+      return old;
+    }
+
+    friend bool operator==(const iterator& lhs, const iterator& rhs) {
+      return lhs.done_ == rhs.done_ &&
+             (lhs.done_ || lhs.field_.data() == rhs.field_.data());
+    }
+
+   private:
+    friend class SplitView;
+
+    static constexpr std::size_t kBlock = 64;
+
+    iterator(StringView text, char delimiter)
+        : text_(text), delimiter_(delimiter), done_(false) {
+      load_block();
+      advance();
+    }
+
+    void load_block() {
+      std::size_t length = std::min(kBlock, text_.size() - block_);
+      mask_ = string_detail::match_mask(text_.data() + block_, length, delimiter_);
+    }
+
+    void advance() {
+      if (finished_) {
+        done_ = true;
+        return;
+      }
+      while (mask_ == 0) {
+        block_ += kBlock;
+        if (block_ >= text_.size()) {
+          field_ = text_.substr(start_);
+          finished_ = true;
+          return;
+        }
+        load_block();
+      }
+      std::size_t end = block_ + static_cast<std::size_t>(std::countr_zero(mask_));
+      mask_ &= mask_ - 1;
+      field_ = StringView(text_.data() + start_, end - start_);
+      start_ = end + 1;
+    }
+
+    StringView text_;
+    StringView field_;
+    std::size_t start_ = 0;   // beginning of the next field
+    std::size_t block_ = 0;   // offset of the block described by mask_
+    std::uint64_t mask_ = 0;  // delimiters in the block not consumed yet
+    char delimiter_ = '\0';
+    bool finished_ = false;   // field_ is the last field
+    bool done_ = true;        // past the last field
+  };
+
+  SplitView(StringView text, char delimiter)
+      : text_(text), delimiter_(delimiter) {}
+
+  iterator begin() const { return iterator(text_, delimiter_); }
+  iterator end() const { return iterator(); }
+
+ private:
+  StringView text_;
+  char delimiter_;
+};
+
+inline SplitView StringView::split(char delimiter) const {
+  return SplitView(*this, delimiter);
+}
+
+class String {
+  static_assert(std::endian::native == std::endian::little,
+                "the inline/heap tag lives in the last byte of the capacity");
+
+ public:
+  static constexpr std::size_t npos = StringView::npos;
+
+  String() { set_short_size(0); }
+  String(const char* str)  // NOLINT(google-explicit-constructor)
+      : String(StringView(str)) {}
+  String(const char* data, std::size_t size) : String(StringView(data, size)) {}
+  String(std::size_t count, char c);
+  explicit String(StringView view);
+
+  String(const String& other);
+  String(String&& other) noexcept : rep_(other.rep_) { other.set_short_size(0); }
+  String& operator=(const String& other);
+  String& operator=(String&& other) noexcept;
+  ~String();
+
+  operator StringView() const {  // NOLINT(google-explicit-constructor)
+    return {data(), size()};
+  }
+
+  std::size_t size() const {
+    return is_short() ? kShortCapacity - rep_.short_rep.remaining
+                      : rep_.long_rep.size;
+  }
+  std::size_t length() const { return size(); }
+  std::size_t capacity() const {
+    return is_short() ? kShortCapacity : rep_.long_rep.capacity & ~kLongFlag;
+  }
+  bool empty() const { return size() == 0; }
+
+  char* data() { return is_short() ? rep_.short_rep.data : rep_.long_rep.data; }
+  const char* data() const {
+    return is_short() ? rep_.short_rep.data : rep_.long_rep.data;
+  }
+  const char* c_str() const { return data(); }
+
+  char& operator[](std::size_t index) { return data()[index]; }
+  const char& operator[](std::size_t index) const { return data()[index]; }
+  char& front() { return data()[0]; }
+  const char& front() const { return data()[0]; }
+  char& back() { return data()[size() - 1]; }
+  const char& back() const { return data()[size() - 1]; }
+
+  char* begin() { return data(); }
+  char* end() { return data() + size(); }
+  const char* begin() const { return data(); }
+  const char* end() const { return data() + size(); }
+
+  void reserve(std::size_t new_capacity);
+  void shrink_to_fit();
+  void resize(std::size_t new_size, char c = '\0');
+  void clear() { set_size(0); }
+
+  void push_back(char c) {
+    if (is_short()) {
+      std::size_t current = kShortCapacity - rep_.short_rep.remaining;
+      if (current < kShortCapacity) {
+        rep_.short_rep.data[current] = c;
+        set_short_size(current + 1);
+        return;
+      }
+    } else if (std::size_t current = rep_.long_rep.size;
+               current < (rep_.long_rep.capacity & ~kLongFlag)) {
+      rep_.long_rep.data[current] = c;
+      rep_.long_rep.data[current + 1] = '\0';
+      rep_.long_rep.size = current + 1;
+      return;
+    }
+    push_back_slow(c);
+  }
+  void pop_back() { set_size(size() - 1); }
+  String& append(StringView view) {
+    std::size_t current = size();
+    if (view.size() <= capacity() - current) {
+      char* buffer = data();
+      std::memmove(buffer + current, view.data(), view.size());
+      set_size(current + view.size());
+      return *this;
+    }
+    return append_slow(view);
+  }
+  String& append(std::size_t count, char c);
+  String& operator+=(StringView view) { return append(view); }
+  String& operator+=(char c) {
+    push_back(c);
+    return *this;
+  }
+
+  // Views into this string, see the note at the top of the file.
+  StringView substr(std::size_t pos, std::size_t count = npos) const {
+    return StringView(*this).substr(pos, count);
+  }
+  std::size_t find(char c, std::size_t pos = 0) const {
+    return StringView(*this).find(c, pos);
+  }
+  std::size_t find(StringView needle, std::size_t pos = 0) const {
+    return StringView(*this).find(needle, pos);
+  }
+  std::size_t rfind(char c, std::size_t pos = npos) const {
+    return StringView(*this).rfind(c, pos);
+  }
+  std::size_t rfind(StringView needle, std::size_t pos = npos) const {
+    return StringView(*this).rfind(needle, pos);
+  }
+  bool contains(StringView needle) const {
+    return StringView(*this).contains(needle);
+  }
+  SplitView split(char delimiter) const {
+    return StringView(*this).split(delimiter);
+  }
+  bool starts_with(StringView prefix) const {
+    return StringView(*this).starts_with(prefix);
+  }
+  bool ends_with(StringView suffix) const {
+    return StringView(*this).ends_with(suffix);
+  }
+
+  void swap(String& other) noexcept { std::swap(rep_, other.rep_); }
+
+ private:
+  static constexpr std::size_t kLongFlag = std::size_t{1}
+                                           << (8 * sizeof(std::size_t) - 1);
+
+  struct Long {
+    char* data;
+    std::size_t size;
+    std::size_t capacity;  // with kLongFlag set
+  };
+
+  static constexpr std::size_t kShortCapacity = sizeof(Long) - 1;
+
+  struct Short {
+    char data[kShortCapacity];
+    unsigned char remaining;  // kShortCapacity - size
+  };
+
+  union Rep {
+    Long long_rep;
+    Short short_rep;
+  };
+
+  bool is_short() const {
+    return (reinterpret_cast<const unsigned char*>(&rep_)[sizeof(Rep) - 1] &
+            0x80) == 0;
+  }
+
+  // A full inline string is terminated by `remaining` itself.
+  void set_short_size(std::size_t size) {
+    if (size < kShortCapacity) {
+      rep_.short_rep.data[size] = '\0';
+    }
+    rep_.short_rep.remaining = static_cast<unsigned char>(kShortCapacity - size);
+  }
+
+  void set_size(std::size_t size) {
+    if (is_short()) {
+      set_short_size(size);
+    } else {
+      rep_.long_rep.size = size;
+      rep_.long_rep.data[size] = '\0';
+    }
+  }
+
+  // Moves the contents to a heap buffer of exactly new_capacity characters.
+  void reallocate(std::size_t new_capacity);
+  // Makes room for `extra` more characters with geometric growth.
+  void grow_for(std::size_t extra);
+  void push_back_slow(char c);
+  String& append_slow(StringView view);
+
+  Rep rep_;
+};
+
+static_assert(sizeof(String) == 3 * sizeof(void*));
+
+String operator+(StringView lhs, StringView rhs);
+
+std::istream& operator>>(std::istream& in, String& str);
+
+inline void swap(String& lhs, String& rhs) noexcept { lhs.swap(rhs); }
+
+template <>
+struct std::hash<StringView> {
+  std::size_t operator()(StringView view) const noexcept {
+    return std::hash<std::string_view>{}(std::string_view(view));
+  }
+};
+
+template <>
+struct std::hash<String> {
+  std::size_t operator()(const String& str) const noexcept {
+    return std::hash<StringView>{}(str);
+  }
+};
@@ -0,0 +1,464 @@
+// Search kernels behind StringView::find and StringView::split.
+//
+// Every instruction set provides the same three kernels and one of them is
+// picked at first use from the CPU features: AVX2 or SSE2 on x86 (SSE2 is
+// part of x86-64, and the first/last-byte filter below outperforms the SSE4.2
+// string instructions), NEON on AArch64 and a portable fallback elsewhere.
+//
+// Substring search uses the "SIMD-friendly" first/last byte filter: compare a
+// block of candidate positions against the first and the last needle byte at
+// once and run memcmp only where both match.
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#include "String/string.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STRING_SEARCH_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define STRING_SEARCH_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace string_detail {
+
+namespace {
+
+constexpr std::size_t npos = StringView::npos;
+
+struct Kernels {
+  SearchIsa isa;
+  std::size_t (*find_char)(const char*, std::size_t, char);
+  std::size_t (*find_substring)(const char*, std::size_t, const char*,
+                                std::size_t);
+  std::uint64_t (*match_mask)(const char*, std::size_t, char);
+};
+
+std::size_t find_char_loop(const char* data, std::size_t size, char c) {
+  for (std::size_t i = 0; i < size; ++i) {
+    if (data[i] == c) {
+      return i;
+    }
+  }
+  return npos;
+}
+
+std::uint64_t match_mask_loop(const char* data, std::size_t size, char c) {
+  std::uint64_t mask = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    mask |= static_cast<std::uint64_t>(data[i] == c) << i;
+  }
+  return mask;
+}
+
+// Checks the candidate positions [begin, last] one by one.
+std::size_t find_substring_tail(const char* data, std::size_t begin,
+                                std::size_t last, const char* needle,
+                                std::size_t needle_size) {
+  for (std::size_t pos = begin; pos <= last; ++pos) {
+    if (data[pos] == needle[0] &&
+        std::memcmp(data + pos + 1, needle + 1, needle_size - 1) == 0) {
+      return pos;
+    }
+  }
+  return npos;
+}
+
+// Portable kernels: memchr is usually vectorized by the C library already.
+
+std::size_t find_char_portable(const char* data, std::size_t size, char c) {
+  const void* found = std::memchr(data, c, size);
+  return found == nullptr ? npos
+                          : static_cast<std::size_t>(
+                                static_cast<const char*>(found) - data);
+}
+
+std::size_t find_substring_portable(const char* data, std::size_t size,
+                                    const char* needle,
+                                    std::size_t needle_size) {
+  std::size_t last = size - needle_size;
+  for (std::size_t pos = 0; pos <= last;) {
+    std::size_t found = find_char_portable(data + pos, last - pos + 1, needle[0]);
+    if (found == npos) {
+      break;
+    }
+    pos += found;
+    if (std::memcmp(data + pos + 1, needle + 1, needle_size - 1) == 0) {
+      return pos;
+    }
+    ++pos;
+  }
+  return npos;
+}
+
+constexpr Kernels kPortable{SearchIsa::Scalar, find_char_portable,
+                            find_substring_portable, match_mask_loop};
+
+#if defined(STRING_SEARCH_X86)
+
+__attribute__((target("sse2"))) std::uint32_t movemask16(__m128i block,
+                                                         __m128i pattern) {
+  return static_cast<std::uint32_t>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern)));
+}
+
+__attribute__((target("sse2"))) __m128i load16(const char* data) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+__attribute__((target("sse2"))) std::size_t find_char_sse2(const char* data,
+                                                           std::size_t size,
+                                                           char c) {
+  if (size < 16) {
+    return find_char_loop(data, size, c);
+  }
+  const __m128i pattern = _mm_set1_epi8(c);
+  std::size_t i = 0;
+  for (; i + 64 <= size; i += 64) {
+    __m128i m0 = _mm_cmpeq_epi8(load16(data + i), pattern);
+    __m128i m1 = _mm_cmpeq_epi8(load16(data + i + 16), pattern);
+    __m128i m2 = _mm_cmpeq_epi8(load16(data + i + 32), pattern);
+    __m128i m3 = _mm_cmpeq_epi8(load16(data + i + 48), pattern);
+    __m128i any = _mm_or_si128(_mm_or_si128(m0, m1), _mm_or_si128(m2, m3));
+    if (_mm_movemask_epi8(any) != 0) {
+      std::uint64_t mask =
+          static_cast<std::uint64_t>(
+              static_cast<std::uint32_t>(_mm_movemask_epi8(m0))) |
+          static_cast<std::uint64_t>(
+              static_cast<std::uint32_t>(_mm_movemask_epi8(m1)))
+              << 16 |
+          static_cast<std::uint64_t>(
+              static_cast<std::uint32_t>(_mm_movemask_epi8(m2)))
+              << 32 |
+          static_cast<std::uint64_t>(
+              static_cast<std::uint32_t>(_mm_movemask_epi8(m3)))
+              << 48;
+      return i + static_cast<std::size_t>(std::countr_zero(mask));
+    }
+  }
+  for (; i + 16 <= size; i += 16) {
+    std::uint32_t mask = movemask16(load16(data + i), pattern);
+    if (mask != 0) {
+      return i + static_cast<std::size_t>(std::countr_zero(mask));
+    }
+  }
+  if (i < size) {
+    // The last, partly checked block is loaded again from size - 16.
+    std::size_t tail = size - 16;
+    std::uint32_t mask = movemask16(load16(data + tail), pattern) >> (i - tail);
+    if (mask != 0) {
+      return i + static_cast<std::size_t>(std::countr_zero(mask));
+    }
+  }
+  return npos;
+}
+
+__attribute__((target("sse2"))) std::size_t find_substring_sse2(
+    const char* data, std::size_t size, const char* needle,
+    std::size_t needle_size) {
+  std::size_t last = size - needle_size;
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i final = _mm_set1_epi8(needle[needle_size - 1]);
+  std::size_t i = 0;
+  for (; i + 16 <= last + 1; i += 16) {
+    __m128i block_first = load16(data + i);
+    __m128i block_final = load16(data + i + needle_size - 1);
+    auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                      _mm_cmpeq_epi8(block_final, final))));
+    while (mask != 0) {
+      std::size_t pos = i + static_cast<std::size_t>(std::countr_zero(mask));
+      if (std::memcmp(data + pos + 1, needle + 1, needle_size - 2) == 0) {
+        return pos;
+      }
+      mask &= mask - 1;
+    }
+  }
+  return find_substring_tail(data, i, last, needle, needle_size);
+}
+
+__attribute__((target("sse2"))) std::uint64_t match_mask_sse2(
+    const char* data, std::size_t size, char c) {
+  if (size < 64) {
+    return match_mask_loop(data, size, c);
+  }
+  const __m128i pattern = _mm_set1_epi8(c);
+  return static_cast<std::uint64_t>(movemask16(load16(data), pattern)) |
+         static_cast<std::uint64_t>(movemask16(load16(data + 16), pattern))
+             << 16 |
+         static_cast<std::uint64_t>(movemask16(load16(data + 32), pattern))
+             << 32 |
+         static_cast<std::uint64_t>(movemask16(load16(data + 48), pattern))
+             << 48;
+}
+
+constexpr Kernels kSse2{SearchIsa::Sse2, find_char_sse2, find_substring_sse2,
+                        match_mask_sse2};
+
+__attribute__((target("avx2"))) __m256i load32(const char* data) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+}
+
+__attribute__((target("avx2"))) std::uint32_t movemask32(__m256i block,
+                                                         __m256i pattern) {
+  return static_cast<std::uint32_t>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, pattern)));
+}
+
+__attribute__((target("avx2"))) std::size_t find_char_avx2(const char* data,
+                                                           std::size_t size,
+                                                           char c) {
+  if (size < 32) {
+    return find_char_sse2(data, size, c);
+  }
+  const __m256i pattern = _mm256_set1_epi8(c);
+  std::size_t i = 0;
+  // Four vectors per iteration keep enough loads in flight to run at L1/L2
+  // bandwidth; the position is only extracted once a block has a match.
+  for (; i + 128 <= size; i += 128) {
+    __m256i m0 = _mm256_cmpeq_epi8(load32(data + i), pattern);
+    __m256i m1 = _mm256_cmpeq_epi8(load32(data + i + 32), pattern);
+    __m256i m2 = _mm256_cmpeq_epi8(load32(data + i + 64), pattern);
+    __m256i m3 = _mm256_cmpeq_epi8(load32(data + i + 96), pattern);
+    __m256i any = _mm256_or_si256(_mm256_or_si256(m0, m1),
+                                  _mm256_or_si256(m2, m3));
+    if (_mm256_testz_si256(any, any) == 0) {
+      std::uint64_t low =
+          static_cast<std::uint64_t>(
+              static_cast<std::uint32_t>(_mm256_movemask_epi8(m0))) |
+          static_cast<std::uint64_t>(
+              static_cast<std::uint32_t>(_mm256_movemask_epi8(m1)))
+              << 32;
+      if (low != 0) {
+        return i + static_cast<std::size_t>(std::countr_zero(low));
+      }
+      std::uint64_t high =
+          static_cast<std::uint64_t>(
+              static_cast<std::uint32_t>(_mm256_movemask_epi8(m2))) |
+          static_cast<std::uint64_t>(
+              static_cast<std::uint32_t>(_mm256_movemask_epi8(m3)))
+              << 32;
+      return i + 64 + static_cast<std::size_t>(std::countr_zero(high));
+    }
+  }
+  for (; i + 32 <= size; i += 32) {
+    std::uint32_t mask = movemask32(load32(data + i), pattern);
+    if (mask != 0) {
+      return i + static_cast<std::size_t>(std::countr_zero(mask));
+    }
+  }
+  if (i < size) {
+    std::size_t tail = size - 32;
+    std::uint32_t mask = movemask32(load32(data + tail), pattern) >> (i - tail);
+    if (mask != 0) {
+      return i + static_cast<std::size_t>(std::countr_zero(mask));
+    }
+  }
+  return npos;
+}
+
+__attribute__((target("avx2"))) std::size_t find_substring_avx2(
+    const char* data, std::size_t size, const char* needle,
+    std::size_t needle_size) {
+  std::size_t last = size - needle_size;
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i final = _mm256_set1_epi8(needle[needle_size - 1]);
+  std::size_t i = 0;
+  for (; i + 32 <= last + 1; i += 32) {
+    __m256i block_first = load32(data + i);
+    __m256i block_final = load32(data + i + needle_size - 1);
+    auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                         _mm256_cmpeq_epi8(block_final, final))));
+    while (mask != 0) {
+      std::size_t pos = i + static_cast<std::size_t>(std::countr_zero(mask));
+      if (std::memcmp(data + pos + 1, needle + 1, needle_size - 2) == 0) {
+        return pos;
+      }
+      mask &= mask - 1;
+    }
+  }
+  if (i > last) {
+    return npos;
+  }
+  std::size_t rest = find_substring_sse2(data + i, size - i, needle, needle_size);
+  return rest == npos ? npos : i + rest;
+}
+
+__attribute__((target("avx2"))) std::uint64_t match_mask_avx2(
+    const char* data, std::size_t size, char c) {
+  if (size < 64) {
+    return match_mask_loop(data, size, c);
+  }
+  const __m256i pattern = _mm256_set1_epi8(c);
+  return static_cast<std::uint64_t>(movemask32(load32(data), pattern)) |
+         static_cast<std::uint64_t>(movemask32(load32(data + 32), pattern))
+             << 32;
+}
+
+constexpr Kernels kAvx2{SearchIsa::Avx2, find_char_avx2, find_substring_avx2,
+                        match_mask_avx2};
+
+#endif  // STRING_SEARCH_X86
+
+#if defined(STRING_SEARCH_NEON)
+
+// NEON has no movemask; narrowing each 16-bit lane by 4 bits leaves a 64-bit
+// value with four bits per input byte.
+std::uint64_t nibble_mask(uint8x16_t matches) {
+  uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+  return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+std::size_t find_char_neon(const char* data, std::size_t size, char c) {
+  if (size < 16) {
+    return find_char_loop(data, size, c);
+  }
+  const uint8x16_t pattern = vdupq_n_u8(static_cast<std::uint8_t>(c));
+  auto bytes = reinterpret_cast<const std::uint8_t*>(data);
+  std::size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    std::uint64_t mask = nibble_mask(vceqq_u8(vld1q_u8(bytes + i), pattern));
+    if (mask != 0) {
+      return i + static_cast<std::size_t>(std::countr_zero(mask)) / 4;
+    }
+  }
+  if (i < size) {
+    std::size_t tail = size - 16;
+    std::uint64_t mask =
+        nibble_mask(vceqq_u8(vld1q_u8(bytes + tail), pattern)) >> (4 * (i - tail));
+    if (mask != 0) {
+      return i + static_cast<std::size_t>(std::countr_zero(mask)) / 4;
+    }
+  }
+  return npos;
+}
+
+std::size_t find_substring_neon(const char* data, std::size_t size,
+                                const char* needle, std::size_t needle_size) {
+  std::size_t last = size - needle_size;
+  const uint8x16_t first = vdupq_n_u8(static_cast<std::uint8_t>(needle[0]));
+  const uint8x16_t final =
+      vdupq_n_u8(static_cast<std::uint8_t>(needle[needle_size - 1]));
+  auto bytes = reinterpret_cast<const std::uint8_t*>(data);
+  std::size_t i = 0;
+  for (; i + 16 <= last + 1; i += 16) {
+    uint8x16_t matches =
+        vandq_u8(vceqq_u8(vld1q_u8(bytes + i), first),
+                 vceqq_u8(vld1q_u8(bytes + i + needle_size - 1), final));
+    std::uint64_t mask = nibble_mask(matches);
+    while (mask != 0) {
+      auto bit = static_cast<std::size_t>(std::countr_zero(mask)) / 4;
+      std::size_t pos = i + bit;
+      if (std::memcmp(data + pos + 1, needle + 1, needle_size - 2) == 0) {
+        return pos;
+      }
+      mask &= ~(std::uint64_t{0xF} << (4 * bit));
+    }
+  }
+  return find_substring_tail(data, i, last, needle, needle_size);
+}
+
+std::uint64_t match_mask_neon(const char* data, std::size_t size, char c) {
+  if (size < 64) {
+    return match_mask_loop(data, size, c);
+  }
+  const uint8x16_t pattern = vdupq_n_u8(static_cast<std::uint8_t>(c));
+  const uint8x16_t weights = {1, 2, 4, 8, 16, 32, 64, 128,
+                              1, 2, 4, 8, 16, 32, 64, 128};
+  auto bytes = reinterpret_cast<const std::uint8_t*>(data);
+  uint8x16_t t0 = vandq_u8(vceqq_u8(vld1q_u8(bytes), pattern), weights);
+  uint8x16_t t1 = vandq_u8(vceqq_u8(vld1q_u8(bytes + 16), pattern), weights);
+  uint8x16_t t2 = vandq_u8(vceqq_u8(vld1q_u8(bytes + 32), pattern), weights);
+  uint8x16_t t3 = vandq_u8(vceqq_u8(vld1q_u8(bytes + 48), pattern), weights);
+  uint8x16_t sum = vpaddq_u8(vpaddq_u8(t0, t1), vpaddq_u8(t2, t3));
+  sum = vpaddq_u8(sum, sum);
+  return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+}
+
+constexpr Kernels kNeon{SearchIsa::Neon, find_char_neon, find_substring_neon,
+                        match_mask_neon};
+
+#endif  // STRING_SEARCH_NEON
+
+const Kernels* kernels_for(SearchIsa isa) {
+  switch (isa) {
+#if defined(STRING_SEARCH_X86)
+    case SearchIsa::Sse2:
+      return __builtin_cpu_supports("sse2") ? &kSse2 : nullptr;
+    case SearchIsa::Avx2:
+      return __builtin_cpu_supports("avx2") ? &kAvx2 : nullptr;
+#endif
+#if defined(STRING_SEARCH_NEON)
+    case SearchIsa::Neon:
+      return &kNeon;
+#endif
+    case SearchIsa::Scalar:
+      return &kPortable;
+    default:
+      return nullptr;
+  }
+}
+
+const Kernels* detect_kernels() {
+  for (SearchIsa isa : {SearchIsa::Avx2, SearchIsa::Sse2, SearchIsa::Neon}) {
+    if (const Kernels* found = kernels_for(isa)) {
+      return found;
+    }
+  }
+  return &kPortable;
+}
+
+// Constant-initialized, so the kernels work during static initialization of
+// other translation units too.
+constinit std::atomic<const Kernels*> active_kernels{nullptr};
+
+const Kernels& kernels() {
+  const Kernels* current = active_kernels.load(std::memory_order_relaxed);
+  if (current == nullptr) {
+    current = detect_kernels();
+    active_kernels.store(current, std::memory_order_relaxed);
+  }
+  return *current;
+}
+
+}  // namespace
+
+bool select_search_isa(SearchIsa isa) {
+  const Kernels* requested = kernels_for(isa);
+  if (requested == nullptr) {
+    return false;
+  }
+  active_kernels.store(requested, std::memory_order_relaxed);
+  return true;
+}
+
+SearchIsa active_search_isa() { return kernels().isa; }
+
+std::size_t find_char(const char* data, std::size_t size, char c) {
+  return kernels().find_char(data, size, c);
+}
+
+std::size_t find_substring(const char* data, std::size_t size,
+                           const char* needle, std::size_t needle_size) {
+  if (needle_size == 0) {
+    return 0;
+  }
+  if (needle_size > size) {
+    return npos;
+  }
+  if (needle_size == 1) {
+    return kernels().find_char(data, size, needle[0]);
+  }
+  return kernels().find_substring(data, size, needle, needle_size);
+}
+
+std::uint64_t match_mask(const char* data, std::size_t size, char c) {
+  return kernels().match_mask(data, size, c);
+}
+
+}  // namespace string_detail
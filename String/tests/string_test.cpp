@@ -0,0 +1,318 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "String/string.h"
+
+namespace {
+
+bool is_inline(const String& str) {
+  const char* self = reinterpret_cast<const char*>(&str);
+  return str.data() >= self && str.data() < self + sizeof(String);
+}
+
+std::string_view view(StringView str) { return std::string_view(str); }
+
+TEST(String, ShortStringsStayInline) {
+  String empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_EQ(empty.c_str()[0], '\0');
+  EXPECT_TRUE(is_inline(empty));
+  EXPECT_EQ(empty.capacity(), 23u);
+
+  for (std::size_t size = 0; size <= 30; ++size) {
+    std::string expected(size, 'x');
+    String str(expected.c_str());
+    EXPECT_EQ(str.size(), size);
+    EXPECT_EQ(view(str), expected);
+    EXPECT_EQ(str.c_str()[size], '\0');
+    EXPECT_EQ(is_inline(str), size <= 23) << size;
+  }
+}
+
+TEST(String, PushBackCrossesToTheHeap) {
+  String str;
+  std::string expected;
+  for (int i = 0; i < 100; ++i) {
+    char c = static_cast<char>('a' + i % 26);
+    str.push_back(c);
+    expected.push_back(c);
+    ASSERT_EQ(view(str), expected);
+    ASSERT_EQ(str.c_str()[str.size()], '\0');
+  }
+  EXPECT_FALSE(is_inline(str));
+  while (!str.empty()) {
+    str.pop_back();
+    expected.pop_back();
+    ASSERT_EQ(view(str), expected);
+  }
+}
+
+TEST(String, CopyAndMove) {
+  for (std::size_t size : {5u, 23u, 24u, 200u}) {
+    String original(size, 'q');
+    String copy = original;
+    EXPECT_EQ(copy, original);
+    EXPECT_NE(copy.data(), original.data());
+
+    String moved = std::move(copy);
+    EXPECT_EQ(moved, original);
+    EXPECT_TRUE(copy.empty());  // NOLINT(bugprone-use-after-move)
+
+    String assigned("something else entirely, and long");
+    assigned = original;
+    EXPECT_EQ(assigned, original);
+    assigned = std::move(moved);
+    EXPECT_EQ(assigned, original);
+
+    assigned = assigned;
+    EXPECT_EQ(assigned, original);
+  }
+}
+
+TEST(String, AppendToItself) {
+  String str("abcdefghij");
+  for (int i = 0; i < 5; ++i) {
+    str.append(str);
+  }
+  EXPECT_EQ(str.size(), 320u);
+  EXPECT_EQ(view(str.substr(310)), "abcdefghij");
+
+  String half("0123456789012345678901234567890123456789");
+  half += half.substr(20);
+  EXPECT_EQ(view(half), "012345678901234567890123456789012345678901234567890123456789");
+}
+
+TEST(String, ReserveResizeShrink) {
+  String str("short");
+  str.reserve(100);
+  EXPECT_GE(str.capacity(), 100u);
+  EXPECT_EQ(view(str), "short");
+
+  str.resize(40, '!');
+  EXPECT_EQ(view(str), "short" + std::string(35, '!'));
+  str.resize(3);
+  EXPECT_EQ(view(str), "sho");
+  EXPECT_EQ(str.c_str()[3], '\0');
+
+  str.shrink_to_fit();
+  EXPECT_TRUE(is_inline(str));
+  EXPECT_EQ(view(str), "sho");
+
+  String big(50, 'b');
+  big.reserve(500);
+  big.shrink_to_fit();
+  EXPECT_EQ(big.capacity(), 50u);
+  EXPECT_EQ(view(big), std::string(50, 'b'));
+}
+
+TEST(String, SubstrIsAView) {
+  String str("hello, world; this one lives on the heap");
+  StringView sub = str.substr(7, 5);
+  EXPECT_EQ(view(sub), "world");
+  EXPECT_EQ(sub.data(), str.data() + 7);
+  EXPECT_EQ(view(str.substr(36)), "heap");
+  EXPECT_EQ(view(str.substr(str.size())), "");
+  EXPECT_THROW(str.substr(str.size() + 1), std::out_of_range);
+  EXPECT_THROW(StringView("abc").substr(4), std::out_of_range);
+}
+
+TEST(StringView, PrefixesSuffixesAndOrder) {
+  StringView text("portfolio");
+  EXPECT_TRUE(text.starts_with("port"));
+  EXPECT_TRUE(text.ends_with("folio"));
+  EXPECT_FALSE(text.starts_with("portfolio!"));
+  EXPECT_TRUE(text.starts_with(""));
+
+  StringView trimmed = text;
+  trimmed.remove_prefix(4);
+  trimmed.remove_suffix(2);
+  EXPECT_EQ(view(trimmed), "fol");
+
+  EXPECT_LT(StringView("abc"), StringView("abd"));
+  EXPECT_LT(StringView("ab"), StringView("abc"));
+  EXPECT_EQ(String("same"), StringView("same"));
+  EXPECT_EQ(std::hash<String>{}(String("key")), std::hash<std::string_view>{}("key"));
+}
+
+TEST(StringView, Rfind) {
+  StringView text("abcabcabc");
+  EXPECT_EQ(text.rfind('a'), 6u);
+  EXPECT_EQ(text.rfind('a', 5), 3u);
+  EXPECT_EQ(text.rfind('z'), StringView::npos);
+  EXPECT_EQ(text.rfind("bc"), 7u);
+  EXPECT_EQ(text.rfind("bc", 6), 4u);
+  EXPECT_EQ(StringView().rfind('a'), StringView::npos);
+}
+
+TEST(String, Concatenation) {
+  String joined = StringView("left half of it, ") + StringView("right half of it");
+  EXPECT_EQ(view(joined), "left half of it, right half of it");
+  EXPECT_EQ(view(String("a") + String("b")), "ab");
+}
+
+TEST(String, Streams) {
+  std::istringstream in("  first second_word_that_is_longer_than_inline\tthird");
+  String word;
+  std::string seen;
+  while (in >> word) {
+    seen += std::string(view(word)) + "|";
+  }
+  EXPECT_EQ(seen, "first|second_word_that_is_longer_than_inline|third|");
+  EXPECT_TRUE(word.empty());
+
+  std::istringstream blank("   ");
+  String none("unchanged");
+  EXPECT_FALSE(blank >> none);
+  EXPECT_TRUE(none.empty());
+
+  std::ostringstream out;
+  out << String("out") << StringView("put");
+  EXPECT_EQ(out.str(), "output");
+}
+
+// Every kernel the CPU supports is checked against std::string_view.
+class StringSearch : public testing::TestWithParam<string_detail::SearchIsa> {
+ protected:
+  void SetUp() override {
+    previous_ = string_detail::active_search_isa();
+    if (!string_detail::select_search_isa(GetParam())) {
+      GTEST_SKIP() << "instruction set not supported here";
+    }
+  }
+  void TearDown() override { string_detail::select_search_isa(previous_); }
+
+ private:
+  string_detail::SearchIsa previous_ = string_detail::SearchIsa::Scalar;
+};
+
+// Text over a small alphabet, so matches and near matches are common.
+std::string random_text(std::size_t size, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> letter(0, 3);
+  std::string text(size, 'a');
+  for (char& c : text) {
+    c = static_cast<char>("ab,\0"[letter(gen)]);
+  }
+  return text;
+}
+
+TEST_P(StringSearch, FindCharMatchesStd) {
+  for (std::size_t size : {0u, 1u, 15u, 16u, 17u, 31u, 32u, 33u, 63u, 64u, 65u, 200u}) {
+    std::string text = random_text(size, static_cast<unsigned>(size));
+    String str(StringView(text.data(), text.size()));
+    for (char c : {'a', ',', '\0', 'z'}) {
+      for (std::size_t pos = 0; pos <= size + 1; ++pos) {
+        ASSERT_EQ(str.find(c, pos), std::string_view(text).find(c, pos))
+            << "size " << size << " pos " << pos << " char " << int(c);
+      }
+    }
+  }
+}
+
+TEST_P(StringSearch, FindSubstringMatchesStd) {
+  std::string text = random_text(300, 1);
+  StringView haystack(text.data(), text.size());
+  std::mt19937 gen(2);
+  for (int round = 0; round < 300; ++round) {
+    std::size_t length = gen() % 12;
+    std::size_t from = gen() % (text.size() - length);
+    std::string needle = text.substr(from, length);
+    if (round % 3 == 0 && length > 0) {
+      needle.back() = 'b';
+    }
+    std::size_t pos = gen() % (text.size() + 2);
+    ASSERT_EQ(haystack.find(StringView(needle.data(), needle.size()), pos),
+              std::string_view(text).find(needle, pos))
+        << "needle of " << length << " at " << pos;
+  }
+  EXPECT_EQ(haystack.find(""), 0u);
+  EXPECT_EQ(haystack.find("", text.size()), text.size());
+  EXPECT_EQ(StringView("short").find("longer needle"), StringView::npos);
+}
+
+TEST_P(StringSearch, FindsMatchesAtBlockEdges) {
+  std::string text(256, '.');
+  for (std::size_t at : {0u, 15u, 16u, 31u, 32u, 63u, 64u, 127u, 255u}) {
+    std::string copy = text;
+    copy[at] = '#';
+    EXPECT_EQ(StringView(copy.data(), copy.size()).find('#'), at);
+    if (at + 3 <= copy.size()) {
+      copy.replace(at, 3, "xyz");
+      EXPECT_EQ(StringView(copy.data(), copy.size()).find("xyz"), at);
+    }
+  }
+}
+
+TEST_P(StringSearch, MatchMask) {
+  std::string text = random_text(64, 3);
+  for (std::size_t size : {0u, 1u, 17u, 63u, 64u}) {
+    std::uint64_t expected = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+      expected |= std::uint64_t{text[i] == ','} << i;
+    }
+    EXPECT_EQ(string_detail::match_mask(text.data(), size, ','), expected) << size;
+  }
+}
+
+// Reference split: every field, empty ones included.
+std::vector<std::string> reference_split(const std::string& text, char delimiter) {
+  std::vector<std::string> fields;
+  std::size_t start = 0;
+  for (std::size_t end; (end = text.find(delimiter, start)) != std::string::npos;
+       start = end + 1) {
+    fields.push_back(text.substr(start, end - start));
+  }
+  fields.push_back(text.substr(start));
+  return fields;
+}
+
+TEST_P(StringSearch, SplitMatchesReference) {
+  for (std::size_t size : {0u, 1u, 2u, 63u, 64u, 65u, 128u, 129u, 500u}) {
+    std::string text = random_text(size, static_cast<unsigned>(size) + 10);
+    String str(StringView(text.data(), text.size()));
+    std::vector<std::string> fields;
+    for (StringView field : str.split(',')) {
+      EXPECT_GE(field.data(), str.data());
+      fields.emplace_back(field.data(), field.size());
+    }
+    EXPECT_EQ(fields, reference_split(text, ',')) << size;
+  }
+}
+
+TEST_P(StringSearch, SplitKeepsEmptyFields) {
+  std::vector<std::string> fields;
+  for (StringView field : StringView(",a,,b,").split(',')) {
+    fields.emplace_back(std::string_view(field));
+  }
+  EXPECT_EQ(fields, (std::vector<std::string>{"", "a", "", "b", ""}));
+
+  std::size_t count = 0;
+  for (StringView field : StringView("").split(',')) {
+    EXPECT_TRUE(field.empty());
+    ++count;
+  }
+  EXPECT_EQ(count, 1u);
+}
+
+std::string isa_name(const testing::TestParamInfo<string_detail::SearchIsa>& info) {
+  constexpr const char* kNames[] = {"Scalar", "Sse2", "Avx2", "Neon"};
+  return kNames[static_cast<int>(info.param)];
+}
+
+INSTANTIATE_TEST_SUITE_P(Isa, StringSearch,
+                         testing::Values(string_detail::SearchIsa::Scalar,
+                                         string_detail::SearchIsa::Sse2,
+                                         string_detail::SearchIsa::Avx2,
+                                         string_detail::SearchIsa::Neon),
+                         isa_name);
+
+}  // namespace
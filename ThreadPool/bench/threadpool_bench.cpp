@@ -0,0 +1,144 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+#include "ThreadPool/threadpool.h"
+
+namespace {
+
+// A few nanoseconds of arithmetic per element, so that the loops measure
+// scheduling rather than memory bandwidth.
+double work(std::size_t i) { return std::sqrt(static_cast<double>(i) + 0.5); }
+
+void BM_ForSerial(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  std::vector<double> out(count);
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < count; ++i) {
+      out[i] = work(i);
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ParallelFor(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  ThreadPool pool(static_cast<std::size_t>(state.range(1)));
+  std::vector<double> out(count);
+  for (auto _ : state) {
+    pool.parallel_for(0, count, [&](std::size_t i) { out[i] = work(i); });
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ParallelReduce(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  ThreadPool pool(static_cast<std::size_t>(state.range(1)));
+  for (auto _ : state) {
+    double sum = pool.parallel_reduce(
+        0, count, 0.0,
+        [](std::size_t first, std::size_t last) {
+          double partial = 0;
+          for (std::size_t i = first; i < last; ++i) {
+            partial += work(i);
+          }
+          return partial;
+        },
+        [](double lhs, double rhs) { return lhs + rhs; });
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Naive recursive Fibonacci with a join per call: the cost of a fork.
+std::uint64_t fib(ThreadPool& pool, unsigned n) {
+  if (n < 2) {
+    return n;
+  }
+  std::uint64_t lhs = 0;
+  std::uint64_t rhs = 0;
+  pool.join([&] { lhs = fib(pool, n - 1); }, [&] { rhs = fib(pool, n - 2); });
+  return lhs + rhs;
+}
+
+void BM_JoinFib(benchmark::State& state) {
+  ThreadPool pool(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    std::uint64_t result = 0;
+    // Inside a task, so that every join takes the worker's path.
+    pool.join([&] { result = fib(pool, 20); }, [] {});
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+constexpr std::size_t kSubmits = 10'000;
+
+void BM_Submit(benchmark::State& state) {
+  ThreadPool pool(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    std::atomic<std::size_t> left{kSubmits};
+    std::atomic<bool> done{false};
+    for (std::size_t i = 0; i < kSubmits; ++i) {
+      pool.submit([&] {
+        if (left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          done.store(true, std::memory_order_release);
+          done.notify_one();
+        }
+      });
+    }
+    done.wait(false, std::memory_order_acquire);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(kSubmits));
+}
+
+// Empty tasks, each on a thread of its own.
+void BM_Async(benchmark::State& state) {
+  constexpr std::size_t kTasks = 1'000;
+  for (auto _ : state) {
+    std::vector<std::future<void>> futures;
+    futures.reserve(kTasks);
+    for (std::size_t i = 0; i < kTasks; ++i) {
+      futures.push_back(std::async(std::launch::async, [] {}));
+    }
+    for (auto& future : futures) {
+      future.get();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(kTasks));
+}
+
+}  // namespace
+
+BENCHMARK(BM_ForSerial)->Arg(1 << 20)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ParallelFor)
+    ->ArgNames({"n", "threads"})
+    ->ArgsProduct({{1 << 20}, {1, 2, 4}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ParallelReduce)
+    ->ArgNames({"n", "threads"})
+    ->ArgsProduct({{1 << 20}, {1, 2, 4}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_JoinFib)
+    ->ArgName("threads")
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Submit)
+    ->ArgName("threads")
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Async)->UseRealTime()->Unit(benchmark::kMicrosecond);
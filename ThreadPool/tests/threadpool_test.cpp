@@ -0,0 +1,293 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <latch>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Instrument/instrument.h"
+#include "ThreadPool/threadpool.h"
+
+namespace {
+
+constexpr std::size_t kSizes[] = {0, 1, 7, 1000, 100003};
+
+TEST(ThreadPool, StartsAtLeastOneWorker) {
+  EXPECT_EQ(ThreadPool(0).size(), 1u);
+  EXPECT_EQ(ThreadPool(3).size(), 3u);
+  EXPECT_GE(ThreadPool::default_threads(), 1u);
+  EXPECT_EQ(&ThreadPool::shared(), &ThreadPool::shared());
+  EXPECT_EQ(ThreadPool::shared().size(), ThreadPool::default_threads());
+}
+
+// From outside the pool, more at once than the lock-free injection queue
+// holds.
+TEST(ThreadPool, SubmitRunsEveryTask) {
+  ThreadPool pool(4);
+  constexpr int kTasks = 20000;
+  std::atomic<int> count{0};
+  std::latch done(kTasks);
+  for (int i = 0; i < kTasks; ++i) {
+    pool.submit([&] {
+      count.fetch_add(1, std::memory_order_relaxed);
+      done.count_down();
+    });
+  }
+  done.wait();
+  EXPECT_EQ(count.load(), kTasks);
+}
+
+TEST(ThreadPool, DestructorRunsQueuedTasks) {
+  std::atomic<int> count{0};
+  {
+    ThreadPool pool(2);
+    for (int i = 0; i < 1000; ++i) {
+      pool.submit([&] { count.fetch_add(1, std::memory_order_relaxed); });
+    }
+  }
+  EXPECT_EQ(count.load(), 1000);
+}
+
+TEST(ThreadPool, TasksSubmittedFromTasksRun) {
+  ThreadPool pool(3);
+  std::latch done(100);
+  for (int i = 0; i < 10; ++i) {
+    pool.submit([&] {
+      for (int j = 0; j < 10; ++j) {
+        pool.submit([&] { done.count_down(); });
+      }
+    });
+  }
+  done.wait();
+}
+
+TEST(ThreadPool, JoinRunsBothAndRethrows) {
+  ThreadPool pool(2);
+  int a = 0;
+  int b = 0;
+  pool.join([&] { a = 1; }, [&] { b = 2; });
+  EXPECT_EQ(a + b, 3);
+
+  EXPECT_THROW(pool.join([] {}, [] { throw std::out_of_range("b"); }), std::out_of_range);
+  bool b_ran = false;
+  EXPECT_THROW(pool.join([] { throw std::out_of_range("a"); }, [&] { b_ran = true; }),
+               std::out_of_range);
+  EXPECT_TRUE(b_ran);
+  // a's exception wins when both throw.
+  EXPECT_THROW(pool.join([] { throw std::out_of_range("a"); },
+                         [] { throw std::invalid_argument("b"); }),
+               std::out_of_range);
+}
+
+TEST(ThreadPool, ParallelForCoversEveryIndexOnce) {
+  ThreadPool pool(4);
+  for (std::size_t size : kSizes) {
+    for (std::size_t grain : {std::size_t{0}, std::size_t{1}, std::size_t{64}}) {
+      std::vector<std::atomic<int>> hits(size);
+      pool.parallel_for(
+          0, size, [&](std::size_t i) { hits[i].fetch_add(1, std::memory_order_relaxed); },
+          grain);
+      for (std::size_t i = 0; i < size; ++i) {
+        ASSERT_EQ(hits[i].load(), 1) << size << " " << grain << " " << i;
+      }
+    }
+  }
+}
+
+TEST(ThreadPool, RangesRespectTheGrain) {
+  ThreadPool pool(4);
+  std::mutex mutex;
+  std::vector<std::pair<std::size_t, std::size_t>> ranges;
+  pool.parallel_for_ranges(
+      10, 10010,
+      [&](std::size_t first, std::size_t last) {
+        std::lock_guard lock(mutex);
+        ranges.emplace_back(first, last);
+      },
+      100);
+  std::sort(ranges.begin(), ranges.end());
+  std::size_t next = 10;
+  for (auto [first, last] : ranges) {
+    EXPECT_EQ(first, next);
+    EXPECT_LT(first, last);
+    EXPECT_LE(last - first, 100u);
+    next = last;
+  }
+  EXPECT_EQ(next, 10010u);
+}
+
+// Concatenation is associative but not commutative, so it shows the order.
+TEST(ThreadPool, ParallelReduceKeepsTheOrder) {
+  ThreadPool pool(4);
+  for (std::size_t size : kSizes) {
+    std::vector<std::size_t> expected(size);
+    std::iota(expected.begin(), expected.end(), 0);
+    const auto result = pool.parallel_reduce(
+        0, size, std::vector<std::size_t>(),
+        [](std::size_t first, std::size_t last) {
+          std::vector<std::size_t> part(last - first);
+          std::iota(part.begin(), part.end(), first);
+          return part;
+        },
+        [](std::vector<std::size_t> lhs, const std::vector<std::size_t>& rhs) {
+          lhs.insert(lhs.end(), rhs.begin(), rhs.end());
+          return lhs;
+        },
+        3);
+    EXPECT_EQ(result, expected) << size;
+  }
+}
+
+TEST(ThreadPool, LoopsNest) {
+  ThreadPool pool(4);
+  std::vector<std::atomic<int>> hits(64 * 64);
+  pool.parallel_for(
+      0, 64,
+      [&](std::size_t i) {
+        pool.parallel_for(0, 64, [&](std::size_t j) {
+          hits[i * 64 + j].fetch_add(1, std::memory_order_relaxed);
+        });
+      },
+      1);
+  for (const auto& hit : hits) {
+    ASSERT_EQ(hit.load(), 1);
+  }
+}
+
+TEST(ThreadPool, ExceptionsLeaveLoops) {
+  ThreadPool pool(4);
+  EXPECT_THROW(pool.parallel_for(0, 10000,
+                                 [](std::size_t i) {
+                                   if (i == 5000) {
+                                     throw std::runtime_error("loop");
+                                   }
+                                 }),
+               std::runtime_error);
+  std::atomic<std::size_t> sum{0};
+  pool.parallel_for(0, 1000, [&](std::size_t i) { sum.fetch_add(i); });
+  EXPECT_EQ(sum.load(), 999u * 1000 / 2);
+}
+
+TEST(ThreadPool, IdleWorkersSteal) {
+  ThreadPool pool(4);
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  pool.parallel_for(
+      0, 64,
+      [&](std::size_t) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::lock_guard lock(mutex);
+        threads.insert(std::this_thread::get_id());
+      },
+      1);
+  EXPECT_GT(threads.size(), 1u);
+}
+
+TEST(ThreadPool, CountsWhereTasksRan) {
+  if (!kInstrumentEnabled) {
+    GTEST_SKIP() << "built without PORTFOLIO_INSTRUMENT";
+  }
+  const InstrumentSnapshot before = instrument_snapshot();
+  {
+    ThreadPool pool(4);
+    std::latch done(1000);
+    for (int i = 0; i < 1000; ++i) {
+      pool.submit([&] { done.count_down(); });
+    }
+    done.wait();
+    pool.parallel_for(
+        0, 64, [](std::size_t) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }, 1);
+  }
+  // The workers have exited; what they counted is still in the totals.
+  const InstrumentSnapshot after = instrument_snapshot();
+  const auto delta = [&](const char* name) { return after.counter(name) - before.counter(name); };
+  EXPECT_GE(delta("threadpool.inject"), 1000u);
+  EXPECT_EQ(delta("threadpool.run_injected"), delta("threadpool.inject"));
+  EXPECT_GT(delta("threadpool.steal"), 0u);
+  const HistogramSnapshot* tasks = after.histogram("threadpool.task");
+  ASSERT_NE(tasks, nullptr);
+  const HistogramSnapshot* tasks_before = before.histogram("threadpool.task");
+  EXPECT_GE(tasks->count - (tasks_before == nullptr ? 0 : tasks_before->count),
+            delta("threadpool.run_injected") + delta("threadpool.run_local") +
+                delta("threadpool.steal"));
+  EXPECT_NE(after.histogram("threadpool.deque_depth"), nullptr);
+}
+
+// An outside caller asleep in join must not take the wake-up meant for an
+// idle worker: x only returns once y runs elsewhere.
+TEST(ThreadPool, OutsideWaitersLeaveWakeUpsToWorkers) {
+  ThreadPool pool(2);
+  for (int round = 0; round < 5; ++round) {
+    std::atomic<bool> started{false};
+    bool ran_elsewhere = false;
+    pool.join(
+        [&] {
+          // By now the caller and the other worker are both asleep.
+          std::this_thread::sleep_for(std::chrono::milliseconds(50));
+          pool.join(
+              [&] {
+                const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+                while (!started.load() && std::chrono::steady_clock::now() < deadline) {
+                  std::this_thread::yield();
+                }
+                ran_elsewhere = started.load();
+              },
+              [&] { started.store(true); });
+        },
+        [] {});
+    EXPECT_TRUE(ran_elsewhere) << round;
+  }
+}
+
+// Many outside threads hand loops over at once.
+TEST(ThreadPool, ManyOutsideThreads) {
+  ThreadPool pool(4);
+  std::vector<std::thread> threads;
+  std::atomic<int> wrong{0};
+  for (int t = 0; t < 16; ++t) {
+    threads.emplace_back([&] {
+      for (int round = 0; round < 200; ++round) {
+        const std::size_t sum = pool.parallel_reduce(
+            0, 1000, std::size_t{0},
+            [](std::size_t first, std::size_t last) {
+              std::size_t part = 0;
+              for (std::size_t i = first; i < last; ++i) {
+                part += i;
+              }
+              return part;
+            },
+            [](std::size_t lhs, std::size_t rhs) { return lhs + rhs; }, 50);
+        if (sum != 999u * 1000 / 2) {
+          wrong.fetch_add(1);
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(wrong.load(), 0);
+}
+
+TEST(ThreadPool, SingleWorkerRunsLoopsInline) {
+  ThreadPool pool(1);
+  const std::thread::id caller = std::this_thread::get_id();
+  bool inline_only = true;
+  pool.parallel_for(0, 100, [&](std::size_t) {
+    inline_only = inline_only && std::this_thread::get_id() == caller;
+  });
+  EXPECT_TRUE(inline_only);
+  std::latch done(1);
+  pool.submit([&] { done.count_down(); });
+  done.wait();
+}
+
+}  // namespace
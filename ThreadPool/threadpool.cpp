@@ -0,0 +1,382 @@
+// Workers, deques and sleeping for ThreadPool.
+//
+// The deque is Chase and Lev's, with the memory orders of Le, Pop, Cohen
+// and Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory
+// Models" (2013). Its ring buffer doubles when full; thieves may still be
+// reading the old one, so outgrown buffers are kept until the deque dies,
+// which costs at most as much again as the largest.
+//
+// Sleeping: a worker about to sleep counts itself in sleepers_, reads
+// epoch_, looks for work once more and then waits for epoch_ to change.
+// Whoever makes work bumps epoch_ and wakes one worker if it sees a
+// sleeper; whoever finishes a stolen task wakes them all. With
+// sequentially consistent fences on both sides, either the sleeper finds
+// the work in its last look or the bump happens after its read of epoch_,
+// so no wake-up is lost. A thread outside the pool waiting in join cannot
+// run work, so it sleeps apart, on waiter_epoch_ and counted in waiters_,
+// and only finished tasks wake it: the wake-up for new work always goes
+// to a worker.
+//
+// With PORTFOLIO_INSTRUMENT, every task is a "threadpool.task" span, and
+// the counters tell where tasks came from (own deque, steal, injected
+// queue), how often a steal attempt found nothing and how often a thread
+// stopped spinning to sleep; "threadpool.deque_depth" samples a worker's
+// deque at every push.
+
+#include "ThreadPool/threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Instrument/instrument.h"
+
+namespace threadpool_detail {
+
+namespace {
+
+class WorkDeque {
+ public:
+  WorkDeque() : buffer_(new Buffer(kInitialCapacity)) { buffers_.emplace_back(buffer_.load()); }
+
+  WorkDeque(const WorkDeque&) = delete;
+  WorkDeque& operator=(const WorkDeque&) = delete;
+
+  // Owner only.
+  void push(Task* task) {
+    const std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    const std::int64_t top = top_.load(std::memory_order_acquire);
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    if (bottom - top >= static_cast<std::int64_t>(buffer->capacity)) {
+      buffer = grow(buffer, top, bottom);
+    }
+    buffer->put(bottom, task);
+    bottom_.store(bottom + 1, std::memory_order_release);
+  }
+
+  // Owner only: the most recently pushed task, or nullptr.
+  Task* pop() {
+    const std::int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    Task* task = buffer->get(bottom);
+    if (top == bottom) {
+      // The last task: race the thieves for it.
+      if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        task = nullptr;
+      }
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return task;
+  }
+
+  // Any thread: the oldest task, or nullptr if there is none or another
+  // thread took it first.
+  Task* steal() {
+    std::int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const std::int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return nullptr;
+    }
+    Task* task = buffer_.load(std::memory_order_acquire)->get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return task;
+  }
+
+  bool empty() const {
+    return top_.load(std::memory_order_acquire) >= bottom_.load(std::memory_order_acquire);
+  }
+
+  // Owner only; thieves may make it smaller meanwhile.
+  std::size_t size() const {
+    const std::int64_t size =
+        bottom_.load(std::memory_order_relaxed) - top_.load(std::memory_order_relaxed);
+    return size > 0 ? static_cast<std::size_t>(size) : 0;
+  }
+
+ private:
+  static constexpr std::size_t kInitialCapacity = 256;
+
+  struct Buffer {
+    explicit Buffer(std::size_t size) : capacity(size), slots(new std::atomic<Task*>[size]) {}
+
+    Task* get(std::int64_t index) const {
+      return slots[static_cast<std::size_t>(index) & (capacity - 1)].load(
+          std::memory_order_relaxed);
+    }
+    void put(std::int64_t index, Task* task) {
+      slots[static_cast<std::size_t>(index) & (capacity - 1)].store(task,
+                                                                     std::memory_order_relaxed);
+    }
+
+    std::size_t capacity;
+    std::unique_ptr<std::atomic<Task*>[]> slots;
+  };
+
+  Buffer* grow(Buffer* old, std::int64_t top, std::int64_t bottom) {
+    auto* bigger = new Buffer(2 * old->capacity);
+    buffers_.emplace_back(bigger);
+    for (std::int64_t i = top; i < bottom; ++i) {
+      bigger->put(i, old->get(i));
+    }
+    buffer_.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  // Apart, so that thieves bumping top do not slow the owner's bottom.
+  alignas(64) std::atomic<std::int64_t> top_{0};
+  alignas(64) std::atomic<std::int64_t> bottom_{0};
+  std::atomic<Buffer*> buffer_;
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+};
+
+// Slots of the lock-free part of the queue of tasks from other threads.
+constexpr std::size_t kInjectedCapacity = 1024;
+
+// Rounds of looking for work, yielding in between, before going to sleep.
+constexpr int kSpins = 16;
+
+void run(Task* task) {
+  PORTFOLIO_SCOPE("threadpool.task");
+  task->execute(task);
+}
+
+}  // namespace
+
+struct Worker {
+  Worker(ThreadPool& owner, std::size_t position) : pool(&owner), index(position) {}
+
+  // xorshift64, for picking victims.
+  std::size_t random() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return static_cast<std::size_t>(state);
+  }
+
+  ThreadPool* pool;
+  std::size_t index;
+  std::uint64_t state = 0x9E3779B97F4A7C15ULL ^ (index + 1);
+  WorkDeque deque;
+};
+
+namespace {
+
+thread_local Worker* current = nullptr;
+
+}  // namespace
+
+}  // namespace threadpool_detail
+
+using threadpool_detail::Task;
+using threadpool_detail::Worker;
+using threadpool_detail::kInjectedCapacity;
+using threadpool_detail::kSpins;
+using threadpool_detail::run;
+
+ThreadPool::ThreadPool(std::size_t threads) : injected_(kInjectedCapacity) {
+  threads = std::max<std::size_t>(threads, 1);
+  workers_.reserve(threads);
+  for (std::size_t i = 0; i < threads; ++i) {
+    workers_.push_back(std::make_unique<Worker>(*this, i));
+  }
+  threads_.reserve(threads);
+  for (std::size_t i = 0; i < threads; ++i) {
+    threads_.emplace_back([this, worker = workers_[i].get()] { work(worker); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  stop_.store(true, std::memory_order_seq_cst);
+  epoch_.fetch_add(1, std::memory_order_seq_cst);
+  epoch_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+ThreadPool& ThreadPool::shared() {
+  static ThreadPool pool;
+  return pool;
+}
+
+std::size_t ThreadPool::default_threads() noexcept {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+Worker* ThreadPool::current_worker() const noexcept {
+  Worker* self = threadpool_detail::current;
+  return self != nullptr && self->pool == this ? self : nullptr;
+}
+
+void ThreadPool::schedule(Task* task) {
+  if (Worker* self = current_worker()) {
+    push(self, task);
+  } else {
+    inject(task);
+  }
+}
+
+void ThreadPool::push(Worker* self, Task* task) {
+  self->deque.push(task);
+  PORTFOLIO_RECORD("threadpool.deque_depth", self->deque.size());
+  wake_one();
+}
+
+void ThreadPool::inject(Task* task) {
+  PORTFOLIO_COUNT("threadpool.inject", 1);
+  if (!injected_.try_push(task)) {
+    PORTFOLIO_COUNT("threadpool.inject_overflow", 1);
+    std::lock_guard lock(overflow_mutex_);
+    overflow_.push_back(task);
+    overflow_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+  wake_one();
+}
+
+bool ThreadPool::take_back(Worker* self, Task* task) {
+  while (Task* top = self->deque.pop()) {
+    if (top == task) {
+      return true;
+    }
+    run(top);
+  }
+  return false;
+}
+
+bool ThreadPool::run_one(Worker* self) {
+  if (self != nullptr) {
+    if (Task* task = self->deque.pop()) {
+      PORTFOLIO_COUNT("threadpool.run_local", 1);
+      run(task);
+      return true;
+    }
+    const std::size_t count = workers_.size();
+    const std::size_t start = self->random() % count;
+    for (std::size_t i = 0; i < count; ++i) {
+      Worker* victim = workers_[(start + i) % count].get();
+      if (victim == self) {
+        continue;
+      }
+      if (Task* task = victim->deque.steal()) {
+        PORTFOLIO_COUNT("threadpool.steal", 1);
+        run(task);
+        return true;
+      }
+      PORTFOLIO_COUNT("threadpool.steal_miss", 1);
+    }
+  }
+  Task* task = nullptr;
+  if (!injected_.try_pop(task)) {
+    if (overflow_count_.load(std::memory_order_relaxed) == 0) {
+      return false;
+    }
+    std::lock_guard lock(overflow_mutex_);
+    if (overflow_.empty()) {
+      return false;
+    }
+    task = overflow_.front();
+    overflow_.pop_front();
+    overflow_count_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  PORTFOLIO_COUNT("threadpool.run_injected", 1);
+  run(task);
+  return true;
+}
+
+bool ThreadPool::has_work() const {
+  if (!injected_.empty() || overflow_count_.load(std::memory_order_relaxed) != 0) {
+    return true;
+  }
+  return std::any_of(workers_.begin(), workers_.end(),
+                     [](const auto& worker) { return !worker->deque.empty(); });
+}
+
+void ThreadPool::wait(const std::atomic<bool>& done, Worker* self) {
+  int spins = 0;
+  while (!done.load(std::memory_order_acquire)) {
+    if (self != nullptr && run_one(self)) {
+      spins = 0;
+      continue;
+    }
+    if (++spins < kSpins) {
+      std::this_thread::yield();
+      continue;
+    }
+    PORTFOLIO_COUNT("threadpool.sleep", 1);
+    std::atomic<std::size_t>& count = self != nullptr ? sleepers_ : waiters_;
+    std::atomic<std::uint32_t>& epoch = self != nullptr ? epoch_ : waiter_epoch_;
+    count.fetch_add(1, std::memory_order_seq_cst);
+    const std::uint32_t seen = epoch.load(std::memory_order_seq_cst);
+    if (!done.load(std::memory_order_seq_cst) && !(self != nullptr && has_work())) {
+      epoch.wait(seen, std::memory_order_seq_cst);
+    }
+    count.fetch_sub(1, std::memory_order_seq_cst);
+    spins = 0;
+  }
+}
+
+void ThreadPool::wake_one() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleepers_.load(std::memory_order_seq_cst) != 0) {
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    epoch_.notify_one();
+  }
+}
+
+void ThreadPool::wake_all() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleepers_.load(std::memory_order_seq_cst) != 0) {
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    epoch_.notify_all();
+  }
+  if (waiters_.load(std::memory_order_seq_cst) != 0) {
+    waiter_epoch_.fetch_add(1, std::memory_order_seq_cst);
+    waiter_epoch_.notify_all();
+  }
+}
+
+void ThreadPool::work(Worker* self) {
+  threadpool_detail::current = self;
+  int spins = 0;
+  while (true) {
+    if (run_one(self)) {
+      spins = 0;
+      continue;
+    }
+    if (++spins < kSpins) {
+      std::this_thread::yield();
+      continue;
+    }
+    PORTFOLIO_COUNT("threadpool.sleep", 1);
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    const std::uint32_t seen = epoch_.load(std::memory_order_seq_cst);
+    const bool stopping = stop_.load(std::memory_order_seq_cst);
+    const bool work_left = has_work();
+    if (!stopping && !work_left) {
+      epoch_.wait(seen, std::memory_order_seq_cst);
+    }
+    sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+    if (stopping && !work_left) {
+      return;
+    }
+    spins = 0;
+  }
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+// A work-stealing thread pool for fork-join parallelism.
+//
+// Every worker owns a Chase-Lev deque: it pushes and pops tasks at the
+// bottom without locks while idle workers steal from the top, so a worker
+// splitting a loop in halves keeps the small pieces near the bottom and
+// thieves take the large ones. join(a, b) pushes b, runs a and then takes
+// b back unless it was stolen, in which case the worker runs other tasks
+// until b is done. parallel_for and parallel_reduce split their range like
+// that until the pieces reach the grain. None of this allocates: the tasks
+// of join live in its stack frame.
+//
+// Threads that are not workers of the pool hand their work to the pool
+// through a lock-free MpmcQueue, or a locked queue once that is full, and
+// block until it is done. A pool with a single
+// worker runs the loops of such threads on the calling thread instead, as
+// there is nothing to gain from handing them over. ThreadPool::shared() is
+// the one pool of the process that the portfolio projects use, so that
+// they do not each start threads of their own.
+//
+// Idle workers spin briefly, then sleep on a futex that every new task and
+// every finished stolen task bumps while anyone sleeps.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Queue/queue.h"
+
+class ThreadPool;
+
+namespace threadpool_detail {
+
+struct Worker;
+
+struct Task {
+  void (*execute)(Task*) = nullptr;
+};
+
+// A task of join(): a reference to the callable in the caller's frame, the
+// exception it threw, and a flag set when it is done.
+template <typename F>
+struct StackTask : Task {
+  StackTask(ThreadPool& owner, F& callable) : pool(&owner), fn(&callable) {
+    execute = &run;
+  }
+
+  static void run(Task* task);
+
+  ThreadPool* pool;
+  F* fn;
+  std::exception_ptr error;
+  std::atomic<bool> done{false};
+};
+
+// A task of submit(), owning its callable and deleting itself when run.
+template <typename F>
+struct HeapTask : Task {
+  explicit HeapTask(F callable) : fn(std::move(callable)) { execute = &run; }
+
+  static void run(Task* task) noexcept {
+    std::unique_ptr<HeapTask> self(static_cast<HeapTask*>(task));
+    self->fn();
+  }
+
+  F fn;
+};
+
+}  // namespace threadpool_detail
+
+class ThreadPool {
+ public:
+  // Starts the given number of worker threads, at least one.
+  explicit ThreadPool(std::size_t threads = default_threads());
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Runs the tasks still queued, then joins the workers. Tasks must not be
+  // submitted from other threads meanwhile.
+  ~ThreadPool();
+
+  // The pool shared by the whole process, with default_threads() workers.
+  static ThreadPool& shared();
+
+  // std::thread::hardware_concurrency(), at least 1.
+  static std::size_t default_threads() noexcept;
+
+  std::size_t size() const noexcept { return workers_.size(); }
+
+  // Runs fn() on some worker at some point. fn must not throw: like a
+  // std::thread's function, an exception escaping it terminates.
+  template <typename F>
+  void submit(F&& fn) {
+    using Callable = std::decay_t<F>;
+    auto* task = new threadpool_detail::HeapTask<Callable>(std::forward<F>(fn));
+    schedule(task);
+  }
+
+  // Runs a() and b(), possibly in parallel, and returns once both are done.
+  // If either throws, the exception is rethrown after both finish, a's if
+  // both throw.
+  template <typename A, typename B>
+  void join(A&& a, B&& b) {
+    threadpool_detail::Worker* self = current_worker();
+    if (self == nullptr) {
+      if (size() <= 1) {
+        a();
+        b();
+        return;
+      }
+      auto both = [&] { join(a, b); };
+      threadpool_detail::StackTask<decltype(both)> task(*this, both);
+      inject(&task);
+      wait(task.done, nullptr);
+      rethrow(task.error);
+      return;
+    }
+
+    threadpool_detail::StackTask<std::remove_reference_t<B>> task(*this, b);
+    push(self, &task);
+    std::exception_ptr error;
+    try {
+      a();
+    } catch (...) {
+      error = std::current_exception();
+    }
+    if (take_back(self, &task)) {
+      // Not stolen: run b here.
+      threadpool_detail::StackTask<std::remove_reference_t<B>>::run(&task);
+    } else {
+      wait(task.done, self);
+    }
+    rethrow(error);
+    rethrow(task.error);
+  }
+
+  // body(begin, end) over disjoint ranges that cover [begin, end), none
+  // longer than grain; 0 picks a grain giving a few ranges per worker.
+  template <typename Body>
+  void parallel_for_ranges(std::size_t begin, std::size_t end, Body&& body, std::size_t grain = 0) {
+    if (begin >= end) {
+      return;
+    }
+    grain = grain_for(end - begin, grain);
+    if (end - begin <= grain || (size() <= 1 && current_worker() == nullptr)) {
+      for (std::size_t first = begin; first < end; first += std::min(grain, end - first)) {
+        body(first, first + std::min(grain, end - first));
+      }
+      return;
+    }
+    split(begin, end, grain, body);
+  }
+
+  // body(i) for every i in [begin, end), in ranges as above.
+  template <typename Body>
+  void parallel_for(std::size_t begin, std::size_t end, Body&& body, std::size_t grain = 0) {
+    parallel_for_ranges(
+        begin, end,
+        [&body](std::size_t first, std::size_t last) {
+          for (std::size_t i = first; i < last; ++i) {
+            body(i);
+          }
+        },
+        grain);
+  }
+
+  // reduce() of body(first, last) over ranges as above, combined in the
+  // order of the ranges; identity for an empty range. reduce must be
+  // associative, and identity neutral for it.
+  template <typename T, typename Body, typename Reduce>
+  T parallel_reduce(std::size_t begin, std::size_t end, T identity, Body&& body, Reduce&& reduce,
+                    std::size_t grain = 0) {
+    if (begin >= end) {
+      return identity;
+    }
+    grain = grain_for(end - begin, grain);
+    if (size() <= 1 && current_worker() == nullptr) {
+      T result = identity;
+      for (std::size_t first = begin; first < end; first += std::min(grain, end - first)) {
+        result = reduce(std::move(result), body(first, first + std::min(grain, end - first)));
+      }
+      return result;
+    }
+    return split_reduce(begin, end, grain, identity, body, reduce);
+  }
+
+ private:
+  template <typename F>
+  friend struct threadpool_detail::StackTask;
+
+  std::size_t grain_for(std::size_t count, std::size_t grain) const {
+    if (grain != 0) {
+      return grain;
+    }
+    const std::size_t pieces = 4 * size();
+    return std::max<std::size_t>(1, (count + pieces - 1) / pieces);
+  }
+
+  template <typename Body>
+  void split(std::size_t begin, std::size_t end, std::size_t grain, Body& body) {
+    if (end - begin <= grain) {
+      body(begin, end);
+      return;
+    }
+    const std::size_t middle = begin + (end - begin) / 2;
+    join([&] { split(begin, middle, grain, body); }, [&] { split(middle, end, grain, body); });
+  }
+
+  template <typename T, typename Body, typename Reduce>
+  T split_reduce(std::size_t begin, std::size_t end, std::size_t grain, const T& identity,
+                 Body& body, Reduce& reduce) {
+    if (end - begin <= grain) {
+      return body(begin, end);
+    }
+    const std::size_t middle = begin + (end - begin) / 2;
+    T left = identity;
+    T right = identity;
+    join([&] { left = split_reduce(begin, middle, grain, identity, body, reduce); },
+         [&] { right = split_reduce(middle, end, grain, identity, body, reduce); });
+    return reduce(std::move(left), std::move(right));
+  }
+
+  static void rethrow(const std::exception_ptr& error) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  // The calling thread's worker if it is one of this pool, else nullptr.
+  threadpool_detail::Worker* current_worker() const noexcept;
+
+  // Puts task on the calling worker's deque, or the shared queue.
+  void schedule(threadpool_detail::Task* task);
+  void push(threadpool_detail::Worker* self, threadpool_detail::Task* task);
+  void inject(threadpool_detail::Task* task);
+  // Pops self's deque down to task, running the tasks pushed after it;
+  // false if task was stolen.
+  bool take_back(threadpool_detail::Worker* self, threadpool_detail::Task* task);
+
+  // Runs one task found anywhere; false if there was none.
+  bool run_one(threadpool_detail::Worker* self);
+  bool has_work() const;
+
+  // Runs tasks (if self is a worker) or sleeps until done is set.
+  void wait(const std::atomic<bool>& done, threadpool_detail::Worker* self);
+  void wake_one();
+  void wake_all();
+
+  void work(threadpool_detail::Worker* self);
+
+  std::vector<std::unique_ptr<threadpool_detail::Worker>> workers_;
+  std::vector<std::thread> threads_;
+
+  // Tasks from other threads; overflow_ takes those that find it full.
+  MpmcQueue<threadpool_detail::Task*> injected_;
+  std::mutex overflow_mutex_;
+  std::deque<threadpool_detail::Task*> overflow_;
+  std::atomic<std::size_t> overflow_count_{0};
+
+  // Sleeping workers wait for epoch_ to change; it is bumped only while any
+  // sleep. Threads outside the pool waiting in join have waiter_epoch_.
+  std::atomic<std::uint32_t> epoch_{0};
+  std::atomic<std::size_t> sleepers_{0};
+  std::atomic<std::uint32_t> waiter_epoch_{0};
+  std::atomic<std::size_t> waiters_{0};
+  std::atomic<bool> stop_{false};
+};
+
+template <typename F>
+void threadpool_detail::StackTask<F>::run(Task* task) {
+  auto* self = static_cast<StackTask*>(task);
+  try {
+    (*self->fn)();
+  } catch (...) {
+    self->error = std::current_exception();
+  }
+  // The waiting frame may return as soon as done is set.
+  ThreadPool* pool = self->pool;
+  self->done.store(true, std::memory_order_seq_cst);
+  pool->wake_all();
+}
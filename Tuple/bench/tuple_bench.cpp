@@ -0,0 +1,69 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "Tuple/tuple.h"
+
+namespace {
+
+struct Tag {};
+
+// A typical small record: declared in an order that leaves std::tuple with
+// 9 bytes of padding out of 24.
+template <template <typename...> class T>
+using Record = T<std::uint8_t, double, std::uint16_t, Tag, std::uint32_t>;
+
+template <template <typename...> class T>
+Record<T> make(std::size_t i) {
+  return Record<T>(static_cast<std::uint8_t>(i), static_cast<double>(i),
+                   static_cast<std::uint16_t>(i), Tag{}, static_cast<std::uint32_t>(i));
+}
+
+// Fills a vector of state.range(0) records.
+template <template <typename...> class T>
+void BM_Fill(benchmark::State& state) {
+  auto count = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    std::vector<Record<T>> records;
+    records.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      records.push_back(make<T>(i));
+    }
+    benchmark::DoNotOptimize(records.data());
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * count));
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * count *
+                                                    sizeof(Record<T>)));
+  state.counters["bytes_per_record"] = sizeof(Record<T>);
+}
+
+// Sums two fields over state.range(0) records, bound by memory bandwidth
+// once the vector leaves the cache.
+template <template <typename...> class T>
+void BM_Scan(benchmark::State& state) {
+  auto count = static_cast<std::size_t>(state.range(0));
+  std::vector<Record<T>> records;
+  records.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    records.push_back(make<T>(i));
+  }
+  for (auto _ : state) {
+    double sum = 0;
+    for (const Record<T>& record : records) {
+      sum += get<1>(record) + get<4>(record);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * count));
+  state.counters["bytes_per_record"] = sizeof(Record<T>);
+}
+
+BENCHMARK_TEMPLATE(BM_Fill, std::tuple)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_Fill, Tuple)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_Scan, std::tuple)->Arg(1 << 12)->Arg(1 << 22);
+BENCHMARK_TEMPLATE(BM_Scan, Tuple)->Arg(1 << 12)->Arg(1 << 22);
+
+}  // namespace
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+
+#include <compare>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Tuple/tuple.h"
+
+namespace {
+
+struct Empty {};
+struct OtherEmpty {};
+
+struct ExplicitOnly {
+  explicit ExplicitOnly(int value) : value(value) {}
+  int value;
+};
+
+// Records the order in which elements are destroyed.
+struct Logged {
+  explicit Logged(std::vector<int>* log, int id) : log(log), id(id) {}
+  Logged(Logged&& other) noexcept : log(other.log), id(other.id) { other.log = nullptr; }
+  ~Logged() {
+    if (log != nullptr) {
+      log->push_back(id);
+    }
+  }
+  std::vector<int>* log;
+  int id;
+};
+
+static_assert(sizeof(Tuple<char, double, char>) == 16);
+static_assert(sizeof(Tuple<char, double, char>) < sizeof(std::tuple<char, double, char>));
+static_assert(sizeof(Tuple<int, Empty, OtherEmpty>) == sizeof(int));
+static_assert(sizeof(Tuple<char, int, short, char>) == 8);
+static_assert(std::is_empty_v<Tuple<Empty, OtherEmpty>>);
+static_assert(std::is_trivially_copyable_v<Tuple<int, double, char>>);
+static_assert(std::tuple_size_v<Tuple<int, char, long>> == 3);
+static_assert(std::is_same_v<std::tuple_element_t<1, Tuple<int, char, long>>, char>);
+
+// Conversions are implicit exactly when every element converts implicitly.
+static_assert(std::is_convertible_v<Tuple<int, long>, Tuple<long, double>>);
+static_assert(std::is_constructible_v<Tuple<ExplicitOnly>, Tuple<int>>);
+static_assert(!std::is_convertible_v<Tuple<int>, Tuple<ExplicitOnly>>);
+static_assert(!std::is_convertible_v<int, Tuple<ExplicitOnly>>);
+static_assert(std::is_constructible_v<Tuple<ExplicitOnly>, int>);
+static_assert(!std::is_constructible_v<Tuple<int, int>, int>);
+static_assert(!std::is_default_constructible_v<Tuple<int&>>);
+
+constexpr int constexpr_sum() {
+  Tuple<int, char, long> tuple(1, 2, 3L);
+  get<0>(tuple) += 10;
+  return apply([](int a, char b, long c) { return a + b + static_cast<int>(c); }, tuple);
+}
+static_assert(constexpr_sum() == 16);
+
+TEST(Tuple, DefaultConstructionValueInitializes) {
+  Tuple<int, double, char, int*> tuple;
+  EXPECT_EQ(get<0>(tuple), 0);
+  EXPECT_EQ(get<1>(tuple), 0.0);
+  EXPECT_EQ(get<2>(tuple), '\0');
+  EXPECT_EQ(get<3>(tuple), nullptr);
+}
+
+TEST(Tuple, IndexNamesTheDeclaredElement) {
+  Tuple<char, double, short, std::string> tuple('a', 2.5, short{7}, "text");
+  EXPECT_EQ(get<0>(tuple), 'a');
+  EXPECT_EQ(get<1>(tuple), 2.5);
+  EXPECT_EQ(get<2>(tuple), 7);
+  EXPECT_EQ(get<3>(tuple), "text");
+  EXPECT_EQ(get<double>(tuple), 2.5);
+  EXPECT_EQ(get<std::string>(tuple), "text");
+
+  get<char>(tuple) = 'b';
+  EXPECT_EQ(get<0>(tuple), 'b');
+}
+
+TEST(Tuple, GetKeepsTheValueCategory) {
+  using T = Tuple<std::string, int&>;
+  static_assert(std::is_same_v<decltype(get<0>(std::declval<T&>())), std::string&>);
+  static_assert(std::is_same_v<decltype(get<0>(std::declval<const T&>())), const std::string&>);
+  static_assert(std::is_same_v<decltype(get<0>(std::declval<T>())), std::string&&>);
+  static_assert(std::is_same_v<decltype(get<1>(std::declval<T>())), int&>);
+
+  Tuple<std::unique_ptr<int>> owner(std::make_unique<int>(5));
+  std::unique_ptr<int> taken = get<0>(std::move(owner));
+  ASSERT_NE(taken, nullptr);
+  EXPECT_EQ(*taken, 5);
+  EXPECT_EQ(get<0>(owner), nullptr);
+}
+
+TEST(Tuple, ConvertsFromOtherTuples) {
+  Tuple<int, const char*> source(3, "text");
+  Tuple<long, std::string> copied = source;
+  EXPECT_EQ(get<0>(copied), 3);
+  EXPECT_EQ(get<1>(copied), "text");
+
+  Tuple<ExplicitOnly> explicit_from(Tuple<int>(9));
+  EXPECT_EQ(get<0>(explicit_from).value, 9);
+
+  Tuple<std::unique_ptr<int>> owner(std::make_unique<int>(1));
+  Tuple<std::shared_ptr<int>> shared(std::move(owner));
+  ASSERT_NE(get<0>(shared), nullptr);
+  EXPECT_EQ(*get<0>(shared), 1);
+}
+
+TEST(Tuple, AssignsThroughReferences) {
+  int a = 1;
+  std::string b = "one";
+  Tuple<int&, std::string&> refs(a, b);
+  refs = Tuple<int, std::string>(2, "two");
+  EXPECT_EQ(a, 2);
+  EXPECT_EQ(b, "two");
+
+  tie(a, b) = makeTuple(3, std::string("three"));
+  EXPECT_EQ(a, 3);
+  EXPECT_EQ(b, "three");
+}
+
+TEST(Tuple, DestroysInReverseStorageOrder) {
+  std::vector<int> log;
+  {
+    Tuple<Logged, Logged> tuple(Logged(&log, 0), Logged(&log, 1));
+  }
+  EXPECT_EQ(log, (std::vector<int>{1, 0}));
+}
+
+TEST(Tuple, MakeTupleDecaysAndUnwrapsReferenceWrappers) {
+  int value = 1;
+  auto tuple = makeTuple(value, std::ref(value), "text");
+  static_assert(std::is_same_v<decltype(tuple), Tuple<int, int&, const char*>>);
+  get<1>(tuple) = 5;
+  EXPECT_EQ(value, 5);
+  EXPECT_EQ(get<0>(tuple), 1);
+}
+
+TEST(Tuple, ForwardAsTupleKeepsReferences) {
+  int lvalue = 1;
+  auto tuple = forwardAsTuple(lvalue, 2);
+  static_assert(std::is_same_v<decltype(tuple), Tuple<int&, int&&>>);
+  get<0>(tuple) = 7;
+  EXPECT_EQ(lvalue, 7);
+}
+
+TEST(Tuple, ApplyForwardsElements) {
+  Tuple<std::unique_ptr<int>, int> tuple(std::make_unique<int>(4), 3);
+  int result = apply([](std::unique_ptr<int> p, int n) { return *p * n; }, std::move(tuple));
+  EXPECT_EQ(result, 12);
+  EXPECT_EQ(get<0>(tuple), nullptr);
+}
+
+TEST(Tuple, TupleCatConcatenates) {
+  int value = 1;
+  Tuple<int, char> first(1, 'a');
+  Tuple<> empty;
+  auto joined = tupleCat(first, empty, Tuple<std::string>("s"), tie(value));
+  static_assert(std::is_same_v<decltype(joined), Tuple<int, char, std::string, int&>>);
+  EXPECT_EQ(get<0>(joined), 1);
+  EXPECT_EQ(get<1>(joined), 'a');
+  EXPECT_EQ(get<2>(joined), "s");
+  get<3>(joined) = 8;
+  EXPECT_EQ(value, 8);
+
+  Tuple<std::unique_ptr<int>> owner(std::make_unique<int>(2));
+  auto moved = tupleCat(std::move(owner), Tuple<int>(3));
+  ASSERT_NE(get<0>(moved), nullptr);
+  EXPECT_EQ(*get<0>(moved), 2);
+  EXPECT_EQ(get<0>(owner), nullptr);
+
+  static_assert(std::is_same_v<decltype(tupleCat()), Tuple<>>);
+}
+
+TEST(Tuple, ComparesLexicographically) {
+  using T = Tuple<int, std::string>;
+  EXPECT_EQ(T(1, "a"), T(1, "a"));
+  EXPECT_NE(T(1, "a"), T(1, "b"));
+  EXPECT_LT(T(1, "b"), T(2, "a"));
+  EXPECT_LT(T(1, "a"), T(1, "b"));
+  EXPECT_EQ(T(1, "a") <=> T(1, "a"), std::strong_ordering::equal);
+
+  using F = Tuple<double>;
+  EXPECT_EQ(F(0.0 / 0.0) <=> F(1.0), std::partial_ordering::unordered);
+}
+
+TEST(Tuple, Swaps) {
+  Tuple<int, std::string> a(1, "a");
+  Tuple<int, std::string> b(2, "b");
+  swap(a, b);
+  EXPECT_EQ(a, (Tuple<int, std::string>(2, "b")));
+  EXPECT_EQ(b, (Tuple<int, std::string>(1, "a")));
+}
+
+TEST(Tuple, SupportsStructuredBindings) {
+  Tuple<int, std::string, Empty> tuple(1, "text", Empty{});
+  auto& [number, text, empty] = tuple;
+  number = 2;
+  text += "!";
+  (void)empty;
+  EXPECT_EQ(get<0>(tuple), 2);
+  EXPECT_EQ(get<1>(tuple), "text!");
+}
+
+}  // namespace
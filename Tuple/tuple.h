@@ -0,0 +1,512 @@
+#pragma once
+
+// Tuple that spends no space on empty members and none on padding.
+//
+// Every element lives in its own leaf base, Leaf<I, T>, holding the value as
+// a [[no_unique_address]] member, so stateless elements (allocators,
+// comparators, tags) take zero bytes. The leaves are laid out by decreasing
+// alignment rather than in declaration order, which removes all padding but
+// the tail: Tuple<char, double, char> is 16 bytes where std::tuple needs 24.
+// Index I always names the I-th declared element; only the storage order
+// changes, and with it the order in which elements are constructed and
+// destroyed.
+//
+// Nothing here recurses over the element list. An element is found by
+// deducing its leaf base, and tupleCat computes, for every element of the
+// result, which argument and which element of it to take from two constexpr
+// tables, so instantiation depth stays constant however many tuples or
+// elements there are.
+//
+// Tuples work with structured bindings; the free functions, including
+// get, tie and apply, are found by argument-dependent lookup.
+
+#include <compare>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+template <typename... Ts>
+class Tuple;
+
+namespace tuple_detail {
+
+// Type at index I, found with one overload resolution instead of a
+// recursive template.
+template <std::size_t I, typename T>
+struct Indexed {
+  using type = T;
+};
+
+template <typename Sequence, typename... Ts>
+struct Indexer;
+
+template <std::size_t... Is, typename... Ts>
+struct Indexer<std::index_sequence<Is...>, Ts...> : Indexed<Is, Ts>... {};
+
+template <std::size_t I, typename T>
+Indexed<I, T> select_index(const Indexed<I, T>&);
+
+template <std::size_t I, typename... Ts>
+using TypeAt = typename decltype(select_index<I>(
+    Indexer<std::index_sequence_for<Ts...>, Ts...>{}))::type;
+
+template <typename T, typename... Ts>
+constexpr std::size_t index_of() {
+  constexpr bool kMatches[] = {std::is_same_v<T, Ts>...};
+  std::size_t index = sizeof...(Ts);
+  for (std::size_t i = 0; i < sizeof...(Ts); ++i) {
+    if (kMatches[i]) {
+      index = i;
+    }
+  }
+  return index;
+}
+
+template <typename T, typename... Ts>
+inline constexpr bool kOccursOnce = (std::is_same_v<T, Ts> + ... + 0) == 1;
+
+template <std::size_t I, typename T>
+struct Leaf {
+  // Value-initialized, so Tuple<int> starts at zero like std::tuple<int>.
+  constexpr Leaf() noexcept(std::is_nothrow_default_constructible_v<T>)
+    requires std::is_default_constructible_v<T>
+      : value() {}
+  template <typename U>
+  constexpr Leaf(std::in_place_t, U&& value) : value(std::forward<U>(value)) {}
+
+  [[no_unique_address]] T value;
+};
+
+template <std::size_t I, typename T>
+constexpr T& leaf(Leaf<I, T>& element) noexcept {
+  return element.value;
+}
+template <std::size_t I, typename T>
+constexpr const T& leaf(const Leaf<I, T>& element) noexcept {
+  return element.value;
+}
+
+// Alignment a member of type T needs; empty types come last so the order
+// of the others decides the layout.
+template <typename T>
+inline constexpr std::size_t kPlacementAlign =
+    std::is_reference_v<T> ? alignof(void*) : std::is_empty_v<T> ? 0 : alignof(T);
+
+template <std::size_t N>
+struct Order {
+  std::size_t index[N == 0 ? 1 : N];
+};
+
+// Declaration indices sorted by decreasing alignment, ties in declaration
+// order.
+template <typename... Ts>
+constexpr Order<sizeof...(Ts)> storage_order() {
+  constexpr std::size_t kAligns[] = {kPlacementAlign<Ts>..., 0};
+  Order<sizeof...(Ts)> order{};
+  for (std::size_t i = 0; i < sizeof...(Ts); ++i) {
+    std::size_t j = i;
+    for (; j > 0 && kAligns[order.index[j - 1]] < kAligns[i]; --j) {
+      order.index[j] = order.index[j - 1];
+    }
+    order.index[j] = i;
+  }
+  return order;
+}
+
+template <typename... Ts>
+inline constexpr Order<sizeof...(Ts)> kStorageOrder = storage_order<Ts...>();
+
+// Source that hands out its arguments, forwarded, by declaration index.
+template <typename Sequence, typename... Us>
+struct Forwarded;
+
+template <std::size_t... Is, typename... Us>
+struct Forwarded<std::index_sequence<Is...>, Us...> : Leaf<Is, Us&&>... {
+  constexpr explicit Forwarded(Us&&... args) : Leaf<Is, Us&&>(std::in_place,
+                                                              std::forward<Us>(args))... {}
+
+  template <std::size_t I>
+  constexpr decltype(auto) get() const noexcept {
+    using U = TypeAt<I, Us...>;
+    return static_cast<U&&>(leaf<I>(*this));
+  }
+};
+
+template <typename Order, typename... Ts>
+class Storage;
+
+template <std::size_t... Ps, typename... Ts>
+class Storage<std::index_sequence<Ps...>, Ts...> : Leaf<Ps, TypeAt<Ps, Ts...>>... {
+ public:
+  Storage() = default;
+
+  // Builds element I from source.template get<I>(), in storage order.
+  template <typename Source>
+  constexpr Storage(std::in_place_t, Source&& source)
+      : Leaf<Ps, TypeAt<Ps, Ts...>>(std::in_place, source.template get<Ps>())... {}
+
+  template <std::size_t I>
+  constexpr auto& get() noexcept {
+    return leaf<I>(*this);
+  }
+  template <std::size_t I>
+  constexpr const auto& get() const noexcept {
+    return leaf<I>(*this);
+  }
+};
+
+template <typename... Ts, std::size_t... Is>
+auto storage_type(std::index_sequence<Is...>)
+    -> Storage<std::index_sequence<kStorageOrder<Ts...>.index[Is]...>, Ts...>;
+
+template <typename... Ts>
+using StorageFor = decltype(storage_type<Ts...>(std::index_sequence_for<Ts...>()));
+
+template <typename T>
+struct TupleTraits {
+  static constexpr bool kIsTuple = false;
+};
+
+template <typename... Ts>
+struct TupleTraits<Tuple<Ts...>> {
+  static constexpr bool kIsTuple = true;
+  static constexpr std::size_t kSize = sizeof...(Ts);
+  template <std::size_t I>
+  using Element = TypeAt<I, Ts...>;
+};
+
+template <typename T>
+concept AnyTuple = TupleTraits<std::remove_cvref_t<T>>::kIsTuple;
+
+// Tag for the constructor that takes every element from a source.
+struct FromSource {};
+
+struct Access {
+  // Element I of `tuple` with the value category std::get would give it.
+  template <std::size_t I, typename T>
+  static constexpr decltype(auto) get(T&& tuple) noexcept {
+    if constexpr (std::is_lvalue_reference_v<T>) {
+      return tuple.storage_.template get<I>();
+    } else {
+      using Element = typename TupleTraits<std::remove_cvref_t<T>>::template Element<I>;
+      using Qualified = std::conditional_t<std::is_const_v<std::remove_reference_t<T>>,
+                                           const Element, Element>;
+      return static_cast<Qualified&&>(tuple.storage_.template get<I>());
+    }
+  }
+};
+
+// Source reading the elements of another tuple with its value category.
+template <typename T>
+struct Elements {
+  T&& tuple;
+
+  template <std::size_t I>
+  constexpr decltype(auto) get() const noexcept {
+    return Access::get<I>(std::forward<T>(tuple));
+  }
+};
+
+}  // namespace tuple_detail
+
+template <typename... Ts>
+class Tuple {
+  template <std::size_t I>
+  using Element = tuple_detail::TypeAt<I, Ts...>;
+
+  static constexpr bool kDefaultAssignable = (!std::is_reference_v<Ts> && ...);
+
+  template <typename... Us>
+  static constexpr bool constructible_from() {
+    if constexpr (sizeof...(Us) != sizeof...(Ts)) {
+      return false;
+    } else {
+      return (std::is_constructible_v<Ts, Us> && ...);
+    }
+  }
+
+  template <typename... Us>
+  static constexpr bool convertible_from() {
+    if constexpr (sizeof...(Us) != sizeof...(Ts)) {
+      return false;
+    } else {
+      return (std::is_convertible_v<Us, Ts> && ...);
+    }
+  }
+
+  // Tuple<Us...> cv-ref, not the copy or move constructor in disguise.
+  template <typename Other>
+  static constexpr bool converts_from_tuple() {
+    if constexpr (std::is_same_v<std::remove_cvref_t<Other>, Tuple> ||
+                  tuple_detail::TupleTraits<std::remove_cvref_t<Other>>::kSize !=
+                      sizeof...(Ts)) {
+      return false;
+    } else {
+      return []<std::size_t... Is>(std::index_sequence<Is...>) {
+        return (std::is_constructible_v<
+                    Ts, decltype(tuple_detail::Access::get<Is>(std::declval<Other>()))> &&
+                ...);
+      }(std::index_sequence_for<Ts...>());
+    }
+  }
+
+  // Every element of Other converts implicitly; decides explicit(...).
+  template <typename Other>
+  static constexpr bool converts_implicitly_from_tuple() {
+    return []<std::size_t... Is>(std::index_sequence<Is...>) {
+      return (std::is_convertible_v<
+                  decltype(tuple_detail::Access::get<Is>(std::declval<Other>())), Ts> &&
+              ...);
+    }(std::index_sequence_for<Ts...>());
+  }
+
+ public:
+  constexpr Tuple() noexcept((std::is_nothrow_default_constructible_v<Ts> && ...))
+    requires(std::is_default_constructible_v<Ts> && ...)
+  = default;
+
+  template <typename... Us>
+    requires(sizeof...(Us) > 0) && (constructible_from<Us...>()) &&
+            (sizeof...(Us) != 1 ||
+             (!std::is_same_v<std::remove_cvref_t<Us>, Tuple> && ...))
+  constexpr explicit(!convertible_from<Us...>()) Tuple(Us&&... values)
+      : storage_(std::in_place,
+                 tuple_detail::Forwarded<std::index_sequence_for<Us...>, Us...>(
+                     std::forward<Us>(values)...)) {}
+
+  template <tuple_detail::AnyTuple Other>
+    requires(converts_from_tuple<Other>())
+  constexpr explicit(!converts_implicitly_from_tuple<Other>()) Tuple(Other&& other)
+      : storage_(std::in_place, tuple_detail::Elements<Other>{std::forward<Other>(other)}) {}
+
+  // Element I is built from source.template get<I>(); used by tupleCat.
+  template <typename Source>
+  constexpr Tuple(tuple_detail::FromSource, Source&& source)
+      : storage_(std::in_place, std::forward<Source>(source)) {}
+
+  Tuple(const Tuple&) = default;
+  Tuple(Tuple&&) = default;
+
+  Tuple& operator=(const Tuple&)
+    requires kDefaultAssignable
+  = default;
+  constexpr Tuple& operator=(const Tuple& other)
+    requires(!kDefaultAssignable && (std::is_assignable_v<Ts&, const Ts&> && ...))
+  {
+    assign(other, std::index_sequence_for<Ts...>());
+    return *this;
+  }
+
+  Tuple& operator=(Tuple&&)
+    requires kDefaultAssignable
+  = default;
+  constexpr Tuple& operator=(Tuple&& other)
+    requires(!kDefaultAssignable && (std::is_assignable_v<Ts&, Ts> && ...))
+  {
+    assign(std::move(other), std::index_sequence_for<Ts...>());
+    return *this;
+  }
+
+  template <tuple_detail::AnyTuple Other>
+    requires(!std::is_same_v<std::remove_cvref_t<Other>, Tuple> &&
+             tuple_detail::TupleTraits<std::remove_cvref_t<Other>>::kSize == sizeof...(Ts))
+  constexpr Tuple& operator=(Other&& other) {
+    assign(std::forward<Other>(other), std::index_sequence_for<Ts...>());
+    return *this;
+  }
+
+  constexpr void swap(Tuple& other) noexcept((std::is_nothrow_swappable_v<Ts> && ...)) {
+    swap(other, std::index_sequence_for<Ts...>());
+  }
+  friend constexpr void swap(Tuple& lhs, Tuple& rhs) noexcept(noexcept(lhs.swap(rhs))) {
+    lhs.swap(rhs);
+  }
+
+  friend constexpr bool operator==(const Tuple& lhs, const Tuple& rhs) {
+    return equal(lhs, rhs, std::index_sequence_for<Ts...>());
+  }
+
+  friend constexpr auto operator<=>(const Tuple& lhs, const Tuple& rhs)
+    requires(std::three_way_comparable<Ts> && ...)
+  {
+    return compare(lhs, rhs, std::index_sequence_for<Ts...>());
+  }
+
+ private:
+  friend struct tuple_detail::Access;
+
+  template <typename Other, std::size_t... Is>
+  constexpr void assign(Other&& other, std::index_sequence<Is...>) {
+    ((storage_.template get<Is>() =
+          tuple_detail::Access::get<Is>(std::forward<Other>(other))),
+     ...);
+  }
+
+  template <std::size_t... Is>
+  constexpr void swap(Tuple& other, std::index_sequence<Is...>) {
+    using std::swap;
+    (swap(storage_.template get<Is>(), other.storage_.template get<Is>()), ...);
+  }
+
+  template <std::size_t... Is>
+  static constexpr bool equal(const Tuple& lhs, const Tuple& rhs, std::index_sequence<Is...>) {
+    return ((lhs.storage_.template get<Is>() == rhs.storage_.template get<Is>()) && ...);
+  }
+
+  template <std::size_t... Is>
+  static constexpr auto compare(const Tuple& lhs, const Tuple& rhs,
+                                std::index_sequence<Is...>) {
+    std::common_comparison_category_t<std::compare_three_way_result_t<Ts>...> result =
+        std::strong_ordering::equal;
+    // Stops at the first element that is not equivalent.
+    (void)((result = lhs.storage_.template get<Is>() <=> rhs.storage_.template get<Is>(),
+            result == 0) &&
+           ...);
+    return result;
+  }
+
+  [[no_unique_address]] tuple_detail::StorageFor<Ts...> storage_;
+};
+
+template <typename... Ts>
+Tuple(Ts...) -> Tuple<Ts...>;
+
+template <typename... Ts>
+struct std::tuple_size<Tuple<Ts...>> : std::integral_constant<std::size_t, sizeof...(Ts)> {};
+
+template <std::size_t I, typename... Ts>
+struct std::tuple_element<I, Tuple<Ts...>> {
+  using type = tuple_detail::TypeAt<I, Ts...>;
+};
+
+template <std::size_t I, typename... Ts>
+constexpr auto& get(Tuple<Ts...>& tuple) noexcept {
+  return tuple_detail::Access::get<I>(tuple);
+}
+template <std::size_t I, typename... Ts>
+constexpr const auto& get(const Tuple<Ts...>& tuple) noexcept {
+  return tuple_detail::Access::get<I>(tuple);
+}
+template <std::size_t I, typename... Ts>
+constexpr decltype(auto) get(Tuple<Ts...>&& tuple) noexcept {
+  return tuple_detail::Access::get<I>(std::move(tuple));
+}
+template <std::size_t I, typename... Ts>
+constexpr decltype(auto) get(const Tuple<Ts...>&& tuple) noexcept {
+  return tuple_detail::Access::get<I>(std::move(tuple));
+}
+
+template <typename T, typename... Ts>
+  requires tuple_detail::kOccursOnce<T, Ts...>
+constexpr decltype(auto) get(Tuple<Ts...>& tuple) noexcept {
+  return get<tuple_detail::index_of<T, Ts...>()>(tuple);
+}
+template <typename T, typename... Ts>
+  requires tuple_detail::kOccursOnce<T, Ts...>
+constexpr decltype(auto) get(const Tuple<Ts...>& tuple) noexcept {
+  return get<tuple_detail::index_of<T, Ts...>()>(tuple);
+}
+template <typename T, typename... Ts>
+  requires tuple_detail::kOccursOnce<T, Ts...>
+constexpr decltype(auto) get(Tuple<Ts...>&& tuple) noexcept {
+  return get<tuple_detail::index_of<T, Ts...>()>(std::move(tuple));
+}
+template <typename T, typename... Ts>
+  requires tuple_detail::kOccursOnce<T, Ts...>
+constexpr decltype(auto) get(const Tuple<Ts...>&& tuple) noexcept {
+  return get<tuple_detail::index_of<T, Ts...>()>(std::move(tuple));
+}
+
+template <typename... Ts>
+constexpr Tuple<std::unwrap_ref_decay_t<Ts>...> makeTuple(Ts&&... values) {
+  return Tuple<std::unwrap_ref_decay_t<Ts>...>(std::forward<Ts>(values)...);
+}
+
+template <typename... Ts>
+constexpr Tuple<Ts&&...> forwardAsTuple(Ts&&... values) noexcept {
+  return Tuple<Ts&&...>(std::forward<Ts>(values)...);
+}
+
+// The constraint also makes this the better match over std::tie when
+// argument-dependent lookup finds both.
+template <typename... Ts>
+  requires(std::is_object_v<Ts> && ...)
+constexpr Tuple<Ts&...> tie(Ts&... values) noexcept {
+  return Tuple<Ts&...>(values...);
+}
+
+namespace tuple_detail {
+
+template <typename F, typename T, std::size_t... Is>
+constexpr decltype(auto) apply(F&& f, T&& tuple, std::index_sequence<Is...>) {
+  return std::forward<F>(f)(Access::get<Is>(std::forward<T>(tuple))...);
+}
+
+// For element J of the concatenation, the argument it comes from and its
+// index there.
+template <std::size_t... Sizes>
+struct CatIndices {
+  static constexpr std::size_t kTotal = (Sizes + ... + 0);
+
+  struct Tables {
+    std::size_t outer[kTotal == 0 ? 1 : kTotal];
+    std::size_t inner[kTotal == 0 ? 1 : kTotal];
+  };
+
+  static constexpr Tables kTables = [] {
+    constexpr std::size_t kSizes[] = {Sizes..., 0};
+    Tables tables{};
+    std::size_t j = 0;
+    for (std::size_t outer = 0; outer < sizeof...(Sizes); ++outer) {
+      for (std::size_t inner = 0; inner < kSizes[outer]; ++inner, ++j) {
+        tables.outer[j] = outer;
+        tables.inner[j] = inner;
+      }
+    }
+    return tables;
+  }();
+};
+
+template <typename... Tuples>
+using CatIndicesFor = CatIndices<TupleTraits<std::remove_cvref_t<Tuples>>::kSize...>;
+
+template <std::size_t J, typename... Tuples>
+using CatElement = typename TupleTraits<std::remove_cvref_t<
+    TypeAt<CatIndicesFor<Tuples...>::kTables.outer[J], Tuples...>>>::
+    template Element<CatIndicesFor<Tuples...>::kTables.inner[J]>;
+
+template <typename... Tuples>
+struct CatSource {
+  Forwarded<std::index_sequence_for<Tuples...>, Tuples...> tuples;
+
+  template <std::size_t J>
+  constexpr decltype(auto) get() const noexcept {
+    constexpr auto& kTables = CatIndicesFor<Tuples...>::kTables;
+    return Access::get<kTables.inner[J]>(tuples.template get<kTables.outer[J]>());
+  }
+};
+
+template <typename... Tuples, std::size_t... Js>
+auto cat_type(std::index_sequence<Js...>) -> Tuple<CatElement<Js, Tuples...>...>;
+
+template <typename... Tuples>
+using CatResult = decltype(cat_type<Tuples...>(
+    std::make_index_sequence<CatIndicesFor<Tuples...>::kTotal>()));
+
+}  // namespace tuple_detail
+
+template <typename F, tuple_detail::AnyTuple T>
+constexpr decltype(auto) apply(F&& f, T&& tuple) {
+  return tuple_detail::apply(
+      std::forward<F>(f), std::forward<T>(tuple),
+      std::make_index_sequence<tuple_detail::TupleTraits<std::remove_cvref_t<T>>::kSize>());
+}
+
+template <tuple_detail::AnyTuple... Tuples>
+constexpr tuple_detail::CatResult<Tuples...> tupleCat(Tuples&&... tuples) {
+  using Result = tuple_detail::CatResult<Tuples...>;
+  return Result(tuple_detail::FromSource{},
+                tuple_detail::CatSource<Tuples...>{
+                    tuple_detail::Forwarded<std::index_sequence_for<Tuples...>, Tuples...>(
+                        std::forward<Tuples>(tuples)...)});
+}
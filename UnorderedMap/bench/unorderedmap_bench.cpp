@@ -0,0 +1,201 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "UnorderedMap/unorderedmap.h"
+
+#ifdef PORTFOLIO_HAVE_ABSL
+#include <absl/container/flat_hash_map.h>
+#endif
+
+namespace {
+
+// Non-owning key type a map looks strings up by. This absl build is not
+// configured to alias std::string_view, so its map needs absl::string_view.
+template <typename Map>
+struct LookupView {
+  using type = std::string_view;
+};
+
+#ifdef PORTFOLIO_HAVE_ABSL
+template <typename K, typename V>
+struct LookupView<absl::flat_hash_map<K, V>> {
+  using type = absl::string_view;
+};
+#endif
+
+template <typename K>
+std::vector<K> random_keys(std::size_t count, unsigned seed) {
+  std::mt19937_64 gen(seed);
+  std::vector<K> keys(count);
+  for (K& key : keys) {
+    if constexpr (std::is_same_v<K, std::string>) {
+      key = "user:" + std::to_string(gen()) + ":session";
+    } else {
+      key = static_cast<K>(gen());
+    }
+  }
+  return keys;
+}
+
+// Inserts state.range(0) distinct keys into an empty map.
+template <typename Map>
+void BM_Insert(benchmark::State& state) {
+  using K = typename Map::key_type;
+  auto keys = random_keys<K>(static_cast<std::size_t>(state.range(0)), 1);
+  for (auto _ : state) {
+    Map map;
+    for (const K& key : keys) {
+      map.try_emplace(key, 1);
+    }
+    benchmark::DoNotOptimize(map.size());
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          state.range(0));
+}
+
+// Looks up keys in a map of state.range(0) elements; 90% of the lookups hit.
+template <typename Map>
+void BM_Lookup(benchmark::State& state) {
+  using K = typename Map::key_type;
+  auto count = static_cast<std::size_t>(state.range(0));
+  auto keys = random_keys<K>(count, 2);
+  auto misses = random_keys<K>(count, 3);
+  Map map;
+  for (const K& key : keys) {
+    map.try_emplace(key, 1);
+  }
+  std::mt19937 gen(4);
+  std::vector<K> queries(std::max<std::size_t>(count, 4096));
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    queries[i] = gen() % 10 == 0 ? misses[gen() % count] : keys[gen() % count];
+  }
+  for (auto _ : state) {
+    std::size_t found = 0;
+    for (const K& query : queries) {
+      found += map.find(query) != map.end();
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(queries.size()));
+}
+
+// Looks up std::string keys through string_views into a parse buffer. A
+// map without heterogeneous lookup has to build a std::string per query.
+template <typename Map>
+void BM_LookupView(benchmark::State& state) {
+  auto count = static_cast<std::size_t>(state.range(0));
+  auto keys = random_keys<std::string>(count, 6);
+  Map map;
+  for (const std::string& key : keys) {
+    map.try_emplace(key, 1);
+  }
+  std::string buffer;
+  std::vector<std::pair<std::size_t, std::size_t>> spans;
+  std::mt19937 gen(7);
+  for (std::size_t i = 0; i < std::max<std::size_t>(count, 4096); ++i) {
+    const std::string& key = keys[gen() % count];
+    spans.emplace_back(buffer.size(), key.size());
+    buffer += key;
+  }
+  for (auto _ : state) {
+    std::size_t found = 0;
+    for (auto [offset, length] : spans) {
+      typename LookupView<Map>::type query(buffer.data() + offset, length);
+      if constexpr (requires { map.find(query); }) {
+        found += map.find(query) != map.end();
+      } else {
+        found += map.find(std::string(query)) != map.end();
+      }
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(spans.size()));
+}
+
+// Probes two maps with the same key, hashing it once when the map accepts a
+// precomputed hash.
+template <typename Map>
+void BM_LookupTwoMaps(benchmark::State& state) {
+  auto count = static_cast<std::size_t>(state.range(0));
+  auto keys = random_keys<std::string>(count, 8);
+  Map first;
+  Map second;
+  for (std::size_t i = 0; i < count; ++i) {
+    (i % 2 == 0 ? first : second).try_emplace(keys[i], 1);
+  }
+  for (auto _ : state) {
+    std::size_t found = 0;
+    for (const std::string& key : keys) {
+      if constexpr (requires { first.find(key, std::size_t{}); }) {
+        std::size_t hash = first.hash_function()(key);
+        found += first.find(key, hash) != first.end() ||
+                 second.find(key, hash) != second.end();
+      } else {
+        found += first.find(key) != first.end() || second.find(key) != second.end();
+      }
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          state.range(0));
+}
+
+// Erases and reinserts keys at a steady size, which leaves tombstones.
+template <typename Map>
+void BM_EraseInsert(benchmark::State& state) {
+  using K = typename Map::key_type;
+  auto count = static_cast<std::size_t>(state.range(0));
+  auto keys = random_keys<K>(count * 2, 5);
+  Map map;
+  for (std::size_t i = 0; i < count; ++i) {
+    map.try_emplace(keys[i], 1);
+  }
+  std::size_t oldest = 0;
+  std::size_t next = count;
+  for (auto _ : state) {
+    for (int step = 0; step < 1024; ++step) {
+      map.erase(keys[oldest]);
+      map.try_emplace(keys[next], 1);
+      oldest = oldest + 1 == keys.size() ? 0 : oldest + 1;
+      next = next + 1 == keys.size() ? 0 : next + 1;
+    }
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * 1024);
+}
+
+template <typename K>
+using StdMap = std::unordered_map<K, int>;
+template <typename K>
+using SwissMap = UnorderedMap<K, int>;
+
+#define MAP_BENCHMARKS(Map)                                                      \
+  BENCHMARK_TEMPLATE(BM_Insert, Map<std::uint64_t>)->Arg(1 << 10)->Arg(1 << 16); \
+  BENCHMARK_TEMPLATE(BM_Insert, Map<std::string>)->Arg(1 << 16);                 \
+  BENCHMARK_TEMPLATE(BM_Lookup, Map<std::uint64_t>)                              \
+      ->Arg(1 << 10)                                                             \
+      ->Arg(1 << 16)                                                             \
+      ->Arg(1 << 20);                                                            \
+  BENCHMARK_TEMPLATE(BM_Lookup, Map<std::string>)->Arg(1 << 10)->Arg(1 << 16);  \
+  BENCHMARK_TEMPLATE(BM_LookupView, Map<std::string>)->Arg(1 << 16);            \
+  BENCHMARK_TEMPLATE(BM_LookupTwoMaps, Map<std::string>)->Arg(1 << 16);         \
+  BENCHMARK_TEMPLATE(BM_EraseInsert, Map<std::uint64_t>)->Arg(1 << 16)
+
+MAP_BENCHMARKS(StdMap);
+MAP_BENCHMARKS(SwissMap);
+
+#ifdef PORTFOLIO_HAVE_ABSL
+template <typename K>
+using AbslMap = absl::flat_hash_map<K, int>;
+MAP_BENCHMARKS(AbslMap);
+#endif
+
+}  // namespace
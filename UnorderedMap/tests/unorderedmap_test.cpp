@@ -0,0 +1,337 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "UnorderedMap/unorderedmap.h"
+
+namespace {
+
+// Every key collides: the map must still work, by key comparison alone.
+struct ConstantHash {
+  std::size_t operator()(int) const { return 42; }
+};
+
+// Counts live instances to catch leaks and double destruction.
+struct Tracked {
+  static inline int alive = 0;
+  int value;
+
+  explicit Tracked(int v = 0) : value(v) { ++alive; }
+  Tracked(const Tracked& other) : value(other.value) { ++alive; }
+  Tracked(Tracked&& other) noexcept : value(other.value) { ++alive; }
+  Tracked& operator=(const Tracked&) = default;
+  ~Tracked() { --alive; }
+};
+
+template <typename Map, typename Model>
+void expect_same(const Map& map, const Model& model) {
+  ASSERT_EQ(map.size(), model.size());
+  std::size_t seen = 0;
+  for (const auto& [key, value] : map) {
+    auto it = model.find(key);
+    ASSERT_NE(it, model.end());
+    ASSERT_EQ(it->second, value);
+    ++seen;
+  }
+  EXPECT_EQ(seen, model.size());
+}
+
+TEST(UnorderedMap, MatchesStdUnderRandomOperations) {
+  UnorderedMap<std::uint64_t, int> map;
+  std::unordered_map<std::uint64_t, int> model;
+  std::mt19937_64 gen(9);
+  for (int step = 0; step < 300000; ++step) {
+    std::uint64_t key = gen() % 5000;
+    int value = static_cast<int>(gen());
+    switch (gen() % 5) {
+      case 0:
+        EXPECT_EQ(map.try_emplace(key, value).second, model.try_emplace(key, value).second);
+        break;
+      case 1:
+        map.insert_or_assign(key, value);
+        model.insert_or_assign(key, value);
+        break;
+      case 2:
+      case 3:
+        ASSERT_EQ(map.erase(key), model.erase(key));
+        break;
+      case 4:
+        ASSERT_EQ(map.contains(key), model.contains(key));
+        break;
+    }
+  }
+  expect_same(map, model);
+  EXPECT_LE(map.load_factor(), map.max_load_factor());
+}
+
+TEST(UnorderedMap, SurvivesTotalCollision) {
+  UnorderedMap<int, int, ConstantHash> map;
+  for (int i = 0; i < 300; ++i) {
+    map.emplace(i, i * i);
+  }
+  for (int i = 0; i < 300; i += 2) {
+    EXPECT_EQ(map.erase(i), 1u);
+  }
+  for (int i = 0; i < 300; ++i) {
+    EXPECT_EQ(map.contains(i), i % 2 == 1) << i;
+  }
+  map.emplace(0, -1);
+  EXPECT_EQ(map.at(0), -1);
+  EXPECT_EQ(map.size(), 151u);
+}
+
+TEST(UnorderedMap, ReserveAvoidsRehash) {
+  UnorderedMap<int, int> map;
+  map.reserve(10000);
+  std::size_t buckets = map.bucket_count();
+  const int* first = nullptr;
+  for (int i = 0; i < 10000; ++i) {
+    map[i] = i;
+    if (i == 0) {
+      first = &map.at(0);
+    }
+  }
+  EXPECT_EQ(map.bucket_count(), buckets);
+  EXPECT_EQ(&map.at(0), first);
+  EXPECT_GE(static_cast<double>(buckets) * map.max_load_factor(), 10000.0);
+}
+
+TEST(UnorderedMap, ChurnAtSteadySizeDoesNotGrow) {
+  UnorderedMap<int, int> map;
+  for (int i = 0; i < 1000; ++i) {
+    map.emplace(i, i);
+  }
+  std::size_t buckets = map.bucket_count();
+  for (int i = 1000; i < 200000; ++i) {
+    map.erase(i - 1000);
+    map.emplace(i, i);
+  }
+  EXPECT_EQ(map.size(), 1000u);
+  EXPECT_EQ(map.bucket_count(), buckets);
+}
+
+TEST(UnorderedMap, AtOperatorBracketsAndErase) {
+  UnorderedMap<std::string, int> map{{"one", 1}, {"two", 2}};
+  EXPECT_EQ(map.at("one"), 1);
+  EXPECT_THROW(map.at("three"), std::out_of_range);
+  const auto& constant = map;
+  EXPECT_THROW(constant.at("three"), std::out_of_range);
+
+  map["three"] += 3;
+  EXPECT_EQ(map.at("three"), 3);
+  EXPECT_EQ(map.erase("two"), 1u);
+  EXPECT_EQ(map.erase("two"), 0u);
+
+  auto it = map.find("one");
+  map.erase(it);
+  EXPECT_EQ(map.size(), 1u);
+  map.erase(map.begin(), map.end());
+  EXPECT_TRUE(map.empty());
+}
+
+TEST(UnorderedMap, MoveOnlyValues) {
+  UnorderedMap<int, std::unique_ptr<int>> map;
+  for (int i = 0; i < 1000; ++i) {
+    map.emplace(i, std::make_unique<int>(i));
+  }
+  UnorderedMap<int, std::unique_ptr<int>> moved = std::move(map);
+  EXPECT_EQ(*moved.at(999), 999);
+  EXPECT_TRUE(map.empty());  // NOLINT(bugprone-use-after-move)
+  auto [it, inserted] = moved.try_emplace(5, std::make_unique<int>(-5));
+  EXPECT_FALSE(inserted);
+  EXPECT_EQ(*it->second, 5);
+}
+
+TEST(UnorderedMap, ExtractAndReinsertNodes) {
+  UnorderedMap<std::string, std::string> source{{"key", "value"}, {"other", "x"}};
+  auto node = source.extract("key");
+  ASSERT_FALSE(node.empty());
+  EXPECT_EQ(node.key(), "key");
+  EXPECT_FALSE(source.contains("key"));
+  EXPECT_TRUE(source.extract("missing").empty());
+
+  node.key() = "renamed";
+  UnorderedMap<std::string, std::string> target{{"renamed", "taken"}};
+  auto clash = target.insert(std::move(node));
+  EXPECT_FALSE(clash.inserted);
+  EXPECT_EQ(clash.position->second, "taken");
+  ASSERT_FALSE(clash.node.empty());
+
+  target.erase("renamed");
+  auto result = target.insert(std::move(clash.node));
+  EXPECT_TRUE(result.inserted);
+  EXPECT_EQ(target.at("renamed"), "value");
+  EXPECT_FALSE(target.insert(decltype(target)::node_type()).inserted);
+}
+
+TEST(UnorderedMap, CopiesCompareEqualAndOwnTheirElements) {
+  Tracked::alive = 0;
+  {
+    UnorderedMap<int, Tracked> map;
+    for (int i = 0; i < 500; ++i) {
+      map.try_emplace(i, i);
+    }
+    UnorderedMap<int, Tracked> copy = map;
+    EXPECT_EQ(Tracked::alive, 1000);
+    copy.at(7).value = -7;
+    EXPECT_EQ(map.at(7).value, 7);
+
+    UnorderedMap<int, int> a{{1, 1}, {2, 2}};
+    UnorderedMap<int, int> b{{2, 2}, {1, 1}};
+    EXPECT_EQ(a, b);
+    b[2] = 3;
+    EXPECT_NE(a, b);
+
+    copy = map;
+    map.clear();
+    EXPECT_EQ(Tracked::alive, 500);
+    swap(map, copy);
+    EXPECT_EQ(map.size(), 500u);
+    EXPECT_TRUE(copy.empty());
+  }
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(UnorderedMap, RehashKeepsEveryElement) {
+  UnorderedMap<std::string, int> map;
+  std::unordered_map<std::string, int> model;
+  for (int i = 0; i < 20000; ++i) {
+    std::string key = "key number " + std::to_string(i);
+    map.emplace(key, i);
+    model.emplace(key, i);
+  }
+  expect_same(map, model);
+  map.rehash(0);
+  expect_same(map, model);
+}
+
+// Key that counts how often one is built, with transparent hash and
+// equality over std::string_view.
+struct CountedKey {
+  static inline int built = 0;
+  std::string text;
+
+  explicit CountedKey(std::string_view view) : text(view) { ++built; }
+  CountedKey(const CountedKey& other) : text(other.text) { ++built; }
+  CountedKey(CountedKey&&) noexcept = default;
+};
+
+struct CountedHash {
+  using is_transparent = void;
+  std::size_t operator()(std::string_view key) const {
+    return std::hash<std::string_view>{}(key);
+  }
+  std::size_t operator()(const CountedKey& key) const { return (*this)(key.text); }
+};
+
+struct CountedEqual {
+  using is_transparent = void;
+  static std::string_view text(std::string_view key) { return key; }
+  static std::string_view text(const CountedKey& key) { return key.text; }
+  template <typename A, typename B>
+  bool operator()(const A& a, const B& b) const {
+    return text(a) == text(b);
+  }
+};
+
+template <typename Map, typename Q>
+concept FindsBy = requires(Map& map, const Q& key) { map.find(key); };
+
+static_assert(FindsBy<UnorderedMap<std::string, int>, std::string_view>);
+static_assert(FindsBy<UnorderedMap<std::string, int>, const char*>);
+static_assert(!FindsBy<UnorderedMap<std::uint64_t, int, std::hash<std::uint64_t>>, std::string_view>);
+
+TEST(UnorderedMapLookup, StringKeysTakeViewsAndLiterals) {
+  UnorderedMap<std::string, int> map{{"alpha", 1}, {"beta", 2}};
+  std::string_view view = "alpha";
+  EXPECT_EQ(map.find(view)->second, 1);
+  EXPECT_TRUE(map.contains("beta"));
+  EXPECT_EQ(map.count(std::string_view("gamma")), 0u);
+  const auto& constant = map;
+  EXPECT_EQ(constant.find("beta")->second, 2);
+}
+
+TEST(UnorderedMapLookup, TransparentLookupBuildsNoKey) {
+  UnorderedMap<CountedKey, int, CountedHash, CountedEqual> map;
+  for (int i = 0; i < 100; ++i) {
+    map.emplace(CountedKey("key" + std::to_string(i)), i);
+  }
+  CountedKey::built = 0;
+  for (int i = 0; i < 100; ++i) {
+    std::string text = "key" + std::to_string(i);
+    ASSERT_EQ(map.find(std::string_view(text))->second, i);
+    ASSERT_TRUE(map.contains(std::string_view(text)));
+  }
+  EXPECT_FALSE(map.contains(std::string_view("absent")));
+  EXPECT_EQ(CountedKey::built, 0);
+}
+
+TEST(UnorderedMapLookup, OneHashServesSeveralMaps) {
+  UnorderedMap<std::string, int> first{{"shared", 1}, {"only first", 2}};
+  UnorderedMap<std::string, int> second{{"shared", 10}};
+  std::size_t hash = first.hash_function()("shared");
+  EXPECT_EQ(first.find("shared", hash)->second, 1);
+  EXPECT_EQ(second.find(std::string("shared"), hash)->second, 10);
+  EXPECT_TRUE(second.contains(std::string_view("shared"), hash));
+  EXPECT_EQ(second.count("shared", hash), 1u);
+
+  std::size_t missing = first.hash_function()("only first");
+  EXPECT_EQ(second.find("only first", missing), second.end());
+  EXPECT_EQ(second.count("only first", missing), 0u);
+
+  UnorderedMap<int, int> ints{{5, 50}};
+  EXPECT_EQ(ints.find(5, ints.hash_function()(5))->second, 50);
+}
+
+// Counts its calls, to show which operations hash the key.
+struct CountingIntHash {
+  static inline int calls = 0;
+  std::size_t operator()(int key) const {
+    ++calls;
+    return static_cast<std::size_t>(key) * 0x9e3779b97f4a7c15ull;
+  }
+};
+
+TEST(UnorderedMapLookup, HashedInsertionsTakeTheCallersHash) {
+  UnorderedMap<int, std::string, CountingIntHash> map;
+  map.reserve(1000);
+  const CountingIntHash hash;
+  std::vector<std::size_t> hashes;
+  for (int key = 0; key < 1000; ++key) {
+    hashes.push_back(hash(key));
+  }
+  CountingIntHash::calls = 0;
+  for (int key = 0; key < 1000; ++key) {
+    auto [it, inserted] = map.try_emplace_hashed(key, hashes[key], 3, 'a');
+    ASSERT_TRUE(inserted);
+    ASSERT_EQ(it->second, "aaa");
+  }
+  for (int key = 0; key < 1000; key += 2) {
+    auto [it, inserted] = map.insert_or_assign_hashed(key, hashes[key], "even");
+    ASSERT_FALSE(inserted);
+    ASSERT_EQ(it->first, key);
+  }
+  EXPECT_FALSE(map.try_emplace_hashed(7, hashes[7], "ignored").second);
+  EXPECT_EQ(CountingIntHash::calls, 0);
+
+  // The hashed and the plain forms reach the same elements.
+  EXPECT_EQ(map.at(4), "even");
+  EXPECT_EQ(map.at(7), "aaa");
+  EXPECT_EQ(map.find(4, hashes[4])->second, "even");
+  auto [it, inserted] = map.insert_or_assign(5, "five");
+  EXPECT_FALSE(inserted);
+  EXPECT_EQ(it->second, "five");
+  EXPECT_TRUE(map.insert_or_assign(1000, "new").second);
+  EXPECT_EQ(map.size(), 1001u);
+}
+
+}  // namespace
@@ -0,0 +1,1132 @@
+#pragma once
+
+// Open-addressing hash map in the style of Swiss tables.
+//
+// Slots come in groups of 16. Next to the slot array is an array of control
+// bytes, one per slot: kEmpty, kDeleted or, for a full slot, the low seven
+// bits of the hash (h2). A lookup picks a group from the rest of the hash
+// (h1), compares all 16 control bytes with h2 in one SSE2 or NEON
+// instruction and only compares keys in the slots that match, so a miss
+// usually costs one group load and no key comparison. Groups are probed
+// triangularly and a search stops at the first group with an empty slot.
+//
+// Elements live inline in the slot array, so there is no allocation per
+// element. The table doubles at a load factor of 7/8. Rehashing invalidates
+// iterators and references.
+//
+// find, contains and count accept any key type when both Hash and KeyEqual
+// are transparent; for std::string keys the defaults are, so a string_view
+// or a literal is looked up without building a std::string. Each of them
+// also takes hash_function()(key) computed by the caller, which lets one
+// hash serve lookups in several maps with the same hasher;
+// try_emplace_hashed and insert_or_assign_hashed take it for insertion.
+//
+// With PORTFOLIO_INSTRUMENT, "unorderedmap.probe_groups" records how many
+// groups each lookup read, and every rehash is timed as
+// "unorderedmap.rehash".
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "Instrument/instrument.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace unorderedmap_detail {
+
+using Ctrl = std::int8_t;
+
+inline constexpr Ctrl kEmpty = -128;
+inline constexpr Ctrl kDeleted = -2;
+inline constexpr Ctrl kSentinel = -1;  // after the last slot, stops iteration
+inline constexpr std::size_t kGroupWidth = 16;
+
+inline bool is_full(Ctrl ctrl) { return ctrl >= 0; }
+
+// Control bytes of a table with no slots: iteration stops right away.
+alignas(kGroupWidth) inline constexpr Ctrl kEmptyGroup[kGroupWidth] = {
+    kSentinel, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty,
+    kEmpty,    kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty};
+
+// Set of matching positions in a group, iterated from the lowest. NEON
+// produces four mask bits per byte, so positions are scaled by kShift.
+template <int kShift>
+class BitMask {
+ public:
+  explicit BitMask(std::uint64_t mask) : mask_(mask) {}
+
+  explicit operator bool() const { return mask_ != 0; }
+  std::size_t lowest() const {
+    return static_cast<std::size_t>(std::countr_zero(mask_)) >> kShift;
+  }
+
+  BitMask begin() const { return *this; }
+  BitMask end() const { return BitMask(0); }
+  std::size_t operator*() const { return lowest(); }
+  BitMask& operator++() {
+    mask_ &= mask_ - 1;
+    return *this;
+  }
+  bool operator==(const BitMask&) const = default;
+
+ private:
+  std::uint64_t mask_;
+};
+
+#if defined(__SSE2__)
+
+class Group {
+ public:
+  using Mask = BitMask<0>;
+
+  explicit Group(const Ctrl* ctrl)
+      : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))) {}
+
+  Mask match(Ctrl h2) const { return mask(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_)); }
+  Mask match_empty() const {
+    return mask(_mm_cmpeq_epi8(_mm_set1_epi8(kEmpty), ctrl_));
+  }
+  Mask match_empty_or_deleted() const {
+    return mask(_mm_cmpgt_epi8(_mm_set1_epi8(kSentinel), ctrl_));
+  }
+  Mask match_full_or_sentinel() const {
+    return mask(_mm_cmpgt_epi8(ctrl_, _mm_set1_epi8(kDeleted)));
+  }
+
+ private:
+  static Mask mask(__m128i bytes) {
+    return Mask(static_cast<std::uint32_t>(_mm_movemask_epi8(bytes)));
+  }
+
+  __m128i ctrl_;
+};
+
+#elif defined(__ARM_NEON)
+
+class Group {
+ public:
+  using Mask = BitMask<2>;
+
+  explicit Group(const Ctrl* ctrl) : ctrl_(vld1q_s8(ctrl)) {}
+
+  Mask match(Ctrl h2) const { return mask(vceqq_s8(vdupq_n_s8(h2), ctrl_)); }
+  Mask match_empty() const { return mask(vceqq_s8(vdupq_n_s8(kEmpty), ctrl_)); }
+  Mask match_empty_or_deleted() const {
+    return mask(vcltq_s8(ctrl_, vdupq_n_s8(kSentinel)));
+  }
+  Mask match_full_or_sentinel() const {
+    return mask(vcgtq_s8(ctrl_, vdupq_n_s8(kDeleted)));
+  }
+
+ private:
+  // Narrows each 0x00/0xFF byte to a nibble and keeps one bit per nibble.
+  static Mask mask(uint8x16_t bytes) {
+    uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(bytes), 4);
+    return Mask(vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) &
+                0x8888888888888888ull);
+  }
+
+  int8x16_t ctrl_;
+};
+
+#else
+
+class Group {
+ public:
+  using Mask = BitMask<0>;
+
+  explicit Group(const Ctrl* ctrl) { std::memcpy(ctrl_, ctrl, kGroupWidth); }
+
+  Mask match(Ctrl h2) const {
+    return collect([h2](Ctrl c) { return c == h2; });
+  }
+  Mask match_empty() const {
+    return collect([](Ctrl c) { return c == kEmpty; });
+  }
+  Mask match_empty_or_deleted() const {
+    return collect([](Ctrl c) { return c < kSentinel; });
+  }
+  Mask match_full_or_sentinel() const {
+    return collect([](Ctrl c) { return c > kDeleted; });
+  }
+
+ private:
+  template <typename Predicate>
+  Mask collect(Predicate predicate) const {
+    std::uint64_t mask = 0;
+    for (std::size_t i = 0; i < kGroupWidth; ++i) {
+      mask |= std::uint64_t{predicate(ctrl_[i])} << i;
+    }
+    return Mask(mask);
+  }
+
+  Ctrl ctrl_[kGroupWidth];
+};
+
+#endif
+
+// Number of free slots before the next full slot or the sentinel.
+inline std::size_t count_leading_free(const Ctrl* ctrl) {
+  auto mask = Group(ctrl).match_full_or_sentinel();
+  return mask ? mask.lowest() : kGroupWidth;
+}
+
+// Visits groups at offsets h, h + 1, h + 3, h + 6, ... modulo the group
+// count, which reaches every group when the count is a power of two.
+class ProbeSeq {
+ public:
+  ProbeSeq(std::size_t hash, std::size_t group_mask)
+      : group_mask_(group_mask), group_(hash & group_mask) {}
+
+  std::size_t offset() const { return group_ * kGroupWidth; }
+  // Groups visited so far, this one included.
+  std::size_t probes() const { return step_ + 1; }
+  void next() {
+    ++step_;
+    group_ = (group_ + step_) & group_mask_;
+  }
+
+ private:
+  std::size_t group_mask_;
+  std::size_t group_;
+  std::size_t step_ = 0;
+};
+
+// std::hash of an integer is the identity; fold a 128-bit product so that
+// both h1 and h2 depend on every input bit.
+inline std::size_t mix(std::size_t hash) {
+  __extension__ using UInt128 = unsigned __int128;
+  UInt128 product = UInt128{hash} * 0x9E3779B97F4A7C15ull;
+  return static_cast<std::size_t>(product) ^ static_cast<std::size_t>(product >> 64);
+}
+
+// Default hasher and equality: std::hash and std::equal_to, except that
+// std::string keys get transparent ones hashing through std::string_view.
+template <typename K>
+struct DefaultHash : std::hash<K> {};
+
+template <>
+struct DefaultHash<std::string> {
+  using is_transparent = void;
+  std::size_t operator()(std::string_view key) const noexcept {
+    return std::hash<std::string_view>{}(key);
+  }
+};
+
+template <typename K>
+struct DefaultEqual : std::equal_to<K> {};
+
+template <>
+struct DefaultEqual<std::string> : std::equal_to<> {};
+
+template <typename Hash, typename KeyEqual>
+concept Transparent = requires {
+  typename Hash::is_transparent;
+  typename KeyEqual::is_transparent;
+};
+
+}  // namespace unorderedmap_detail
+
+template <typename K, typename V,
+          typename Hash = unorderedmap_detail::DefaultHash<K>,
+          typename KeyEqual = unorderedmap_detail::DefaultEqual<K>,
+          typename Allocator = std::allocator<std::pair<const K, V>>>
+class UnorderedMap {
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<const K, V>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using allocator_type = Allocator;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = typename std::allocator_traits<Allocator>::pointer;
+  using const_pointer = typename std::allocator_traits<Allocator>::const_pointer;
+
+ private:
+  using Ctrl = unorderedmap_detail::Ctrl;
+  using Group = unorderedmap_detail::Group;
+  using ProbeSeq = unorderedmap_detail::ProbeSeq;
+  static constexpr std::size_t kGroupWidth = unorderedmap_detail::kGroupWidth;
+
+  union Slot {
+    Slot() {}
+    ~Slot() {}
+    value_type value;
+  };
+
+  using AllocTraits = std::allocator_traits<Allocator>;
+  using SlotAllocator = typename AllocTraits::template rebind_alloc<Slot>;
+  using SlotTraits = std::allocator_traits<SlotAllocator>;
+  using CtrlAllocator = typename AllocTraits::template rebind_alloc<Ctrl>;
+  using CtrlTraits = std::allocator_traits<CtrlAllocator>;
+
+  // Moving out of a slot that is destroyed right after, so the const key can
+  // be moved instead of copied.
+  static constexpr bool kNothrowRelocate =
+      std::is_nothrow_move_constructible_v<K> &&
+      std::is_nothrow_move_constructible_v<V>;
+
+  template <bool IsConst>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = UnorderedMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+    using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+
+    Iterator() = default;
+    operator Iterator<true>() const {  // NOLINT(google-explicit-constructor)
+      return Iterator<true>(ctrl_, slot_);
+    }
+
+    reference operator*() const { return slot_->value; }
+    pointer operator->() const { return std::addressof(slot_->value); }
+
+    Iterator& operator++() {
+      ++ctrl_;
+      ++slot_;
+      skip_free();
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator old = *this;
+      ++*this;
+      return old;
+    }
+
+    friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
+      return lhs.ctrl_ == rhs.ctrl_;
+    }
+
+   private:
+    friend class UnorderedMap;
+    friend class Iterator<!IsConst>;
+
+    Iterator(const Ctrl* ctrl, Slot* slot) : ctrl_(ctrl), slot_(slot) {}
+
+    void skip_free() {
+      while (!unorderedmap_detail::is_full(*ctrl_) &&
+             *ctrl_ != unorderedmap_detail::kSentinel) {
+        std::size_t shift = unorderedmap_detail::count_leading_free(ctrl_);
+        ctrl_ += shift;
+        slot_ += shift;
+      }
+    }
+
+    const Ctrl* ctrl_ = nullptr;
+    Slot* slot_ = nullptr;
+  };
+
+ public:
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  // Owns one element taken out of a map by extract().
+  class node_type {
+   public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = UnorderedMap::value_type;
+    using allocator_type = Allocator;
+
+    node_type() = default;
+    node_type(node_type&& other) noexcept(kNothrowRelocate) { take(other); }
+    node_type& operator=(node_type&& other) noexcept(kNothrowRelocate) {
+      if (this != &other) {
+        reset();
+        take(other);
+      }
+      return *this;
+    }
+    ~node_type() { reset(); }
+
+    bool empty() const { return !alloc_.has_value(); }
+    explicit operator bool() const { return !empty(); }
+    allocator_type get_allocator() const { return allocator_type(*alloc_); }
+
+    key_type& key() const { return const_cast<key_type&>(slot_.value.first); }
+    mapped_type& mapped() const { return slot_.value.second; }
+
+    void swap(node_type& other) noexcept(kNothrowRelocate) {
+      node_type tmp(std::move(other));
+      other = std::move(*this);
+      *this = std::move(tmp);
+    }
+    friend void swap(node_type& lhs, node_type& rhs) noexcept(kNothrowRelocate) {
+      lhs.swap(rhs);
+    }
+
+   private:
+    friend class UnorderedMap;
+
+    void take(node_type& other) {
+      if (!other.empty()) {
+        alloc_.emplace(*other.alloc_);
+        relocate(*alloc_, &slot_, &other.slot_);
+        other.alloc_.reset();
+      }
+    }
+
+    void reset() {
+      if (!empty()) {
+        SlotTraits::destroy(*alloc_, std::addressof(slot_.value));
+        alloc_.reset();
+      }
+    }
+
+    std::optional<SlotAllocator> alloc_;
+    mutable Slot slot_;
+  };
+
+  struct insert_return_type {
+    iterator position;
+    bool inserted;
+    node_type node;
+  };
+
+  UnorderedMap() = default;
+
+  explicit UnorderedMap(size_type bucket_count, const Hash& hash = Hash(),
+                        const KeyEqual& equal = KeyEqual(),
+                        const Allocator& alloc = Allocator())
+      : hash_(hash), equal_(equal), alloc_(alloc) {
+    reserve(bucket_count);
+  }
+
+  explicit UnorderedMap(const Allocator& alloc) : alloc_(alloc) {}
+
+  template <std::input_iterator InputIt>
+  UnorderedMap(InputIt first, InputIt last, size_type bucket_count = 0,
+               const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual(),
+               const Allocator& alloc = Allocator())
+      : UnorderedMap(bucket_count, hash, equal, alloc) {
+    insert(first, last);
+  }
+
+  UnorderedMap(std::initializer_list<value_type> values, size_type bucket_count = 0,
+               const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual(),
+               const Allocator& alloc = Allocator())
+      : UnorderedMap(values.begin(), values.end(), bucket_count, hash, equal,
+                     alloc) {}
+
+  UnorderedMap(const UnorderedMap& other)
+      : UnorderedMap(other, AllocTraits::select_on_container_copy_construction(
+                                Allocator(other.alloc_))) {}
+
+  UnorderedMap(const UnorderedMap& other, const Allocator& alloc)
+      : hash_(other.hash_), equal_(other.equal_), alloc_(alloc) {
+    copy_from(other);
+  }
+
+  UnorderedMap(UnorderedMap&& other) noexcept
+      : hash_(std::move(other.hash_)),
+        equal_(std::move(other.equal_)),
+        alloc_(std::move(other.alloc_)) {
+    steal(other);
+  }
+
+  UnorderedMap(UnorderedMap&& other, const Allocator& alloc)
+      : hash_(other.hash_), equal_(other.equal_), alloc_(alloc) {
+    if (alloc_ == other.alloc_) {
+      steal(other);
+    } else {
+      move_elements_from(other);
+    }
+  }
+
+  ~UnorderedMap() { release(); }
+
+  UnorderedMap& operator=(const UnorderedMap& other) {
+    if (this != &other) {
+      UnorderedMap copy(
+          other, AllocTraits::propagate_on_container_copy_assignment::value
+                     ? Allocator(other.alloc_)
+                     : Allocator(alloc_));
+      release();
+      hash_ = other.hash_;
+      equal_ = other.equal_;
+      if constexpr (AllocTraits::propagate_on_container_copy_assignment::value) {
+        alloc_ = other.alloc_;
+      }
+      steal(copy);
+    }
+    return *this;
+  }
+
+  UnorderedMap& operator=(UnorderedMap&& other) noexcept(
+      AllocTraits::propagate_on_container_move_assignment::value ||
+      AllocTraits::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
+    }
+    release();
+    hash_ = std::move(other.hash_);
+    equal_ = std::move(other.equal_);
+    if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+      alloc_ = std::move(other.alloc_);
+      steal(other);
+    } else if (alloc_ == other.alloc_) {
+      steal(other);
+    } else {
+      move_elements_from(other);
+    }
+    return *this;
+  }
+
+  UnorderedMap& operator=(std::initializer_list<value_type> values) {
+    clear();
+    insert(values);
+    return *this;
+  }
+
+  allocator_type get_allocator() const { return allocator_type(alloc_); }
+  hasher hash_function() const { return hash_; }
+  key_equal key_eq() const { return equal_; }
+
+  iterator begin() {
+    iterator it(ctrl_, slots_);
+    it.skip_free();
+    return it;
+  }
+  iterator end() { return iterator(ctrl_ + capacity_, slots_ + capacity_); }
+  const_iterator begin() const { return const_cast<UnorderedMap*>(this)->begin(); }
+  const_iterator end() const { return const_cast<UnorderedMap*>(this)->end(); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  bool empty() const { return size_ == 0; }
+  size_type size() const { return size_; }
+
+  size_type bucket_count() const { return capacity_; }
+  float load_factor() const {
+    return capacity_ == 0 ? 0.0f
+                          : static_cast<float>(size_) / static_cast<float>(capacity_);
+  }
+  float max_load_factor() const { return 0.875f; }
+
+  // Makes room for `count` elements without rehashing.
+  void reserve(size_type count) {
+    size_type capacity = capacity_for(count);
+    if (capacity > capacity_) {
+      resize_table(capacity);
+    }
+  }
+
+  // Rebuilds the table with at least `count` slots, dropping tombstones.
+  void rehash(size_type count) {
+    size_type capacity = std::max(capacity_for(size_), table_size(count));
+    if (capacity != 0 || capacity_ != 0) {
+      resize_table(capacity);
+    }
+  }
+
+  void clear() noexcept {
+    if (capacity_ == 0) {
+      return;
+    }
+    destroy_elements();
+    reset_ctrl(ctrl_, capacity_);
+    size_ = 0;
+    growth_left_ = growth_limit(capacity_);
+  }
+
+  // Lookup and insertion.
+
+  iterator find(const K& key) { return find(key, hash_(key)); }
+  const_iterator find(const K& key) const { return find(key, hash_(key)); }
+
+  // `hash` must be hash_function()(key).
+  iterator find(const K& key, size_type hash) {
+    return iterator_at(find_index(key, mix(hash)));
+  }
+  const_iterator find(const K& key, size_type hash) const {
+    return const_cast<UnorderedMap*>(this)->find(key, hash);
+  }
+
+  bool contains(const K& key) const { return find(key) != end(); }
+  bool contains(const K& key, size_type hash) const { return find(key, hash) != end(); }
+  size_type count(const K& key) const { return contains(key) ? 1 : 0; }
+  size_type count(const K& key, size_type hash) const {
+    return contains(key, hash) ? 1 : 0;
+  }
+
+  template <typename Q>
+    requires unorderedmap_detail::Transparent<Hash, KeyEqual>
+  iterator find(const Q& key) {
+    return find(key, hash_(key));
+  }
+  template <typename Q>
+    requires unorderedmap_detail::Transparent<Hash, KeyEqual>
+  const_iterator find(const Q& key) const {
+    return find(key, hash_(key));
+  }
+
+  template <typename Q>
+    requires unorderedmap_detail::Transparent<Hash, KeyEqual>
+  iterator find(const Q& key, size_type hash) {
+    return iterator_at(find_index(key, mix(hash)));
+  }
+  template <typename Q>
+    requires unorderedmap_detail::Transparent<Hash, KeyEqual>
+  const_iterator find(const Q& key, size_type hash) const {
+    return const_cast<UnorderedMap*>(this)->find(key, hash);
+  }
+
+  template <typename Q>
+    requires unorderedmap_detail::Transparent<Hash, KeyEqual>
+  bool contains(const Q& key) const {
+    return find(key) != end();
+  }
+  template <typename Q>
+    requires unorderedmap_detail::Transparent<Hash, KeyEqual>
+  bool contains(const Q& key, size_type hash) const {
+    return find(key, hash) != end();
+  }
+
+  template <typename Q>
+    requires unorderedmap_detail::Transparent<Hash, KeyEqual>
+  size_type count(const Q& key) const {
+    return contains(key) ? 1 : 0;
+  }
+  template <typename Q>
+    requires unorderedmap_detail::Transparent<Hash, KeyEqual>
+  size_type count(const Q& key, size_type hash) const {
+    return contains(key, hash) ? 1 : 0;
+  }
+
+  V& at(const K& key) {
+    iterator it = find(key);
+    if (it == end()) {
+      throw std::out_of_range("UnorderedMap::at");
+    }
+    return it->second;
+  }
+  const V& at(const K& key) const { return const_cast<UnorderedMap*>(this)->at(key); }
+
+  V& operator[](const K& key) { return try_emplace(key).first->second; }
+  V& operator[](K&& key) { return try_emplace(std::move(key)).first->second; }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const K& key, Args&&... args) {
+    return emplace_unique(key, std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+    return emplace_unique(std::move(key), std::forward<Args>(args)...);
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(const K& key, M&& value) {
+    return insert_or_assign_hashed(key, hash_(key), std::forward<M>(value));
+  }
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(K&& key, M&& value) {
+    return insert_or_assign_hashed(std::move(key), hash_(key), std::forward<M>(value));
+  }
+
+  // As try_emplace and insert_or_assign; `hash` must be hash_function()(key).
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace_hashed(const K& key, size_type hash, Args&&... args) {
+    return emplace_hashed(mix(hash), key, std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace_hashed(K&& key, size_type hash, Args&&... args) {
+    return emplace_hashed(mix(hash), std::move(key), std::forward<Args>(args)...);
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign_hashed(const K& key, size_type hash, M&& value) {
+    auto result = try_emplace_hashed(key, hash, std::forward<M>(value));
+    if (!result.second) {
+      result.first->second = std::forward<M>(value);
+    }
+    return result;
+  }
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign_hashed(K&& key, size_type hash, M&& value) {
+    auto result = try_emplace_hashed(std::move(key), hash, std::forward<M>(value));
+    if (!result.second) {
+      result.first->second = std::forward<M>(value);
+    }
+    return result;
+  }
+
+  // A key and a mapped value, or a pair of them, are looked up before
+  // anything is constructed; any other arguments build a temporary pair.
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    if constexpr (sizeof...(Args) == 2) {
+      return emplace_key_value(std::forward<Args>(args)...);
+    } else if constexpr (sizeof...(Args) == 1 &&
+                         (is_pair<std::remove_cvref_t<Args>>::value && ...)) {
+      return emplace_pair(std::forward<Args>(args)...);
+    } else {
+      std::pair<K, V> value(std::forward<Args>(args)...);
+      return emplace_unique(std::move(value.first), std::move(value.second));
+    }
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    return emplace_unique(value.first, value.second);
+  }
+  std::pair<iterator, bool> insert(value_type&& value) {
+    return emplace_unique(value.first, std::move(value.second));
+  }
+  template <typename P>
+    requires std::is_constructible_v<value_type, P&&>
+  std::pair<iterator, bool> insert(P&& value) {
+    return emplace(std::forward<P>(value));
+  }
+
+  template <std::input_iterator InputIt>
+  void insert(InputIt first, InputIt last) {
+    if constexpr (std::forward_iterator<InputIt>) {
+      reserve(size_ + static_cast<size_type>(std::distance(first, last)));
+    }
+    for (; first != last; ++first) {
+      emplace(*first);
+    }
+  }
+  void insert(std::initializer_list<value_type> values) {
+    insert(values.begin(), values.end());
+  }
+
+  insert_return_type insert(node_type&& node) {
+    if (node.empty()) {
+      return {end(), false, node_type()};
+    }
+    size_type hash = hash_of(node.key());
+    size_type index = find_index(node.key(), hash);
+    if (index != capacity_) {
+      return {iterator_at(index), false, std::move(node)};
+    }
+    index = prepare_insert(hash);
+    relocate(alloc_, slots_ + index, &node.slot_);
+    node.alloc_.reset();
+    commit_insert(index, hash);
+    return {iterator_at(index), true, node_type()};
+  }
+
+  // Erasure. Tombstones are only left in groups that have no empty slot,
+  // since only those can be on the probe path of other keys.
+
+  iterator erase(const_iterator pos) {
+    auto index = static_cast<size_type>(pos.slot_ - slots_);
+    SlotTraits::destroy(alloc_, std::addressof(slots_[index].value));
+    erase_meta(index);
+    iterator next(ctrl_ + index, slots_ + index);
+    next.skip_free();
+    return next;
+  }
+  iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    while (first != last) {
+      first = erase(first);
+    }
+    return iterator(last.ctrl_, last.slot_);
+  }
+
+  size_type erase(const K& key) {
+    size_type index = find_index(key, hash_of(key));
+    if (index == capacity_) {
+      return 0;
+    }
+    erase(iterator_at(index));
+    return 1;
+  }
+
+  node_type extract(const_iterator pos) {
+    auto index = static_cast<size_type>(pos.slot_ - slots_);
+    node_type node;
+    node.alloc_.emplace(alloc_);
+    relocate(alloc_, &node.slot_, slots_ + index);
+    erase_meta(index);
+    return node;
+  }
+
+  node_type extract(const K& key) {
+    const_iterator it = find(key);
+    return it == end() ? node_type() : extract(it);
+  }
+
+  void swap(UnorderedMap& other) noexcept {
+    using std::swap;
+    swap(hash_, other.hash_);
+    swap(equal_, other.equal_);
+    if constexpr (AllocTraits::propagate_on_container_swap::value) {
+      swap(alloc_, other.alloc_);
+    }
+    swap(ctrl_, other.ctrl_);
+    swap(slots_, other.slots_);
+    swap(capacity_, other.capacity_);
+    swap(size_, other.size_);
+    swap(growth_left_, other.growth_left_);
+  }
+
+  friend void swap(UnorderedMap& lhs, UnorderedMap& rhs) noexcept { lhs.swap(rhs); }
+
+  friend bool operator==(const UnorderedMap& lhs, const UnorderedMap& rhs) {
+    if (lhs.size_ != rhs.size_) {
+      return false;
+    }
+    for (const value_type& value : lhs) {
+      auto it = rhs.find(value.first);
+      if (it == rhs.end() || !(it->second == value.second)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  template <typename T>
+  struct is_pair : std::false_type {};
+  template <typename A, typename B>
+  struct is_pair<std::pair<A, B>> : std::true_type {};
+
+  static size_type growth_limit(size_type capacity) { return capacity - capacity / 8; }
+
+  // Smallest power-of-two table holding `count` elements below 7/8 load.
+  static size_type capacity_for(size_type count) {
+    if (count == 0) {
+      return 0;
+    }
+    size_type capacity = std::bit_ceil(std::max(count + count / 7 + 1, kGroupWidth));
+    while (growth_limit(capacity) < count) {
+      capacity *= 2;
+    }
+    return capacity;
+  }
+
+  static size_type table_size(size_type count) {
+    return count == 0 ? 0 : std::bit_ceil(std::max(count, kGroupWidth));
+  }
+
+  template <typename Q>
+  size_type hash_of(const Q& key) const {
+    return mix(static_cast<size_type>(hash_(key)));
+  }
+
+  static size_type mix(size_type hash) { return unorderedmap_detail::mix(hash); }
+
+  static Ctrl h2(size_type hash) { return static_cast<Ctrl>(hash & 0x7F); }
+  size_type group_mask() const { return capacity_ / kGroupWidth - 1; }
+
+  iterator iterator_at(size_type index) {
+    return iterator(ctrl_ + index, slots_ + index);
+  }
+
+  // Index of the slot holding `key`, or capacity_ if there is none.
+  template <typename Q>
+  size_type find_index(const Q& key, size_type hash) const {
+    if (capacity_ == 0) {
+      return 0;
+    }
+    ProbeSeq seq(hash >> 7, group_mask());
+    while (true) {
+      Group group(ctrl_ + seq.offset());
+      for (size_type i : group.match(h2(hash))) {
+        size_type index = seq.offset() + i;
+        if (equal_(slots_[index].value.first, key)) {
+          PORTFOLIO_RECORD("unorderedmap.probe_groups", seq.probes());
+          return index;
+        }
+      }
+      if (group.match_empty()) {
+        PORTFOLIO_RECORD("unorderedmap.probe_groups", seq.probes());
+        return capacity_;
+      }
+      seq.next();
+    }
+  }
+
+  size_type find_free(size_type hash) const {
+    ProbeSeq seq(hash >> 7, group_mask());
+    while (true) {
+      auto mask = Group(ctrl_ + seq.offset()).match_empty_or_deleted();
+      if (mask) {
+        return seq.offset() + mask.lowest();
+      }
+      seq.next();
+    }
+  }
+
+  // Finds the slot for a new element, growing the table if it is time.
+  // The slot stays free until commit_insert(), so a throwing constructor
+  // leaves the table as it was.
+  size_type prepare_insert(size_type hash) {
+    if (capacity_ == 0) {
+      resize_table(kGroupWidth);
+    }
+    size_type index = find_free(hash);
+    if (growth_left_ == 0 && ctrl_[index] == unorderedmap_detail::kEmpty) {
+      // Tombstones alone can fill the table: clean them up in place if the
+      // live elements fit in half of it.
+      resize_table(size_ * 2 <= growth_limit(capacity_) ? capacity_ : capacity_ * 2);
+      index = find_free(hash);
+    }
+    return index;
+  }
+
+  void commit_insert(size_type index, size_type hash) {
+    if (ctrl_[index] == unorderedmap_detail::kEmpty) {
+      --growth_left_;
+    }
+    ctrl_[index] = h2(hash);
+    ++size_;
+  }
+
+  void erase_meta(size_type index) {
+    --size_;
+    Group group(ctrl_ + (index & ~(kGroupWidth - 1)));
+    if (group.match_empty()) {
+      ctrl_[index] = unorderedmap_detail::kEmpty;
+      ++growth_left_;
+    } else {
+      ctrl_[index] = unorderedmap_detail::kDeleted;
+    }
+  }
+
+  template <typename KeyArg, typename... Args>
+  std::pair<iterator, bool> emplace_unique(KeyArg&& key, Args&&... args) {
+    const size_type hash = hash_of(key);
+    return emplace_hashed(hash, std::forward<KeyArg>(key), std::forward<Args>(args)...);
+  }
+
+  // `hash` is mixed already.
+  template <typename KeyArg, typename... Args>
+  std::pair<iterator, bool> emplace_hashed(size_type hash, KeyArg&& key, Args&&... args) {
+    size_type index = find_index(key, hash);
+    if (index != capacity_) {
+      return {iterator_at(index), false};
+    }
+    index = prepare_insert(hash);
+    SlotTraits::construct(alloc_, std::addressof(slots_[index].value),
+                          std::piecewise_construct,
+                          std::forward_as_tuple(std::forward<KeyArg>(key)),
+                          std::forward_as_tuple(std::forward<Args>(args)...));
+    commit_insert(index, hash);
+    return {iterator_at(index), true};
+  }
+
+  template <typename KeyArg, typename MappedArg>
+  std::pair<iterator, bool> emplace_key_value(KeyArg&& key, MappedArg&& mapped) {
+    if constexpr (std::is_same_v<std::remove_cvref_t<KeyArg>, K>) {
+      return emplace_unique(std::forward<KeyArg>(key), std::forward<MappedArg>(mapped));
+    } else {
+      K converted(std::forward<KeyArg>(key));
+      return emplace_unique(std::move(converted), std::forward<MappedArg>(mapped));
+    }
+  }
+
+  template <typename Pair>
+  std::pair<iterator, bool> emplace_pair(Pair&& pair) {
+    return emplace_key_value(std::forward<Pair>(pair).first,
+                             std::forward<Pair>(pair).second);
+  }
+
+  // Moves the element of `from` into the raw slot `to` and destroys it.
+  static void relocate(SlotAllocator& alloc, Slot* to, Slot* from) {
+    value_type& value = from->value;
+    SlotTraits::construct(alloc, std::addressof(to->value),
+                          std::move(const_cast<K&>(value.first)),
+                          std::move(value.second));
+    SlotTraits::destroy(alloc, std::addressof(value));
+  }
+
+  static void reset_ctrl(Ctrl* ctrl, size_type capacity) {
+    std::memset(ctrl, unorderedmap_detail::kEmpty, capacity);
+    std::memset(ctrl + capacity, unorderedmap_detail::kSentinel, kGroupWidth);
+  }
+
+  // Moves every element into a fresh table of `capacity` slots. Elements
+  // that may throw on move are copied, and the old table is kept until all
+  // copies succeed.
+  void resize_table(size_type capacity) {
+    PORTFOLIO_SCOPE("unorderedmap.rehash");
+    CtrlAllocator ctrl_alloc(alloc_);
+    Ctrl* ctrl = nullptr;
+    Slot* slots = nullptr;
+    if (capacity != 0) {
+      ctrl = CtrlTraits::allocate(ctrl_alloc, capacity + kGroupWidth);
+      try {
+        slots = SlotTraits::allocate(alloc_, capacity);
+      } catch (...) {
+        CtrlTraits::deallocate(ctrl_alloc, ctrl, capacity + kGroupWidth);
+        throw;
+      }
+      reset_ctrl(ctrl, capacity);
+    }
+
+    Ctrl* old_ctrl = ctrl_;
+    Slot* old_slots = slots_;
+    size_type old_capacity = capacity_;
+    ctrl_ = ctrl;
+    slots_ = slots;
+    capacity_ = capacity;
+
+    if constexpr (kNothrowRelocate) {
+      for (size_type i = 0; i < old_capacity; ++i) {
+        if (unorderedmap_detail::is_full(old_ctrl[i])) {
+          size_type hash = hash_of(old_slots[i].value.first);
+          size_type index = find_free(hash);
+          ctrl_[index] = h2(hash);
+          relocate(alloc_, slots_ + index, old_slots + i);
+        }
+      }
+    } else {
+      try {
+        for (size_type i = 0; i < old_capacity; ++i) {
+          if (unorderedmap_detail::is_full(old_ctrl[i])) {
+            size_type hash = hash_of(old_slots[i].value.first);
+            size_type index = find_free(hash);
+            SlotTraits::construct(alloc_, std::addressof(slots_[index].value),
+                                  std::as_const(old_slots[i].value));
+            ctrl_[index] = h2(hash);
+          }
+        }
+      } catch (...) {
+        if (capacity_ != 0) {
+          destroy_elements(ctrl_, slots_, capacity_);
+          deallocate_table();
+        }
+        ctrl_ = old_ctrl;
+        slots_ = old_slots;
+        capacity_ = old_capacity;
+        throw;
+      }
+      destroy_elements(old_ctrl, old_slots, old_capacity);
+    }
+
+    if (old_capacity != 0) {
+      CtrlTraits::deallocate(ctrl_alloc, old_ctrl, old_capacity + kGroupWidth);
+      SlotTraits::deallocate(alloc_, old_slots, old_capacity);
+    }
+    if (capacity == 0) {
+      ctrl_ = empty_ctrl();
+    }
+    growth_left_ = growth_limit(capacity) - size_;
+  }
+
+  // Copies with the same layout: control bytes are copied as they are and
+  // each element is copy-constructed into the same slot, without hashing.
+  void copy_from(const UnorderedMap& other) {
+    if (other.size_ == 0) {
+      return;
+    }
+    CtrlAllocator ctrl_alloc(alloc_);
+    size_type capacity = other.capacity_;
+    Ctrl* ctrl = CtrlTraits::allocate(ctrl_alloc, capacity + kGroupWidth);
+    try {
+      slots_ = SlotTraits::allocate(alloc_, capacity);
+    } catch (...) {
+      CtrlTraits::deallocate(ctrl_alloc, ctrl, capacity + kGroupWidth);
+      throw;
+    }
+    ctrl_ = ctrl;
+    capacity_ = capacity;
+    reset_ctrl(ctrl_, capacity_);
+    try {
+      for (size_type i = 0; i < capacity; ++i) {
+        if (unorderedmap_detail::is_full(other.ctrl_[i])) {
+          SlotTraits::construct(alloc_, std::addressof(slots_[i].value),
+                                other.slots_[i].value);
+          ctrl_[i] = other.ctrl_[i];
+        }
+      }
+    } catch (...) {
+      release();
+      throw;
+    }
+    for (size_type i = 0; i < capacity; ++i) {
+      if (other.ctrl_[i] == unorderedmap_detail::kDeleted) {
+        ctrl_[i] = unorderedmap_detail::kDeleted;
+      }
+    }
+    size_ = other.size_;
+    growth_left_ = other.growth_left_;
+  }
+
+  void move_elements_from(UnorderedMap& other) {
+    reserve(other.size_);
+    for (value_type& value : other) {
+      emplace_unique(std::move(const_cast<K&>(value.first)), std::move(value.second));
+    }
+    other.clear();
+  }
+
+  void destroy_elements() noexcept { destroy_elements(ctrl_, slots_, capacity_); }
+
+  void destroy_elements(const Ctrl* ctrl, Slot* slots, size_type capacity) noexcept {
+    if constexpr (!std::is_trivially_destructible_v<value_type>) {
+      for (size_type i = 0; i < capacity; ++i) {
+        if (unorderedmap_detail::is_full(ctrl[i])) {
+          SlotTraits::destroy(alloc_, std::addressof(slots[i].value));
+        }
+      }
+    }
+  }
+
+  void deallocate_table() noexcept {
+    CtrlAllocator ctrl_alloc(alloc_);
+    CtrlTraits::deallocate(ctrl_alloc, ctrl_, capacity_ + kGroupWidth);
+    SlotTraits::deallocate(alloc_, slots_, capacity_);
+  }
+
+  void release() noexcept {
+    if (capacity_ != 0) {
+      destroy_elements();
+      deallocate_table();
+    }
+    ctrl_ = empty_ctrl();
+    slots_ = nullptr;
+    capacity_ = 0;
+    size_ = 0;
+    growth_left_ = 0;
+  }
+
+  void steal(UnorderedMap& other) noexcept {
+    ctrl_ = std::exchange(other.ctrl_, empty_ctrl());
+    slots_ = std::exchange(other.slots_, nullptr);
+    capacity_ = std::exchange(other.capacity_, 0);
+    size_ = std::exchange(other.size_, 0);
+    growth_left_ = std::exchange(other.growth_left_, 0);
+  }
+
+  static Ctrl* empty_ctrl() {
+    return const_cast<Ctrl*>(unorderedmap_detail::kEmptyGroup);
+  }
+
+  Ctrl* ctrl_ = empty_ctrl();
+  Slot* slots_ = nullptr;
+  size_type capacity_ = 0;
+  size_type size_ = 0;
+  size_type growth_left_ = 0;  // inserts into empty slots before a rehash
+  [[no_unique_address]] Hash hash_;
+  [[no_unique_address]] KeyEqual equal_;
+  [[no_unique_address]] SlotAllocator alloc_;
+};
@@ -0,0 +1,49 @@
+# Times compiling visit_compile.cpp with std::variant and with Variant for a
+# range of alternative counts, and prints one line per count.
+#
+# Invoked by the variant_compile_bench target as a script:
+#   cmake -DCOMPILER=<c++> -DSOURCE=<visit_compile.cpp> -DINCLUDE_DIR=<repo root>
+#         -DFLAGS=<flag>|<flag>... -DWORK_DIR=<dir> -P CompileTime.cmake
+#
+# TIMESTAMP "%f" needs CMake 3.23.
+
+cmake_minimum_required(VERSION 3.23)
+
+string(REPLACE "|" ";" flags "${FLAGS}")
+file(MAKE_DIRECTORY "${WORK_DIR}")
+
+# Microseconds since the epoch, from one reading so the seconds cannot tick
+# over between the two parts.
+function(now out)
+  string(TIMESTAMP stamp "%s.%f")
+  string(REPLACE "." ";" parts "${stamp}")
+  list(GET parts 0 seconds)
+  list(GET parts 1 micros)
+  math(EXPR value "${seconds} * 1000000 + ${micros}")
+  set(${out} ${value} PARENT_SCOPE)
+endfunction()
+
+function(compile_ms alternatives implementation out)
+  set(defines "-DVARIANT_ALTERNATIVES=${alternatives}")
+  if(implementation STREQUAL "std")
+    list(APPEND defines -DVARIANT_USE_STD)
+  endif()
+  now(start)
+  execute_process(
+    COMMAND "${COMPILER}" ${flags} ${defines} "-I${INCLUDE_DIR}" -c "${SOURCE}"
+            -o "${WORK_DIR}/visit_${implementation}_${alternatives}.o"
+    RESULT_VARIABLE result)
+  now(stop)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "compiling with ${implementation} and ${alternatives} alternatives failed")
+  endif()
+  math(EXPR elapsed "(${stop} - ${start}) / 1000")
+  set(${out} ${elapsed} PARENT_SCOPE)
+endfunction()
+
+message(STATUS "alternatives  std::visit ms  Variant ms")
+foreach(alternatives 2 4 8 16 32 64)
+  compile_ms(${alternatives} std std_ms)
+  compile_ms(${alternatives} portfolio portfolio_ms)
+  message(STATUS "${alternatives}  ${std_ms}  ${portfolio_ms}")
+endforeach()
@@ -0,0 +1,115 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "Variant/variant.h"
+
+namespace {
+
+// A packet type per alternative. Each handler does slightly different work
+// so the compiler cannot fold the branches together.
+template <std::size_t I>
+struct Message {
+  std::uint32_t payload;
+};
+
+struct Handler {
+  template <std::size_t I>
+  std::uint64_t operator()(const Message<I>& message) const {
+    return message.payload * (2 * I + 1) + I;
+  }
+};
+
+struct PairHandler {
+  template <std::size_t I, std::size_t J>
+  std::uint64_t operator()(const Message<I>& lhs, const Message<J>& rhs) const {
+    return lhs.payload * (I + 1) + rhs.payload * (J + 3);
+  }
+};
+
+template <template <typename...> class V, typename Sequence>
+struct MessagesOf;
+
+template <template <typename...> class V, std::size_t... Is>
+struct MessagesOf<V, std::index_sequence<Is...>> {
+  using type = V<Message<Is>...>;
+};
+
+template <template <typename...> class V, std::size_t N>
+using Messages = typename MessagesOf<V, std::make_index_sequence<N>>::type;
+
+// Random packets with every alternative equally likely.
+template <typename Packet, std::size_t... Is>
+std::vector<Packet> make_packets(std::size_t count, std::index_sequence<Is...>) {
+  using Factory = Packet (*)(std::uint32_t);
+  static constexpr Factory kFactories[] = {
+      [](std::uint32_t payload) { return Packet(Message<Is>{payload}); }...};
+  std::mt19937 gen(42);
+  std::vector<Packet> packets;
+  packets.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    packets.push_back(kFactories[gen() % sizeof...(Is)](static_cast<std::uint32_t>(gen())));
+  }
+  return packets;
+}
+
+constexpr std::size_t kPackets = 1 << 12;
+
+struct StdVisit {
+  template <typename... Args>
+  static decltype(auto) visit(Args&&... args) {
+    return std::visit(std::forward<Args>(args)...);
+  }
+};
+
+struct PortfolioVisit {
+  template <typename... Args>
+  static decltype(auto) visit(Args&&... args) {
+    return ::visit(std::forward<Args>(args)...);
+  }
+};
+
+template <template <typename...> class V, typename Visit, std::size_t N>
+void BM_Visit(benchmark::State& state) {
+  auto packets = make_packets<Messages<V, N>>(kPackets, std::make_index_sequence<N>());
+  for (auto _ : state) {
+    std::uint64_t sum = 0;
+    for (const auto& packet : packets) {
+      sum += Visit::visit(Handler{}, packet);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kPackets));
+}
+
+template <template <typename...> class V, typename Visit, std::size_t N>
+void BM_VisitPair(benchmark::State& state) {
+  auto packets = make_packets<Messages<V, N>>(kPackets + 1, std::make_index_sequence<N>());
+  for (auto _ : state) {
+    std::uint64_t sum = 0;
+    for (std::size_t i = 0; i < kPackets; ++i) {
+      sum += Visit::visit(PairHandler{}, packets[i], packets[i + 1]);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kPackets));
+}
+
+#define VISIT_BENCHMARKS(N)                                         \
+  BENCHMARK_TEMPLATE(BM_Visit, std::variant, StdVisit, N);          \
+  BENCHMARK_TEMPLATE(BM_Visit, Variant, PortfolioVisit, N);         \
+  BENCHMARK_TEMPLATE(BM_VisitPair, std::variant, StdVisit, N);      \
+  BENCHMARK_TEMPLATE(BM_VisitPair, Variant, PortfolioVisit, N)
+
+VISIT_BENCHMARKS(2);
+VISIT_BENCHMARKS(4);
+VISIT_BENCHMARKS(8);
+VISIT_BENCHMARKS(16);
+VISIT_BENCHMARKS(32);
+VISIT_BENCHMARKS(64);
+
+}  // namespace
@@ -0,0 +1,49 @@
+// Translation unit timed by CompileTime.cmake: visits over a variant with
+// VARIANT_ALTERNATIVES alternatives, singly and in pairs, using either
+// std::visit (VARIANT_USE_STD) or the portfolio Variant.
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#ifdef VARIANT_USE_STD
+#include <variant>
+#define VARIANT_TEMPLATE std::variant
+#define VARIANT_VISIT std::visit
+#else
+#include "Variant/variant.h"
+#define VARIANT_TEMPLATE Variant
+#define VARIANT_VISIT visit
+#endif
+
+template <std::size_t I>
+struct Message {
+  std::uint32_t payload;
+};
+
+template <typename Sequence>
+struct MessagesOf;
+
+template <std::size_t... Is>
+struct MessagesOf<std::index_sequence<Is...>> {
+  using type = VARIANT_TEMPLATE<Message<Is>...>;
+};
+
+using Packet = MessagesOf<std::make_index_sequence<VARIANT_ALTERNATIVES>>::type;
+
+struct Handler {
+  template <std::size_t I>
+  std::uint64_t operator()(const Message<I>& message) const {
+    return message.payload * (2 * I + 1);
+  }
+  template <std::size_t I, std::size_t J>
+  std::uint64_t operator()(const Message<I>& lhs, const Message<J>& rhs) const {
+    return lhs.payload * (I + 1) + rhs.payload * (J + 3);
+  }
+};
+
+std::uint64_t visit_one(const Packet& packet) { return VARIANT_VISIT(Handler{}, packet); }
+
+std::uint64_t visit_two(const Packet& lhs, const Packet& rhs) {
+  return VARIANT_VISIT(Handler{}, lhs, rhs);
+}
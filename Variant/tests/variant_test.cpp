@@ -0,0 +1,259 @@
+#include <gtest/gtest.h>
+
+#include <compare>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "Variant/variant.h"
+
+namespace {
+
+struct ThrowsOnCopy {
+  ThrowsOnCopy() = default;
+  ThrowsOnCopy(const ThrowsOnCopy&) { throw std::runtime_error("ThrowsOnCopy"); }
+  ThrowsOnCopy& operator=(const ThrowsOnCopy&) = default;
+  friend auto operator<=>(const ThrowsOnCopy&, const ThrowsOnCopy&) = default;
+};
+
+struct Tracked {
+  static inline int alive = 0;
+  Tracked() { ++alive; }
+  Tracked(const Tracked&) { ++alive; }
+  Tracked(Tracked&&) noexcept { ++alive; }
+  Tracked& operator=(const Tracked&) = default;
+  Tracked& operator=(Tracked&&) = default;
+  ~Tracked() { --alive; }
+};
+
+template <std::size_t I>
+struct Tag {
+  int value = static_cast<int>(I);
+};
+
+static_assert(sizeof(Variant<char, bool>) == 2);
+static_assert(std::is_trivially_copyable_v<Variant<int, double, char>>);
+static_assert(std::is_trivially_destructible_v<Variant<int, double>>);
+static_assert(!std::is_trivially_destructible_v<Variant<int, std::string>>);
+static_assert(!std::is_copy_constructible_v<Variant<int, std::unique_ptr<int>>>);
+static_assert(std::is_nothrow_move_constructible_v<Variant<int, std::string>>);
+
+// The converting constructor picks the same alternative as std::variant.
+template <typename T, typename... Ts>
+bool selects_like_std(T&& value) {
+  Variant<Ts...> ours(value);
+  std::variant<Ts...> theirs(value);
+  return ours.index() == theirs.index();
+}
+
+TEST(Variant, ConvertingConstructorSelectsLikeStd) {
+  EXPECT_TRUE((selects_like_std<const char*, int, std::string>("text")));
+  EXPECT_TRUE((selects_like_std<int, long, int, double>(1)));
+  EXPECT_TRUE((selects_like_std<double, int, double>(1.5)));
+  EXPECT_TRUE((selects_like_std<char, std::string, char>('c')));
+  EXPECT_TRUE((selects_like_std<float, double, int>(1.0f)));
+  static_assert(!std::is_constructible_v<Variant<int, char>, double>,
+                "narrowing conversions are not candidates");
+}
+
+TEST(Variant, DefaultHoldsTheFirstAlternative) {
+  Variant<int, std::string> variant;
+  EXPECT_EQ(variant.index(), 0u);
+  EXPECT_EQ(get<0>(variant), 0);
+  EXPECT_TRUE(holds_alternative<int>(variant));
+}
+
+TEST(Variant, GetAndGetIf) {
+  Variant<int, std::string> variant(std::in_place_type<std::string>, 3, 'x');
+  EXPECT_EQ(get<std::string>(variant), "xxx");
+  EXPECT_EQ(get<1>(std::as_const(variant)), "xxx");
+  EXPECT_THROW(get<int>(variant), std::bad_variant_access);
+  EXPECT_THROW(get<0>(variant), std::bad_variant_access);
+  EXPECT_EQ(get_if<int>(&variant), nullptr);
+  ASSERT_NE(get_if<1>(&variant), nullptr);
+  EXPECT_EQ(*get_if<std::string>(&variant), "xxx");
+  EXPECT_EQ(get_if<0>(static_cast<Variant<int, std::string>*>(nullptr)), nullptr);
+
+  std::string moved = get<1>(std::move(variant));
+  EXPECT_EQ(moved, "xxx");
+}
+
+TEST(Variant, AssignmentSwitchesAndDestroysAlternatives) {
+  {
+    Variant<int, Tracked, std::string> variant;
+    variant = Tracked();
+    EXPECT_EQ(Tracked::alive, 1);
+    variant = std::string("text");
+    EXPECT_EQ(Tracked::alive, 0);
+    variant.emplace<Tracked>();
+    Variant<int, Tracked, std::string> copy = variant;
+    EXPECT_EQ(Tracked::alive, 2);
+    copy = 5;
+    EXPECT_EQ(Tracked::alive, 1);
+    copy = variant;
+    variant = std::move(copy);
+    EXPECT_EQ(Tracked::alive, 2);
+  }
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(Variant, ThrowingEmplaceLeavesItValueless) {
+  Variant<int, ThrowsOnCopy> variant = 1;
+  ThrowsOnCopy source;
+  EXPECT_THROW(variant.emplace<ThrowsOnCopy>(source), std::runtime_error);
+  EXPECT_TRUE(variant.valueless_by_exception());
+  EXPECT_EQ(variant.index(), (Variant<int, ThrowsOnCopy>::npos));
+  EXPECT_THROW(get<0>(variant), std::bad_variant_access);
+  EXPECT_THROW(visit([](auto&&) {}, variant), std::bad_variant_access);
+
+  Variant<int, ThrowsOnCopy> other = 2;
+  EXPECT_LT(variant, other);
+  other = variant;
+  EXPECT_TRUE(other.valueless_by_exception());
+  EXPECT_EQ(variant, other);
+  variant = 3;
+  EXPECT_EQ(get<int>(variant), 3);
+}
+
+TEST(Variant, TriviallyCopyableNeverGoesValueless) {
+  struct Throws {
+    Throws() = default;
+    explicit Throws(int) { throw std::runtime_error("Throws"); }
+  };
+  Variant<int, Throws> variant = 7;
+  EXPECT_THROW(variant.emplace<Throws>(0), std::runtime_error);
+  EXPECT_FALSE(variant.valueless_by_exception());
+  EXPECT_EQ(get<int>(variant), 7);
+
+  // One built aside is moved in, so it need not be copyable.
+  struct MoveOnly {
+    explicit MoveOnly(int v) : value(v) {
+      if (v < 0) {
+        throw std::runtime_error("MoveOnly");
+      }
+    }
+    MoveOnly(const MoveOnly&) = delete;
+    MoveOnly(MoveOnly&&) = default;
+    MoveOnly& operator=(MoveOnly&&) = default;
+    int value;
+  };
+  static_assert(std::is_trivially_copyable_v<MoveOnly>);
+  Variant<int, MoveOnly> move_only = 7;
+  EXPECT_EQ(move_only.emplace<MoveOnly>(5).value, 5);
+  EXPECT_THROW(move_only.emplace<1>(-1), std::runtime_error);
+  EXPECT_EQ(get<MoveOnly>(move_only).value, 5);
+}
+
+TEST(Variant, VisitSingle) {
+  Variant<int, double, std::string> variant = std::string("abc");
+  auto describe = [](const auto& value) -> std::string {
+    if constexpr (std::is_same_v<std::decay_t<decltype(value)>, std::string>) {
+      return "string " + value;
+    } else {
+      return "number " + std::to_string(value);
+    }
+  };
+  EXPECT_EQ(visit(describe, variant), "string abc");
+  variant = 4;
+  EXPECT_EQ(visit(describe, variant), "number 4");
+  EXPECT_EQ(visit<long>([](const auto& value) { return sizeof(value); }, variant),
+            static_cast<long>(sizeof(int)));
+
+  visit([](auto& value) {
+    if constexpr (std::is_same_v<std::decay_t<decltype(value)>, int>) {
+      value *= 10;
+    }
+  }, variant);
+  EXPECT_EQ(get<int>(variant), 40);
+}
+
+TEST(Variant, VisitPassesValueCategories) {
+  Variant<std::string, int> variant = std::string(100, 'm');
+  std::string taken = visit(
+      [](auto&& value) -> std::string {
+        if constexpr (std::is_same_v<std::decay_t<decltype(value)>, std::string>) {
+          static_assert(std::is_rvalue_reference_v<decltype(value)>);
+          return std::move(value);
+        } else {
+          return {};
+        }
+      },
+      std::move(variant));
+  EXPECT_EQ(taken.size(), 100u);
+}
+
+// Both dispatch paths: 3 x 3 combinations fit the switch, 6 x 6 use the
+// table; every pair of indices must reach its own instantiation.
+template <std::size_t N, std::size_t... Is>
+void check_pairs(std::index_sequence<Is...>) {
+  using V = Variant<Tag<Is>...>;
+  for (std::size_t left = 0; left < N; ++left) {
+    for (std::size_t right = 0; right < N; ++right) {
+      V a;
+      V b;
+      ((left == Is ? (a = Tag<Is>{}, 0) : 0), ...);
+      ((right == Is ? (b = Tag<Is>{}, 0) : 0), ...);
+      int combined = visit([](auto x, auto y) { return x.value * 100 + y.value; }, a, b);
+      EXPECT_EQ(combined, static_cast<int>(left * 100 + right));
+    }
+  }
+}
+
+TEST(Variant, VisitSeveralThroughSwitchAndTable) {
+  check_pairs<3>(std::make_index_sequence<3>());
+  check_pairs<6>(std::make_index_sequence<6>());
+
+  Variant<int, char> a = 'x';
+  Variant<int, char> b = 2;
+  Variant<int, char> c = 'y';
+  auto sum = visit([](auto x, auto y, auto z) { return int(x) + int(y) + int(z); }, a, b, c);
+  EXPECT_EQ(sum, 'x' + 2 + 'y');
+}
+
+TEST(Variant, VisitManyAlternatives) {
+  Variant<Tag<0>, Tag<1>, Tag<2>, Tag<3>, Tag<4>, Tag<5>, Tag<6>, Tag<7>, Tag<8>, Tag<9>,
+          Tag<10>, Tag<11>, Tag<12>, Tag<13>, Tag<14>, Tag<15>, Tag<16>, Tag<17>, Tag<18>,
+          Tag<19>>
+      variant = Tag<17>{};
+  EXPECT_EQ(variant.index(), 17u);
+  EXPECT_EQ(visit([](auto tag) { return tag.value; }, variant), 17);
+}
+
+TEST(Variant, ComparesByIndexThenValue) {
+  using V = Variant<int, std::string>;
+  EXPECT_EQ(V(1), V(1));
+  EXPECT_NE(V(1), V(2));
+  EXPECT_LT(V(5), V(std::string("a")));
+  EXPECT_LT(V(std::string("a")), V(std::string("b")));
+  EXPECT_GT(V(3), V(2));
+}
+
+TEST(Variant, Swap) {
+  Variant<int, std::string> a = 1;
+  Variant<int, std::string> b = std::string("two");
+  swap(a, b);
+  EXPECT_EQ(get<std::string>(a), "two");
+  EXPECT_EQ(get<int>(b), 1);
+  Variant<int, std::string> c = std::string("three");
+  a.swap(c);
+  EXPECT_EQ(get<std::string>(a), "three");
+  EXPECT_EQ(get<std::string>(c), "two");
+}
+
+TEST(Variant, MoveOnlyAlternatives) {
+  Variant<int, std::unique_ptr<int>> variant = std::make_unique<int>(9);
+  Variant<int, std::unique_ptr<int>> moved = std::move(variant);
+  EXPECT_EQ(*get<1>(moved), 9);
+  std::vector<Variant<int, std::unique_ptr<int>>> many;
+  for (int i = 0; i < 100; ++i) {
+    many.emplace_back(std::make_unique<int>(i));
+  }
+  EXPECT_EQ(*get<1>(many[99]), 99);
+}
+
+}  // namespace
@@ -0,0 +1,630 @@
+#pragma once
+
+// Type-safe union in the spirit of std::variant, built for cheap dispatch.
+//
+// The alternatives share one aligned byte buffer; next to it is the index
+// of the active one, stored in the smallest unsigned type that can hold
+// every index plus the valueless marker, so Variant<char, bool> is two
+// bytes. Copy, move and destruction are trivial when they are trivial for
+// every alternative.
+//
+// visit() flattens the index tuple of all its variants into one number and
+// dispatches on it in a single step: through a switch when there are at
+// most kSwitchLimit combinations, which the compiler turns into a jump table
+// and can inline, and through a constexpr array of function pointers
+// otherwise. Either way the instantiation depth does not grow with the
+// number of alternatives. A variant left valueless by a throwing emplace
+// makes visit and get throw std::bad_variant_access; with trivially
+// copyable alternatives that cannot happen and the check compiles away.
+//
+// Unlike std::variant this one is not usable in constant expressions.
+
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+template <typename... Ts>
+class Variant;
+
+namespace variant_detail {
+
+inline constexpr std::size_t kSwitchLimit = 16;
+
+template <std::size_t N>
+using IndexType =
+    std::conditional_t<(N < std::numeric_limits<std::uint8_t>::max()), std::uint8_t,
+                       std::conditional_t<(N < std::numeric_limits<std::uint16_t>::max()),
+                                          std::uint16_t, std::uint32_t>>;
+
+[[noreturn]] inline void unreachable() {
+#if defined(__GNUC__)
+  __builtin_unreachable();
+#elif defined(_MSC_VER)
+  __assume(false);
+#endif
+}
+
+// Type at index I, found with one overload resolution instead of a
+// recursive template.
+template <std::size_t I, typename T>
+struct Indexed {
+  using type = T;
+};
+
+template <typename Sequence, typename... Ts>
+struct Indexer;
+
+template <std::size_t... Is, typename... Ts>
+struct Indexer<std::index_sequence<Is...>, Ts...> : Indexed<Is, Ts>... {};
+
+template <std::size_t I, typename T>
+Indexed<I, T> select_index(const Indexed<I, T>&);
+
+template <std::size_t I, typename... Ts>
+using TypeAt = typename decltype(select_index<I>(
+    Indexer<std::index_sequence_for<Ts...>, Ts...>{}))::type;
+
+// Index of T in Ts..., which must appear exactly once.
+template <typename T, typename... Ts>
+constexpr std::size_t index_of() {
+  constexpr bool kMatches[] = {std::is_same_v<T, Ts>...};
+  std::size_t index = sizeof...(Ts);
+  for (std::size_t i = 0; i < sizeof...(Ts); ++i) {
+    if (kMatches[i]) {
+      index = i;
+    }
+  }
+  return index;
+}
+
+template <std::size_t... Ns>
+inline constexpr std::size_t kMaxOf = [] {
+  std::size_t max = 0;
+  ((max = Ns > max ? Ns : max), ...);
+  return max;
+}();
+
+template <typename T, typename... Ts>
+inline constexpr bool kOccursOnce = (std::is_same_v<T, Ts> + ...) == 1;
+
+// Alternative picked by the converting constructor: overload resolution
+// over F(T_i) for every T_i that T converts to without narrowing.
+template <typename T>
+struct Array {
+  T value[1];
+};
+
+template <std::size_t I, typename Ti>
+struct Candidate {
+  template <typename T>
+    requires requires { Array<Ti>{{std::declval<T>()}}; }
+  std::integral_constant<std::size_t, I> operator()(Ti, T&&) const;
+};
+
+template <typename Sequence, typename... Ts>
+struct Candidates;
+
+template <std::size_t... Is, typename... Ts>
+struct Candidates<std::index_sequence<Is...>, Ts...> : Candidate<Is, Ts>... {
+  using Candidate<Is, Ts>::operator()...;
+};
+
+template <typename T, typename... Ts>
+using Selected = decltype(Candidates<std::index_sequence_for<Ts...>, Ts...>{}(
+    std::declval<T>(), std::declval<T>()));
+
+// Calls f(std::integral_constant<std::size_t, I>{}) with I = index < N.
+template <std::size_t I, typename R, typename F>
+R dispatch_thunk(F&& f) {
+  return std::forward<F>(f)(std::integral_constant<std::size_t, I>{});
+}
+
+template <typename R, typename F, std::size_t... Is>
+R dispatch_table(std::size_t index, F&& f, std::index_sequence<Is...>) {
+  static constexpr R (*kTable[])(F&&) = {&dispatch_thunk<Is, R, F>...};
+  return kTable[index](std::forward<F>(f));
+}
+
+template <std::size_t N, typename R, typename F>
+R dispatch(std::size_t index, F&& f) {
+  if constexpr (N > kSwitchLimit) {
+    return dispatch_table<R>(index, std::forward<F>(f), std::make_index_sequence<N>());
+  } else {
+#define VARIANT_DISPATCH_CASE(k)                                                \
+  case k:                                                                       \
+    if constexpr ((k) < N) {                                                    \
+      return std::forward<F>(f)(std::integral_constant<std::size_t, (k)>{});    \
+    }                                                                           \
+    [[fallthrough]];
+    switch (index) {
+      VARIANT_DISPATCH_CASE(0)
+      VARIANT_DISPATCH_CASE(1)
+      VARIANT_DISPATCH_CASE(2)
+      VARIANT_DISPATCH_CASE(3)
+      VARIANT_DISPATCH_CASE(4)
+      VARIANT_DISPATCH_CASE(5)
+      VARIANT_DISPATCH_CASE(6)
+      VARIANT_DISPATCH_CASE(7)
+      VARIANT_DISPATCH_CASE(8)
+      VARIANT_DISPATCH_CASE(9)
+      VARIANT_DISPATCH_CASE(10)
+      VARIANT_DISPATCH_CASE(11)
+      VARIANT_DISPATCH_CASE(12)
+      VARIANT_DISPATCH_CASE(13)
+      VARIANT_DISPATCH_CASE(14)
+      VARIANT_DISPATCH_CASE(15)
+      default:
+        break;
+    }
+#undef VARIANT_DISPATCH_CASE
+    static_assert(kSwitchLimit == 16, "the switch above has kSwitchLimit cases");
+    unreachable();
+  }
+}
+
+template <typename T>
+struct VariantTraits {
+  static constexpr bool kIsVariant = false;
+};
+
+template <typename... Ts>
+struct VariantTraits<Variant<Ts...>> {
+  static constexpr bool kIsVariant = true;
+  static constexpr std::size_t kSize = sizeof...(Ts);
+};
+
+template <typename V>
+concept AnyVariant = VariantTraits<std::remove_cvref_t<V>>::kIsVariant;
+
+template <typename V>
+inline constexpr std::size_t kSizeOf = VariantTraits<std::remove_cvref_t<V>>::kSize;
+
+struct Access {
+  template <std::size_t I, typename V>
+  static decltype(auto) get(V&& variant) noexcept {
+    return std::remove_cvref_t<V>::template unchecked<I>(std::forward<V>(variant));
+  }
+};
+
+}  // namespace variant_detail
+
+template <typename... Ts>
+class Variant {
+  static_assert(sizeof...(Ts) > 0, "Variant needs at least one alternative");
+  static_assert((std::is_object_v<Ts> && ...) && (!std::is_array_v<Ts> && ...),
+                "Variant alternatives must be non-array object types");
+
+  template <std::size_t I>
+  using Alternative = variant_detail::TypeAt<I, Ts...>;
+  using Index = variant_detail::IndexType<sizeof...(Ts)>;
+
+  static constexpr Index kValueless = std::numeric_limits<Index>::max();
+  static constexpr bool kTriviallyCopyable =
+      (std::is_trivially_copy_constructible_v<Ts> && ...) &&
+      (std::is_trivially_copy_assignable_v<Ts> && ...) &&
+      (std::is_trivially_destructible_v<Ts> && ...);
+  // Trivially copyable alternatives are built aside and copied in when
+  // their constructor may throw, so visit and get skip the valueless check.
+  static constexpr bool kNeverValueless = (std::is_trivially_copyable_v<Ts> && ...);
+  static constexpr bool kTriviallyMovable =
+      (std::is_trivially_move_constructible_v<Ts> && ...) &&
+      (std::is_trivially_move_assignable_v<Ts> && ...) &&
+      (std::is_trivially_destructible_v<Ts> && ...);
+
+ public:
+  static constexpr std::size_t npos = std::variant_npos;
+
+  Variant() noexcept(std::is_nothrow_default_constructible_v<Alternative<0>>)
+    requires std::is_default_constructible_v<Alternative<0>>
+  {
+    construct<0>();
+  }
+
+  // Picks the alternative the way std::variant does: the best overload
+  // among those T converts to without narrowing.
+  template <typename T, std::size_t I = variant_detail::Selected<T, Ts...>::value>
+    requires(!std::is_same_v<std::remove_cvref_t<T>, Variant> &&
+             std::is_constructible_v<Alternative<I>, T>)
+  Variant(T&& value) noexcept(  // NOLINT(google-explicit-constructor)
+      std::is_nothrow_constructible_v<Alternative<I>, T>) {
+    construct<I>(std::forward<T>(value));
+  }
+
+  template <typename T, typename... Args>
+    requires variant_detail::kOccursOnce<T, Ts...> && std::is_constructible_v<T, Args...>
+  explicit Variant(std::in_place_type_t<T>, Args&&... args) {
+    construct<variant_detail::index_of<T, Ts...>()>(std::forward<Args>(args)...);
+  }
+
+  template <std::size_t I, typename... Args>
+    requires(I < sizeof...(Ts)) && std::is_constructible_v<Alternative<I>, Args...>
+  explicit Variant(std::in_place_index_t<I>, Args&&... args) {
+    construct<I>(std::forward<Args>(args)...);
+  }
+
+  Variant(const Variant&)
+    requires kTriviallyCopyable
+  = default;
+  Variant(const Variant& other) noexcept((std::is_nothrow_copy_constructible_v<Ts> && ...))
+    requires(!kTriviallyCopyable && (std::is_copy_constructible_v<Ts> && ...))
+  {
+    other.for_active([&](auto index) { construct<index>(unchecked<index>(other)); });
+  }
+
+  Variant(Variant&&)
+    requires kTriviallyMovable
+  = default;
+  Variant(Variant&& other) noexcept((std::is_nothrow_move_constructible_v<Ts> && ...))
+    requires(!kTriviallyMovable && (std::is_move_constructible_v<Ts> && ...))
+  {
+    other.for_active([&](auto index) {
+      construct<index>(std::move(unchecked<index>(other)));
+    });
+  }
+
+  Variant& operator=(const Variant&)
+    requires kTriviallyCopyable
+  = default;
+  Variant& operator=(const Variant& other)
+    requires(!kTriviallyCopyable && (std::is_copy_constructible_v<Ts> && ...) &&
+             (std::is_copy_assignable_v<Ts> && ...))
+  {
+    if (other.valueless_by_exception()) {
+      reset();
+      return *this;
+    }
+    other.for_active([&](auto index) {
+      const auto& value = unchecked<index>(other);
+      using T = Alternative<index>;
+      if (index_ == index) {
+        unchecked<index>(*this) = value;
+      } else if constexpr (std::is_nothrow_copy_constructible_v<T> ||
+                           !std::is_nothrow_move_constructible_v<T>) {
+        emplace<index>(value);
+      } else {
+        emplace<index>(T(value));
+      }
+    });
+    return *this;
+  }
+
+  Variant& operator=(Variant&&)
+    requires kTriviallyMovable
+  = default;
+  Variant& operator=(Variant&& other) noexcept(
+      ((std::is_nothrow_move_constructible_v<Ts> && std::is_nothrow_move_assignable_v<Ts>) &&
+       ...))
+    requires(!kTriviallyMovable && (std::is_move_constructible_v<Ts> && ...) &&
+             (std::is_move_assignable_v<Ts> && ...))
+  {
+    if (other.valueless_by_exception()) {
+      reset();
+      return *this;
+    }
+    other.for_active([&](auto index) {
+      auto&& value = std::move(unchecked<index>(other));
+      if (index_ == index) {
+        unchecked<index>(*this) = std::move(value);
+      } else {
+        emplace<index>(std::move(value));
+      }
+    });
+    return *this;
+  }
+
+  template <typename T, std::size_t I = variant_detail::Selected<T, Ts...>::value>
+    requires(!std::is_same_v<std::remove_cvref_t<T>, Variant> &&
+             std::is_constructible_v<Alternative<I>, T> &&
+             std::is_assignable_v<Alternative<I>&, T>)
+  Variant& operator=(T&& value) noexcept(std::is_nothrow_assignable_v<Alternative<I>&, T> &&
+                                         std::is_nothrow_constructible_v<Alternative<I>, T>) {
+    using Target = Alternative<I>;
+    if (index_ == I) {
+      unchecked<I>(*this) = std::forward<T>(value);
+    } else if constexpr (std::is_nothrow_constructible_v<Target, T> ||
+                         !std::is_nothrow_move_constructible_v<Target>) {
+      emplace<I>(std::forward<T>(value));
+    } else {
+      emplace<I>(Target(std::forward<T>(value)));
+    }
+    return *this;
+  }
+
+  ~Variant()
+    requires(std::is_trivially_destructible_v<Ts> && ...)
+  = default;
+  ~Variant() { reset(); }
+
+  // If the constructor throws, the variant is left valueless, except when
+  // every alternative is trivially copyable: the new value is then built
+  // aside first, and the old one survives.
+  template <typename T, typename... Args>
+    requires variant_detail::kOccursOnce<T, Ts...> && std::is_constructible_v<T, Args...>
+  T& emplace(Args&&... args) {
+    return emplace<variant_detail::index_of<T, Ts...>()>(std::forward<Args>(args)...);
+  }
+
+  template <std::size_t I, typename... Args>
+    requires(I < sizeof...(Ts)) && std::is_constructible_v<Alternative<I>, Args...>
+  Alternative<I>& emplace(Args&&... args) {
+    if constexpr (kNeverValueless && !std::is_nothrow_constructible_v<Alternative<I>, Args...>) {
+      Alternative<I> value(std::forward<Args>(args)...);
+      reset();
+      construct<I>(std::move(value));
+    } else {
+      reset();
+      construct<I>(std::forward<Args>(args)...);
+    }
+    return unchecked<I>(*this);
+  }
+
+  std::size_t index() const noexcept {
+    return valueless_by_exception() ? npos : static_cast<std::size_t>(index_);
+  }
+  bool valueless_by_exception() const noexcept {
+    if constexpr (kNeverValueless) {
+      return false;
+    } else {
+      return index_ == kValueless;
+    }
+  }
+
+  void swap(Variant& other) noexcept(
+      ((std::is_nothrow_move_constructible_v<Ts> && std::is_nothrow_swappable_v<Ts>) && ...)) {
+    if (index_ == other.index_) {
+      for_active([&](auto index) {
+        using std::swap;
+        swap(unchecked<index>(*this), unchecked<index>(other));
+      });
+    } else {
+      Variant tmp(std::move(other));
+      other = std::move(*this);
+      *this = std::move(tmp);
+    }
+  }
+  friend void swap(Variant& lhs, Variant& rhs) noexcept(noexcept(lhs.swap(rhs))) {
+    lhs.swap(rhs);
+  }
+
+  friend bool operator==(const Variant& lhs, const Variant& rhs)
+    requires(std::equality_comparable<Ts> && ...)
+  {
+    if (lhs.index_ != rhs.index_) {
+      return false;
+    }
+    if (lhs.valueless_by_exception()) {
+      return true;
+    }
+    return variant_detail::dispatch<sizeof...(Ts), bool>(lhs.index_, [&](auto index) {
+      return unchecked<index>(lhs) == unchecked<index>(rhs);
+    });
+  }
+
+  // A valueless variant orders before every other; otherwise by index,
+  // then by value.
+  friend auto operator<=>(const Variant& lhs, const Variant& rhs)
+    requires(std::three_way_comparable<Ts> && ...)
+  {
+    using Result = std::common_comparison_category_t<std::compare_three_way_result_t<Ts>...>;
+    if (lhs.valueless_by_exception() || rhs.valueless_by_exception()) {
+      return Result(rhs.valueless_by_exception() <=> lhs.valueless_by_exception());
+    }
+    if (lhs.index_ != rhs.index_) {
+      return Result(lhs.index_ <=> rhs.index_);
+    }
+    return variant_detail::dispatch<sizeof...(Ts), Result>(lhs.index_, [&](auto index) {
+      return Result(unchecked<index>(lhs) <=> unchecked<index>(rhs));
+    });
+  }
+
+ private:
+  friend struct variant_detail::Access;
+
+  template <std::size_t I, typename... Args>
+  void construct(Args&&... args) {
+    index_ = kValueless;
+    ::new (static_cast<void*>(storage_)) Alternative<I>(std::forward<Args>(args)...);
+    index_ = static_cast<Index>(I);
+  }
+
+  void reset() noexcept {
+    if constexpr (!(std::is_trivially_destructible_v<Ts> && ...)) {
+      for_active([&](auto index) {
+        using T = Alternative<index>;
+        unchecked<index>(*this).~T();
+      });
+    }
+    index_ = kValueless;
+  }
+
+  // Runs f(std::integral_constant<std::size_t, index()>) unless valueless.
+  template <typename F>
+  void for_active(F&& f) const {
+    if (!valueless_by_exception()) {
+      variant_detail::dispatch<sizeof...(Ts), void>(index_, std::forward<F>(f));
+    }
+  }
+
+  // The alternative I of `self` with the value category of `self`.
+  template <std::size_t I, typename Self>
+  static decltype(auto) unchecked(Self&& self) noexcept {
+    using T = Alternative<I>;
+    using Qualified = std::conditional_t<std::is_const_v<std::remove_reference_t<Self>>,
+                                         const T, T>;
+    auto* ptr = std::launder(reinterpret_cast<Qualified*>(self.storage_));
+    if constexpr (std::is_lvalue_reference_v<Self>) {
+      return static_cast<Qualified&>(*ptr);
+    } else {
+      return static_cast<Qualified&&>(*ptr);
+    }
+  }
+
+  alignas(Ts...) std::byte storage_[variant_detail::kMaxOf<sizeof(Ts)...>];
+  Index index_ = kValueless;
+};
+
+namespace variant_detail {
+
+template <std::size_t I, typename V>
+decltype(auto) get_checked(V&& variant) {
+  if (variant.index() != I) {
+    throw std::bad_variant_access();
+  }
+  return Access::get<I>(std::forward<V>(variant));
+}
+
+// Mixed-radix strides of the flattened index, the last variant varying
+// fastest: combination K selects alternative K / stride % size of each.
+template <typename... Vs>
+struct Strides {
+  static constexpr std::size_t kSizes[] = {kSizeOf<Vs>...};
+  template <std::size_t P>
+  static constexpr std::size_t kStride = [] {
+    std::size_t stride = 1;
+    for (std::size_t i = P + 1; i < sizeof...(Vs); ++i) {
+      stride *= kSizes[i];
+    }
+    return stride;
+  }();
+};
+
+template <typename R, typename Positions, typename Visitor, typename... Vs>
+struct VisitTable;
+
+// One function per combination and nothing else, which is what keeps
+// visiting many variants cheap to compile.
+template <typename R, std::size_t... Ps, typename Visitor, typename... Vs>
+struct VisitTable<R, std::index_sequence<Ps...>, Visitor, Vs...> {
+  template <std::size_t K>
+  static R call(Visitor&& visitor, Vs&&... variants) {
+    return static_cast<R>(std::forward<Visitor>(visitor)(
+        Access::get<K / Strides<Vs...>::template kStride<Ps> % kSizeOf<Vs>>(
+            std::forward<Vs>(variants))...));
+  }
+
+  template <std::size_t... Ks>
+  static R call_flat(std::size_t flat, std::index_sequence<Ks...>, Visitor&& visitor,
+                     Vs&&... variants) {
+    static constexpr R (*kTable[])(Visitor&&, Vs&&...) = {&call<Ks>...};
+    return kTable[flat](std::forward<Visitor>(visitor), std::forward<Vs>(variants)...);
+  }
+};
+
+template <typename R, typename Visitor, typename... Vs>
+R visit_flat(std::size_t flat, Visitor&& visitor, Vs&&... variants) {
+  using Table = VisitTable<R, std::index_sequence_for<Vs...>, Visitor, Vs...>;
+  constexpr std::size_t kCombinations = (kSizeOf<Vs> * ...);
+  if constexpr (kCombinations > kSwitchLimit) {
+    return Table::call_flat(flat, std::make_index_sequence<kCombinations>(),
+                            std::forward<Visitor>(visitor), std::forward<Vs>(variants)...);
+  } else {
+    return dispatch<kCombinations, R>(flat, [&](auto combination) -> R {
+      return Table::template call<decltype(combination)::value>(std::forward<Visitor>(visitor),
+                                                                std::forward<Vs>(variants)...);
+    });
+  }
+}
+
+template <typename R, typename Visitor, typename... Vs>
+R visit_impl(Visitor&& visitor, Vs&&... variants) {
+  if ((variants.valueless_by_exception() || ...)) {
+    throw std::bad_variant_access();
+  }
+  std::size_t flat = 0;
+  ((flat = flat * kSizeOf<Vs> + variants.index()), ...);
+  return visit_flat<R>(flat, std::forward<Visitor>(visitor), std::forward<Vs>(variants)...);
+}
+
+}  // namespace variant_detail
+
+template <typename T, typename... Ts>
+bool holds_alternative(const Variant<Ts...>& variant) noexcept {
+  static_assert(variant_detail::kOccursOnce<T, Ts...>,
+                "holds_alternative: T must occur exactly once in the alternatives");
+  return variant.index() == variant_detail::index_of<T, Ts...>();
+}
+
+template <std::size_t I, typename... Ts>
+decltype(auto) get(Variant<Ts...>& variant) {
+  return variant_detail::get_checked<I>(variant);
+}
+template <std::size_t I, typename... Ts>
+decltype(auto) get(const Variant<Ts...>& variant) {
+  return variant_detail::get_checked<I>(variant);
+}
+template <std::size_t I, typename... Ts>
+decltype(auto) get(Variant<Ts...>&& variant) {
+  return variant_detail::get_checked<I>(std::move(variant));
+}
+template <std::size_t I, typename... Ts>
+decltype(auto) get(const Variant<Ts...>&& variant) {
+  return variant_detail::get_checked<I>(std::move(variant));
+}
+
+template <typename T, typename... Ts>
+  requires variant_detail::kOccursOnce<T, Ts...>
+T& get(Variant<Ts...>& variant) {
+  return get<variant_detail::index_of<T, Ts...>()>(variant);
+}
+template <typename T, typename... Ts>
+  requires variant_detail::kOccursOnce<T, Ts...>
+const T& get(const Variant<Ts...>& variant) {
+  return get<variant_detail::index_of<T, Ts...>()>(variant);
+}
+template <typename T, typename... Ts>
+  requires variant_detail::kOccursOnce<T, Ts...>
+T&& get(Variant<Ts...>&& variant) {
+  return get<variant_detail::index_of<T, Ts...>()>(std::move(variant));
+}
+template <typename T, typename... Ts>
+  requires variant_detail::kOccursOnce<T, Ts...>
+const T&& get(const Variant<Ts...>&& variant) {
+  return get<variant_detail::index_of<T, Ts...>()>(std::move(variant));
+}
+
+template <std::size_t I, typename... Ts>
+auto* get_if(Variant<Ts...>* variant) noexcept {
+  using T = variant_detail::TypeAt<I, Ts...>;
+  return variant != nullptr && variant->index() == I
+             ? std::addressof(variant_detail::Access::get<I>(*variant))
+             : static_cast<T*>(nullptr);
+}
+template <std::size_t I, typename... Ts>
+auto* get_if(const Variant<Ts...>* variant) noexcept {
+  using T = variant_detail::TypeAt<I, Ts...>;
+  return variant != nullptr && variant->index() == I
+             ? std::addressof(variant_detail::Access::get<I>(*variant))
+             : static_cast<const T*>(nullptr);
+}
+template <typename T, typename... Ts>
+  requires variant_detail::kOccursOnce<T, Ts...>
+T* get_if(Variant<Ts...>* variant) noexcept {
+  return get_if<variant_detail::index_of<T, Ts...>()>(variant);
+}
+template <typename T, typename... Ts>
+  requires variant_detail::kOccursOnce<T, Ts...>
+const T* get_if(const Variant<Ts...>* variant) noexcept {
+  return get_if<variant_detail::index_of<T, Ts...>()>(variant);
+}
+
+// The result type is the visitor's result for the first alternatives. The
+// visitor is called directly rather than through std::invoke, so it cannot
+// be a pointer to member.
+template <typename Visitor, variant_detail::AnyVariant... Vs>
+decltype(auto) visit(Visitor&& visitor, Vs&&... variants) {
+  using R = decltype(std::forward<Visitor>(visitor)(
+      variant_detail::Access::get<0>(std::forward<Vs>(variants))...));
+  return variant_detail::visit_impl<R>(std::forward<Visitor>(visitor),
+                                       std::forward<Vs>(variants)...);
+}
+
+template <typename R, typename Visitor, variant_detail::AnyVariant... Vs>
+R visit(Visitor&& visitor, Vs&&... variants) {
+  return variant_detail::visit_impl<R>(std::forward<Visitor>(visitor),
+                                       std::forward<Vs>(variants)...);
+}
@@ -0,0 +1,100 @@
+# Helpers shared by the portfolio projects.
+#
+#   portfolio_add_library(<name> [SOURCES <src>...] [DEPENDS <lib>...])
+#     Builds the project library <name>. Without SOURCES the library is header
+#     only. Headers are included relative to the repository root, e.g.
+#     #include "BigInteger/biginteger.h".
+#
+#   portfolio_add_test(<name> SOURCES <src>... [DEPENDS <lib>...])
+#     Builds a GoogleTest executable from the project's tests/ directory and
+#     registers each of its tests with CTest. Does nothing when
+#     PORTFOLIO_BUILD_TESTS is OFF.
+#
+#   portfolio_add_benchmark(<name> SOURCES <src>... [DEPENDS <lib>...])
+#     Builds a Google Benchmark executable and registers it with the bench
+#     target. Does nothing when PORTFOLIO_BUILD_BENCHMARKS is OFF.
+
+add_library(portfolio_options INTERFACE)
+target_include_directories(portfolio_options INTERFACE "${PROJECT_SOURCE_DIR}")
+if(CMAKE_CXX_COMPILER_ID MATCHES "GNU|Clang")
+  target_compile_options(portfolio_options INTERFACE -Wall -Wextra -Wpedantic)
+endif()
+# On every target alike: whether the macros of Instrument/instrument.h
+# expand must not differ between translation units.
+if(PORTFOLIO_INSTRUMENT)
+  target_compile_definitions(portfolio_options INTERFACE PORTFOLIO_INSTRUMENT=1)
+endif()
+
+# A GoogleTest from another prefix, such as a conda environment, puts that
+# prefix on the tests' run path, and with it a libstdc++ that may be older
+# than the compiler's. The tests look in the compiler's runtime directory
+# first.
+if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+  execute_process(COMMAND "${CMAKE_CXX_COMPILER}" -print-file-name=libstdc++.so.6
+                  OUTPUT_VARIABLE runtime
+                  OUTPUT_STRIP_TRAILING_WHITESPACE)
+  if(IS_ABSOLUTE "${runtime}")
+    get_filename_component(runtime "${runtime}" REALPATH)
+    get_filename_component(PORTFOLIO_CXX_RUNTIME_DIR "${runtime}" DIRECTORY)
+  endif()
+endif()
+
+function(portfolio_add_library name)
+  cmake_parse_arguments(ARG "" "" "SOURCES;DEPENDS" ${ARGN})
+  if(ARG_SOURCES)
+    add_library(${name} STATIC ${ARG_SOURCES})
+    target_link_libraries(${name} PUBLIC portfolio_options ${ARG_DEPENDS})
+  else()
+    add_library(${name} INTERFACE)
+    target_link_libraries(${name} INTERFACE portfolio_options ${ARG_DEPENDS})
+  endif()
+endfunction()
+
+function(portfolio_add_test name)
+  if(NOT PORTFOLIO_BUILD_TESTS)
+    return()
+  endif()
+  cmake_parse_arguments(ARG "" "" "SOURCES;DEPENDS" ${ARGN})
+  add_executable(${name} ${ARG_SOURCES})
+  target_link_libraries(${name} PRIVATE ${ARG_DEPENDS} GTest::gtest_main)
+  if(PORTFOLIO_CXX_RUNTIME_DIR)
+    set_property(TARGET ${name} PROPERTY BUILD_RPATH "${PORTFOLIO_CXX_RUNTIME_DIR}")
+  endif()
+  # Listed when ctest runs rather than after every link.
+  gtest_discover_tests(${name} DISCOVERY_MODE PRE_TEST)
+endfunction()
+
+function(portfolio_add_benchmark name)
+  if(NOT PORTFOLIO_BUILD_BENCHMARKS)
+    return()
+  endif()
+  cmake_parse_arguments(ARG "" "" "SOURCES;DEPENDS" ${ARGN})
+  add_executable(${name} ${ARG_SOURCES})
+  target_link_libraries(${name} PRIVATE ${ARG_DEPENDS} benchmark::benchmark_main)
+  set_property(GLOBAL APPEND PROPERTY PORTFOLIO_BENCHMARKS ${name})
+endfunction()
+
+# Must be called after all projects are added: the bench target runs every
+# registered suite and collects their JSON reports into PORTFOLIO_BENCH_OUTPUT.
+function(portfolio_add_bench_target)
+  if(NOT PORTFOLIO_BUILD_BENCHMARKS)
+    return()
+  endif()
+  get_property(suites GLOBAL PROPERTY PORTFOLIO_BENCHMARKS)
+  set(executables "")
+  foreach(suite IN LISTS suites)
+    list(APPEND executables "$<TARGET_FILE:${suite}>")
+  endforeach()
+  string(REPLACE ";" "|" executables "${executables}")
+  add_custom_target(bench
+    COMMAND "${CMAKE_COMMAND}"
+            "-DBENCHMARKS=${executables}"
+            "-DOUTPUT=${PORTFOLIO_BENCH_OUTPUT}"
+            "-DMIN_TIME=${PORTFOLIO_BENCH_MIN_TIME}"
+            "-DWORK_DIR=${CMAKE_CURRENT_BINARY_DIR}/bench_results"
+            -P "${PROJECT_SOURCE_DIR}/cmake/RunBenchmarks.cmake"
+    DEPENDS ${suites}
+    USES_TERMINAL
+    VERBATIM
+    COMMENT "Running benchmarks, results go to ${PORTFOLIO_BENCH_OUTPUT}")
+endfunction()
@@ -0,0 +1,35 @@
+# Runs a list of Google Benchmark executables and merges their JSON reports.
+#
+# Invoked by the bench target as a script:
+#   cmake -DBENCHMARKS=<exe>|<exe>... -DOUTPUT=<file> -DMIN_TIME=<seconds>
+#         -DWORK_DIR=<dir> -P RunBenchmarks.cmake
+#
+# The output is a single JSON document {"suites": [<report>, ...]} where every
+# report is the unmodified --benchmark_out of one executable.
+
+string(REPLACE "|" ";" benchmarks "${BENCHMARKS}")
+file(MAKE_DIRECTORY "${WORK_DIR}")
+
+set(body "")
+set(separator "")
+foreach(exe IN LISTS benchmarks)
+  get_filename_component(suite "${exe}" NAME_WE)
+  set(report "${WORK_DIR}/${suite}.json")
+  message(STATUS "Running ${suite}")
+  execute_process(
+    COMMAND "${exe}"
+            "--benchmark_out=${report}"
+            --benchmark_out_format=json
+            "--benchmark_min_time=${MIN_TIME}"
+    RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${suite} failed: ${result}")
+  endif()
+  file(READ "${report}" content)
+  string(STRIP "${content}" content)
+  string(APPEND body "${separator}${content}")
+  set(separator ",\n")
+endforeach()
+
+file(WRITE "${OUTPUT}" "{\"suites\": [\n${body}\n]}\n")
+message(STATUS "Benchmark results written to ${OUTPUT}")